@@ -47,7 +47,7 @@ const bool needs_escape(const wint_t _char)
 	return iswcntrl(_char) || (_char == '"') || (_char == '\\');
 }
 
-inline void output_char(std::ostream& os, char c)
+void output_char(std::ostream& os, char c)
 {
 	if (needs_escape((int)c))
 	{
@@ -72,7 +72,7 @@ inline void output_char(std::ostream& os, char c)
 		os << c;
 }
 
-inline void output_wchar(std::ostream& os, wchar_t c)
+void output_wchar(std::ostream& os, wchar_t c)
 {
 	if (needs_escape((wint_t)c))
 	{
@@ -40,7 +40,9 @@
 #include <sstream> // For std::stringstream
 #include <iostream> // For std::cout
 #include <iomanip> // For std::setw
+#include <memory> // For std::unique_ptr
 #include "Cxbx.h" // For g_bPrintfOn
+#include "Common/TraceRing.h" // For TraceRecord
 
 //
 // __FILENAME__
@@ -69,8 +71,8 @@ constexpr const char* file_name(const char* str) {
 //
 
 extern const bool needs_escape(const wint_t _char);
-extern inline void output_char(std::ostream& os, char c);
-extern inline void output_wchar(std::ostream& os, wchar_t c);
+extern void output_char(std::ostream& os, char c);
+extern void output_wchar(std::ostream& os, wchar_t c);
 
 //
 // Data sanitization functions
@@ -225,6 +227,7 @@ extern thread_local std::string _logPrefix;
 
 #define LOG_INIT \
 	LOG_THREAD_INIT \
+	static const char * const _logSource = __FILENAME__; \
 	static std::string _logFuncPrefix; \
 	if (_logFuncPrefix.length() == 0) {	\
 		std::stringstream tmp; \
@@ -232,69 +235,81 @@ extern thread_local std::string _logPrefix;
 		_logFuncPrefix = tmp.str(); \
 	}
 
+// While a binary trace is running (see TraceRing.h), the macros below only record
+// the raw argument values; otherwise they format text when g_bPrintfOn is set.
+
 #define LOG_FUNC_BEGIN \
 	LOG_INIT \
-	do { if(g_bPrintfOn) { \
+	do { if(g_bTraceRingOn || g_bPrintfOn) { \
+		TraceRecord _trace(TRACE_KIND_CALL, _logSource, __func__); \
 		bool _had_arg = false; \
-		std::stringstream msg; \
-		msg << _logFuncPrefix << "(";
+		std::unique_ptr<std::stringstream> msg(_trace ? nullptr : new std::stringstream); \
+		if (msg) *msg << _logFuncPrefix << "(";
 
 // LOG_FUNC_ARG writes output via all available ostream << operator overloads, sanitizing and adding detail where possible
 #define LOG_FUNC_ARG(arg) \
 		_had_arg = true; \
-		msg << LOG_ARG_START << #arg << " : " << _log_sanitize(arg);
+		if (_trace) _trace.Arg(#arg, arg); \
+		else *msg << LOG_ARG_START << #arg << " : " << _log_sanitize(arg);
 
 // LOG_FUNC_ARG_TYPE writes output using the overloaded << operator of the given type
 #define LOG_FUNC_ARG_TYPE(type, arg) \
 		_had_arg = true; \
-		msg << LOG_ARG_START << #arg << " : " << (type)arg;
+		if (_trace) _trace.Arg(#arg, (type)arg); \
+		else *msg << LOG_ARG_START << #arg << " : " << (type)arg;
 
 // LOG_FUNC_ARG_OUT prevents expansion of types, by only rendering as a pointer
 #define LOG_FUNC_ARG_OUT(arg) \
 		_had_arg = true; \
-		msg << LOG_ARG_OUT_START << #arg << " : " << hex4((uint32_t)arg);
+		if (_trace) _trace.Arg(#arg, (uint32_t)arg); \
+		else *msg << LOG_ARG_OUT_START << #arg << " : " << hex4((uint32_t)arg);
 
 // LOG_FUNC_END closes off function and optional argument logging
 #define LOG_FUNC_END \
-		if (_had_arg) msg << "\n"; \
-		msg << ");\n"; \
-		std::cout << msg.str(); \
+		if (msg) { \
+			if (_had_arg) *msg << "\n"; \
+			*msg << ");\n"; \
+			std::cout << msg->str(); \
+		} \
 	} } while (0)
 
 // LOG_FUNC_RESULT logs the function return result
 #define LOG_FUNC_RESULT(r) \
-	std::cout << _logFuncPrefix << " returns " << r << "\n";
+	do { if(g_bTraceRingOn) { \
+		TraceRecord _trace(TRACE_KIND_RESULT, _logSource, __func__); \
+		_trace.Arg("returns", r); \
+	} else if(g_bPrintfOn) { \
+		std::cout << _logFuncPrefix << " returns " << r << "\n"; \
+	} } while (0);
+
+// LOG_MESSAGE logs a fixed text after the function name
+#define LOG_MESSAGE(text) \
+	do { if(g_bTraceRingOn) { \
+		TraceRecord _trace(TRACE_KIND_MESSAGE, _logSource, __func__, text); \
+	} else if(g_bPrintfOn) { \
+		std::cout << _logFuncPrefix << text << "\n"; \
+	} } while (0)
 
 // LOG_FORWARD indicates that an api is implemented by a forward to another API
 #define LOG_FORWARD(api) \
 	LOG_INIT \
-	do { if(g_bPrintfOn) { \
-		std::cout << _logFuncPrefix << " forwarding to "#api"...\n"; \
-	} } while (0)
+	LOG_MESSAGE(" forwarding to "#api"...")
 
 // LOG_IGNORED indicates that Cxbx consiously ignores an api
 #define LOG_IGNORED() \
-	do { if(g_bPrintfOn) { \
-		std::cout << _logFuncPrefix << " ignored!\n"; \
-	} } while (0)
+	LOG_MESSAGE(" ignored!")
 
 	// LOG_UNIMPLEMENTED indicates that Cxbx is missing an implementation of an api
 #define LOG_UNIMPLEMENTED() \
-	do { if(g_bPrintfOn) { \
-		std::cout << _logFuncPrefix << " unimplemented!\n"; \
-	} } while (0)
+	LOG_MESSAGE(" unimplemented!")
 
 	// LOG_INCOMPLETE indicates that Cxbx is missing part of an implementation of an api
 #define LOG_INCOMPLETE() \
-	do { if(g_bPrintfOn) { \
-		std::cout << _logFuncPrefix << " incomplete!\n"; \
-	} } while (0)
+	LOG_MESSAGE(" incomplete!")
 
 	// LOG_NOT_SUPPORTED indicates that Cxbx cannot implement (part of) an api
 #define LOG_NOT_SUPPORTED() \
-	do { if(g_bPrintfOn) { \
-		std::cout << _logFuncPrefix << __func__ << " not supported!\n"; \
-	} } while (0)
+	LOG_MESSAGE(" not supported!")
 
 #else // _DEBUG_TRACE
 
@@ -0,0 +1,481 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Core->PushBufferDecoder.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "PushBufferDecoder.h"
+#include "CxbxKrnl/xxhash32.h"
+
+#include <chrono>
+#include <cstring>
+
+// number of jumps, calls and returns allowed in a row before giving up
+#define PUSHBUFFER_MAX_JUMPS 1024
+
+PushBufferDecoder::PushBufferDecoder() : m_LastRegion(0)
+{
+}
+
+void PushBufferDecoder::Map(uint32_t Address, const void *pData, uint32_t Size)
+{
+    Region NewRegion;
+
+    NewRegion.Address = Address;
+    NewRegion.Size = Size;
+    NewRegion.pData = (const uint8_t*)pData;
+
+    // replace an earlier mapping of the same memory
+    for(size_t r = 0; r < m_Regions.size(); r++)
+    {
+        if(m_Regions[r].Address == Address)
+        {
+            m_Regions.erase(m_Regions.begin() + r);
+            break;
+        }
+    }
+
+    m_Regions.push_back(NewRegion);
+    m_LastRegion = m_Regions.size() - 1;
+}
+
+void PushBufferDecoder::Unmap()
+{
+    m_Regions.clear();
+    m_LastRegion = 0;
+}
+
+const uint32_t *PushBufferDecoder::Translate(uint32_t Address, uint32_t Words)
+{
+    uint64_t End = (uint64_t)Address + (uint64_t)Words * sizeof(uint32_t);
+
+    // most lookups hit the region of the previous one
+    if(m_LastRegion < m_Regions.size())
+    {
+        const Region &Last = m_Regions[m_LastRegion];
+
+        if(Address >= Last.Address && End <= (uint64_t)Last.Address + Last.Size)
+            return (const uint32_t*)(Last.pData + (Address - Last.Address));
+    }
+
+    for(size_t r = m_Regions.size(); r-- > 0; )
+    {
+        const Region &Current = m_Regions[r];
+
+        if(Address >= Current.Address && End <= (uint64_t)Current.Address + Current.Size)
+        {
+            m_LastRegion = r;
+
+            return (const uint32_t*)(Current.pData + (Address - Current.Address));
+        }
+    }
+
+    return NULL;
+}
+
+PUSHBUFFER_STATUS PushBufferDecoder::Decode(uint32_t Get, uint32_t Put, PushBufferHandler *pHandler, uint32_t *pStopAddress)
+{
+    PUSHBUFFER_STATUS Status = PUSHBUFFER_OK;
+
+    uint32_t ReturnAddress = 0;
+    bool bInCall = false;
+    uint32_t dwJumps = 0;
+
+    while(Get != Put)
+    {
+        const uint32_t *pWord = Translate(Get, 1);
+
+        if(pWord == NULL)
+        {
+            Status = PUSHBUFFER_BAD_ADDRESS;
+            break;
+        }
+
+        uint32_t Word = *pWord;
+
+        // jumps, calls and returns
+        if((Word & PUSHBUFFER_OLD_JUMP_MASK) == PUSHBUFFER_OLD_JUMP
+         || (Word & PUSHBUFFER_COMMAND_TYPE_MASK) != PUSHBUFFER_COMMAND_METHOD
+         || Word == PUSHBUFFER_COMMAND_RETURN)
+        {
+            if(++dwJumps > PUSHBUFFER_MAX_JUMPS)
+            {
+                Status = PUSHBUFFER_RUNAWAY;
+                break;
+            }
+
+            if((Word & PUSHBUFFER_OLD_JUMP_MASK) == PUSHBUFFER_OLD_JUMP)
+            {
+                Get = Word & 0x1FFFFFFC;
+            }
+            else if((Word & PUSHBUFFER_COMMAND_TYPE_MASK) == PUSHBUFFER_COMMAND_JUMP)
+            {
+                Get = Word & ~PUSHBUFFER_COMMAND_TYPE_MASK;
+            }
+            else if((Word & PUSHBUFFER_COMMAND_TYPE_MASK) == PUSHBUFFER_COMMAND_CALL)
+            {
+                if(bInCall)
+                {
+                    Status = PUSHBUFFER_NESTED_CALL;
+                    break;
+                }
+
+                ReturnAddress = Get + sizeof(uint32_t);
+                bInCall = true;
+                Get = Word & ~PUSHBUFFER_COMMAND_TYPE_MASK;
+            }
+            else if(Word == PUSHBUFFER_COMMAND_RETURN)
+            {
+                if(!bInCall)
+                {
+                    Status = PUSHBUFFER_BAD_RETURN;
+                    break;
+                }
+
+                bInCall = false;
+                Get = ReturnAddress;
+            }
+            else
+            {
+                Status = PUSHBUFFER_BAD_COMMAND;
+                break;
+            }
+
+            continue;
+        }
+
+        dwJumps = 0;
+
+        PushBufferCommand Command;
+
+        Command.Address = Get;
+        Command.Method = PUSHBUFFER_METHOD(Word);
+        Command.Subchannel = PUSHBUFFER_SUBCHANNEL(Word);
+        Command.Count = PUSHBUFFER_COUNT(Word);
+        Command.bNonIncrementing = (Word & PUSHBUFFER_NON_INCREMENTING) != 0;
+
+        uint32_t Next = Get + (1 + Command.Count) * sizeof(uint32_t);
+
+        // the parameters may not run past the put address
+        if(Get < Put && Next > Put)
+        {
+            Status = PUSHBUFFER_TRUNCATED;
+            break;
+        }
+
+        Command.pParameters = (Command.Count > 0) ? Translate(Get + sizeof(uint32_t), Command.Count) : pWord + 1;
+
+        if(Command.pParameters == NULL)
+        {
+            Status = PUSHBUFFER_TRUNCATED;
+            break;
+        }
+
+        if(!pHandler->Command(Command))
+        {
+            Get = Next;
+            Status = PUSHBUFFER_STOPPED;
+            break;
+        }
+
+        Get = Next;
+    }
+
+    if(pStopAddress != NULL)
+        *pStopAddress = Get;
+
+    return Status;
+}
+
+const char *PushBufferDecoder::StatusName(PUSHBUFFER_STATUS Status)
+{
+    switch(Status)
+    {
+        case PUSHBUFFER_OK:          return "OK";
+        case PUSHBUFFER_STOPPED:     return "Stopped";
+        case PUSHBUFFER_BAD_ADDRESS: return "Bad address";
+        case PUSHBUFFER_BAD_COMMAND: return "Bad command";
+        case PUSHBUFFER_TRUNCATED:   return "Truncated";
+        case PUSHBUFFER_NESTED_CALL: return "Nested call";
+        case PUSHBUFFER_BAD_RETURN:  return "Return without call";
+        case PUSHBUFFER_RUNAWAY:     return "Runaway jumps";
+    }
+
+    return "Unknown";
+}
+
+const char *PushBufferDecoder::MethodName(uint32_t Method)
+{
+    switch(Method)
+    {
+        case NV2A_METHOD_SET_BEGIN_END:       return "SetBeginEnd";
+        case NV2A_METHOD_INLINE_INDEX_ARRAY:  return "InlineIndexArray";
+        case NV2A_METHOD_FIX_LOOP:            return "FixLoop";
+        case NV2A_METHOD_INLINE_VERTEX_ARRAY: return "InlineVertexArray";
+    }
+
+    return NULL;
+}
+
+PushBufferRecorder::PushBufferRecorder(const char *szFileName) : m_dwFrames(0)
+{
+    m_File = fopen(szFileName, "wb");
+
+    if(m_File == NULL)
+    {
+        SetFatalError("Could not open push buffer capture file for writing");
+        return;
+    }
+
+    PushBufferCaptureHeader Header;
+
+    Header.Magic = PUSHBUFFER_CAPTURE_MAGIC;
+    Header.Version = PUSHBUFFER_CAPTURE_VERSION;
+
+    if(fwrite(&Header, sizeof(Header), 1, m_File) != 1)
+        SetFatalError("Could not write push buffer capture header");
+}
+
+PushBufferRecorder::~PushBufferRecorder()
+{
+    if(m_File != NULL)
+        fclose(m_File);
+}
+
+void PushBufferRecorder::WriteRecord(uint32_t Type, const void *pData1, uint32_t Size1, const void *pData2, uint32_t Size2)
+{
+    if(m_File == NULL || HasFatalError())
+        return;
+
+    PushBufferRecordHeader Record;
+
+    Record.Type = Type;
+    Record.Size = Size1 + Size2;
+
+    if(fwrite(&Record, sizeof(Record), 1, m_File) != 1
+     || (Size1 > 0 && fwrite(pData1, Size1, 1, m_File) != 1)
+     || (Size2 > 0 && fwrite(pData2, Size2, 1, m_File) != 1))
+    {
+        SetFatalError("Could not write push buffer capture record");
+    }
+}
+
+void PushBufferRecorder::RecordMemory(uint32_t Address, const void *pData, uint32_t Size)
+{
+    uint32_t Hash = XXHash32::hash(pData, Size, 0);
+
+    auto it = m_Memory.find(Address);
+
+    if(it != m_Memory.end() && it->second.first == Size && it->second.second == Hash)
+        return;
+
+    m_Memory[Address] = std::make_pair(Size, Hash);
+
+    WriteRecord(PUSHBUFFER_RECORD_MEMORY, &Address, sizeof(Address), pData, Size);
+}
+
+void PushBufferRecorder::RecordDecode(uint32_t Get, uint32_t Put)
+{
+    uint32_t Range[2] = { Get, Put };
+
+    WriteRecord(PUSHBUFFER_RECORD_DECODE, Range, sizeof(Range), NULL, 0);
+}
+
+void PushBufferRecorder::RecordFrame()
+{
+    m_dwFrames++;
+
+    WriteRecord(PUSHBUFFER_RECORD_FRAME, NULL, 0, NULL, 0);
+
+    if(m_File != NULL)
+        fflush(m_File);
+}
+
+PushBufferReplayer::PushBufferReplayer(const char *szFileName)
+{
+    memset(m_MethodCounts, 0, sizeof(m_MethodCounts));
+    memset(m_MethodParameters, 0, sizeof(m_MethodParameters));
+
+    m_Commands = m_Parameters = m_Decodes = m_Failures = m_MissingMemory = m_Frames = 0;
+    m_Seconds = 0;
+
+    FILE *File = fopen(szFileName, "rb");
+
+    if(File == NULL)
+    {
+        SetFatalError("Could not open push buffer capture file");
+        return;
+    }
+
+    // read the whole capture up front, so replays don't measure disk access
+    uint8_t Buffer[0x10000];
+    size_t Read;
+
+    while((Read = fread(Buffer, 1, sizeof(Buffer), File)) > 0)
+        m_Capture.insert(m_Capture.end(), Buffer, Buffer + Read);
+
+    fclose(File);
+
+    PushBufferCaptureHeader Header;
+
+    if(m_Capture.size() < sizeof(Header))
+    {
+        SetFatalError("Push buffer capture file is too small");
+        return;
+    }
+
+    memcpy(&Header, &m_Capture[0], sizeof(Header));
+
+    if(Header.Magic != PUSHBUFFER_CAPTURE_MAGIC || Header.Version != PUSHBUFFER_CAPTURE_VERSION)
+        SetFatalError("Not a push buffer capture file (or an unsupported version)");
+}
+
+void PushBufferReplayer::Replay(uint32_t Repeat)
+{
+    if(HasFatalError())
+        return;
+
+    auto Start = std::chrono::high_resolution_clock::now();
+
+    for(uint32_t r = 0; r < Repeat; r++)
+    {
+        PushBufferDecoder Decoder;
+
+        size_t Offset = sizeof(PushBufferCaptureHeader);
+
+        while(Offset + sizeof(PushBufferRecordHeader) <= m_Capture.size())
+        {
+            PushBufferRecordHeader Record;
+
+            memcpy(&Record, &m_Capture[Offset], sizeof(Record));
+            Offset += sizeof(Record);
+
+            if(Record.Size > m_Capture.size() - Offset)
+            {
+                SetError("Push buffer capture file is truncated");
+                break;
+            }
+
+            const uint8_t *pData = &m_Capture[Offset];
+            Offset += Record.Size;
+
+            switch(Record.Type)
+            {
+                case PUSHBUFFER_RECORD_MEMORY:
+                {
+                    if(Record.Size < sizeof(uint32_t))
+                        break;
+
+                    uint32_t Address;
+
+                    memcpy(&Address, pData, sizeof(Address));
+
+                    // the capture data stays in memory, so map it in place
+                    Decoder.Map(Address, pData + sizeof(Address), Record.Size - sizeof(Address));
+                    break;
+                }
+                case PUSHBUFFER_RECORD_DECODE:
+                {
+                    if(Record.Size < 2 * sizeof(uint32_t))
+                        break;
+
+                    uint32_t Range[2];
+
+                    memcpy(Range, pData, sizeof(Range));
+
+                    m_Decodes++;
+
+                    PUSHBUFFER_STATUS Status = Decoder.Decode(Range[0], Range[1], this);
+
+                    if(Status != PUSHBUFFER_OK)
+                        m_Failures++;
+
+                    if(Status == PUSHBUFFER_BAD_ADDRESS)
+                        m_MissingMemory++;
+
+                    break;
+                }
+                case PUSHBUFFER_RECORD_FRAME:
+                    m_Frames++;
+                    break;
+            }
+        }
+    }
+
+    std::chrono::duration<double> Elapsed = std::chrono::high_resolution_clock::now() - Start;
+
+    m_Seconds += Elapsed.count();
+}
+
+bool PushBufferReplayer::Command(const PushBufferCommand &Command)
+{
+    uint32_t Index = Command.Method >> 2;
+
+    m_MethodCounts[Index]++;
+    m_MethodParameters[Index] += Command.Count;
+
+    m_Commands++;
+    m_Parameters += Command.Count;
+
+    return true;
+}
+
+void PushBufferReplayer::DumpStatistics(FILE *file)
+{
+    fprintf(file, "Push buffers : %llu decoded (%llu failed, %llu of those on memory outside the capture) in %llu frames\n",
+        (unsigned long long)m_Decodes, (unsigned long long)m_Failures, (unsigned long long)m_MissingMemory, (unsigned long long)m_Frames);
+
+    fprintf(file, "Commands     : %llu, with %llu parameters\n",
+        (unsigned long long)m_Commands, (unsigned long long)m_Parameters);
+
+    if(m_Seconds > 0)
+    {
+        double Words = (double)(m_Commands + m_Parameters);
+
+        fprintf(file, "Throughput   : %.3f seconds, %.1f M commands/s, %.1f MB/s\n",
+            m_Seconds, m_Commands / m_Seconds / 1000000.0, Words * sizeof(uint32_t) / m_Seconds / (1024.0 * 1024.0));
+    }
+
+    fprintf(file, "\n");
+    fprintf(file, "Method  Commands     Parameters\n");
+
+    for(uint32_t m = 0; m < PUSHBUFFER_METHOD_COUNT; m++)
+    {
+        if(m_MethodCounts[m] == 0)
+            continue;
+
+        const char *szName = PushBufferDecoder::MethodName(m << 2);
+
+        fprintf(file, "0x%.04X  %-12llu %-12llu %s\n", m << 2,
+            (unsigned long long)m_MethodCounts[m], (unsigned long long)m_MethodParameters[m], szName != NULL ? szName : "");
+    }
+}
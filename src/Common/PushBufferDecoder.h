@@ -0,0 +1,221 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Core->PushBufferDecoder.h
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef PUSHBUFFERDECODER_H
+#define PUSHBUFFERDECODER_H
+
+#include "Common/Error.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <unordered_map>
+#include <vector>
+
+// NV2A push buffer command words
+#define PUSHBUFFER_COMMAND_TYPE_MASK    0x00000003
+#define PUSHBUFFER_COMMAND_METHOD       0x00000000
+#define PUSHBUFFER_COMMAND_JUMP         0x00000001
+#define PUSHBUFFER_COMMAND_CALL         0x00000002
+#define PUSHBUFFER_COMMAND_RETURN       0x00020000
+#define PUSHBUFFER_OLD_JUMP_MASK        0xE0000003
+#define PUSHBUFFER_OLD_JUMP             0x20000000
+#define PUSHBUFFER_NON_INCREMENTING     0x40000000
+
+#define PUSHBUFFER_METHOD(Word)         ((Word) & 0x00001FFC)
+#define PUSHBUFFER_SUBCHANNEL(Word)     (((Word) >> 13) & 0x7)
+#define PUSHBUFFER_COUNT(Word)          (((Word) >> 18) & 0x7FF)
+
+#define PUSHBUFFER_METHOD_COUNT         (0x2000 / 4)
+
+// methods interpreted by EmuExecutePushBufferRaw
+#define NV2A_METHOD_SET_BEGIN_END       0x000017FC
+#define NV2A_METHOD_INLINE_INDEX_ARRAY  0x00001800
+#define NV2A_METHOD_FIX_LOOP            0x00001808 // parameters are 16 bit indices
+#define NV2A_METHOD_INLINE_VERTEX_ARRAY 0x00001818
+
+typedef enum _PUSHBUFFER_STATUS
+{
+    PUSHBUFFER_OK = 0,          // reached the put address
+    PUSHBUFFER_STOPPED,         // the handler asked to stop
+    PUSHBUFFER_BAD_ADDRESS,     // get address (or jump target) isn't mapped
+    PUSHBUFFER_BAD_COMMAND,     // unknown command word
+    PUSHBUFFER_TRUNCATED,       // parameters run past the put address or mapped memory
+    PUSHBUFFER_NESTED_CALL,     // call while already in a subroutine
+    PUSHBUFFER_BAD_RETURN,      // return without a call
+    PUSHBUFFER_RUNAWAY          // jumps without ever reaching a method
+}
+PUSHBUFFER_STATUS;
+
+// a method header together with its parameters
+struct PushBufferCommand
+{
+    uint32_t        Address;            // of the method header
+    uint32_t        Method;
+    uint32_t        Subchannel;
+    uint32_t        Count;
+    bool            bNonIncrementing;   // all parameters go to Method
+    const uint32_t *pParameters;
+};
+
+// receives the commands found by PushBufferDecoder
+class PushBufferHandler
+{
+    public:
+        virtual ~PushBufferHandler() { }
+
+        // return false to stop decoding
+        virtual bool Command(const PushBufferCommand &Command) = 0;
+};
+
+// decodes push buffers the way the PFIFO DMA pusher reads them
+class PushBufferDecoder
+{
+    public:
+        PushBufferDecoder();
+
+        // make memory reachable at Address (later mappings take precedence)
+        void Map(uint32_t Address, const void *pData, uint32_t Size);
+
+        // forget all mapped memory
+        void Unmap();
+
+        // decode the commands from Get up to Put, following jumps, calls and returns
+        PUSHBUFFER_STATUS Decode(uint32_t Get, uint32_t Put, PushBufferHandler *pHandler, uint32_t *pStopAddress = NULL);
+
+        static const char *StatusName(PUSHBUFFER_STATUS Status);
+        static const char *MethodName(uint32_t Method);
+
+    private:
+        struct Region
+        {
+            uint32_t       Address;
+            uint32_t       Size;
+            const uint8_t *pData;
+        };
+
+        const uint32_t *Translate(uint32_t Address, uint32_t Words);
+
+        std::vector<Region> m_Regions;
+        size_t              m_LastRegion;
+};
+
+// capture files : a header followed by records, all little endian
+#define PUSHBUFFER_CAPTURE_MAGIC        0x42505843 // "CXPB"
+#define PUSHBUFFER_CAPTURE_VERSION      1
+
+typedef enum _PUSHBUFFER_RECORD_TYPE
+{
+    PUSHBUFFER_RECORD_MEMORY = 1,       // Address, followed by the memory contents
+    PUSHBUFFER_RECORD_DECODE = 2,       // Get, Put
+    PUSHBUFFER_RECORD_FRAME  = 3        // end of a frame
+}
+PUSHBUFFER_RECORD_TYPE;
+
+struct PushBufferCaptureHeader
+{
+    uint32_t Magic;
+    uint32_t Version;
+};
+
+struct PushBufferRecordHeader
+{
+    uint32_t Type;
+    uint32_t Size;                      // of the data following this header
+};
+
+// writes push buffers and the memory they use to a capture file
+//
+// Only the memory passed to RecordMemory ends up in the capture. The emulator
+// records the push buffer itself (Data up to Data + Size), so push buffers
+// that jump to or call into memory outside of that range can't be replayed :
+// their decode stops with PUSHBUFFER_BAD_ADDRESS at the first such target.
+// The replayer counts these separately from other failures.
+class PushBufferRecorder : public Error
+{
+    public:
+        PushBufferRecorder(const char *szFileName);
+       ~PushBufferRecorder();
+
+        // memory is only written again once its contents changed
+        void RecordMemory(uint32_t Address, const void *pData, uint32_t Size);
+        void RecordDecode(uint32_t Get, uint32_t Put);
+        void RecordFrame();
+
+        uint32_t GetFrameCount() const { return m_dwFrames; }
+
+    private:
+        void WriteRecord(uint32_t Type, const void *pData1, uint32_t Size1, const void *pData2, uint32_t Size2);
+
+        FILE    *m_File;
+        uint32_t m_dwFrames;
+
+        // size and hash of the memory last recorded per address
+        std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>> m_Memory;
+};
+
+// decodes all push buffers in a capture file, without a GPU
+class PushBufferReplayer : public Error, private PushBufferHandler
+{
+    public:
+        PushBufferReplayer(const char *szFileName);
+
+        // decode every captured frame, Repeat times over
+        void Replay(uint32_t Repeat = 1);
+
+        // write per method counts and decode throughput
+        void DumpStatistics(FILE *file);
+
+        uint64_t GetDecodeCount() const { return m_Decodes; }
+        uint64_t GetFailureCount() const { return m_Failures; }
+        uint64_t GetMissingMemoryCount() const { return m_MissingMemory; }
+        uint64_t GetFrameCount() const { return m_Frames; }
+        uint64_t GetCommandCount() const { return m_Commands; }
+        uint64_t GetMethodCount(uint32_t Method) const { return m_MethodCounts[(Method >> 2) % PUSHBUFFER_METHOD_COUNT]; }
+
+    private:
+        bool Command(const PushBufferCommand &Command);
+
+        std::vector<uint8_t> m_Capture;
+
+        uint64_t m_MethodCounts[PUSHBUFFER_METHOD_COUNT];
+        uint64_t m_MethodParameters[PUSHBUFFER_METHOD_COUNT];
+        uint64_t m_Commands;
+        uint64_t m_Parameters;
+        uint64_t m_Decodes;
+        uint64_t m_Failures;
+        uint64_t m_MissingMemory;       // failures on memory that wasn't captured
+        uint64_t m_Frames;
+        double   m_Seconds;
+};
+
+#endif
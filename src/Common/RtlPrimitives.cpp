@@ -0,0 +1,229 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Core->RtlPrimitives.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "RtlPrimitives.h"
+
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define RTL_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// index of the lowest set bit, Mask must not be zero
+static inline unsigned int LowestBit(unsigned int Mask)
+{
+#ifdef _MSC_VER
+    unsigned long Index;
+    _BitScanForward(&Index, Mask);
+    return Index;
+#else
+    return __builtin_ctz(Mask);
+#endif
+}
+
+size_t RtlpCompareMemory(const void *pSource1, const void *pSource2, size_t Length)
+{
+    const uint8_t *pBytes1 = (const uint8_t*)pSource1;
+    const uint8_t *pBytes2 = (const uint8_t*)pSource2;
+    size_t i = 0;
+
+#ifdef RTL_SSE2
+    for(; i + 16 <= Length; i += 16)
+    {
+        __m128i Equal = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(pBytes1 + i)),
+                                       _mm_loadu_si128((const __m128i*)(pBytes2 + i)));
+        unsigned int Mask = _mm_movemask_epi8(Equal) ^ 0xFFFF;
+        if(Mask != 0)
+            return i + LowestBit(Mask);
+    }
+#endif
+
+    while(i < Length && pBytes1[i] == pBytes2[i])
+        i++;
+
+    return i;
+}
+
+size_t RtlpCompareMemoryUlong(const void *pSource, size_t Length, uint32_t Pattern)
+{
+    const uint8_t *pBytes = (const uint8_t*)pSource;
+    size_t i = 0;
+
+    Length &= ~(size_t)3;
+
+#ifdef RTL_SSE2
+    __m128i Patterns = _mm_set1_epi32((int)Pattern);
+    for(; i + 16 <= Length; i += 16)
+    {
+        __m128i Equal = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(pBytes + i)), Patterns);
+        unsigned int Mask = _mm_movemask_epi8(Equal) ^ 0xFFFF;
+        if(Mask != 0)
+            return i + (LowestBit(Mask) & ~3);
+    }
+#endif
+
+    for(; i < Length; i += 4)
+    {
+        uint32_t Value;
+        memcpy(&Value, pBytes + i, 4);
+        if(Value != Pattern)
+            break;
+    }
+
+    return i;
+}
+
+void RtlpFillMemoryUlong(void *pDestination, size_t Length, uint32_t Pattern)
+{
+    uint8_t *pBytes = (uint8_t*)pDestination;
+    size_t i = 0;
+
+    Length &= ~(size_t)3;
+
+#ifdef RTL_SSE2
+    __m128i Patterns = _mm_set1_epi32((int)Pattern);
+    for(; i + 16 <= Length; i += 16)
+        _mm_storeu_si128((__m128i*)(pBytes + i), Patterns);
+#endif
+
+    for(; i < Length; i += 4)
+        memcpy(pBytes + i, &Pattern, 4);
+}
+
+size_t RtlpUpcaseUnicodeAscii(uint16_t *pDestination, const uint16_t *pSource, size_t Count)
+{
+    size_t i = 0;
+
+#ifdef RTL_SSE2
+    const __m128i Ascii = _mm_set1_epi16(0x7F);
+    const __m128i BeforeA = _mm_set1_epi16('a' - 1);
+    const __m128i AfterZ = _mm_set1_epi16('z' + 1);
+    const __m128i CaseBit = _mm_set1_epi16(0x20);
+    for(; i + 8 <= Count; i += 8)
+    {
+        __m128i Chars = _mm_loadu_si128((const __m128i*)(pSource + i));
+
+        // leave the rest of the block to the caller, at the first character
+        // above 0x7F (the signed compare takes 0x8000 and up as negative)
+        __m128i Wide = _mm_or_si128(_mm_cmpgt_epi16(Chars, Ascii), _mm_cmplt_epi16(Chars, _mm_setzero_si128()));
+        unsigned int Mask = _mm_movemask_epi8(Wide);
+        if(Mask != 0)
+            break;
+
+        __m128i Lower = _mm_and_si128(_mm_cmpgt_epi16(Chars, BeforeA), _mm_cmplt_epi16(Chars, AfterZ));
+        _mm_storeu_si128((__m128i*)(pDestination + i), _mm_sub_epi16(Chars, _mm_and_si128(Lower, CaseBit)));
+    }
+#endif
+
+    for(; i < Count; i++)
+    {
+        uint16_t Char = pSource[i];
+        if(Char > 0x7F)
+            break;
+
+        pDestination[i] = (Char >= 'a' && Char <= 'z') ? Char - 0x20 : Char;
+    }
+
+    return i;
+}
+
+void RtlpMultiByteToUnicode(uint16_t *pDestination, const char *pSource, size_t Count)
+{
+    const uint8_t *pBytes = (const uint8_t*)pSource;
+    size_t i = 0;
+
+#ifdef RTL_SSE2
+    for(; i + 16 <= Count; i += 16)
+    {
+        __m128i Bytes = _mm_loadu_si128((const __m128i*)(pBytes + i));
+        _mm_storeu_si128((__m128i*)(pDestination + i), _mm_unpacklo_epi8(Bytes, _mm_setzero_si128()));
+        _mm_storeu_si128((__m128i*)(pDestination + i + 8), _mm_unpackhi_epi8(Bytes, _mm_setzero_si128()));
+    }
+#endif
+
+    for(; i < Count; i++)
+        pDestination[i] = pBytes[i];
+}
+
+void RtlpUnicodeToMultiByte(char *pDestination, const uint16_t *pSource, size_t Count)
+{
+    size_t i = 0;
+
+#ifdef RTL_SSE2
+    const __m128i HighByte = _mm_set1_epi16((short)0xFF00);
+    const __m128i Unknown = _mm_set1_epi16('?');
+    for(; i + 16 <= Count; i += 16)
+    {
+        __m128i Chars1 = _mm_loadu_si128((const __m128i*)(pSource + i));
+        __m128i Chars2 = _mm_loadu_si128((const __m128i*)(pSource + i + 8));
+
+        // replace characters above 0xFF, then pack the low bytes
+        __m128i Fits1 = _mm_cmpeq_epi16(_mm_and_si128(Chars1, HighByte), _mm_setzero_si128());
+        __m128i Fits2 = _mm_cmpeq_epi16(_mm_and_si128(Chars2, HighByte), _mm_setzero_si128());
+        Chars1 = _mm_or_si128(_mm_and_si128(Fits1, Chars1), _mm_andnot_si128(Fits1, Unknown));
+        Chars2 = _mm_or_si128(_mm_and_si128(Fits2, Chars2), _mm_andnot_si128(Fits2, Unknown));
+
+        _mm_storeu_si128((__m128i*)(pDestination + i), _mm_packus_epi16(Chars1, Chars2));
+    }
+#endif
+
+    for(; i < Count; i++)
+        pDestination[i] = (pSource[i] <= 0xFF) ? (char)pSource[i] : '?';
+}
+
+size_t RtlpMultiByteToUnicodeN(uint16_t *pDestination, size_t MaxBytesInUnicodeString, const char *pSource, size_t BytesInMultiByteString)
+{
+    size_t MaxUnicodeChars = MaxBytesInUnicodeString / sizeof(uint16_t);
+    size_t NumChars = (MaxUnicodeChars < BytesInMultiByteString) ? MaxUnicodeChars : BytesInMultiByteString;
+
+    RtlpMultiByteToUnicode(pDestination, pSource, NumChars);
+
+    return NumChars * sizeof(uint16_t);
+}
+
+size_t RtlpUnicodeToMultiByteN(char *pDestination, size_t MaxBytesInMultiByteString, const uint16_t *pSource, size_t BytesInUnicodeString)
+{
+    size_t UnicodeChars = BytesInUnicodeString / sizeof(uint16_t);
+    size_t NumChars = (UnicodeChars < MaxBytesInMultiByteString) ? UnicodeChars : MaxBytesInMultiByteString;
+
+    RtlpUnicodeToMultiByte(pDestination, pSource, NumChars);
+
+    return NumChars;
+}
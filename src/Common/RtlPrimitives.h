@@ -0,0 +1,72 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Core->RtlPrimitives.h
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef RTLPRIMITIVES_H
+#define RTLPRIMITIVES_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Memory and string loops behind the Rtl kernel exports, vectorized with
+// SSE2 where available. They follow the Xbox kernel semantics, which differ
+// from the host's : there are no code pages, ANSI strings are Latin-1.
+
+// number of leading bytes that are equal
+size_t RtlpCompareMemory(const void *pSource1, const void *pSource2, size_t Length);
+
+// number of leading bytes (in whole ULONGs) that repeat Pattern,
+// Length is rounded down to a multiple of four
+size_t RtlpCompareMemoryUlong(const void *pSource, size_t Length, uint32_t Pattern);
+
+// repeats Pattern over Length bytes, rounded down to a multiple of four
+void RtlpFillMemoryUlong(void *pDestination, size_t Length, uint32_t Pattern);
+
+// copies and upcases characters until one outside ASCII, returns the number
+// of characters done (so the caller can upcase the next one another way)
+size_t RtlpUpcaseUnicodeAscii(uint16_t *pDestination, const uint16_t *pSource, size_t Count);
+
+// widens Latin-1 characters
+void RtlpMultiByteToUnicode(uint16_t *pDestination, const char *pSource, size_t Count);
+
+// narrows characters to Latin-1, those that don't fit become '?'
+void RtlpUnicodeToMultiByte(char *pDestination, const uint16_t *pSource, size_t Count);
+
+// RtlMultiByteToUnicodeN : converts as many characters as fit in the destination,
+// returns the number of bytes written (an odd byte left in the destination stays untouched)
+size_t RtlpMultiByteToUnicodeN(uint16_t *pDestination, size_t MaxBytesInUnicodeString, const char *pSource, size_t BytesInMultiByteString);
+
+// RtlUnicodeToMultiByteN : converts as many characters as fit in the destination,
+// returns the number of bytes written (an odd byte at the end of the source is ignored)
+size_t RtlpUnicodeToMultiByteN(char *pDestination, size_t MaxBytesInMultiByteString, const uint16_t *pSource, size_t BytesInUnicodeString);
+
+#endif
@@ -0,0 +1,380 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Core->TraceDecoder.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "TraceDecoder.h"
+
+#include <cstring>
+
+TraceDecoder::TraceDecoder(const char *szFileName) : m_TicksPerSecond(1), m_FirstTime(0), m_dwEvents(0), m_dwDropped(0)
+{
+    FILE *File = fopen(szFileName, "rb");
+
+    if(File == NULL)
+    {
+        SetFatalError("Could not open trace file");
+        return;
+    }
+
+    uint8_t Buffer[0x10000];
+    size_t Read;
+
+    while((Read = fread(Buffer, 1, sizeof(Buffer), File)) > 0)
+        m_Trace.insert(m_Trace.end(), Buffer, Buffer + Read);
+
+    fclose(File);
+
+    TraceFileHeader Header;
+
+    if(m_Trace.size() < sizeof(Header))
+    {
+        SetFatalError("Trace file is too small");
+        return;
+    }
+
+    memcpy(&Header, &m_Trace[0], sizeof(Header));
+
+    if(Header.Magic != TRACE_FILE_MAGIC || Header.Version != TRACE_FILE_VERSION)
+    {
+        SetFatalError("Not a trace file (or an unsupported version)");
+        return;
+    }
+
+    if(Header.TicksPerSecond != 0)
+        m_TicksPerSecond = Header.TicksPerSecond;
+}
+
+void TraceDecoder::Render(FILE *file)
+{
+    if(HasFatalError())
+        return;
+
+    m_Strings.clear();
+    m_dwEvents = m_dwDropped = 0;
+
+    bool bFirst = true;
+    size_t Offset = sizeof(TraceFileHeader);
+
+    while(Offset + sizeof(TraceFileRecord) <= m_Trace.size())
+    {
+        TraceFileRecord Record;
+        memcpy(&Record, &m_Trace[Offset], sizeof(Record));
+        Offset += sizeof(Record);
+
+        if(Offset + Record.Size > m_Trace.size())
+        {
+            SetError("Trace file is truncated");
+            break;
+        }
+
+        const uint8_t *pData = &m_Trace[Offset];
+        Offset += Record.Size;
+
+        // every record type starts with a fixed size part
+        size_t MinimumSize = 0;
+
+        switch(Record.Type)
+        {
+            case TRACE_RECORD_STRING:  MinimumSize = sizeof(uint32_t); break;
+            case TRACE_RECORD_EVENT:   MinimumSize = sizeof(TraceFileEvent); break;
+            case TRACE_RECORD_DROPPED: MinimumSize = 2 * sizeof(uint32_t); break;
+        }
+
+        if(Record.Size < MinimumSize)
+        {
+            SetError("Trace file has a record that is too small");
+            continue;
+        }
+
+        switch(Record.Type)
+        {
+            case TRACE_RECORD_STRING:
+            {
+                uint32_t Id;
+                memcpy(&Id, pData, sizeof(Id));
+                m_Strings[Id] = std::string((const char*)pData + sizeof(Id), Record.Size - sizeof(Id));
+                break;
+            }
+
+            case TRACE_RECORD_EVENT:
+            {
+                TraceFileEvent Event;
+                memcpy(&Event, pData, sizeof(Event));
+
+                if(Event.ArgCount > TRACE_MAX_ARGS || Event.StringsUsed > TRACE_STRING_SPACE ||
+                   sizeof(Event) + Event.ArgCount * sizeof(TraceFileArg) + Event.StringsUsed != Record.Size)
+                {
+                    SetError("Trace file has a malformed event");
+                    break;
+                }
+
+                TraceFileArg Args[TRACE_MAX_ARGS];
+                memcpy(Args, pData + sizeof(Event), Event.ArgCount * sizeof(TraceFileArg));
+
+                // string arguments are stored as offsets, keep them within the event
+                char Strings[TRACE_STRING_SPACE + 1];
+                memcpy(Strings, pData + sizeof(Event) + Event.ArgCount * sizeof(TraceFileArg), Event.StringsUsed);
+                Strings[Event.StringsUsed] = 0;
+
+                for(int i = 0; i < Event.ArgCount; i++)
+                {
+                    if((Event.StringMask & (1 << i)) && Args[i].Value >= Event.StringsUsed)
+                        Event.StringMask &= ~(1 << i);
+                }
+
+                if(bFirst)
+                {
+                    m_FirstTime = Event.Time;
+                    bFirst = false;
+                }
+
+                RenderEvent(file, Event, Args, Strings);
+                m_dwEvents++;
+                break;
+            }
+
+            case TRACE_RECORD_DROPPED:
+            {
+                uint32_t Data[2];
+                memcpy(Data, pData, sizeof(Data));
+                fprintf(file, "[0x%X] %u events dropped, the trace ring was full\n", Data[0], Data[1]);
+                m_dwDropped += Data[1];
+                break;
+            }
+        }
+    }
+}
+
+static double Double(uint64_t Value)
+{
+    double d;
+    memcpy(&d, &Value, sizeof(d));
+    return d;
+}
+
+const char *TraceDecoder::String(uint32_t Id)
+{
+    if(Id == 0)
+        return "";
+
+    auto it = m_Strings.find(Id);
+
+    return (it != m_Strings.end()) ? it->second.c_str() : "?";
+}
+
+void TraceDecoder::RenderEvent(FILE *file, const TraceFileEvent &Event, const TraceFileArg *pArgs, const char *pStrings)
+{
+    double Seconds = (double)(Event.Time - m_FirstTime) / m_TicksPerSecond;
+
+    fprintf(file, "%12.6f [0x%X] ", Seconds, Event.ThreadId);
+
+    switch(Event.Kind)
+    {
+        case TRACE_KIND_CALL:
+        {
+            fprintf(file, "%s : %s(", String(Event.SourceId), String(Event.FormatId));
+
+            for(int i = 0; i < Event.ArgCount; i++)
+            {
+                fprintf(file, "\n   %-20s : ", String(pArgs[i].NameId));
+
+                if(Event.StringMask & (1 << i))
+                    fprintf(file, "\"%s\"", pStrings + pArgs[i].Value);
+                else if(Event.FloatMask & (1 << i))
+                    fprintf(file, "%g", Double(pArgs[i].Value));
+                else
+                    fprintf(file, "0x%llX", (unsigned long long)pArgs[i].Value);
+            }
+
+            if(Event.Flags & TRACE_FLAG_TRUNCATED)
+                fprintf(file, "\n   ...");
+
+            fprintf(file, "%s);\n", Event.ArgCount > 0 ? "\n" : "");
+            break;
+        }
+
+        case TRACE_KIND_RESULT:
+        {
+            fprintf(file, "%s : %s returns ", String(Event.SourceId), String(Event.FormatId));
+
+            if(Event.ArgCount == 0)
+                fprintf(file, "?\n");
+            else if(Event.FloatMask & 1)
+                fprintf(file, "%g\n", Double(pArgs[0].Value));
+            else
+                fprintf(file, "0x%llX\n", (unsigned long long)pArgs[0].Value);
+            break;
+        }
+
+        case TRACE_KIND_MESSAGE:
+        {
+            fprintf(file, "%s : %s%s\n", String(Event.SourceId), String(Event.FormatId), String(Event.TextId));
+            break;
+        }
+
+        case TRACE_KIND_PRINTF:
+        {
+            RenderPrintf(file, String(Event.FormatId), Event, pArgs, pStrings);
+            break;
+        }
+
+        default:
+        {
+            fprintf(file, "unknown event kind %u\n", Event.Kind);
+            break;
+        }
+    }
+}
+
+// printf, with the arguments taken from the event instead of the stack
+void TraceDecoder::RenderPrintf(FILE *file, const char *szFormat, const TraceFileEvent &Event, const TraceFileArg *pArgs, const char *pStrings)
+{
+    int Arg = 0;
+    const char *p = szFormat;
+
+    while(*p != 0)
+    {
+        if(*p != '%')
+        {
+            fputc(*p++, file);
+            continue;
+        }
+
+        if(p[1] == '%')
+        {
+            fputc('%', file);
+            p += 2;
+            continue;
+        }
+
+        // copy flags, width and precision, with * replaced by its argument
+        std::string Spec = "%";
+        p++;
+
+        while(*p != 0 && strchr("-+ #0", *p) != NULL)
+            Spec += *p++;
+
+        for(int Part = 0; Part < 2; Part++)
+        {
+            if(Part == 1)
+            {
+                if(*p != '.')
+                    break;
+
+                Spec += *p++;
+            }
+
+            if(*p == '*')
+            {
+                p++;
+                Spec += std::to_string(Arg < Event.ArgCount ? (int)pArgs[Arg++].Value : 0);
+            }
+            else while(*p >= '0' && *p <= '9')
+                Spec += *p++;
+        }
+
+        // length modifiers; only 64 bit integers differ from the rest on the Xbox
+        bool b64 = false;
+
+        if(strncmp(p, "I64", 3) == 0 || strncmp(p, "ll", 2) == 0)
+        {
+            b64 = true;
+            p += (*p == 'I') ? 3 : 2;
+        }
+        else if(strncmp(p, "I32", 3) == 0)
+            p += 3;
+        else while(*p != 0 && strchr("hlLzjtw", *p) != NULL)
+            p++;
+
+        char Conversion = *p;
+        if(Conversion == 0)
+            break;
+
+        p++;
+
+        if(Conversion == 'n')
+            continue;
+
+        if(Arg >= Event.ArgCount)
+        {
+            fputs((Event.Flags & TRACE_FLAG_TRUNCATED) ? "..." : "<missing>", file);
+            continue;
+        }
+
+        uint64_t Value = pArgs[Arg].Value;
+        bool bString = (Event.StringMask & (1 << Arg)) != 0;
+        Arg++;
+
+        switch(Conversion)
+        {
+            case 'd': case 'i':
+                if(b64)
+                    fprintf(file, (Spec + "lld").c_str(), (long long)Value);
+                else
+                    fprintf(file, (Spec + Conversion).c_str(), (int)Value);
+                break;
+
+            case 'o': case 'u': case 'x': case 'X':
+                if(b64)
+                    fprintf(file, (Spec + "ll" + Conversion).c_str(), (unsigned long long)Value);
+                else
+                    fprintf(file, (Spec + Conversion).c_str(), (unsigned int)Value);
+                break;
+
+            case 'c': case 'C':
+                fprintf(file, (Spec + 'c').c_str(), (int)(char)Value);
+                break;
+
+            case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+                fprintf(file, (Spec + Conversion).c_str(), Double(Value));
+                break;
+
+            case 's': case 'S':
+                // strings that didn't fit in the event only have their address
+                if(bString)
+                    fprintf(file, (Spec + 's').c_str(), pStrings + Value);
+                else
+                    fprintf(file, "(string at 0x%08X)", (uint32_t)Value);
+                break;
+
+            case 'p':
+                fprintf(file, "%08X", (uint32_t)Value);
+                break;
+
+            default:
+                fprintf(file, "%s%c", Spec.c_str(), Conversion);
+                break;
+        }
+    }
+}
@@ -0,0 +1,71 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Core->TraceDecoder.h
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef TRACEDECODER_H
+#define TRACEDECODER_H
+
+#include "Common/Error.h"
+#include "Common/TraceRing.h"
+
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// renders a trace file written by TraceRingStart as text, without the traced process
+class TraceDecoder : public Error
+{
+    public:
+        TraceDecoder(const char *szFileName);
+
+        // write every event as a line (or block) of text
+        void Render(FILE *file);
+
+        uint32_t GetEventCount() const { return m_dwEvents; }
+        uint32_t GetDroppedCount() const { return m_dwDropped; }
+
+    private:
+        void RenderEvent(FILE *file, const TraceFileEvent &Event, const TraceFileArg *pArgs, const char *pStrings);
+        void RenderPrintf(FILE *file, const char *szFormat, const TraceFileEvent &Event, const TraceFileArg *pArgs, const char *pStrings);
+
+        const char *String(uint32_t Id);
+
+        std::vector<uint8_t>                      m_Trace;
+        std::unordered_map<uint32_t, std::string> m_Strings;
+        uint64_t                                  m_TicksPerSecond;
+        uint64_t                                  m_FirstTime;
+        uint32_t                                  m_dwEvents;
+        uint32_t                                  m_dwDropped;
+};
+
+#endif
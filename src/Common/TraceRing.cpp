@@ -0,0 +1,269 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Core->TraceRing.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "TraceRing.h"
+
+#include <windows.h> // For GetCurrentThreadId
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// how often the drain thread empties the rings, unless one fills up sooner
+#define TRACE_DRAIN_INTERVAL_MS 10
+
+volatile bool g_bTraceRingOn = false;
+
+// single producer (the owning thread), single consumer (the drain thread)
+struct TraceRing
+{
+    TraceEvent            Events[TRACE_RING_SIZE];
+    std::atomic<uint32_t> Head;         // next event to write, only advanced by the owner
+    std::atomic<uint32_t> Tail;         // next event to read, only advanced by the drain thread
+    std::atomic<uint32_t> Dropped;      // events lost since the last drain
+    uint32_t              ThreadId;
+};
+
+// Rings are never freed; one that belonged to a thread that exited simply stays empty
+static std::mutex              g_TraceRingsLock;
+static std::vector<TraceRing*> g_TraceRings;
+static thread_local TraceRing *t_pTraceRing = nullptr;
+
+// drain state, owned by TraceRingStart/TraceRingStop and the drain thread
+static std::mutex                              g_TraceLock;
+static FILE                                   *g_TraceFile = nullptr;
+static std::thread                             g_TraceDrainThread;
+static std::atomic<bool>                       g_bTraceDraining(false);
+static std::mutex                              g_TraceDrainLock;
+static std::condition_variable                 g_TraceDrainWake;
+static std::unordered_map<const char*, uint32_t> g_TraceStringIds;
+
+uint64_t TraceRingTime()
+{
+    return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+static TraceRing *TraceRingForThread()
+{
+    TraceRing *pRing = new TraceRing();
+
+    pRing->Head = 0;
+    pRing->Tail = 0;
+    pRing->Dropped = 0;
+    pRing->ThreadId = GetCurrentThreadId();
+
+    std::lock_guard<std::mutex> Lock(g_TraceRingsLock);
+    g_TraceRings.push_back(pRing);
+
+    return pRing;
+}
+
+void TraceRingCommit(const TraceEvent &Event)
+{
+    TraceRing *pRing = t_pTraceRing;
+    if(pRing == nullptr)
+        pRing = t_pTraceRing = TraceRingForThread();
+
+    uint32_t Head = pRing->Head.load(std::memory_order_relaxed);
+
+    // never wait for the drain thread, that would change the timing being traced
+    if(Head - pRing->Tail.load(std::memory_order_acquire) >= TRACE_RING_SIZE)
+    {
+        pRing->Dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    pRing->Events[Head & (TRACE_RING_SIZE - 1)] = Event;
+    pRing->Head.store(Head + 1, std::memory_order_release);
+
+    // wake the drain thread early when the ring is half full
+    if(Head - pRing->Tail.load(std::memory_order_relaxed) == TRACE_RING_SIZE / 2)
+        g_TraceDrainWake.notify_one();
+}
+
+static void TraceWriteRecord(uint32_t Type, const void *pData1, uint32_t Size1, const void *pData2 = nullptr, uint32_t Size2 = 0)
+{
+    TraceFileRecord Record = { Type, Size1 + Size2 };
+
+    fwrite(&Record, sizeof(Record), 1, g_TraceFile);
+    fwrite(pData1, Size1, 1, g_TraceFile);
+    if(Size2 > 0)
+        fwrite(pData2, Size2, 1, g_TraceFile);
+}
+
+// strings are written once, the first time an event refers to them
+static uint32_t TraceStringId(const char *szString)
+{
+    if(szString == nullptr)
+        return 0;
+
+    auto it = g_TraceStringIds.find(szString);
+    if(it != g_TraceStringIds.end())
+        return it->second;
+
+    uint32_t Id = (uint32_t)g_TraceStringIds.size() + 1;
+    g_TraceStringIds[szString] = Id;
+
+    TraceWriteRecord(TRACE_RECORD_STRING, &Id, sizeof(Id), szString, (uint32_t)strlen(szString));
+
+    return Id;
+}
+
+static void TraceWriteEvent(const TraceEvent &Event, uint32_t ThreadId)
+{
+    TraceFileEvent FileEvent;
+    TraceFileArg   FileArgs[TRACE_MAX_ARGS];
+
+    FileEvent.Time = Event.Time;
+    FileEvent.ThreadId = ThreadId;
+    FileEvent.SourceId = TraceStringId(Event.szSource);
+    FileEvent.FormatId = TraceStringId(Event.szFormat);
+    FileEvent.TextId = TraceStringId(Event.szText);
+    FileEvent.Kind = Event.Kind;
+    FileEvent.Flags = Event.Flags;
+    FileEvent.ArgCount = Event.ArgCount;
+    FileEvent.StringsUsed = Event.StringsUsed;
+    FileEvent.StringMask = Event.StringMask;
+    FileEvent.FloatMask = Event.FloatMask;
+
+    for(int i = 0; i < Event.ArgCount; i++)
+    {
+        FileArgs[i].NameId = TraceStringId(Event.szNames[i]);
+        FileArgs[i].Reserved = 0;
+        FileArgs[i].Value = Event.Values[i];
+    }
+
+    uint32_t ArgsSize = Event.ArgCount * sizeof(TraceFileArg);
+    TraceFileRecord Record = { TRACE_RECORD_EVENT, (uint32_t)(sizeof(FileEvent) + ArgsSize + Event.StringsUsed) };
+
+    fwrite(&Record, sizeof(Record), 1, g_TraceFile);
+    fwrite(&FileEvent, sizeof(FileEvent), 1, g_TraceFile);
+    fwrite(FileArgs, ArgsSize, 1, g_TraceFile);
+    fwrite(Event.Strings, Event.StringsUsed, 1, g_TraceFile);
+}
+
+static void TraceDrain()
+{
+    std::vector<TraceRing*> Rings;
+    {
+        std::lock_guard<std::mutex> Lock(g_TraceRingsLock);
+        Rings = g_TraceRings;
+    }
+
+    for(TraceRing *pRing : Rings)
+    {
+        uint32_t Tail = pRing->Tail.load(std::memory_order_relaxed);
+        uint32_t Head = pRing->Head.load(std::memory_order_acquire);
+
+        for(; Tail != Head; Tail++)
+            TraceWriteEvent(pRing->Events[Tail & (TRACE_RING_SIZE - 1)], pRing->ThreadId);
+
+        pRing->Tail.store(Tail, std::memory_order_release);
+
+        uint32_t Dropped = pRing->Dropped.exchange(0, std::memory_order_relaxed);
+        if(Dropped > 0)
+        {
+            uint32_t Data[2] = { pRing->ThreadId, Dropped };
+            TraceWriteRecord(TRACE_RECORD_DROPPED, Data, sizeof(Data));
+        }
+    }
+}
+
+static void TraceDrainThread()
+{
+    while(g_bTraceDraining)
+    {
+        TraceDrain();
+
+        std::unique_lock<std::mutex> Lock(g_TraceDrainLock);
+        g_TraceDrainWake.wait_for(Lock, std::chrono::milliseconds(TRACE_DRAIN_INTERVAL_MS));
+    }
+}
+
+bool TraceRingStart(const char *szFileName)
+{
+    TraceRingStop();
+
+    std::lock_guard<std::mutex> Lock(g_TraceLock);
+
+    g_TraceFile = fopen(szFileName, "wb");
+    if(g_TraceFile == nullptr)
+        return false;
+
+    TraceFileHeader Header;
+    Header.Magic = TRACE_FILE_MAGIC;
+    Header.Version = TRACE_FILE_VERSION;
+    Header.TicksPerSecond = (uint64_t)std::chrono::steady_clock::period::den / std::chrono::steady_clock::period::num;
+    fwrite(&Header, sizeof(Header), 1, g_TraceFile);
+
+    // skip whatever was left behind by an earlier trace
+    {
+        std::lock_guard<std::mutex> RingsLock(g_TraceRingsLock);
+        for(TraceRing *pRing : g_TraceRings)
+        {
+            pRing->Tail.store(pRing->Head.load(std::memory_order_acquire), std::memory_order_release);
+            pRing->Dropped = 0;
+        }
+    }
+
+    g_TraceStringIds.clear();
+    g_bTraceDraining = true;
+    g_TraceDrainThread = std::thread(TraceDrainThread);
+    g_bTraceRingOn = true;
+
+    return true;
+}
+
+void TraceRingStop()
+{
+    std::lock_guard<std::mutex> Lock(g_TraceLock);
+
+    if(g_TraceFile == nullptr)
+        return;
+
+    g_bTraceRingOn = false;
+    g_bTraceDraining = false;
+    g_TraceDrainThread.join();
+
+    // events committed after the drain thread's last pass
+    TraceDrain();
+
+    fclose(g_TraceFile);
+    g_TraceFile = nullptr;
+}
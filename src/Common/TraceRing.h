@@ -0,0 +1,289 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Core->TraceRing.h
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef TRACERING_H
+#define TRACERING_H
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Binary tracing : instead of formatting log messages when they happen, the
+// logging macros record a format id plus the raw argument values into a ring
+// owned by the calling thread. A drain thread writes the rings to a file, which
+// TraceDecoder renders as text afterwards.
+
+#define TRACE_RING_SIZE     2048        // events per thread, must be a power of two
+#define TRACE_MAX_ARGS      12
+#define TRACE_STRING_SPACE  96          // per event, for copies of string arguments
+
+typedef enum _TRACE_KIND
+{
+    TRACE_KIND_CALL = 1,                // LOG_FUNC_BEGIN .. LOG_FUNC_END
+    TRACE_KIND_RESULT,                  // LOG_FUNC_RESULT
+    TRACE_KIND_MESSAGE,                 // LOG_FORWARD, LOG_IGNORED and the like
+    TRACE_KIND_PRINTF                   // DbgPrintf
+}
+TRACE_KIND;
+
+#define TRACE_FLAG_TRUNCATED 0x01       // more than TRACE_MAX_ARGS arguments
+
+// Pointers are only valid in the traced process; the drain thread replaces
+// them with string ids when writing the event to file.
+struct TraceEvent
+{
+    uint64_t    Time;
+    const char *szSource;               // file name
+    const char *szFormat;               // function name, or printf format
+    const char *szText;                 // message text (TRACE_KIND_MESSAGE)
+    uint8_t     Kind;
+    uint8_t     Flags;
+    uint8_t     ArgCount;
+    uint8_t     StringsUsed;
+    uint16_t    StringMask;             // arguments that are offsets into Strings
+    uint16_t    FloatMask;              // arguments that are doubles
+    const char *szNames[TRACE_MAX_ARGS];
+    uint64_t    Values[TRACE_MAX_ARGS];
+    char        Strings[TRACE_STRING_SPACE];
+};
+
+// set while a trace file is being written
+extern volatile bool g_bTraceRingOn;
+
+// start writing all events to a file (stops a running trace first)
+bool TraceRingStart(const char *szFileName);
+
+// write the remaining events and close the file
+void TraceRingStop();
+
+// copy an event into the ring of the calling thread (dropped when full)
+void TraceRingCommit(const TraceEvent &Event);
+
+uint64_t TraceRingTime();
+
+// raw argument values, as far as they fit in 64 bits
+template<class T>
+inline uint64_t TraceValue(T Value, typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type* = 0)
+{
+    return (uint64_t)(int64_t)Value;
+}
+
+template<class T>
+inline uint64_t TraceValue(T Value, typename std::enable_if<std::is_floating_point<T>::value>::type* = 0)
+{
+    // floats are recorded as double, like printf receives them
+    double d = Value;
+    uint64_t Result;
+    memcpy(&Result, &d, sizeof(Result));
+    return Result;
+}
+
+template<class T>
+inline uint64_t TraceValue(T Value, typename std::enable_if<std::is_pointer<T>::value>::type* = 0)
+{
+    return (uint64_t)(uintptr_t)Value;
+}
+
+template<class T>
+inline uint64_t TraceValue(const T &Value, typename std::enable_if<std::is_class<T>::value || std::is_union<T>::value>::type* = 0)
+{
+    uint64_t Result = 0;
+    memcpy(&Result, &Value, sizeof(T) < sizeof(Result) ? sizeof(T) : sizeof(Result));
+    return Result;
+}
+
+template<class T, size_t N>
+inline uint64_t TraceValue(const T (&Value)[N])
+{
+    return (uint64_t)(uintptr_t)Value;
+}
+
+// builds one event on the stack, committed when going out of scope
+class TraceRecord
+{
+    public:
+        TraceRecord(TRACE_KIND Kind, const char *szSource, const char *szFormat, const char *szText = nullptr)
+            : m_bActive(g_bTraceRingOn)
+        {
+            if(!m_bActive)
+                return;
+
+            m_Event.Time = TraceRingTime();
+            m_Event.szSource = szSource;
+            m_Event.szFormat = szFormat;
+            m_Event.szText = szText;
+            m_Event.Kind = (uint8_t)Kind;
+            m_Event.Flags = 0;
+            m_Event.ArgCount = 0;
+            m_Event.StringsUsed = 0;
+            m_Event.StringMask = 0;
+            m_Event.FloatMask = 0;
+        }
+
+       ~TraceRecord()
+        {
+            if(m_bActive)
+                TraceRingCommit(m_Event);
+        }
+
+        explicit operator bool() const { return m_bActive; }
+
+        template<class T>
+        void Arg(const char *szName, const T &Value)
+        {
+            if(Slot())
+            {
+                if(std::is_floating_point<T>::value)
+                    m_Event.FloatMask |= 1 << m_Event.ArgCount;
+
+                Add(szName, TraceValue(Value));
+            }
+        }
+
+        // strings are copied, as far as they fit
+        void Arg(const char *szName, const char *szValue) { if(Slot()) AddString(szName, szValue); }
+        void Arg(const char *szName, char *szValue) { if(Slot()) AddString(szName, szValue); }
+        void Arg(const char *szName, const wchar_t *wszValue) { if(Slot()) AddString(szName, wszValue); }
+        void Arg(const char *szName, wchar_t *wszValue) { if(Slot()) AddString(szName, wszValue); }
+
+        // all arguments of a printf style call
+        void Args() { }
+
+        template<class T, class... Rest>
+        void Args(const T &Value, const Rest&... Others)
+        {
+            Arg(nullptr, Value);
+            Args(Others...);
+        }
+
+    private:
+        bool Slot()
+        {
+            // nothing of the event is set up when the trace wasn't running
+            if(!m_bActive)
+                return false;
+
+            if(m_Event.ArgCount < TRACE_MAX_ARGS)
+                return true;
+
+            m_Event.Flags |= TRACE_FLAG_TRUNCATED;
+            return false;
+        }
+
+        void Add(const char *szName, uint64_t Value)
+        {
+            m_Event.szNames[m_Event.ArgCount] = szName;
+            m_Event.Values[m_Event.ArgCount++] = Value;
+        }
+
+        template<class C>
+        void AddString(const char *szName, const C *szValue)
+        {
+            // pointers are kept when there's no room left (or nothing to copy)
+            if(szValue == nullptr || m_Event.StringsUsed >= TRACE_STRING_SPACE)
+            {
+                Add(szName, (uint64_t)(uintptr_t)szValue);
+                return;
+            }
+
+            uint8_t Offset = m_Event.StringsUsed;
+            uint8_t i = Offset;
+            while(i < TRACE_STRING_SPACE - 1 && *szValue != 0)
+                m_Event.Strings[i++] = (char)*szValue++; // wide strings are narrowed
+
+            m_Event.Strings[i++] = 0;
+            m_Event.StringsUsed = i;
+            m_Event.StringMask |= 1 << m_Event.ArgCount;
+            Add(szName, Offset);
+        }
+
+        bool       m_bActive;
+        TraceEvent m_Event;
+};
+
+template<class... Args>
+inline void TraceRingPrintf(const char *szFormat, const Args&... Values)
+{
+    TraceRecord Record(TRACE_KIND_PRINTF, nullptr, szFormat);
+    Record.Args(Values...);
+}
+
+// trace files : a header followed by records, all little endian
+#define TRACE_FILE_MAGIC    0x52545843  // "CXTR"
+#define TRACE_FILE_VERSION  1
+
+typedef enum _TRACE_RECORD_TYPE
+{
+    TRACE_RECORD_STRING  = 1,           // Id, followed by the characters
+    TRACE_RECORD_EVENT   = 2,           // TraceFileEvent, arguments, then string space
+    TRACE_RECORD_DROPPED = 3            // ThreadId, Count : events lost because a ring was full
+}
+TRACE_RECORD_TYPE;
+
+struct TraceFileHeader
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint64_t TicksPerSecond;
+};
+
+struct TraceFileRecord
+{
+    uint32_t Type;
+    uint32_t Size;                      // of the data following this header
+};
+
+// an event as written to file, followed by ArgCount TraceFileArg's and StringsUsed characters
+struct TraceFileEvent
+{
+    uint64_t Time;
+    uint32_t ThreadId;
+    uint32_t SourceId;                  // string ids, 0 for none
+    uint32_t FormatId;
+    uint32_t TextId;
+    uint8_t  Kind;
+    uint8_t  Flags;
+    uint8_t  ArgCount;
+    uint8_t  StringsUsed;
+    uint16_t StringMask;
+    uint16_t FloatMask;
+};
+
+struct TraceFileArg
+{
+    uint32_t NameId;
+    uint32_t Reserved;
+    uint64_t Value;
+};
+
+#endif
@@ -35,6 +35,74 @@
 // ******************************************************************
 #include "Mutex.h"
 
+// spin iterations before parking, adapted between these bounds per mutex
+#define MUTEX_SPIN_MIN          8
+#define MUTEX_SPIN_MAX          200
+
+// parked threads recheck the lock this often, since unlocks from other
+// processes (EmuShared) can't wake them
+#define MUTEX_PARK_TIMEOUT_MS   1
+
+// WaitOnAddress and WakeByAddressSingle are only available since Windows 8
+typedef BOOL (WINAPI *WaitOnAddress_t)(volatile VOID *Address, PVOID CompareAddress, SIZE_T AddressSize, DWORD dwMilliseconds);
+typedef VOID (WINAPI *WakeByAddressSingle_t)(PVOID Address);
+
+static WaitOnAddress_t       g_pWaitOnAddress       = NULL;
+static WakeByAddressSingle_t g_pWakeByAddressSingle = NULL;
+static DWORD                 g_dwProcessors         = 1;
+static LONGLONG              g_TicksPerSecond       = 1;
+static volatile LONG         g_bMutexInitialized    = 0;
+
+// ******************************************************************
+// * MutexInitialize (done lazily, mutexes are constructed statically)
+// ******************************************************************
+static void MutexInitialize()
+{
+    if (g_bMutexInitialized)
+        return;
+
+    HMODULE hKernelBase = GetModuleHandleA("kernelbase.dll");
+    if (hKernelBase != NULL)
+    {
+        g_pWakeByAddressSingle = (WakeByAddressSingle_t)GetProcAddress(hKernelBase, "WakeByAddressSingle");
+        g_pWaitOnAddress = (WaitOnAddress_t)GetProcAddress(hKernelBase, "WaitOnAddress");
+    }
+
+    SYSTEM_INFO SystemInfo;
+    GetSystemInfo(&SystemInfo);
+    g_dwProcessors = SystemInfo.dwNumberOfProcessors;
+
+    LARGE_INTEGER Frequency;
+    QueryPerformanceFrequency(&Frequency);
+    g_TicksPerSecond = Frequency.QuadPart;
+
+    InterlockedExchange(&g_bMutexInitialized, 1);
+}
+
+// ******************************************************************
+// * MutexPark - Sleep while the lock is still marked as parked on
+// ******************************************************************
+static void MutexPark(volatile LONG *pMutexLock)
+{
+    LONG Parked = 2;
+
+    if (g_pWaitOnAddress != NULL)
+        g_pWaitOnAddress(pMutexLock, &Parked, sizeof(LONG), MUTEX_PARK_TIMEOUT_MS);
+    else
+        Sleep(MUTEX_PARK_TIMEOUT_MS);
+}
+
+// ******************************************************************
+// * MutexWake - Wake one thread parked on the lock
+// ******************************************************************
+static void MutexWake(volatile LONG *pMutexLock)
+{
+    MutexInitialize();
+
+    if (g_pWakeByAddressSingle != NULL)
+        g_pWakeByAddressSingle((PVOID)pMutexLock);
+}
+
 // ******************************************************************
 // * Constructor
 // ******************************************************************
@@ -43,7 +111,10 @@ Mutex::Mutex()
     InterlockedExchange(&m_MutexLock, 0);
     InterlockedExchange(&m_OwnerProcess, 0);
     InterlockedExchange(&m_OwnerThread, 0);
-    InterlockedExchange(&m_LockCount, 0);
+    m_LockCount = 0;
+    m_SpinLimit = MUTEX_SPIN_MIN;
+
+    ResetStatistics();
 }
 
 // ******************************************************************
@@ -53,52 +124,94 @@ void Mutex::Lock()
 {
     LONG _CurrentProcessId = (LONG) GetCurrentProcessId();
     LONG _CurrentThreadId = (LONG) GetCurrentThreadId();
-    while(true)
+
+    // The mutex was already locked, but by us.  Only this thread can
+    // have stored its own id, so the reading need not be interlocked.
+    if ((m_OwnerThread  == _CurrentThreadId) &&
+        (m_OwnerProcess == _CurrentProcessId))
     {
-        // Grab the lock, letting us look at the variables
-#if (_MSC_VER < 1300)  // We are not using VC++.NET
-        while(InterlockedCompareExchange((LPVOID*)&m_MutexLock, (LPVOID)1, (LPVOID)0))
-#else
-        while(InterlockedCompareExchange((LPLONG)&m_MutexLock, (LONG)1, (LONG)0))
+        m_LockCount++;
+#ifdef _DEBUG_MUTEX
+        m_Acquires++;
 #endif
-            Sleep(1);
+        return;
+    }
 
-        // Are we the the new owner?
-        if (!m_OwnerProcess)
-        {
-            // Take ownership
-            InterlockedExchange(&m_OwnerProcess, _CurrentProcessId);
-            InterlockedExchange(&m_OwnerThread, _CurrentThreadId);
-            InterlockedExchange(&m_LockCount, 1);
+    // Grab the lock, only spinning or parking when it's taken
+    if (InterlockedCompareExchange(&m_MutexLock, 1, 0) != 0)
+        LockContended();
 
-            // Unlock the mutex itself
-            InterlockedExchange(&m_MutexLock, 0);
+    // Take ownership
+    m_OwnerProcess = _CurrentProcessId;
+    m_OwnerThread = _CurrentThreadId;
+    m_LockCount = 1;
+#ifdef _DEBUG_MUTEX
+    m_Acquires++;
+#endif
+}
 
-            return;
-        }
+// ******************************************************************
+// * LockContended - Spin, then park until the lock is ours
+// ******************************************************************
+void Mutex::LockContended()
+{
+    MutexInitialize();
+
+#ifdef _DEBUG_MUTEX
+    LARGE_INTEGER Start;
+    QueryPerformanceCounter(&Start);
+#endif
+
+    // Spin up to twice as long as recent acquisitions needed, since the
+    // owner will often be done in less time than it takes to park (there's
+    // no point spinning on a single processor though)
+    LONG Limit = 0;
+    if (g_dwProcessors > 1)
+    {
+        Limit = m_SpinLimit * 2 + MUTEX_SPIN_MIN;
+        if (Limit > MUTEX_SPIN_MAX)
+            Limit = MUTEX_SPIN_MAX;
+    }
+
+    LONG Spins = 0;
+    LONG Parks = 0;
+    bool bAcquired = false;
+    while (Spins < Limit)
+    {
+        Spins++;
+        YieldProcessor();
 
-        // If a different process owns this mutex right now, unlock
-        // the mutex lock and wait.  The reading need not be
-        // interlocked.
-        if ((m_OwnerProcess != _CurrentProcessId) ||
-            (m_OwnerThread  != _CurrentThreadId))
+        if ((m_MutexLock == 0) && (InterlockedCompareExchange(&m_MutexLock, 1, 0) == 0))
         {
-            // Unlock the mutex itself
-            InterlockedExchange(&m_MutexLock, 0);
+            bAcquired = true;
+            break;
+        }
+    }
 
-            // Wait and try again
-			// TODO : Improve performance replacing Sleep(1) with YieldProcessor and perhaps an optional SpinLock
-            Sleep(1);
-            continue;
+    // Park until the lock is free.  It's marked as parked on meanwhile, so
+    // the owner wakes us when unlocking, and keeps that mark once we own
+    // it, as other threads may still be parked.
+    if (!bAcquired)
+    {
+        while (InterlockedExchange(&m_MutexLock, 2) != 0)
+        {
+            MutexPark(&m_MutexLock);
+            Parks++;
         }
+    }
 
-        // The mutex was already locked, but by us.  Just increment
-        // the lock count and unlock the mutex itself.
-        InterlockedIncrement(&m_LockCount);
-        InterlockedExchange(&m_MutexLock, 0);
+    // We own the lock now, so the remaining fields are ours to update
+    m_SpinLimit += (Spins - m_SpinLimit) / 8;
 
-        return;
-    }
+#ifdef _DEBUG_MUTEX
+    LARGE_INTEGER End;
+    QueryPerformanceCounter(&End);
+
+    m_Contended++;
+    m_Spins += Spins;
+    m_Parks += Parks;
+    m_WaitTicks += End.QuadPart - Start.QuadPart;
+#endif
 }
 
 // ******************************************************************
@@ -106,22 +219,54 @@ void Mutex::Lock()
 // ******************************************************************
 void Mutex::Unlock()
 {
-    // Grab the lock, letting us look at the variables
-#if (_MSC_VER < 1300)  // We are not using VC++.NET
-    while(InterlockedCompareExchange((LPVOID*)&m_MutexLock, (LPVOID)1, (LPVOID)0))
+    // Decrement the lock count
+    if (--m_LockCount > 0)
+        return;
+
+    // Mark the mutex as now unused
+    m_OwnerThread = 0;
+    m_OwnerProcess = 0;
+
+    // Unlock the mutex itself, waking a parked thread if there may be one
+    if (InterlockedExchange(&m_MutexLock, 0) == 2)
+        MutexWake(&m_MutexLock);
+}
+
+// ******************************************************************
+// * GetStatistics
+// ******************************************************************
+void Mutex::GetStatistics(MutexStatistics *pStatistics)
+{
+    MutexInitialize();
+
+    Lock();
+
+#ifdef _DEBUG_MUTEX
+    pStatistics->Acquires = m_Acquires - 1; // without the Lock above
 #else
-    while (InterlockedCompareExchange((LPLONG)&m_MutexLock, (LONG)1, (LONG)0))
+    pStatistics->Acquires = m_Acquires;
 #endif
-        Sleep(1);
+    pStatistics->Contended = m_Contended;
+    pStatistics->Spins = m_Spins;
+    pStatistics->Parks = m_Parks;
+    pStatistics->WaitMicroseconds = (ULONGLONG)((m_WaitTicks / g_TicksPerSecond) * 1000000 +
+                                                (m_WaitTicks % g_TicksPerSecond) * 1000000 / g_TicksPerSecond);
 
-    // Decrement the lock count
-    if (!InterlockedDecrement(&m_LockCount))
-    {
-        // Mark the mutex as now unused
-        InterlockedExchange(&m_OwnerProcess, 0);
-        InterlockedExchange(&m_OwnerThread, 0);
-    }
+    Unlock();
+}
 
-    // Unlock the mutex itself
-    InterlockedExchange(&m_MutexLock, 0);
-}
\ No newline at end of file
+// ******************************************************************
+// * ResetStatistics
+// ******************************************************************
+void Mutex::ResetStatistics()
+{
+    Lock();
+
+    m_Acquires = 0;
+    m_Contended = 0;
+    m_Spins = 0;
+    m_Parks = 0;
+    m_WaitTicks = 0;
+
+    Unlock();
+}
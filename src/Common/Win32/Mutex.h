@@ -36,7 +36,27 @@
 
 #include <windows.h>
 
-// mutex object (intended to be inherited from)
+// define this to count lock contention (see Mutex::GetStatistics)
+#ifdef _DEBUG
+#define _DEBUG_MUTEX
+#endif
+
+// contention counters, only maintained when _DEBUG_MUTEX is defined
+struct MutexStatistics
+{
+    ULONGLONG Acquires;         // all (recursive) acquisitions
+    ULONGLONG Contended;        // acquisitions that found the lock taken
+    ULONGLONG Spins;            // pause iterations spent spinning
+    ULONGLONG Parks;            // times a thread went to sleep on the lock
+    ULONGLONG WaitMicroseconds; // time spent in contended acquisitions
+};
+
+// recursive mutex object (intended to be inherited from)
+//
+// Contended threads spin briefly, then park until the owner unlocks. The
+// object may live in memory shared between processes : parked threads are
+// woken directly by unlocks from their own process, and poll for unlocks
+// from other processes.
 class Mutex
 {
     public:
@@ -45,11 +65,24 @@ class Mutex
         void Lock();
         void Unlock();
 
+        void GetStatistics(MutexStatistics *pStatistics);
+        void ResetStatistics();
+
     private:
-        LONG m_MutexLock;      // Mutex lock
-        LONG m_OwnerProcess;   // Current owner process (or zero)
-        LONG m_OwnerThread;    // Current owner thread
-        LONG m_LockCount;      // Lock count within this thread
+        void LockContended();
+
+        volatile LONG m_MutexLock;      // 0 : free, 1 : locked, 2 : locked with parked threads
+        volatile LONG m_OwnerProcess;   // Current owner process (or zero)
+        volatile LONG m_OwnerThread;    // Current owner thread
+        LONG          m_LockCount;      // Lock count within this thread
+        LONG          m_SpinLimit;      // Average spins that were needed, adapts the next spin
+
+        // only updated by the owner
+        ULONGLONG     m_Acquires;
+        ULONGLONG     m_Contended;
+        ULONGLONG     m_Spins;
+        ULONGLONG     m_Parks;
+        LONGLONG      m_WaitTicks;
 };
 
 #endif
@@ -40,7 +40,7 @@
 // ******************************************************************
 // * func: XBVideo::XBVideo
 // ******************************************************************
-XBVideo::XBVideo() : m_bVSync(false), m_bFullscreen(false), m_bHardwareYUV(false)
+XBVideo::XBVideo() : m_bVSync(false), m_bFullscreen(false), m_bHardwareYUV(false), m_dwTextureCacheSize(256)
 {
     strcpy(m_szVideoResolution, "Automatic (Default)");
 }
@@ -84,6 +84,9 @@ void XBVideo::Load(const char *szRegistryKey)
             dwType = REG_DWORD; dwSize = sizeof(m_bHardwareYUV);
             RegQueryValueEx(hKey, "HardwareYUV", NULL, &dwType, (PBYTE)&m_bHardwareYUV, &dwSize);
 
+            dwType = REG_DWORD; dwSize = sizeof(m_dwTextureCacheSize);
+            RegQueryValueEx(hKey, "TextureCacheSize", NULL, &dwType, (PBYTE)&m_dwTextureCacheSize, &dwSize);
+
             RegCloseKey(hKey);
         }
     }
@@ -121,6 +124,9 @@ void XBVideo::Save(const char *szRegistryKey)
             dwType = REG_DWORD; dwSize = sizeof(m_bHardwareYUV);
             RegSetValueEx(hKey, "HardwareYUV", 0, dwType, (PBYTE)&m_bHardwareYUV, dwSize);
 
+            dwType = REG_DWORD; dwSize = sizeof(m_dwTextureCacheSize);
+            RegSetValueEx(hKey, "TextureCacheSize", 0, dwType, (PBYTE)&m_dwTextureCacheSize, dwSize);
+
             RegCloseKey(hKey);
         }
     }
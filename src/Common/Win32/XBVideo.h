@@ -92,6 +92,12 @@ class XBVideo : public Error
 		void SetHardwareYUV(BOOL bHardwareYUV) { m_bHardwareYUV = bHardwareYUV; }
 		BOOL GetHardwareYUV() const { return m_bHardwareYUV; }
 
+		// ******************************************************************
+		// * Texture Cache Size (in MB, zero for unlimited)
+		// ******************************************************************
+		void SetTextureCacheSize(DWORD dwTextureCacheSize) { m_dwTextureCacheSize = dwTextureCacheSize; }
+		DWORD GetTextureCacheSize() const { return m_dwTextureCacheSize; }
+
     private:
         // ******************************************************************
         // * Configuration
@@ -102,6 +108,7 @@ class XBVideo : public Error
         BOOL  m_bVSync;
         BOOL  m_bFullscreen;
         BOOL  m_bHardwareYUV;
+        DWORD m_dwTextureCacheSize;
 };
 
 #endif
@@ -3,6 +3,9 @@
 #define _CXBXKRNL_INTERNAL
 #define _XBOXKRNL_DEFEXTRN_
 
+#include <stdlib.h>
+#include <string.h>
+
 // prevent name collisions
 namespace xboxkrnl
 {
@@ -10,76 +13,271 @@ namespace xboxkrnl
 
 #include "buffered_io.h"
 
-PBYTE GetSectorBuffered(
+#ifndef MIN
+#define	MIN(a,b) (((a)<(b))?(a):(b))
+#endif
+
+static int FindBufferedBlock(
 		PCDIO_READ This,
-		DWORD SectorNumber)
+		DWORD Block)
 {
-	int		i, index;
-	PBYTE	Ptr;
+	int		Slot;
 
-	// Have we got this baby in buffer ?
+	for(Slot = This->BlockHash[Block & (BLOCK_HASH_SIZE - 1)];Slot != NO_SLOT;Slot = This->NextList[Slot])
+	{
+		if (This->BlockList[Slot] == Block)
+			return Slot;
+	}
+
+	return NO_SLOT;
+}
+//------------------------------------------------------------------------------
+static void LinkBufferedBlock(
+		PCDIO_READ This,
+		int Slot,
+		DWORD Block)
+{
+	SHORT	*Bucket = &This->BlockHash[Block & (BLOCK_HASH_SIZE - 1)];
+
+	This->BlockList[Slot] = Block;
+	This->UseList[Slot] = ++This->UseCounter;
+	This->NextList[Slot] = *Bucket;
+	*Bucket = (SHORT)Slot;
+}
+//------------------------------------------------------------------------------
+// Take the least recently used slot which isn't locked, and free it
+static int ClaimBufferSlot(
+		PCDIO_READ This)
+{
+	int		i, Slot;
+	SHORT	*Link;
+
+	Slot = NO_SLOT;
 	for(i = 0;i < DISK_BUFFER;i++)
 	{
-		if (This->SectorList[i] == SectorNumber)
+		if ((This->LockList[i] == 0) &&
+			((Slot == NO_SLOT) || (This->UseList[i] < This->UseList[Slot])))
+			Slot = i;
+	}
+
+	// We land here if all entries were locked, and that's BAD !
+	if (Slot == NO_SLOT)
+		return NO_SLOT;
+
+	if (This->BlockList[Slot] != NO_BLOCK)
+	{
+		// Unlink the slot from its hash bucket
+		Link = &This->BlockHash[This->BlockList[Slot] & (BLOCK_HASH_SIZE - 1)];
+		while (*Link != Slot)
+			Link = &This->NextList[*Link];
+
+		*Link = This->NextList[Slot];
+		This->BlockList[Slot] = NO_BLOCK;
+	}
+
+	return Slot;
+}
+//------------------------------------------------------------------------------
+// Read a block from disk, together with the blocks following it when the disk
+// is being read sequentially
+static int LoadBufferedBlock(
+		PCDIO_READ This,
+		DWORD Block)
+{
+	DWORD	Count, i;
+	int		Slot, FirstSlot;
+
+	// Double the read-ahead window on each sequential miss, shrink it otherwise
+	if (Block == This->LastBlock + 1)
+		This->ReadAhead = MIN(This->ReadAhead * 2, MAX_READ_AHEAD);
+	else
+		This->ReadAhead = 1;
+
+	// Don't read ahead into blocks that are already buffered
+	for(Count = 1;Count < This->ReadAhead;Count++)
+	{
+		if (FindBufferedBlock(This, Block + Count) != NO_SLOT)
+			break;
+	}
+
+	if (Count == 1)
+	{
+		FirstSlot = ClaimBufferSlot(This);
+		if (FirstSlot == NO_SLOT)
+			return NO_SLOT;
+
+		// Read the block straight into its slot
+		if (!This->Sectors(This->Data, &This->DiskBuffer[FirstSlot * BLOCK_SIZE], Block * BLOCK_SECTORS, BLOCK_SECTORS))
+			return NO_SLOT;
+
+		LinkBufferedBlock(This, FirstSlot, Block);
+	}
+	else
+	{
+		// Read all blocks with one transfer, and spread them over the buffer
+		if (!This->Sectors(This->Data, This->ReadAheadBuffer, Block * BLOCK_SECTORS, Count * BLOCK_SECTORS))
+			return NO_SLOT;
+
+		FirstSlot = ClaimBufferSlot(This);
+		if (FirstSlot == NO_SLOT)
+			return NO_SLOT;
+
+		memcpy(&This->DiskBuffer[FirstSlot * BLOCK_SIZE], This->ReadAheadBuffer, BLOCK_SIZE);
+		LinkBufferedBlock(This, FirstSlot, Block);
+
+		// Keep the requested block from being replaced by the blocks read ahead
+		This->LockList[FirstSlot]++;
+		for(i = 1;i < Count;i++)
 		{
-			This->LockList[i]++;
-			return(&This->DiskBuffer[i * SECTOR_SIZE]);
+			Slot = ClaimBufferSlot(This);
+			if (Slot == NO_SLOT)
+				break;
+
+			memcpy(&This->DiskBuffer[Slot * BLOCK_SIZE], &This->ReadAheadBuffer[i * BLOCK_SIZE], BLOCK_SIZE);
+			LinkBufferedBlock(This, Slot, Block + i);
 		}
+
+		This->LockList[FirstSlot]--;
 	}
 
-	// Nope, load the sector and store it in buffer
-	for(i = 0;i < DISK_BUFFER;i++)
+	This->LastBlock = Block + Count - 1;
+	return FirstSlot;
+}
+//------------------------------------------------------------------------------
+static int GetBufferedBlock(
+		PCDIO_READ This,
+		DWORD Block)
+{
+	int		Slot;
+
+	// Have we got this baby in buffer ?
+	Slot = FindBufferedBlock(This, Block);
+	if (Slot == NO_SLOT)
+		// Nope, load the block and store it in buffer
+		return LoadBufferedBlock(This, Block);
+
+	This->UseList[Slot] = ++This->UseCounter;
+	return Slot;
+}
+//------------------------------------------------------------------------------
+BOOL InitBufferedIO(
+		PCDIO_READ This)
+{
+	if (This->DiskBuffer == NULL)
 	{
-		if (This->LockList[This->WriteIndex] == 0)
+		This->DiskBuffer = (PBYTE)malloc(BLOCK_SIZE * DISK_BUFFER);
+		This->ReadAheadBuffer = (PBYTE)malloc(BLOCK_SIZE * MAX_READ_AHEAD);
+		if ((This->DiskBuffer == NULL) || (This->ReadAheadBuffer == NULL))
 		{
-			// Take an entry into the ring buffer but do not
-			// write the sector number yet (this is needed
-			// for re-entrancy purposes
-			Ptr = &This->DiskBuffer[This->WriteIndex * SECTOR_SIZE];
-
-			This->LockList[This->WriteIndex]++;
-			This->SectorList[This->WriteIndex] = 0;
-
-			index = This->WriteIndex;
-			This->WriteIndex++;
-			This->WriteIndex %= DISK_BUFFER;
-
-			if (This->Sectors(This->Data, Ptr, SectorNumber, 1))
-			{
-				// OK, write the sector number and exit
-				This->SectorList[index] = SectorNumber;
-				return(Ptr);
-			}
-
-			// If something went bad free the slot
-			This->SectorList[index] = 0;
-			This->LockList[index]--;
-			return NULL;
+			FreeBufferedIO(This);
+			return FALSE;
 		}
+	}
+
+	ResetBufferedIO(This);
+	return TRUE;
+}
+//------------------------------------------------------------------------------
+void ResetBufferedIO(
+		PCDIO_READ This)
+{
+	int		i;
 
-		This->WriteIndex++;
-		This->WriteIndex %= DISK_BUFFER;
+	for(i = 0;i < DISK_BUFFER;i++)
+	{
+		This->BlockList[i] = NO_BLOCK;
+		This->LockList[i] = 0;
+		This->UseList[i] = 0;
+		This->NextList[i] = NO_SLOT;
 	}
 
-	// We land here if all entries were locked, and that's BAD !
-	return NULL;
+	for(i = 0;i < BLOCK_HASH_SIZE;i++)
+		This->BlockHash[i] = NO_SLOT;
+
+	This->UseCounter = 0;
+	This->LastBlock = NO_BLOCK;
+	This->ReadAhead = 1;
+}
+//------------------------------------------------------------------------------
+void FreeBufferedIO(
+		PCDIO_READ This)
+{
+	free(This->DiskBuffer);
+	free(This->ReadAheadBuffer);
+	This->DiskBuffer = NULL;
+	This->ReadAheadBuffer = NULL;
+}
+//------------------------------------------------------------------------------
+PBYTE GetSectorBuffered(
+		PCDIO_READ This,
+		DWORD SectorNumber)
+{
+	int		Slot;
+
+	Slot = GetBufferedBlock(This, SectorNumber / BLOCK_SECTORS);
+	if (Slot == NO_SLOT)
+		return NULL;
+
+	This->LockList[Slot]++;
+	return(&This->DiskBuffer[(Slot * BLOCK_SIZE) + ((SectorNumber % BLOCK_SECTORS) * SECTOR_SIZE)]);
 }
 //------------------------------------------------------------------------------
 void ReleaseBufferedSector(
 		PCDIO_READ This,
 		DWORD SectorNumber)
 {
-	int     i;
+	int     Slot;
 
-	// Find the sector in the lock list and decrease its usage count
-	for(i = 0;i < DISK_BUFFER;i++)
+	// Find the block in the lock list and decrease its usage count
+	Slot = FindBufferedBlock(This, SectorNumber / BLOCK_SECTORS);
+	if ((Slot != NO_SLOT) && (This->LockList[Slot]))
+		This->LockList[Slot]--;
+}
+//------------------------------------------------------------------------------
+BOOL ReadBuffered(
+		PCDIO_READ This,
+		PVOID OutBuffer,
+		DWORD StartSector,
+		DWORD Offset,
+		DWORD Size)
+{
+	PBYTE	Buffer = (PBYTE)OutBuffer;
+	DWORD	Block, Position, Count, Chunk;
+	int		Slot;
+
+	StartSector += Offset / SECTOR_SIZE;
+	Block = StartSector / BLOCK_SECTORS;
+	Position = ((StartSector % BLOCK_SECTORS) * SECTOR_SIZE) + (Offset % SECTOR_SIZE);
+	while (Size > 0)
 	{
-		if ((This->SectorList[i] == SectorNumber)&&(This->LockList[i]))
+		if ((Position == 0) && (Size >= BLOCK_SIZE) && (FindBufferedBlock(This, Block) == NO_SLOT))
+		{
+			// Whole blocks that aren't buffered are read straight into the output
+			Count = MIN(Size / BLOCK_SIZE, MAX_READ_AHEAD);
+			if (!This->Sectors(This->Data, Buffer, Block * BLOCK_SECTORS, Count * BLOCK_SECTORS))
+				return FALSE;
+
+			This->LastBlock = Block + Count - 1;
+			Chunk = Count * BLOCK_SIZE;
+		}
+		else
 		{
-			This->LockList[i]--;
-			return;
+			Slot = GetBufferedBlock(This, Block);
+			if (Slot == NO_SLOT)
+				return FALSE;
+
+			Chunk = MIN(Size, BLOCK_SIZE - Position);
+			memcpy(Buffer, &This->DiskBuffer[(Slot * BLOCK_SIZE) + Position], Chunk);
 		}
+
+		Buffer += Chunk;
+		Size -= Chunk;
+		Position += Chunk;
+		Block += Position / BLOCK_SIZE;
+		Position %= BLOCK_SIZE;
 	}
+
+	return TRUE;
 }
 
 } // namespace
@@ -13,14 +13,33 @@ extern "C" {
 // Determines how large a sector is
 #define SECTOR_SIZE 2048
 
-// Determines how many sectors are buffered in each instance of CDIO_READ
+// Sectors are buffered per block of this many sectors (32 * 2048 = 64 Kb)
+#define BLOCK_SECTORS	32
+#define BLOCK_SIZE		(SECTOR_SIZE * BLOCK_SECTORS)
+
+// Determines how many blocks are buffered in each instance of CDIO_READ (4 Mb)
 #define DISK_BUFFER		64
 
+// Number of hash buckets used to look up buffered blocks (must be a power of 2)
+#define BLOCK_HASH_SIZE	128
+
+// Maximum number of blocks read at once while the disk is read sequentially (1 Mb)
+#define MAX_READ_AHEAD	16
+
+#define NO_BLOCK		0xFFFFFFFF
+#define NO_SLOT			-1
+
 typedef struct {
-	DWORD	SectorList[DISK_BUFFER];		// Ring buffer for buffered disk i/o
-	DWORD	LockList[DISK_BUFFER];			// Lock for each buffered sector
-	BYTE	DiskBuffer[SECTOR_SIZE * DISK_BUFFER];	// Storage room for buffered sectors
-	DWORD	WriteIndex;						// Write pointer
+	DWORD	BlockList[DISK_BUFFER];			// Block held by each buffer slot (NO_BLOCK if free)
+	DWORD	LockList[DISK_BUFFER];			// Lock for each buffer slot
+	DWORD	UseList[DISK_BUFFER];			// Last use of each buffer slot (for LRU replacement)
+	SHORT	NextList[DISK_BUFFER];			// Next slot in the same hash bucket
+	SHORT	BlockHash[BLOCK_HASH_SIZE];		// First slot of each hash bucket
+	PBYTE	DiskBuffer;						// Storage room for buffered blocks
+	PBYTE	ReadAheadBuffer;				// Storage room for multi-block transfers
+	DWORD	UseCounter;						// Increments on every buffer access
+	DWORD	LastBlock;						// Last block read from disk
+	DWORD	ReadAhead;						// Current read-ahead window (in blocks)
 
 	// Pointer to arbitrary data passed at init
 	// (usually a file or device handle)
@@ -34,6 +53,18 @@ typedef struct {
 
 } CDIO_READ, *PCDIO_READ;
 
+// Allocate the buffers (a CDIO_READ must be zeroed before its first init)
+extern BOOL InitBufferedIO(
+				PCDIO_READ This);
+
+// Drop all buffered blocks
+extern void ResetBufferedIO(
+				PCDIO_READ This);
+
+// Free the buffers
+extern void FreeBufferedIO(
+				PCDIO_READ This);
+
 // Get a sector from buffer and lock it
 extern PBYTE GetSectorBuffered(
 				PCDIO_READ This,
@@ -44,6 +75,14 @@ extern void ReleaseBufferedSector(
 				PCDIO_READ This,
 				DWORD SectorNumber);
 
+// Read Size bytes, starting Offset bytes after the start of StartSector
+extern BOOL ReadBuffered(
+				PCDIO_READ This,
+				PVOID Buffer,
+				DWORD StartSector,
+				DWORD Offset,
+				DWORD Size);
+
 #ifdef __cplusplus
 }
 #endif
@@ -23,8 +23,6 @@
 #endif // _WIN32
 #endif // DIRECTORY_SEPARATOR
 
-#define TRANSFER_SIZE	32 // Read granularity (in sectors) = 32 * 2048 = 64 Kb
-
 #define VOLUME_DESCRIPTOR_SECTOR_OFFSET 32
 
 #if BYTE_ORDER == BIG_ENDIAN
@@ -48,32 +46,63 @@ typedef struct {
 	BYTE		Filename[FILENAME_SIZE];
 } XDVDFS_DIRECTORY_ENTRY, *PXDVDFS_DIRECTORY_ENTRY;
 
+// Cxbx addition : Sectors at which known image layouts start their game partition
+// (plain XISO, and the XGD1, XGD2 and XGD3 layouts of full disc images)
+static const DWORD XDVDFS_BaseSectors[] = { 0, 0x30600, 0x1FB20, 0x4100 };
+
+static BOOL XDVDFS_ReadVolumeDescriptor(
+			PXDVDFS_SESSION	Session)
+{
+	// Read in the volume descriptor (the actual root of the filesystem is 32 sectors back)
+	return ReadBuffered(
+		&Session->Read,
+		(PVOID)&Session->Root,
+		Session->FileSystemBaseSector + VOLUME_DESCRIPTOR_SECTOR_OFFSET,
+		0,
+		sizeof(XDVDFS_VOLUME_DESCRIPTOR));
+}
+
+static BOOL XDVDFS_CheckSignatures(
+			PXDVDFS_SESSION	Session)
+{
+	return (memcmp(Session->Root.Signature1, XDVDFS_SIGNATURE, SIGNATURE_SIZE) == 0) &&
+		(memcmp(Session->Root.Signature2, XDVDFS_SIGNATURE, SIGNATURE_SIZE) == 0);
+}
+
 // XDVDFS init a session object
 BOOL	XDVDFS_Mount(
 			PXDVDFS_SESSION	Session,
 			BOOL			(*ReadFunc)(PVOID, PVOID, DWORD, DWORD),
 			PVOID			Data)
 {
+	DWORD	i;
+
+	XDVDFS_UnMount(Session);
+
 	Session->Read.Data = Data;
 	Session->Read.Sectors = ReadFunc;
+	if (!InitBufferedIO(&Session->Read))
+		return FALSE;
 
-	XDVDFS_UnMount(Session);
+	// Cxbx addition : Try the known partition locations first
+	for(i = 0;i < sizeof(XDVDFS_BaseSectors) / sizeof(DWORD);i++)
+	{
+		Session->FileSystemBaseSector = XDVDFS_BaseSectors[i];
+		if (XDVDFS_ReadVolumeDescriptor(Session) && XDVDFS_CheckSignatures(Session))
+			return TRUE;
+	}
 
 	// scan sectors until the signature is found
 	Session->FileSystemBaseSector = 0;
 	while (1) {
-		// Read in the volume descriptor
-		if (!Session->Read.Sectors(
-			Session->Read.Data,
-			(PVOID)&Session->Root,
-			// the actual root of the filesystem is 32 sectors back
-			Session->FileSystemBaseSector + VOLUME_DESCRIPTOR_SECTOR_OFFSET,
-			1))
+		if (!XDVDFS_ReadVolumeDescriptor(Session))
+		{
+			XDVDFS_UnMount(Session);
 			return FALSE;
+		}
 
 		// Check signatures
-		if ((memcmp(Session->Root.Signature1, XDVDFS_Signature, SIGNATURE_SIZE) == 0) &&
-			(memcmp(Session->Root.Signature2, XDVDFS_Signature, SIGNATURE_SIZE) == 0)) {
+		if (XDVDFS_CheckSignatures(Session)) {
 			/* From https://github.com/multimediamike/xbfuse/blob/master/src/xdvdfs.c#L258 :
 			// process the volume descriptor
 			root_directory_sector = LE_32(&sector_buffer[0x14]);
@@ -98,10 +127,8 @@ BOOL	XDVDFS_Mount(
 BOOL	XDVDFS_UnMount(
 			PXDVDFS_SESSION	Session)
 {
-	// Reset ring buffer
-	memset(Session->Read.SectorList, 0, sizeof(DWORD) * DISK_BUFFER);
-	memset(Session->Read.LockList, 0, sizeof(DWORD) * DISK_BUFFER);
-	Session->Read.WriteIndex = 0;
+	// Release the block buffer
+	FreeBufferedIO(&Session->Read);
 	// Invalidate all open files & search structures
 	Session->Magic++;
 	return TRUE;
@@ -130,7 +157,7 @@ DWORD	XDVDFS_EnumFiles(
 			PSEARCH_RECORD	SearchRecord)
 {
 	PXDVDFS_DIRECTORY_ENTRY	Entry;
-	DWORD					SectorNumber, Position, i;
+	DWORD					SectorNumber, Position;
 	PBYTE					Ptr;
 
 enum_retry:
@@ -151,16 +178,8 @@ enum_retry:
 	if (!Ptr)
 		return XDVDFS_DISK_ERROR;
 
-	// If we're at the begining...
-	if (!SearchRecord->Position)
-	{
-		// ...bufferize the whole dir.
-		for(i = 1;i < MIN(DISK_BUFFER - 1, SearchRecord->DirectorySize / SECTOR_SIZE);i++)
-		{
-			GetSectorBuffered(&Session->Read, i + SearchRecord->SearchStartSector);
-			ReleaseBufferedSector(&Session->Read, i + SearchRecord->SearchStartSector);
-		}
-	}
+	// Note : There's no need to bufferize the whole dir anymore, as sectors are
+	// buffered per 64 Kb block, and reading on sequentially grows the read-ahead.
 
 	Entry = (PXDVDFS_DIRECTORY_ENTRY)&Ptr[Position];
 	// If Entry->FileStartSector = 0xFFFFFFFF or Position > 2040, we reached the last
@@ -326,7 +345,6 @@ DWORD	XDVDFS_OpenFile(
 
 	// Copy file info into the FILE_RECORD structure
 	FileRecord->Magic = SearchRecord.Magic;
-	FileRecord->PartialSector = 0;
 	FileRecord->FileStartSector = SearchRecord.CurrentFileStartSector;
 	FileRecord->FileSize = SearchRecord.CurrentFileSize;
 	FileRecord->CurrentPosition = 0;
@@ -349,7 +367,6 @@ DWORD	XDVDFS_OpenFileEx(
 
 	// Copy file info into the FILE_RECORD structure
 	FileRecord->Magic = SearchRecord->Magic;
-	FileRecord->PartialSector = 0;
 	FileRecord->FileStartSector = SearchRecord->CurrentFileStartSector;
 	FileRecord->FileSize = SearchRecord->CurrentFileSize;
 	FileRecord->CurrentPosition = 0;
@@ -363,7 +380,7 @@ DWORD	XDVDFS_FileRead(
 			PVOID			OutBuffer,
 			DWORD			Size)
 {
-	DWORD   CurrentSector, Position, PartialRead, Readed, i;
+	DWORD   Readed;
 	PBYTE	Buffer = (PBYTE)OutBuffer;
 
 	Readed = 0;
@@ -379,85 +396,13 @@ DWORD	XDVDFS_FileRead(
 	if (!Size)
 		return Readed;
 
-	// Process partial sector read before
-	Position = FileRecord->CurrentPosition % SECTOR_SIZE;
-	if (Position)
-	{
-		CurrentSector = (FileRecord->CurrentPosition / SECTOR_SIZE) +
-			FileRecord->FileStartSector;
-		PartialRead = MIN(Size, SECTOR_SIZE - Position);
-		if (FileRecord->PartialSector != CurrentSector)
-		{
-			if (!Session->Read.Sectors(
-								Session->Read.Data,
-								FileRecord->PartialData,
-								CurrentSector,
-								1))
-				return 0;
-
-			FileRecord->PartialSector = CurrentSector;
-		}
-
-		for(i = 0;i < PartialRead;i++)
-			*Buffer++ = FileRecord->PartialData[Position++];
-
-		Size -= PartialRead;
-		Readed += PartialRead;
-		FileRecord->CurrentPosition += PartialRead;
-		if (!Size)
-			return Readed;
-	}
-
-	// Process entire sector read
-	PartialRead = Size / SECTOR_SIZE;
-	if (PartialRead)
-	{
-		CurrentSector = (FileRecord->CurrentPosition / SECTOR_SIZE) + FileRecord->FileStartSector;
-		i = PartialRead;
-		while(i > 0)
-		{
-			Position = MIN(i, TRANSFER_SIZE);
-			if (!Session->Read.Sectors(
-					Session->Read.Data,
-					Buffer,
-					CurrentSector,
-					Position))
-				return Readed;
-
-			Buffer += Position * SECTOR_SIZE;
-			CurrentSector += Position;
-			i -= Position;
-		}
-
-		PartialRead *= SECTOR_SIZE;
-		Size -= PartialRead;
-		Readed += PartialRead;
-		FileRecord->CurrentPosition += PartialRead;
-		if (!Size)
-			return Readed;
-	}
-
-	// Process partial sector read after
-	PartialRead = Size;
-	CurrentSector = (FileRecord->CurrentPosition / SECTOR_SIZE)
-						+ FileRecord->FileStartSector;
-	if (FileRecord->PartialSector != CurrentSector)
-	{
-		if (!Session->Read.Sectors(
-							Session->Read.Data,
-							FileRecord->PartialData,
-							CurrentSector,
-							1))
-			return Readed;
-
-		FileRecord->PartialSector = CurrentSector;
-	}
-
-	for(i = 0;i < PartialRead;i++)
-		*Buffer++ = FileRecord->PartialData[i];
+	// Cxbx addition : Read via the block buffer, which keeps partial sectors around
+	// and reads ahead when the file is read sequentially
+	if (!ReadBuffered(&Session->Read, Buffer, FileRecord->FileStartSector, FileRecord->CurrentPosition, Size))
+		return Readed;
 
-	Readed += PartialRead;
-	FileRecord->CurrentPosition += PartialRead;
+	Readed = Size;
+	FileRecord->CurrentPosition += Size;
 	return Readed;
 }
 
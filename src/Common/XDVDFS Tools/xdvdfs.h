@@ -13,11 +13,11 @@ extern "C" {
 
 #include "buffered_io.h"
 
-CONST CHAR *XDVDFS_Signature = "MICROSOFT*XBOX*MEDIA";
-
 //-- Defines ------------------------------------------------------------------
 
-#define SIGNATURE_SIZE sizeof(XDVDFS_Signature)
+#define XDVDFS_SIGNATURE "MICROSOFT*XBOX*MEDIA"
+
+#define SIGNATURE_SIZE (sizeof(XDVDFS_SIGNATURE) - 1)
 
 #define FILENAME_SIZE 256
 
@@ -73,8 +73,6 @@ typedef struct {
 // File Record
 typedef struct {
 	DWORD	Magic;
-	BYTE	PartialData[SECTOR_SIZE];
-	DWORD	PartialSector;
 	DWORD	FileStartSector;
 	DWORD	FileSize;
 	DWORD	CurrentPosition;
@@ -96,6 +94,7 @@ typedef struct {
 //-- Exported Functions -------------------------------------------------------
 
 // XDVDFS init a session object
+// Note: The session must be zeroed before it's mounted for the first time
 extern BOOL		XDVDFS_Mount(
 					PXDVDFS_SESSION	Session,
 					BOOL			(*ReadFunc)(PVOID, PVOID, DWORD, DWORD),
@@ -42,13 +42,19 @@ typedef signed int     sint;
 typedef unsigned int   uint;
 typedef char           int08;
 typedef short          int16;
-typedef long           int32;
 typedef unsigned char  uint08;
 typedef unsigned short uint16;
-typedef unsigned long  uint32;
 typedef signed char    sint08;
 typedef signed short   sint16;
+#ifdef _WIN32
+typedef long           int32;
+typedef unsigned long  uint32;
 typedef signed long    sint32;
+#else // long is 64 bits wide on LP64 hosts (where the host tests may run)
+typedef int            int32;
+typedef unsigned int   uint32;
+typedef signed int     sint32;
+#endif
 /*! \} */
 
 /*! define this to track vertex buffers */
@@ -99,9 +105,11 @@ extern volatile bool g_bPrintfOn;
 #pragma warning(disable : 4477)
 #endif
 
-/*! DbgPrintf enabled if _DEBUG_TRACE is set */
+#include "Common/TraceRing.h" // For g_bTraceRingOn
+
+/*! DbgPrintf enabled if _DEBUG_TRACE is set (recorded binary while a trace ring is running) */
 #ifdef _DEBUG_TRACE
-	#define DbgPrintf(fmt, ...) do { if(g_bPrintfOn) printf("[0x%X] "##fmt, GetCurrentThreadId(), ##__VA_ARGS__); } while (0)
+	#define DbgPrintf(fmt, ...) do { if(g_bTraceRingOn) TraceRingPrintf(fmt, ##__VA_ARGS__); else if(g_bPrintfOn) printf("[0x%X] "##fmt, GetCurrentThreadId(), ##__VA_ARGS__); } while (0)
 #else
 	inline void null_func(...) { }
 	#define DbgPrintf null_func
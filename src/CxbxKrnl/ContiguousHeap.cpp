@@ -0,0 +1,358 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Win32->CxbxKrnl->ContiguousHeap.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include <intrin.h> // For _BitScanForward(), _BitScanReverse()
+
+#include "ContiguousHeap.h"
+
+#define NO_PAGE UINT32_MAX
+
+static inline int LowestBit(uint32_t Value)
+{
+	unsigned long Index;
+
+	_BitScanForward(&Index, Value); // MSVC intrinsic; GCC has __builtin_ctz
+	return (int)Index;
+}
+
+static inline int HighestBit(uint32_t Value)
+{
+	unsigned long Index;
+
+	_BitScanReverse(&Index, Value); // MSVC intrinsic; GCC has __builtin_clz
+	return (int)Index;
+}
+
+ContiguousHeap::ContiguousHeap()
+{
+	Initialize(0, 0);
+}
+
+void ContiguousHeap::Initialize(uint32_t StartAddress, uint32_t EndAddress)
+{
+	m_StartAddress = (StartAddress + CONTIGUOUS_HEAP_PAGE_SIZE - 1) & ~(CONTIGUOUS_HEAP_PAGE_SIZE - 1);
+	m_PageCount = 0;
+	if (EndAddress > m_StartAddress)
+		m_PageCount = (EndAddress - m_StartAddress) / CONTIGUOUS_HEAP_PAGE_SIZE;
+
+	m_FlBitmap = 0;
+	for (int fl = 0; fl < CONTIGUOUS_HEAP_FL_COUNT; fl++) {
+		m_SlBitmap[fl] = 0;
+		for (int sl = 0; sl < CONTIGUOUS_HEAP_SL_COUNT; sl++)
+			m_FreeLists[fl][sl] = NO_PAGE;
+	}
+
+	m_UsedPages = 0;
+	m_HighWaterPages = 0;
+	m_HighWaterPage = 0;
+	m_FreeBlocks = 0;
+	m_UsedBlocks = 0;
+	m_FailedAllocations = 0;
+
+	m_Blocks.assign(m_PageCount, Block());
+	if (m_PageCount == 0)
+		return;
+
+	// Start out with one free block spanning the whole region
+	m_Blocks[0].Pages = m_PageCount;
+	m_Blocks[0].PrevPhysical = NO_PAGE;
+	m_Blocks[0].IsFree = true;
+	InsertFreeBlock(0);
+}
+
+void ContiguousHeap::MapSize(uint32_t Pages, int *pFl, int *pSl)
+{
+	if (Pages < CONTIGUOUS_HEAP_SL_COUNT) {
+		// Small sizes all go in the first level, one list per size
+		*pFl = 0;
+		*pSl = (int)Pages;
+		return;
+	}
+
+	int Log2 = HighestBit(Pages);
+
+	*pFl = Log2 - CONTIGUOUS_HEAP_SL_LOG2 + 1;
+	*pSl = (int)(Pages >> (Log2 - CONTIGUOUS_HEAP_SL_LOG2)) - CONTIGUOUS_HEAP_SL_COUNT;
+}
+
+bool ContiguousHeap::FindFreeList(uint32_t Pages, int *pFl, int *pSl)
+{
+	// Round the size up to the next list boundary, so any block in the found list fits
+	if (Pages >= CONTIGUOUS_HEAP_SL_COUNT)
+		Pages += (1 << (HighestBit(Pages) - CONTIGUOUS_HEAP_SL_LOG2)) - 1;
+
+	int fl, sl;
+
+	MapSize(Pages, &fl, &sl);
+	if (fl >= CONTIGUOUS_HEAP_FL_COUNT)
+		return false;
+
+	// Look for a non-empty list in this first level, or else in the first level above it
+	uint32_t SlBitmap = m_SlBitmap[fl] & (~0U << sl);
+	if (SlBitmap == 0) {
+		uint32_t FlBitmap = m_FlBitmap & (~0U << (fl + 1));
+		if (FlBitmap == 0)
+			return false;
+
+		fl = LowestBit(FlBitmap);
+		SlBitmap = m_SlBitmap[fl];
+	}
+
+	*pFl = fl;
+	*pSl = LowestBit(SlBitmap);
+	return true;
+}
+
+uint32_t ContiguousHeap::FindFittingBlock(uint32_t Pages, uint32_t AlignMask)
+{
+	int fl, sl;
+
+	// Walk all lists that can hold blocks of at least Pages pages, checking every block
+	MapSize(Pages, &fl, &sl);
+	for (; fl < CONTIGUOUS_HEAP_FL_COUNT; fl++, sl = 0) {
+		for (uint32_t SlBitmap = m_SlBitmap[fl] & (~0U << sl); SlBitmap != 0; SlBitmap &= SlBitmap - 1) {
+			for (uint32_t Page = m_FreeLists[fl][LowestBit(SlBitmap)]; Page != NO_PAGE; Page = m_Blocks[Page].NextFree) {
+				uint32_t Address = m_StartAddress + (Page * CONTIGUOUS_HEAP_PAGE_SIZE);
+				uint32_t Padding = (((Address + AlignMask) & ~AlignMask) - Address) / CONTIGUOUS_HEAP_PAGE_SIZE;
+
+				if (Padding + Pages <= m_Blocks[Page].Pages)
+					return Page;
+			}
+		}
+	}
+
+	return NO_PAGE;
+}
+
+void ContiguousHeap::InsertFreeBlock(uint32_t Page)
+{
+	Block &block = m_Blocks[Page];
+	int fl, sl;
+
+	MapSize(block.Pages, &fl, &sl);
+	block.IsFree = true;
+	block.PrevFree = NO_PAGE;
+	block.NextFree = m_FreeLists[fl][sl];
+	if (block.NextFree != NO_PAGE)
+		m_Blocks[block.NextFree].PrevFree = Page;
+
+	m_FreeLists[fl][sl] = Page;
+	m_FlBitmap |= 1U << fl;
+	m_SlBitmap[fl] |= 1U << sl;
+	m_FreeBlocks++;
+}
+
+void ContiguousHeap::RemoveFreeBlock(uint32_t Page)
+{
+	Block &block = m_Blocks[Page];
+	int fl, sl;
+
+	MapSize(block.Pages, &fl, &sl);
+	if (block.PrevFree != NO_PAGE)
+		m_Blocks[block.PrevFree].NextFree = block.NextFree;
+	else
+		m_FreeLists[fl][sl] = block.NextFree;
+
+	if (block.NextFree != NO_PAGE)
+		m_Blocks[block.NextFree].PrevFree = block.PrevFree;
+
+	// Clear the bitmap bits when the list has become empty
+	if (m_FreeLists[fl][sl] == NO_PAGE) {
+		m_SlBitmap[fl] &= ~(1U << sl);
+		if (m_SlBitmap[fl] == 0)
+			m_FlBitmap &= ~(1U << fl);
+	}
+
+	block.IsFree = false;
+	m_FreeBlocks--;
+}
+
+// Cuts the given block after Pages pages, and returns the first page of the remainder
+uint32_t ContiguousHeap::SplitBlock(uint32_t Page, uint32_t Pages)
+{
+	uint32_t Remainder = Page + Pages;
+	uint32_t Next = Page + m_Blocks[Page].Pages;
+
+	m_Blocks[Remainder].Pages = m_Blocks[Page].Pages - Pages;
+	m_Blocks[Remainder].PrevPhysical = Page;
+	m_Blocks[Remainder].IsFree = false;
+	m_Blocks[Page].Pages = Pages;
+	if (Next < m_PageCount)
+		m_Blocks[Next].PrevPhysical = Remainder;
+
+	return Remainder;
+}
+
+// Merges a block that has just been freed with its free neighbours, and returns the result
+uint32_t ContiguousHeap::MergeFreeBlock(uint32_t Page)
+{
+	uint32_t Next = Page + m_Blocks[Page].Pages;
+
+	if (Next < m_PageCount && m_Blocks[Next].IsFree) {
+		RemoveFreeBlock(Next);
+		m_Blocks[Page].Pages += m_Blocks[Next].Pages;
+		m_Blocks[Next].Pages = 0;
+	}
+
+	uint32_t Prev = m_Blocks[Page].PrevPhysical;
+
+	if (Prev != NO_PAGE && m_Blocks[Prev].IsFree) {
+		RemoveFreeBlock(Prev);
+		m_Blocks[Prev].Pages += m_Blocks[Page].Pages;
+		m_Blocks[Page].Pages = 0;
+		Page = Prev;
+	}
+
+	Next = Page + m_Blocks[Page].Pages;
+	if (Next < m_PageCount)
+		m_Blocks[Next].PrevPhysical = Page;
+
+	return Page;
+}
+
+uint32_t ContiguousHeap::Allocate(size_t Size, size_t Alignment)
+{
+	uint32_t Pages = (uint32_t)((Size + CONTIGUOUS_HEAP_PAGE_SIZE - 1) / CONTIGUOUS_HEAP_PAGE_SIZE);
+	uint32_t AlignMask = (uint32_t)(Alignment - 1) | (CONTIGUOUS_HEAP_PAGE_SIZE - 1);
+	uint32_t Page = NO_PAGE;
+	int fl, sl;
+
+	if (Pages == 0)
+		Pages = 1;
+
+	if (Size > (size_t)m_PageCount * CONTIGUOUS_HEAP_PAGE_SIZE) {
+		m_FailedAllocations++;
+		return 0;
+	}
+
+	// Try the first block of the best fitting list, which suffices unless it's misaligned
+	if (FindFreeList(Pages, &fl, &sl)) {
+		uint32_t Candidate = m_FreeLists[fl][sl];
+		uint32_t Address = m_StartAddress + (Candidate * CONTIGUOUS_HEAP_PAGE_SIZE);
+		uint32_t Padding = (((Address + AlignMask) & ~AlignMask) - Address) / CONTIGUOUS_HEAP_PAGE_SIZE;
+
+		if (Padding + Pages <= m_Blocks[Candidate].Pages)
+			Page = Candidate;
+		// Otherwise, look for a block that fits even with the worst case padding
+		else if (FindFreeList(Pages + (AlignMask / CONTIGUOUS_HEAP_PAGE_SIZE), &fl, &sl))
+			Page = m_FreeLists[fl][sl];
+	}
+
+	// When fragmentation leaves only blocks that the rounded up lookups skip (smaller than
+	// the worst case padding, or in the list of the requested size), check them one by one,
+	// so an allocation only fails if there's really no free block it fits in
+	if (Page == NO_PAGE)
+		Page = FindFittingBlock(Pages, AlignMask);
+
+	if (Page == NO_PAGE) {
+		m_FailedAllocations++;
+		return 0;
+	}
+
+	RemoveFreeBlock(Page);
+
+	// Give the part before the aligned address back as a free block of its own
+	uint32_t Address = m_StartAddress + (Page * CONTIGUOUS_HEAP_PAGE_SIZE);
+	uint32_t Padding = (((Address + AlignMask) & ~AlignMask) - Address) / CONTIGUOUS_HEAP_PAGE_SIZE;
+
+	if (Padding > 0) {
+		uint32_t Aligned = SplitBlock(Page, Padding);
+
+		InsertFreeBlock(Page);
+		Page = Aligned;
+	}
+
+	// And the part after the allocation too
+	if (m_Blocks[Page].Pages > Pages)
+		InsertFreeBlock(SplitBlock(Page, Pages));
+
+	m_UsedPages += Pages;
+	m_UsedBlocks++;
+	if (m_HighWaterPages < m_UsedPages)
+		m_HighWaterPages = m_UsedPages;
+
+	if (m_HighWaterPage < Page + Pages)
+		m_HighWaterPage = Page + Pages;
+
+	return m_StartAddress + (Page * CONTIGUOUS_HEAP_PAGE_SIZE);
+}
+
+size_t ContiguousHeap::Free(uint32_t Address)
+{
+	uint32_t Offset = Address - m_StartAddress;
+	uint32_t Page = Offset / CONTIGUOUS_HEAP_PAGE_SIZE;
+
+	if (Address < m_StartAddress || Page >= m_PageCount || (Offset % CONTIGUOUS_HEAP_PAGE_SIZE) != 0)
+		return 0;
+
+	uint32_t Pages = m_Blocks[Page].Pages;
+
+	if (Pages == 0 || m_Blocks[Page].IsFree)
+		return 0;
+
+	m_UsedPages -= Pages;
+	m_UsedBlocks--;
+	InsertFreeBlock(MergeFreeBlock(Page));
+
+	return (size_t)Pages * CONTIGUOUS_HEAP_PAGE_SIZE;
+}
+
+void ContiguousHeap::GetStatistics(ContiguousHeapStatistics *pStatistics)
+{
+	uint32_t LargestFreePages = 0;
+
+	// The largest free block is in the highest non-empty list
+	if (m_FlBitmap != 0) {
+		int fl = HighestBit(m_FlBitmap);
+		int sl = HighestBit(m_SlBitmap[fl]);
+
+		for (uint32_t Page = m_FreeLists[fl][sl]; Page != NO_PAGE; Page = m_Blocks[Page].NextFree)
+			if (LargestFreePages < m_Blocks[Page].Pages)
+				LargestFreePages = m_Blocks[Page].Pages;
+	}
+
+	uint32_t FreePages = m_PageCount - m_UsedPages;
+
+	pStatistics->TotalSize = (size_t)m_PageCount * CONTIGUOUS_HEAP_PAGE_SIZE;
+	pStatistics->UsedSize = (size_t)m_UsedPages * CONTIGUOUS_HEAP_PAGE_SIZE;
+	pStatistics->HighWaterSize = (size_t)m_HighWaterPages * CONTIGUOUS_HEAP_PAGE_SIZE;
+	pStatistics->HighWaterAddress = m_StartAddress + (m_HighWaterPage * CONTIGUOUS_HEAP_PAGE_SIZE);
+	pStatistics->LargestFreeSize = (size_t)LargestFreePages * CONTIGUOUS_HEAP_PAGE_SIZE;
+	pStatistics->FreeBlocks = m_FreeBlocks;
+	pStatistics->UsedBlocks = m_UsedBlocks;
+	pStatistics->FailedAllocations = m_FailedAllocations;
+	pStatistics->Fragmentation = (FreePages == 0) ? 0 : (uint32_t)(((uint64_t)(FreePages - LargestFreePages) * 100) / FreePages);
+}
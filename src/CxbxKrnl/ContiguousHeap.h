@@ -0,0 +1,112 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Win32->CxbxKrnl->ContiguousHeap.h
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#ifndef CONTIGUOUS_HEAP_H
+#define CONTIGUOUS_HEAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Page granular TLSF (two-level segregated fit) allocator for the contiguous memory region.
+// Free blocks are kept in lists per size class : the first level splits sizes by powers of
+// two, the second level splits each power of two in CONTIGUOUS_HEAP_SL_COUNT equal ranges.
+// Bitmaps over these lists make finding a good fit, allocating and freeing O(1); only when
+// fragmentation leaves no block in those lists, an allocation scans the free blocks instead.
+// Neighbouring free blocks are always merged. The block administration is kept outside the
+// region (indexed by page), so Xbox code can't corrupt it by writing past an allocation.
+#define CONTIGUOUS_HEAP_PAGE_SIZE 0x1000
+#define CONTIGUOUS_HEAP_SL_LOG2 4
+#define CONTIGUOUS_HEAP_SL_COUNT (1 << CONTIGUOUS_HEAP_SL_LOG2)
+#define CONTIGUOUS_HEAP_FL_COUNT 20 // Enough for regions of up to 2^23 pages
+
+typedef struct {
+	size_t TotalSize;
+	size_t UsedSize;
+	size_t HighWaterSize; // Largest UsedSize so far
+	uint32_t HighWaterAddress; // End of the highest block ever allocated
+	size_t LargestFreeSize;
+	uint32_t FreeBlocks;
+	uint32_t UsedBlocks;
+	uint32_t FailedAllocations;
+	// Percentage of free memory that's not in the largest free block
+	uint32_t Fragmentation;
+} ContiguousHeapStatistics;
+
+class ContiguousHeap
+{
+public:
+	ContiguousHeap();
+	// Manage the pages in [StartAddress, EndAddress), rounded inwards to whole pages
+	void Initialize(uint32_t StartAddress, uint32_t EndAddress);
+	// Returns 0 when there's no free block that's large enough
+	uint32_t Allocate(size_t Size, size_t Alignment);
+	// Returns the size of the freed block, or 0 if Address doesn't start an allocation
+	size_t Free(uint32_t Address);
+	void GetStatistics(ContiguousHeapStatistics *pStatistics);
+	size_t GetHighWaterSize() { return (size_t)m_HighWaterPages * CONTIGUOUS_HEAP_PAGE_SIZE; }
+private:
+	struct Block {
+		uint32_t Pages; // Non-zero only for the first page of a block
+		uint32_t PrevPhysical; // First page of the block before this one
+		uint32_t NextFree; // Free list links, only valid for free blocks
+		uint32_t PrevFree;
+		bool IsFree;
+	};
+
+	void MapSize(uint32_t Pages, int *pFl, int *pSl);
+	bool FindFreeList(uint32_t Pages, int *pFl, int *pSl);
+	uint32_t FindFittingBlock(uint32_t Pages, uint32_t AlignMask);
+	void InsertFreeBlock(uint32_t Page);
+	void RemoveFreeBlock(uint32_t Page);
+	uint32_t SplitBlock(uint32_t Page, uint32_t Pages);
+	uint32_t MergeFreeBlock(uint32_t Page);
+
+	std::vector<Block> m_Blocks;
+	uint32_t m_StartAddress;
+	uint32_t m_PageCount;
+	uint32_t m_FlBitmap;
+	uint32_t m_SlBitmap[CONTIGUOUS_HEAP_FL_COUNT];
+	uint32_t m_FreeLists[CONTIGUOUS_HEAP_FL_COUNT][CONTIGUOUS_HEAP_SL_COUNT];
+	uint32_t m_UsedPages;
+	uint32_t m_HighWaterPages;
+	uint32_t m_HighWaterPage;
+	uint32_t m_FreeBlocks;
+	uint32_t m_UsedBlocks;
+	uint32_t m_FailedAllocations;
+};
+
+#endif
@@ -0,0 +1,156 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Win32->CxbxKrnl->CriticalSectionRegistry.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "CxbxKrnl/CriticalSectionRegistry.h"
+
+#include <algorithm> // For std::sort
+#include <cstdio>
+#include <unordered_map>
+#include <vector>
+
+struct CRITICAL_SECTION_SHARD
+{
+	SRWLOCK Lock;
+	std::unordered_map<PVOID, INTERNAL_CRITICAL_SECTION> Sections;
+};
+
+CRITICAL_SECTION_SHARD GlobalCriticalSections[CRITICAL_SECTION_SHARDS];
+
+void InitializeSectionStructures(void)
+{
+	for (int iShard = 0; iShard < CRITICAL_SECTION_SHARDS; ++iShard)
+		InitializeSRWLock(&GlobalCriticalSections[iShard].Lock);
+}
+
+static inline CRITICAL_SECTION_SHARD &GetCriticalSectionShard(PVOID XboxCriticalSection)
+{
+	uintptr_t Address = (uintptr_t)XboxCriticalSection;
+
+	return GlobalCriticalSections[((Address >> 4) ^ (Address >> 10)) & (CRITICAL_SECTION_SHARDS - 1)];
+}
+
+INTERNAL_CRITICAL_SECTION *FindCriticalSection(PVOID XboxCriticalSection, bool bCreate)
+{
+	CRITICAL_SECTION_SHARD &Shard = GetCriticalSectionShard(XboxCriticalSection);
+	INTERNAL_CRITICAL_SECTION *pSection = nullptr;
+
+	AcquireSRWLockShared(&Shard.Lock);
+	auto it = Shard.Sections.find(XboxCriticalSection);
+	if (it != Shard.Sections.end())
+		pSection = &it->second;
+	ReleaseSRWLockShared(&Shard.Lock);
+
+	if (pSection != nullptr || !bCreate)
+		return pSection;
+
+	AcquireSRWLockExclusive(&Shard.Lock);
+	auto result = Shard.Sections.emplace(XboxCriticalSection, INTERNAL_CRITICAL_SECTION());
+	pSection = &result.first->second;
+	if (result.second)
+	{
+		// Another thread didn't register this section meanwhile
+		pSection->XboxCriticalSection = XboxCriticalSection;
+		NtDll::RtlInitializeCriticalSection(&pSection->NativeCriticalSection);
+	}
+	ReleaseSRWLockExclusive(&Shard.Lock);
+
+	return pSection;
+}
+
+INTERNAL_CRITICAL_SECTION *InitializeCriticalSectionEntry(PVOID XboxCriticalSection)
+{
+	INTERNAL_CRITICAL_SECTION *pSection = FindCriticalSection(XboxCriticalSection, false);
+
+	if (pSection == nullptr)
+		return FindCriticalSection(XboxCriticalSection);
+
+	// The memory of an earlier section is reused, so reuse its native section too
+	NtDll::RtlDeleteCriticalSection(&pSection->NativeCriticalSection);
+	NtDll::RtlInitializeCriticalSection(&pSection->NativeCriticalSection);
+
+	return pSection;
+}
+
+void EnterNativeCriticalSection(INTERNAL_CRITICAL_SECTION *pSection)
+{
+	if (!NtDll::RtlTryEnterCriticalSection(&pSection->NativeCriticalSection))
+	{
+		LARGE_INTEGER Start, End;
+
+		QueryPerformanceCounter(&Start);
+		NtDll::RtlEnterCriticalSection(&pSection->NativeCriticalSection);
+		QueryPerformanceCounter(&End);
+
+		pSection->Contentions++;
+		pSection->WaitTicks += End.QuadPart - Start.QuadPart;
+	}
+
+	pSection->Enters++;
+}
+
+bool TryEnterNativeCriticalSection(INTERNAL_CRITICAL_SECTION *pSection)
+{
+	if (!NtDll::RtlTryEnterCriticalSection(&pSection->NativeCriticalSection))
+		return false;
+
+	pSection->Enters++;
+	return true;
+}
+
+void DumpCriticalSectionStatistics(void)
+{
+	std::vector<INTERNAL_CRITICAL_SECTION *> Sections;
+
+	for (int iShard = 0; iShard < CRITICAL_SECTION_SHARDS; ++iShard)
+	{
+		AcquireSRWLockShared(&GlobalCriticalSections[iShard].Lock);
+		for (auto &it : GlobalCriticalSections[iShard].Sections)
+			Sections.push_back(&it.second);
+		ReleaseSRWLockShared(&GlobalCriticalSections[iShard].Lock);
+	}
+
+	// Most waited on first
+	std::sort(Sections.begin(), Sections.end(),
+		[](const INTERNAL_CRITICAL_SECTION *a, const INTERNAL_CRITICAL_SECTION *b) { return a->WaitTicks > b->WaitTicks; });
+
+	LARGE_INTEGER Frequency;
+	QueryPerformanceFrequency(&Frequency);
+
+	printf("Rtl : %u critical sections\n", (unsigned int)Sections.size());
+	for (size_t i = 0; i < Sections.size() && i < 32 && Sections[i]->Contentions > 0; i++)
+	{
+		printf("Rtl : 0x%.08X : %u enters, %u contended, %.3f ms waited\n",
+			(unsigned int)(uintptr_t)Sections[i]->XboxCriticalSection, Sections[i]->Enters, Sections[i]->Contentions,
+			(1000.0 * Sections[i]->WaitTicks) / Frequency.QuadPart);
+	}
+}
@@ -0,0 +1,83 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Win32->CxbxKrnl->CriticalSectionRegistry.h
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef CRITICAL_SECTION_REGISTRY_H
+#define CRITICAL_SECTION_REGISTRY_H
+
+#include <windows.h>
+#include <cstdint>
+
+namespace NtDll
+{
+	#include "CxbxKrnl/EmuNtDll.h"
+};
+
+// Xbox critical sections are implemented with native ones. Each Xbox section is
+// registered on first use, in hash maps sharded by address, so threads using
+// different sections rarely share a lock. Registered sections are never moved
+// nor removed, so they can be used after their lookup returned.
+#define CRITICAL_SECTION_SHARDS 64
+
+// A critical section containing the PC and Xbox equivalent
+struct INTERNAL_CRITICAL_SECTION
+{
+	PVOID XboxCriticalSection;
+	NtDll::_RTL_CRITICAL_SECTION NativeCriticalSection;
+
+	// contention statistics, only updated by the owner
+	uint32_t Enters;
+	uint32_t Contentions;
+	LONGLONG WaitTicks;
+};
+
+void InitializeSectionStructures(void);
+
+// Returns the native section of an Xbox critical section, registering and
+// initializing one if bCreate is set and there's none yet
+INTERNAL_CRITICAL_SECTION *FindCriticalSection(PVOID XboxCriticalSection, bool bCreate = true);
+
+// Like FindCriticalSection, but an already registered section gets a new native
+// section, since the Xbox one was initialized again (Xbox has no RtlDeleteCriticalSection,
+// so titles reuse the memory of sections they're done with)
+INTERNAL_CRITICAL_SECTION *InitializeCriticalSectionEntry(PVOID XboxCriticalSection);
+
+// Enters the native section, counting the times (and time) it had to wait
+void EnterNativeCriticalSection(INTERNAL_CRITICAL_SECTION *pSection);
+
+// Enters the native section if it's free, and counts that
+bool TryEnterNativeCriticalSection(INTERNAL_CRITICAL_SECTION *pSection);
+
+// Lists the sections that were waited on the longest
+void DumpCriticalSectionStatistics(void);
+
+#endif
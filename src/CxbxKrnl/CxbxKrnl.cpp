@@ -48,6 +48,7 @@ namespace xboxkrnl
 #include "Emu.h"
 #include "EmuX86.h"
 #include "EmuFile.h"
+#include "EmuXiso.h" // For CxbxIsXisoPath, CxbxRegisterDeviceXiso
 #include "EmuFS.h"
 #include "EmuEEPROM.h" // For CxbxRestoreEEPROM, EEPROM, XboxFactoryGameRegion
 #include "EmuShared.h"
@@ -414,7 +415,23 @@ void CxbxKrnlMain(int argc, char* argv[])
 	{
 		// Load Xbe (this one will reside above WinMain's virtual_memory_placeholder) 
 		g_EmuShared->SetXbePath(xbePath.c_str());
-		CxbxKrnl_Xbe = new Xbe(xbePath.c_str()); // TODO : Instead of using the Xbe class, port Dxbx _ReadXbeBlock()
+		std::string xbeFilePath = xbePath;
+		if (CxbxIsXisoPath(xbePath))
+		{
+			// When booting a disc image, extract it's default.xbe so the Xbe class can load it
+			std::string xisoCachePath = std::string(szFolder_CxbxReloadedData) + "\\XisoCache\\";
+			SHCreateDirectoryEx(nullptr, xisoCachePath.c_str(), nullptr);
+			xbeFilePath = xisoCachePath + PathFindFileName(xbePath.c_str()) + ".xbe";
+
+			EmuXisoImage *xisoImage = CxbxMountXiso(xbePath);
+			if ((xisoImage == nullptr) || !CxbxExtractXisoFile(xisoImage, "default.xbe", xbeFilePath))
+			{
+				MessageBox(NULL, "Couldn't load default.xbe from the disc image", "Cxbx-Reloaded", MB_OK);
+				return; // TODO : Halt(0); 
+			}
+		}
+
+		CxbxKrnl_Xbe = new Xbe(xbeFilePath.c_str()); // TODO : Instead of using the Xbe class, port Dxbx _ReadXbeBlock()
 
 		// Detect XBE type :
 		g_XbeType = GetXbeType(&CxbxKrnl_Xbe->m_Header);
@@ -673,7 +690,11 @@ void CxbxKrnlInit
 	sprintf(szBuffer, "%08X", ((Xbe::Certificate*)pXbeHeader->dwCertificateAddr)->dwTitleId);
 	std::string titleId(szBuffer);
 	// Games may assume they are running from CdRom :
-	CxbxDefaultXbeDriveIndex = CxbxRegisterDeviceHostPath(DeviceCdrom0, xbeDirectory);
+	if (CxbxIsXisoPath(xbePath))
+		// A disc image is mounted as the disc itself
+		CxbxDefaultXbeDriveIndex = CxbxRegisterDeviceXiso(DeviceCdrom0, xbePath);
+	else
+		CxbxDefaultXbeDriveIndex = CxbxRegisterDeviceHostPath(DeviceCdrom0, xbeDirectory);
 	// Partition 0 contains configuration data, and is accessed as a native file, instead as a folder :
 	CxbxRegisterDeviceHostPath(DeviceHarddisk0Partition0, CxbxBasePath + "Partition0", /*IsFile=*/true);
 	// The first two partitions are for Data and Shell files, respectively :
@@ -705,6 +726,10 @@ void CxbxKrnlInit
 		if (fileName.rfind('\\') != std::string::npos)
 			fileName = fileName.substr(fileName.rfind('\\') + 1);
 
+		// A disc image always boots it's default.xbe
+		if (CxbxIsXisoPath(xbePath))
+			fileName = "default.xbe";
+
 		if (xboxkrnl::XeImageFileName.Buffer != NULL)
 			free(xboxkrnl::XeImageFileName.Buffer);
 
@@ -761,6 +786,9 @@ void CxbxKrnlInit
 	{
 		DbgPrintf("EmuMain: Initializing OpenGL.\n");
 		InitOpenGLContext();
+
+		DbgPrintf("EmuMain: Initializing NV2A.\n");
+		EmuNV2A_Init();
 	}
 	else
 	{
@@ -884,6 +912,15 @@ void CxbxKrnlCleanup(const char *szErrorMessage, ...)
     printf("CxbxKrnl: Terminating Process\n");
     fflush(stdout);
 
+    // stop the timer thread, which also restores the host timer resolution
+    CxbxShutdownDpcAndTimerThread();
+
+    // stop the NV2A puller thread
+    EmuNV2A_Shutdown();
+
+    // write out the events still in the trace rings
+    TraceRingStop();
+
     // cleanup debug output
     {
         FreeConsole();
@@ -142,6 +142,7 @@ void CxbxKrnlPanic();
 void CxbxKrnlNoFunc();
 
 void CxbxInitPerformanceCounters(); // Implemented in EmuKrnlKe.cpp
+void CxbxShutdownDpcAndTimerThread(); // Implemented in EmuKrnlKe.cpp
 
 void CxbxInitFilePaths();
 
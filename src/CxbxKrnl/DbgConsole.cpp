@@ -43,6 +43,11 @@
 #include "DbgConsole.h"
 #include "ResourceTracker.h"
 #include "EmuXTL.h"
+#include "EmuNV2A.h"
+#include "EmuX86.h"
+#include "HandleTable.h"
+#include "Common/PushBufferDecoder.h"
+#include "Common/TraceDecoder.h"
 
 #include <conio.h>
 
@@ -194,6 +199,13 @@ void DbgConsole::ParseCommand()
         printf("CxbxDbg:  Help            [H]     : Show Command List\n");
         printf("CxbxDbg:  Quit/Exit       [Q]     : Stop Emulation\n");
         printf("CxbxDbg:  Trace           [T]     : Toggle Debug Trace\n");
+        printf("CxbxDbg:  TraceRing       [TR f]  : Record Binary Trace to File (Stop without f)\n");
+        printf("CxbxDbg:  DecodeTrace     [DT f]  : Render Binary Trace File as Text to f.txt\n");
+        printf("CxbxDbg:  DumpNV2A        [DNV]   : Show NV2A Register Accesses and PFIFO Statistics\n");
+        printf("CxbxDbg:  DumpX86         [DX86]  : Show MMIO Fault Decode Cache Statistics\n");
+        printf("CxbxDbg:  DumpCS          [DCS]   : Show Most Contended Critical Sections\n");
+        printf("CxbxDbg:  DumpHandles     [DH]    : Show Handle Table Statistics\n");
+        printf("CxbxDbg:  DumpPaths       [DP]    : Show File Path Cache Statistics\n");
 
         #ifdef _DEBUG_TRACK_VB
         printf("CxbxDbg:  ListVB          [LVB]   : List Active Vertex Buffers\n");
@@ -208,6 +220,8 @@ void DbgConsole::ParseCommand()
         printf("CxbxDbg:  DisablePB       [DPB #] : Disable Push Buffer(s)\n");
         printf("CxbxDbg:  EnablePB        [EPB #] : Enable Push Buffer(s)\n");
         printf("CxbxDbg:  ClearPB         [CPB]   : Clear Push Buffer List\n");
+        printf("CxbxDbg:  RecordPB        [RPB f] : Capture Push Buffers to File (Stop without f)\n");
+        printf("CxbxDbg:  ReplayPB        [PPB f] : Decode Captured Push Buffers from File\n");
         #endif
 
         #ifdef _DEBUG_ALLOC
@@ -229,6 +243,72 @@ void DbgConsole::ParseCommand()
         g_bPrintfOn = !g_bPrintfOn;
         printf("CxbxDbg: Trace is now %s\n", g_bPrintfOn ? "ON" : "OFF");
     }
+    else if(_stricmp(szCmd, "tr") == 0 || _stricmp(szCmd, "TraceRing") == 0)
+    {
+        char szFileName[MAX_PATH];
+
+        if(sscanf(m_szInput, "%*s %259s", szFileName) == 1)
+        {
+            if(TraceRingStart(szFileName))
+                printf("CxbxDbg: Recording Binary Trace to %s\n", szFileName);
+            else
+                printf("CxbxDbg: Could not create %s\n", szFileName);
+        }
+        else
+        {
+            TraceRingStop();
+
+            printf("CxbxDbg: Binary Trace Stopped\n");
+        }
+    }
+    else if(_stricmp(szCmd, "dt") == 0 || _stricmp(szCmd, "DecodeTrace") == 0)
+    {
+        char szFileName[MAX_PATH];
+
+        if(sscanf(m_szInput, "%*s %255s", szFileName) == 1)
+        {
+            TraceDecoder Decoder(szFileName);
+
+            strcat(szFileName, ".txt");
+
+            FILE *File = fopen(szFileName, "wt");
+
+            if(File != NULL)
+            {
+                Decoder.Render(File);
+                fclose(File);
+            }
+
+            if(Decoder.HasError())
+                printf("CxbxDbg: %s\n", Decoder.GetError().c_str());
+            else
+                printf("CxbxDbg: %u Events (%u Dropped) Written to %s\n", Decoder.GetEventCount(), Decoder.GetDroppedCount(), szFileName);
+        }
+        else
+        {
+            printf("CxbxDbg: Syntax Incorrect (dt filename)\n");
+        }
+    }
+    else if(_stricmp(szCmd, "dnv") == 0 || _stricmp(szCmd, "DumpNV2A") == 0)
+    {
+        EmuNV2A_DumpAccessCounts();
+    }
+    else if(_stricmp(szCmd, "dx86") == 0 || _stricmp(szCmd, "DumpX86") == 0)
+    {
+        EmuX86_DumpStatistics();
+    }
+    else if(_stricmp(szCmd, "dcs") == 0 || _stricmp(szCmd, "DumpCS") == 0)
+    {
+        DumpCriticalSectionStatistics();
+    }
+    else if(_stricmp(szCmd, "dh") == 0 || _stricmp(szCmd, "DumpHandles") == 0)
+    {
+        g_HandleTable.DumpStatistics();
+    }
+    else if(_stricmp(szCmd, "dp") == 0 || _stricmp(szCmd, "DumpPaths") == 0)
+    {
+        DumpFilePathCacheStatistics();
+    }
     #ifdef _DEBUG_TRACK_VB
     else if(_stricmp(szCmd, "lvb") == 0 || _stricmp(szCmd, "ListVB") == 0)
     {
@@ -375,6 +455,42 @@ void DbgConsole::ParseCommand()
 
         printf("CxbxDbg: Push Buffer List Cleared!\n");
     }
+    else if(_stricmp(szCmd, "rpb") == 0 || _stricmp(szCmd, "RecordPB") == 0)
+    {
+        char szFileName[MAX_PATH];
+
+        if(sscanf(m_szInput, "%*s %259s", szFileName) == 1)
+        {
+            if(XTL::EmuStartPushBufferCapture(szFileName))
+                printf("CxbxDbg: Capturing Push Buffers to %s\n", szFileName);
+        }
+        else
+        {
+            XTL::EmuStopPushBufferCapture();
+
+            printf("CxbxDbg: Push Buffer Capture Stopped\n");
+        }
+    }
+    else if(_stricmp(szCmd, "ppb") == 0 || _stricmp(szCmd, "ReplayPB") == 0)
+    {
+        char szFileName[MAX_PATH];
+
+        if(sscanf(m_szInput, "%*s %259s", szFileName) == 1)
+        {
+            PushBufferReplayer Replayer(szFileName);
+
+            Replayer.Replay();
+
+            if(Replayer.HasError())
+                printf("CxbxDbg: %s\n", Replayer.GetError().c_str());
+
+            Replayer.DumpStatistics(stdout);
+        }
+        else
+        {
+            printf("CxbxDbg: Syntax Incorrect (ppb filename)\n");
+        }
+    }
     #endif
     #ifdef _DEBUG_ALLOC
     else if(_stricmp(szCmd, "dmem") == 0 || _stricmp(szCmd, "DumpMem") == 0)
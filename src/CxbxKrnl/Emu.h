@@ -98,6 +98,8 @@ g_pXInputSetStateStatus[XINPUT_SETSTATE_SLOTS];
 extern HANDLE g_hInputHandle[XINPUT_HANDLE_SLOTS];
 
 extern void InitializeSectionStructures(void);
+extern void DumpCriticalSectionStatistics(void);
+extern void DumpFilePathCacheStatistics(void);
 
 typedef struct DUMMY_KERNEL
 {
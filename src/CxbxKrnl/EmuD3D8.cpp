@@ -60,6 +60,7 @@ namespace xboxkrnl
 #include <assert.h>
 #include <process.h>
 #include <clocale>
+#include <list>
 
 // Global(s)
 HWND                                g_hEmuWindow   = NULL; // rendering window
@@ -612,6 +613,9 @@ VOID XTL::EmuD3DInit()
         g_pD3D8->GetDeviceCaps(g_XBVideo.GetDisplayAdapter(), DevType, &g_D3DCaps);
     }
 
+    // limit the host memory spent on textures that are no longer in use
+    XTL::EmuTextureCacheInitialize((ULONGLONG)g_XBVideo.GetTextureCacheSize() * ONE_MB);
+
     // create default device
     {
         XTL::X_D3DPRESENT_PARAMETERS PresParam;
@@ -1245,6 +1249,9 @@ static DWORD WINAPI EmuCreateDeviceProxy(LPVOID)
                 // cache device pointer
                 g_pD3DDevice8 = *g_EmuCDPD.ppReturnedDeviceInterface;
 
+                // a new device starts out with unknown states
+                XTL::EmuInvalidateStateCache();
+
                 // default NULL guid
                 ZeroMemory(&g_ddguid, sizeof(GUID));
 
@@ -1488,6 +1495,9 @@ static void EmuAdjustPower2(UINT *dwWidth, UINT *dwHeight)
 // Derived from EmuUnswizzleActiveTexture
 static void EmuUnswizzleTextureStages()
 {
+	// scratch space for the unswizzled levels, kept between calls
+	static std::vector<uint08> UnswizzleBuffer;
+
 	for( int i = 0; i < TEXTURE_STAGES; i++ )
 	{
 		// for current usages, we're always on stage 0
@@ -1549,7 +1559,10 @@ static void EmuUnswizzleTextureStages()
 					RECT  iRect = {0,0,0,0};
 					POINT iPoint = {0,0};
 
-					void *pTemp = malloc(dwPitch*dwHeight);
+					if(UnswizzleBuffer.size() < dwPitch*dwHeight)
+						UnswizzleBuffer.resize(dwPitch*dwHeight);
+
+					void *pTemp = UnswizzleBuffer.data();
 
 					XTL::EmuUnswizzleRect
 					(
@@ -1559,9 +1572,7 @@ static void EmuUnswizzleTextureStages()
 
 					memcpy(LockedRect.pBits, pTemp, dwPitch*dwHeight);
 
-					pHostTexture->UnlockRect(0);
-
-					free(pTemp);
+					pHostTexture->UnlockRect(v);
 				}
 			}
 
@@ -1570,33 +1581,95 @@ static void EmuUnswizzleTextureStages()
 	}
 }
 
+// Indices compared on each use of a converted index buffer, to notice changes quickly
+#define INDEX_BUFFER_SAMPLES 32
+// Every this many uses, all indices are compared (page by page)
+#define INDEX_BUFFER_VERIFY_INTERVAL 8
+// Indices per page, in which changed indices are detected and uploaded
+#define INDEX_BUFFER_PAGE_INDICES (0x1000 / sizeof(WORD))
+// Memory the converted index buffers (host buffers plus their shadow copies) may take up
+#define INDEX_BUFFER_CACHE_SIZE (16 * ONE_MB)
+
 typedef struct {
-	DWORD Hash = 0;
-	DWORD IndexCount = 0;;
+	DWORD IndexCount = 0;
+	DWORD Capacity = 0; // indices the host buffer holds
+	DWORD UseCount = 0;
+	WORD MinIndex = 0;
+	WORD MaxIndex = 0;
+	std::vector<WORD> Shadow; // the indices as last uploaded
 	XTL::IDirect3DIndexBuffer8* pHostIndexBuffer = nullptr;
+	std::list<PWORD>::iterator LruPosition;
 } ConvertedIndexBuffer;
 
 std::map<PWORD, ConvertedIndexBuffer> g_ConvertedIndexBuffers;
-	
+std::list<PWORD> g_ConvertedIndexBufferLru; // most recently used first
+DWORD g_ConvertedIndexBufferBytes = 0;
+
+static void CxbxFreeIndexBuffer(std::map<PWORD, ConvertedIndexBuffer>::iterator it)
+{
+	ConvertedIndexBuffer& indexBuffer = it->second;
+
+	if (indexBuffer.pHostIndexBuffer != nullptr) {
+		indexBuffer.pHostIndexBuffer->Release();
+	}
+
+	g_ConvertedIndexBufferBytes -= indexBuffer.Capacity * 2 * sizeof(WORD);
+	g_ConvertedIndexBufferLru.erase(indexBuffer.LruPosition);
+	g_ConvertedIndexBuffers.erase(it);
+}
+
 void CxbxRemoveIndexBuffer(PWORD pData)
 {
-	// HACK: Never Free
+	auto it = g_ConvertedIndexBuffers.find(pData);
+	if (it != g_ConvertedIndexBuffers.end()) {
+		CxbxFreeIndexBuffer(it);
+	}
+}
+
+// Returns true when any of a set of indices (spread over the buffer, and shifting with each use) changed
+static bool CxbxSampleIndexBuffer(const ConvertedIndexBuffer& indexBuffer, PWORD pIndexData)
+{
+	DWORD dwStep = indexBuffer.IndexCount / INDEX_BUFFER_SAMPLES;
+	DWORD dwIndex = indexBuffer.UseCount % dwStep;
+
+	for (int i = 0; i < INDEX_BUFFER_SAMPLES; i++, dwIndex += dwStep) {
+		if (pIndexData[dwIndex] != indexBuffer.Shadow[dwIndex]) {
+			return true;
+		}
+	}
+
+	return false;
 }
 
 void CxbxUpdateActiveIndexBuffer
 (
 	PWORD         pIndexData,
-	UINT          IndexCount
+	UINT          IndexCount,
+	UINT         *pMinIndex,
+	UINT         *pNumVertices
 )
 {
+	// Find (or create) the converted buffer, and mark it as most recently used
+	auto it = g_ConvertedIndexBuffers.find(pIndexData);
+	if (it == g_ConvertedIndexBuffers.end()) {
+		it = g_ConvertedIndexBuffers.emplace(pIndexData, ConvertedIndexBuffer()).first;
+		it->second.LruPosition = g_ConvertedIndexBufferLru.insert(g_ConvertedIndexBufferLru.begin(), pIndexData);
+	}
+	else {
+		g_ConvertedIndexBufferLru.splice(g_ConvertedIndexBufferLru.begin(), g_ConvertedIndexBufferLru, it->second.LruPosition);
+	}
+
 	// Create a reference to the active buffer
-	ConvertedIndexBuffer& indexBuffer = g_ConvertedIndexBuffers[pIndexData];
+	ConvertedIndexBuffer& indexBuffer = it->second;
+	bool bUploadAll = false;
 
-	// If the size has changed, free the buffer so it will be re-created
+	// If the buffer is too small, free it so it will be re-created
 	if (indexBuffer.pHostIndexBuffer != nullptr &&
-		indexBuffer.IndexCount < IndexCount) {
+		indexBuffer.Capacity < IndexCount) {
 		indexBuffer.pHostIndexBuffer->Release();
-		indexBuffer = {};
+		indexBuffer.pHostIndexBuffer = nullptr;
+		g_ConvertedIndexBufferBytes -= indexBuffer.Capacity * 2 * sizeof(WORD);
+		indexBuffer.Capacity = 0;
 	}
 
 	// If we need to create an index buffer, do so.
@@ -1612,26 +1685,80 @@ void CxbxUpdateActiveIndexBuffer
 		if (FAILED(hRet)) {
 			CxbxKrnlCleanup("CxbxUpdateActiveIndexBuffer: IndexBuffer Create Failed!");
 		}
+
+		indexBuffer.Capacity = IndexCount;
+		indexBuffer.Shadow.resize(IndexCount);
+		g_ConvertedIndexBufferBytes += indexBuffer.Capacity * 2 * sizeof(WORD);
+		bUploadAll = true;
 	}
 
-	// If the data needs updating, do so
-	uint32_t uiHash = XXHash32::hash(pIndexData, IndexCount * 2, 0);
-	if (uiHash != indexBuffer.Hash)	{
-		// Update the Index Count and the hash
+	// Determine which indices changed. Small buffers, buffers drawn with another count
+	// and every so many uses are compared completely, otherwise only a sample is checked.
+	DWORD dwFirstChanged = IndexCount, dwEndChanged = 0;
+
+	if (bUploadAll) {
+		dwFirstChanged = 0;
+		dwEndChanged = IndexCount;
+	}
+	else if (IndexCount != indexBuffer.IndexCount
+		|| IndexCount < INDEX_BUFFER_PAGE_INDICES
+		|| (indexBuffer.UseCount % INDEX_BUFFER_VERIFY_INTERVAL) == 0
+		|| CxbxSampleIndexBuffer(indexBuffer, pIndexData)) {
+		for (DWORD dwPage = 0; dwPage < IndexCount; dwPage += INDEX_BUFFER_PAGE_INDICES) {
+			DWORD dwCount = (IndexCount - dwPage < INDEX_BUFFER_PAGE_INDICES) ? IndexCount - dwPage : INDEX_BUFFER_PAGE_INDICES;
+
+			if (memcmp(&pIndexData[dwPage], &indexBuffer.Shadow[dwPage], dwCount * sizeof(WORD)) != 0) {
+				if (dwFirstChanged > dwPage) {
+					dwFirstChanged = dwPage;
+				}
+
+				dwEndChanged = dwPage + dwCount;
+			}
+		}
+	}
+
+	indexBuffer.UseCount++;
+
+	// If the data needs updating, do so (only the range of changed pages)
+	if (dwFirstChanged < dwEndChanged || IndexCount != indexBuffer.IndexCount) {
 		indexBuffer.IndexCount = IndexCount;
-		indexBuffer.Hash = uiHash;
 
-		// Update the host index buffer
-		BYTE* pData = nullptr;
-		indexBuffer.pHostIndexBuffer->Lock(0, 0, &pData, D3DLOCK_DISCARD);
-		if (pData == nullptr) {
-			CxbxKrnlCleanup("CxbxUpdateActiveIndexBuffer: Could not lock index buffer!");
+		if (dwFirstChanged < dwEndChanged) {
+			BYTE* pData = nullptr;
+			indexBuffer.pHostIndexBuffer->Lock(dwFirstChanged * 2, (dwEndChanged - dwFirstChanged) * 2, &pData, 0);
+			if (pData == nullptr) {
+				CxbxKrnlCleanup("CxbxUpdateActiveIndexBuffer: Could not lock index buffer!");
+			}
+
+			DbgPrintf("CxbxUpdateActiveIndexBuffer: Copying %d of %d indices (D3DFMT_INDEX16)\n", dwEndChanged - dwFirstChanged, IndexCount);
+			memcpy(pData, &pIndexData[dwFirstChanged], (dwEndChanged - dwFirstChanged) * 2);
+			memcpy(&indexBuffer.Shadow[dwFirstChanged], &pIndexData[dwFirstChanged], (dwEndChanged - dwFirstChanged) * 2);
+
+			indexBuffer.pHostIndexBuffer->Unlock();
+		}
+
+		// Determine the range of vertices the indices refer to
+		WORD wMinIndex = 0xFFFF, wMaxIndex = 0;
+		for (DWORD i = 0; i < IndexCount; i++) {
+			if (wMinIndex > indexBuffer.Shadow[i]) {
+				wMinIndex = indexBuffer.Shadow[i];
+			}
+
+			if (wMaxIndex < indexBuffer.Shadow[i]) {
+				wMaxIndex = indexBuffer.Shadow[i];
+			}
 		}
 
-		printf("CxbxUpdateActiveIndexBuffer: Copying %d indices (D3DFMT_INDEX16)\n", IndexCount);
-		memcpy(pData, pIndexData, IndexCount * 2); 
+		indexBuffer.MinIndex = (IndexCount > 0) ? wMinIndex : 0;
+		indexBuffer.MaxIndex = wMaxIndex;
+	}
+
+	*pMinIndex = indexBuffer.MinIndex;
+	*pNumVertices = indexBuffer.MaxIndex - indexBuffer.MinIndex + 1;
 
-		indexBuffer.pHostIndexBuffer->Unlock();
+	// Free the least recently used buffers, once they take up too much memory
+	while (g_ConvertedIndexBufferBytes > INDEX_BUFFER_CACHE_SIZE && g_ConvertedIndexBufferLru.back() != pIndexData) {
+		CxbxFreeIndexBuffer(g_ConvertedIndexBuffers.find(g_ConvertedIndexBufferLru.back()));
 	}
 
 	// Determine active the vertex index
@@ -2114,6 +2241,8 @@ HRESULT WINAPI XTL::EMUPATCH(D3DDevice_BeginStateBlock)()
 
     ULONG ret = g_pD3DDevice8->BeginStateBlock();
 
+    EmuRecordStateBlock(true);
+
     return ret;
 }
 
@@ -2161,6 +2290,8 @@ HRESULT WINAPI XTL::EMUPATCH(D3DDevice_ApplyStateBlock)(DWORD Token)
 
     ULONG ret = g_pD3DDevice8->ApplyStateBlock(Token);
 
+    EmuInvalidateStateCache();
+
     return ret;
 }
 
@@ -2175,6 +2306,8 @@ HRESULT WINAPI XTL::EMUPATCH(D3DDevice_EndStateBlock)(DWORD *pToken)
 
     ULONG ret = g_pD3DDevice8->EndStateBlock(pToken);
 
+    EmuRecordStateBlock(false);
+
     return ret;
 }
 
@@ -4347,7 +4480,7 @@ HRESULT WINAPI XTL::EMUPATCH(D3DDevice_Clear)
     else
         dwFillMode = D3DFILL_POINT;
 
-    g_pD3DDevice8->SetRenderState(D3DRS_FILLMODE, dwFillMode);
+    EmuSetRenderState(D3DRS_FILLMODE, dwFillMode);
 
     HRESULT ret = g_pD3DDevice8->Clear(Count, pRects, Flags, Color, Z, Stencil);
 
@@ -4409,6 +4542,10 @@ DWORD WINAPI XTL::EMUPATCH(D3DDevice_Swap)
 
 	g_pD3DDevice8->Present(0, 0, 0, 0);
 
+	EmuTextureCacheEndFrame();
+	EmuStateCacheEndFrame();
+	EmuPushBufferEndFrame();
+
 	if (Flags == CXBX_SWAP_PRESENT_FORWARD) // Only do this when forwarded from Present
 	{
 		// Put primitives per frame in the title
@@ -4628,6 +4765,12 @@ HRESULT WINAPI XTL::EMUPATCH(D3DResource_Register)
             BOOL  bCubemap = pPixelContainer->Format & X_D3DFORMAT_CUBEMAP;
 			dwBPP = EmuXBFormatBytesPerPixel(X_Format);
 
+            // texture cache state (all levels are uploaded unless the cache has some up to date)
+            TEXTURE_CACHE_KEY CacheKey;
+            BOOL  bCacheTexture = FALSE;
+            DWORD dwDirtyLevels = 0xFFFFFFFF, dwCacheHostSize = 0;
+            IDirect3DBaseTexture8 *pCachedTexture = nullptr;
+
             // Interpret Width/Height/BPP
             if(X_Format == X_D3DFMT_X8R8G8B8 || X_Format == X_D3DFMT_A8R8G8B8
 			|| X_Format == X_D3DFMT_A8B8G8R8)
@@ -4798,6 +4941,56 @@ HRESULT WINAPI XTL::EMUPATCH(D3DResource_Register)
                         PCFormat = D3DFMT_A8R8G8B8;   // ARGB
                     }
 
+                    // textures made from the same Xbox data before are taken from the texture cache
+                    bCacheTexture = !bCubemap && dwMipMapLevels <= TEXTURE_CACHE_MAX_LEVELS
+                        && pBase != nullptr && (DWORD)pBase != 0x80000000
+                        && pResource->Data != X_D3DRESOURCE_DATA_BACK_BUFFER && (DWORD)pBase != X_D3DRESOURCE_DATA_BACK_BUFFER;
+
+                    if(bCacheTexture)
+                    {
+                        DWORD dwMipWidth = dwWidth, dwMipHeight = dwHeight, dwMipPitch = dwPitch, dwOffset = 0;
+
+                        CacheKey.Format = pPixelContainer->Format;
+                        CacheKey.Size = pPixelContainer->Size;
+                        CacheKey.LevelCount = dwMipMapLevels;
+
+                        // the conversion of palettized textures depends on the current palette
+                        CacheKey.Variant = 0;
+                        if(CacheFormat == D3DFMT_P8 && g_pCurrentPalette[TextureStage] != nullptr)
+                            CacheKey.Variant = XXHash32::hash(g_pCurrentPalette[TextureStage], g_dwCurrentPaletteSize[TextureStage], 0);
+
+                        // determine where each level ends in the Xbox data (as read by the upload below)
+                        for(uint level=0;level<dwMipMapLevels;level++)
+                        {
+                            if(bCompressed)
+                                dwOffset += dwCompressedSize >> (level * 2);
+                            else if(bSwizzled)
+                                dwOffset += dwMipWidth*dwMipHeight*dwBPP;
+                            else
+                                dwOffset += dwMipPitch*dwMipHeight;
+
+                            CacheKey.LevelEnd[level] = dwOffset;
+
+                            dwMipWidth /= 2;
+                            dwMipHeight /= 2;
+                            dwMipPitch /= 2;
+                        }
+
+                        CacheKey.DataSize = dwOffset;
+
+                        // expanded formats take 4 bytes per texel on the host
+                        dwCacheHostSize = (CacheFormat != 0) ? (dwOffset / dwBPP) * 4 : dwOffset;
+
+                        pCachedTexture = EmuTextureCacheLookup(pResource, pBase, &CacheKey, &dwDirtyLevels);
+
+                        if(pCachedTexture != nullptr)
+                        {
+                            DbgPrintf("EmuIDirect3DResource8_Register : Reusing cached Texture (0x%.08X, 0x%.08X, dirty levels 0x%X)\n", pResource, pCachedTexture, dwDirtyLevels);
+
+                            SetHostTexture(pResource, (IDirect3DTexture8 *)pCachedTexture);
+                        }
+                    }
+
                     if(bCubemap)
                     {
                         DbgPrintf("CreateCubeTexture(%d, %d, 0, %d, D3DPOOL_MANAGED)\n", dwWidth,
@@ -4818,7 +5011,7 @@ HRESULT WINAPI XTL::EMUPATCH(D3DResource_Register)
 						SetHostCubeTexture(pResource, pHostCubeTexture);
 						DbgPrintf("EmuIDirect3DResource8_Register : Successfully Created CubeTexture (0x%.08X, 0x%.08X)\n", pResource, pHostCubeTexture);
                     }
-                    else
+                    else if(pCachedTexture == nullptr)
                     {
                     //    printf("CreateTexture(%d, %d, %d, 0, %d (X=0x%.08X), D3DPOOL_MANAGED)\n", dwWidth, dwHeight,
                      //       dwMipMapLevels, PCFormat, X_Format);
@@ -4856,6 +5049,10 @@ HRESULT WINAPI XTL::EMUPATCH(D3DResource_Register)
 							DbgPrintf("EmuIDirect3DResource8_Register : Successfully Created Texture (0x%.08X, 0x%.08X)\n", pResource, pHostTexture);
 
 							SetHostTexture(pResource, pHostTexture);
+
+							// the texture cache keys it on the Xbox data, which is uploaded below
+							if(bCacheTexture)
+								EmuTextureCacheInsert(pResource, pHostTexture, pBase, &CacheKey, dwCacheHostSize);
             }
           }
         }
@@ -4877,6 +5074,23 @@ HRESULT WINAPI XTL::EMUPATCH(D3DResource_Register)
                     {
                         D3DLOCKED_RECT LockedRect;
 
+                        // skip the levels the cached texture already has up to date
+                        if(!(dwDirtyLevels & (1 << level)))
+                        {
+                            if(level == 0)
+                                pResource->Data = (DWORD)pBase;
+
+                            if(bCompressed)
+                                dwCompressedOffset += (dwCompressedSize >> (level * 2));
+
+                            dwMipOffs += dwMipWidth*dwMipHeight*dwBPP;
+
+                            dwMipWidth /= 2;
+                            dwMipHeight /= 2;
+                            dwMipPitch /= 2;
+                            continue;
+                        }
+
                         // copy over data (deswizzle if necessary)
                         if(dwCommonType == X_D3DCOMMON_TYPE_SURFACE)
                             hRet = GetHostSurface(pResource)->LockRect(&LockedRect, NULL, 0);
@@ -5064,7 +5278,6 @@ HRESULT WINAPI XTL::EMUPATCH(D3DResource_Register)
                         dwMipPitch /= 2;
                     }
                 }
-
                 // Debug Texture Dumping
                 #ifdef _DEBUG_DUMP_TEXTURE_REGISTER
                 if(dwCommonType == X_D3DCOMMON_TYPE_SURFACE)
@@ -5253,6 +5466,11 @@ ULONG WINAPI XTL::EMUPATCH(D3DResource_Release)
 				g_RegisteredResources.erase(it);
 			}
 
+			// Once the last reference is gone, the texture cache may release the host texture
+			if ((pThis->Common & X_D3DCOMMON_REFCOUNT_MASK) == 1) {
+				EmuTextureCacheRelease(pThis);
+			}
+
             #ifdef _DEBUG_TRACE_VB
             D3DRESOURCETYPE Type = pResource8->GetType();
             #endif
@@ -5644,6 +5862,10 @@ HRESULT WINAPI XTL::EMUPATCH(D3DSurface_LockRect)
 			}
 			else
 			{
+				// Writes go to the host texture, so it no longer matches the Xbox data it's cached under
+				if (!(Flags & X_D3DLOCK_READONLY))
+					EmuTextureCacheDetach(pHostTexture);
+
 				// Remove old lock(s)
 				pHostTexture->UnlockRect(0);
 				hRet = pHostTexture->LockRect(0, pLockedRect, pRect, Flags);
@@ -5749,6 +5971,9 @@ XTL::X_D3DSurface * WINAPI XTL::EMUPATCH(D3DTexture_GetSurfaceLevel2)
 
 			IDirect3DTexture8 *pHostTexture = GetHostTexture(pThis);
 
+			// The surface can be locked or rendered to, which the texture cache can't keep track of
+			EmuTextureCacheDetach(pHostTexture);
+
 			IDirect3DSurface8 *pHostSurface = nullptr;
 			HRESULT hRet = pHostTexture->GetSurfaceLevel(Level, &pHostSurface);
 
@@ -5829,6 +6054,10 @@ HRESULT WINAPI XTL::EMUPATCH(D3DTexture_LockRect)
             CxbxKrnlCleanup("EmuIDirect3DTexture8_LockRect: Unknown Flags! (0x%.08X)", Flags);
 
 		if (pHostTexture != nullptr) {
+			// Writes go to the host texture, so it no longer matches the Xbox data it's cached under
+			if (!(NewFlags & D3DLOCK_READONLY))
+				EmuTextureCacheDetach(pHostTexture);
+
 			pHostTexture->UnlockRect(Level);
 			hRet = pHostTexture->LockRect(Level, pLockedRect, pRect, NewFlags);
 		}
@@ -6341,7 +6570,7 @@ VOID WINAPI XTL::EMUPATCH(D3DDevice_SetTextureState_TexCoordIndex)
     if(Value >= 0x00040000)
         CxbxKrnlCleanup("EmuD3DDevice_SetTextureState_TexCoordIndex: Unknown TexCoordIndex Value (0x%.08X)", Value);
 
-    g_pD3DDevice8->SetTextureStageState(Stage, D3DTSS_TEXCOORDINDEX, Value);
+    EmuSetTextureStageState(Stage, D3DTSS_TEXCOORDINDEX, Value);
 }
 
 // ******************************************************************
@@ -6401,7 +6630,7 @@ VOID WINAPI XTL::EMUPATCH(D3DDevice_SetTextureState_BorderColor)
            ");\n",
            Stage, Value);
 
-    g_pD3DDevice8->SetTextureStageState(Stage, D3DTSS_BORDERCOLOR, Value);
+    EmuSetTextureStageState(Stage, D3DTSS_BORDERCOLOR, Value);
 }
 
 // ******************************************************************
@@ -6446,19 +6675,19 @@ VOID WINAPI XTL::EMUPATCH(D3DDevice_SetTextureState_BumpEnv)
     switch(Type)
     {
         case 22:    // X_D3DTSS_BUMPENVMAT00
-            g_pD3DDevice8->SetTextureStageState(Stage, D3DTSS_BUMPENVMAT00, Value);
+            EmuSetTextureStageState(Stage, D3DTSS_BUMPENVMAT00, Value);
             break;
         case 23:    // X_D3DTSS_BUMPENVMAT01
-            g_pD3DDevice8->SetTextureStageState(Stage, D3DTSS_BUMPENVMAT01, Value);
+            EmuSetTextureStageState(Stage, D3DTSS_BUMPENVMAT01, Value);
             break;
         case 24:    // X_D3DTSS_BUMPENVMAT11
-            g_pD3DDevice8->SetTextureStageState(Stage, D3DTSS_BUMPENVMAT11, Value);
+            EmuSetTextureStageState(Stage, D3DTSS_BUMPENVMAT11, Value);
             break;
         case 25:    // X_D3DTSS_BUMPENVMAT10
-            g_pD3DDevice8->SetTextureStageState(Stage, D3DTSS_BUMPENVMAT10, Value);
+            EmuSetTextureStageState(Stage, D3DTSS_BUMPENVMAT10, Value);
             break;
         case 26:    // X_D3DTSS_BUMPENVLSCALE
-            g_pD3DDevice8->SetTextureStageState(Stage, D3DTSS_BUMPENVLSCALE, Value);
+            EmuSetTextureStageState(Stage, D3DTSS_BUMPENVLSCALE, Value);
             break;
     }
 }
@@ -6505,7 +6734,7 @@ VOID WINAPI XTL::EMUPATCH(D3DDevice_SetRenderState_NormalizeNormals)
 
 	LOG_FUNC_ONE_ARG(Value);
 
-    g_pD3DDevice8->SetRenderState(D3DRS_NORMALIZENORMALS, Value);
+    EmuSetRenderState(D3DRS_NORMALIZENORMALS, Value);
 }
 
 // ******************************************************************
@@ -6520,7 +6749,7 @@ VOID WINAPI XTL::EMUPATCH(D3DDevice_SetRenderState_TextureFactor)
 
 	LOG_FUNC_ONE_ARG(Value);
 
-    g_pD3DDevice8->SetRenderState(D3DRS_TEXTUREFACTOR, Value);
+    EmuSetRenderState(D3DRS_TEXTUREFACTOR, Value);
 }
 
 // ******************************************************************
@@ -6535,7 +6764,7 @@ VOID WINAPI XTL::EMUPATCH(D3DDevice_SetRenderState_ZBias)
 
 	LOG_FUNC_ONE_ARG(Value);
 
-    g_pD3DDevice8->SetRenderState(D3DRS_ZBIAS, Value);
+    EmuSetRenderState(D3DRS_ZBIAS, Value);
 }
 
 // ******************************************************************
@@ -6551,7 +6780,7 @@ VOID WINAPI XTL::EMUPATCH(D3DDevice_SetRenderState_EdgeAntiAlias)
 	LOG_FUNC_ONE_ARG(Value);
 
 //  TODO: Analyze performance and compatibility (undefined behavior on PC with triangles or points)
-//  g_pD3DDevice8->SetRenderState(D3DRS_EDGEANTIALIAS, Value);
+//  EmuSetRenderState(D3DRS_EDGEANTIALIAS, Value);
 
     LOG_UNIMPLEMENTED();	
 }
@@ -6577,7 +6806,7 @@ VOID WINAPI XTL::EMUPATCH(D3DDevice_SetRenderState_FillMode)
     else
         dwFillMode = D3DFILL_POINT;
 
-    g_pD3DDevice8->SetRenderState(D3DRS_FILLMODE, dwFillMode);
+    EmuSetRenderState(D3DRS_FILLMODE, dwFillMode);
 }
 
 // ******************************************************************
@@ -6592,7 +6821,7 @@ VOID WINAPI XTL::EMUPATCH(D3DDevice_SetRenderState_FogColor)
 
 	LOG_FUNC_ONE_ARG(Value);
 
-    g_pD3DDevice8->SetRenderState(D3DRS_FOGCOLOR, Value);
+    EmuSetRenderState(D3DRS_FOGCOLOR, Value);
 }
 
 // ******************************************************************
@@ -6748,7 +6977,7 @@ VOID __fastcall XTL::EMUPATCH(D3DDevice_SetRenderState_Simple)
         };
 
         // TODO: verify these params as you add support for them!
-        g_pD3DDevice8->SetRenderState((D3DRENDERSTATETYPE)State, Value);
+        EmuSetRenderState((D3DRENDERSTATETYPE)State, Value);
     }
 }
 
@@ -6774,7 +7003,7 @@ VOID WINAPI XTL::EMUPATCH(D3DDevice_SetRenderState_VertexBlend)
     else
         CxbxKrnlCleanup("Unsupported D3DVERTEXBLENDFLAGS (%d)", Value);
 
-    g_pD3DDevice8->SetRenderState(D3DRS_VERTEXBLEND, Value);
+    EmuSetRenderState(D3DRS_VERTEXBLEND, Value);
 }
 
 // ******************************************************************
@@ -6823,7 +7052,7 @@ VOID WINAPI XTL::EMUPATCH(D3DDevice_SetRenderState_CullMode)
             CxbxKrnlCleanup("EmuD3DDevice_SetRenderState_CullMode: Unknown Cullmode (%d)", Value);
     }
 
-    g_pD3DDevice8->SetRenderState(D3DRS_CULLMODE, Value);
+    EmuSetRenderState(D3DRS_CULLMODE, Value);
 }
 
 // ******************************************************************
@@ -6839,7 +7068,7 @@ VOID WINAPI XTL::EMUPATCH(D3DDevice_SetRenderState_LineWidth)
 	LOG_FUNC_ONE_ARG(Value);
 
     // TODO: Convert to PC format??
-//    g_pD3DDevice8->SetRenderState(D3DRS_LINEPATTERN, Value);
+//    EmuSetRenderState(D3DRS_LINEPATTERN, Value);
 	LOG_NOT_SUPPORTED();
 }
 
@@ -6855,7 +7084,7 @@ VOID WINAPI XTL::EMUPATCH(D3DDevice_SetRenderState_StencilFail)
 
 	LOG_FUNC_ONE_ARG(Value);
 
-    g_pD3DDevice8->SetRenderState(D3DRS_STENCILFAIL, Value);
+    EmuSetRenderState(D3DRS_STENCILFAIL, Value);
 }
 
 // ******************************************************************
@@ -6945,7 +7174,7 @@ VOID WINAPI XTL::EMUPATCH(D3DDevice_SetRenderState_ZEnable)
 
 	LOG_FUNC_ONE_ARG(Value);
 
-	g_pD3DDevice8->SetRenderState(D3DRS_ZENABLE, Value);
+	EmuSetRenderState(D3DRS_ZENABLE, Value);
 }
 
 // ******************************************************************
@@ -6960,7 +7189,7 @@ VOID WINAPI XTL::EMUPATCH(D3DDevice_SetRenderState_StencilEnable)
 
 	LOG_FUNC_ONE_ARG(Value);
 
-    g_pD3DDevice8->SetRenderState(D3DRS_STENCILENABLE, Value);
+    EmuSetRenderState(D3DRS_STENCILENABLE, Value);
 }
 
 // ******************************************************************
@@ -6975,7 +7204,7 @@ VOID WINAPI XTL::EMUPATCH(D3DDevice_SetRenderState_MultiSampleAntiAlias)
 
 	LOG_FUNC_ONE_ARG(Value);
 
-    g_pD3DDevice8->SetRenderState(D3DRS_MULTISAMPLEANTIALIAS, Value);
+    EmuSetRenderState(D3DRS_MULTISAMPLEANTIALIAS, Value);
 }
 
 // ******************************************************************
@@ -6990,7 +7219,7 @@ VOID WINAPI XTL::EMUPATCH(D3DDevice_SetRenderState_MultiSampleMask)
 
 	LOG_FUNC_ONE_ARG(Value);
 
-    g_pD3DDevice8->SetRenderState(D3DRS_MULTISAMPLEMASK, Value);
+    EmuSetRenderState(D3DRS_MULTISAMPLEMASK, Value);
 }
 
 // ******************************************************************
@@ -7596,7 +7825,9 @@ VOID WINAPI XTL::EMUPATCH(D3DDevice_DrawIndexedVertices)
 
 	// Dxbx Note : In DrawVertices and DrawIndexedVertices, PrimitiveType may not be D3DPT_POLYGON
 	CxbxUpdateNativeD3DResources();
-	CxbxUpdateActiveIndexBuffer(pIndexData, VertexCount);
+
+	UINT uiMinIndex, uiNumVertices;
+	CxbxUpdateActiveIndexBuffer(pIndexData, VertexCount, &uiMinIndex, &uiNumVertices);
 
     VertexPatchDesc VPDesc;
 
@@ -7612,7 +7843,6 @@ VOID WINAPI XTL::EMUPATCH(D3DDevice_DrawIndexedVertices)
     VertPatch.Apply(&VPDesc, &FatalError);
 
 	UINT uiStartIndex = 0;
-	UINT uiNumVertices = VertexCount;
 
     if(IsValidCurrentShader() && !FatalError)
     {
@@ -7631,8 +7861,8 @@ VOID WINAPI XTL::EMUPATCH(D3DDevice_DrawIndexedVertices)
 				(
 					D3DPT_TRIANGLEFAN, // Draw a triangle-fan instead of a quad
 					//{ $IFDEF DXBX_USE_D3D9 } {BaseVertexIndex = }0, { $ENDIF }
-					/* MinVertexIndex = */0,
-					/* NumVertices = */VERTICES_PER_QUAD, // Use all 4 vertices of 1 quad
+					/* MinVertexIndex = */uiMinIndex,
+					/* NumVertices = */uiNumVertices, // The range of vertices the indices refer to
 					uiStartIndex,
 					/* primCount = */TRIANGLES_PER_QUAD // Draw 2 triangles with that
 				);
@@ -7646,9 +7876,9 @@ VOID WINAPI XTL::EMUPATCH(D3DDevice_DrawIndexedVertices)
 			// Other primitives than X_D3DPT_QUADLIST can be drawn normally :
 			g_pD3DDevice8->DrawIndexedPrimitive(
 				EmuXB2PC_D3DPrimitiveType(VPDesc.PrimitiveType),
-				/* MinVertexIndex = */0,
-				/* NumVertices = */uiNumVertices, // TODO : g_EmuD3DActiveStreamSizes[0], // Note : ATI drivers are especially picky about this -
-				// NumVertices should be the span of covered vertices in the active vertex buffer (TODO : Is stream 0 correct?)
+				/* MinVertexIndex = */uiMinIndex,
+				/* NumVertices = */uiNumVertices, // Note : ATI drivers are especially picky about this -
+				// NumVertices should be the span of covered vertices in the active vertex buffer
 				uiStartIndex,
 				VPDesc.dwPrimitiveCount);
 /*
@@ -7716,7 +7946,6 @@ VOID WINAPI XTL::EMUPATCH(D3DDevice_DrawIndexedVerticesUP)
         CxbxKrnlCleanup("g_pIndexBuffer != 0");
 
 	CxbxUpdateNativeD3DResources();
-	CxbxUpdateActiveIndexBuffer((PWORD)pIndexData, VertexCount);
 
     if( (PrimitiveType == X_D3DPT_LINELOOP) || (PrimitiveType == X_D3DPT_QUADLIST) )
         EmuWarning("Unsupported PrimitiveType! (%d)", (DWORD)PrimitiveType);
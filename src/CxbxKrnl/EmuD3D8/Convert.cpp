@@ -586,79 +586,7 @@ void XTL::EmuUnswizzleRect
 	DWORD dwBPP // expressed in Bytes Per Pixel
 ) // Source : Dxbx
 {
-	// TODO : The following could be done using a lookup table :
-	DWORD dwMaskX = 0, dwMaskY = 0, dwMaskZ = 0;
-	for (uint i=1, j=1; (i <= dwWidth) || (i <= dwHeight) || (i <= dwDepth); i <<= 1) {
-		if (i < dwWidth) {
-			dwMaskX = dwMaskX | j;
-			j <<= 1;
-		};
-
-		if (i < dwHeight) {
-			dwMaskY = dwMaskY | j;
-			j <<= 1;
-		}
-
-		if (i < dwDepth) {
-			dwMaskZ = dwMaskZ | j;
-			j <<= 1;
-		}
-	}
-
-	// get the biggest mask
-	DWORD dwMaskMax;
-	if (dwMaskX > dwMaskY)
-		dwMaskMax = dwMaskX;
-	else
-		dwMaskMax = dwMaskY;
-
-	if (dwMaskZ > dwMaskMax)
-		dwMaskMax = dwMaskZ;
-
-	DWORD dwStartX = 0, dwOffsetX = 0;
-	DWORD dwStartY = 0, dwOffsetY = 0;
-	DWORD dwStartZ = 0, dwOffsetW = 0;
-	/* TODO : Use values from poDst and rSrc to initialize above values, after which the following makes more sense:
-	for (uint i=1; i <= dwMaskMax; i <<= 1) {
-		if (i <= dwMaskX) {
-			if (dwMaskX & i)
-				dwStartX |= (dwOffsetX & i);
-			else
-				dwOffsetX <<= 1;
-		}
-
-		if (i <= dwMaskY) {
-			if (dwMaskY & i)
-				dwStartY |= dwOffsetY & i;
-			else
-				dwOffsetY <<= 1;
-		}
-
-		if (i <= dwMaskZ) {
-			if (dwMaskZ & i)
-				dwStartZ |= dwOffsetZ & i;
-			else
-				dwOffsetZ <<= 1;
-		}
-	}*/
-
-	DWORD dwZ = dwStartZ;
-	for (uint z = 0; z < dwDepth; z++) {
-		DWORD dwY = dwStartY;
-		for (uint y = 0; y < dwHeight; y++) {
-			DWORD dwX = dwStartX;
-			for (uint x = 0; x < dwWidth; x++) {
-				int delta = ((dwX | dwY | dwZ) * dwBPP);
-				memcpy(pDstBuff, (PBYTE)pSrcBuff + delta, dwBPP); // copy one pixel
-				pDstBuff = (PBYTE)pDstBuff + dwBPP; // Step to next pixel in destination
-				dwX = (dwX - dwMaskX) & dwMaskX; // step to next pixel in source
-			}
-
-			pDstBuff = (PBYTE)pDstBuff + dwPitch - (dwWidth * dwBPP); // step to next line in destination
-			dwY = (dwY - dwMaskY) & dwMaskY; // step to next line in source
-		}
-
-		// TODO : How to step to next level in destination? Should X and Y be recalculated per level?
-		dwZ = (dwZ - dwMaskZ) & dwMaskZ; // step to next level in source
-	}
+	// Slices follow each other directly in the destination :
+	EmuUnswizzleBox(pSrcBuff, dwWidth, dwHeight, dwDepth, 0, 0, 0,
+		pDstBuff, dwPitch, dwPitch * dwHeight, dwWidth, dwHeight, dwDepth, dwBPP);
 } // EmuUnswizzleRect NOPATCH
@@ -202,6 +202,26 @@ BOOL bV1R0Reg = FALSE;
 
 HRESULT XTL::CreatePixelShaderFunction(X_D3DPIXELSHADERDEF *pPSD, LPD3DXBUFFER* ppRecompiled)
 {
+	// Reuse an earlier translation of this definition, if there is one. A cached
+	// translation consists of the result, followed by the assembled shader (if any)
+	const void *pTranslation;
+	DWORD dwTranslationSize;
+	if (EmuShaderCacheLookup(SHADER_CACHE_PIXEL_SHADER, 0, pPSD, sizeof(X_D3DPIXELSHADERDEF), &pTranslation, &dwTranslationSize))
+	{
+		HRESULT hRet = *(const HRESULT *)pTranslation;
+		DWORD dwAssembledSize = dwTranslationSize - sizeof(HRESULT);
+
+		*ppRecompiled = NULL;
+		if (SUCCEEDED(hRet))
+		{
+			hRet = D3DXCreateBuffer(dwAssembledSize, ppRecompiled);
+			if (SUCCEEDED(hRet))
+				memcpy((*ppRecompiled)->GetBufferPointer(), (const HRESULT *)pTranslation + 1, dwAssembledSize);
+		}
+
+		return hRet;
+	}
+
 	char szCode[9000] = {0};
 
 	pCodeBuffer = szCode;
@@ -821,6 +841,22 @@ HRESULT XTL::CreatePixelShaderFunction(X_D3DPIXELSHADERDEF *pPSD, LPD3DXBUFFER*
 		pCompilationErrors->Release();
 	}
 
+	// Remember the outcome (Azurik for one, recreates the same pixel shaders every frame)
+	if (FAILED(hRet))
+	{
+		EmuShaderCacheInsert(SHADER_CACHE_PIXEL_SHADER, 0, pPSD, sizeof(X_D3DPIXELSHADERDEF), &hRet, sizeof(HRESULT));
+	}
+	else if (*ppRecompiled != NULL)
+	{
+		DWORD dwAssembledSize = (*ppRecompiled)->GetBufferSize();
+		BYTE *pCached = (BYTE *)malloc(sizeof(HRESULT) + dwAssembledSize);
+
+		*(HRESULT *)pCached = hRet;
+		memcpy(pCached + sizeof(HRESULT), (*ppRecompiled)->GetBufferPointer(), dwAssembledSize);
+		EmuShaderCacheInsert(SHADER_CACHE_PIXEL_SHADER, 0, pPSD, sizeof(X_D3DPIXELSHADERDEF), pCached, sizeof(HRESULT) + dwAssembledSize);
+		free(pCached);
+	}
+
 	return hRet;
 }
 
@@ -41,6 +41,10 @@
 #include "CxbxKrnl/EmuD3D8Types.h" // For X_D3DFORMAT
 #include "CxbxKrnl/ResourceTracker.h"
 #include "CxbxKrnl/MemoryManager.h"
+#include "Common/PushBufferDecoder.h"
+#include "Common/Win32/Mutex.h"
+
+#include <vector>
 
 uint32  XTL::g_dwPrimaryPBCount = 0;
 uint32 *XTL::g_pPrimaryPB = 0;
@@ -53,6 +57,218 @@ bool g_bPBSkipPusher = false;
 
 static void DbgDumpMesh(WORD *pIndexData, DWORD dwCount);
 
+// inline vertex batches are merged into a single draw for as long as they
+// share their vertex shader, stride and (list) primitive type
+#define PUSHBUFFER_BATCH_MAX_VERTICES 0xFFFF
+#define PUSHBUFFER_REPORT_INTERVAL    600
+
+struct PushBufferBatch
+{
+    DWORD                   dwVertexShader;
+    DWORD                   dwStride;
+    XTL::X_D3DPRIMITIVETYPE XBPrimitiveType;
+    XTL::D3DPRIMITIVETYPE   PCPrimitiveType;
+    PVOID                   pVertexData;    // vertices of the first batch, still in the push buffer
+    UINT                    VertexCount;
+    UINT                    BatchCount;
+};
+
+static PushBufferBatch g_PendingBatch = { 0 };
+
+// merged vertices, once a second batch joins the pending one
+static std::vector<BYTE> g_BatchVertexData;
+
+// push buffer capture, see EmuStartPushBufferCapture
+//
+// Captures are started and stopped from the debug console thread while the
+// render thread records into them, so the recorder is only used with the lock
+// held. The render thread peeks at the pointer first, to keep the lock out of
+// the common (not capturing) path.
+static PushBufferRecorder * volatile g_pPushBufferRecorder = NULL;
+static Mutex g_PushBufferCaptureLock;
+
+static DWORD g_dwPushBufferFrame = 0;
+static DWORD g_dwBatchesIn = 0;
+static DWORD g_dwDrawsOut = 0;
+
+// number of vertices per primitive for list types, 0 for types that can't be merged
+static UINT BatchVerticesPerPrimitive(XTL::X_D3DPRIMITIVETYPE PrimitiveType)
+{
+    switch(PrimitiveType)
+    {
+        case XTL::X_D3DPT_POINTLIST:    return 1;
+        case XTL::X_D3DPT_LINELIST:     return 2;
+        case XTL::X_D3DPT_TRIANGLELIST: return 3;
+        case XTL::X_D3DPT_QUADLIST:     return 4;
+    }
+
+    return 0;
+}
+
+static void FlushBatch()
+{
+    using namespace XTL;
+
+    if(g_PendingBatch.BatchCount == 0)
+        return;
+
+    VertexPatchDesc VPDesc;
+
+    VPDesc.dwVertexCount = g_PendingBatch.VertexCount;
+    VPDesc.PrimitiveType = g_PendingBatch.XBPrimitiveType;
+    VPDesc.dwPrimitiveCount = EmuD3DVertex2PrimitiveCount(g_PendingBatch.XBPrimitiveType, g_PendingBatch.VertexCount);
+    VPDesc.dwOffset = 0;
+    VPDesc.pVertexStreamZeroData = (g_PendingBatch.BatchCount > 1) ? &g_BatchVertexData[0] : g_PendingBatch.pVertexData;
+    VPDesc.uiVertexStreamZeroStride = g_PendingBatch.dwStride;
+    VPDesc.hVertexShader = g_PendingBatch.dwVertexShader;
+
+    VertexPatcher VertPatch;
+
+    bool bPatched = VertPatch.Apply(&VPDesc, NULL);
+
+    g_pD3DDevice8->DrawPrimitiveUP
+    (
+        g_PendingBatch.PCPrimitiveType,
+        VPDesc.dwPrimitiveCount,
+        VPDesc.pVertexStreamZeroData,
+        VPDesc.uiVertexStreamZeroStride
+    );
+
+    g_dwPrimPerFrame += VPDesc.dwPrimitiveCount;
+
+    VertPatch.Restore();
+
+    g_dwDrawsOut++;
+    g_PendingBatch.BatchCount = 0;
+}
+
+static void AddBatch
+(
+    DWORD                   dwVertexShader,
+    DWORD                   dwStride,
+    XTL::X_D3DPRIMITIVETYPE XBPrimitiveType,
+    XTL::D3DPRIMITIVETYPE   PCPrimitiveType,
+    PVOID                   pVertexData,
+    UINT                    VertexCount
+)
+{
+    g_dwBatchesIn++;
+
+    UINT VerticesPerPrimitive = BatchVerticesPerPrimitive(XBPrimitiveType);
+    bool bMergeable = (VerticesPerPrimitive != 0) && (VertexCount % VerticesPerPrimitive == 0);
+
+    if(g_PendingBatch.BatchCount > 0)
+    {
+        if(bMergeable
+         && g_PendingBatch.dwVertexShader == dwVertexShader
+         && g_PendingBatch.dwStride == dwStride
+         && g_PendingBatch.XBPrimitiveType == XBPrimitiveType
+         && g_PendingBatch.VertexCount + VertexCount <= PUSHBUFFER_BATCH_MAX_VERTICES)
+        {
+            // start merging by copying the pending batch out of the push buffer
+            if(g_PendingBatch.BatchCount == 1)
+            {
+                BYTE *pFirst = (BYTE*)g_PendingBatch.pVertexData;
+
+                g_BatchVertexData.assign(pFirst, pFirst + g_PendingBatch.VertexCount * dwStride);
+            }
+
+            BYTE *pNext = (BYTE*)pVertexData;
+
+            g_BatchVertexData.insert(g_BatchVertexData.end(), pNext, pNext + VertexCount * dwStride);
+
+            g_PendingBatch.VertexCount += VertexCount;
+            g_PendingBatch.BatchCount++;
+
+            return;
+        }
+
+        FlushBatch();
+    }
+
+    g_PendingBatch.dwVertexShader = dwVertexShader;
+    g_PendingBatch.dwStride = dwStride;
+    g_PendingBatch.XBPrimitiveType = XBPrimitiveType;
+    g_PendingBatch.PCPrimitiveType = PCPrimitiveType;
+    g_PendingBatch.pVertexData = pVertexData;
+    g_PendingBatch.VertexCount = VertexCount;
+    g_PendingBatch.BatchCount = 1;
+
+    // strips and fans can't be appended to, so draw those right away
+    if(!bMergeable)
+        FlushBatch();
+}
+
+void XTL::EmuPushBufferEndFrame()
+{
+    g_dwPushBufferFrame++;
+
+    if(g_pPushBufferRecorder != NULL)
+    {
+        g_PushBufferCaptureLock.Lock();
+
+        if(g_pPushBufferRecorder != NULL)
+            g_pPushBufferRecorder->RecordFrame();
+
+        g_PushBufferCaptureLock.Unlock();
+    }
+
+    if(g_dwPushBufferFrame % PUSHBUFFER_REPORT_INTERVAL == 0 && g_dwBatchesIn > 0)
+    {
+        DbgPrintf("PushBuffer: %d inline vertex batches drawn with %d draws last frame\n",
+            g_dwBatchesIn, g_dwDrawsOut);
+    }
+
+    g_dwBatchesIn = 0;
+    g_dwDrawsOut = 0;
+}
+
+bool XTL::EmuStartPushBufferCapture(const char *szFileName)
+{
+    EmuStopPushBufferCapture();
+
+    PushBufferRecorder *pRecorder = new PushBufferRecorder(szFileName);
+
+    if(pRecorder->HasFatalError())
+    {
+        EmuWarning("Push buffer capture failed : %s", pRecorder->GetError().c_str());
+        delete pRecorder;
+        return false;
+    }
+
+    g_PushBufferCaptureLock.Lock();
+
+    // another capture may have been started in the meantime
+    PushBufferRecorder *pPrevious = g_pPushBufferRecorder;
+
+    g_pPushBufferRecorder = pRecorder;
+
+    g_PushBufferCaptureLock.Unlock();
+
+    delete pPrevious;
+
+    return true;
+}
+
+void XTL::EmuStopPushBufferCapture()
+{
+    g_PushBufferCaptureLock.Lock();
+
+    PushBufferRecorder *pRecorder = g_pPushBufferRecorder;
+
+    g_pPushBufferRecorder = NULL;
+
+    g_PushBufferCaptureLock.Unlock();
+
+    // the render thread can no longer reach the recorder, so it's safe to close
+    if(pRecorder == NULL)
+        return;
+
+    DbgPrintf("PushBuffer: Captured %d frames\n", pRecorder->GetFrameCount());
+
+    delete pRecorder;
+}
+
 void XTL::EmuExecutePushBuffer
 (
     X_D3DPushBuffer       *pPushBuffer,
@@ -66,6 +282,22 @@ void XTL::EmuExecutePushBuffer
 	DbgDumpPushBuffer((DWORD*)pPushBuffer->Data, pPushBuffer->Size);
 #endif
 
+    // only the push buffer itself is captured, see PushBufferRecorder
+    if(g_pPushBufferRecorder != NULL)
+    {
+        uint32_t dwAddress = (uint32_t)pPushBuffer->Data;
+
+        g_PushBufferCaptureLock.Lock();
+
+        if(g_pPushBufferRecorder != NULL)
+        {
+            g_pPushBufferRecorder->RecordMemory(dwAddress, (PVOID)pPushBuffer->Data, pPushBuffer->Size);
+            g_pPushBufferRecorder->RecordDecode(dwAddress, dwAddress + pPushBuffer->Size);
+        }
+
+        g_PushBufferCaptureLock.Unlock();
+    }
+
     EmuExecutePushBufferRaw((DWORD*)pPushBuffer->Data);
 
     return;
@@ -261,37 +493,12 @@ extern void XTL::EmuExecutePushBufferRaw
             }
             #endif
 
-            // render vertices
+            // render vertices (possibly together with the following batches)
             if(dwVertexShader != -1)
             {
                 UINT VertexCount = (dwCount*sizeof(DWORD)) / dwStride;
-                UINT PrimitiveCount = EmuD3DVertex2PrimitiveCount(XBPrimitiveType, VertexCount);
-
-                VertexPatchDesc VPDesc;
-
-                VPDesc.dwVertexCount = VertexCount;
-                VPDesc.PrimitiveType = XBPrimitiveType;
-                VPDesc.dwPrimitiveCount = PrimitiveCount;
-                VPDesc.dwOffset = 0;
-                VPDesc.pVertexStreamZeroData = pVertexData;
-                VPDesc.uiVertexStreamZeroStride = dwStride;
-                VPDesc.hVertexShader = dwVertexShader;
-
-                VertexPatcher VertPatch;
-
-                bool bPatched = VertPatch.Apply(&VPDesc, NULL);
 
-                g_pD3DDevice8->DrawPrimitiveUP
-                (
-                    PCPrimitiveType,
-                    VPDesc.dwPrimitiveCount,
-                    VPDesc.pVertexStreamZeroData,
-                    VPDesc.uiVertexStreamZeroStride
-                );
-
-				g_dwPrimPerFrame += VPDesc.dwPrimitiveCount;
-
-                VertPatch.Restore();
+                AddBatch(dwVertexShader, dwStride, XBPrimitiveType, PCPrimitiveType, pVertexData, VertexCount);
             }
 
             pdwPushData--;
@@ -319,6 +526,9 @@ extern void XTL::EmuExecutePushBufferRaw
             }
             #endif
 
+            // indexed draws use other vertices, so draw what's pending first
+            FlushBatch();
+
             WORD *pwVal = (WORD*)(pdwPushData + 1);
             for(uint mi=0;mi<dwCount;mi++)
             {
@@ -421,6 +631,9 @@ extern void XTL::EmuExecutePushBufferRaw
                 dwCount = ((*pdwPushData - (0x40000000 | 0x00001818)) >> 18)*2 + 2;
             }
 
+            // indexed draws use other vertices, so draw what's pending first
+            FlushBatch();
+
             pIndexData = ++pdwPushData;
 
             #ifdef _DEBUG_TRACK_PB
@@ -582,6 +795,9 @@ extern void XTL::EmuExecutePushBufferRaw
         pdwPushData++;
     }
 
+    // the push buffer data is only valid during this call
+    FlushBatch();
+
     #ifdef _DEBUG_TRACK_PB
     if(bShowPB)
     {
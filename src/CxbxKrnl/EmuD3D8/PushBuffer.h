@@ -45,6 +45,13 @@ extern void EmuExecutePushBufferRaw
     DWORD                 *pdwPushData
 );
 
+// report (and reset) the per frame batching counters
+extern void EmuPushBufferEndFrame();
+
+// capture all executed push buffers to a file, for PushBufferReplayer
+extern bool EmuStartPushBufferCapture(const char *szFileName);
+extern void EmuStopPushBufferCapture();
+
 extern void DbgDumpPushBuffer
 ( 
 	DWORD*				  PBData, 
@@ -0,0 +1,359 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Win32->CxbxKrnl->EmuD3D8->ShaderCache.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#define _CXBXKRNL_INTERNAL
+#define _XBOXKRNL_DEFEXTRN_
+
+#include "CxbxKrnl/Emu.h"
+#include "CxbxKrnl/EmuXTL.h"
+#include "CxbxKrnl/CxbxKrnl.h"
+#include "CxbxKrnl/xxhash32.h"
+#include "Common/Win32/Mutex.h"
+
+#include <shlobj.h>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Marks a shader cache file ('CXSC' when viewed as bytes)
+#define SHADER_CACHE_MAGIC 0x43535843
+
+// Increment this whenever the layout of the file, or of any translation, changes
+#define SHADER_CACHE_FORMAT_VERSION 1
+
+#pragma pack(push, 1)
+
+struct ShaderCacheFileHeader
+{
+	uint32_t Magic;           // SHADER_CACHE_MAGIC
+	uint32_t FormatVersion;   // SHADER_CACHE_FORMAT_VERSION
+	uint32_t BuildStamp;      // link time stamp of the Cxbx build that made the translations
+};
+
+// The file header is followed by any number of these, each followed by the
+// source and then the translation. Records are only ever appended.
+struct ShaderCacheRecord
+{
+	uint32_t Kind;            // SHADER_CACHE_KIND
+	uint32_t Variant;
+	uint32_t SourceSize;
+	uint32_t TranslationSize;
+};
+
+#pragma pack(pop)
+
+struct ShaderCacheEntry
+{
+	DWORD Kind;
+	DWORD Variant;
+	std::vector<uint08> Source;
+	std::vector<uint08> Translation;
+};
+
+static const char *ShaderCacheKindNames[XTL::SHADER_CACHE_KIND_COUNT] =
+{
+	"vertex shader declarations",
+	"vertex shader functions",
+	"pixel shaders",
+};
+
+class ShaderCache : public Mutex
+{
+	public:
+		ShaderCache();
+		~ShaderCache();
+
+		bool Lookup(DWORD Kind, DWORD Variant, const void *pSource, DWORD SourceSize, const void **ppTranslation, DWORD *pTranslationSize);
+		void Insert(DWORD Kind, DWORD Variant, const void *pSource, DWORD SourceSize, const void *pTranslation, DWORD TranslationSize);
+
+	private:
+		void Open();
+		bool Load(const std::string &FileName);
+		bool Append(const ShaderCacheEntry &Entry);
+		ShaderCacheEntry *Find(uint32_t Hash, DWORD Kind, DWORD Variant, const void *pSource, DWORD SourceSize);
+
+		static uint32_t Hash(DWORD Kind, DWORD Variant, const void *pSource, DWORD SourceSize);
+		static uint32_t GetBuildStamp();
+
+		bool  m_bOpened;
+		FILE *m_pFile;
+		std::unordered_multimap<uint32_t, ShaderCacheEntry> m_Entries;
+		DWORD m_Hits[XTL::SHADER_CACHE_KIND_COUNT];
+		DWORD m_Misses[XTL::SHADER_CACHE_KIND_COUNT];
+};
+
+static ShaderCache g_ShaderCache;
+
+ShaderCache::ShaderCache() : m_bOpened(false), m_pFile(NULL)
+{
+	memset(m_Hits, 0, sizeof(m_Hits));
+	memset(m_Misses, 0, sizeof(m_Misses));
+}
+
+ShaderCache::~ShaderCache()
+{
+	if (m_pFile != NULL)
+		fclose(m_pFile);
+}
+
+uint32_t ShaderCache::Hash(DWORD Kind, DWORD Variant, const void *pSource, DWORD SourceSize)
+{
+	return XXHash32::hash(pSource, SourceSize, (Kind << 24) ^ Variant);
+}
+
+uint32_t ShaderCache::GetBuildStamp()
+{
+	// Any change to a shader translator changes the link time stamp of our executable
+	PIMAGE_DOS_HEADER pDosHeader = (PIMAGE_DOS_HEADER)GetModuleHandle(NULL);
+	PIMAGE_NT_HEADERS pNtHeaders = (PIMAGE_NT_HEADERS)((uint08 *)pDosHeader + pDosHeader->e_lfanew);
+
+	return pNtHeaders->FileHeader.TimeDateStamp;
+}
+
+ShaderCacheEntry *ShaderCache::Find(uint32_t Hash, DWORD Kind, DWORD Variant, const void *pSource, DWORD SourceSize)
+{
+	auto range = m_Entries.equal_range(Hash);
+	for (auto it = range.first; it != range.second; ++it) {
+		ShaderCacheEntry &Entry = it->second;
+
+		// Compare the complete source, so that hash collisions can't return a wrong translation
+		if (Entry.Kind == Kind && Entry.Variant == Variant && Entry.Source.size() == SourceSize
+			&& memcmp(Entry.Source.data(), pSource, SourceSize) == 0) {
+			return &Entry;
+		}
+	}
+
+	return nullptr;
+}
+
+// Reads all records from the given file, returns true when the file can be appended to
+bool ShaderCache::Load(const std::string &FileName)
+{
+	FILE *pFile = fopen(FileName.c_str(), "rb");
+	if (pFile == NULL)
+		return false;
+
+	std::vector<uint08> Image;
+
+	fseek(pFile, 0, SEEK_END);
+	long Size = ftell(pFile);
+	if (Size > 0) {
+		Image.resize(Size);
+		fseek(pFile, 0, SEEK_SET);
+		if (fread(Image.data(), 1, Size, pFile) != (size_t)Size)
+			Image.clear();
+	}
+
+	fclose(pFile);
+
+	if (Image.size() < sizeof(ShaderCacheFileHeader))
+		return false;
+
+	const ShaderCacheFileHeader *pHeader = (const ShaderCacheFileHeader *)Image.data();
+	if (pHeader->Magic != SHADER_CACHE_MAGIC
+		|| pHeader->FormatVersion != SHADER_CACHE_FORMAT_VERSION
+		|| pHeader->BuildStamp != GetBuildStamp()) {
+		printf("ShaderCache: %s is outdated and will be regenerated\n", FileName.c_str());
+		return false;
+	}
+
+	size_t Offset = sizeof(ShaderCacheFileHeader);
+	while (Offset < Image.size()) {
+		// A record that was only partially written (when Cxbx got terminated) ends the file
+		if (Image.size() - Offset < sizeof(ShaderCacheRecord))
+			return false;
+
+		const ShaderCacheRecord *pRecord = (const ShaderCacheRecord *)&Image[Offset];
+		Offset += sizeof(ShaderCacheRecord);
+		if (pRecord->Kind >= XTL::SHADER_CACHE_KIND_COUNT
+			|| Image.size() - Offset < (size_t)pRecord->SourceSize + pRecord->TranslationSize)
+			return false;
+
+		ShaderCacheEntry Entry;
+		Entry.Kind = pRecord->Kind;
+		Entry.Variant = pRecord->Variant;
+		Entry.Source.assign(&Image[Offset], &Image[Offset] + pRecord->SourceSize);
+		Offset += pRecord->SourceSize;
+		Entry.Translation.assign(&Image[Offset], &Image[Offset] + pRecord->TranslationSize);
+		Offset += pRecord->TranslationSize;
+
+		uint32_t EntryHash = Hash(Entry.Kind, Entry.Variant, Entry.Source.data(), (DWORD)Entry.Source.size());
+		if (Find(EntryHash, Entry.Kind, Entry.Variant, Entry.Source.data(), (DWORD)Entry.Source.size()) == nullptr)
+			m_Entries.emplace(EntryHash, std::move(Entry));
+	}
+
+	return true;
+}
+
+void ShaderCache::Open()
+{
+	m_bOpened = true;
+
+	// Make sure the Shader Cache directory exists
+	std::string cachePath = std::string(szFolder_CxbxReloadedData) + "\\ShaderCache\\";
+	int result = SHCreateDirectoryEx(nullptr, cachePath.c_str(), nullptr);
+	if ((result != ERROR_SUCCESS) && (result != ERROR_ALREADY_EXISTS)) {
+		EmuWarning("Couldn't create Cxbx-Reloaded ShaderCache folder, shaders are only cached in memory!");
+		return;
+	}
+
+	// Like the HLE cache, use a hash of the loaded XBE's header as filename
+	uint32_t uiHash = XXHash32::hash((void*)&CxbxKrnl_Xbe->m_Header, sizeof(Xbe::Header), 0);
+	std::stringstream sstream;
+	sstream << cachePath << std::hex << uiHash << ".bin";
+	std::string filename = sstream.str();
+
+	if (Load(filename)) {
+		printf("ShaderCache: Loaded %d translations from %08X.bin\n", (int)m_Entries.size(), uiHash);
+		m_pFile = fopen(filename.c_str(), "ab");
+	}
+	else {
+		// Start over, keeping whatever could still be read
+		m_pFile = fopen(filename.c_str(), "wb");
+		if (m_pFile != NULL) {
+			ShaderCacheFileHeader Header;
+			Header.Magic = SHADER_CACHE_MAGIC;
+			Header.FormatVersion = SHADER_CACHE_FORMAT_VERSION;
+			Header.BuildStamp = GetBuildStamp();
+			fwrite(&Header, sizeof(Header), 1, m_pFile);
+
+			for (auto it = m_Entries.begin(); it != m_Entries.end(); ++it)
+				if (!Append(it->second))
+					break;
+		}
+	}
+
+	if (m_pFile == NULL)
+		EmuWarning("Couldn't open Shader Cache file, shaders are only cached in memory!");
+}
+
+bool ShaderCache::Append(const ShaderCacheEntry &Entry)
+{
+	ShaderCacheRecord Record;
+	Record.Kind = Entry.Kind;
+	Record.Variant = Entry.Variant;
+	Record.SourceSize = (uint32_t)Entry.Source.size();
+	Record.TranslationSize = (uint32_t)Entry.Translation.size();
+
+	bool bResult = fwrite(&Record, sizeof(Record), 1, m_pFile) == 1
+		&& fwrite(Entry.Source.data(), 1, Entry.Source.size(), m_pFile) == Entry.Source.size()
+		&& fwrite(Entry.Translation.data(), 1, Entry.Translation.size(), m_pFile) == Entry.Translation.size();
+
+	// Flush right away, as Cxbx is usually terminated instead of shut down
+	if (bResult)
+		bResult = fflush(m_pFile) == 0;
+
+	if (!bResult) {
+		EmuWarning("Couldn't write to Shader Cache file, shaders are only cached in memory from now on!");
+		fclose(m_pFile);
+		m_pFile = NULL;
+	}
+
+	return bResult;
+}
+
+bool ShaderCache::Lookup(DWORD Kind, DWORD Variant, const void *pSource, DWORD SourceSize, const void **ppTranslation, DWORD *pTranslationSize)
+{
+	Lock();
+
+	if (!m_bOpened)
+		Open();
+
+	ShaderCacheEntry *pEntry = Find(Hash(Kind, Variant, pSource, SourceSize), Kind, Variant, pSource, SourceSize);
+	if (pEntry != nullptr) {
+		m_Hits[Kind]++;
+		*ppTranslation = pEntry->Translation.data();
+		*pTranslationSize = (DWORD)pEntry->Translation.size();
+	}
+	else {
+		m_Misses[Kind]++;
+		DbgPrintf("ShaderCache: Translating %s (%d hits, %d misses so far)\n", ShaderCacheKindNames[Kind], m_Hits[Kind], m_Misses[Kind]);
+	}
+
+	Unlock();
+
+	return pEntry != nullptr;
+}
+
+void ShaderCache::Insert(DWORD Kind, DWORD Variant, const void *pSource, DWORD SourceSize, const void *pTranslation, DWORD TranslationSize)
+{
+	Lock();
+
+	if (!m_bOpened)
+		Open();
+
+	uint32_t EntryHash = Hash(Kind, Variant, pSource, SourceSize);
+	if (Find(EntryHash, Kind, Variant, pSource, SourceSize) == nullptr) {
+		ShaderCacheEntry Entry;
+		Entry.Kind = Kind;
+		Entry.Variant = Variant;
+		Entry.Source.assign((const uint08 *)pSource, (const uint08 *)pSource + SourceSize);
+		Entry.Translation.assign((const uint08 *)pTranslation, (const uint08 *)pTranslation + TranslationSize);
+
+		if (m_pFile != NULL)
+			Append(Entry);
+
+		m_Entries.emplace(EntryHash, std::move(Entry));
+	}
+
+	Unlock();
+}
+
+bool XTL::EmuShaderCacheLookup
+(
+	SHADER_CACHE_KIND Kind,
+	DWORD             dwVariant,
+	const void       *pSource,
+	DWORD             dwSourceSize,
+	const void      **ppTranslation,
+	DWORD            *pdwTranslationSize
+)
+{
+	return g_ShaderCache.Lookup(Kind, dwVariant, pSource, dwSourceSize, ppTranslation, pdwTranslationSize);
+}
+
+void XTL::EmuShaderCacheInsert
+(
+	SHADER_CACHE_KIND Kind,
+	DWORD             dwVariant,
+	const void       *pSource,
+	DWORD             dwSourceSize,
+	const void       *pTranslation,
+	DWORD             dwTranslationSize
+)
+{
+	g_ShaderCache.Insert(Kind, dwVariant, pSource, dwSourceSize, pTranslation, dwTranslationSize);
+}
@@ -0,0 +1,78 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Win32->CxbxKrnl->EmuD3D8->ShaderCache.h
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef SHADERCACHE_H
+#define SHADERCACHE_H
+
+#include "Cxbx.h"
+
+// The shader cache remembers shader translations, keyed on (a hash of) the Xbox data
+// they were made from. Translations are kept in memory and appended to a cache file
+// per title, so that titles that recreate their shaders (per level, or even per frame)
+// only pay for translating them once. The file is invalidated whenever Cxbx is rebuilt.
+
+// The kinds of translations kept in the shader cache
+typedef enum _SHADER_CACHE_KIND
+{
+	SHADER_CACHE_VERTEX_DECLARATION = 0, // EmuRecompileVshDeclaration
+	SHADER_CACHE_VERTEX_FUNCTION    = 1, // EmuRecompileVshFunction
+	SHADER_CACHE_PIXEL_SHADER       = 2, // CreatePixelShaderFunction
+	SHADER_CACHE_KIND_COUNT
+}
+SHADER_CACHE_KIND;
+
+// Looks up a translation. dwVariant holds any setting the translation depends upon
+// (besides the source). On a hit, *ppTranslation points to data owned by the cache,
+// which stays valid until the cache is closed.
+extern bool EmuShaderCacheLookup
+(
+	SHADER_CACHE_KIND Kind,
+	DWORD             dwVariant,
+	const void       *pSource,
+	DWORD             dwSourceSize,
+	const void      **ppTranslation,
+	DWORD            *pdwTranslationSize
+);
+
+// Adds a translation to the cache (and it's file)
+extern void EmuShaderCacheInsert
+(
+	SHADER_CACHE_KIND Kind,
+	DWORD             dwVariant,
+	const void       *pSource,
+	DWORD             dwSourceSize,
+	const void       *pTranslation,
+	DWORD             dwTranslationSize
+);
+
+#endif
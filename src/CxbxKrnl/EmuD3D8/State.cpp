@@ -45,6 +45,98 @@ DWORD *XTL::EmuD3DDeferredTextureState;
 
 extern uint32 g_BuildVersion;
 
+// host state cache : the last value handed to the host device per state, so
+// that redundant SetRenderState/SetTextureStageState calls can be dropped
+#define STATE_CACHE_RENDER_STATES    256
+#define STATE_CACHE_TEXTURE_STAGES   8
+#define STATE_CACHE_TEXTURE_STATES   32
+#define STATE_CACHE_REPORT_INTERVAL  600
+
+static DWORD g_CachedRenderState[STATE_CACHE_RENDER_STATES];
+static DWORD g_CachedTextureState[STATE_CACHE_TEXTURE_STAGES][STATE_CACHE_TEXTURE_STATES];
+
+// a set bit means the cached value is known to be what the host device holds
+static DWORD g_RenderStateValid[STATE_CACHE_RENDER_STATES / 32];
+static DWORD g_TextureStateValid[STATE_CACHE_TEXTURE_STAGES];
+
+// while a state block is being recorded, every call must reach the host
+static bool g_bRecordingStateBlock = false;
+
+static DWORD g_dwStateFrame = 0;
+static DWORD g_dwStateCallsIssued = 0;
+static DWORD g_dwStateCallsRedundant = 0;
+
+void XTL::EmuSetRenderState(D3DRENDERSTATETYPE State, DWORD Value)
+{
+    DWORD dwIndex = (DWORD)State;
+
+    if(dwIndex < STATE_CACHE_RENDER_STATES && !g_bRecordingStateBlock)
+    {
+        DWORD dwBit = 1 << (dwIndex & 31);
+
+        if((g_RenderStateValid[dwIndex >> 5] & dwBit) && g_CachedRenderState[dwIndex] == Value)
+        {
+            g_dwStateCallsRedundant++;
+            return;
+        }
+
+        g_CachedRenderState[dwIndex] = Value;
+        g_RenderStateValid[dwIndex >> 5] |= dwBit;
+    }
+
+    g_dwStateCallsIssued++;
+
+    g_pD3DDevice8->SetRenderState(State, Value);
+}
+
+void XTL::EmuSetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value)
+{
+    DWORD dwType = (DWORD)Type;
+
+    if(Stage < STATE_CACHE_TEXTURE_STAGES && dwType < STATE_CACHE_TEXTURE_STATES && !g_bRecordingStateBlock)
+    {
+        DWORD dwBit = 1 << dwType;
+
+        if((g_TextureStateValid[Stage] & dwBit) && g_CachedTextureState[Stage][dwType] == Value)
+        {
+            g_dwStateCallsRedundant++;
+            return;
+        }
+
+        g_CachedTextureState[Stage][dwType] = Value;
+        g_TextureStateValid[Stage] |= dwBit;
+    }
+
+    g_dwStateCallsIssued++;
+
+    g_pD3DDevice8->SetTextureStageState(Stage, Type, Value);
+}
+
+void XTL::EmuInvalidateStateCache()
+{
+    memset(g_RenderStateValid, 0, sizeof(g_RenderStateValid));
+    memset(g_TextureStateValid, 0, sizeof(g_TextureStateValid));
+}
+
+void XTL::EmuRecordStateBlock(bool bRecording)
+{
+    g_bRecordingStateBlock = bRecording;
+}
+
+void XTL::EmuStateCacheEndFrame()
+{
+    g_dwStateFrame++;
+
+    if(g_dwStateFrame % STATE_CACHE_REPORT_INTERVAL == 0)
+    {
+        DbgPrintf("StateCache: %d state changes issued, %d redundant ones dropped last frame\n",
+            g_dwStateCallsIssued, g_dwStateCallsRedundant);
+    }
+
+    g_dwStateCallsIssued = 0;
+    g_dwStateCallsRedundant = 0;
+}
+
 // ******************************************************************
 // * patch: UpdateDeferredStates
 // ******************************************************************
@@ -56,22 +148,22 @@ void XTL::EmuUpdateDeferredStates()
     if(EmuD3DDeferredRenderState != 0)
     {
         if(XTL::EmuD3DDeferredRenderState[0] != X_D3DRS_UNK)
-            g_pD3DDevice8->SetRenderState(D3DRS_FOGENABLE, XTL::EmuD3DDeferredRenderState[0]);
+            EmuSetRenderState(D3DRS_FOGENABLE, XTL::EmuD3DDeferredRenderState[0]);
 
         if(XTL::EmuD3DDeferredRenderState[1] != X_D3DRS_UNK)
-            g_pD3DDevice8->SetRenderState(D3DRS_FOGTABLEMODE, XTL::EmuD3DDeferredRenderState[1]);
+            EmuSetRenderState(D3DRS_FOGTABLEMODE, XTL::EmuD3DDeferredRenderState[1]);
 
         if(XTL::EmuD3DDeferredRenderState[2] != X_D3DRS_UNK)
-            g_pD3DDevice8->SetRenderState(D3DRS_FOGSTART, XTL::EmuD3DDeferredRenderState[2]);
+            EmuSetRenderState(D3DRS_FOGSTART, XTL::EmuD3DDeferredRenderState[2]);
 
         if(XTL::EmuD3DDeferredRenderState[3] != X_D3DRS_UNK)
-            g_pD3DDevice8->SetRenderState(D3DRS_FOGEND, XTL::EmuD3DDeferredRenderState[3]);
+            EmuSetRenderState(D3DRS_FOGEND, XTL::EmuD3DDeferredRenderState[3]);
 
         if(XTL::EmuD3DDeferredRenderState[4] != X_D3DRS_UNK)
-            g_pD3DDevice8->SetRenderState(D3DRS_FOGDENSITY, XTL::EmuD3DDeferredRenderState[4]);
+            EmuSetRenderState(D3DRS_FOGDENSITY, XTL::EmuD3DDeferredRenderState[4]);
 
         if(XTL::EmuD3DDeferredRenderState[5] != X_D3DRS_UNK)
-            g_pD3DDevice8->SetRenderState(D3DRS_RANGEFOGENABLE, XTL::EmuD3DDeferredRenderState[5]);
+            EmuSetRenderState(D3DRS_RANGEFOGENABLE, XTL::EmuD3DDeferredRenderState[5]);
 
         if(XTL::EmuD3DDeferredRenderState[6] != X_D3DRS_UNK)
         {
@@ -81,7 +173,7 @@ void XTL::EmuUpdateDeferredStates()
             dwConv |= (XTL::EmuD3DDeferredRenderState[6] & 0x00001000) ? D3DWRAP_V : 0;
             dwConv |= (XTL::EmuD3DDeferredRenderState[6] & 0x00100000) ? D3DWRAP_W : 0;
 
-            g_pD3DDevice8->SetRenderState(D3DRS_WRAP0, dwConv);
+            EmuSetRenderState(D3DRS_WRAP0, dwConv);
         }
 
         if(XTL::EmuD3DDeferredRenderState[7] != X_D3DRS_UNK)
@@ -92,56 +184,56 @@ void XTL::EmuUpdateDeferredStates()
             dwConv |= (XTL::EmuD3DDeferredRenderState[7] & 0x00001000) ? D3DWRAP_V : 0;
             dwConv |= (XTL::EmuD3DDeferredRenderState[7] & 0x00100000) ? D3DWRAP_W : 0;
 
-            g_pD3DDevice8->SetRenderState(D3DRS_WRAP1, dwConv);
+            EmuSetRenderState(D3DRS_WRAP1, dwConv);
         }
 
         if(XTL::EmuD3DDeferredRenderState[10] != X_D3DRS_UNK)
-            g_pD3DDevice8->SetRenderState(D3DRS_LIGHTING, XTL::EmuD3DDeferredRenderState[10]);
+            EmuSetRenderState(D3DRS_LIGHTING, XTL::EmuD3DDeferredRenderState[10]);
 
         if(XTL::EmuD3DDeferredRenderState[11] != X_D3DRS_UNK)
-            g_pD3DDevice8->SetRenderState(D3DRS_SPECULARENABLE, XTL::EmuD3DDeferredRenderState[11]);
+            EmuSetRenderState(D3DRS_SPECULARENABLE, XTL::EmuD3DDeferredRenderState[11]);
 
         if(XTL::EmuD3DDeferredRenderState[13] != X_D3DRS_UNK)
-            g_pD3DDevice8->SetRenderState(D3DRS_COLORVERTEX, XTL::EmuD3DDeferredRenderState[13]);
+            EmuSetRenderState(D3DRS_COLORVERTEX, XTL::EmuD3DDeferredRenderState[13]);
 
         if(XTL::EmuD3DDeferredRenderState[19] != X_D3DRS_UNK)
-            g_pD3DDevice8->SetRenderState(D3DRS_DIFFUSEMATERIALSOURCE, XTL::EmuD3DDeferredRenderState[19]);
+            EmuSetRenderState(D3DRS_DIFFUSEMATERIALSOURCE, XTL::EmuD3DDeferredRenderState[19]);
 
         if(XTL::EmuD3DDeferredRenderState[20] != X_D3DRS_UNK)
-            g_pD3DDevice8->SetRenderState(D3DRS_AMBIENTMATERIALSOURCE, XTL::EmuD3DDeferredRenderState[20]);
+            EmuSetRenderState(D3DRS_AMBIENTMATERIALSOURCE, XTL::EmuD3DDeferredRenderState[20]);
 
         if(XTL::EmuD3DDeferredRenderState[21] != X_D3DRS_UNK)
-            g_pD3DDevice8->SetRenderState(D3DRS_EMISSIVEMATERIALSOURCE, XTL::EmuD3DDeferredRenderState[21]);
+            EmuSetRenderState(D3DRS_EMISSIVEMATERIALSOURCE, XTL::EmuD3DDeferredRenderState[21]);
 
         if(XTL::EmuD3DDeferredRenderState[23] != X_D3DRS_UNK)
-            g_pD3DDevice8->SetRenderState(D3DRS_AMBIENT, XTL::EmuD3DDeferredRenderState[23]);
+            EmuSetRenderState(D3DRS_AMBIENT, XTL::EmuD3DDeferredRenderState[23]);
 
         if(XTL::EmuD3DDeferredRenderState[24] != X_D3DRS_UNK)
-            g_pD3DDevice8->SetRenderState(D3DRS_POINTSIZE, XTL::EmuD3DDeferredRenderState[24]);
+            EmuSetRenderState(D3DRS_POINTSIZE, XTL::EmuD3DDeferredRenderState[24]);
 
         if(XTL::EmuD3DDeferredRenderState[25] != X_D3DRS_UNK)
-            g_pD3DDevice8->SetRenderState(D3DRS_POINTSIZE_MIN, XTL::EmuD3DDeferredRenderState[25]);
+            EmuSetRenderState(D3DRS_POINTSIZE_MIN, XTL::EmuD3DDeferredRenderState[25]);
 
         if(XTL::EmuD3DDeferredRenderState[26] != X_D3DRS_UNK)
-            g_pD3DDevice8->SetRenderState(D3DRS_POINTSPRITEENABLE, XTL::EmuD3DDeferredRenderState[26]);
+            EmuSetRenderState(D3DRS_POINTSPRITEENABLE, XTL::EmuD3DDeferredRenderState[26]);
 
         if(XTL::EmuD3DDeferredRenderState[27] != X_D3DRS_UNK)
-            g_pD3DDevice8->SetRenderState(D3DRS_POINTSCALEENABLE, XTL::EmuD3DDeferredRenderState[27]);
+            EmuSetRenderState(D3DRS_POINTSCALEENABLE, XTL::EmuD3DDeferredRenderState[27]);
 
         if(XTL::EmuD3DDeferredRenderState[28] != X_D3DRS_UNK)
-            g_pD3DDevice8->SetRenderState(D3DRS_POINTSCALE_A, XTL::EmuD3DDeferredRenderState[28]);
+            EmuSetRenderState(D3DRS_POINTSCALE_A, XTL::EmuD3DDeferredRenderState[28]);
 
         if(XTL::EmuD3DDeferredRenderState[29] != X_D3DRS_UNK)
-            g_pD3DDevice8->SetRenderState(D3DRS_POINTSCALE_B, XTL::EmuD3DDeferredRenderState[29]);
+            EmuSetRenderState(D3DRS_POINTSCALE_B, XTL::EmuD3DDeferredRenderState[29]);
 
         if(XTL::EmuD3DDeferredRenderState[30] != X_D3DRS_UNK)
-            g_pD3DDevice8->SetRenderState(D3DRS_POINTSCALE_C, XTL::EmuD3DDeferredRenderState[30]);
+            EmuSetRenderState(D3DRS_POINTSCALE_C, XTL::EmuD3DDeferredRenderState[30]);
 
         if(XTL::EmuD3DDeferredRenderState[31] != X_D3DRS_UNK)
-            g_pD3DDevice8->SetRenderState(D3DRS_POINTSIZE_MAX, XTL::EmuD3DDeferredRenderState[31]);
+            EmuSetRenderState(D3DRS_POINTSIZE_MAX, XTL::EmuD3DDeferredRenderState[31]);
 
         if(XTL::EmuD3DDeferredRenderState[33] != X_D3DRS_UNK)
-            g_pD3DDevice8->SetRenderState(D3DRS_PATCHSEGMENTS, XTL::EmuD3DDeferredRenderState[33]);
+            EmuSetRenderState(D3DRS_PATCHSEGMENTS, XTL::EmuD3DDeferredRenderState[33]);
 
         /** To check for unhandled RenderStates
         for(int v=0;v<117-82;v++)
@@ -174,7 +266,7 @@ void XTL::EmuUpdateDeferredStates()
                 if(pCur[0+Adjust2] == 5)
                     CxbxKrnlCleanup("ClampToEdge is unsupported (temporarily)");
 
-                g_pD3DDevice8->SetTextureStageState(v, D3DTSS_ADDRESSU, pCur[0+Adjust2]);
+                EmuSetTextureStageState(v, D3DTSS_ADDRESSU, pCur[0+Adjust2]);
             }
 
             if(pCur[1+Adjust2] != X_D3DTSS_UNK)
@@ -182,7 +274,7 @@ void XTL::EmuUpdateDeferredStates()
                 if(pCur[1+Adjust2] == 5)
                     CxbxKrnlCleanup("ClampToEdge is unsupported (temporarily)");
 
-                g_pD3DDevice8->SetTextureStageState(v, D3DTSS_ADDRESSV, pCur[1+Adjust2]);
+                EmuSetTextureStageState(v, D3DTSS_ADDRESSV, pCur[1+Adjust2]);
             }
 
             if(pCur[2+Adjust2] != X_D3DTSS_UNK)
@@ -190,7 +282,7 @@ void XTL::EmuUpdateDeferredStates()
                 if(pCur[2+Adjust2] == 5)
                     CxbxKrnlCleanup("ClampToEdge is unsupported (temporarily)");
 
-                g_pD3DDevice8->SetTextureStageState(v, D3DTSS_ADDRESSW, pCur[2+Adjust2]);
+                EmuSetTextureStageState(v, D3DTSS_ADDRESSW, pCur[2+Adjust2]);
             }
 
             if(pCur[3+Adjust2] != X_D3DTSS_UNK)
@@ -198,7 +290,7 @@ void XTL::EmuUpdateDeferredStates()
                 if(pCur[3+Adjust2] == 4)
                     CxbxKrnlCleanup("QuinCunx is unsupported (temporarily)");
 
-                g_pD3DDevice8->SetTextureStageState(v, D3DTSS_MAGFILTER, pCur[3+Adjust2]);
+                EmuSetTextureStageState(v, D3DTSS_MAGFILTER, pCur[3+Adjust2]);
             }
 
             if(pCur[4+Adjust2] != X_D3DTSS_UNK)
@@ -206,7 +298,7 @@ void XTL::EmuUpdateDeferredStates()
                 if(pCur[4+Adjust2] == 4)
                     CxbxKrnlCleanup("QuinCunx is unsupported (temporarily)");
 
-                g_pD3DDevice8->SetTextureStageState(v, D3DTSS_MINFILTER, pCur[4+Adjust2]);
+                EmuSetTextureStageState(v, D3DTSS_MINFILTER, pCur[4+Adjust2]);
             }
 
             if(pCur[5+Adjust2] != X_D3DTSS_UNK)
@@ -214,17 +306,17 @@ void XTL::EmuUpdateDeferredStates()
                 if(pCur[5+Adjust2] == 4)
                     CxbxKrnlCleanup("QuinCunx is unsupported (temporarily)");
 
-                g_pD3DDevice8->SetTextureStageState(v, D3DTSS_MIPFILTER, pCur[5+Adjust2]);
+                EmuSetTextureStageState(v, D3DTSS_MIPFILTER, pCur[5+Adjust2]);
             }
 
             if(pCur[6+Adjust2] != X_D3DTSS_UNK)
-                g_pD3DDevice8->SetTextureStageState(v, D3DTSS_MIPMAPLODBIAS, pCur[6+Adjust2]);
+                EmuSetTextureStageState(v, D3DTSS_MIPMAPLODBIAS, pCur[6+Adjust2]);
 
             if(pCur[7+Adjust2] != X_D3DTSS_UNK)
-                g_pD3DDevice8->SetTextureStageState(v, D3DTSS_MAXMIPLEVEL, pCur[7+Adjust2]);
+                EmuSetTextureStageState(v, D3DTSS_MAXMIPLEVEL, pCur[7+Adjust2]);
 
             if(pCur[8+Adjust2] != X_D3DTSS_UNK)
-                g_pD3DDevice8->SetTextureStageState(v, D3DTSS_MAXANISOTROPY, pCur[8+Adjust2]);
+                EmuSetTextureStageState(v, D3DTSS_MAXANISOTROPY, pCur[8+Adjust2]);
 
             if(pCur[12-Adjust1] != X_D3DTSS_UNK)
             {
@@ -232,82 +324,82 @@ void XTL::EmuUpdateDeferredStates()
 				switch (pCur[12 - Adjust1]) 
 				{
 				case X_D3DTOP_DISABLE: 
-					g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_DISABLE);
+					EmuSetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_DISABLE);
 					break;
 				case X_D3DTOP_SELECTARG1:
-					g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_SELECTARG1);
+					EmuSetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_SELECTARG1);
 					break;
 				case X_D3DTOP_SELECTARG2:
-					g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_SELECTARG2);
+					EmuSetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_SELECTARG2);
 					break;
 				case X_D3DTOP_MODULATE:
-					g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_MODULATE);
+					EmuSetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_MODULATE);
 					break;
 				case X_D3DTOP_MODULATE2X:
-					g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_MODULATE2X);
+					EmuSetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_MODULATE2X);
 					break;
 				case X_D3DTOP_MODULATE4X:
-					g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_MODULATE4X);
+					EmuSetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_MODULATE4X);
 					break;
 				case X_D3DTOP_ADD:
-					g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_ADD);
+					EmuSetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_ADD);
 					break;
 				case X_D3DTOP_ADDSIGNED:
-					g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_ADDSIGNED);
+					EmuSetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_ADDSIGNED);
 					break;
 				case X_D3DTOP_ADDSIGNED2X:
-					g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_ADDSIGNED2X);
+					EmuSetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_ADDSIGNED2X);
 					break;
 				case X_D3DTOP_SUBTRACT:
-					g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_SUBTRACT);
+					EmuSetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_SUBTRACT);
 					break;
 				case X_D3DTOP_ADDSMOOTH:
-					g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_ADDSMOOTH);
+					EmuSetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_ADDSMOOTH);
 					break;
 				case X_D3DTOP_BLENDDIFFUSEALPHA:
-					g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_BLENDDIFFUSEALPHA);
+					EmuSetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_BLENDDIFFUSEALPHA);
 					break;
 				case X_D3DTOP_BLENDCURRENTALPHA:
-					g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_BLENDCURRENTALPHA);
+					EmuSetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_BLENDCURRENTALPHA);
 					break;
 				case X_D3DTOP_BLENDTEXTUREALPHA:
-					g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_BLENDTEXTUREALPHA);
+					EmuSetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_BLENDTEXTUREALPHA);
 					break;
 				case X_D3DTOP_BLENDFACTORALPHA:
-					g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_BLENDFACTORALPHA);
+					EmuSetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_BLENDFACTORALPHA);
 					break;
 				case X_D3DTOP_BLENDTEXTUREALPHAPM:
-					g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_BLENDTEXTUREALPHAPM);
+					EmuSetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_BLENDTEXTUREALPHAPM);
 					break;
 				case X_D3DTOP_PREMODULATE:
-					g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_PREMODULATE);
+					EmuSetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_PREMODULATE);
 					break;
 				case X_D3DTOP_MODULATEALPHA_ADDCOLOR:
-					g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_MODULATEALPHA_ADDCOLOR);
+					EmuSetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_MODULATEALPHA_ADDCOLOR);
 					break;
 				case X_D3DTOP_MODULATECOLOR_ADDALPHA:
-					g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_MODULATECOLOR_ADDALPHA);
+					EmuSetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_MODULATECOLOR_ADDALPHA);
 					break;
 				case X_D3DTOP_MODULATEINVALPHA_ADDCOLOR:
-					g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_MODULATEINVALPHA_ADDCOLOR);
+					EmuSetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_MODULATEINVALPHA_ADDCOLOR);
 					break;
 				case X_D3DTOP_MODULATEINVCOLOR_ADDALPHA:
-					g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_MODULATEINVCOLOR_ADDALPHA);
+					EmuSetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_MODULATEINVCOLOR_ADDALPHA);
 					break;
 				case X_D3DTOP_DOTPRODUCT3:
-					g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_DOTPRODUCT3);
+					EmuSetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_DOTPRODUCT3);
 					break;
 				case X_D3DTOP_MULTIPLYADD:
-					g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_MULTIPLYADD);
+					EmuSetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_MULTIPLYADD);
 					break;
 				case X_D3DTOP_LERP:
-					g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_LERP);
+					EmuSetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_LERP);
 					break;
 				case X_D3DTOP_BUMPENVMAP:
-					g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_MULTIPLYADD);
+					EmuSetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_MULTIPLYADD);
 					break;
 				case X_D3DTOP_BUMPENVMAPLUMINANCE:
-					g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_BUMPENVMAPLUMINANCE);
+					EmuSetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_BUMPENVMAPLUMINANCE);
 					break;
 				default:
 					CxbxKrnlCleanup("(Temporarily) Unsupported D3DTSS_COLOROP Value (%d)", pCur[12 - Adjust1]);
@@ -316,13 +408,13 @@ void XTL::EmuUpdateDeferredStates()
             }
 
             if(pCur[13-Adjust1] != X_D3DTSS_UNK)
-                g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLORARG0, pCur[13-Adjust1]);
+                EmuSetTextureStageState(v, D3DTSS_COLORARG0, pCur[13-Adjust1]);
 
             if(pCur[14-Adjust1] != X_D3DTSS_UNK)
-                g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLORARG1, pCur[14-Adjust1]);
+                EmuSetTextureStageState(v, D3DTSS_COLORARG1, pCur[14-Adjust1]);
 
             if(pCur[15-Adjust1] != X_D3DTSS_UNK)
-                g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLORARG2, pCur[15-Adjust1]);
+                EmuSetTextureStageState(v, D3DTSS_COLORARG2, pCur[15-Adjust1]);
 
             // TODO: Use a lookup table, this is not always a 1:1 map (same as D3DTSS_COLOROP)
             if(pCur[16-Adjust1] != X_D3DTSS_UNK)
@@ -331,32 +423,32 @@ void XTL::EmuUpdateDeferredStates()
                     CxbxKrnlCleanup("(Temporarily) Unsupported D3DTSS_ALPHAOP Value (%d)", pCur[16-Adjust1]);
 
 				if( pCur[16-Adjust1] == 14 )
-					g_pD3DDevice8->SetTextureStageState(v, D3DTSS_ALPHAOP, D3DTOP_BLENDTEXTUREALPHA);
+					EmuSetTextureStageState(v, D3DTSS_ALPHAOP, D3DTOP_BLENDTEXTUREALPHA);
 				if( pCur[16-Adjust1] == 15 )
-					g_pD3DDevice8->SetTextureStageState(v, D3DTSS_ALPHAOP, D3DTOP_BLENDFACTORALPHA);
+					EmuSetTextureStageState(v, D3DTSS_ALPHAOP, D3DTOP_BLENDFACTORALPHA);
 				if( pCur[16-Adjust1] == 13 )
-					g_pD3DDevice8->SetTextureStageState(v, D3DTSS_ALPHAOP, D3DTOP_BLENDCURRENTALPHA);
+					EmuSetTextureStageState(v, D3DTSS_ALPHAOP, D3DTOP_BLENDCURRENTALPHA);
 				else
-					g_pD3DDevice8->SetTextureStageState(v, D3DTSS_ALPHAOP, pCur[16-Adjust1]);
+					EmuSetTextureStageState(v, D3DTSS_ALPHAOP, pCur[16-Adjust1]);
             }
 
             if(pCur[17-Adjust1] != X_D3DTSS_UNK)
-                g_pD3DDevice8->SetTextureStageState(v, D3DTSS_ALPHAARG0, pCur[17-Adjust1]);
+                EmuSetTextureStageState(v, D3DTSS_ALPHAARG0, pCur[17-Adjust1]);
 
             if(pCur[18-Adjust1] != X_D3DTSS_UNK)
-                g_pD3DDevice8->SetTextureStageState(v, D3DTSS_ALPHAARG1, pCur[18-Adjust1]);
+                EmuSetTextureStageState(v, D3DTSS_ALPHAARG1, pCur[18-Adjust1]);
 
             if(pCur[19-Adjust1] != X_D3DTSS_UNK)
-                g_pD3DDevice8->SetTextureStageState(v, D3DTSS_ALPHAARG2, pCur[19-Adjust1]);
+                EmuSetTextureStageState(v, D3DTSS_ALPHAARG2, pCur[19-Adjust1]);
 
             if(pCur[20-Adjust1] != X_D3DTSS_UNK)
-                g_pD3DDevice8->SetTextureStageState(v, D3DTSS_RESULTARG, pCur[20-Adjust1]);
+                EmuSetTextureStageState(v, D3DTSS_RESULTARG, pCur[20-Adjust1]);
 
             if(pCur[21-Adjust1] != X_D3DTSS_UNK)
-                g_pD3DDevice8->SetTextureStageState(v, D3DTSS_TEXTURETRANSFORMFLAGS, pCur[21-Adjust1]);
+                EmuSetTextureStageState(v, D3DTSS_TEXTURETRANSFORMFLAGS, pCur[21-Adjust1]);
 
             /*if(pCur[29] != X_D3DTSS_UNK)	// This is NOT a deferred texture state!
-                g_pD3DDevice8->SetTextureStageState(v, D3DTSS_BORDERCOLOR, pCur[29]);*/
+                EmuSetTextureStageState(v, D3DTSS_BORDERCOLOR, pCur[29]);*/
 
             /** To check for unhandled texture stage state changes
             for(int r=0;r<32;r++)
@@ -399,8 +491,8 @@ void XTL::EmuUpdateDeferredStates()
             g_pD3DDevice8->SetTexture(0, pTexture);
 
             // disable all other stages
-            g_pD3DDevice8->SetTextureStageState(1, D3DTSS_COLOROP, D3DTOP_DISABLE);
-            g_pD3DDevice8->SetTextureStageState(1, D3DTSS_ALPHAOP, D3DTOP_DISABLE);
+            EmuSetTextureStageState(1, D3DTSS_COLOROP, D3DTOP_DISABLE);
+            EmuSetTextureStageState(1, D3DTSS_ALPHAOP, D3DTOP_DISABLE);
 
             // in that case we have to copy over the stage by hand
             for(int v=0;v<30;v++)
@@ -410,7 +502,7 @@ void XTL::EmuUpdateDeferredStates()
                     ::DWORD dwValue;
 
                     g_pD3DDevice8->GetTextureStageState(3, (D3DTEXTURESTAGESTATETYPE)v, &dwValue);
-                    g_pD3DDevice8->SetTextureStageState(0, (D3DTEXTURESTAGESTATETYPE)v, dwValue);
+                    EmuSetTextureStageState(0, (D3DTEXTURESTAGESTATETYPE)v, dwValue);
                 }
             }
         }
@@ -418,14 +510,14 @@ void XTL::EmuUpdateDeferredStates()
 
     if(g_bFakePixelShaderLoaded)
     {
-        g_pD3DDevice8->SetRenderState(D3DRS_FOGENABLE, FALSE);
+        EmuSetRenderState(D3DRS_FOGENABLE, FALSE);
 
         // programmable pipeline
         //*
         for(int v=0;v<4;v++)
         {
-            g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_DISABLE);
-            g_pD3DDevice8->SetTextureStageState(v, D3DTSS_ALPHAOP, D3DTOP_DISABLE);
+            EmuSetTextureStageState(v, D3DTSS_COLOROP, D3DTOP_DISABLE);
+            EmuSetTextureStageState(v, D3DTSS_ALPHAOP, D3DTOP_DISABLE);
         }
         //*/
 
@@ -433,18 +525,18 @@ void XTL::EmuUpdateDeferredStates()
         /*
         for(int v=0;v<4;v++)
         {
-            g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLOROP,   D3DTOP_MODULATE);
-            g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLORARG1, D3DTA_TEXTURE);
-            g_pD3DDevice8->SetTextureStageState(v, D3DTSS_COLORARG2, D3DTA_CURRENT);
+            EmuSetTextureStageState(v, D3DTSS_COLOROP,   D3DTOP_MODULATE);
+            EmuSetTextureStageState(v, D3DTSS_COLORARG1, D3DTA_TEXTURE);
+            EmuSetTextureStageState(v, D3DTSS_COLORARG2, D3DTA_CURRENT);
 
-            g_pD3DDevice8->SetTextureStageState(v, D3DTSS_ALPHAOP,   D3DTOP_MODULATE);
-            g_pD3DDevice8->SetTextureStageState(v, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
-            g_pD3DDevice8->SetTextureStageState(v, D3DTSS_ALPHAARG2, D3DTA_CURRENT);
+            EmuSetTextureStageState(v, D3DTSS_ALPHAOP,   D3DTOP_MODULATE);
+            EmuSetTextureStageState(v, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
+            EmuSetTextureStageState(v, D3DTSS_ALPHAARG2, D3DTA_CURRENT);
         }
 
-        g_pD3DDevice8->SetRenderState(D3DRS_NORMALIZENORMALS, TRUE);
-        g_pD3DDevice8->SetRenderState(D3DRS_LIGHTING,TRUE);
-        g_pD3DDevice8->SetRenderState(D3DRS_AMBIENT, 0xFFFFFFFF);
+        EmuSetRenderState(D3DRS_NORMALIZENORMALS, TRUE);
+        EmuSetRenderState(D3DRS_LIGHTING,TRUE);
+        EmuSetRenderState(D3DRS_AMBIENT, 0xFFFFFFFF);
         //*/
     }
 }
@@ -42,4 +42,17 @@ extern DWORD *EmuD3DDeferredTextureState;
 
 extern void EmuUpdateDeferredStates();
 
+// forward a state to the host device, unless it already holds that value
+extern void EmuSetRenderState(D3DRENDERSTATETYPE State, DWORD Value);
+extern void EmuSetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value);
+
+// forget the cached host states (after the host device state was changed as a whole)
+extern void EmuInvalidateStateCache();
+
+// bypass the host state cache while a state block is being recorded
+extern void EmuRecordStateBlock(bool bRecording);
+
+// report (and reset) the per frame state change counters
+extern void EmuStateCacheEndFrame();
+
 #endif
\ No newline at end of file
@@ -0,0 +1,269 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Win32->CxbxKrnl->EmuD3D8->Swizzle.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#define _CXBXKRNL_INTERNAL
+#define _XBOXKRNL_DEFEXTRN_
+
+#include "CxbxKrnl/Emu.h"
+#include "CxbxKrnl/EmuXTL.h"
+
+#include <vector>
+
+// The swizzled offsets (in texels) of the coordinates along one axis. Tables of up to
+// SWIZZLE_INLINE_TABLE_SIZE entries don't need a heap allocation, which would otherwise
+// dominate the cost of (un)swizzling small textures.
+#define SWIZZLE_INLINE_TABLE_SIZE 256
+
+struct SwizzleTable
+{
+	DWORD dwCount;
+	DWORD *pOffsets;
+	DWORD Inline[SWIZZLE_INLINE_TABLE_SIZE];
+	std::vector<DWORD> Heap;
+};
+
+// Since no two masks share a bit, the offset of (x, y, z) is OffsetX[x] | OffsetY[y] | OffsetZ[z]
+struct SwizzleTables
+{
+	SwizzleTable X;
+	SwizzleTable Y;
+	SwizzleTable Z;
+};
+
+// Source : Dxbx (this is how EmuUnswizzleRect always determined the masks)
+static void GetSwizzleMasks(DWORD dwWidth, DWORD dwHeight, DWORD dwDepth, DWORD *pMaskX, DWORD *pMaskY, DWORD *pMaskZ)
+{
+	DWORD dwMaskX = 0, dwMaskY = 0, dwMaskZ = 0;
+	for (uint i=1, j=1; (i <= dwWidth) || (i <= dwHeight) || (i <= dwDepth); i <<= 1) {
+		if (i < dwWidth) {
+			dwMaskX = dwMaskX | j;
+			j <<= 1;
+		};
+
+		if (i < dwHeight) {
+			dwMaskY = dwMaskY | j;
+			j <<= 1;
+		}
+
+		if (i < dwDepth) {
+			dwMaskZ = dwMaskZ | j;
+			j <<= 1;
+		}
+	}
+
+	*pMaskX = dwMaskX;
+	*pMaskY = dwMaskY;
+	*pMaskZ = dwMaskZ;
+}
+
+// Fills the table with the swizzled offsets of coordinates dwStart up to dwStart+dwCount
+static void FillSwizzleTable(SwizzleTable &Table, DWORD dwMask, DWORD dwStart, DWORD dwCount)
+{
+	Table.dwCount = dwCount;
+	if (dwCount <= SWIZZLE_INLINE_TABLE_SIZE)
+		Table.pOffsets = Table.Inline;
+	else {
+		Table.Heap.resize(dwCount);
+		Table.pOffsets = Table.Heap.data();
+	}
+
+	// Skip to the start coordinate, by depositing its bits in the mask
+	DWORD dwOffset = 0;
+	for (DWORD dwBit = 1, dwValue = dwStart; dwValue != 0 && dwBit != 0; dwBit <<= 1) {
+		if (dwMask & dwBit) {
+			if (dwValue & 1)
+				dwOffset |= dwBit;
+
+			dwValue >>= 1;
+		}
+	}
+
+	for (DWORD i = 0; i < dwCount; i++) {
+		Table.pOffsets[i] = dwOffset;
+		dwOffset = (dwOffset - dwMask) & dwMask; // step to next coordinate
+	}
+}
+
+static void BuildSwizzleTables
+(
+	SwizzleTables &Tables,
+	DWORD dwWidth, DWORD dwHeight, DWORD dwDepth,
+	DWORD dwX, DWORD dwY, DWORD dwZ,
+	DWORD dwCopyWidth, DWORD dwCopyHeight, DWORD dwCopyDepth
+)
+{
+	DWORD dwMaskX, dwMaskY, dwMaskZ;
+
+	GetSwizzleMasks(dwWidth, dwHeight, dwDepth, &dwMaskX, &dwMaskY, &dwMaskZ);
+	FillSwizzleTable(Tables.X, dwMaskX, dwX, dwCopyWidth);
+	FillSwizzleTable(Tables.Y, dwMaskY, dwY, dwCopyHeight);
+	FillSwizzleTable(Tables.Z, dwMaskZ, dwZ, dwCopyDepth);
+}
+
+// Aligned square tiles of up to this many texels per side are contiguous in the swizzled
+// image, so walking the box tile by tile keeps the swizzled side of the copy cache-local
+// (instead of touching every tile along the entire width of the image for each row).
+#define SWIZZLE_TILE_SIZE 32
+
+struct Texel128 { UINT64 Lo, Hi; };
+
+template <typename T, bool bSwizzle>
+static void SwizzleBoxTexels
+(
+	const SwizzleTables &Tables,
+	uint08 *pSwizzled,
+	uint08 *pLinear,
+	DWORD dwRowPitch,
+	DWORD dwSlicePitch,
+	DWORD dwBPP
+)
+{
+	const DWORD *pOffsetX = Tables.X.pOffsets;
+	const DWORD *pOffsetY = Tables.Y.pOffsets;
+	const DWORD dwCopyWidth = Tables.X.dwCount;
+	const DWORD dwCopyHeight = Tables.Y.dwCount;
+	const DWORD dwCopyDepth = Tables.Z.dwCount;
+
+	for (DWORD z = 0; z < dwCopyDepth; z++) {
+		const DWORD dwOffsetZ = Tables.Z.pOffsets[z];
+		uint08 *pSlice = pLinear + z * dwSlicePitch;
+
+		for (DWORD ty = 0; ty < dwCopyHeight; ty += SWIZZLE_TILE_SIZE) {
+			const DWORD dwTileBottom = (dwCopyHeight - ty > SWIZZLE_TILE_SIZE) ? ty + SWIZZLE_TILE_SIZE : dwCopyHeight;
+
+			for (DWORD tx = 0; tx < dwCopyWidth; tx += SWIZZLE_TILE_SIZE) {
+				const DWORD dwTileRight = (dwCopyWidth - tx > SWIZZLE_TILE_SIZE) ? tx + SWIZZLE_TILE_SIZE : dwCopyWidth;
+
+				for (DWORD y = ty; y < dwTileBottom; y++) {
+					const DWORD dwOffsetYZ = pOffsetY[y] | dwOffsetZ;
+					uint08 *pRow = pSlice + y * dwRowPitch;
+
+					for (DWORD x = tx; x < dwTileRight; x++) {
+						uint08 *pTexel = pSwizzled + (pOffsetX[x] | dwOffsetYZ) * dwBPP;
+						if (sizeof(T) != dwBPP) {
+							// The texel size isn't natively supported - copy it bytewise
+							if (bSwizzle)
+								memcpy(pTexel, pRow + x * dwBPP, dwBPP);
+							else
+								memcpy(pRow + x * dwBPP, pTexel, dwBPP);
+						}
+						else {
+							if (bSwizzle)
+								*(T *)pTexel = ((T *)pRow)[x];
+							else
+								((T *)pRow)[x] = *(T *)pTexel;
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+template <bool bSwizzle>
+static void SwizzleBox
+(
+	uint08 *pSwizzled,
+	DWORD dwWidth, DWORD dwHeight, DWORD dwDepth,
+	DWORD dwX, DWORD dwY, DWORD dwZ,
+	uint08 *pLinear,
+	DWORD dwRowPitch, DWORD dwSlicePitch,
+	DWORD dwCopyWidth, DWORD dwCopyHeight, DWORD dwCopyDepth,
+	DWORD dwBPP
+)
+{
+	if (dwCopyWidth == 0 || dwCopyHeight == 0 || dwCopyDepth == 0 || dwBPP == 0)
+		return;
+
+	SwizzleTables Tables;
+
+	BuildSwizzleTables(Tables, dwWidth, dwHeight, dwDepth, dwX, dwY, dwZ, dwCopyWidth, dwCopyHeight, dwCopyDepth);
+
+	switch (dwBPP) {
+	case 1: SwizzleBoxTexels<uint08, bSwizzle>(Tables, pSwizzled, pLinear, dwRowPitch, dwSlicePitch, dwBPP); break;
+	case 2: SwizzleBoxTexels<uint16, bSwizzle>(Tables, pSwizzled, pLinear, dwRowPitch, dwSlicePitch, dwBPP); break;
+	case 4: SwizzleBoxTexels<uint32, bSwizzle>(Tables, pSwizzled, pLinear, dwRowPitch, dwSlicePitch, dwBPP); break;
+	case 8: SwizzleBoxTexels<UINT64, bSwizzle>(Tables, pSwizzled, pLinear, dwRowPitch, dwSlicePitch, dwBPP); break;
+	case 16: SwizzleBoxTexels<Texel128, bSwizzle>(Tables, pSwizzled, pLinear, dwRowPitch, dwSlicePitch, dwBPP); break;
+	default:
+		// Odd texel sizes are copied bytewise (the 1-byte instantiation uses memcpy with dwBPP) :
+		SwizzleBoxTexels<uint08, bSwizzle>(Tables, pSwizzled, pLinear, dwRowPitch, dwSlicePitch, dwBPP);
+		break;
+	}
+}
+
+void XTL::EmuUnswizzleBox
+(
+	const void *pSrc,
+	DWORD dwWidth,
+	DWORD dwHeight,
+	DWORD dwDepth,
+	DWORD dwX,
+	DWORD dwY,
+	DWORD dwZ,
+	void *pDst,
+	DWORD dwRowPitch,
+	DWORD dwSlicePitch,
+	DWORD dwCopyWidth,
+	DWORD dwCopyHeight,
+	DWORD dwCopyDepth,
+	DWORD dwBPP
+)
+{
+	SwizzleBox<false>((uint08 *)pSrc, dwWidth, dwHeight, dwDepth, dwX, dwY, dwZ,
+		(uint08 *)pDst, dwRowPitch, dwSlicePitch, dwCopyWidth, dwCopyHeight, dwCopyDepth, dwBPP);
+}
+
+void XTL::EmuSwizzleBox
+(
+	const void *pSrc,
+	DWORD dwRowPitch,
+	DWORD dwSlicePitch,
+	void *pDst,
+	DWORD dwWidth,
+	DWORD dwHeight,
+	DWORD dwDepth,
+	DWORD dwX,
+	DWORD dwY,
+	DWORD dwZ,
+	DWORD dwCopyWidth,
+	DWORD dwCopyHeight,
+	DWORD dwCopyDepth,
+	DWORD dwBPP
+)
+{
+	SwizzleBox<true>((uint08 *)pDst, dwWidth, dwHeight, dwDepth, dwX, dwY, dwZ,
+		(uint08 *)pSrc, dwRowPitch, dwSlicePitch, dwCopyWidth, dwCopyHeight, dwCopyDepth, dwBPP);
+}
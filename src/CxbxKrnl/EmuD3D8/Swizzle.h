@@ -0,0 +1,88 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Win32->CxbxKrnl->EmuD3D8->Swizzle.h
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef SWIZZLE_H
+#define SWIZZLE_H
+
+#include "Cxbx.h"
+
+// Xbox textures are swizzled in Morton (Z-)order : starting at the lowest bit, the
+// coordinate bits of x, y and z are interleaved for as long as each dimension has bits
+// left, after which the bits of the remaining (larger) dimensions follow contiguously.
+//
+// The functions below convert a (sub-)box between that layout and a linear layout,
+// using per-axis lookup tables instead of stepping through the masks per pixel.
+// Texels of 1, 2, 4, 8 and 16 bytes are copied with native moves; other sizes work,
+// but fall back to a memcpy per texel.
+
+// Copies a dwCopyWidth x dwCopyHeight x dwCopyDepth box, starting at (dwX, dwY, dwZ)
+// in the swizzled dwWidth x dwHeight x dwDepth image at pSrc, to the linear image at pDst
+extern void EmuUnswizzleBox
+(
+	const void *pSrc,
+	DWORD dwWidth,
+	DWORD dwHeight,
+	DWORD dwDepth,
+	DWORD dwX,
+	DWORD dwY,
+	DWORD dwZ,
+	void *pDst,
+	DWORD dwRowPitch,
+	DWORD dwSlicePitch,
+	DWORD dwCopyWidth,
+	DWORD dwCopyHeight,
+	DWORD dwCopyDepth,
+	DWORD dwBPP // expressed in Bytes Per Pixel
+);
+
+// Copies a dwCopyWidth x dwCopyHeight x dwCopyDepth box from the linear image at pSrc,
+// to (dwX, dwY, dwZ) in the swizzled dwWidth x dwHeight x dwDepth image at pDst
+extern void EmuSwizzleBox
+(
+	const void *pSrc,
+	DWORD dwRowPitch,
+	DWORD dwSlicePitch,
+	void *pDst,
+	DWORD dwWidth,
+	DWORD dwHeight,
+	DWORD dwDepth,
+	DWORD dwX,
+	DWORD dwY,
+	DWORD dwZ,
+	DWORD dwCopyWidth,
+	DWORD dwCopyHeight,
+	DWORD dwCopyDepth,
+	DWORD dwBPP // expressed in Bytes Per Pixel
+);
+
+#endif
@@ -0,0 +1,444 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Win32->CxbxKrnl->EmuD3D8->TextureCache.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#define _CXBXKRNL_INTERNAL
+#define _XBOXKRNL_DEFEXTRN_
+
+#include "CxbxKrnl/Emu.h"
+#include "CxbxKrnl/EmuXTL.h"
+#include "CxbxKrnl/CxbxKrnl.h"
+#include "CxbxKrnl/xxhash32.h"
+#include "Common/Win32/Mutex.h"
+
+#include <algorithm>
+#include <iterator>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+// Report the cache statistics once every this many frames
+#define TEXTURE_CACHE_REPORT_INTERVAL 600
+
+struct TextureCacheEntry
+{
+	XTL::TEXTURE_CACHE_KEY Key;
+	uint32_t Hash;                             // hash over PageHashes
+	std::vector<uint32_t> PageHashes;          // hash of each page of the Xbox data
+	const void *pData;                         // where the Xbox data was last read from
+	XTL::IDirect3DBaseTexture8 *pHostTexture;  // owned by the cache
+	DWORD HostSize;
+	DWORD LastFrame;                           // the frame in which the texture was last handed out
+	std::vector<XTL::X_D3DResource *> Users;   // Xbox resources currently using the texture
+	std::list<TextureCacheEntry *>::iterator LruPosition;
+};
+
+class TextureCache : public Mutex
+{
+	public:
+		TextureCache();
+
+		void Initialize(ULONGLONG BudgetBytes);
+		XTL::IDirect3DBaseTexture8 *Lookup(XTL::X_D3DResource *pResource, const void *pData, const XTL::TEXTURE_CACHE_KEY *pKey, DWORD *pdwDirtyLevels);
+		void Insert(XTL::X_D3DResource *pResource, XTL::IDirect3DBaseTexture8 *pHostTexture, const void *pData, const XTL::TEXTURE_CACHE_KEY *pKey, DWORD dwHostSize);
+		void Release(XTL::X_D3DResource *pResource);
+		void Detach(XTL::IDirect3DBaseTexture8 *pHostTexture);
+		void EndFrame();
+		void GetStatistics(XTL::TEXTURE_CACHE_STATISTICS *pStatistics);
+
+	private:
+		static uint32_t HashPages(const void *pData, const XTL::TEXTURE_CACHE_KEY *pKey, std::vector<uint32_t> &PageHashes);
+		static bool SameKey(const XTL::TEXTURE_CACHE_KEY *pKey1, const XTL::TEXTURE_CACHE_KEY *pKey2);
+		static DWORD LevelBytes(const XTL::TEXTURE_CACHE_KEY *pKey, DWORD dwLevels);
+
+		TextureCacheEntry *Find(uint32_t Hash, const XTL::TEXTURE_CACHE_KEY *pKey, const std::vector<uint32_t> &PageHashes);
+		void Use(TextureCacheEntry *pEntry, XTL::X_D3DResource *pResource);
+		void RemoveUser(XTL::X_D3DResource *pResource);
+		void Remove(TextureCacheEntry *pEntry);
+		void Evict();
+
+		std::unordered_multimap<uint32_t, TextureCacheEntry *> m_Entries;                 // by content hash
+		std::unordered_map<const void *, TextureCacheEntry *> m_AddressEntries;            // last entry made from an address
+		std::unordered_map<XTL::X_D3DResource *, TextureCacheEntry *> m_ResourceEntries;  // entry used by an Xbox resource
+		std::unordered_map<XTL::IDirect3DBaseTexture8 *, TextureCacheEntry *> m_HostEntries;
+		std::list<TextureCacheEntry *> m_Lru;                                              // most recently used first
+		std::vector<uint32_t> m_PageHashes;                                                // scratch space for lookups
+
+		DWORD m_Frame;
+		ULONGLONG m_CurrentFrameUploadedBytes;
+		XTL::TEXTURE_CACHE_STATISTICS m_Statistics;
+};
+
+static TextureCache g_TextureCache;
+
+TextureCache::TextureCache() : m_Frame(0), m_CurrentFrameUploadedBytes(0)
+{
+	memset(&m_Statistics, 0, sizeof(m_Statistics));
+}
+
+uint32_t TextureCache::HashPages(const void *pData, const XTL::TEXTURE_CACHE_KEY *pKey, std::vector<uint32_t> &PageHashes)
+{
+	DWORD dwPages = (pKey->DataSize + TEXTURE_CACHE_PAGE_SIZE - 1) / TEXTURE_CACHE_PAGE_SIZE;
+
+	PageHashes.resize(dwPages);
+	for (DWORD p = 0; p < dwPages; p++) {
+		DWORD dwOffset = p * TEXTURE_CACHE_PAGE_SIZE;
+		DWORD dwSize = (pKey->DataSize - dwOffset < TEXTURE_CACHE_PAGE_SIZE) ? pKey->DataSize - dwOffset : TEXTURE_CACHE_PAGE_SIZE;
+
+		PageHashes[p] = XXHash32::hash((const uint08 *)pData + dwOffset, dwSize, p);
+	}
+
+	return XXHash32::hash(PageHashes.data(), dwPages * sizeof(uint32_t), pKey->Format ^ pKey->Size ^ pKey->Variant);
+}
+
+bool TextureCache::SameKey(const XTL::TEXTURE_CACHE_KEY *pKey1, const XTL::TEXTURE_CACHE_KEY *pKey2)
+{
+	return pKey1->Format == pKey2->Format
+		&& pKey1->Size == pKey2->Size
+		&& pKey1->Variant == pKey2->Variant
+		&& pKey1->DataSize == pKey2->DataSize
+		&& pKey1->LevelCount == pKey2->LevelCount
+		&& memcmp(pKey1->LevelEnd, pKey2->LevelEnd, pKey1->LevelCount * sizeof(DWORD)) == 0;
+}
+
+// Returns the number of bytes of Xbox data in the levels set in dwLevels
+DWORD TextureCache::LevelBytes(const XTL::TEXTURE_CACHE_KEY *pKey, DWORD dwLevels)
+{
+	DWORD dwBytes = 0;
+
+	for (DWORD l = 0; l < pKey->LevelCount; l++)
+		if (dwLevels & (1 << l))
+			dwBytes += pKey->LevelEnd[l] - ((l > 0) ? pKey->LevelEnd[l - 1] : 0);
+
+	return dwBytes;
+}
+
+TextureCacheEntry *TextureCache::Find(uint32_t Hash, const XTL::TEXTURE_CACHE_KEY *pKey, const std::vector<uint32_t> &PageHashes)
+{
+	auto range = m_Entries.equal_range(Hash);
+	for (auto it = range.first; it != range.second; ++it) {
+		TextureCacheEntry *pEntry = it->second;
+
+		// A texture is never shared by live Xbox resources : writes to it on the host side
+		// (through LockRect or a surface level) would show up in all of them
+		if (!pEntry->Users.empty())
+			continue;
+
+		// Compare all page hashes, which makes a collision as unlikely as it gets without keeping a copy of the data
+		if (SameKey(&pEntry->Key, pKey) && pEntry->PageHashes == PageHashes)
+			return pEntry;
+	}
+
+	return nullptr;
+}
+
+void TextureCache::Use(TextureCacheEntry *pEntry, XTL::X_D3DResource *pResource)
+{
+	pEntry->Users.push_back(pResource);
+	pEntry->LastFrame = m_Frame;
+	m_ResourceEntries[pResource] = pEntry;
+
+	m_Lru.splice(m_Lru.begin(), m_Lru, pEntry->LruPosition);
+}
+
+void TextureCache::RemoveUser(XTL::X_D3DResource *pResource)
+{
+	auto it = m_ResourceEntries.find(pResource);
+	if (it == m_ResourceEntries.end())
+		return;
+
+	std::vector<XTL::X_D3DResource *> &Users = it->second->Users;
+	Users.erase(std::find(Users.begin(), Users.end(), pResource));
+	m_ResourceEntries.erase(it);
+}
+
+// Forgets about an entry, without releasing it's texture
+void TextureCache::Remove(TextureCacheEntry *pEntry)
+{
+	auto range = m_Entries.equal_range(pEntry->Hash);
+	for (auto it = range.first; it != range.second; ++it) {
+		if (it->second == pEntry) {
+			m_Entries.erase(it);
+			break;
+		}
+	}
+
+	auto address = m_AddressEntries.find(pEntry->pData);
+	if (address != m_AddressEntries.end() && address->second == pEntry)
+		m_AddressEntries.erase(address);
+
+	for (auto it = pEntry->Users.begin(); it != pEntry->Users.end(); ++it)
+		m_ResourceEntries.erase(*it);
+
+	m_HostEntries.erase(pEntry->pHostTexture);
+	m_Lru.erase(pEntry->LruPosition);
+
+	m_Statistics.Entries--;
+	m_Statistics.CachedBytes -= pEntry->HostSize;
+
+	delete pEntry;
+}
+
+// Releases unused textures, least recently used first, until the cache fits it's budget again
+void TextureCache::Evict()
+{
+	if (m_Statistics.BudgetBytes == 0)
+		return;
+
+	auto it = m_Lru.end();
+	while (m_Statistics.CachedBytes > m_Statistics.BudgetBytes && it != m_Lru.begin()) {
+		TextureCacheEntry *pEntry = *(--it);
+
+		// Leave textures that are in use, or were handed out in this or the previous frame
+		if (!pEntry->Users.empty() || pEntry->LastFrame + 1 >= m_Frame)
+			continue;
+
+		XTL::IDirect3DBaseTexture8 *pHostTexture = pEntry->pHostTexture;
+
+		// Continue from the (more recently used) neighbour, which Remove leaves alone
+		it = std::next(it);
+		Remove(pEntry);
+
+		pHostTexture->Release();
+		m_Statistics.Evictions++;
+	}
+}
+
+void TextureCache::Initialize(ULONGLONG BudgetBytes)
+{
+	Lock();
+
+	m_Statistics.BudgetBytes = BudgetBytes;
+	Evict();
+
+	Unlock();
+}
+
+XTL::IDirect3DBaseTexture8 *TextureCache::Lookup(XTL::X_D3DResource *pResource, const void *pData, const XTL::TEXTURE_CACHE_KEY *pKey, DWORD *pdwDirtyLevels)
+{
+	Lock();
+
+	m_Statistics.Lookups++;
+
+	// A resource that is registered again no longer uses the texture it was given before
+	RemoveUser(pResource);
+
+	uint32_t Hash = HashPages(pData, pKey, m_PageHashes);
+	XTL::IDirect3DBaseTexture8 *pHostTexture = nullptr;
+
+	TextureCacheEntry *pEntry = Find(Hash, pKey, m_PageHashes);
+	if (pEntry != nullptr) {
+		m_Statistics.Hits++;
+		*pdwDirtyLevels = 0;
+	}
+	else {
+		// When the texture made from this address last time isn't used by anyone else,
+		// it can be brought up to date by uploading only the levels on changed pages
+		auto it = m_AddressEntries.find(pData);
+		if (it != m_AddressEntries.end() && it->second->Users.empty() && SameKey(&it->second->Key, pKey)) {
+			pEntry = it->second;
+
+			DWORD dwDirtyLevels = 0;
+			for (DWORD p = 0; p < m_PageHashes.size(); p++) {
+				if (m_PageHashes[p] == pEntry->PageHashes[p])
+					continue;
+
+				DWORD dwPageStart = p * TEXTURE_CACHE_PAGE_SIZE;
+				DWORD dwPageEnd = dwPageStart + TEXTURE_CACHE_PAGE_SIZE;
+
+				for (DWORD l = 0; l < pKey->LevelCount; l++) {
+					DWORD dwLevelStart = (l > 0) ? pKey->LevelEnd[l - 1] : 0;
+					if (dwLevelStart < dwPageEnd && pKey->LevelEnd[l] > dwPageStart)
+						dwDirtyLevels |= 1 << l;
+				}
+			}
+
+			// Rehash the entry under it's new contents
+			auto range = m_Entries.equal_range(pEntry->Hash);
+			for (auto e = range.first; e != range.second; ++e) {
+				if (e->second == pEntry) {
+					m_Entries.erase(e);
+					break;
+				}
+			}
+
+			pEntry->Hash = Hash;
+			pEntry->PageHashes.swap(m_PageHashes);
+			m_Entries.emplace(Hash, pEntry);
+
+			DWORD dwUploadBytes = LevelBytes(pKey, dwDirtyLevels);
+			m_Statistics.PartialHits++;
+			m_Statistics.UploadedBytes += dwUploadBytes;
+			m_CurrentFrameUploadedBytes += dwUploadBytes;
+
+			*pdwDirtyLevels = dwDirtyLevels;
+		}
+	}
+
+	if (pEntry != nullptr) {
+		Use(pEntry, pResource);
+		pHostTexture = pEntry->pHostTexture;
+	}
+
+	Unlock();
+
+	return pHostTexture;
+}
+
+void TextureCache::Insert(XTL::X_D3DResource *pResource, XTL::IDirect3DBaseTexture8 *pHostTexture, const void *pData, const XTL::TEXTURE_CACHE_KEY *pKey, DWORD dwHostSize)
+{
+	Lock();
+
+	RemoveUser(pResource);
+
+	TextureCacheEntry *pEntry = new TextureCacheEntry();
+	pEntry->Key = *pKey;
+	pEntry->Hash = HashPages(pData, pKey, pEntry->PageHashes);
+	pEntry->pData = pData;
+	pEntry->pHostTexture = pHostTexture;
+	pEntry->HostSize = dwHostSize;
+	pEntry->LruPosition = m_Lru.insert(m_Lru.begin(), pEntry);
+
+	m_Entries.emplace(pEntry->Hash, pEntry);
+	m_AddressEntries[pData] = pEntry;
+	m_HostEntries[pHostTexture] = pEntry;
+	Use(pEntry, pResource);
+
+	m_Statistics.Entries++;
+	m_Statistics.CachedBytes += dwHostSize;
+	m_Statistics.UploadedBytes += pKey->DataSize;
+	m_CurrentFrameUploadedBytes += pKey->DataSize;
+
+	Evict();
+
+	Unlock();
+}
+
+void TextureCache::Release(XTL::X_D3DResource *pResource)
+{
+	Lock();
+
+	RemoveUser(pResource);
+
+	Unlock();
+}
+
+void TextureCache::Detach(XTL::IDirect3DBaseTexture8 *pHostTexture)
+{
+	Lock();
+
+	auto it = m_HostEntries.find(pHostTexture);
+	if (it != m_HostEntries.end())
+		Remove(it->second);
+
+	Unlock();
+}
+
+void TextureCache::EndFrame()
+{
+	Lock();
+
+	m_Frame++;
+	m_Statistics.FrameUploadedBytes = m_CurrentFrameUploadedBytes;
+	m_CurrentFrameUploadedBytes = 0;
+
+	if (m_Frame % TEXTURE_CACHE_REPORT_INTERVAL == 0 && m_Statistics.Lookups > 0) {
+		DbgPrintf("TextureCache: %d of %d lookups hit (%d partially), %d textures using %d of %d KB, %d KB uploaded last frame, %d evicted\n",
+			m_Statistics.Hits + m_Statistics.PartialHits, m_Statistics.Lookups, m_Statistics.PartialHits,
+			m_Statistics.Entries, (DWORD)(m_Statistics.CachedBytes / ONE_KB), (DWORD)(m_Statistics.BudgetBytes / ONE_KB),
+			(DWORD)(m_Statistics.FrameUploadedBytes / ONE_KB), m_Statistics.Evictions);
+	}
+
+	// Textures handed out two frames ago may be released now
+	Evict();
+
+	Unlock();
+}
+
+void TextureCache::GetStatistics(XTL::TEXTURE_CACHE_STATISTICS *pStatistics)
+{
+	Lock();
+
+	*pStatistics = m_Statistics;
+
+	Unlock();
+}
+
+void XTL::EmuTextureCacheInitialize(ULONGLONG BudgetBytes)
+{
+	g_TextureCache.Initialize(BudgetBytes);
+}
+
+XTL::IDirect3DBaseTexture8 *XTL::EmuTextureCacheLookup
+(
+	X_D3DResource           *pResource,
+	const void              *pData,
+	const TEXTURE_CACHE_KEY *pKey,
+	DWORD                   *pdwDirtyLevels
+)
+{
+	return g_TextureCache.Lookup(pResource, pData, pKey, pdwDirtyLevels);
+}
+
+void XTL::EmuTextureCacheInsert
+(
+	X_D3DResource           *pResource,
+	IDirect3DBaseTexture8   *pHostTexture,
+	const void              *pData,
+	const TEXTURE_CACHE_KEY *pKey,
+	DWORD                    dwHostSize
+)
+{
+	g_TextureCache.Insert(pResource, pHostTexture, pData, pKey, dwHostSize);
+}
+
+void XTL::EmuTextureCacheRelease(X_D3DResource *pResource)
+{
+	g_TextureCache.Release(pResource);
+}
+
+void XTL::EmuTextureCacheDetach(IDirect3DBaseTexture8 *pHostTexture)
+{
+	g_TextureCache.Detach(pHostTexture);
+}
+
+void XTL::EmuTextureCacheEndFrame()
+{
+	g_TextureCache.EndFrame();
+}
+
+void XTL::EmuTextureCacheGetStatistics(TEXTURE_CACHE_STATISTICS *pStatistics)
+{
+	g_TextureCache.GetStatistics(pStatistics);
+}
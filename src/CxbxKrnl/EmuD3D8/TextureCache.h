@@ -0,0 +1,122 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Win32->CxbxKrnl->EmuD3D8->TextureCache.h
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+#include "Cxbx.h"
+
+// The texture cache keeps the host textures made by D3DResource_Register, keyed on
+// the Xbox format and dimensions plus a hash of the Xbox texel data. Registering a
+// texture with the same contents again (as titles do when they recreate resources)
+// reuses the host texture, instead of unswizzling, converting and uploading it again.
+// A host texture has at most one Xbox resource using it at any time, since writes to
+// it on the host side would otherwise show up in every resource that shares it.
+//
+// The data is hashed per page, so that when a texture is re-registered from the same
+// address with partly changed contents, only the mipmap levels that touch a changed
+// page need to be uploaded again. Textures no Xbox resource uses anymore are released,
+// least recently used first, once the cache grows beyond its budget.
+
+// Pages in which the Xbox data of a cached texture is hashed
+#define TEXTURE_CACHE_PAGE_SIZE 0x1000
+
+// Mipmap levels a cached texture can have (dirty levels are passed as a bit mask)
+#define TEXTURE_CACHE_MAX_LEVELS 16
+
+// Describes the Xbox texture a host texture is made from
+typedef struct _TEXTURE_CACHE_KEY
+{
+	DWORD Format;     // X_D3DPixelContainer::Format
+	DWORD Size;       // X_D3DPixelContainer::Size
+	DWORD Variant;    // any other state the conversion depends upon (like a palette hash)
+	DWORD DataSize;   // bytes of Xbox data, over all levels
+	DWORD LevelCount;
+	DWORD LevelEnd[TEXTURE_CACHE_MAX_LEVELS]; // offset in the Xbox data at which each level ends
+}
+TEXTURE_CACHE_KEY;
+
+typedef struct _TEXTURE_CACHE_STATISTICS
+{
+	DWORD     Lookups;           // number of lookups
+	DWORD     Hits;              // lookups that needed no upload at all
+	DWORD     PartialHits;       // lookups that needed only some levels uploaded
+	DWORD     Evictions;         // textures released to stay within the budget
+	DWORD     Entries;           // textures currently cached
+	ULONGLONG CachedBytes;       // host memory used by the cached textures (estimated)
+	ULONGLONG BudgetBytes;       // host memory the cache tries to stay within
+	ULONGLONG UploadedBytes;     // Xbox data uploaded, in total
+	ULONGLONG FrameUploadedBytes;// Xbox data uploaded during the last completed frame
+}
+TEXTURE_CACHE_STATISTICS;
+
+// Sets the host memory budget of the texture cache
+extern void EmuTextureCacheInitialize(ULONGLONG BudgetBytes);
+
+// Looks up a host texture for the given Xbox data. Returns nullptr on a miss, after
+// which the caller should create and upload a texture and call EmuTextureCacheInsert.
+// Otherwise pResource is registered as a user of the returned texture, and
+// *pdwDirtyLevels receives a mask of the levels that must be uploaded again (zero
+// when the texture is up to date).
+extern IDirect3DBaseTexture8 *EmuTextureCacheLookup
+(
+	X_D3DResource           *pResource,
+	const void              *pData,
+	const TEXTURE_CACHE_KEY *pKey,
+	DWORD                   *pdwDirtyLevels
+);
+
+// Adds a fully uploaded texture to the cache, with pResource as it's first user.
+// The cache takes over the reference the caller holds on pHostTexture.
+extern void EmuTextureCacheInsert
+(
+	X_D3DResource           *pResource,
+	IDirect3DBaseTexture8   *pHostTexture,
+	const void              *pData,
+	const TEXTURE_CACHE_KEY *pKey,
+	DWORD                    dwHostSize
+);
+
+// Removes pResource from the users of it's cached texture (when it's released)
+extern void EmuTextureCacheRelease(X_D3DResource *pResource);
+
+// Stops caching a texture whose contents are about to be changed on the host side
+// (like through LockRect), leaving it to the (only) Xbox resource that uses it.
+extern void EmuTextureCacheDetach(IDirect3DBaseTexture8 *pHostTexture);
+
+// Marks the end of a frame, which updates the per frame statistics
+extern void EmuTextureCacheEndFrame();
+
+extern void EmuTextureCacheGetStatistics(TEXTURE_CACHE_STATISTICS *pStatistics);
+
+#endif
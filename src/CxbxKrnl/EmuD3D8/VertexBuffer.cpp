@@ -476,130 +476,36 @@ bool XTL::VertexPatcher::PatchStream(VertexPatchDesc *pPatchDesc,
         }
     }
 
-	for (uint32 uiVertex = 0; uiVertex < uiVertexCount; uiVertex++)
+	// Convert one attribute at a time, over all vertices, using the kernel for it's type.
+	// Dxbx note : Only the D3DVSDT enums that need conversion have a kernel;
+	// All other types are copied (consecutive ones combined into a single copy).
+	UINT uiOrigOffset = 0;
+	UINT uiNewOffset = 0;
+	UINT uiCopySize = 0;
+	for (UINT uiType = 0; uiType < pStreamPatch->NbrTypes; uiType++)
 	{
-		uint08 *pOrigVertex = &pOrigData[uiVertex * uiStride];
-		uint08 *pNewDataPos = &pNewData[uiVertex * pStreamPatch->ConvertedStride];
-		for (UINT uiType = 0; uiType < pStreamPatch->NbrTypes; uiType++)
+		UINT uiOrigSize;
+		VertexConvertKernel Kernel = EmuGetVertexConvertKernel(pStreamPatch->pTypes[uiType], &uiOrigSize);
+		if (Kernel == nullptr)
 		{
-			// Dxbx note : The following code handles only the D3DVSDT enums that need conversion;
-			// All other cases are catched by the memcpy in the default-block.
-			switch (pStreamPatch->pTypes[uiType])
-			{
-			case X_D3DVSDT_NORMPACKED3: { // 0x16: // Make it FLOAT3
-				// Hit by Dashboard
-				int32 iPacked = ((int32 *)pOrigVertex)[0];
-				// Cxbx note : to make each component signed, two need to be shifted towards the sign-bit first :
-				((FLOAT *)pNewDataPos)[0] = ((FLOAT)((iPacked << 21) >> 21)) / 1023.0f;
-				((FLOAT *)pNewDataPos)[1] = ((FLOAT)((iPacked << 10) >> 21)) / 1023.0f;
-				((FLOAT *)pNewDataPos)[2] = ((FLOAT)((iPacked      ) >> 22)) / 511.0f;
-				pOrigVertex += 1 * sizeof(int32);
-				break;
-			}
-			case X_D3DVSDT_SHORT1: { // 0x15: // Make it SHORT2 and set the second short to 0
-				((SHORT *)pNewDataPos)[0] = ((SHORT*)pOrigVertex)[0];
-				((SHORT *)pNewDataPos)[1] = 0x00;
-				pOrigVertex += 1 * sizeof(SHORT);
-				break;
-			}
-			case X_D3DVSDT_SHORT3: { // 0x35: // Make it a SHORT4 and set the fourth short to 1
-				// Hit by Turok
-				memcpy(pNewDataPos, pOrigVertex, 3 * sizeof(SHORT));
-				((SHORT *)pNewDataPos)[3] = 0x01;
-				pOrigVertex += 3 * sizeof(SHORT);
-				break;
-			}
-			case X_D3DVSDT_PBYTE1: { // 0x14:  // Make it FLOAT1
-				((FLOAT *)pNewDataPos)[0] = ((FLOAT)((BYTE*)pOrigVertex)[0]) / 255.0f;
-				pOrigVertex += 1 * sizeof(BYTE);
-				break;
-			}
-			case X_D3DVSDT_PBYTE2: { // 0x24:  // Make it FLOAT2
-				((FLOAT *)pNewDataPos)[0] = ((FLOAT)((BYTE*)pOrigVertex)[0]) / 255.0f;
-				((FLOAT *)pNewDataPos)[1] = ((FLOAT)((BYTE*)pOrigVertex)[1]) / 255.0f;
-				pOrigVertex += 2 * sizeof(BYTE);
-				break;
-			}
-			case X_D3DVSDT_PBYTE3: { // 0x34: // Make it FLOAT3
-				// Hit by Turok
-				((FLOAT *)pNewDataPos)[0] = ((FLOAT)((BYTE*)pOrigVertex)[0]) / 255.0f;
-				((FLOAT *)pNewDataPos)[1] = ((FLOAT)((BYTE*)pOrigVertex)[1]) / 255.0f;
-				((FLOAT *)pNewDataPos)[2] = ((FLOAT)((BYTE*)pOrigVertex)[2]) / 255.0f;
-				pOrigVertex += 3 * sizeof(BYTE);
-				break;
-			}
-			case X_D3DVSDT_PBYTE4: { // 0x44: // Make it FLOAT4
-				// Hit by Jet Set Radio Future
-				((FLOAT *)pNewDataPos)[0] = ((FLOAT)((BYTE*)pOrigVertex)[0]) / 255.0f;
-				((FLOAT *)pNewDataPos)[1] = ((FLOAT)((BYTE*)pOrigVertex)[1]) / 255.0f;
-				((FLOAT *)pNewDataPos)[2] = ((FLOAT)((BYTE*)pOrigVertex)[2]) / 255.0f;
-				((FLOAT *)pNewDataPos)[3] = ((FLOAT)((BYTE*)pOrigVertex)[3]) / 255.0f;
-				pOrigVertex += 4 * sizeof(BYTE);
-				break;
-			}
-			case X_D3DVSDT_NORMSHORT1: { // 0x11: // Make it FLOAT1
-				// UNTESTED - Need test-case!
-				((FLOAT *)pNewDataPos)[0] = ((FLOAT)((SHORT*)pOrigVertex)[0]) / 32767.0f;
-				//((FLOAT *)pNewDataPos)[1] = 0.0f; // Would be needed for FLOAT2
-				pOrigVertex += 1 * sizeof(SHORT);
-				break;
-			}
-#if !DXBX_USE_D3D9 // No need for patching in D3D9
-			case X_D3DVSDT_NORMSHORT2: { // 0x21: // Make it FLOAT2
-				// UNTESTED - Need test-case!
-				((FLOAT *)pNewDataPos)[0] = ((FLOAT)((SHORT*)pOrigVertex)[0]) / 32767.0f;
-				((FLOAT *)pNewDataPos)[1] = ((FLOAT)((SHORT*)pOrigVertex)[1]) / 32767.0f;
-				pOrigVertex += 2 * sizeof(SHORT);
-				break;
-			}
-#endif
-			case X_D3DVSDT_NORMSHORT3: { // 0x31: // Make it FLOAT3
-				// UNTESTED - Need test-case!
-				((FLOAT *)pNewDataPos)[0] = ((FLOAT)((SHORT*)pOrigVertex)[0]) / 32767.0f;
-				((FLOAT *)pNewDataPos)[1] = ((FLOAT)((SHORT*)pOrigVertex)[1]) / 32767.0f;
-				((FLOAT *)pNewDataPos)[2] = ((FLOAT)((SHORT*)pOrigVertex)[2]) / 32767.0f;
-				pOrigVertex += 3 * sizeof(SHORT);
-				break;
-			}
-#if !DXBX_USE_D3D9 // No need for patching in D3D9
-			case X_D3DVSDT_NORMSHORT4: { // 0x41: // Make it FLOAT4
-				// UNTESTED - Need test-case!
-				((FLOAT *)pNewDataPos)[0] = ((FLOAT)((SHORT*)pOrigVertex)[0]) / 32767.0f;
-				((FLOAT *)pNewDataPos)[1] = ((FLOAT)((SHORT*)pOrigVertex)[1]) / 32767.0f;
-				((FLOAT *)pNewDataPos)[2] = ((FLOAT)((SHORT*)pOrigVertex)[2]) / 32767.0f;
-				((FLOAT *)pNewDataPos)[3] = ((FLOAT)((SHORT*)pOrigVertex)[3]) / 32767.0f;
-				pOrigVertex += 4 * sizeof(SHORT);
-				break;
-			}
-#endif
-			case X_D3DVSDT_FLOAT2H: { // 0x72: // Make it FLOAT4 and set the third float to 0.0
-				((FLOAT *)pNewDataPos)[0] = ((FLOAT*)pOrigVertex)[0];
-				((FLOAT *)pNewDataPos)[1] = ((FLOAT*)pOrigVertex)[1];
-				((FLOAT *)pNewDataPos)[2] = 0.0f;
-				((FLOAT *)pNewDataPos)[3] = ((FLOAT*)pOrigVertex)[2];
-				pOrigVertex += 3 * sizeof(FLOAT);
-				break;
-			}
-			/*TODO
-			case X_D3DVSDT_NONE: { // 0x02:
-				printf("D3DVSDT_NONE / xbox ext. nsp /");
-				dwNewDataType = 0xFF;
-				break;
-			}
-			*/
-			default: {
-				// Generic 'conversion' - just make a copy :
-				memcpy(pNewDataPos, pOrigVertex, pStreamPatch->pSizes[uiType]);
-				pOrigVertex += pStreamPatch->pSizes[uiType];
-				break;
-			}
-			} // switch
-
-			// Increment the new pointer :
-			pNewDataPos += pStreamPatch->pSizes[uiType];
+			// Generic 'conversion' - just make a copy (deferred, to combine it with the next ones) :
+			uiCopySize += pStreamPatch->pSizes[uiType];
+			continue;
 		}
+
+		// Flush the pending copy
+		EmuCopyVertexAttributes(&pOrigData[uiOrigOffset], uiStride, &pNewData[uiNewOffset], pStreamPatch->ConvertedStride, uiCopySize, uiVertexCount);
+		uiOrigOffset += uiCopySize;
+		uiNewOffset += uiCopySize;
+		uiCopySize = 0;
+
+		Kernel(&pOrigData[uiOrigOffset], uiStride, &pNewData[uiNewOffset], pStreamPatch->ConvertedStride, uiVertexCount);
+		uiOrigOffset += uiOrigSize;
+		uiNewOffset += pStreamPatch->pSizes[uiType];
 	}
 
+	EmuCopyVertexAttributes(&pOrigData[uiOrigOffset], uiStride, &pNewData[uiNewOffset], pStreamPatch->ConvertedStride, uiCopySize, uiVertexCount);
+
     if(!pPatchDesc->pVertexStreamZeroData)
     {
         //if(pNewVertexBuffer != nullptr) // Dxbx addition
@@ -0,0 +1,257 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Win32->CxbxKrnl->EmuD3D8->VertexConvert.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#define _CXBXKRNL_INTERNAL
+#define _XBOXKRNL_DEFEXTRN_
+
+#include "CxbxKrnl/Emu.h"
+#include "CxbxKrnl/EmuXTL.h"
+
+#include <emmintrin.h> // For SSE2 intrinsics
+
+// ******************************************************************
+// * Reference kernels
+// ******************************************************************
+// These handle one vertex at a time, exactly like VertexPatcher::PatchStream
+// always did. The SSE2 kernels below must produce bit-identical output.
+
+static void NormPacked3_C(const uint08 *pSrc, UINT uiSrcStride, uint08 *pDst, UINT uiDstStride, UINT uiCount)
+{
+	for (; uiCount > 0; uiCount--, pSrc += uiSrcStride, pDst += uiDstStride) {
+		int32 iPacked = ((int32 *)pSrc)[0];
+		// Cxbx note : to make each component signed, two need to be shifted towards the sign-bit first :
+		((FLOAT *)pDst)[0] = ((FLOAT)((iPacked << 21) >> 21)) / 1023.0f;
+		((FLOAT *)pDst)[1] = ((FLOAT)((iPacked << 10) >> 21)) / 1023.0f;
+		((FLOAT *)pDst)[2] = ((FLOAT)((iPacked      ) >> 22)) / 511.0f;
+	}
+}
+
+static void Short1_C(const uint08 *pSrc, UINT uiSrcStride, uint08 *pDst, UINT uiDstStride, UINT uiCount)
+{
+	// Make it SHORT2 and set the second short to 0
+	for (; uiCount > 0; uiCount--, pSrc += uiSrcStride, pDst += uiDstStride) {
+		((SHORT *)pDst)[0] = ((SHORT *)pSrc)[0];
+		((SHORT *)pDst)[1] = 0x00;
+	}
+}
+
+static void Short3_C(const uint08 *pSrc, UINT uiSrcStride, uint08 *pDst, UINT uiDstStride, UINT uiCount)
+{
+	// Make it a SHORT4 and set the fourth short to 1
+	for (; uiCount > 0; uiCount--, pSrc += uiSrcStride, pDst += uiDstStride) {
+		memcpy(pDst, pSrc, 3 * sizeof(SHORT));
+		((SHORT *)pDst)[3] = 0x01;
+	}
+}
+
+template <int COUNT>
+static void PByte_C(const uint08 *pSrc, UINT uiSrcStride, uint08 *pDst, UINT uiDstStride, UINT uiCount)
+{
+	for (; uiCount > 0; uiCount--, pSrc += uiSrcStride, pDst += uiDstStride) {
+		for (int i = 0; i < COUNT; i++)
+			((FLOAT *)pDst)[i] = ((FLOAT)((BYTE *)pSrc)[i]) / 255.0f;
+	}
+}
+
+template <int COUNT>
+static void NormShort_C(const uint08 *pSrc, UINT uiSrcStride, uint08 *pDst, UINT uiDstStride, UINT uiCount)
+{
+	for (; uiCount > 0; uiCount--, pSrc += uiSrcStride, pDst += uiDstStride) {
+		for (int i = 0; i < COUNT; i++)
+			((FLOAT *)pDst)[i] = ((FLOAT)((SHORT *)pSrc)[i]) / 32767.0f;
+	}
+}
+
+static void Float2H_C(const uint08 *pSrc, UINT uiSrcStride, uint08 *pDst, UINT uiDstStride, UINT uiCount)
+{
+	// Make it FLOAT4 and set the third float to 0.0
+	for (; uiCount > 0; uiCount--, pSrc += uiSrcStride, pDst += uiDstStride) {
+		((FLOAT *)pDst)[0] = ((FLOAT *)pSrc)[0];
+		((FLOAT *)pDst)[1] = ((FLOAT *)pSrc)[1];
+		((FLOAT *)pDst)[2] = 0.0f;
+		((FLOAT *)pDst)[3] = ((FLOAT *)pSrc)[2];
+	}
+}
+
+// ******************************************************************
+// * SSE2 kernels
+// ******************************************************************
+// Each vertex is converted using one integer to float conversion and one
+// division (which, like the scalar division, is correctly rounded).
+// Stores never write beyond the converted size of the attribute.
+
+static inline void StoreFloats(uint08 *pDst, __m128 Value, int Count)
+{
+	switch (Count) {
+	case 1: _mm_store_ss((float *)pDst, Value); break;
+	case 2: _mm_storel_pi((__m64 *)pDst, Value); break;
+	case 3:
+		_mm_storel_pi((__m64 *)pDst, Value);
+		_mm_store_ss((float *)pDst + 2, _mm_movehl_ps(Value, Value));
+		break;
+	case 4: _mm_storeu_ps((float *)pDst, Value); break;
+	}
+}
+
+static void NormPacked3_SSE2(const uint08 *pSrc, UINT uiSrcStride, uint08 *pDst, UINT uiDstStride, UINT uiCount)
+{
+	const __m128 Scale = _mm_setr_ps(1023.0f, 1023.0f, 511.0f, 1.0f);
+	for (; uiCount > 0; uiCount--, pSrc += uiSrcStride, pDst += uiDstStride) {
+		__m128i Packed = _mm_set1_epi32(((int32 *)pSrc)[0]);
+		// Shift the first two components towards the sign-bit (the third already is there),
+		// SSE2 has no per-lane shifts, so combine the differently shifted copies instead :
+		__m128i X = _mm_srai_epi32(_mm_slli_epi32(Packed, 21), 21);
+		__m128i Y = _mm_srai_epi32(_mm_slli_epi32(Packed, 10), 21);
+		__m128i Z = _mm_srai_epi32(Packed, 22);
+		__m128i XY = _mm_unpacklo_epi32(X, Y);             // X, Y, X, Y
+		__m128i XYZ = _mm_unpacklo_epi64(XY, Z);           // X, Y, Z, Z
+		StoreFloats(pDst, _mm_div_ps(_mm_cvtepi32_ps(XYZ), Scale), 3);
+	}
+}
+
+template <int COUNT>
+static void PByte_SSE2(const uint08 *pSrc, UINT uiSrcStride, uint08 *pDst, UINT uiDstStride, UINT uiCount)
+{
+	const __m128 Scale = _mm_set1_ps(255.0f);
+	const __m128i Zero = _mm_setzero_si128();
+	for (; uiCount > 0; uiCount--, pSrc += uiSrcStride, pDst += uiDstStride) {
+		// Read only COUNT bytes, so the end of the source is never passed
+		uint32 uiBytes = 0;
+		memcpy(&uiBytes, pSrc, COUNT);
+		__m128i Bytes = _mm_cvtsi32_si128(uiBytes);
+		__m128i Ints = _mm_unpacklo_epi16(_mm_unpacklo_epi8(Bytes, Zero), Zero);
+		StoreFloats(pDst, _mm_div_ps(_mm_cvtepi32_ps(Ints), Scale), COUNT);
+	}
+}
+
+template <int COUNT>
+static void NormShort_SSE2(const uint08 *pSrc, UINT uiSrcStride, uint08 *pDst, UINT uiDstStride, UINT uiCount)
+{
+	const __m128 Scale = _mm_set1_ps(32767.0f);
+	for (; uiCount > 0; uiCount--, pSrc += uiSrcStride, pDst += uiDstStride) {
+		// Read only COUNT shorts, so the end of the source is never passed
+		__m128i Shorts;
+		if (COUNT == 4) {
+			Shorts = _mm_loadl_epi64((const __m128i *)pSrc);
+		}
+		else {
+			// (Going through a stack copy instead stalls on store forwarding)
+			uint32 uiLow = 0;
+			memcpy(&uiLow, pSrc, ((COUNT < 2) ? COUNT : 2) * sizeof(SHORT));
+			Shorts = _mm_cvtsi32_si128(uiLow);
+			if (COUNT == 3)
+				Shorts = _mm_insert_epi16(Shorts, ((const uint16 *)pSrc)[2], 2);
+		}
+
+		// Sign-extend the shorts to 32 bit integers
+		__m128i Ints = _mm_srai_epi32(_mm_unpacklo_epi16(Shorts, Shorts), 16);
+		StoreFloats(pDst, _mm_div_ps(_mm_cvtepi32_ps(Ints), Scale), COUNT);
+	}
+}
+
+// ******************************************************************
+// * Kernel table
+// ******************************************************************
+static const struct VertexConvertEntry
+{
+	DWORD                    XboxType;
+	UINT                     uiSrcSize;
+	XTL::VertexConvertKernel Reference;
+	XTL::VertexConvertKernel SSE2;
+}
+VertexConvertTable[] = {
+	{ XTL::X_D3DVSDT_NORMPACKED3, 1 * sizeof(int32), NormPacked3_C,   NormPacked3_SSE2 }, // Make it FLOAT3
+	{ XTL::X_D3DVSDT_SHORT1,      1 * sizeof(SHORT), Short1_C,        Short1_C }, // Make it SHORT2
+	{ XTL::X_D3DVSDT_SHORT3,      3 * sizeof(SHORT), Short3_C,        Short3_C }, // Make it SHORT4
+	{ XTL::X_D3DVSDT_PBYTE1,      1 * sizeof(BYTE),  PByte_C<1>,      PByte_SSE2<1> }, // Make it FLOAT1
+	{ XTL::X_D3DVSDT_PBYTE2,      2 * sizeof(BYTE),  PByte_C<2>,      PByte_SSE2<2> }, // Make it FLOAT2
+	{ XTL::X_D3DVSDT_PBYTE3,      3 * sizeof(BYTE),  PByte_C<3>,      PByte_SSE2<3> }, // Make it FLOAT3
+	{ XTL::X_D3DVSDT_PBYTE4,      4 * sizeof(BYTE),  PByte_C<4>,      PByte_SSE2<4> }, // Make it FLOAT4
+	{ XTL::X_D3DVSDT_NORMSHORT1,  1 * sizeof(SHORT), NormShort_C<1>,  NormShort_SSE2<1> }, // Make it FLOAT1
+#if !DXBX_USE_D3D9 // No need for patching in D3D9
+	{ XTL::X_D3DVSDT_NORMSHORT2,  2 * sizeof(SHORT), NormShort_C<2>,  NormShort_SSE2<2> }, // Make it FLOAT2
+#endif
+	{ XTL::X_D3DVSDT_NORMSHORT3,  3 * sizeof(SHORT), NormShort_C<3>,  NormShort_SSE2<3> }, // Make it FLOAT3
+#if !DXBX_USE_D3D9 // No need for patching in D3D9
+	{ XTL::X_D3DVSDT_NORMSHORT4,  4 * sizeof(SHORT), NormShort_C<4>,  NormShort_SSE2<4> }, // Make it FLOAT4
+#endif
+	{ XTL::X_D3DVSDT_FLOAT2H,     3 * sizeof(FLOAT), Float2H_C,       Float2H_C }, // Make it FLOAT4
+};
+
+static const VertexConvertEntry *FindVertexConvertEntry(DWORD XboxType)
+{
+	for (size_t i = 0; i < ARRAYSIZE(VertexConvertTable); i++)
+		if (VertexConvertTable[i].XboxType == XboxType)
+			return &VertexConvertTable[i];
+
+	return nullptr;
+}
+
+XTL::VertexConvertKernel XTL::EmuGetVertexConvertKernel(DWORD XboxType, UINT *puiSrcSize)
+{
+	static const bool bHasSSE2 = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE) != FALSE;
+
+	const VertexConvertEntry *pEntry = FindVertexConvertEntry(XboxType);
+	if (pEntry == nullptr)
+		return nullptr;
+
+	*puiSrcSize = pEntry->uiSrcSize;
+	return bHasSSE2 ? pEntry->SSE2 : pEntry->Reference;
+}
+
+XTL::VertexConvertKernel XTL::EmuGetVertexConvertReferenceKernel(DWORD XboxType, UINT *puiSrcSize)
+{
+	const VertexConvertEntry *pEntry = FindVertexConvertEntry(XboxType);
+	if (pEntry == nullptr)
+		return nullptr;
+
+	*puiSrcSize = pEntry->uiSrcSize;
+	return pEntry->Reference;
+}
+
+void XTL::EmuCopyVertexAttributes(const uint08 *pSrc, UINT uiSrcStride, uint08 *pDst, UINT uiDstStride, UINT uiSize, UINT uiCount)
+{
+	if (uiSize == 0)
+		return;
+
+	// Both streams are contiguous; copy all at once
+	if (uiSrcStride == uiSize && uiDstStride == uiSize) {
+		memcpy(pDst, pSrc, uiSize * uiCount);
+		return;
+	}
+
+	for (; uiCount > 0; uiCount--, pSrc += uiSrcStride, pDst += uiDstStride)
+		memcpy(pDst, pSrc, uiSize);
+}
@@ -0,0 +1,53 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Win32->CxbxKrnl->EmuD3D8->VertexConvert.h
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef VERTEXCONVERT_H
+#define VERTEXCONVERT_H
+
+#include "Cxbx.h"
+
+// Converts uiCount attributes of a single Xbox vertex data type, read uiSrcStride
+// bytes apart, into their host equivalent, written uiDstStride bytes apart
+typedef void (*VertexConvertKernel)(const uint08 *pSrc, UINT uiSrcStride, uint08 *pDst, UINT uiDstStride, UINT uiCount);
+
+// Returns the conversion kernel (and the Xbox size) for the given X_D3DVSDT_* type,
+// or nullptr when the type is passed to the host as-is (and just needs a copy)
+extern VertexConvertKernel EmuGetVertexConvertKernel(DWORD XboxType, UINT *puiSrcSize);
+
+// Returns the plain C++ conversion kernel for the given type (the reference for all others)
+extern VertexConvertKernel EmuGetVertexConvertReferenceKernel(DWORD XboxType, UINT *puiSrcSize);
+
+// Copies uiSize bytes per vertex, for uiCount vertices
+extern void EmuCopyVertexAttributes(const uint08 *pSrc, UINT uiSrcStride, uint08 *pDst, UINT uiDstStride, UINT uiSize, UINT uiCount);
+
+#endif
@@ -45,6 +45,8 @@
 #include "CxbxKrnl/MemoryManager.h"
 #include "CxbxKrnl/EmuD3D8Types.h" // For X_D3DVSDE_*
 
+#include <vector>
+
 // ****************************************************************************
 // * Vertex shader function recompiler
 // ****************************************************************************
@@ -2081,6 +2083,60 @@ static DWORD VshRecompileToken(DWORD          *pToken,
     return Step;
 }
 
+// A cached declaration translation consists of the recompiled declaration, followed by
+// NbrStreams and then per stream : NeedPatch, ConvertedStride, NbrTypes, pTypes[], pSizes[]
+static void VshWriteDeclarationTranslation
+(
+    DWORD                      *pRecompiledDeclaration,
+    DWORD                       DeclarationSize,
+    XTL::VERTEX_DYNAMIC_PATCH  *pVertexDynamicPatch,
+    std::vector<DWORD>         &Translation
+)
+{
+    Translation.assign(pRecompiledDeclaration, pRecompiledDeclaration + (DeclarationSize / sizeof(DWORD)));
+    Translation.push_back(pVertexDynamicPatch->NbrStreams);
+    for (XTL::UINT i = 0; i < pVertexDynamicPatch->NbrStreams; i++)
+    {
+        XTL::STREAM_DYNAMIC_PATCH *pStreamPatch = &pVertexDynamicPatch->pStreamPatches[i];
+
+        Translation.push_back(pStreamPatch->NeedPatch);
+        Translation.push_back(pStreamPatch->ConvertedStride);
+        Translation.push_back(pStreamPatch->NbrTypes);
+        Translation.insert(Translation.end(), pStreamPatch->pTypes, pStreamPatch->pTypes + pStreamPatch->NbrTypes);
+        Translation.insert(Translation.end(), pStreamPatch->pSizes, pStreamPatch->pSizes + pStreamPatch->NbrTypes);
+    }
+}
+
+static void VshReadDeclarationTranslation
+(
+    const DWORD                *pTranslation,
+    DWORD                       DeclarationSize,
+    DWORD                     **ppRecompiledDeclaration,
+    XTL::VERTEX_DYNAMIC_PATCH  *pVertexDynamicPatch
+)
+{
+    *ppRecompiledDeclaration = (DWORD *)malloc(DeclarationSize);
+    memcpy(*ppRecompiledDeclaration, pTranslation, DeclarationSize);
+    pTranslation += DeclarationSize / sizeof(DWORD);
+
+    pVertexDynamicPatch->NbrStreams = *pTranslation++;
+    pVertexDynamicPatch->pStreamPatches = (XTL::STREAM_DYNAMIC_PATCH *)malloc(pVertexDynamicPatch->NbrStreams * sizeof(XTL::STREAM_DYNAMIC_PATCH));
+    for (XTL::UINT i = 0; i < pVertexDynamicPatch->NbrStreams; i++)
+    {
+        XTL::STREAM_DYNAMIC_PATCH *pStreamPatch = &pVertexDynamicPatch->pStreamPatches[i];
+
+        pStreamPatch->NeedPatch = *pTranslation++;
+        pStreamPatch->ConvertedStride = *pTranslation++;
+        pStreamPatch->NbrTypes = *pTranslation++;
+        pStreamPatch->pTypes = (XTL::UINT *)malloc(pStreamPatch->NbrTypes * sizeof(XTL::UINT));
+        memcpy(pStreamPatch->pTypes, pTranslation, pStreamPatch->NbrTypes * sizeof(XTL::UINT));
+        pTranslation += pStreamPatch->NbrTypes;
+        pStreamPatch->pSizes = (XTL::UINT *)malloc(pStreamPatch->NbrTypes * sizeof(XTL::UINT));
+        memcpy(pStreamPatch->pSizes, pTranslation, pStreamPatch->NbrTypes * sizeof(XTL::UINT));
+        pTranslation += pStreamPatch->NbrTypes;
+    }
+}
+
 DWORD XTL::EmuRecompileVshDeclaration
 (
     DWORD                *pDeclaration,
@@ -2100,10 +2156,20 @@ DWORD XTL::EmuRecompileVshDeclaration
 
     // Calculate size of declaration
     DWORD DeclarationSize = VshGetDeclarationSize(pDeclaration);
+    *pDeclarationSize = DeclarationSize;
+
+    // Reuse an earlier translation of this declaration, if there is one
+    const void *pTranslation;
+    DWORD TranslationSize;
+    if (EmuShaderCacheLookup(SHADER_CACHE_VERTEX_DECLARATION, IsFixedFunction, pDeclaration, DeclarationSize, &pTranslation, &TranslationSize))
+    {
+        VshReadDeclarationTranslation((const DWORD *)pTranslation, DeclarationSize, ppRecompiledDeclaration, pVertexDynamicPatch);
+        return D3D_OK;
+    }
+
     *ppRecompiledDeclaration = (DWORD *)malloc(DeclarationSize);
     DWORD *pRecompiled = *ppRecompiledDeclaration;
     memcpy(pRecompiled, pDeclaration, DeclarationSize);
-    *pDeclarationSize = DeclarationSize;
 
     // TODO: Put these in one struct
     VSH_PATCH_DATA       PatchData = { 0 };
@@ -2130,9 +2196,37 @@ DWORD XTL::EmuRecompileVshDeclaration
            PatchData.StreamPatchData.pStreamPatches,
            StreamsSize);
 
+    std::vector<DWORD> Translation;
+    VshWriteDeclarationTranslation(*ppRecompiledDeclaration, DeclarationSize, pVertexDynamicPatch, Translation);
+    EmuShaderCacheInsert(SHADER_CACHE_VERTEX_DECLARATION, IsFixedFunction, pDeclaration, DeclarationSize,
+                         Translation.data(), Translation.size() * sizeof(DWORD));
+
     return D3D_OK;
 }
 
+// Returns the size of the given shader function, including it's header
+static DWORD VshGetFunctionSize(DWORD *pFunction)
+{
+    DWORD *pToken = (DWORD*)((uint08*)pFunction + sizeof(VSH_SHADER_HEADER));
+    boolean EOI = false;
+
+    for (; !EOI; pToken += VSH_INSTRUCTION_SIZE)
+    {
+        EOI = (boolean)VshGetField(pToken, FLD_FINAL);
+    }
+
+    return (DWORD)pToken - (DWORD)pFunction;
+}
+
+// A cached function translation starts with these, followed by the assembled shader (if any)
+typedef struct _VSH_FUNCTION_TRANSLATION
+{
+    HRESULT Result;
+    DWORD   OriginalSize;
+    DWORD   UseDeclarationOnly;
+}
+VSH_FUNCTION_TRANSLATION;
+
 // recompile xbox vertex shader function
 extern HRESULT XTL::EmuRecompileVshFunction
 (
@@ -2182,6 +2276,35 @@ extern HRESULT XTL::EmuRecompileVshFunction
             break;
     }
 
+    DWORD FunctionSize = 0;
+    if(SUCCEEDED(hRet))
+    {
+        // Reuse an earlier translation of this function, if there is one
+        const void *pTranslation;
+        DWORD TranslationSize;
+
+        FunctionSize = VshGetFunctionSize(pFunction);
+        if(EmuShaderCacheLookup(SHADER_CACHE_VERTEX_FUNCTION, bNoReservedConstants, pFunction, FunctionSize, &pTranslation, &TranslationSize))
+        {
+            const VSH_FUNCTION_TRANSLATION *pCached = (const VSH_FUNCTION_TRANSLATION *)pTranslation;
+            DWORD AssembledSize = TranslationSize - sizeof(VSH_FUNCTION_TRANSLATION);
+
+            hRet = pCached->Result;
+            *pOriginalSize = pCached->OriginalSize;
+            *pbUseDeclarationOnly = (boolean)pCached->UseDeclarationOnly;
+            if(SUCCEEDED(hRet) && AssembledSize > 0)
+            {
+                hRet = D3DXCreateBuffer(AssembledSize, ppRecompiled);
+                if(SUCCEEDED(hRet))
+                    memcpy((*ppRecompiled)->GetBufferPointer(), pCached + 1, AssembledSize);
+            }
+
+            free(pShader);
+
+            return hRet;
+        }
+    }
+
     if(SUCCEEDED(hRet))
     {
 
@@ -2243,6 +2366,21 @@ extern HRESULT XTL::EmuRecompileVshFunction
 			pErrors->Release();
 
         free(pShaderDisassembly);
+
+        // Remember the outcome (including failures, which would only fail again)
+        std::vector<uint08> Translation(sizeof(VSH_FUNCTION_TRANSLATION));
+        VSH_FUNCTION_TRANSLATION *pTranslation = (VSH_FUNCTION_TRANSLATION *)Translation.data();
+        pTranslation->Result = hRet;
+        pTranslation->OriginalSize = *pOriginalSize;
+        pTranslation->UseDeclarationOnly = *pbUseDeclarationOnly;
+        if(SUCCEEDED(hRet) && *ppRecompiled != NULL)
+        {
+            uint08 *pAssembled = (uint08 *)(*ppRecompiled)->GetBufferPointer();
+            Translation.insert(Translation.end(), pAssembled, pAssembled + (*ppRecompiled)->GetBufferSize());
+        }
+
+        EmuShaderCacheInsert(SHADER_CACHE_VERTEX_FUNCTION, bNoReservedConstants, pFunction, FunctionSize,
+                             Translation.data(), Translation.size());
     }
 
     free(pShader);
@@ -50,6 +50,7 @@ namespace xboxkrnl
 #include "EmuXTL.h"
 #include "MemoryManager.h"
 #include "Logging.h"
+#include "XboxAdpcm.h"
 
 #include <mmreg.h>
 #include <msacm.h>
@@ -115,6 +116,79 @@ static XTL::X_CDirectSoundBuffer   *g_pDSoundBufferCache[SOUNDBUFFER_CACHE_SIZE]
 static XTL::X_CDirectSoundStream   *g_pDSoundStreamCache[SOUNDSTREAM_CACHE_SIZE];
 static int							g_bDSoundCreateCalled = FALSE;
 
+// EmuAdpcmBlock value of a buffer that has nothing decoded yet
+#define ADPCM_BLOCK_NONE 0xFFFFFFFF
+
+// host buffers for Xbox ADPCM data receive the 16 bit PCM samples decoded from it
+static void EmuAdpcmToPcmFormat(WAVEFORMATEX *pwfx)
+{
+    pwfx->wFormatTag = WAVE_FORMAT_PCM;
+    pwfx->wBitsPerSample = 16;
+    pwfx->nBlockAlign = pwfx->nChannels * 2;
+    pwfx->nAvgBytesPerSec = pwfx->nSamplesPerSec * pwfx->nBlockAlign;
+    pwfx->cbSize = 0;
+}
+
+// decode the ADPCM blocks of a sound buffer up to half a second ahead of its play cursor,
+// continuing from where the previous update stopped
+static void EmuUpdateAdpcmSoundBuffer(XTL::X_CDirectSoundBuffer *pThis)
+{
+    WAVEFORMATEX *pwfx = pThis->EmuBufferDesc->lpwfxFormat;
+    DWORD dwBlockBytes = XBOX_ADPCM_DSTSIZE * pwfx->nChannels;
+    DWORD dwBlocks = pThis->EmuBufferDesc->dwBufferBytes / dwBlockBytes;
+
+    if(dwBlocks == 0)
+        return;
+
+    DWORD dwPlayCursor = 0;
+
+    if(FAILED(pThis->EmuDirectSoundBuffer8->GetCurrentPosition(&dwPlayCursor, NULL)))
+        dwPlayCursor = 0;
+
+    DWORD dwPlayBlock = (dwPlayCursor / dwBlockBytes) % dwBlocks;
+
+    // when the whole buffer fits, leave the block before the play cursor alone,
+    // so buffers that don't play aren't decoded over and over again
+    DWORD dwLead = pwfx->nSamplesPerSec / (2 * XBOX_ADPCM_SAMPLES_PER_BLOCK) + 1;
+
+    if(dwLead >= dwBlocks)
+        dwLead = (dwBlocks > 1) ? dwBlocks - 1 : 1;
+
+    DWORD dwAhead = 0;
+
+    if(pThis->EmuAdpcmBlock < dwBlocks)
+        dwAhead = (pThis->EmuAdpcmBlock + dwBlocks - dwPlayBlock) % dwBlocks;
+
+    // start over at the play cursor if it moved past the decoded blocks (or nothing is decoded yet)
+    if(pThis->EmuAdpcmBlock >= dwBlocks || dwAhead > dwLead)
+    {
+        pThis->EmuAdpcmBlock = dwPlayBlock;
+        dwAhead = 0;
+    }
+
+    DWORD dwCount = dwLead - dwAhead;
+
+    while(dwCount > 0)
+    {
+        DWORD dwBlock = pThis->EmuAdpcmBlock;
+        DWORD dwDecode = (dwCount < dwBlocks - dwBlock) ? dwCount : dwBlocks - dwBlock;
+        PVOID pAudioPtr;
+        DWORD dwAudioBytes;
+
+        HRESULT hRet = pThis->EmuDirectSoundBuffer8->Lock(dwBlock * dwBlockBytes, dwDecode * dwBlockBytes, &pAudioPtr, &dwAudioBytes, NULL, NULL, 0);
+
+        if(FAILED(hRet))
+            break;
+
+        XboxAdpcmDecode((PBYTE)pThis->EmuBuffer + (dwBlock * XBOX_ADPCM_SRCSIZE * pwfx->nChannels), pAudioPtr, dwDecode, pwfx->nChannels);
+
+        pThis->EmuDirectSoundBuffer8->Unlock(pAudioPtr, dwAudioBytes, NULL, 0);
+
+        pThis->EmuAdpcmBlock = (dwBlock + dwDecode) % dwBlocks;
+        dwCount -= dwDecode;
+    }
+}
+
 // periodically update sound buffers
 static void HackUpdateSoundBuffers()
 {
@@ -130,6 +204,12 @@ static void HackUpdateSoundBuffers()
         if(g_pDSoundBufferCache[v]->EmuLockPtr1 != 0)
             g_pDSoundBufferCache[v]->EmuDirectSoundBuffer8->Unlock(g_pDSoundBufferCache[v]->EmuLockPtr1, g_pDSoundBufferCache[v]->EmuLockBytes1, g_pDSoundBufferCache[v]->EmuLockPtr2, g_pDSoundBufferCache[v]->EmuLockBytes2);
 
+        if(g_pDSoundBufferCache[v]->EmuFlags & DSB_FLAG_ADPCM)
+        {
+            EmuUpdateAdpcmSoundBuffer(g_pDSoundBufferCache[v]);
+            continue;
+        }
+
         HRESULT hRet = g_pDSoundBufferCache[v]->EmuDirectSoundBuffer8->Lock(0, g_pDSoundBufferCache[v]->EmuBufferDesc->dwBufferBytes, &pAudioPtr, &dwAudioBytes, &pAudioPtr2, &dwAudioBytes2, 0);
 
         if(SUCCEEDED(hRet))
@@ -162,11 +242,22 @@ static void HackUpdateSoundStreams()
 
         if(SUCCEEDED(hRet))
         {
-            if(pAudioPtr != 0)
-                memcpy(pAudioPtr,  g_pDSoundStreamCache[v]->EmuBuffer, dwAudioBytes);
+            if(g_pDSoundStreamCache[v]->EmuFlags & DSB_FLAG_ADPCM)
+            {
+                // decode the packet straight into the host buffer (which is sized to fit it)
+                WORD nChannels = g_pDSoundStreamCache[v]->EmuBufferDesc->lpwfxFormat->nChannels;
 
-            if(pAudioPtr2 != 0)
-                memcpy(pAudioPtr2, (PVOID)((DWORD)g_pDSoundStreamCache[v]->EmuBuffer+dwAudioBytes), dwAudioBytes2);
+                if(pAudioPtr != 0)
+                    XboxAdpcmDecode(g_pDSoundStreamCache[v]->EmuBuffer, pAudioPtr, dwAudioBytes / (XBOX_ADPCM_DSTSIZE * nChannels), nChannels);
+            }
+            else
+            {
+                if(pAudioPtr != 0)
+                    memcpy(pAudioPtr,  g_pDSoundStreamCache[v]->EmuBuffer, dwAudioBytes);
+
+                if(pAudioPtr2 != 0)
+                    memcpy(pAudioPtr2, (PVOID)((DWORD)g_pDSoundStreamCache[v]->EmuBuffer+dwAudioBytes), dwAudioBytes2);
+            }
 
             g_pDSoundStreamCache[v]->EmuDirectSoundBuffer8->Unlock(pAudioPtr, dwAudioBytes, pAudioPtr2, dwAudioBytes2);
         }
@@ -181,6 +272,10 @@ static void HackUpdateSoundStreams()
 // resize an emulated directsound buffer, if necessary
 static void EmuResizeIDirectSoundBuffer8(XTL::X_CDirectSoundBuffer *pThis, DWORD dwBytes)
 {
+    // the host buffer of ADPCM data holds the decoded samples
+    if(pThis->EmuFlags & DSB_FLAG_ADPCM)
+        dwBytes = XboxAdpcmDecodedSize(dwBytes, pThis->EmuBufferDesc->lpwfxFormat->nChannels);
+
     if(dwBytes == pThis->EmuBufferDesc->dwBufferBytes || dwBytes == 0)
         return;
 
@@ -208,6 +303,9 @@ static void EmuResizeIDirectSoundBuffer8(XTL::X_CDirectSoundBuffer *pThis, DWORD
     if(FAILED(hRet))
         CxbxKrnlCleanup("IDirectSoundBuffer8 resize Failed!");
 
+    // the new buffer has nothing decoded yet
+    pThis->EmuAdpcmBlock = ADPCM_BLOCK_NONE;
+
     pThis->EmuDirectSoundBuffer8->SetCurrentPosition(dwPlayCursor);
 
     if(dwStatus & DSBSTATUS_PLAYING)
@@ -217,6 +315,15 @@ static void EmuResizeIDirectSoundBuffer8(XTL::X_CDirectSoundBuffer *pThis, DWORD
 // resize an emulated directsound stream, if necessary
 static void EmuResizeIDirectSoundStream8(XTL::X_CDirectSoundStream *pThis, DWORD dwBytes)
 {
+    // the host buffer of ADPCM data holds the decoded samples
+    if(pThis->EmuFlags & DSB_FLAG_ADPCM)
+    {
+        dwBytes = XboxAdpcmDecodedSize(dwBytes, pThis->EmuBufferDesc->lpwfxFormat->nChannels);
+
+        if(dwBytes < DSBSIZE_MIN)
+            dwBytes = DSBSIZE_MIN;
+    }
+
     if(dwBytes == pThis->EmuBufferDesc->dwBufferBytes)
         return;
 
@@ -865,12 +972,6 @@ HRESULT WINAPI XTL::EMUPATCH(DirectSoundCreateBuffer)
         pDSBufferDesc->dwSize = sizeof(DSBUFFERDESC);
         pDSBufferDesc->dwFlags = (pdsbd->dwFlags & dwAcceptableMask) | DSBCAPS_CTRLVOLUME | DSBCAPS_GETCURRENTPOSITION2;
         pDSBufferDesc->dwBufferBytes = pdsbd->dwBufferBytes;
-
-        if(pDSBufferDesc->dwBufferBytes < DSBSIZE_MIN)
-            pDSBufferDesc->dwBufferBytes = DSBSIZE_MIN;
-        else if(pDSBufferDesc->dwBufferBytes > DSBSIZE_MAX)
-            pDSBufferDesc->dwBufferBytes = DSBSIZE_MAX;
-
         pDSBufferDesc->dwReserved = 0;
 
         if(pdsbd->lpwfxFormat != NULL)
@@ -882,23 +983,9 @@ HRESULT WINAPI XTL::EMUPATCH(DirectSoundCreateBuffer)
             {
                 dwEmuFlags |= DSB_FLAG_ADPCM;
 
-                EmuWarning("WAVE_FORMAT_XBOX_ADPCM Unsupported!");
-
-                pDSBufferDesc->lpwfxFormat->wFormatTag = WAVE_FORMAT_PCM;
-                pDSBufferDesc->lpwfxFormat->nBlockAlign = (pDSBufferDesc->lpwfxFormat->nChannels*pDSBufferDesc->lpwfxFormat->wBitsPerSample)/8;
-
-                // the above calculation can yield zero for wBitsPerSample < 8, so we'll bound it to 1 byte minimum
-                if(pDSBufferDesc->lpwfxFormat->nBlockAlign == 0)
-                    pDSBufferDesc->lpwfxFormat->nBlockAlign = 1;
-
-                pDSBufferDesc->lpwfxFormat->nAvgBytesPerSec = pDSBufferDesc->lpwfxFormat->nSamplesPerSec*pDSBufferDesc->lpwfxFormat->nBlockAlign;
-                pDSBufferDesc->lpwfxFormat->wBitsPerSample = 8;
-
-                /* TODO: Get ADPCM working!
-                pDSBufferDesc->lpwfxFormat->cbSize = 32;
-                #define WAVE_FORMAT_ADPCM 2
-                pDSBufferDesc->lpwfxFormat->wFormatTag = WAVE_FORMAT_ADPCM;
-                */
+                // the data is decoded block by block while playing (see EmuUpdateAdpcmSoundBuffer)
+                EmuAdpcmToPcmFormat(pDSBufferDesc->lpwfxFormat);
+                pDSBufferDesc->dwBufferBytes = XboxAdpcmDecodedSize(pdsbd->dwBufferBytes, pDSBufferDesc->lpwfxFormat->nChannels);
             }
         }
 		else
@@ -948,6 +1035,11 @@ HRESULT WINAPI XTL::EMUPATCH(DirectSoundCreateBuffer)
 				pDSBufferDesc->dwBufferBytes = 3 * pDSBufferDesc->lpwfxFormat->nAvgBytesPerSec;*/
 		}
 
+        if(pDSBufferDesc->dwBufferBytes < DSBSIZE_MIN)
+            pDSBufferDesc->dwBufferBytes = DSBSIZE_MIN;
+        else if(pDSBufferDesc->dwBufferBytes > DSBSIZE_MAX)
+            pDSBufferDesc->dwBufferBytes = DSBSIZE_MAX;
+
         pDSBufferDesc->guid3DAlgorithm = DS3DALG_DEFAULT;
     }
 
@@ -972,6 +1064,7 @@ HRESULT WINAPI XTL::EMUPATCH(DirectSoundCreateBuffer)
     (*ppBuffer)->EmuLockPtr2 = 0;
     (*ppBuffer)->EmuLockBytes2 = 0;
     (*ppBuffer)->EmuFlags = dwEmuFlags;
+    (*ppBuffer)->EmuAdpcmBlock = ADPCM_BLOCK_NONE;
 
     DbgPrintf("EmuDSound: EmuDirectSoundCreateBuffer, *ppBuffer := 0x%.08X, bytes := 0x%.08X\n", *ppBuffer, pDSBufferDesc->dwBufferBytes);
 
@@ -1077,6 +1170,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetBufferData)
 
     // update buffer data cache
     pThis->EmuBuffer = pvBufferData;
+    pThis->EmuAdpcmBlock = ADPCM_BLOCK_NONE;
 
 	EmuResizeIDirectSoundBuffer8(pThis, dwBufferBytes);
 
@@ -1358,6 +1452,10 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetCurrentPosition)
            ");\n",
            pThis, dwNewPosition);
 
+    // positions in ADPCM data must be translated to the decoded host buffer
+    if(pThis->EmuFlags & DSB_FLAG_ADPCM)
+        dwNewPosition = XboxAdpcmDecodedSize(dwNewPosition, pThis->EmuBufferDesc->lpwfxFormat->nChannels);
+
     // NOTE: TODO: This call *will* (by MSDN) fail on primary buffers!
     HRESULT hRet = pThis->EmuDirectSoundBuffer8->SetCurrentPosition(dwNewPosition);
 
@@ -1401,6 +1499,17 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_GetCurrentPosition)
 
 		if(FAILED(hRet))
 			EmuWarning("GetCurrentPosition Failed!");
+		else if(pThis->EmuFlags & DSB_FLAG_ADPCM)
+		{
+			// report positions in the ADPCM data, rather than in the decoded host buffer
+			WORD nChannels = pThis->EmuBufferDesc->lpwfxFormat->nChannels;
+
+			if(pdwCurrentPlayCursor != 0)
+				*pdwCurrentPlayCursor = XboxAdpcmEncodedSize(*pdwCurrentPlayCursor, nChannels);
+
+			if(pdwCurrentWriteCursor != 0)
+				*pdwCurrentWriteCursor = XboxAdpcmEncodedSize(*pdwCurrentWriteCursor, nChannels);
+		}
 
 		if(pdwCurrentPlayCursor != 0 && pdwCurrentWriteCursor != 0)
 		{
@@ -1463,16 +1572,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_Play)
         pThis->EmuLockPtr1 = 0;
     }
 
-    HRESULT hRet;
-
-    if(pThis->EmuFlags & DSB_FLAG_ADPCM)
-    {
-        hRet = D3D_OK;
-    }
-    else
-    {
-        hRet = pThis->EmuDirectSoundBuffer8->Play(0, 0, dwFlags);
-    }
+    HRESULT hRet = pThis->EmuDirectSoundBuffer8->Play(0, 0, dwFlags);
 
     pThis->EmuPlayFlags = dwFlags;
 
@@ -1614,6 +1714,7 @@ HRESULT WINAPI XTL::EMUPATCH(DirectSoundCreateStream)
 
     // TODO: Garbage Collection
     *ppStream = new X_CDirectSoundStream();
+    (*ppStream)->EmuFlags = 0;
 
     DSBUFFERDESC *pDSBufferDesc = (DSBUFFERDESC*)g_MemoryManager.Allocate(sizeof(DSBUFFERDESC));
 
@@ -1639,11 +1740,16 @@ HRESULT WINAPI XTL::EMUPATCH(DirectSoundCreateStream)
 
         pDSBufferDesc->guid3DAlgorithm = DS3DALG_DEFAULT;
 
+        if(pDSBufferDesc->lpwfxFormat != NULL && pDSBufferDesc->lpwfxFormat->wFormatTag == WAVE_FORMAT_XBOX_ADPCM)
+        {
+            // each packet is decoded when it's submitted (see HackUpdateSoundStreams)
+            (*ppStream)->EmuFlags |= DSB_FLAG_ADPCM;
+            EmuAdpcmToPcmFormat(pDSBufferDesc->lpwfxFormat);
+        }
+
         if(pDSBufferDesc->lpwfxFormat != NULL && pDSBufferDesc->lpwfxFormat->wFormatTag != WAVE_FORMAT_PCM)
         {
             EmuWarning("Invalid WAVE_FORMAT!");
-            if(pDSBufferDesc->lpwfxFormat->wFormatTag == WAVE_FORMAT_XBOX_ADPCM)
-                EmuWarning("WAVE_FORMAT_XBOX_ADPCM Unsupported!");
 
             (*ppStream)->EmuDirectSoundBuffer8 = 0;
 
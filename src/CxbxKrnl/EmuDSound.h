@@ -231,6 +231,7 @@ struct X_CDirectSoundBuffer
     DWORD           EmuLockBytes2;      // Offset: 0x3C
     DWORD           EmuPlayFlags;       // Offset: 0x40
     DWORD           EmuFlags;           // Offset: 0x44
+    DWORD           EmuAdpcmBlock;      // Offset: 0x48 (next ADPCM block to decode)
 };
 
 #define DSB_FLAG_ADPCM 0x00000001
@@ -347,6 +348,7 @@ class X_CDirectSoundStream
         PVOID                    EmuLockPtr2;
         DWORD                    EmuLockBytes2;
         DWORD                    EmuPlayFlags;
+        DWORD                    EmuFlags;
 };
 
 // ******************************************************************
@@ -37,6 +37,8 @@
 #define _XBOXKRNL_DEFEXTRN_
 
 #include "EmuFile.h"
+#include "HandleTable.h"
+#include "FilePathPrefixCache.h"
 #include <vector>
 #include <string>
 #include <cassert>
@@ -145,17 +147,22 @@ EmuNtObject* EmuNtObject::NtDuplicateObject(DWORD Options)
 
 bool IsEmuHandle(HANDLE Handle)
 {
-	return ((uint32)Handle > 0x80000000) && ((uint32)Handle < 0xFFFFFFFE);
+	return HandleTable::IsTableHandle(Handle);
 }
 
 EmuHandle* HandleToEmuHandle(HANDLE Handle)
 {
-	return (EmuHandle*)((uint32_t)Handle & 0x7FFFFFFF);
+	void *pObject;
+
+	if (g_HandleTable.Lookup(Handle, &pObject) != HANDLE_TYPE_EMU)
+		return nullptr;
+
+	return (EmuHandle*)pObject;
 }
 
 HANDLE EmuHandleToHandle(EmuHandle* emuHandle)
 {
-	return (HANDLE)((uint32_t)emuHandle | 0x80000000);
+	return g_HandleTable.Insert(emuHandle, HANDLE_TYPE_EMU);
 }
 
 bool CxbxIsUtilityDrive(NtDll::HANDLE RootDirectory)
@@ -189,6 +196,27 @@ void copy_string_to_PSTRING_to(std::string const & src, const xboxkrnl::PSTRING
 	memcpy(dest->Buffer, src.c_str(), dest->Length);
 }
 
+// The prefixes of all symbolic links, in the drive letter order FindNtSymbolicLinkObjectByDevice uses
+static void FillFilePathPrefixCache(FilePathPrefixCache &Cache)
+{
+	for (char DriveLetter = 'A'; DriveLetter <= 'Z'; DriveLetter++)
+	{
+		EmuNtSymbolicLinkObject* SymbolicLinkObject = NtSymbolicLinkObjects[DriveLetter - 'A'];
+		if (SymbolicLinkObject != NULL)
+		{
+			Cache.AddDrive(DriveLetter, SymbolicLinkObject, SymbolicLinkObject->RootDirectoryHandle);
+			Cache.AddDevice(SymbolicLinkObject->XboxSymbolicLinkPath, SymbolicLinkObject, SymbolicLinkObject->RootDirectoryHandle);
+		}
+	}
+}
+
+static FilePathPrefixCache FilePathPrefixes(FillFilePathPrefixCache);
+
+void DumpFilePathCacheStatistics(void)
+{
+	FilePathPrefixes.DumpStatistics();
+}
+
 NTSTATUS _CxbxConvertFilePath(
 	std::string RelativeXboxPath, 
 	OUT std::wstring &RelativeHostPath, 
@@ -200,6 +228,7 @@ NTSTATUS _CxbxConvertFilePath(
 	std::string XboxFullPath;
 	std::string HostPath;
 	EmuNtSymbolicLinkObject* NtSymbolicLinkObject = NULL;
+	FILE_PATH_PREFIX Prefix;
 	
 	// Always trim '\??\' off :
 	if (RelativePath.compare(0, DrivePrefix.length(), DrivePrefix.c_str()) == 0)
@@ -212,7 +241,8 @@ NTSTATUS _CxbxConvertFilePath(
 		if ((RelativePath.length() >= 2) && (RelativePath[1] == ':'))
 		{
 			// Look up the symbolic link information using the drive letter :
-			NtSymbolicLinkObject = FindNtSymbolicLinkObjectByDriveLetter(RelativePath[0]);
+			if (FilePathPrefixes.Lookup(RelativePath, &Prefix))
+				NtSymbolicLinkObject = (EmuNtSymbolicLinkObject*)Prefix.pLink;
 			RelativePath.erase(0, 2); // Remove 'C:'
 
 			// If the remaining path starts with a ':', remove it (to prevent errors) :
@@ -242,10 +272,12 @@ NTSTATUS _CxbxConvertFilePath(
 				return STATUS_UNRECOGNIZED_VOLUME;
 
 			// The path seems to be a device path, look it up :
-			NtSymbolicLinkObject = FindNtSymbolicLinkObjectByDevice(RelativePath);
-			// Fixup RelativePath path here
-			if (NtSymbolicLinkObject != NULL)
-				RelativePath.erase(0, NtSymbolicLinkObject->XboxSymbolicLinkPath.length()); // Remove '\Device\Harddisk0\Partition2'
+			if (FilePathPrefixes.Lookup(RelativePath, &Prefix))
+			{
+				NtSymbolicLinkObject = (EmuNtSymbolicLinkObject*)Prefix.pLink;
+				// Fixup RelativePath path here
+				RelativePath.erase(0, Prefix.Length); // Remove '\Device\Harddisk0\Partition2'
+			}
 			// else TODO : Turok requests 'gamedata.dat' without a preceding path, we probably need 'CurrentDir'-functionality
 		}
 
@@ -372,7 +404,7 @@ XboxDevice *CxbxDeviceByDevicePath(const std::string XboxDevicePath)
 	return nullptr;
 }
 
-int CxbxRegisterDeviceHostPath(std::string XboxDevicePath, std::string HostDevicePath, bool IsFile)
+int CxbxRegisterDeviceHostPath(std::string XboxDevicePath, std::string HostDevicePath, bool IsFile, EmuXisoImage *XisoImage)
 {
 	int result = -1;
 
@@ -389,13 +421,15 @@ int CxbxRegisterDeviceHostPath(std::string XboxDevicePath, std::string HostDevic
 	}
 	else
 	{
-		int status = SHCreateDirectoryEx(NULL, HostDevicePath.c_str(), NULL);
+		// An image is accessed as it is, there's no host folder to create
+		int status = (XisoImage != nullptr) ? STATUS_SUCCESS : SHCreateDirectoryEx(NULL, HostDevicePath.c_str(), NULL);
 		if (status == STATUS_SUCCESS || status == ERROR_ALREADY_EXISTS)
 		{
 			XboxDevice newDevice;
 
 			newDevice.XboxDevicePath = XboxDevicePath;
 			newDevice.HostDevicePath = HostDevicePath;
+			newDevice.XisoImage = XisoImage;
 			Devices.push_back(newDevice);
 			result = Devices.size() - 1;
 		}
@@ -451,6 +485,7 @@ NTSTATUS EmuNtSymbolicLinkObject::Init(std::string aSymbolicLinkName, std::strin
 			{
 				result = STATUS_SUCCESS;
 				SymbolicLinkName = aSymbolicLinkName;
+				XisoImage = nullptr;
 				if (IsHostBasedPath)
 				{
 					XboxSymbolicLinkPath = "";
@@ -460,14 +495,24 @@ NTSTATUS EmuNtSymbolicLinkObject::Init(std::string aSymbolicLinkName, std::strin
 				{
 					XboxSymbolicLinkPath = aFullPath;
 					HostSymbolicLinkPath = Devices[DeviceIndex].HostDevicePath;
+					XisoImage = Devices[DeviceIndex].XisoImage;
 					// Handle the case where a sub folder of the partition is mounted (instead of it's root) :
 					std::string ExtraPath = aFullPath.substr(Devices[DeviceIndex].XboxDevicePath.length(), std::string::npos);
 
 					if (!ExtraPath.empty())
-						HostSymbolicLinkPath = HostSymbolicLinkPath + ExtraPath;
+					{
+						if (XisoImage != nullptr)
+							EmuWarning("Linking \"%s\" to the root of the image instead of \"%s\"", aSymbolicLinkName.c_str(), aFullPath.c_str());
+						else
+							HostSymbolicLinkPath = HostSymbolicLinkPath + ExtraPath;
+					}
 				}
 
-				SHCreateDirectoryEx(NULL, HostSymbolicLinkPath.c_str(), NULL);
+				if (XisoImage == nullptr)
+					SHCreateDirectoryEx(NULL, HostSymbolicLinkPath.c_str(), NULL);
+
+				// Note : For an image, this opens the image file itself; The handle then
+				// only identifies the link, as files on the image never reach the host.
 				RootDirectoryHandle = CreateFile(HostSymbolicLinkPath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
 				if (RootDirectoryHandle == INVALID_HANDLE_VALUE)
 				{
@@ -477,6 +522,7 @@ NTSTATUS EmuNtSymbolicLinkObject::Init(std::string aSymbolicLinkName, std::strin
 				else
 				{
 					NtSymbolicLinkObjects[DriveLetter - 'A'] = this;
+					FilePathPrefixes.Invalidate();
 					DbgPrintf("EmuMain : Linked \"%s\" to \"%s\" (residing at \"%s\")\n", aSymbolicLinkName.c_str(), aFullPath.c_str(), HostSymbolicLinkPath.c_str());
 				}
 			}
@@ -490,6 +536,7 @@ NTSTATUS EmuNtSymbolicLinkObject::Init(std::string aSymbolicLinkName, std::strin
 {
 	if (DriveLetter >= 'A' && DriveLetter <= 'Z') {
 		NtSymbolicLinkObjects[DriveLetter - 'A'] = NULL;
+		FilePathPrefixes.Invalidate();
 		NtDll::NtClose(RootDirectoryHandle);
 	}
 }
@@ -155,6 +155,7 @@ const size_t XboxFileInfoStructSizes[xboxkrnl::FileMaximumInformation] = {
 
 
 class EmuNtObject;
+class EmuXisoImage;
 
 struct NativeObjectAttributes {
 	wchar_t wszObjectName[160];
@@ -206,6 +207,7 @@ public:
 	bool IsHostBasedPath;
 	std::string XboxSymbolicLinkPath;
 	std::string HostSymbolicLinkPath;
+	EmuXisoImage *XisoImage; // Set when the link refers to a mounted image instead of a host folder
 	HANDLE RootDirectoryHandle;
 	NTSTATUS Init(std::string aSymbolicLinkName, std::string aFullPath);
 	~EmuNtSymbolicLinkObject();
@@ -215,18 +217,19 @@ struct XboxDevice {
 	std::string XboxDevicePath;
 	std::string HostDevicePath;
 	HANDLE HostRootHandle;
+	EmuXisoImage *XisoImage; // Set when the device contents are a mounted image (HostDevicePath is the image file)
 };
 
 // ******************************************************************
-// * is Handle a 'special' emulated handle?
+// * is Handle a 'special' emulated handle? (see HandleTable.h)
 // ******************************************************************
 bool IsEmuHandle(HANDLE Handle);
-EmuHandle* HandleToEmuHandle(HANDLE Handle);
+EmuHandle* HandleToEmuHandle(HANDLE Handle); // nullptr when closed or not an EmuHandle
 HANDLE EmuHandleToHandle(EmuHandle* emuHandle);
 
 CHAR* NtStatusToString(IN NTSTATUS Status);
 
-int CxbxRegisterDeviceHostPath(std::string XboxFullPath, std::string HostDevicePath, bool IsFile = false);
+int CxbxRegisterDeviceHostPath(std::string XboxFullPath, std::string HostDevicePath, bool IsFile = false, EmuXisoImage *XisoImage = nullptr);
 int CxbxDeviceIndexByDevicePath(const char *XboxDevicePath);
 XboxDevice *CxbxDeviceByDevicePath(const std::string XboxDevicePath);
 
@@ -55,4 +55,8 @@ xboxkrnl::PLIST_ENTRY RemoveTailList(xboxkrnl::PLIST_ENTRY pListHead);
 
 extern xboxkrnl::LAUNCH_DATA_PAGE DefaultLaunchDataPage;
 
+// handles of Xbox objects, see EmuKrnlOb.cpp
+xboxkrnl::HANDLE EmuObCreateObjectHandle(xboxkrnl::PVOID Object);
+void EmuObCloseObjectHandle(xboxkrnl::PVOID Object);
+
 #endif
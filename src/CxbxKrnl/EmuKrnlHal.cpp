@@ -474,6 +474,7 @@ XBSYSAPI EXPORTNUM(49) xboxkrnl::VOID DECLSPEC_NORETURN xboxkrnl::HalReturnToFir
 		LOG_UNIMPLEMENTED();
 	}
 
+	CxbxShutdownDpcAndTimerThread();
 	EmuShared::Cleanup();
 	ExitProcess(EXIT_SUCCESS);
 }
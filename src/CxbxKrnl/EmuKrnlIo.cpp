@@ -48,6 +48,7 @@ namespace xboxkrnl
 #include "CxbxKrnl.h" // For CxbxKrnlCleanup
 #include "Emu.h" // For EmuWarning()
 #include "EmuFile.h" // For CxbxCreateSymbolicLink(), etc.
+#include "EmuXiso.h" // For CxbxXisoCreateFile()
 
 // ******************************************************************
 // * 0x003B - IoAllocateIrp()
@@ -261,7 +262,14 @@ XBSYSAPI EXPORTNUM(66) xboxkrnl::NTSTATUS NTAPI xboxkrnl::IoCreateFile
 
 	NTSTATUS ret = CxbxObjectAttributesToNT(ObjectAttributes, /*OUT*/nativeObjectAttributes, "IoCreateFile");
 
-	if (!FAILED(ret))
+	// Files on a mounted image are opened without involving the host
+	EmuXisoImage *XisoImage = nullptr;
+	if (!FAILED(ret) && (nativeObjectAttributes.NtObjAttrPtr != nullptr))
+		XisoImage = CxbxXisoImageByRootHandle(nativeObjectAttributes.NtObjAttr.RootDirectory);
+
+	if (XisoImage != nullptr)
+		ret = CxbxXisoCreateFile(XisoImage, nativeObjectAttributes.wszObjectName, FileHandle, Disposition, CreateOptions, IoStatusBlock);
+	else if (!FAILED(ret))
 		// redirect to NtCreateFile
 		ret = NtDll::NtCreateFile(
 			FileHandle, 
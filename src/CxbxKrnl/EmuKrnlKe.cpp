@@ -65,13 +65,65 @@ namespace NtDll
 typedef struct _DpcData {
 	CRITICAL_SECTION Lock;
 	HANDLE DpcThread;
+	DWORD DpcThreadId;
 	HANDLE DpcEvent;
+	bool bShutdown; // Set by CxbxShutdownDpcAndTimerThread()
 	xboxkrnl::LIST_ENTRY DpcQueue; // TODO : Use KeGetCurrentPrcb()->DpcListHead instead
-	xboxkrnl::LIST_ENTRY TimerQueue;
 } DpcData;
 
 DpcData g_DpcData = { 0 }; // Note : g_DpcData is initialized in InitDpcAndTimerThread()
 
+// Xbox Performance Counter Frequency = 337F98 = ACPI timer frequency (3.375000 Mhz)
+#define XBOX_PERFORMANCE_FREQUENCY 3375000 
+
+LARGE_INTEGER NativePerformanceCounter = { 0 };
+LARGE_INTEGER NativePerformanceFrequency = { 0 };
+double NativeToXbox_FactorForPerformanceFrequency;
+
+// Returns the host performance counter, re-based and scaled to the Xbox frequency
+xboxkrnl::ULONGLONG CxbxXboxPerformanceCounter()
+{
+	LARGE_INTEGER PerformanceCounter;
+
+	// Dxbx note : Xbox actually uses the RDTSC machine code instruction for this,
+	// and we we're bound to a single core, so we could do that too, but on Windows
+	// rdtsc is not a very stable counter, so instead, we'll use the native PeformanceCounter :
+	QueryPerformanceCounter(&PerformanceCounter);
+
+	// Re-base the performance counter to increase accuracy of the following conversion :
+	PerformanceCounter.QuadPart -= NativePerformanceCounter.QuadPart;
+	// We appy a conversion factor here, to fake Xbox1-like increment-speed behaviour :
+	return (xboxkrnl::ULONGLONG)(NativeToXbox_FactorForPerformanceFrequency * PerformanceCounter.QuadPart);
+}
+
+// Timers are kept in a hierarchical timing wheel, so inserting and cancelling a timer
+// is O(1), and the Dpc thread only visits timers that are actually due. Timer due times
+// are stored as CxbxXboxPerformanceCounter() values. Level 0 has a slot per wheel tick,
+// each higher level has a slot per full turn of the level below it. Timers move down
+// a level (cascade) when the level below wraps around to their slot.
+#define TIMER_TICK_SHIFT 10 // A wheel tick is 1024 counter ticks (about 0.3 ms)
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_LEVELS 4 // Spans 2^24 wheel ticks (about 85 minutes), later timers get re-inserted
+#define TIMER_WHEEL_SPAN ((xboxkrnl::ULONGLONG)1 << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS))
+
+// Timer fire jitter is counted per power of two microseconds :
+// bucket 0 counts jitter below 1 us, bucket i counts jitter below 2^i us.
+#define TIMER_JITTER_BUCKETS 16
+#define TIMER_JITTER_REPORT_INTERVAL 65536 // Expirations between histogram reports
+
+typedef struct _TimerWheel {
+	xboxkrnl::ULONGLONG CurrentTick; // The first wheel tick that hasn't expired yet
+	xboxkrnl::ULONG Count; // Number of timers linked into the wheel
+	xboxkrnl::LIST_ENTRY Slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+	xboxkrnl::ULONG JitterHistogram[TIMER_JITTER_BUCKETS];
+	xboxkrnl::ULONG JitterCount;
+	xboxkrnl::ULONG JitterMax; // In microseconds
+} TimerWheel;
+
+TimerWheel g_TimerWheel = { 0 }; // Note : Protected by g_DpcData.Lock, initialized in InitDpcAndTimerThread()
+
 xboxkrnl::ULONGLONG LARGE_INTEGER2ULONGLONG(xboxkrnl::LARGE_INTEGER value)
 {
 	// Weird construction because there doesn't seem to exist an implicit
@@ -83,18 +135,58 @@ xboxkrnl::ULONGLONG LARGE_INTEGER2ULONGLONG(xboxkrnl::LARGE_INTEGER value)
 
 #define KiRemoveTreeTimer(Timer)               \
     (Timer)->Header.Inserted = FALSE;          \
-    RemoveEntryList(&(Timer)->TimerListEntry)
+    RemoveEntryList(&(Timer)->TimerListEntry); \
+    g_TimerWheel.Count--
+
+void KiInsertTimerWheel(
+	IN xboxkrnl::PKTIMER Timer
+)
+{
+	xboxkrnl::ULONGLONG Tick;
+	xboxkrnl::ULONGLONG Delta;
+	int Level;
+
+	// Round the due time up, so that timers never expire early :
+	Tick = (Timer->DueTime.QuadPart + (1 << TIMER_TICK_SHIFT) - 1) >> TIMER_TICK_SHIFT;
+	if (Tick < g_TimerWheel.CurrentTick)
+		Tick = g_TimerWheel.CurrentTick;
+
+	// Timers beyond the span of the wheel are parked at its far end, they're
+	// re-inserted when they reach level 0 (see KiExpireTimers) :
+	Delta = Tick - g_TimerWheel.CurrentTick;
+	if (Delta >= TIMER_WHEEL_SPAN)
+		Tick = g_TimerWheel.CurrentTick + TIMER_WHEEL_SPAN - 1;
+
+	for (Level = 0; Level < TIMER_WHEEL_LEVELS - 1; Level++)
+		if (Delta < ((xboxkrnl::ULONGLONG)1 << (TIMER_WHEEL_BITS * (Level + 1))))
+			break;
+
+	InsertTailList(&(g_TimerWheel.Slots[Level][(Tick >> (TIMER_WHEEL_BITS * Level)) & TIMER_WHEEL_MASK]), &(Timer->TimerListEntry));
+	g_TimerWheel.Count++;
+}
 
 BOOLEAN KiInsertTimerTable(
 	IN xboxkrnl::LARGE_INTEGER Interval,
-	xboxkrnl::ULONGLONG,
+	xboxkrnl::ULONGLONG CurrentTime,
 	IN xboxkrnl::PKTIMER Timer
 )
 {
-	// TODO
+	xboxkrnl::ULONGLONG Ticks;
+
+	// Convert the relative interval from 100 ns units to performance counter ticks
+	// (10000000 : 3375000 = 80 : 27), rounding up and without overflowing :
+	Ticks = (xboxkrnl::ULONGLONG)(-Interval.QuadPart);
+	Ticks = ((Ticks / 80) * 27) + ((((Ticks % 80) * 27) + 79) / 80);
+
+	Timer->DueTime.QuadPart = CurrentTime + Ticks;
+	KiInsertTimerWheel(Timer);
+
+	// Let the Dpc thread recalculate how long it can wait :
+	SetEvent(g_DpcData.DpcEvent);
 	return TRUE;
 }
 
+// Note : Callers must hold g_DpcData.Lock
 BOOLEAN KiInsertTreeTimer(
 	IN xboxkrnl::PKTIMER Timer,
 	IN xboxkrnl::LARGE_INTEGER Interval
@@ -123,7 +215,172 @@ BOOLEAN KiInsertTreeTimer(
 		Timer->Header.SignalState = FALSE;
 
 	Timer->Header.Inserted = TRUE;
-	return KiInsertTimerTable(Interval, xboxkrnl::KeQueryInterruptTime(), Timer);
+	return KiInsertTimerTable(Interval, CxbxXboxPerformanceCounter(), Timer);
+}
+
+void KiRecordTimerJitter(
+	xboxkrnl::ULONGLONG Jitter
+)
+{
+	xboxkrnl::ULONG Microseconds;
+	int Bucket;
+	int i;
+	char szBuffer[TIMER_JITTER_BUCKETS * 32];
+	char *p;
+
+	Microseconds = (xboxkrnl::ULONG)((Jitter * 1000000) / XBOX_PERFORMANCE_FREQUENCY);
+	for (Bucket = 0; Bucket < TIMER_JITTER_BUCKETS - 1; Bucket++)
+		if (Microseconds < (1UL << Bucket))
+			break;
+
+	g_TimerWheel.JitterHistogram[Bucket]++;
+	if (g_TimerWheel.JitterMax < Microseconds)
+		g_TimerWheel.JitterMax = Microseconds;
+
+	if (++g_TimerWheel.JitterCount % TIMER_JITTER_REPORT_INTERVAL != 0)
+		return;
+
+	p = szBuffer;
+	for (i = 0; i < TIMER_JITTER_BUCKETS - 1; i++)
+		p += sprintf(p, " <%u:%u", 1UL << i, g_TimerWheel.JitterHistogram[i]);
+
+	sprintf(p, " more:%u", g_TimerWheel.JitterHistogram[TIMER_JITTER_BUCKETS - 1]);
+	DbgPrintf("KeTimer: Jitter of %u expirations (us) :%s, max %u\n", g_TimerWheel.JitterCount, szBuffer, g_TimerWheel.JitterMax);
+}
+
+void KiTimerExpiration(
+	IN xboxkrnl::PKTIMER Timer,
+	xboxkrnl::ULONGLONG CurrentTime
+)
+{
+	xboxkrnl::ULONGLONG Period;
+	xboxkrnl::PKDPC Dpc;
+	xboxkrnl::LARGE_INTEGER SystemTime;
+
+	KiRecordTimerJitter(CurrentTime - Timer->DueTime.QuadPart);
+
+	Timer->Header.Inserted = FALSE;
+	Timer->Header.SignalState = TRUE;
+	if (!IsListEmpty(&(Timer->Header.WaitListHead))) {
+		// KiWaitTest(Timer, 0);
+	}
+
+	if (Timer->Period != 0) {
+		// Re-arm periodic timers relative to their previous due time, so they don't drift,
+		// but skip the periods that were missed entirely :
+		Period = (xboxkrnl::ULONGLONG)Timer->Period * (XBOX_PERFORMANCE_FREQUENCY / 1000);
+		Timer->DueTime.QuadPart += Period;
+		if (Timer->DueTime.QuadPart <= CurrentTime)
+			Timer->DueTime.QuadPart = CurrentTime + Period;
+
+		Timer->Header.Inserted = TRUE;
+		KiInsertTimerWheel(Timer);
+	}
+
+	Dpc = Timer->Dpc;
+	if (Dpc != NULL && Dpc->Inserted == FALSE) {
+		// Queue the Dpc, we're already on the Dpc thread (see KeInsertQueueDpc) :
+		xboxkrnl::KeQuerySystemTime(&SystemTime);
+		Dpc->Inserted = TRUE;
+		Dpc->SystemArgument1 = (PVOID)SystemTime.u.LowPart;
+		Dpc->SystemArgument2 = (PVOID)SystemTime.u.HighPart;
+		InsertTailList(&(g_DpcData.DpcQueue), &(Dpc->DpcListEntry));
+	}
+}
+
+// Moves the timers in a slot of a higher level down, now that their turn has come
+void KiCascadeTimerWheel(
+	int Level,
+	int Slot
+)
+{
+	xboxkrnl::PLIST_ENTRY ListHead;
+	xboxkrnl::PKTIMER Timer;
+
+	ListHead = &(g_TimerWheel.Slots[Level][Slot]);
+	while (!IsListEmpty(ListHead)) {
+		Timer = CONTAINING_RECORD(RemoveHeadList(ListHead), xboxkrnl::KTIMER, TimerListEntry);
+		g_TimerWheel.Count--;
+		KiInsertTimerWheel(Timer);
+	}
+}
+
+// Expires all timers that are due at the given time
+void KiExpireTimers(
+	xboxkrnl::ULONGLONG CurrentTime
+)
+{
+	xboxkrnl::ULONGLONG CurrentTick;
+	xboxkrnl::LIST_ENTRY Expired;
+	xboxkrnl::PLIST_ENTRY ListHead;
+	xboxkrnl::PKTIMER Timer;
+	int Level;
+
+	CurrentTick = CurrentTime >> TIMER_TICK_SHIFT;
+	while (g_TimerWheel.CurrentTick <= CurrentTick) {
+		if (g_TimerWheel.Count == 0) {
+			// An empty wheel can skip ahead at once
+			g_TimerWheel.CurrentTick = CurrentTick + 1;
+			break;
+		}
+
+		// When a level wraps around, the next slot of the level above it is due :
+		for (Level = 1; Level < TIMER_WHEEL_LEVELS; Level++) {
+			if ((g_TimerWheel.CurrentTick & (((xboxkrnl::ULONGLONG)1 << (TIMER_WHEEL_BITS * Level)) - 1)) != 0)
+				break;
+
+			KiCascadeTimerWheel(Level, (g_TimerWheel.CurrentTick >> (TIMER_WHEEL_BITS * Level)) & TIMER_WHEEL_MASK);
+		}
+
+		// Detach the due slot first, as periodic timers are re-inserted while expiring :
+		ListHead = &(g_TimerWheel.Slots[0][g_TimerWheel.CurrentTick & TIMER_WHEEL_MASK]);
+		g_TimerWheel.CurrentTick++;
+		if (IsListEmpty(ListHead))
+			continue;
+
+		Expired.Flink = ListHead->Flink;
+		Expired.Blink = ListHead->Blink;
+		Expired.Flink->Blink = &Expired;
+		Expired.Blink->Flink = &Expired;
+		InitializeListHead(ListHead);
+
+		while (!IsListEmpty(&Expired)) {
+			Timer = CONTAINING_RECORD(RemoveHeadList(&Expired), xboxkrnl::KTIMER, TimerListEntry);
+			g_TimerWheel.Count--;
+			if (Timer->DueTime.QuadPart > CurrentTime)
+				// Parked beyond the span of the wheel, re-insert it :
+				KiInsertTimerWheel(Timer);
+			else
+				KiTimerExpiration(Timer, CurrentTime);
+		}
+	}
+}
+
+// Returns how many milliseconds the Dpc thread can wait for the next timer
+// (or for the next cascade, when level 0 is empty)
+DWORD KiTimerWheelWait(
+	xboxkrnl::ULONGLONG CurrentTime
+)
+{
+	xboxkrnl::ULONGLONG Tick;
+	xboxkrnl::ULONGLONG WakeTime;
+
+	if (g_TimerWheel.Count == 0)
+		return INFINITE;
+
+	Tick = g_TimerWheel.CurrentTick;
+	while (IsListEmpty(&(g_TimerWheel.Slots[0][Tick & TIMER_WHEEL_MASK]))) {
+		Tick++;
+		if ((Tick & TIMER_WHEEL_MASK) == 0)
+			break;
+	}
+
+	WakeTime = Tick << TIMER_TICK_SHIFT;
+	if (WakeTime <= CurrentTime)
+		return 0;
+
+	// Round up, waking up early would only cause an idle loop :
+	return (DWORD)((((WakeTime - CurrentTime) * 1000) + XBOX_PERFORMANCE_FREQUENCY - 1) / XBOX_PERFORMANCE_FREQUENCY);
 }
 
 // ******************************************************************
@@ -174,23 +431,25 @@ DWORD __stdcall EmuThreadDpcHandler(LPVOID lpVoid)
 {
 	xboxkrnl::PKDPC pkdpc;
 	DWORD dwWait;
-	DWORD dwNow;
-	LONG lWait;
-	xboxkrnl::PKTIMER pktimer;
 
 	while (true)
 	{
 		// While we're working with the DpcQueue, we need to be thread-safe :
 		EnterCriticalSection(&(g_DpcData.Lock));
 
-//    if (g_DpcData._fShutdown)
-//        break; // while 
+		if (g_DpcData.bShutdown) {
+			LeaveCriticalSection(&(g_DpcData.Lock));
+			break; // while
+		}
 
 //    Assert(g_DpcData._dwThreadId == GetCurrentThreadId());
 //    Assert(g_DpcData._dwDpcThreadId == 0);
 //    g_DpcData._dwDpcThreadId = g_DpcData._dwThreadId;
 //    Assert(g_DpcData._dwDpcThreadId != 0);
 
+		// Expire the timers that are due, which queues their Dpc's :
+		KiExpireTimers(CxbxXboxPerformanceCounter());
+
 		// Are there entries in the DpqQueue?
 		while (!IsListEmpty(&(g_DpcData.DpcQueue)))
 		{
@@ -209,47 +468,15 @@ DWORD __stdcall EmuThreadDpcHandler(LPVOID lpVoid)
 			KeGetCurrentPrcb()->DpcRoutineActive = FALSE; // Experimental
 		}
 
-		dwWait = INFINITE;
-		if (!IsListEmpty(&(g_DpcData.TimerQueue)))
-		{
-			while (true)
-			{
-				dwNow = CxbxXboxGetTickCount();
-				dwWait = INFINITE;
-				pktimer = (xboxkrnl::PKTIMER)g_DpcData.TimerQueue.Flink;
-				pkdpc = nullptr;
-				while (pktimer != (xboxkrnl::PKTIMER)&(g_DpcData.TimerQueue))
-				{
-					lWait = (LONG)pktimer->DueTime.u.LowPart - dwNow;
-					if (lWait <= 0) 
-					{
-						pktimer->DueTime.u.LowPart = pktimer->Period + dwNow;
-						pkdpc = pktimer->Dpc;
-						break; // while
-					}
-
-					if (dwWait > (DWORD)lWait)
-						dwWait = (DWORD)lWait;
-
-					pktimer = (xboxkrnl::PKTIMER)pktimer->TimerListEntry.Flink;
-				}
-
-				if (pkdpc == nullptr)
-					break; // while
-
-				pkdpc->DeferredRoutine(pkdpc,
-					pkdpc->DeferredContext,
-					pkdpc->SystemArgument1,
-					pkdpc->SystemArgument2);
-			}
-		}
+		// Deferred routines could have (re)set timers, so determine the wait afterwards :
+		dwWait = KiTimerWheelWait(CxbxXboxPerformanceCounter());
 
 //    Assert(g_DpcData._dwThreadId == GetCurrentThreadId());
 //    Assert(g_DpcData._dwDpcThreadId == g_DpcData._dwThreadId);
 //    g_DpcData._dwDpcThreadId = 0;
 		LeaveCriticalSection(&(g_DpcData.Lock));
 
-		// TODO : Wait for shutdown too here
+		// Wait for the next timer, a new Dpc or shutdown (all of which set DpcEvent) :
 		WaitForSingleObject(g_DpcData.DpcEvent, dwWait);
 	} // while
 
@@ -258,22 +485,44 @@ DWORD __stdcall EmuThreadDpcHandler(LPVOID lpVoid)
 
 void InitDpcAndTimerThread()
 {
-	DWORD dwThreadId;
+	int Level;
+	int Slot;
 
 	InitializeCriticalSection(&(g_DpcData.Lock));
 	InitializeListHead(&(g_DpcData.DpcQueue));
-	InitializeListHead(&(g_DpcData.TimerQueue));
+	for (Level = 0; Level < TIMER_WHEEL_LEVELS; Level++)
+		for (Slot = 0; Slot < TIMER_WHEEL_SLOTS; Slot++)
+			InitializeListHead(&(g_TimerWheel.Slots[Level][Slot]));
+
+	g_TimerWheel.CurrentTick = CxbxXboxPerformanceCounter() >> TIMER_TICK_SHIFT;
+	// Timer waits are in milliseconds, so make sure the host wakes us up that precise :
+	timeBeginPeriod(1);
 	g_DpcData.DpcEvent = CreateEvent(/*lpEventAttributes=*/nullptr, /*bManualReset=*/FALSE, /*bInitialState=*/FALSE, /*lpName=*/nullptr);
-	g_DpcData.DpcThread = CreateThread(/*lpThreadAttributes=*/nullptr, /*dwStackSize=*/0, (LPTHREAD_START_ROUTINE)&EmuThreadDpcHandler, /*lpParameter=*/nullptr, /*dwCreationFlags=*/0, &dwThreadId);
+	g_DpcData.DpcThread = CreateThread(/*lpThreadAttributes=*/nullptr, /*dwStackSize=*/0, (LPTHREAD_START_ROUTINE)&EmuThreadDpcHandler, /*lpParameter=*/nullptr, /*dwCreationFlags=*/0, &(g_DpcData.DpcThreadId));
 	SetThreadPriority(g_DpcData.DpcThread, THREAD_PRIORITY_HIGHEST);
 }
 
-// Xbox Performance Counter Frequency = 337F98 = ACPI timer frequency (3.375000 Mhz)
-#define XBOX_PERFORMANCE_FREQUENCY 3375000 
+void CxbxShutdownDpcAndTimerThread()
+{
+	if (g_DpcData.DpcThread == NULL)
+		return;
 
-LARGE_INTEGER NativePerformanceCounter = { 0 };
-LARGE_INTEGER NativePerformanceFrequency = { 0 };
-double NativeToXbox_FactorForPerformanceFrequency;
+	// Only the first call shuts down (both the kernel and the cleanup paths call this)
+	EnterCriticalSection(&(g_DpcData.Lock));
+	bool bAlreadyShutdown = g_DpcData.bShutdown;
+	g_DpcData.bShutdown = true;
+	LeaveCriticalSection(&(g_DpcData.Lock));
+	if (bAlreadyShutdown)
+		return;
+
+	// Let the thread finish the Dpc's it's running (unless we're called from one of those)
+	SetEvent(g_DpcData.DpcEvent);
+	if (GetCurrentThreadId() != g_DpcData.DpcThreadId)
+		WaitForSingleObject(g_DpcData.DpcThread, 1000);
+
+	// Restore the host timer resolution, set by InitDpcAndTimerThread
+	timeEndPeriod(1);
+}
 
 void ConnectKeInterruptTimeToThunkTable(); // forward
 
@@ -424,12 +673,15 @@ XBSYSAPI EXPORTNUM(96) xboxkrnl::BOOLEAN NTAPI xboxkrnl::KeCancelTimer
 
 	BOOLEAN Inserted;
 
+	EnterCriticalSection(&(g_DpcData.Lock));
 	Inserted = Timer->Header.Inserted;
 	if (Inserted != FALSE) {
 		// Do some unlinking if already inserted in the linked list
 		KiRemoveTreeTimer(Timer);
 	}
 
+	LeaveCriticalSection(&(g_DpcData.Lock));
+
 	RETURN(Inserted);
 }
 
@@ -896,22 +1148,9 @@ XBSYSAPI EXPORTNUM(126) xboxkrnl::ULONGLONG NTAPI xboxkrnl::KeQueryPerformanceCo
 {
 	LOG_FUNC();
 
-	ULONGLONG ret;
-	::LARGE_INTEGER PerformanceCounter;
-
 	// TODO : When Cxbx emulates the RDTSC opcode, use the same handling here.
+	ULONGLONG ret = CxbxXboxPerformanceCounter();
 
-	// Dxbx note : Xbox actually uses the RDTSC machine code instruction for this,
-	// and we we're bound to a single core, so we could do that too, but on Windows
-	// rdtsc is not a very stable counter, so instead, we'll use the native PeformanceCounter :
-	QueryPerformanceCounter(&PerformanceCounter);
-
-	// Re-base the performance counter to increase accuracy of the following conversion :
-	PerformanceCounter.QuadPart -= NativePerformanceCounter.QuadPart;
-	// We appy a conversion factor here, to fake Xbox1-like increment-speed behaviour :
-	PerformanceCounter.QuadPart = (ULONGLONG)(NativeToXbox_FactorForPerformanceFrequency * PerformanceCounter.QuadPart);
-
-	ret = PerformanceCounter.QuadPart;
 	RETURN(ret);
 }
 
@@ -1194,6 +1433,9 @@ XBSYSAPI EXPORTNUM(150) xboxkrnl::BOOLEAN NTAPI xboxkrnl::KeSetTimerEx
 		CxbxKrnlCleanup("Assertion: '(Timer)->Header.Type == TimerNotificationObject) || ((Timer)->Header.Type == TimerSynchronizationObject)' in KeSetTimerEx()");
 	}
 
+	// The timer wheel is shared with the Dpc thread :
+	EnterCriticalSection(&(g_DpcData.Lock));
+
 	// Same as KeCancelTimer(Timer) :
 	Inserted = Timer->Header.Inserted;
 	if (Inserted != FALSE) {
@@ -1223,19 +1465,8 @@ XBSYSAPI EXPORTNUM(150) xboxkrnl::BOOLEAN NTAPI xboxkrnl::KeSetTimerEx
 				;
 		}
 	}
-/* Dxbx has this :
-	EnterCriticalSection(&(g_DpcData.Lock));
-	if (Timer->TimerListEntry.Flink == nullptr) 
-	{
-		Timer->DueTime.QuadPart := (DueTime.QuadPart / -10000) + CxbxXboxGetTickCount();
-		Timer->Period = Period;
-		Timer->Dpc = Dpc;
-		InsertTailList(&(g_DpcData.TimerQueue), &(Timer->TimerListEntry));
-	}
 
 	LeaveCriticalSection(&(g_DpcData.Lock));
-	SetEvent(g_DpcData.DpcEvent);
-*/
 
 	RETURN(Inserted);
 }
@@ -54,7 +54,10 @@ namespace NtDll
 
 #include "CxbxKrnl.h" // For CxbxKrnlCleanup
 #include "Emu.h" // For EmuWarning()
+#include "EmuKrnl.h" // For EmuObCreateObjectHandle(), EmuObCloseObjectHandle()
 #include "EmuFile.h" // For EmuNtSymbolicLinkObject, NtStatusToString(), etc.
+#include "HandleTable.h"
+#include "EmuXiso.h" // For EmuNtXisoFile
 #include "EmuAlloc.h" // For CxbxFree(), g_MemoryManager.Allocate(), etc.
 #include "MemoryManager.h"
 
@@ -220,11 +223,23 @@ XBSYSAPI EXPORTNUM(187) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtClose
 
 	if (IsEmuHandle(Handle))
 	{
-		// delete 'special' handles
-		EmuHandle *iEmuHandle = HandleToEmuHandle(Handle);
-		ret = iEmuHandle->NtClose();
+		// delete 'special' handles, any later use of them fails
+		PVOID Object;
 
-		LOG_UNIMPLEMENTED(); // TODO : Base this on the Ob* functions
+		switch (g_HandleTable.Remove(Handle, &Object)) {
+		case HANDLE_TYPE_EMU: {
+			EmuHandle *iEmuHandle = (EmuHandle *)Object;
+			ret = iEmuHandle->NtClose();
+			delete iEmuHandle;
+			break;
+		}
+		case HANDLE_TYPE_OBJECT:
+			EmuObCloseObjectHandle(Object);
+			break;
+		default:
+			EmuWarning("NtClose of a closed handle (0x%.08X)!", Handle);
+			ret = STATUS_INVALID_HANDLE;
+		}
 	}
 	else
 		// close normal handles
@@ -691,22 +706,30 @@ XBSYSAPI EXPORTNUM(197) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtDuplicateObject
 	NTSTATUS ret = STATUS_SUCCESS;
 
 	if (IsEmuHandle(SourceHandle)) {
-		EmuHandle* iEmuHandle = HandleToEmuHandle(SourceHandle);
-		ret = iEmuHandle->NtDuplicateObject(TargetHandle, Options);
-/*
 		PVOID Object;
 
-		ret = ObReferenceObjectByHandle(SourceHandle, /*ObjectType=* /NULL, &Object);
-		if (NT_SUCCESS(ret)) {
-			if (ObpIsFlagSet(Options, DUPLICATE_CLOSE_SOURCE))
-				NtClose(SourceHandle);
-
-			status = ObOpenObjectByPointer(Object, OBJECT_TO_OBJECT_HEADER(Object)->Type, /*OUT* /TargetHandle);
-			ObDereferenceObject(Object);
-		}
-		else
+		switch (g_HandleTable.Lookup(SourceHandle, &Object)) {
+		case HANDLE_TYPE_EMU:
+			ret = ((EmuHandle *)Object)->NtDuplicateObject(TargetHandle, Options);
+			break;
+		case HANDLE_TYPE_OBJECT:
+			// The new handle holds a reference of its own
+			ret = ObReferenceObjectByPointer(Object, /*ObjectType=*/NULL);
+			if (NT_SUCCESS(ret)) {
+				*TargetHandle = EmuObCreateObjectHandle(Object);
+				if (*TargetHandle == NULL) {
+					ObfDereferenceObject(Object);
+					ret = STATUS_INSUFFICIENT_RESOURCES;
+				}
+			}
+			break;
+		default:
 			*TargetHandle = NULL;
-*/
+			ret = STATUS_INVALID_HANDLE;
+		}
+
+		if (NT_SUCCESS(ret) && (Options & DUPLICATE_CLOSE_SOURCE))
+			NtClose(SourceHandle);
 	}
 	else
 	{
@@ -1027,6 +1050,13 @@ XBSYSAPI EXPORTNUM(207) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtQueryDirectoryFile
 	if (FileInformationClass != FileDirectoryInformation)   // Due to unicode->string conversion
 		CxbxKrnlCleanup("Unsupported FileInformationClass");
 
+	EmuNtXisoFile *XisoFile = CxbxXisoFileByHandle(FileHandle);
+	if (XisoFile != nullptr)
+	{
+		ret = XisoFile->NtQueryDirectoryFile(Event, ApcRoutine, ApcContext, IoStatusBlock, FileInformation, Length, FileMask, RestartScan);
+		RETURN(ret);
+	}
+
 	NtDll::UNICODE_STRING NtFileMask;
 
 	wchar_t wszObjectName[MAX_PATH];
@@ -1109,13 +1139,22 @@ XBSYSAPI EXPORTNUM(210) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtQueryFullAttributes
 		/*var*/nativeObjectAttributes, 
 		"NtQueryFullAttributesFile");
 
-	if (ret == STATUS_SUCCESS)
-		ret = NtDll::NtQueryFullAttributesFile(
-			nativeObjectAttributes.NtObjAttrPtr, 
-			&nativeNetOpenInfo);
-	
-	// Convert Attributes to Xbox
-	NTToXboxFileInformation(&nativeNetOpenInfo, Attributes, FileNetworkOpenInformation, sizeof(xboxkrnl::FILE_NETWORK_OPEN_INFORMATION));
+	EmuXisoImage *XisoImage = nullptr;
+	if ((ret == STATUS_SUCCESS) && (nativeObjectAttributes.NtObjAttrPtr != nullptr))
+		XisoImage = CxbxXisoImageByRootHandle(nativeObjectAttributes.NtObjAttr.RootDirectory);
+
+	if (XisoImage != nullptr)
+		ret = CxbxXisoQueryFullAttributes(XisoImage, nativeObjectAttributes.wszObjectName, Attributes);
+	else
+	{
+		if (ret == STATUS_SUCCESS)
+			ret = NtDll::NtQueryFullAttributesFile(
+				nativeObjectAttributes.NtObjAttrPtr, 
+				&nativeNetOpenInfo);
+
+		// Convert Attributes to Xbox
+		NTToXboxFileInformation(&nativeNetOpenInfo, Attributes, FileNetworkOpenInformation, sizeof(xboxkrnl::FILE_NETWORK_OPEN_INFORMATION));
+	}
 
 	if (FAILED(ret))
 		EmuWarning("NtQueryFullAttributesFile failed! (0x%.08X)", ret);
@@ -1173,6 +1212,13 @@ XBSYSAPI EXPORTNUM(211) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtQueryInformationFil
 	NTSTATUS ret;
 	PVOID ntFileInfo;
 
+	EmuNtXisoFile *XisoFile = CxbxXisoFileByHandle(FileHandle);
+	if (XisoFile != nullptr)
+	{
+		ret = XisoFile->NtQueryInformationFile(IoStatusBlock, FileInformation, Length, FileInformationClass);
+		RETURN(ret);
+	}
+
 	// Start with sizeof(corresponding struct)
 	size_t bufferSize = XboxFileInfoStructSizes[FileInformationClass];
 
@@ -1296,6 +1342,9 @@ XBSYSAPI EXPORTNUM(215) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtQuerySymbolicLinkOb
 	ret = STATUS_INVALID_HANDLE;
 
 	EmuHandle* iEmuHandle = HandleToEmuHandle(LinkHandle);
+	if (iEmuHandle == nullptr)
+		RETURN(ret);
+
 	// Retrieve the NtSymbolicLinkObject and populate the output arguments :
 	ret = STATUS_SUCCESS;
 	symbolicLinkObject = (EmuNtSymbolicLinkObject*)iEmuHandle->NtObject;
@@ -1422,6 +1471,13 @@ XBSYSAPI EXPORTNUM(218) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtQueryVolumeInformat
 		LOG_FUNC_ARG(FileInformationClass)
 		LOG_FUNC_END;
 
+	EmuNtXisoFile *XisoFile = CxbxXisoFileByHandle(FileHandle);
+	if (XisoFile != nullptr)
+	{
+		NTSTATUS ret = XisoFile->NtQueryVolumeInformationFile(IoStatusBlock, FileInformation, Length, FileInformationClass);
+		RETURN(ret);
+	}
+
 	NTSTATUS ret = NtDll::NtQueryVolumeInformationFile(
 		FileHandle,
 		(NtDll::PIO_STATUS_BLOCK)IoStatusBlock,
@@ -1482,6 +1538,13 @@ XBSYSAPI EXPORTNUM(219) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtReadFile
 	//    if(ByteOffset != 0 && ByteOffset->QuadPart == 0x00120800)
 	//        _asm int 3
 
+	EmuNtXisoFile *XisoFile = CxbxXisoFileByHandle(FileHandle);
+	if (XisoFile != nullptr)
+	{
+		NTSTATUS ret = XisoFile->NtReadFile(Event, ApcRoutine, ApcContext, IoStatusBlock, Buffer, Length, ByteOffset);
+		RETURN(ret);
+	}
+
 	NTSTATUS ret = NtDll::NtReadFile(
 		FileHandle,
 		Event,
@@ -1617,6 +1680,13 @@ XBSYSAPI EXPORTNUM(226) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtSetInformationFile
 		LOG_FUNC_ARG(Length)
 		LOG_FUNC_ARG(FileInformationClass)
 		LOG_FUNC_END;
+
+	EmuNtXisoFile *XisoFile = CxbxXisoFileByHandle(FileHandle);
+	if (XisoFile != nullptr)
+	{
+		NTSTATUS ret = XisoFile->NtSetInformationFile(IoStatusBlock, FileInformation, Length, FileInformationClass);
+		RETURN(ret);
+	}
 	
 	XboxToNTFileInformation(convertedFileInfo, FileInformation, FileInformationClass, &Length);
 
@@ -1880,6 +1950,14 @@ XBSYSAPI EXPORTNUM(236) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtWriteFile
 	//    if(ByteOffset != 0 && ByteOffset->QuadPart == 0x01C00800)
 	//        _asm int 3
 
+	// Images are read-only
+	if (CxbxXisoFileByHandle(FileHandle) != nullptr)
+	{
+		IoStatusBlock->Status = STATUS_MEDIA_WRITE_PROTECTED;
+		IoStatusBlock->Information = 0;
+		RETURN(STATUS_MEDIA_WRITE_PROTECTED);
+	}
+
 	NTSTATUS ret = NtDll::NtWriteFile(
 		FileHandle,
 		Event,
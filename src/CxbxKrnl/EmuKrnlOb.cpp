@@ -56,6 +56,7 @@ namespace NtDll
 #include "Emu.h" // For EmuWarning()
 #include "EmuKrnl.h" // For OBJECT_TO_OBJECT_HEADER()
 #include "EmuFile.h" // For EmuNtSymbolicLinkObject, NtStatusToString(), etc.
+#include "HandleTable.h"
 
 #pragma warning(disable:4005) // Ignore redefined status values
 #include <ntstatus.h>
@@ -71,13 +72,25 @@ xboxkrnl::HANDLE EmuObCreateObjectHandle
 {
 	LOG_FUNC_ONE_ARG(Object);
 
-	HANDLE Handle = (HANDLE)Object; // Fake it for now
-
-	LOG_INCOMPLETE(); // TODO : Create an actual handle
+	// The handle holds the reference the caller obtained on the object
+	HANDLE Handle = g_HandleTable.Insert(Object, HANDLE_TYPE_OBJECT);
+	if (Handle != NULL)
+		InterlockedIncrement(&CONTAINING_RECORD(Object, xboxkrnl::OBJECT_HEADER, Body)->HandleCount);
 
 	return Handle;
 }
 
+void EmuObCloseObjectHandle
+(
+	IN xboxkrnl::PVOID Object
+)
+{
+	LOG_FUNC_ONE_ARG(Object);
+
+	InterlockedDecrement(&CONTAINING_RECORD(Object, xboxkrnl::OBJECT_HEADER, Body)->HandleCount);
+	xboxkrnl::ObfDereferenceObject(Object);
+}
+
 xboxkrnl::NTSTATUS EmuObFindObjectByHandle
 (
 	IN xboxkrnl::HANDLE Handle,
@@ -91,12 +104,10 @@ xboxkrnl::NTSTATUS EmuObFindObjectByHandle
 
 	NTSTATUS Status = STATUS_SUCCESS;
 
-	*Object = (PVOID)Handle; // Fake it for now
-	
-	LOG_INCOMPLETE(); // TODO : Lookup an actual handle
-
-	if (*Object == NULL)
+	if (g_HandleTable.Lookup(Handle, Object) != HANDLE_TYPE_OBJECT) {
+		*Object = NULL;
 		Status = STATUS_INVALID_HANDLE;
+	}
 
 	return Status;
 }
@@ -389,8 +400,11 @@ XBSYSAPI EXPORTNUM(246) xboxkrnl::NTSTATUS NTAPI xboxkrnl::ObReferenceObjectByHa
 
 	NTSTATUS Status = EmuObFindObjectByHandle(Handle, ReturnedObject);
 
-	if (NT_SUCCESS(Status))
-		Status = ObReferenceObjectByPointer(ReturnedObject, ObjectType);
+	if (NT_SUCCESS(Status)) {
+		Status = ObReferenceObjectByPointer(*ReturnedObject, ObjectType);
+		if (!NT_SUCCESS(Status))
+			*ReturnedObject = NULL;
+	}
 
 	RETURN(Status);
 }
@@ -54,46 +54,15 @@ namespace NtDll
 
 #include "CxbxKrnl.h" // For CxbxKrnlCleanup()
 #include "Emu.h" // For EmuWarning()
+#include "Common/RtlPrimitives.h"
+#include "CriticalSectionRegistry.h" // For FindCriticalSection()
 
-// A critical section containing the PC and Xbox equivalent
-struct INTERNAL_CRITICAL_SECTION
+// Mirrors the state of the native section in the Xbox one
+static inline void UpdateCriticalSection(xboxkrnl::PRTL_CRITICAL_SECTION CriticalSection, INTERNAL_CRITICAL_SECTION *pSection)
 {
-	xboxkrnl::PRTL_CRITICAL_SECTION XboxCriticalSection;
-	NtDll::_RTL_CRITICAL_SECTION NativeCriticalSection;
-};
-
-#define MAX_XBOX_CRITICAL_SECTIONS 1024
-INTERNAL_CRITICAL_SECTION GlobalCriticalSections[MAX_XBOX_CRITICAL_SECTIONS] = { 0 };
-
-void InitializeSectionStructures(void)
-{
-	ZeroMemory(GlobalCriticalSections, sizeof(GlobalCriticalSections));
-}
-
-int FindCriticalSection(xboxkrnl::PRTL_CRITICAL_SECTION CriticalSection)
-{
-	int FreeSection = -1;
-
-	int iSection = 0;
-	for (iSection = 0; iSection < MAX_XBOX_CRITICAL_SECTIONS; ++iSection)
-	{
-		if (GlobalCriticalSections[iSection].XboxCriticalSection == CriticalSection)
-		{
-			FreeSection = iSection;
-			break;
-		}
-		else if (FreeSection < 0 && GlobalCriticalSections[iSection].XboxCriticalSection == NULL)
-		{
-			FreeSection = iSection;
-		}
-	}
-
-	if (FreeSection < 0)
-	{
-		EmuWarning("Too many critical sections in use!\n");
-	}
-
-	return FreeSection;
+	CriticalSection->LockCount = pSection->NativeCriticalSection.LockCount;
+	CriticalSection->RecursionCount = pSection->NativeCriticalSection.RecursionCount;
+	CriticalSection->OwningThread = pSection->NativeCriticalSection.OwningThread;
 }
 
 // ******************************************************************
@@ -224,7 +193,7 @@ XBSYSAPI EXPORTNUM(267) xboxkrnl::NTSTATUS NTAPI xboxkrnl::RtlCharToInteger
 // * compare block of memory, return number of equivalent bytes.
 // *
 // ******************************************************************
-XBSYSAPI EXPORTNUM(268) xboxkrnl::BOOLEAN NTAPI xboxkrnl::RtlCompareMemory
+XBSYSAPI EXPORTNUM(268) xboxkrnl::SIZE_T NTAPI xboxkrnl::RtlCompareMemory
 (
 	IN CONST VOID *Source1,
 	IN CONST VOID *Source2,
@@ -237,7 +206,7 @@ XBSYSAPI EXPORTNUM(268) xboxkrnl::BOOLEAN NTAPI xboxkrnl::RtlCompareMemory
 		LOG_FUNC_ARG(Length)
 		LOG_FUNC_END;
 
-	BOOL result = NtDll::RtlCompareMemory(Source1, Source2, Length);
+	SIZE_T result = RtlpCompareMemory(Source1, Source2, Length);
 
 	RETURN(result);
 }
@@ -258,7 +227,7 @@ XBSYSAPI EXPORTNUM(269) xboxkrnl::SIZE_T NTAPI xboxkrnl::RtlCompareMemoryUlong
 		LOG_FUNC_ARG(Pattern)
 		LOG_FUNC_END;
 
-	SIZE_T result = NtDll::RtlCompareMemoryUlong(Source, Length, Pattern);
+	SIZE_T result = RtlpCompareMemoryUlong(Source, Length, Pattern);
 
 	RETURN(result);
 }
@@ -414,20 +383,10 @@ XBSYSAPI EXPORTNUM(277) xboxkrnl::VOID NTAPI xboxkrnl::RtlEnterCriticalSection
 	// This seems redundant, but xbox software doesn't always do it
 	if (CriticalSection)
 	{
-		int iSection = FindCriticalSection(CriticalSection);
+		INTERNAL_CRITICAL_SECTION *pSection = FindCriticalSection(CriticalSection);
 
-		if (iSection >= 0)
-		{
-			GlobalCriticalSections[iSection].XboxCriticalSection = CriticalSection;
-			if (CriticalSection->LockCount < 0)
-				NtDll::RtlInitializeCriticalSection(&GlobalCriticalSections[iSection].NativeCriticalSection);
-
-			NtDll::RtlEnterCriticalSection(&GlobalCriticalSections[iSection].NativeCriticalSection);
-
-			CriticalSection->LockCount = GlobalCriticalSections[iSection].NativeCriticalSection.LockCount;
-			CriticalSection->RecursionCount = GlobalCriticalSections[iSection].NativeCriticalSection.RecursionCount;
-			CriticalSection->OwningThread = GlobalCriticalSections[iSection].NativeCriticalSection.OwningThread;
-		}
+		EnterNativeCriticalSection(pSection);
+		UpdateCriticalSection(CriticalSection, pSection);
 
 		//if(CriticalSection->LockCount == -1)
 		//NtDll::RtlInitializeCriticalSection((NtDll::_RTL_CRITICAL_SECTION*)CriticalSection);
@@ -619,7 +578,7 @@ XBSYSAPI EXPORTNUM(285) xboxkrnl::VOID NTAPI xboxkrnl::RtlFillMemoryUlong
 		LOG_FUNC_ARG(Pattern)
 		LOG_FUNC_END;
 
-	NtDll::RtlFillMemoryUlong(Destination, Length, Pattern);
+	RtlpFillMemoryUlong(Destination, Length, Pattern);
 }
 
 // ******************************************************************
@@ -697,17 +656,9 @@ XBSYSAPI EXPORTNUM(291) xboxkrnl::VOID NTAPI xboxkrnl::RtlInitializeCriticalSect
 	/*
 	LOG_FUNC_ONE_ARG(CriticalSection);
 	//*/
-	int iSection = FindCriticalSection(CriticalSection);
+	INTERNAL_CRITICAL_SECTION *pSection = InitializeCriticalSectionEntry(CriticalSection);
 
-	if (iSection >= 0)
-	{
-		GlobalCriticalSections[iSection].XboxCriticalSection = CriticalSection;
-		NtDll::RtlInitializeCriticalSection(&GlobalCriticalSections[iSection].NativeCriticalSection);
-
-		CriticalSection->LockCount = GlobalCriticalSections[iSection].NativeCriticalSection.LockCount;
-		CriticalSection->RecursionCount = GlobalCriticalSections[iSection].NativeCriticalSection.RecursionCount;
-		CriticalSection->OwningThread = GlobalCriticalSections[iSection].NativeCriticalSection.OwningThread;
-	}
+	UpdateCriticalSection(CriticalSection, pSection);
 
 	//NtDll::RtlInitializeCriticalSection((NtDll::_RTL_CRITICAL_SECTION*)CriticalSection);
 }
@@ -772,16 +723,13 @@ XBSYSAPI EXPORTNUM(294) xboxkrnl::VOID NTAPI xboxkrnl::RtlLeaveCriticalSection
 	LOG_FUNC_ONE_ARG(CriticalSection);
 	//*/
 
-	int iSection = FindCriticalSection(CriticalSection);
+	// A section that was never entered can't be left
+	INTERNAL_CRITICAL_SECTION *pSection = FindCriticalSection(CriticalSection, false);
 
-	if (iSection >= 0)
+	if (pSection != nullptr)
 	{
-		GlobalCriticalSections[iSection].XboxCriticalSection = CriticalSection;
-		NtDll::RtlLeaveCriticalSection(&GlobalCriticalSections[iSection].NativeCriticalSection);
-
-		CriticalSection->LockCount = GlobalCriticalSections[iSection].NativeCriticalSection.LockCount;
-		CriticalSection->RecursionCount = GlobalCriticalSections[iSection].NativeCriticalSection.RecursionCount;
-		CriticalSection->OwningThread = GlobalCriticalSections[iSection].NativeCriticalSection.OwningThread;
+		NtDll::RtlLeaveCriticalSection(&pSection->NativeCriticalSection);
+		UpdateCriticalSection(CriticalSection, pSection);
 	}
 
 	// Note: We need to execute this before debug output to avoid trouble
@@ -877,14 +825,14 @@ XBSYSAPI EXPORTNUM(299) xboxkrnl::NTSTATUS NTAPI xboxkrnl::RtlMultiByteToUnicode
 		LOG_FUNC_ARG(BytesInMultiByteString)
 		LOG_FUNC_END;
 
-	NTSTATUS result = NtDll::RtlMultiByteToUnicodeN(
-		UnicodeString,
-		MaxBytesInUnicodeString,
-		BytesInUnicodeString,
-		MultiByteString,
-		BytesInMultiByteString);
+	// The Xbox has no code pages, every byte is a Latin-1 character
+	ULONG BytesWritten = (ULONG)RtlpMultiByteToUnicodeN((uint16_t*)UnicodeString, MaxBytesInUnicodeString,
+		MultiByteString, BytesInMultiByteString);
 
-	RETURN(result);
+	if (BytesInUnicodeString != NULL)
+		*BytesInUnicodeString = BytesWritten;
+
+	RETURN(STATUS_SUCCESS);
 }
 
 // ******************************************************************
@@ -979,20 +927,11 @@ XBSYSAPI EXPORTNUM(306) xboxkrnl::BOOLEAN NTAPI xboxkrnl::RtlTryEnterCriticalSec
 
 	BOOL bRet = FALSE;
 
-	int iSection = FindCriticalSection(CriticalSection);
+	INTERNAL_CRITICAL_SECTION *pSection = FindCriticalSection(CriticalSection);
 
-	if (iSection >= 0)
-	{
-		GlobalCriticalSections[iSection].XboxCriticalSection = CriticalSection;
-		if (CriticalSection->LockCount < 0)
-			NtDll::RtlInitializeCriticalSection(&GlobalCriticalSections[iSection].NativeCriticalSection);
+	bRet = TryEnterNativeCriticalSection(pSection);
 
-		bRet = NtDll::RtlTryEnterCriticalSection(&GlobalCriticalSections[iSection].NativeCriticalSection);
-
-		CriticalSection->LockCount = GlobalCriticalSections[iSection].NativeCriticalSection.LockCount;
-		CriticalSection->RecursionCount = GlobalCriticalSections[iSection].NativeCriticalSection.RecursionCount;
-		CriticalSection->OwningThread = GlobalCriticalSections[iSection].NativeCriticalSection.OwningThread;
-	}
+	UpdateCriticalSection(CriticalSection, pSection);
 
 	//bRet = NtDll::RtlTryEnterCriticalSection((NtDll::PRTL_CRITICAL_SECTION)CriticalSection);
 
@@ -1076,14 +1015,14 @@ XBSYSAPI EXPORTNUM(310) xboxkrnl::NTSTATUS NTAPI xboxkrnl::RtlUnicodeToMultiByte
 		LOG_FUNC_ARG(BytesInUnicodeString)
 		LOG_FUNC_END;
 
-	NTSTATUS ret = NtDll::RtlUnicodeToMultiByteN(
-		MultiByteString,
-		MaxBytesInMultiByteString,
-		BytesInMultiByteString,
-		UnicodeString,
-		BytesInUnicodeString);
+	// The Xbox has no code pages, characters beyond Latin-1 become '?'
+	ULONG BytesWritten = (ULONG)RtlpUnicodeToMultiByteN(MultiByteString, MaxBytesInMultiByteString,
+		(const uint16_t*)UnicodeString, BytesInUnicodeString);
 
-	RETURN(ret);
+	if (BytesInMultiByteString != NULL)
+		*BytesInMultiByteString = BytesWritten;
+
+	RETURN(STATUS_SUCCESS);
 }
 
 // ******************************************************************
@@ -1141,12 +1080,32 @@ XBSYSAPI EXPORTNUM(314) xboxkrnl::NTSTATUS NTAPI xboxkrnl::RtlUpcaseUnicodeStrin
 		LOG_FUNC_ARG(AllocateDestinationString)
 		LOG_FUNC_END;
 
-	NTSTATUS result = NtDll::RtlUpcaseUnicodeString(
-		(NtDll::PUNICODE_STRING)DestinationString,
-		(NtDll::PUNICODE_STRING)SourceString,
-		AllocateDestinationString);
+	USHORT Length = SourceString->Length;
 
-	RETURN(result);
+	// Allocated the way NtDll::RtlFreeUnicodeString frees
+	if (AllocateDestinationString) {
+		DestinationString->MaximumLength = Length;
+		DestinationString->Buffer = (PWSTR)NtDll::RtlAllocateHeap(GetProcessHeap(), 0, Length);
+		if (DestinationString->Buffer == NULL)
+			RETURN(STATUS_NO_MEMORY);
+	}
+	else if (Length > DestinationString->MaximumLength)
+		RETURN(STATUS_BUFFER_OVERFLOW);
+
+	// Upcase ASCII runs in bulk, and other characters one by one
+	uint16_t *pDestination = (uint16_t*)DestinationString->Buffer;
+	const uint16_t *pSource = (const uint16_t*)SourceString->Buffer;
+	size_t Count = Length / sizeof(WCHAR);
+	size_t i = RtlpUpcaseUnicodeAscii(pDestination, pSource, Count);
+	while (i < Count) {
+		pDestination[i] = NtDll::RtlUpcaseUnicodeChar(pSource[i]);
+		i++;
+		i += RtlpUpcaseUnicodeAscii(pDestination + i, pSource + i, Count - i);
+	}
+
+	DestinationString->Length = Length;
+
+	RETURN(STATUS_SUCCESS);
 }
 
 // ******************************************************************
@@ -49,6 +49,7 @@
 
 #include <distorm.h> // For uint32_t
 #include <string> // For std::string
+#include <assert.h>
 
 #include "CxbxKrnl.h"
 #include "device.h"
@@ -97,11 +98,64 @@
 #define NV_PRAMDAC_SIZE             0x001000
 #define NV_PRMDIO_ADDR   0x00681000
 #define NV_PRMDIO_SIZE              0x001000
-#define NV_PRAMIN_ADDR   0x00710000
+#define NV_PRAMIN_ADDR   0x00700000
 #define NV_PRAMIN_SIZE              0x100000
 #define NV_USER_ADDR     0x00800000
 #define NV_USER_SIZE                0x800000
 
+#define GET_MASK(v, mask) (((v) & (mask)) / ((mask) & ~((mask) - 1)))
+#define SET_MASK(v, mask, val) ((v) = ((v) & ~(mask)) | (((val) * ((mask) & ~((mask) - 1))) & (mask)))
+
+#define NV2A_NUM_CHANNELS 32
+#define NV2A_NUM_SUBCHANNELS 8
+
+// CACHE1 holds 128 entries on real hardware; this one is larger, so the
+// pusher (running on the CPU) can get further ahead of the puller thread
+#define NV2A_CACHE1_SIZE 1024
+
+typedef struct CacheEntry {
+	uint32_t method;
+	uint32_t subchannel;
+	uint32_t parameter;
+} CacheEntry;
+
+typedef enum FIFOEngine {
+	ENGINE_SOFTWARE = 0,
+	ENGINE_GRAPHICS = 1,
+	ENGINE_DVD = 2,
+} FIFOEngine;
+
+typedef struct RAMHTEntry {
+	uint32_t handle;
+	xbaddr instance;
+	FIFOEngine engine;
+	unsigned int channel_id : 5;
+	bool valid;
+} RAMHTEntry;
+
+typedef struct Cache1State {
+	// Ring of methods, filled by the pusher and drained by the puller thread.
+	// put and get only ever increase; put - get entries are queued.
+	CacheEntry cache[NV2A_CACHE1_SIZE];
+	volatile uint32_t put;
+	volatile uint32_t get;
+
+	CRITICAL_SECTION pusher_lock; // only one pusher runs at a time
+	HANDLE cache_event;           // signalled when entries are queued or pulling is enabled
+	volatile LONG pusher_stalled; // the pusher stopped on a full cache, the puller restarts it
+	volatile LONG puller_stop;    // set by EmuNV2A_Shutdown, makes the puller thread return
+
+	FIFOEngine bound_engines[NV2A_NUM_SUBCHANNELS];
+	FIFOEngine last_engine;
+
+	// metrics
+	volatile uint32_t max_depth;
+	volatile uint32_t pushed;
+	volatile uint32_t pulled;
+	volatile uint32_t pusher_stalls;
+	volatile uint32_t puller_waits;
+} Cache1State;
+
 struct {
 	uint32_t pending_interrupts;
 	uint32_t enabled_interrupts;
@@ -111,9 +165,9 @@ struct {
 struct {
 	uint32_t pending_interrupts;
 	uint32_t enabled_interrupts;
-	//TODO:
-	// QemuThread puller_thread;
-	// Cache1State cache1;
+	HANDLE puller_thread;
+	DWORD puller_thread_id;
+	Cache1State cache1;
 	uint32_t regs[NV_PFIFO_SIZE / sizeof(uint32_t)]; // TODO : union
 } pfifo;
 
@@ -157,9 +211,16 @@ struct {
 struct {
 	uint32_t pending_interrupts;
 	uint32_t enabled_interrupts;
+	xbaddr subchannel_objects[NV2A_NUM_SUBCHANNELS];
+	xbaddr dma_semaphore;
+	uint32_t semaphore_offset;
 	uint32_t regs[NV_PGRAPH_SIZE / sizeof(uint32_t)]; // TODO : union
 } pgraph;
 
+struct {
+	uint32_t ref[NV2A_NUM_CHANNELS];
+} user;
+
 
 static void update_irq()
 {
@@ -213,6 +274,419 @@ static void update_irq()
 }
 
 
+//
+// PFIFO
+//
+
+static RAMHTEntry ramht_lookup(uint32_t handle)
+{
+	unsigned int ramht_size = 1 << (GET_MASK(pfifo.regs[NV_PFIFO_RAMHT / 4], NV_PFIFO_RAMHT_SIZE) + 12);
+
+	// Hash the handle together with the channel, the way xqemu does
+	unsigned int bits = GET_MASK(pfifo.regs[NV_PFIFO_RAMHT / 4], NV_PFIFO_RAMHT_SIZE) + 12 - 1;
+
+	unsigned int hash = 0;
+	uint32_t h = handle;
+	while (h) {
+		hash ^= (h & ((1 << bits) - 1));
+		h >>= bits;
+	}
+
+	unsigned int channel_id = GET_MASK(pfifo.regs[NV_PFIFO_CACHE1_PUSH1 / 4], NV_PFIFO_CACHE1_PUSH1_CHID);
+	hash ^= channel_id << (bits - 4);
+
+	RAMHTEntry entry = { 0 };
+
+	xbaddr ramht_address = GET_MASK(pfifo.regs[NV_PFIFO_RAMHT / 4], NV_PFIFO_RAMHT_BASE_ADDRESS) << 12;
+	if (hash * 8 >= ramht_size || ramht_address + hash * 8 + 8 > NV_PRAMIN_SIZE) {
+		return entry;
+	}
+
+	uint32_t *entry_ptr = &pramin.regs[(ramht_address + hash * 8) / 4];
+	uint32_t entry_context = entry_ptr[1];
+
+	entry.handle = entry_ptr[0];
+	entry.instance = (entry_context & NV_RAMHT_INSTANCE) << 4;
+	entry.engine = (FIFOEngine)((entry_context & NV_RAMHT_ENGINE) >> 16);
+	entry.channel_id = (entry_context & NV_RAMHT_CHID) >> 24;
+	entry.valid = (entry_context & NV_RAMHT_STATUS) != 0;
+
+	return entry;
+}
+
+// Returns the host address of the memory a DMA object (in RAMIN) refers to
+static uint8_t *nv_dma_map(xbaddr dma_obj_address, uint32_t *len)
+{
+	if (dma_obj_address + 12 > NV_PRAMIN_SIZE) {
+		*len = 0;
+		return nullptr;
+	}
+
+	uint32_t *dma_obj = &pramin.regs[dma_obj_address / 4];
+	uint32_t flags = dma_obj[0];
+	uint32_t limit = dma_obj[1];
+	uint32_t frame = dma_obj[2];
+
+	xbaddr address = (frame & NV_DMA_ADDRESS) | GET_MASK(flags, NV_DMA_ADJUST);
+
+	// The limit is the offset of the last accessible byte
+	*len = (limit == 0xFFFFFFFF) ? limit : limit + 1;
+
+	// Physical memory is accessible through the system physical map
+	return (uint8_t *)(MM_SYSTEM_PHYSICAL_MAP + address);
+}
+
+// Executes the methods titles synchronize with : object binding, flip bookkeeping and
+// semaphore releases. Rendering methods are not executed here, since drawing goes
+// through the Direct3D patches; those are only logged.
+static void pgraph_method(unsigned int subchannel, uint32_t method, uint32_t parameter)
+{
+	uint32_t *surface = &pgraph.regs[NV_PGRAPH_SURFACE / 4];
+
+	switch (method) {
+	case NV_SET_OBJECT:
+		pgraph.subchannel_objects[subchannel] = parameter;
+		break;
+	case NV097_NO_OPERATION:
+	case NV097_WAIT_FOR_IDLE:
+		// Methods are executed in order, so there's never anything to wait for
+		break;
+	case NV097_SET_FLIP_READ:
+		SET_MASK(*surface, NV_PGRAPH_SURFACE_READ_3D, parameter);
+		break;
+	case NV097_SET_FLIP_WRITE:
+		SET_MASK(*surface, NV_PGRAPH_SURFACE_WRITE_3D, parameter);
+		break;
+	case NV097_SET_FLIP_MODULO:
+		SET_MASK(*surface, NV_PGRAPH_SURFACE_MODULO_3D, parameter);
+		break;
+	case NV097_FLIP_INCREMENT_WRITE: {
+		uint32_t modulo = GET_MASK(*surface, NV_PGRAPH_SURFACE_MODULO_3D);
+		uint32_t write = GET_MASK(*surface, NV_PGRAPH_SURFACE_WRITE_3D) + 1;
+
+		SET_MASK(*surface, NV_PGRAPH_SURFACE_WRITE_3D, (modulo != 0) ? write % modulo : write);
+		break;
+	}
+	case NV097_FLIP_STALL:
+		// TODO : Wait until the flip read index catches up (xqemu waits for the vblank)
+		break;
+	case NV097_SET_CONTEXT_DMA_SEMAPHORE:
+		// The puller already resolved the handle to the DMA object instance
+		pgraph.dma_semaphore = parameter;
+		break;
+	case NV097_SET_SEMAPHORE_OFFSET:
+		pgraph.semaphore_offset = parameter;
+		break;
+	case NV097_BACK_END_WRITE_SEMAPHORE_RELEASE: {
+		uint32_t semaphore_len;
+		uint8_t *semaphore = nv_dma_map(pgraph.dma_semaphore, &semaphore_len);
+
+		if (semaphore == nullptr || semaphore_len < 4 || pgraph.semaphore_offset > semaphore_len - 4) {
+			EmuWarning("NV2A PGRAPH : Semaphore offset 0x%08X is outside its DMA object", pgraph.semaphore_offset);
+			break;
+		}
+
+		*(volatile uint32_t *)(semaphore + pgraph.semaphore_offset) = parameter;
+		break;
+	}
+	default:
+		DbgPrintf("NV2A PGRAPH method (%d) 0x%04X = 0x%08X [Unhandled]\n", subchannel, method, parameter);
+	}
+}
+
+static void pfifo_run_pusher();
+
+static void pfifo_pull(const CacheEntry *command)
+{
+	Cache1State *state = &pfifo.cache1;
+
+	if (command->method == NV_SET_OBJECT) {
+		RAMHTEntry entry = ramht_lookup(command->parameter);
+		if (!entry.valid) {
+			EmuWarning("NV2A PFIFO : No object for handle 0x%08X", command->parameter);
+			return;
+		}
+
+		switch (entry.engine) {
+		case ENGINE_GRAPHICS:
+			pgraph_method(command->subchannel, NV_SET_OBJECT, entry.instance);
+			break;
+		default:
+			EmuWarning("NV2A PFIFO : Objects of engine %d are not supported", entry.engine);
+			break;
+		}
+
+		// the engine is bound to the subchannel
+		state->bound_engines[command->subchannel] = entry.engine;
+		state->last_engine = entry.engine;
+	} else if (command->method >= 0x100) {
+		// method passed to engine
+		uint32_t parameter = command->parameter;
+
+		// methods that take objects
+		if (command->method >= 0x180 && command->method < 0x200) {
+			RAMHTEntry entry = ramht_lookup(parameter);
+			if (entry.valid) {
+				parameter = entry.instance;
+			}
+		}
+
+		switch (state->bound_engines[command->subchannel]) {
+		case ENGINE_GRAPHICS:
+			pgraph_method(command->subchannel, command->method, parameter);
+			break;
+		default:
+			EmuWarning("NV2A PFIFO : Method 0x%04X for unsupported engine %d", command->method, state->bound_engines[command->subchannel]);
+			break;
+		}
+
+		state->last_engine = state->bound_engines[command->subchannel];
+	}
+}
+
+static DWORD WINAPI pfifo_puller_thread(LPVOID lpParameter)
+{
+	Cache1State *state = &pfifo.cache1;
+
+	while (!state->puller_stop) {
+		// Wait until there's something to pull, and pulling is enabled
+		while (state->get == state->put || !(pfifo.regs[NV_PFIFO_CACHE1_PULL0 / 4] & NV_PFIFO_CACHE1_PULL0_ACCESS)) {
+			if (state->puller_stop) {
+				return 0;
+			}
+
+			state->puller_waits++;
+			WaitForSingleObject(state->cache_event, INFINITE);
+		}
+
+		uint32_t put = state->put;
+
+		while (state->get != put) {
+			pfifo_pull(&state->cache[state->get % NV2A_CACHE1_SIZE]);
+
+			state->get++;
+			state->pulled++;
+		}
+
+		// Room was made, so let a stalled pusher continue
+		if (InterlockedExchange(&state->pusher_stalled, 0)) {
+			pfifo_run_pusher();
+		}
+	}
+
+	return 0;
+}
+
+// Moves the methods between DMA_GET and DMA_PUT into CACHE1
+static void pfifo_run_pusher()
+{
+	Cache1State *state = &pfifo.cache1;
+
+	// Not initialized (pusher and puller only run in LLE GPU mode)
+	if (state->cache_event == NULL) {
+		return;
+	}
+
+	EnterCriticalSection(&state->pusher_lock);
+
+	uint32_t *push0 = &pfifo.regs[NV_PFIFO_CACHE1_PUSH0 / 4];
+	uint32_t *push1 = &pfifo.regs[NV_PFIFO_CACHE1_PUSH1 / 4];
+	uint32_t *dma_subroutine = &pfifo.regs[NV_PFIFO_CACHE1_DMA_SUBROUTINE / 4];
+	uint32_t *dma_state = &pfifo.regs[NV_PFIFO_CACHE1_DMA_STATE / 4];
+	uint32_t *dma_push = &pfifo.regs[NV_PFIFO_CACHE1_DMA_PUSH / 4];
+	uint32_t *dma_get = &pfifo.regs[NV_PFIFO_CACHE1_DMA_GET / 4];
+	uint32_t *dma_put = &pfifo.regs[NV_PFIFO_CACHE1_DMA_PUT / 4];
+	uint32_t *dcount = &pfifo.regs[NV_PFIFO_CACHE1_DMA_DCOUNT / 4];
+
+	// Pushing must be enabled, and not suspended
+	if (!GET_MASK(*push0, NV_PFIFO_CACHE1_PUSH0_ACCESS)
+		|| !GET_MASK(*dma_push, NV_PFIFO_CACHE1_DMA_PUSH_ACCESS)
+		|| GET_MASK(*dma_push, NV_PFIFO_CACHE1_DMA_PUSH_STATUS)) {
+		LeaveCriticalSection(&state->pusher_lock);
+		return;
+	}
+
+	// The channel must be running in DMA mode
+	unsigned int channel_id = GET_MASK(*push1, NV_PFIFO_CACHE1_PUSH1_CHID);
+	if (!(pfifo.regs[NV_PFIFO_MODE / 4] & (1 << channel_id)) || !GET_MASK(*push1, NV_PFIFO_CACHE1_PUSH1_MODE)) {
+		EmuWarning("NV2A PFIFO : Channel %d is not in DMA mode", channel_id);
+		LeaveCriticalSection(&state->pusher_lock);
+		return;
+	}
+
+	xbaddr dma_instance = GET_MASK(pfifo.regs[NV_PFIFO_CACHE1_DMA_INSTANCE / 4], NV_PFIFO_CACHE1_DMA_INSTANCE_ADDRESS) << 4;
+	uint32_t dma_len;
+	uint8_t *dma = nv_dma_map(dma_instance, &dma_len);
+
+	bool queued = false;
+
+	while (true) {
+		uint32_t dma_get_v = *dma_get;
+		uint32_t dma_put_v = *dma_put;
+		if (dma_get_v == dma_put_v) {
+			break;
+		}
+
+		// The whole word must lie within the DMA object
+		if (dma == nullptr || dma_len < 4 || dma_get_v > dma_len - 4) {
+			SET_MASK(*dma_state, NV_PFIFO_CACHE1_DMA_STATE_ERROR, NV_PFIFO_CACHE1_DMA_STATE_ERROR_PROTECTION);
+			break;
+		}
+
+		uint32_t method_type = GET_MASK(*dma_state, NV_PFIFO_CACHE1_DMA_STATE_METHOD_TYPE);
+		uint32_t method_subchannel = GET_MASK(*dma_state, NV_PFIFO_CACHE1_DMA_STATE_SUBCHANNEL);
+		uint32_t method = GET_MASK(*dma_state, NV_PFIFO_CACHE1_DMA_STATE_METHOD) << 2;
+		uint32_t method_count = GET_MASK(*dma_state, NV_PFIFO_CACHE1_DMA_STATE_METHOD_COUNT);
+		uint32_t subroutine_state = GET_MASK(*dma_subroutine, NV_PFIFO_CACHE1_DMA_SUBROUTINE_STATE);
+
+		if (method_count) {
+			// Data word of a methods command; stop when CACHE1 is full
+			uint32_t depth = state->put - state->get;
+			if (depth >= NV2A_CACHE1_SIZE) {
+				InterlockedExchange(&state->pusher_stalled, 1);
+
+				// Check again, in case the puller emptied the cache in the mean time
+				if (state->put - state->get >= NV2A_CACHE1_SIZE) {
+					state->pusher_stalls++;
+					break;
+				}
+
+				InterlockedExchange(&state->pusher_stalled, 0);
+			}
+
+			uint32_t word = *(uint32_t *)(dma + dma_get_v);
+			dma_get_v += 4;
+
+			pfifo.regs[NV_PFIFO_CACHE1_DMA_DATA_SHADOW / 4] = word;
+
+			CacheEntry *command = &state->cache[state->put % NV2A_CACHE1_SIZE];
+			command->method = method;
+			command->subchannel = method_subchannel;
+			command->parameter = word;
+			state->put++;
+			state->pushed++;
+			queued = true;
+
+			if (depth + 1 > state->max_depth) {
+				state->max_depth = depth + 1;
+			}
+
+			if (!method_type) {
+				method += 4;
+			}
+
+			SET_MASK(*dma_state, NV_PFIFO_CACHE1_DMA_STATE_METHOD, method >> 2);
+			SET_MASK(*dma_state, NV_PFIFO_CACHE1_DMA_STATE_METHOD_COUNT, method_count - 1);
+			(*dcount)++;
+		} else {
+			// No command active - this is the first word of a new one
+			uint32_t word = *(uint32_t *)(dma + dma_get_v);
+			dma_get_v += 4;
+
+			pfifo.regs[NV_PFIFO_CACHE1_DMA_RSVD_SHADOW / 4] = word;
+
+			if ((word & 0xE0000003) == 0x20000000) {
+				// old jump
+				pfifo.regs[NV_PFIFO_CACHE1_DMA_GET_JMP_SHADOW / 4] = dma_get_v;
+				dma_get_v = word & 0x1FFFFFFF;
+			} else if ((word & 3) == 1) {
+				// jump
+				pfifo.regs[NV_PFIFO_CACHE1_DMA_GET_JMP_SHADOW / 4] = dma_get_v;
+				dma_get_v = word & 0xFFFFFFFC;
+			} else if ((word & 3) == 2) {
+				// call
+				if (subroutine_state) {
+					SET_MASK(*dma_state, NV_PFIFO_CACHE1_DMA_STATE_ERROR, NV_PFIFO_CACHE1_DMA_STATE_ERROR_CALL);
+					break;
+				}
+
+				*dma_subroutine = dma_get_v;
+				SET_MASK(*dma_subroutine, NV_PFIFO_CACHE1_DMA_SUBROUTINE_STATE, 1);
+				dma_get_v = word & 0xFFFFFFFC;
+			} else if (word == 0x00020000) {
+				// return
+				if (!subroutine_state) {
+					SET_MASK(*dma_state, NV_PFIFO_CACHE1_DMA_STATE_ERROR, NV_PFIFO_CACHE1_DMA_STATE_ERROR_RETURN);
+					break;
+				}
+
+				dma_get_v = *dma_subroutine & 0xFFFFFFFC;
+				SET_MASK(*dma_subroutine, NV_PFIFO_CACHE1_DMA_SUBROUTINE_STATE, 0);
+			} else if ((word & 0xE0030003) == 0 || (word & 0xE0030003) == 0x40000000) {
+				// (non-)increasing methods
+				SET_MASK(*dma_state, NV_PFIFO_CACHE1_DMA_STATE_METHOD, (word & 0x1FFF) >> 2);
+				SET_MASK(*dma_state, NV_PFIFO_CACHE1_DMA_STATE_SUBCHANNEL, (word >> 13) & 7);
+				SET_MASK(*dma_state, NV_PFIFO_CACHE1_DMA_STATE_METHOD_COUNT, (word >> 18) & 0x7FF);
+				SET_MASK(*dma_state, NV_PFIFO_CACHE1_DMA_STATE_METHOD_TYPE, (word & 0x40000000) ? 1 : 0);
+				*dcount = 0;
+			} else {
+				SET_MASK(*dma_state, NV_PFIFO_CACHE1_DMA_STATE_ERROR, NV_PFIFO_CACHE1_DMA_STATE_ERROR_RESERVED_CMD);
+				break;
+			}
+		}
+
+		*dma_get = dma_get_v;
+	}
+
+	if (GET_MASK(*dma_state, NV_PFIFO_CACHE1_DMA_STATE_ERROR)) {
+		EmuWarning("NV2A PFIFO : DMA pusher error %d at 0x%08X", GET_MASK(*dma_state, NV_PFIFO_CACHE1_DMA_STATE_ERROR), *dma_get);
+
+		// suspended
+		SET_MASK(*dma_push, NV_PFIFO_CACHE1_DMA_PUSH_STATUS, 1);
+
+		pfifo.pending_interrupts |= NV_PFIFO_INTR_0_DMA_PUSHER;
+		update_irq();
+	}
+
+	LeaveCriticalSection(&state->pusher_lock);
+
+	if (queued || state->pusher_stalled) {
+		SetEvent(state->cache_event);
+	}
+}
+
+void EmuNV2A_Init()
+{
+	Cache1State *state = &pfifo.cache1;
+
+	InitializeCriticalSection(&state->pusher_lock);
+	state->cache_event = CreateEvent(NULL, FALSE, FALSE, NULL);
+
+	DWORD dwThreadId;
+	HANDLE hThread = CreateThread(NULL, NULL, pfifo_puller_thread, NULL, NULL, &dwThreadId);
+	if (hThread == NULL) {
+		CxbxKrnlCleanup("NV2A : Could not create the PFIFO puller thread");
+	}
+
+	pfifo.puller_thread_id = dwThreadId;
+	pfifo.puller_thread = hThread;
+}
+
+void EmuNV2A_Shutdown()
+{
+	Cache1State *state = &pfifo.cache1;
+
+	if (pfifo.puller_thread == NULL) {
+		return;
+	}
+
+	// Only the first call stops the thread (cleanup can be reached more than once)
+	if (InterlockedExchange(&state->puller_stop, 1)) {
+		return;
+	}
+
+	// Wake the puller, so it sees the stop flag; it finishes the methods it's pulling
+	// first, unless we're called from one of those
+	SetEvent(state->cache_event);
+	if (GetCurrentThreadId() != pfifo.puller_thread_id) {
+		WaitForSingleObject(pfifo.puller_thread, 1000);
+	}
+
+	CloseHandle(pfifo.puller_thread);
+	pfifo.puller_thread = NULL;
+}
+
+
 #define DEBUG_START(DEV) \
 const char *DebugNV_##DEV##(xbaddr addr) \
 { \
@@ -512,11 +986,22 @@ DEBUG_END(USER)
 
 
 
+// Register access logging is only compiled in trace builds, where it's
+// switched on and off at runtime via g_bPrintfOn (the DebugNV_ lookups are
+// only evaluated when printing)
+#ifdef _DEBUG_TRACE
 #define DEBUG_READ32(DEV)            DbgPrintf("EmuX86 Read32 NV2A " #DEV "(0x%08X) = 0x%08X [Handled, %s]\n", addr, result, DebugNV_##DEV##(addr))
 #define DEBUG_READ32_UNHANDLED(DEV)  { DbgPrintf("EmuX86 Read32 NV2A " #DEV "(0x%08X) = 0x%08X [Unhandled, %s]\n", addr, result, DebugNV_##DEV##(addr)); return result; }
 
 #define DEBUG_WRITE32(DEV)           DbgPrintf("EmuX86 Write32 NV2A " #DEV "(0x%08X, 0x%08X) [Handled, %s]\n", addr, value, DebugNV_##DEV##(addr))
 #define DEBUG_WRITE32_UNHANDLED(DEV) { DbgPrintf("EmuX86 Write32 NV2A " #DEV "(0x%08X, 0x%08X) [Unhandled, %s]\n", addr, value, DebugNV_##DEV##(addr)); return; }
+#else
+#define DEBUG_READ32(DEV)
+#define DEBUG_READ32_UNHANDLED(DEV)  { return result; }
+
+#define DEBUG_WRITE32(DEV)
+#define DEBUG_WRITE32_UNHANDLED(DEV) { return; }
+#endif
 
 #define DEVICE_READ32(DEV) uint32_t EmuNV2A_##DEV##_Read32(xbaddr addr)
 #define DEVICE_READ32_SWITCH() uint32_t result = 0; switch (addr) 
@@ -608,6 +1093,21 @@ DEVICE_WRITE32(PBUS)
 DEVICE_READ32(PFIFO)
 {
 	DEVICE_READ32_SWITCH() {
+	case NV_PFIFO_CACHE1_STATUS: {
+		uint32_t depth = pfifo.cache1.put - pfifo.cache1.get;
+		if (depth == 0) {
+			result |= NV_PFIFO_CACHE1_STATUS_LOW_MARK; // empty
+		} else if (depth >= NV2A_CACHE1_SIZE) {
+			result |= NV_PFIFO_CACHE1_STATUS_HIGH_MARK; // full
+		}
+		break;
+	}
+	case NV_PFIFO_CACHE1_DMA_PUSH:
+		DEVICE_READ32_REG(pfifo);
+		if (pfifo.cache1.put == pfifo.cache1.get) {
+			result |= NV_PFIFO_CACHE1_DMA_PUSH_BUFFER; // empty
+		}
+		break;
 	case NV_PFIFO_RAMHT:
 		result = 0x03000100; // = NV_PFIFO_RAMHT_SIZE_4K | NV_PFIFO_RAMHT_BASE_ADDRESS(NumberOfPaddingBytes >> 12) | NV_PFIFO_RAMHT_SEARCH_128
 	case NV_PFIFO_RAMFC:
@@ -622,6 +1122,18 @@ DEVICE_READ32(PFIFO)
 DEVICE_WRITE32(PFIFO)
 {
 	switch(addr) {
+	case NV_PFIFO_CACHE1_PULL0:
+		DEVICE_WRITE32_REG(pfifo);
+		// Wake up the puller, in case pulling got enabled
+		if (pfifo.cache1.cache_event != NULL) {
+			SetEvent(pfifo.cache1.cache_event);
+		}
+		break;
+	case NV_PFIFO_CACHE1_DMA_PUSH:
+		DEVICE_WRITE32_REG(pfifo);
+		// Pushing could have been enabled or resumed
+		pfifo_run_pusher();
+		break;
 	default: 
 		DEVICE_WRITE32_REG(pfifo); // Was : DEBUG_WRITE32_UNHANDLED(PFIFO);
 	}
@@ -1064,7 +1576,24 @@ DEVICE_WRITE32(PRAMIN)
 
 DEVICE_READ32(USER)
 {
-	DEVICE_READ32_SWITCH() {
+	unsigned int channel_id = addr >> 16;
+	if (channel_id >= NV2A_NUM_CHANNELS || !(pfifo.regs[NV_PFIFO_MODE / 4] & (1 << channel_id))) {
+		uint32_t result = 0;
+		DEBUG_READ32_UNHANDLED(USER); // TODO : PIO mode
+	}
+
+	// DMA mode
+	uint32_t result = 0;
+	switch (addr & 0xFFFF) {
+	case NV_USER_DMA_PUT:
+		result = pfifo.regs[NV_PFIFO_CACHE1_DMA_PUT / 4];
+		break;
+	case NV_USER_DMA_GET:
+		result = pfifo.regs[NV_PFIFO_CACHE1_DMA_GET / 4];
+		break;
+	case NV_USER_REF:
+		result = user.ref[channel_id];
+		break;
 	default:
 		DEBUG_READ32_UNHANDLED(USER);
 	}
@@ -1074,7 +1603,24 @@ DEVICE_READ32(USER)
 
 DEVICE_WRITE32(USER)
 {
-	switch (addr) {
+	unsigned int channel_id = addr >> 16;
+	if (channel_id >= NV2A_NUM_CHANNELS || !(pfifo.regs[NV_PFIFO_MODE / 4] & (1 << channel_id))) {
+		DEBUG_WRITE32_UNHANDLED(USER); // TODO : PIO mode
+	}
+
+	// DMA mode
+	switch (addr & 0xFFFF) {
+	case NV_USER_DMA_PUT:
+		pfifo.regs[NV_PFIFO_CACHE1_DMA_PUT / 4] = value;
+		// Move the new methods into CACHE1, the puller thread executes them
+		pfifo_run_pusher();
+		break;
+	case NV_USER_DMA_GET:
+		pfifo.regs[NV_PFIFO_CACHE1_DMA_GET / 4] = value;
+		break;
+	case NV_USER_REF:
+		user.ref[channel_id] = value;
+		break;
 	default:
 		DEBUG_WRITE32_UNHANDLED(USER);
 	}
@@ -1088,6 +1634,8 @@ typedef struct NV2ABlockInfo {
 		uint32_t size;
 		uint32_t(*read)(xbaddr addr);
 		void(*write)(xbaddr addr, uint32_t value);
+		const char *name;
+		uint32_t *regs; // register storage, used to merge narrow writes (nullptr if the block has none)
 } NV2ABlockInfo;
 
 static const NV2ABlockInfo regions[] = {{
@@ -1096,143 +1644,227 @@ static const NV2ABlockInfo regions[] = {{
 		NV_PMC_SIZE, // = 0x001000
 		EmuNV2A_PMC_Read32,
 		EmuNV2A_PMC_Write32,
+		"PMC",
+		pmc.regs,
 	}, {
 		/* bus control */
 		NV_PBUS_ADDR, // = 0x001000
 		NV_PBUS_SIZE, // = 0x001000
 		EmuNV2A_PBUS_Read32,
 		EmuNV2A_PBUS_Write32,
+		"PBUS",
+		nullptr,
 	}, {
 		/* MMIO and DMA FIFO submission to PGRAPH and VPE */
 		NV_PFIFO_ADDR, // = 0x002000
 		NV_PFIFO_SIZE, // = 0x002000
 		EmuNV2A_PFIFO_Read32,
 		EmuNV2A_PFIFO_Write32,
+		"PFIFO",
+		pfifo.regs,
 	}, {
 		/* access to BAR0/BAR1 from real mode */
 		NV_PRMA_ADDR, // = 0x007000
 		NV_PRMA_SIZE, // = 0x001000
 		EmuNV2A_PRMA_Read32,
 		EmuNV2A_PRMA_Write32,
+		"PRMA",
+		nullptr,
 	}, {
 		/* video overlay */
 		NV_PVIDEO_ADDR, // = 0x008000
 		NV_PVIDEO_SIZE, // = 0x001000
 		EmuNV2A_PVIDEO_Read32,
 		EmuNV2A_PVIDEO_Write32,
+		"PVIDEO",
+		pvideo.regs,
 	}, {
 		/* time measurement and time-based alarms */
 		NV_PTIMER_ADDR, // = 0x009000
 		NV_PTIMER_SIZE, // = 0x001000
 		EmuNV2A_PTIMER_Read32,
 		EmuNV2A_PTIMER_Write32,
+		"PTIMER",
+		ptimer.regs,
 	}, {
 		/* performance monitoring counters */
 		NV_PCOUNTER_ADDR, // = 0x00a000
 		NV_PCOUNTER_SIZE, // = 0x001000
 		EmuNV2A_PCOUNTER_Read32,
 		EmuNV2A_PCOUNTER_Write32,
+		"PCOUNTER",
+		nullptr,
 	}, {
 		/* MPEG2 decoding engine */
 		NV_PVPE_ADDR, // = 0x00b000
 		NV_PVPE_SIZE, // = 0x001000
 		EmuNV2A_PVPE_Read32,
 		EmuNV2A_PVPE_Write32,
+		"PVPE",
+		nullptr,
 	},	{
 		/* TV encoder */
 		NV_PTV_ADDR, // = 0x00d000
 		NV_PTV_SIZE, // = 0x001000
 		EmuNV2A_PTV_Read32,
 		EmuNV2A_PTV_Write32,
+		"PTV",
+		nullptr,
 	}, {
 		/* aliases VGA memory window */
 		NV_PRMFB_ADDR, // = 0x0a0000
 		NV_PRMFB_SIZE, // = 0x020000
 		EmuNV2A_PRMFB_Read32,
 		EmuNV2A_PRMFB_Write32,
+		"PRMFB",
+		nullptr,
 	}, {
 		/* aliases VGA sequencer and graphics controller registers */
 		NV_PRMVIO_ADDR, // = 0x0c0000
 		NV_PRMVIO_SIZE, // = 0x001000
 		EmuNV2A_PRMVIO_Read32,
 		EmuNV2A_PRMVIO_Write32,
+		"PRMVIO",
+		nullptr,
 	},{
 		/* memory interface */
 		NV_PFB_ADDR, // = 0x100000
 		NV_PFB_SIZE, // = 0x001000
 		EmuNV2A_PFB_Read32,
 		EmuNV2A_PFB_Write32,
+		"PFB",
+		pfb.regs,
 	}, {
 		/* straps readout / override */
 		NV_PSTRAPS_ADDR, // = 0x101000
 		NV_PSTRAPS_SIZE, // = 0x001000
 		EmuNV2A_PSTRAPS_Read32,
 		EmuNV2A_PSTRAPS_Write32,
+		"PSTRAPS",
+		nullptr,
 	}, {
 		/* accelerated 2d/3d drawing engine */
 		NV_PGRAPH_ADDR, // = 0x400000
 		NV_PGRAPH_SIZE, // = 0x002000
 		EmuNV2A_PGRAPH_Read32,
 		EmuNV2A_PGRAPH_Write32,
+		"PGRAPH",
+		pgraph.regs,
 	}, {
 		/* more CRTC controls */
 		NV_PCRTC_ADDR, // = 0x600000
 		NV_PCRTC_SIZE, // = 0x001000
 		EmuNV2A_PCRTC_Read32,
 		EmuNV2A_PCRTC_Write32,
+		"PCRTC",
+		pcrtc.regs,
 	}, {
 		/* aliases VGA CRTC and attribute controller registers */
 		NV_PRMCIO_ADDR, // = 0x601000
 		NV_PRMCIO_SIZE, // = 0x001000
 		EmuNV2A_PRMCIO_Read32,
 		EmuNV2A_PRMCIO_Write32,
+		"PRMCIO",
+		nullptr,
 	}, {
 		/* RAMDAC, cursor, and PLL control */
 		NV_PRAMDAC_ADDR, // = 0x680000
 		NV_PRAMDAC_SIZE, // = 0x001000
 		EmuNV2A_PRAMDAC_Read32,
 		EmuNV2A_PRAMDAC_Write32,
+		"PRAMDAC",
+		pramdac.regs,
 	}, {
 		/* aliases VGA palette registers */
 		NV_PRMDIO_ADDR, // = 0x681000
 		NV_PRMDIO_SIZE, // = 0x001000
 		EmuNV2A_PRMDIO_Read32,
 		EmuNV2A_PRMDIO_Write32,
+		"PRMDIO",
+		nullptr,
 	}, {
 		/* RAMIN access */
-		NV_PRAMIN_ADDR, // = 0x710000
+		NV_PRAMIN_ADDR, // = 0x700000
 		NV_PRAMIN_SIZE, // = 0x100000
 		EmuNV2A_PRAMIN_Read32,
 		EmuNV2A_PRAMIN_Write32,
+		"PRAMIN",
+		pramin.regs,
 	},{
 		/* PFIFO MMIO and DMA submission area */
 		NV_USER_ADDR, // = 0x800000,
 		NV_USER_SIZE, // = 0x800000,
 		EmuNV2A_USER_Read32,
 		EmuNV2A_USER_Write32,
+		"USER",
+		nullptr,
 	}, {
 		0xFFFFFFFF,
 		0,
 		nullptr,
 		nullptr,
+		nullptr,
+		nullptr,
 	},
 };
 
-const NV2ABlockInfo* EmuNV2A_Block(xbaddr addr) 
+#define NV2A_BLOCK_PAGE_SHIFT 12 // All blocks start and end on a 4 KB boundary
+#define NV2A_BLOCK_PAGE_COUNT (NV2A_SIZE >> NV2A_BLOCK_PAGE_SHIFT)
+#define NV2A_BLOCK_COUNT (sizeof(regions) / sizeof(regions[0]))
+
+// Block handling each 4 KB page of the NV2A register space (nullptr for gaps)
+static const NV2ABlockInfo* g_NV2ABlockPages[NV2A_BLOCK_PAGE_COUNT];
+
+// Access counters per block
+static volatile uint32_t g_NV2ABlockReads[NV2A_BLOCK_COUNT];
+static volatile uint32_t g_NV2ABlockWrites[NV2A_BLOCK_COUNT];
+
+static bool EmuNV2A_InitBlockPages()
 {
-	// Find the block in the block table
 	const NV2ABlockInfo* block = &regions[0];
 	int i = 0;
 
 	while (block->read != nullptr) {
-		if (addr >= block->offset && addr < block->offset + block->size) {
-			return block;
+		// No two blocks overlap, so each page belongs to exactly one
+		for (uint32_t page = block->offset >> NV2A_BLOCK_PAGE_SHIFT; page < (block->offset + block->size) >> NV2A_BLOCK_PAGE_SHIFT; page++) {
+			g_NV2ABlockPages[page] = block;
 		}
 
 		block = &regions[++i];
 	}
 
-	return nullptr;
+	return true;
+}
+
+// Filled once, during static initialization
+static bool g_NV2ABlockPagesInitialized = EmuNV2A_InitBlockPages();
+
+const NV2ABlockInfo* EmuNV2A_Block(xbaddr addr) 
+{
+	if (addr >= NV2A_SIZE) {
+		return nullptr;
+	}
+
+	return g_NV2ABlockPages[addr >> NV2A_BLOCK_PAGE_SHIFT];
+}
+
+void EmuNV2A_DumpAccessCounts()
+{
+	printf("NV2A register accesses per block :\n");
+
+	for (int i = 0; regions[i].read != nullptr; i++) {
+		if (g_NV2ABlockReads[i] == 0 && g_NV2ABlockWrites[i] == 0) {
+			continue;
+		}
+
+		printf("  %-8s : %u reads, %u writes\n", regions[i].name, g_NV2ABlockReads[i], g_NV2ABlockWrites[i]);
+	}
+
+	Cache1State *state = &pfifo.cache1;
+
+	printf("NV2A PFIFO : %u methods pushed, %u pulled, %u queued (at most %u of %u), %u pusher stalls, %u puller waits\n",
+		state->pushed, state->pulled, state->put - state->get, state->max_depth, NV2A_CACHE1_SIZE,
+		state->pusher_stalls, state->puller_waits);
 }
 
 uint32_t EmuNV2A_Read32(xbaddr addr)
@@ -1240,6 +1872,7 @@ uint32_t EmuNV2A_Read32(xbaddr addr)
 	const NV2ABlockInfo* block = EmuNV2A_Block(addr);
 
 	if (block != nullptr) {
+		g_NV2ABlockReads[block - regions]++;
 		return block->read(addr - block->offset);
 	}
 
@@ -1252,6 +1885,7 @@ void EmuNV2A_Write32(xbaddr addr, uint32_t value)
 	const NV2ABlockInfo* block = EmuNV2A_Block(addr);
 
 	if (block != nullptr) {
+		g_NV2ABlockWrites[block - regions]++;
 		block->write(addr - block->offset, value);
 		return;
 	}
@@ -1260,6 +1894,51 @@ void EmuNV2A_Write32(xbaddr addr, uint32_t value)
 	return;
 }
 
+// Registers are 32 bits wide; an 8, 16 or 24 bit access must lie within one register
+static inline uint32_t EmuNV2A_SizeMask(int size)
+{
+	return (size >= 32) ? 0xFFFFFFFF : ((1 << size) - 1);
+}
+
+uint32_t EmuNV2A_Read(xbaddr addr, int size)
+{
+	if (size == 32) {
+		return EmuNV2A_Read32(addr);
+	}
+
+	int shift = (addr & 3) * 8;
+	assert(shift + size <= 32);
+
+	// Narrow reads take their part of the register, with a single device read
+	return (EmuNV2A_Read32(addr & ~3) >> shift) & EmuNV2A_SizeMask(size);
+}
+
+void EmuNV2A_Write(xbaddr addr, uint32_t value, int size)
+{
+	if (size == 32) {
+		EmuNV2A_Write32(addr, value);
+		return;
+	}
+
+	int shift = (addr & 3) * 8;
+	assert(shift + size <= 32);
+
+	xbaddr aligned_addr = addr & ~3;
+	uint32_t mask = EmuNV2A_SizeMask(size) << shift;
+	const NV2ABlockInfo* block = EmuNV2A_Block(aligned_addr);
+
+	// The bytes that aren't written keep their stored value. Blocks without register
+	// storage have to be read back, which reaches the device twice.
+	uint32_t current;
+	if (block != nullptr && block->regs != nullptr) {
+		current = block->regs[(aligned_addr - block->offset) / sizeof(uint32_t)];
+	} else {
+		current = EmuNV2A_Read32(aligned_addr);
+	}
+
+	EmuNV2A_Write32(aligned_addr, (current & ~mask) | ((value << shift) & mask));
+}
+
 //
 // OPENGL
 //
@@ -43,6 +43,19 @@
 uint32_t EmuNV2A_Read32(xbaddr addr);
 void EmuNV2A_Write32(xbaddr addr, uint32_t value);
 
+// 8, 16, 24 or 32 bit accesses, which must lie within one register
+uint32_t EmuNV2A_Read(xbaddr addr, int size);
+void EmuNV2A_Write(xbaddr addr, uint32_t value, int size);
+
+// Start the PFIFO puller thread (LLE GPU mode only)
+void EmuNV2A_Init();
+
+// Stop the PFIFO puller thread, if it was started
+void EmuNV2A_Shutdown();
+
+// Print how often each register block was accessed, and PFIFO queue statistics
+void EmuNV2A_DumpAccessCounts();
+
 void InitOpenGLContext();
 
 #endif
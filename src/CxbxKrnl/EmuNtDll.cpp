@@ -120,6 +120,7 @@ IMPORT(RtlCopyString);
 IMPORT(RtlCopyUnicodeString);
 IMPORT(RtlCreateHeap);
 IMPORT(RtlCreateUnicodeString);
+IMPORT(RtlDeleteCriticalSection);
 IMPORT(RtlDestroyHeap);
 IMPORT(RtlDowncaseUnicodeChar);
 IMPORT(RtlDowncaseUnicodeString);
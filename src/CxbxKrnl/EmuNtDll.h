@@ -1379,6 +1379,14 @@ typedef VOID (NTAPI *FPTR_RtlInitializeCriticalSection)
     IN PRTL_CRITICAL_SECTION CriticalSection
 );
 
+// ******************************************************************
+// * RtlDeleteCriticalSection
+// ******************************************************************
+typedef NTSTATUS (NTAPI *FPTR_RtlDeleteCriticalSection)
+(
+    IN PRTL_CRITICAL_SECTION CriticalSection
+);
+
 // ******************************************************************
 // * RtlEnterCriticalSection
 // ******************************************************************
@@ -1946,6 +1954,7 @@ EXTERN(RtlCopyString);
 EXTERN(RtlCopyUnicodeString);
 EXTERN(RtlCreateHeap);
 EXTERN(RtlCreateUnicodeString);
+EXTERN(RtlDeleteCriticalSection);
 EXTERN(RtlDestroyHeap);
 EXTERN(RtlDowncaseUnicodeChar);
 EXTERN(RtlDowncaseUnicodeString);
@@ -45,13 +45,14 @@
 #include "distorm.h"
 #include "mnemonics.h"
 
-#include "CxbxKrnl.h"
-#include "Emu.h"
-#include "EmuX86.h"
-#include "EmuNV2A.h"
-#include "HLEIntercept.h" // for bLLE_GPU
+#include "CxbxKrnl/CxbxKrnl.h"
+#include "CxbxKrnl/Emu.h"
+#include "CxbxKrnl/EmuX86.h"
+#include "CxbxKrnl/EmuNV2A.h"
+#include "CxbxKrnl/HLEIntercept.h" // for bLLE_GPU
 
 #include <assert.h>
+#include <intrin.h> // for __rdtsc
 
 //
 // Read & write handlers handlers for I/O
@@ -99,171 +100,139 @@ void EmuX86_IOWrite8(xbaddr addr, uint8_t value)
 
 uint32_t EmuX86_Mem_Read32(xbaddr addr)
 {
-	return *(uint32_t*)addr;
+	return *(uint32_t*)(uintptr_t)addr;
 }
 
 uint16_t EmuX86_Mem_Read16(xbaddr addr)
 {
-	return *(uint16_t*)addr;
+	return *(uint16_t*)(uintptr_t)addr;
 }
 
 uint8_t EmuX86_Mem_Read8(xbaddr addr)
 {
-	return *(uint8_t*)addr;
+	return *(uint8_t*)(uintptr_t)addr;
 }
 
 void EmuX86_Mem_Write32(xbaddr addr, uint32_t value)
 {
-	*(uint32_t*)addr = value;
+	*(uint32_t*)(uintptr_t)addr = value;
 }
 
 void EmuX86_Mem_Write16(xbaddr addr, uint16_t value)
 {
-	*(uint16_t*)addr = value;
+	*(uint16_t*)(uintptr_t)addr = value;
 }
 
 void EmuX86_Mem_Write8(xbaddr addr, uint8_t value)
 {
-	*(uint8_t*)addr = value;
+	*(uint8_t*)(uintptr_t)addr = value;
+}
+
+uint32_t EmuX86_Mem_Read(xbaddr addr, int size)
+{
+	switch (size) {
+	case 8:
+		return EmuX86_Mem_Read8(addr);
+	case 16:
+		return EmuX86_Mem_Read16(addr);
+	default:
+		return EmuX86_Mem_Read32(addr);
+	}
+}
+
+void EmuX86_Mem_Write(xbaddr addr, uint32_t value, int size)
+{
+	switch (size) {
+	case 8:
+		EmuX86_Mem_Write8(addr, (uint8_t)value);
+		break;
+	case 16:
+		EmuX86_Mem_Write16(addr, (uint16_t)value);
+		break;
+	default:
+		EmuX86_Mem_Write32(addr, value);
+		break;
+	}
 }
 
 
 //
 // Read & write handlers for memory-mapped hardware devices
 //
+// Accesses reach the device with their own width (8, 16 or 32 bits), so narrow
+// writes don't need a read-modify-write of the register they're part of.
+//
 
-uint32_t EmuX86_Read32Aligned(xbaddr addr)
+inline bool EmuX86_IsNV2AAddr(xbaddr addr)
 {
-	assert((addr & 3) == 0);
+	return addr >= NV2A_ADDR && addr < NV2A_ADDR + NV2A_SIZE;
+}
 
+uint32_t EmuX86_Read(xbaddr addr, int size)
+{
 	uint32_t value;
 
-	if (addr >= NV2A_ADDR && addr < NV2A_ADDR + NV2A_SIZE) {
+	if (EmuX86_IsNV2AAddr(addr)) {
 		if (!bLLE_GPU) {
-			EmuWarning("EmuX86_Read32Aligned(0x%08X) Unexpected NV2A access, missing a HLE patch. " \
-				"Please notify https://github.com/Cxbx-Reloaded/Cxbx-Reloaded which title raised this!", addr);
+			EmuWarning("EmuX86_Read(0x%08X, %d) Unexpected NV2A access, missing a HLE patch. " \
+				"Please notify https://github.com/Cxbx-Reloaded/Cxbx-Reloaded which title raised this!", addr, size);
 		}
 
 		// Access NV2A regardless weither HLE is disabled or not 
-		value = EmuNV2A_Read32(addr - NV2A_ADDR);
+		int shift = (addr & 3) * 8;
+		if (shift + size > 32) {
+			// Unaligned access crossing a register boundary, split it over both registers
+			int low_size = 32 - shift;
+			value = EmuNV2A_Read(addr - NV2A_ADDR, low_size);
+			value |= EmuNV2A_Read(addr - NV2A_ADDR + (low_size / 8), size - low_size) << low_size;
+		} else {
+			value = EmuNV2A_Read(addr - NV2A_ADDR, size);
+		}
 		// Note : EmuNV2A_Read32 does it's own logging
 	} else {
 		if (g_bEmuException) {
-			EmuWarning("EmuX86_Read32Aligned(0x%08X) [Unknown address]", addr);
+			EmuWarning("EmuX86_Read(0x%08X, %d) [Unknown address]", addr, size);
 			value = 0;
 		} else {
 			// Outside EmuException, pass the memory-access through to normal memory :
-			value = EmuX86_Mem_Read32(addr);
+			value = EmuX86_Mem_Read(addr, size);
 		}
-		DbgPrintf("EmuX86_Read32Aligned(0x%08X) = 0x%08X\n", addr, value);
-	}
-
-	return value;
-}
-
-uint32_t EmuX86_Read32(xbaddr addr)
-{
-	uint32_t value;
-
-	if ((addr & 3) == 0)
-		value = EmuX86_Read32Aligned(addr);
-	else {
-		EmuWarning("EmuX86_Read32(0x%08X) [Unaligned unimplemented]", addr);
-		value = 0;
+		DbgPrintf("EmuX86_Read(0x%08X, %d) = 0x%08X\n", addr, size, value);
 	}
 
 	return value;
 }
 
-uint16_t EmuX86_Read16(xbaddr addr)
-{
-	DbgPrintf("EmuX86_Read16(0x%08X) Forwarding to EmuX86_Read32Aligned...\n", addr);
-
-	int shift = (addr & 3) * 8;
-	xbaddr aligned_addr = addr & ~3;
-	uint16_t value = (uint16_t)(EmuX86_Read32Aligned(aligned_addr) >> shift);
-
-	// Must the second byte be retrieved from the next DWORD?
-	if ((addr & 3) == 3)
-		value |= (uint16_t)((EmuX86_Read32Aligned(aligned_addr + 4) & 0xff) << 8);
-
-	DbgPrintf("EmuX86_Read16(0x%08X) = 0x%04X\n", addr, value);
-	return value;
-}
-
-uint8_t EmuX86_Read8(xbaddr addr)
-{
-	DbgPrintf("EmuX86_Read8(0x%08X) Forwarding to EmuX86_Read32Aligned...\n", addr);
-
-	int shift = (addr & 3) * 8;
-	xbaddr aligned_addr = addr & ~3;
-	uint8_t value = (uint8_t)(EmuX86_Read32Aligned(aligned_addr) >> shift);
-
-	DbgPrintf("EmuX86_Read8(0x%08X) = 0x%02X\n", addr, value);
-	return value;
-}
-
-void EmuX86_Write32Aligned(xbaddr addr, uint32_t value)
+void EmuX86_Write(xbaddr addr, uint32_t value, int size)
 {
-	assert((addr & 3) == 0);
-
-	if (addr >= NV2A_ADDR && addr < NV2A_ADDR + NV2A_SIZE) {
+	if (EmuX86_IsNV2AAddr(addr)) {
 		if (!bLLE_GPU) {
-			EmuWarning("EmuX86_Write32Aligned(0x%08X, 0x%08X) Unexpected NV2A access, missing a HLE patch. " \
-				"Please notify https://github.com/Cxbx-Reloaded/Cxbx-Reloaded which title raised this!", addr);
+			EmuWarning("EmuX86_Write(0x%08X, 0x%08X, %d) Unexpected NV2A access, missing a HLE patch. " \
+				"Please notify https://github.com/Cxbx-Reloaded/Cxbx-Reloaded which title raised this!", addr, value, size);
 		}
 
 		// Access NV2A regardless weither HLE is disabled or not 
-		EmuNV2A_Write32(addr - NV2A_ADDR, value);
+		int shift = (addr & 3) * 8;
+		if (shift + size > 32) {
+			// Unaligned access crossing a register boundary, split it over both registers
+			int low_size = 32 - shift;
+			EmuNV2A_Write(addr - NV2A_ADDR, value, low_size);
+			EmuNV2A_Write(addr - NV2A_ADDR + (low_size / 8), value >> low_size, size - low_size);
+		} else {
+			EmuNV2A_Write(addr - NV2A_ADDR, value, size);
+		}
 		// Note : EmuNV2A_Write32 does it's own logging
 		return;
 	}
 
 	if (g_bEmuException) {
-		EmuWarning("EmuX86_Write32Aligned(0x%08X, 0x%08X) [Unknown address]", addr, value);
+		EmuWarning("EmuX86_Write(0x%08X, 0x%08X, %d) [Unknown address]", addr, value, size);
 		return;
 	}
 
 	// Outside EmuException, pass the memory-access through to normal memory :
-	DbgPrintf("EmuX86_Write32Aligned(0x%08X, 0x%08X)\n", addr, value);
-	EmuX86_Mem_Write32(addr, value);
-}
-
-void EmuX86_Write32(xbaddr addr, uint32_t value)
-{
-	if ((addr & 3) == 0) {
-		EmuX86_Write32Aligned(addr, value);
-	}
-	else
-		EmuWarning("EmuX86_Write32(0x%08X, 0x%08X) [Unaligned unimplemented]", addr, value);
-}
-
-void EmuX86_Write16(xbaddr addr, uint16_t value)
-{
-	DbgPrintf("EmuX86_Write16(0x%08X, 0x%04X) Forwarding to EmuX86_Read32Aligned+EmuX86_Write32Aligned\n", addr, value);
-
-	assert((addr & 1) == 0);
-
-	int shift = (addr & 2) * 16;
-	xbaddr aligned_addr = addr & ~3;
-	uint32_t aligned_value = EmuX86_Read32Aligned(aligned_addr);
-	uint32_t mask = 0xFFFF << shift;
-
-	// TODO : Must the second byte be written to the next DWORD?
-
-	EmuX86_Write32Aligned(aligned_addr, (aligned_value & ~mask) | (value << shift));
-}
-
-void EmuX86_Write8(xbaddr addr, uint8_t value)
-{
-	DbgPrintf("EmuX86_Write8(0x%08X, 0x%02X) Forwarding to EmuX86_Read32Aligned+EmuX86_Write32Aligned\n", addr, value);
-
-	int shift = (addr & 3) * 8;
-	xbaddr aligned_addr = addr & ~3;
-	uint32_t aligned_value = EmuX86_Read32Aligned(aligned_addr);
-	uint32_t mask = 0xFF << shift;
-
-	EmuX86_Write32Aligned(aligned_addr, (aligned_value & ~mask) | (value << shift));
+	DbgPrintf("EmuX86_Write(0x%08X, 0x%08X, %d)\n", addr, value, size);
+	EmuX86_Mem_Write(addr, value, size);
 }
 
 int ContextRecordOffsetByRegisterType[/*_RegisterType*/R_DR7 + 1] = { 0 };
@@ -440,27 +409,27 @@ xbaddr EmuX86_Operand_Addr(LPEXCEPTION_POINTERS e, _DInst& info, int operand, bo
 	case O_NONE:
 	{
 		// ignore operand
-		return (xbaddr)nullptr;
+		return (xbaddr)0;
 	}
 	case O_REG:
 		is_internal_addr = true;
-		return (xbaddr)EmuX86_GetRegisterPointer(e, info.ops[operand].index);
+		return (xbaddr)(uintptr_t)EmuX86_GetRegisterPointer(e, info.ops[operand].index);
 	{
 	}
 	case O_IMM:
 	{
 		is_internal_addr = true;
-		return (xbaddr)(&info.imm);
+		return (xbaddr)(uintptr_t)(&info.imm);
 	}
 	case O_IMM1:
 	{
 		is_internal_addr = true;
-		return (xbaddr)(&info.imm.ex.i1);
+		return (xbaddr)(uintptr_t)(&info.imm.ex.i1);
 	}
 	case O_IMM2:
 	{
 		is_internal_addr = true;
-		return (xbaddr)(&info.imm.ex.i2);
+		return (xbaddr)(uintptr_t)(&info.imm.ex.i2);
 	}
 	case O_DISP:
 	{
@@ -488,89 +457,55 @@ xbaddr EmuX86_Operand_Addr(LPEXCEPTION_POINTERS e, _DInst& info, int operand, bo
 		return (xbaddr)info.imm.ptr.off; // TODO : What about info.imm.ptr.seg ?
 	}
 	default:
-		return (xbaddr)nullptr;
+		return (xbaddr)0;
 	}
 
-	return (xbaddr)nullptr;
+	return (xbaddr)0;
 }
 
 bool EmuX86_Addr_Read(xbaddr srcAddr, bool is_internal_addr, uint16_t size, OUT uint32_t *value)
 {
-	if (is_internal_addr)
-	{
-		switch (size) {
-		case 8:
-			*value = *((uint8_t*)srcAddr);
-			return true;
-		case 16:
-			*value = *((uint16_t*)srcAddr);
-			return true;
-		case 32:
-			*value = *((uint32_t*)srcAddr);
-			return true;
-		default:
-			return false;
-		}
+	switch (size) {
+	case 8:
+	case 16:
+	case 32:
+		break;
+	default:
+		return false;
 	}
+
+	if (is_internal_addr)
+		*value = EmuX86_Mem_Read(srcAddr, size);
 	else
-	{
-		switch (size) {
-		case 8:
-			*value = EmuX86_Read8(srcAddr);
-			return true;
-		case 16:
-			*value = EmuX86_Read16(srcAddr);
-			return true;
-		case 32:
-			*value = EmuX86_Read32(srcAddr);
-			return true;
-		default:
-			return false;
-		}
-	}
+		*value = EmuX86_Read(srcAddr, size);
+
+	return true;
 }
 
 bool EmuX86_Addr_Write(xbaddr destAddr, bool is_internal_addr, uint16_t size, uint32_t value)
 {
-	if (is_internal_addr)
-	{
-		switch (size) {
-		case 8:
-			*((uint8_t*)destAddr) = (uint8_t)value;
-			return true;
-		case 16:
-			*((uint16_t*)destAddr) = (uint16_t)value;
-			return true;
-		case 32:
-			*((uint32_t*)destAddr) = value;
-			return true;
-		default:
-			return false;
-		}
+	switch (size) {
+	case 8:
+	case 16:
+	case 32:
+		break;
+	default:
+		return false;
 	}
+
+	if (is_internal_addr)
+		EmuX86_Mem_Write(destAddr, value, size);
 	else
-	{
-		switch (size) {
-		case 8:
-			EmuX86_Write8(destAddr, value & 0xFF);
-			return true;
-		case 16:
-			EmuX86_Write16(destAddr, value & 0xFFFF);
-			return true;
-		case 32:
-			EmuX86_Write32(destAddr, value);
-			return true;
-		default:
-			return false;
-		}
-	}
+		EmuX86_Write(destAddr, value, size);
+
+	return true;
 }
 
 bool EmuX86_Operand_Read(LPEXCEPTION_POINTERS e, _DInst& info, int operand, OUT uint32_t *value)
 {
 	bool is_internal_addr;
 	xbaddr srcAddr = EmuX86_Operand_Addr(e, info, operand, OUT is_internal_addr);
-	if (srcAddr != (xbaddr)nullptr)
+	if (srcAddr != (xbaddr)0)
 		return EmuX86_Addr_Read(srcAddr, is_internal_addr, info.ops[operand].size, value);
 
 	return false;
@@ -580,50 +515,140 @@ bool EmuX86_Operand_Write(LPEXCEPTION_POINTERS e, _DInst& info, int operand, uin
 {
 	bool is_internal_addr;
 	xbaddr destAddr = EmuX86_Operand_Addr(e, info, operand, OUT is_internal_addr);
-	if (destAddr != (xbaddr)nullptr)
+	if (destAddr != (xbaddr)0)
 		return EmuX86_Addr_Write(destAddr, is_internal_addr, info.ops[operand].size, value);
 
 	return false;
 }
 
+inline uint32_t EmuX86_SignExtend(uint32_t value, uint16_t size)
+{
+	switch (size) {
+	case 8:
+		return (uint32_t)(int32_t)(int8_t)value;
+	case 16:
+		return (uint32_t)(int32_t)(int16_t)value;
+	default:
+		return value;
+	}
+}
+
+// Reads both operands of a two-operand instruction. Immediates narrower than
+// the destination (like the imm8 of opcode 83) are sign-extended.
+bool EmuX86_Operands_Read(LPEXCEPTION_POINTERS e, _DInst& info, OUT uint32_t *dest, OUT uint32_t *src)
+{
+	if (!EmuX86_Operand_Read(e, info, 0, dest))
+		return false;
+
+	if (!EmuX86_Operand_Read(e, info, 1, src))
+		return false;
+
+	if (info.ops[1].type == O_IMM && info.ops[1].size < info.ops[0].size)
+		*src = EmuX86_SignExtend(*src, info.ops[1].size);
+
+	return true;
+}
+
+inline void EmuX86_SetFlag(LPEXCEPTION_POINTERS e, int flag, int value)
+{
+	e->ContextRecord->EFlags ^= (-value ^ e->ContextRecord->EFlags) & (1 << flag);
+}
+
+// Sets SF, ZF and PF, based on the lower size bits of result
+void EmuX86_SetResultFlags(LPEXCEPTION_POINTERS e, uint32_t result, uint16_t size)
+{
+	if (size < 32)
+		result &= (1 << size) - 1;
+
+	EmuX86_SetFlag(e, EMUX86_EFLAG_SF, (result >> (size - 1)) & 1);
+	EmuX86_SetFlag(e, EMUX86_EFLAG_ZF, result == 0 ? 1 : 0);
+	// Set Parity flag, based on "Compute parity in parallel" method from
+	// http://graphics.stanford.edu/~seander/bithacks.html#ParityParallel
+	// (which gives 1 for an odd number of bits, while PF is set for an even number)
+	uint32_t v = 255 & result;
+	v ^= v >> 4;
+	v &= 0xf;
+	EmuX86_SetFlag(e, EMUX86_EFLAG_PF, ((0x6996 >> v) & 1) ^ 1);
+}
+
+// AND, OR, TEST and XOR
+void EmuX86_SetLogicFlags(LPEXCEPTION_POINTERS e, uint32_t result, uint16_t size)
+{
+	// https://en.wikipedia.org/wiki/TEST_(x86_instruction)
+	// Set CF/OF to 0
+	EmuX86_SetFlag(e, EMUX86_EFLAG_CF, 0);
+	EmuX86_SetFlag(e, EMUX86_EFLAG_OF, 0);
+	EmuX86_SetResultFlags(e, result, size);
+}
+
+void EmuX86_SetAddFlags(LPEXCEPTION_POINTERS e, uint32_t dest, uint32_t src, uint32_t result, uint16_t size)
+{
+	uint32_t mask = (size < 32) ? (1 << size) - 1 : 0xFFFFFFFF;
+	uint32_t sign = 1 << (size - 1);
+
+	EmuX86_SetFlag(e, EMUX86_EFLAG_CF, (result & mask) < (dest & mask) ? 1 : 0);
+	EmuX86_SetFlag(e, EMUX86_EFLAG_OF, ((dest ^ result) & (src ^ result) & sign) ? 1 : 0);
+	EmuX86_SetFlag(e, EMUX86_EFLAG_AF, ((dest ^ src ^ result) & 0x10) ? 1 : 0);
+	EmuX86_SetResultFlags(e, result, size);
+}
+
+// SUB and CMP
+void EmuX86_SetSubFlags(LPEXCEPTION_POINTERS e, uint32_t dest, uint32_t src, uint32_t result, uint16_t size)
+{
+	uint32_t mask = (size < 32) ? (1 << size) - 1 : 0xFFFFFFFF;
+	uint32_t sign = 1 << (size - 1);
+
+	EmuX86_SetFlag(e, EMUX86_EFLAG_CF, (dest & mask) < (src & mask) ? 1 : 0);
+	EmuX86_SetFlag(e, EMUX86_EFLAG_OF, ((dest ^ src) & (dest ^ result) & sign) ? 1 : 0);
+	EmuX86_SetFlag(e, EMUX86_EFLAG_AF, ((dest ^ src ^ result) & 0x10) ? 1 : 0);
+	EmuX86_SetResultFlags(e, result, size);
+}
+
 bool EmuX86_Opcode_ADD(LPEXCEPTION_POINTERS e, _DInst& info)
 {
-	// ADD reads value from source :
-	uint32_t value;
-	if (!EmuX86_Operand_Read(e, info, 1, &value))
+	// ADD reads value from source and destination :
+	uint32_t dest, src;
+	if (!EmuX86_Operands_Read(e, info, &dest, &src))
 		return false;
 
-	// ADD reads and writes destination :
-	bool is_internal_addr;
-	xbaddr addr = EmuX86_Operand_Addr(e, info, 0, OUT is_internal_addr);
-	if (addr == (xbaddr)nullptr)
+	uint32_t result = dest + src;
+
+	// ADD writes the sum to destination :
+	if (!EmuX86_Operand_Write(e, info, 0, result))
 		return false;
 
-	if (is_internal_addr)
+	EmuX86_SetAddFlags(e, dest, src, result, info.ops[0].size);
+
+	return true;
+}
+
+bool EmuX86_Opcode_AND(LPEXCEPTION_POINTERS e, _DInst& info)
+{
+	// AND reads value from source and destination :
+	uint32_t dest, src;
+	if (!EmuX86_Operands_Read(e, info, &dest, &src))
 		return false;
 
-	// TODO : Do this better
-	switch (info.ops[0].size) {
-	case 8: {
-		uint8_t current = EmuX86_Read8(addr);
-		EmuX86_Write8(addr, (uint8_t)current + value);
-		return true;
-	}
-	case 16: {
-		uint16_t current = EmuX86_Read16(addr);
-		EmuX86_Write16(addr, (uint16_t)current + value);
-		return true;
-	}
-	case 32: {
-		uint32_t current = EmuX86_Read32(addr);
-		EmuX86_Write32(addr, (uint32_t)current + value);
-		return true;
-	}
-	default:
+	uint32_t result = dest & src;
+
+	// AND writes result to destination :
+	if (!EmuX86_Operand_Write(e, info, 0, result))
 		return false;
-	}
 
-	// TODO : update CPU flags
+	EmuX86_SetLogicFlags(e, result, info.ops[0].size);
+
+	return true;
+}
+
+bool EmuX86_Opcode_CMP(LPEXCEPTION_POINTERS e, _DInst& info)
+{
+	// CMP reads value from source and destination :
+	uint32_t dest, src;
+	if (!EmuX86_Operands_Read(e, info, &dest, &src))
+		return false;
+
+	// CMP subtracts like SUB, but the result is thrown away
+	EmuX86_SetSubFlags(e, dest, src, dest - src, info.ops[0].size);
 
 	return true;
 }
@@ -644,14 +669,31 @@ bool  EmuX86_Opcode_MOV(LPEXCEPTION_POINTERS e, _DInst& info)
 	return true;
 }
 
-bool  EmuX86_Opcode_MOVZX(LPEXCEPTION_POINTERS e, _DInst& info)
+bool  EmuX86_Opcode_MOVSX(LPEXCEPTION_POINTERS e, _DInst& info)
 {
-	// MOVZX reads value from source :
+	// MOVSX reads value from source :
 	uint32_t value = 0;
 	if (!EmuX86_Operand_Read(e, info, 1, &value))
 		return false;
 
-	// TODO : Implement MOVZX zero-extension!
+	// MOVSX extends the sign of the source to the size of the destination :
+	value = EmuX86_SignExtend(value, info.ops[1].size);
+
+	// MOVSX writes value to destination :
+	if (!EmuX86_Operand_Write(e, info, 0, value))
+		return false;
+
+	// Note : MOV instructions never update CPU flags
+
+	return true;
+}
+
+bool  EmuX86_Opcode_MOVZX(LPEXCEPTION_POINTERS e, _DInst& info)
+{
+	// MOVZX reads value from source (narrower reads are zero-extended already) :
+	uint32_t value = 0;
+	if (!EmuX86_Operand_Read(e, info, 1, &value))
+		return false;
 
 	// MOVZX writes value to destination :
 	if (!EmuX86_Operand_Write(e, info, 0, value))
@@ -662,45 +704,193 @@ bool  EmuX86_Opcode_MOVZX(LPEXCEPTION_POINTERS e, _DInst& info)
 	return true;
 }
 
-inline void EmuX86_SetFlag(LPEXCEPTION_POINTERS e, int flag, int value)
+bool EmuX86_Opcode_OR(LPEXCEPTION_POINTERS e, _DInst& info)
 {
-	e->ContextRecord->EFlags ^= (-value ^ e->ContextRecord->EFlags) & (1 << flag);
+	// OR reads value from source and destination :
+	uint32_t dest, src;
+	if (!EmuX86_Operands_Read(e, info, &dest, &src))
+		return false;
+
+	uint32_t result = dest | src;
+
+	// OR writes result to destination :
+	if (!EmuX86_Operand_Write(e, info, 0, result))
+		return false;
+
+	EmuX86_SetLogicFlags(e, result, info.ops[0].size);
+
+	return true;
 }
 
-bool  EmuX86_Opcode_TEST(LPEXCEPTION_POINTERS e, _DInst& info)
+bool EmuX86_Opcode_SUB(LPEXCEPTION_POINTERS e, _DInst& info)
 {
-	// TEST reads first value :
-	uint32_t result = 0;
-	if (!EmuX86_Operand_Read(e, info, 0, &result))
+	// SUB reads value from source and destination :
+	uint32_t dest, src;
+	if (!EmuX86_Operands_Read(e, info, &dest, &src))
 		return false;
 
-	// TEST reads second value :
-	uint32_t value = 0;
-	if (!EmuX86_Operand_Read(e, info, 1, &value))
+	uint32_t result = dest - src;
+
+	// SUB writes the difference to destination :
+	if (!EmuX86_Operand_Write(e, info, 0, result))
 		return false;
 
-	// TEST performs bitwise AND between first and second value :
-	result &= value;
+	EmuX86_SetSubFlags(e, dest, src, result, info.ops[0].size);
 
-	// https://en.wikipedia.org/wiki/TEST_(x86_instruction)
-	// Set CF/OF to 0
-	EmuX86_SetFlag(e, EMUX86_EFLAG_CF, 0);
-	EmuX86_SetFlag(e, EMUX86_EFLAG_OF, 0);
-	EmuX86_SetFlag(e, EMUX86_EFLAG_SF, result >> 31);
-	EmuX86_SetFlag(e, EMUX86_EFLAG_ZF, result == 0 ? 1 : 0);
-	// Set Parity flag, based on "Compute parity in parallel" method from
-	// http://graphics.stanford.edu/~seander/bithacks.html#ParityParallel
-	uint32_t v = 255 & result;
-	v ^= v >> 4;
-	v &= 0xf;
-	EmuX86_SetFlag(e, EMUX86_EFLAG_PF, (0x6996 >> v) & 1);
+	return true;
+}
+
+bool  EmuX86_Opcode_TEST(LPEXCEPTION_POINTERS e, _DInst& info)
+{
+	// TEST reads first and second value :
+	uint32_t dest, src;
+	if (!EmuX86_Operands_Read(e, info, &dest, &src))
+		return false;
 
+	// TEST performs bitwise AND between first and second value,
 	// result is thrown away
+	EmuX86_SetLogicFlags(e, dest & src, info.ops[0].size);
+
+	return true;
+}
+
+bool EmuX86_Opcode_XOR(LPEXCEPTION_POINTERS e, _DInst& info)
+{
+	// XOR reads value from source and destination :
+	uint32_t dest, src;
+	if (!EmuX86_Operands_Read(e, info, &dest, &src))
+		return false;
+
+	uint32_t result = dest ^ src;
+
+	// XOR writes result to destination :
+	if (!EmuX86_Operand_Write(e, info, 0, result))
+		return false;
+
+	EmuX86_SetLogicFlags(e, result, info.ops[0].size);
+
+	return true;
+}
+
+//
+// String instructions
+//
+// One side of a string instruction is the device that faulted, the other side is
+// normal memory. Because these run inside our EmuException exception handler,
+// the whole range in normal memory is checked for access before starting.
+//
+
+bool EmuX86_IsMemoryAccessible(xbaddr addr, uint32_t size)
+{
+	xbaddr end = addr + size;
+	if (end < addr)
+		return false;
+
+	while (addr < end) {
+		MEMORY_BASIC_INFORMATION mbi;
+		if (VirtualQuery((LPCVOID)(uintptr_t)addr, &mbi, sizeof(mbi)) == 0)
+			return false;
+
+		if (mbi.State != MEM_COMMIT || (mbi.Protect & (PAGE_NOACCESS | PAGE_GUARD)) != 0)
+			return false;
+
+		addr = (xbaddr)(uintptr_t)mbi.BaseAddress + (xbaddr)mbi.RegionSize;
+	}
+
+	return true;
+}
+
+// Checks the addresses a string instruction steps through, count elements of size bits
+bool EmuX86_String_CheckRange(xbaddr addr, uint32_t count, int size, bool down)
+{
+	uint64_t length = (uint64_t)count * (size / 8);
+	uint64_t start = down ? (uint64_t)addr + (size / 8) - length : addr;
+
+	if (length == 0)
+		return true;
+
+	if (start > addr || start + length > 0x100000000ULL)
+		return false;
+
+	if (EmuX86_IsNV2AAddr((xbaddr)start))
+		return EmuX86_IsNV2AAddr((xbaddr)(start + length - 1));
+
+	return EmuX86_IsMemoryAccessible((xbaddr)start, (uint32_t)length);
+}
+
+inline uint32_t EmuX86_String_Read(xbaddr addr, int size)
+{
+	if (EmuX86_IsNV2AAddr(addr))
+		return EmuX86_Read(addr, size);
+
+	return EmuX86_Mem_Read(addr, size);
+}
+
+inline void EmuX86_String_Write(xbaddr addr, uint32_t value, int size)
+{
+	if (EmuX86_IsNV2AAddr(addr))
+		EmuX86_Write(addr, value, size);
+	else
+		EmuX86_Mem_Write(addr, value, size);
+}
+
+bool EmuX86_Opcode_MOVS(LPEXCEPTION_POINTERS e, _DInst& info)
+{
+	int size = info.ops[0].size;
+	if (size != 8 && size != 16 && size != 32)
+		return false;
+
+	// MOVS copies from [ESI] to [EDI], ECX times when prefixed with REP :
+	bool rep = (FLAG_GET_PREFIX(info.flags) & FLAG_REP) != 0;
+	uint32_t count = rep ? e->ContextRecord->Ecx : 1;
+	bool down = (e->ContextRecord->EFlags & (1 << EMUX86_EFLAG_DF)) != 0;
+	int step = down ? -(size / 8) : (size / 8);
+
+	if (!EmuX86_String_CheckRange(e->ContextRecord->Esi, count, size, down) ||
+		!EmuX86_String_CheckRange(e->ContextRecord->Edi, count, size, down))
+		return false;
+
+	for (; count > 0; count--) {
+		uint32_t value = EmuX86_String_Read(e->ContextRecord->Esi, size);
+		EmuX86_String_Write(e->ContextRecord->Edi, value, size);
+		e->ContextRecord->Esi += step;
+		e->ContextRecord->Edi += step;
+	}
+
+	if (rep)
+		e->ContextRecord->Ecx = 0;
+
+	return true;
+}
+
+bool EmuX86_Opcode_STOS(LPEXCEPTION_POINTERS e, _DInst& info)
+{
+	int size = info.ops[0].size;
+	if (size != 8 && size != 16 && size != 32)
+		return false;
+
+	// STOS stores AL, AX or EAX to [EDI], ECX times when prefixed with REP :
+	bool rep = (FLAG_GET_PREFIX(info.flags) & FLAG_REP) != 0;
+	uint32_t count = rep ? e->ContextRecord->Ecx : 1;
+	bool down = (e->ContextRecord->EFlags & (1 << EMUX86_EFLAG_DF)) != 0;
+	int step = down ? -(size / 8) : (size / 8);
+
+	if (!EmuX86_String_CheckRange(e->ContextRecord->Edi, count, size, down))
+		return false;
+
+	uint32_t value = e->ContextRecord->Eax;
+	for (; count > 0; count--) {
+		EmuX86_String_Write(e->ContextRecord->Edi, value, size);
+		e->ContextRecord->Edi += step;
+	}
+
+	if (rep)
+		e->ContextRecord->Ecx = 0;
 
 	return true;
 }
 
-void  EmuX86_Opcode_CPUID(LPEXCEPTION_POINTERS e, _DInst& info)
+bool  EmuX86_Opcode_CPUID(LPEXCEPTION_POINTERS e, _DInst& info)
 {
 	// This CPUID emulation is based on :
 	// https://github.com/docbrown/vxb/wiki/Xbox-CPUID-Information
@@ -716,7 +906,7 @@ void  EmuX86_Opcode_CPUID(LPEXCEPTION_POINTERS e, _DInst& info)
 		e->ContextRecord->Ebx = (ULONG)'uneG';
 		e->ContextRecord->Edx = (ULONG)'Ieni';
 		e->ContextRecord->Ecx = (ULONG)'letn';
-		return;
+		return true;
 	}
 	case 1: // CPUID Function 1, Return the processor type / family / model / stepping and feature flags
 	{
@@ -726,7 +916,7 @@ void  EmuX86_Opcode_CPUID(LPEXCEPTION_POINTERS e, _DInst& info)
 		e->ContextRecord->Ecx = 0;
 		// Feature Flags 
 		e->ContextRecord->Edx = 0x383F9FF; // FPU, VME, DE, PSE, TSC, MSR, PAE, MCE, CX8, SEP, MTRR, PGE, MCA, CMOV, PAT, PSE36, MMX, FXSR, SSE
-		return;
+		return true;
 	}
 	case 2: // CPUID Function 2, Return the processor configuration descriptors
 	{
@@ -743,9 +933,38 @@ void  EmuX86_Opcode_CPUID(LPEXCEPTION_POINTERS e, _DInst& info)
 		// EDX nibble 2 = 04h : data TLB, 4M pages, 4 ways, 8 entries
 		// EDX nibble 3 = 0Ch : data L1 cache, 16 KB, 4 ways, 32 byte lines
 		e->ContextRecord->Edx = 0xC040841;
-		return;
+		return true;
+	}
 	}
+
+	// Other functions leave the registers unchanged
+	return true;
+}
+
+bool  EmuX86_Opcode_IN(LPEXCEPTION_POINTERS e, _DInst& info)
+{
+	// IN will address the second operand (DX or an immediate) :
+	uint32_t addr;
+	if (!EmuX86_Operand_Read(e, info, 1, &addr))
+		return false;
+
+	// IN does an I/O read on the address, returning the value in the first operand :
+	uint32_t value;
+	switch (info.ops[0].size) {
+	case 8:
+		value = EmuX86_IORead8(addr);
+		break;
+	case 16:
+		value = EmuX86_IORead16(addr);
+		break;
+	case 32:
+		value = EmuX86_IORead32(addr);
+		break;
+	default:
+		return false;
 	}
+
+	return EmuX86_Operand_Write(e, info, 0, value);
 }
 
 bool  EmuX86_Opcode_OUT(LPEXCEPTION_POINTERS e, _DInst& info)
@@ -779,23 +998,79 @@ bool  EmuX86_Opcode_OUT(LPEXCEPTION_POINTERS e, _DInst& info)
 	return false;
 }
 
-bool EmuX86_DecodeException(LPEXCEPTION_POINTERS e)
+bool  EmuX86_Opcode_Ignore(LPEXCEPTION_POINTERS e, _DInst& info)
 {
-	// Only decode instructions which reside in the loaded Xbe
-	if (e->ContextRecord->Eip > XBE_MAX_VA || e->ContextRecord->Eip < XBE_IMAGE_BASE) {
-		return false;
+	// Used for cache management instructions (INVD, WBINVD), we can safely ignore these
+	return true;
+}
+
+typedef bool (*EmuX86_OpcodeHandler)(LPEXCEPTION_POINTERS e, _DInst& info);
+
+EmuX86_OpcodeHandler EmuX86_ResolveOpcodeHandler(uint16_t opcode)
+{
+	switch (opcode) // Keep these cases alphabetically ordered
+	{
+	case I_ADD: return EmuX86_Opcode_ADD;
+	case I_AND: return EmuX86_Opcode_AND;
+	case I_CMP: return EmuX86_Opcode_CMP;
+	case I_CPUID: return EmuX86_Opcode_CPUID;
+	case I_IN: return EmuX86_Opcode_IN;
+	case I_INVD: return EmuX86_Opcode_Ignore; // Flush internal caches; initiate flushing of external caches.
+	case I_MOV: return EmuX86_Opcode_MOV;
+	case I_MOVS: return EmuX86_Opcode_MOVS;
+	case I_MOVSX: return EmuX86_Opcode_MOVSX;
+	case I_MOVZX: return EmuX86_Opcode_MOVZX;
+	case I_OR: return EmuX86_Opcode_OR;
+	case I_OUT: return EmuX86_Opcode_OUT;
+	case I_STOS: return EmuX86_Opcode_STOS;
+	case I_SUB: return EmuX86_Opcode_SUB;
+	case I_TEST: return EmuX86_Opcode_TEST;
+	case I_WBINVD: return EmuX86_Opcode_Ignore; // Write back and flush internal caches; initiate writing-back and flushing of external caches.
+	case I_XOR: return EmuX86_Opcode_XOR;
+	default: return nullptr;
 	}
+}
 
-	// Decoded instruction information.
+//
+// Decoded instruction cache
+//
+// Titles polling GPU or APU registers in tight loops fault on the same few
+// instructions over and over, so each decoded instruction is kept per EIP,
+// together with its handler. The instruction bytes are kept as well, so an
+// entry is only used while the code at EIP is unchanged.
+//
+
+#define EMUX86_DECODE_CACHE_SIZE 1024 // must be a power of two
+#define EMUX86_MAX_INSTRUCTION_SIZE 15
+
+typedef struct EmuX86_DecodedInstruction {
+	xbaddr eip; // 0 when unused
 	_DInst info;
+	EmuX86_OpcodeHandler handler;
+	uint8_t code[EMUX86_MAX_INSTRUCTION_SIZE];
+} EmuX86_DecodedInstruction;
+
+static EmuX86_DecodedInstruction g_DecodeCache[EMUX86_DECODE_CACHE_SIZE] = { 0 };
+static CRITICAL_SECTION g_DecodeCacheLock;
+static uint32_t g_DecodeCacheEntries = 0;
+
+// statistics
+static uint64_t g_DecodeCacheHits = 0;
+static uint64_t g_DecodeCacheMisses = 0;
+static uint64_t g_DecodeCacheInvalidations = 0;
+static uint64_t g_FaultCycles = 0;
+
+inline EmuX86_DecodedInstruction *EmuX86_DecodeCacheEntry(xbaddr eip)
+{
+	return &g_DecodeCache[(eip ^ (eip >> 10)) & (EMUX86_DECODE_CACHE_SIZE - 1)];
+}
+
+bool EmuX86_DecodeInstruction(xbaddr eip, OUT _DInst &info)
+{
 	unsigned int decodedInstructionsCount = 0;
 
 	_CodeInfo ci;
-	if (e->ContextRecord->Eip == 0x00023A8A)
-		//			00023A8A 03B2 28010000 add esi, [edx + $00000128]; CMiniport_SetDmaRange + 13E8
-		ci.code = (uint8_t*)e->ContextRecord->Eip;
-	else
-	ci.code = (uint8_t*)e->ContextRecord->Eip;
+	ci.code = (uint8_t*)(uintptr_t)eip;
 	ci.codeLen = 20;
 	ci.codeOffset = 0;
 	ci.dt = (_DecodeType)Decode32Bits;
@@ -806,68 +1081,123 @@ bool EmuX86_DecodeException(LPEXCEPTION_POINTERS e)
 	// halt cleanly after reaching maxInstructions 1. So instead, just call distorm :
 	distorm_decompose(&ci, &info, /*maxInstructions=*/1, &decodedInstructionsCount);
 	// and check if it successfully decoded one instruction :
-	if (decodedInstructionsCount != 1)
-	{
-		EmuWarning("EmuX86: Error decoding opcode at 0x%08X", e->ContextRecord->Eip);
+	return decodedInstructionsCount == 1 && info.size <= EMUX86_MAX_INSTRUCTION_SIZE;
+}
+
+// Returns the decoded instruction at eip and its handler (nullptr when unimplemented),
+// decoding and caching it on a miss. Returns false when the code can't be decoded.
+bool EmuX86_LookupInstruction(xbaddr eip, OUT _DInst &info, OUT EmuX86_OpcodeHandler &handler)
+{
+	EmuX86_DecodedInstruction *entry = EmuX86_DecodeCacheEntry(eip);
+
+	EnterCriticalSection(&g_DecodeCacheLock);
+
+	if (entry->eip == eip) {
+		if (memcmp(entry->code, (void*)(uintptr_t)eip, entry->info.size) == 0) {
+			info = entry->info;
+			handler = entry->handler;
+			g_DecodeCacheHits++;
+			LeaveCriticalSection(&g_DecodeCacheLock);
+			return true;
+		}
+
+		// The code was overwritten since it was decoded
+		entry->eip = 0;
+		g_DecodeCacheEntries--;
+		g_DecodeCacheInvalidations++;
 	}
-	else
-	{
-		switch (info.opcode) // Keep these cases alphabetically ordered
-		{
-		case I_ADD:
-			if (EmuX86_Opcode_ADD(e, info))
-				break;
-
-			goto unimplemented_opcode;
-		case I_CPUID:
-			EmuX86_Opcode_CPUID(e, info);
-			break;
-		case I_INVD: // Flush internal caches; initiate flushing of external caches.
-			 // We can safely ignore this
-			break;
-		case I_MOV:
-			if (EmuX86_Opcode_MOV(e, info))
-				break;
-
-			goto unimplemented_opcode;
-		case I_MOVZX:			
-			if (EmuX86_Opcode_MOVZX(e, info))
-				break;
-
-			goto unimplemented_opcode;
-		case I_OUT:
-			if (EmuX86_Opcode_OUT(e, info))
-				break;
-
-			goto unimplemented_opcode;
-		case I_TEST:
-			if (EmuX86_Opcode_TEST(e, info))
-				break;
-
-			goto unimplemented_opcode;
-		case I_WBINVD: // Write back and flush internal caches; initiate writing-back and flushing of external caches.
-			// We can safely ignore this
-			break;
-		default:
-			goto unimplemented_opcode;
+
+	g_DecodeCacheMisses++;
+	LeaveCriticalSection(&g_DecodeCacheLock);
+
+	if (!EmuX86_DecodeInstruction(eip, info))
+		return false;
+
+	handler = EmuX86_ResolveOpcodeHandler(info.opcode);
+
+	EnterCriticalSection(&g_DecodeCacheLock);
+
+	if (entry->eip == 0)
+		g_DecodeCacheEntries++;
+
+	entry->eip = eip;
+	entry->info = info;
+	entry->handler = handler;
+	memcpy(entry->code, (void*)(uintptr_t)eip, info.size);
+
+	LeaveCriticalSection(&g_DecodeCacheLock);
+
+	return true;
+}
+
+void EmuX86_InvalidateDecodeCache(xbaddr addr, size_t size)
+{
+	// Nothing is cached before the first fault (which includes all HLE patching)
+	if (g_DecodeCacheEntries == 0)
+		return;
+
+	EnterCriticalSection(&g_DecodeCacheLock);
+
+	for (int i = 0; i < EMUX86_DECODE_CACHE_SIZE; i++) {
+		EmuX86_DecodedInstruction *entry = &g_DecodeCache[i];
+		if (entry->eip == 0)
+			continue;
+
+		if (entry->eip < addr + size && entry->eip + entry->info.size > addr) {
+			entry->eip = 0;
+			g_DecodeCacheEntries--;
+			g_DecodeCacheInvalidations++;
 		}
+	}
 
-		// When falling through here, the instruction was handled correctly,
-		// skip over the instruction and continue execution :
-		e->ContextRecord->Eip += info.size;
-		return true;
+	LeaveCriticalSection(&g_DecodeCacheLock);
+}
+
+void EmuX86_DumpStatistics()
+{
+	uint64_t faults = g_DecodeCacheHits + g_DecodeCacheMisses;
+
+	printf("EmuX86 : %llu faults, %llu decode cache hits (%.1f%%), %llu misses, %llu invalidations\n",
+		(unsigned long long)faults, (unsigned long long)g_DecodeCacheHits, faults ? (100.0 * g_DecodeCacheHits) / faults : 0.0,
+		(unsigned long long)g_DecodeCacheMisses, (unsigned long long)g_DecodeCacheInvalidations);
+	printf("EmuX86 : %u instructions cached, %llu cycles per fault\n",
+		g_DecodeCacheEntries, (unsigned long long)(faults ? g_FaultCycles / faults : 0));
+}
+
+bool EmuX86_DecodeException(LPEXCEPTION_POINTERS e)
+{
+	// Only decode instructions which reside in the loaded Xbe
+	if (e->ContextRecord->Eip > XBE_MAX_VA || e->ContextRecord->Eip < XBE_IMAGE_BASE) {
+		return false;
+	}
 
-unimplemented_opcode:
+	uint64_t start = __rdtsc();
+
+	// Decoded instruction information.
+	_DInst info;
+	EmuX86_OpcodeHandler handler;
+	if (!EmuX86_LookupInstruction(e->ContextRecord->Eip, info, handler)) {
+		EmuWarning("EmuX86: Error decoding opcode at 0x%08X", e->ContextRecord->Eip);
+		return false;
+	}
+
+	bool handled = (handler != nullptr) && handler(e, info);
+	if (!handled) {
 		EmuWarning("EmuX86: 0x%08X: Not Implemented\n", e->ContextRecord->Eip);	// TODO : format decodedInstructions[0]
-		e->ContextRecord->Eip += info.size;
 	}
-	
-	return false;
+
+	// Skip over the instruction and continue execution :
+	e->ContextRecord->Eip += info.size;
+
+	InterlockedExchangeAdd64((LONGLONG*)&g_FaultCycles, __rdtsc() - start);
+
+	return handled;
 }
 
 void EmuX86_Init()
 {
 	DbgPrintf("EmuX86: Initializing distorm version %d\n", distorm_version());
 	EmuX86_InitContextRecordOffsetByRegisterType();
+	InitializeCriticalSection(&g_DecodeCacheLock);
 }
 
@@ -57,6 +57,8 @@
 
 void EmuX86_Init();
 bool EmuX86_DecodeException(LPEXCEPTION_POINTERS e);
+void EmuX86_InvalidateDecodeCache(xbaddr addr, size_t size);
+void EmuX86_DumpStatistics();
 uint32_t EmuX86_IORead32(xbaddr addr);
 uint16_t EmuX86_IORead16(xbaddr addr);
 uint8_t EmuX86_IORead8(xbaddr addr);
@@ -95,37 +95,38 @@ VOID WINAPI XTL::EMUPATCH(XGSwizzleRect)
 		LOG_FUNC_ARG(BytesPerPixel)
 		LOG_FUNC_END;
 
-    if(pRect == NULL && pPoint == NULL && Pitch == 0)
-    {
-        memcpy(pDest, pSource, Width*Height*BytesPerPixel);
-    }
-    else
-    {
-        if(pPoint != NULL && (pPoint->x != 0 || pPoint->y != 0))
-            CxbxKrnlCleanup("Temporarily unsupported swizzle (very easy fix)");
-
-        DWORD dwMaxY = Height;
-        DWORD dwChunkSize = Width;
-
-        uint08 *pSrc = (uint08*)pSource;
-        uint08 *pDst = (uint08*)pDest;
-
-        if(pRect != 0)
-        {
-            pSrc += pRect->top*Pitch;
-            pSrc += pRect->left;
-
-            dwMaxY = pRect->bottom - pRect->top;
-            dwChunkSize = pRect->right - pRect->left;
-        }
-
-        for(DWORD y=0;y<dwMaxY;y++)
-        {
-            memcpy(pSrc, pDst, dwChunkSize);
-            pSrc += Pitch;
-            pDst += Pitch;
-        }
-    }
+	if(pDest != (LPVOID) 0x80000000)
+	{
+		// Without a rect, the whole source is swizzled (into the whole destination)
+		DWORD dwLeft = 0, dwTop = 0;
+		DWORD dwCopyWidth = Width, dwCopyHeight = Height;
+
+		if(pRect != NULL)
+		{
+			dwLeft = pRect->left;
+			dwTop = pRect->top;
+			dwCopyWidth = pRect->right - pRect->left;
+			dwCopyHeight = pRect->bottom - pRect->top;
+		}
+
+		// A zero pitch means the source is tightly packed
+		if(Pitch == 0)
+			Pitch = dwCopyWidth * BytesPerPixel;
+
+		const uint08 *pSrc = (const uint08*)pSource + (dwTop * Pitch) + (dwLeft * BytesPerPixel);
+
+		// A rect is a box of depth 1
+		EmuSwizzleBox
+		(
+			pSrc, Pitch, Pitch * dwCopyHeight,
+			pDest, Width, Height, 1,
+			(pPoint != NULL) ? pPoint->x : 0,
+			(pPoint != NULL) ? pPoint->y : 0,
+			0,
+			dwCopyWidth, dwCopyHeight, 1,
+			BytesPerPixel
+		);
+	}
 }
 #endif
 
@@ -163,38 +164,39 @@ VOID WINAPI XTL::EMUPATCH(XGSwizzleBox)
 
 	if(pDest != (LPVOID) 0x80000000)
 	{
-		if(pBox == NULL && pPoint == NULL && RowPitch == 0 && SlicePitch == 0)
+		// Without a box, the whole source is swizzled (into the whole destination)
+		DWORD dwLeft = 0, dwTop = 0, dwFront = 0;
+		DWORD dwCopyWidth = Width, dwCopyHeight = Height, dwCopyDepth = Depth;
+
+		if(pBox != NULL)
 		{
-			memcpy(pDest, pSource, Width*Height*Depth*BytesPerPixel);
+			dwLeft = pBox->Left;
+			dwTop = pBox->Top;
+			dwFront = pBox->Front;
+			dwCopyWidth = pBox->Right - pBox->Left;
+			dwCopyHeight = pBox->Bottom - pBox->Top;
+			dwCopyDepth = pBox->Back - pBox->Front;
 		}
-		else
-		{
-			if(pPoint != NULL && (pPoint->u != 0 || pPoint->v != 0 || pPoint->w != 0))
-				CxbxKrnlCleanup("Temporarily unsupported swizzle (very easy fix)");
-
-			DWORD dwMaxY = Height;
-			DWORD dwMaxZ = Depth;
-			DWORD dwChunkSize = Width;
-
-			uint08 *pSrc = (uint08*)pSource;
-			uint08 *pDst = (uint08*)pDest;
-
-			if(pBox != 0)
-			{
-				pSrc += pBox->Top*RowPitch;
-				pSrc += pBox->Left;
-
-				dwMaxY = pBox->Bottom - pBox->Top;
-				dwChunkSize = pBox->Right - pBox->Left;
-			}
-
-			for(DWORD y=0;y<dwMaxY;y++)
-			{
-				memcpy(pSrc, pDst, dwChunkSize);
-				pSrc += RowPitch;
-				pDst += RowPitch;
-			}
-        }
+
+		// A zero pitch means the source is tightly packed
+		if(RowPitch == 0)
+			RowPitch = dwCopyWidth * BytesPerPixel;
+
+		if(SlicePitch == 0)
+			SlicePitch = RowPitch * dwCopyHeight;
+
+		const uint08 *pSrc = (const uint08*)pSource + (dwFront * SlicePitch) + (dwTop * RowPitch) + (dwLeft * BytesPerPixel);
+
+		EmuSwizzleBox
+		(
+			pSrc, RowPitch, SlicePitch,
+			pDest, Width, Height, Depth,
+			(pPoint != NULL) ? pPoint->u : 0,
+			(pPoint != NULL) ? pPoint->v : 0,
+			(pPoint != NULL) ? pPoint->w : 0,
+			dwCopyWidth, dwCopyHeight, dwCopyDepth,
+			BytesPerPixel
+		);
 	}
 }
 
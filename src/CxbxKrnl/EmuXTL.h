@@ -39,10 +39,14 @@ namespace XTL
     #include "EmuXapi.h"
     #include "EmuD3D8.h"
     #include "EmuD3D8\Convert.h"
+    #include "EmuD3D8\Swizzle.h"
     #include "EmuD3D8\VertexBuffer.h"
+    #include "EmuD3D8\VertexConvert.h"
     #include "EmuD3D8\PushBuffer.h"
     #include "EmuD3D8\VertexShader.h"
 	#include "EmuD3D8\PixelShader.h"
+    #include "EmuD3D8\ShaderCache.h"
+    #include "EmuD3D8\TextureCache.h"
     #include "EmuD3D8\State.h"
     #include "EmuDInput.h"
     #include "EmuDSound.h"
@@ -0,0 +1,531 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Win32->CxbxKrnl->EmuXiso.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#define _CXBXKRNL_INTERNAL
+#define _XBOXKRNL_DEFEXTRN_
+
+#include "EmuXiso.h"
+#include <vector>
+#include <string>
+#include <Shlobj.h>
+#include <Shlwapi.h>
+#pragma warning(disable:4005) // Ignore redefined status values
+#include <ntstatus.h>
+#pragma warning(default:4005)
+#include "CxbxKrnl.h"
+#include "Common/Win32/Mutex.h"
+
+// prevent name collisions
+namespace xboxkrnl
+{
+#include "Common/XDVDFS Tools/xdvdfs.h"
+};
+
+// buffered_io.h maps these onto the Xbox kernel types, keep them away from the Windows API's below
+#undef BOOL
+#undef LPSTR
+
+#ifndef FILE_OPENED
+#define FILE_OPENED 0x00000001
+#endif
+
+// A ByteOffset with this value reads from the current file position
+#ifndef FILE_USE_FILE_POINTER_POSITION
+#define FILE_USE_FILE_POINTER_POSITION 0xFFFFFFFE
+#endif
+
+// ******************************************************************
+// * A mounted image
+// ******************************************************************
+class EmuXisoImage : public Mutex
+{
+public:
+	std::string HostPath;
+	HANDLE HostFile;
+	LARGE_INTEGER HostFileSize;
+	xboxkrnl::XDVDFS_SESSION Session;
+};
+
+std::vector<EmuXisoImage*> XisoImages;
+
+static xboxkrnl::BOOLEAN CxbxXisoReadSectors(PVOID Data, PVOID Buffer, DWORD StartSector, DWORD ReadSize)
+{
+	EmuXisoImage *Image = (EmuXisoImage *)Data;
+	ULONGLONG Offset = (ULONGLONG)StartSector * SECTOR_SIZE;
+	DWORD Size = ReadSize * SECTOR_SIZE;
+	DWORD BytesRead = 0;
+	OVERLAPPED Overlapped = { 0 };
+
+	// Use an explicit offset, so no file pointer needs to be kept in sync
+	Overlapped.Offset = (DWORD)Offset;
+	Overlapped.OffsetHigh = (DWORD)(Offset >> 32);
+	if (!ReadFile(Image->HostFile, Buffer, Size, &BytesRead, &Overlapped) || (BytesRead == 0))
+		return FALSE;
+
+	// The last block of an image can be incomplete
+	if (BytesRead < Size)
+		memset((PBYTE)Buffer + BytesRead, 0, Size - BytesRead);
+
+	return TRUE;
+}
+
+static std::string CxbxXisoRelativePath(std::wstring RelativePath)
+{
+	std::string result;
+
+	// Names on an image are plain ASCII
+	for (size_t i = 0; i < RelativePath.length(); i++)
+		result += (char)RelativePath[i];
+
+	// A trailing separator would make XDVDFS_GetFileInfo return the first entry of the directory
+	while (!result.empty() && (result.back() == '\\'))
+		result.pop_back();
+
+	return result;
+}
+
+static DWORD CxbxXisoLookup(EmuXisoImage *Image, std::string RelativePath, xboxkrnl::SEARCH_RECORD *SearchRecord)
+{
+	Image->Lock();
+	DWORD result = xboxkrnl::XDVDFS_GetFileInfo(&Image->Session, &RelativePath[0], SearchRecord);
+	Image->Unlock();
+
+	return result;
+}
+
+static ULONG CxbxXisoFileAttributes(DWORD XdvdfsAttributes)
+{
+	// XDVDFS attributes use the same bits as FILE_ATTRIBUTE_*
+	if (XdvdfsAttributes == 0)
+		return FILE_ATTRIBUTE_NORMAL;
+
+	return XdvdfsAttributes;
+}
+
+static void CxbxXisoFileTime(EmuXisoImage *Image, xboxkrnl::LARGE_INTEGER *Time)
+{
+	// Images don't store times per file, so report the creation time of the image
+	Time->QuadPart = ((LONGLONG)Image->Session.Root.ImageCreationTime.dwHighDateTime << 32) | Image->Session.Root.ImageCreationTime.dwLowDateTime;
+}
+
+static ULONGLONG CxbxXisoAllocationSize(DWORD FileSize)
+{
+	return ((ULONGLONG)FileSize + SECTOR_SIZE - 1) & ~((ULONGLONG)SECTOR_SIZE - 1);
+}
+
+static NTSTATUS CxbxXisoComplete(NTSTATUS Status, ULONG_PTR Information, HANDLE Event, PVOID ApcRoutine, PVOID ApcContext, xboxkrnl::PIO_STATUS_BLOCK IoStatusBlock)
+{
+	IoStatusBlock->Status = Status;
+	IoStatusBlock->Information = Information;
+
+	// Requests on an image complete immediately, signal the caller like the I/O manager would
+	if (!FAILED(Status))
+	{
+		if (Event != NULL)
+			SetEvent(Event);
+
+		if (ApcRoutine != NULL)
+			NtDll::NtQueueApcThread(GetCurrentThread(), (NtDll::PIO_APC_ROUTINE)ApcRoutine, ApcContext, (NtDll::PIO_STATUS_BLOCK)IoStatusBlock, 0);
+	}
+
+	return Status;
+}
+
+bool CxbxIsXisoPath(std::string HostPath)
+{
+	const char *Extension = PathFindExtension(HostPath.c_str());
+
+	return (_stricmp(Extension, ".iso") == 0) || (_stricmp(Extension, ".xiso") == 0);
+}
+
+EmuXisoImage *CxbxMountXiso(std::string HostPath)
+{
+	for (size_t i = 0; i < XisoImages.size(); i++)
+		if (_stricmp(XisoImages[i]->HostPath.c_str(), HostPath.c_str()) == 0)
+			return XisoImages[i];
+
+	HANDLE HostFile = CreateFile(HostPath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+	if (HostFile == INVALID_HANDLE_VALUE)
+	{
+		EmuWarning("Could not open image \"%s\"", HostPath.c_str());
+		return nullptr;
+	}
+
+	EmuXisoImage *Image = new EmuXisoImage();
+	Image->HostPath = HostPath;
+	Image->HostFile = HostFile;
+	GetFileSizeEx(HostFile, &Image->HostFileSize);
+	memset(&Image->Session, 0, sizeof(Image->Session));
+	if (!xboxkrnl::XDVDFS_Mount(&Image->Session, CxbxXisoReadSectors, Image))
+	{
+		EmuWarning("\"%s\" is not an Xbox disc image", HostPath.c_str());
+		CloseHandle(HostFile);
+		delete Image;
+		return nullptr;
+	}
+
+	DbgPrintf("EmuMain : Mounted image \"%s\" (file system at sector 0x%.08X)\n", HostPath.c_str(), Image->Session.FileSystemBaseSector);
+	XisoImages.push_back(Image);
+	return Image;
+}
+
+bool CxbxExtractXisoFile(EmuXisoImage *Image, std::string XisoPath, std::string HostPath)
+{
+	xboxkrnl::FILE_RECORD FileRecord;
+	std::vector<BYTE> Buffer(BLOCK_SIZE * MAX_READ_AHEAD);
+	bool result = false;
+
+	Image->Lock();
+	if (xboxkrnl::XDVDFS_OpenFile(&Image->Session, &XisoPath[0], &FileRecord) == XDVDFS_NO_ERROR)
+	{
+		FILE *HostFile = fopen(HostPath.c_str(), "wb");
+		if (HostFile != NULL)
+		{
+			DWORD Size;
+
+			result = true;
+			while ((Size = xboxkrnl::XDVDFS_FileRead(&Image->Session, &FileRecord, Buffer.data(), Buffer.size())) > 0)
+				if (fwrite(Buffer.data(), 1, Size, HostFile) != Size)
+				{
+					result = false;
+					break;
+				}
+
+			// A short read means the image is damaged
+			if (FileRecord.CurrentPosition != FileRecord.FileSize)
+				result = false;
+
+			fclose(HostFile);
+		}
+
+		xboxkrnl::XDVDFS_FileClose(&Image->Session, &FileRecord);
+	}
+
+	Image->Unlock();
+	return result;
+}
+
+int CxbxRegisterDeviceXiso(std::string XboxDevicePath, std::string ImagePath)
+{
+	EmuXisoImage *Image = CxbxMountXiso(ImagePath);
+	if (Image == nullptr)
+		return -1;
+
+	int DeviceIndex = CxbxRegisterDeviceHostPath(XboxDevicePath, ImagePath, /*IsFile=*/false, Image);
+	if (DeviceIndex >= 0)
+		DbgPrintf("EmuMain : Registered \"%s\" as the contents of %s\n", ImagePath.c_str(), XboxDevicePath.c_str());
+
+	return DeviceIndex;
+}
+
+EmuXisoImage *CxbxXisoImageByRootHandle(HANDLE RootDirectory)
+{
+	if (RootDirectory == NULL)
+		return nullptr;
+
+	EmuNtSymbolicLinkObject* NtSymbolicLinkObject = FindNtSymbolicLinkObjectByRootHandle(RootDirectory);
+	if (NtSymbolicLinkObject == NULL)
+		return nullptr;
+
+	return NtSymbolicLinkObject->XisoImage;
+}
+
+EmuNtXisoFile *CxbxXisoFileByHandle(HANDLE Handle)
+{
+	if (!IsEmuHandle(Handle))
+		return nullptr;
+
+	EmuHandle *iEmuHandle = HandleToEmuHandle(Handle);
+	if (iEmuHandle == nullptr)
+		return nullptr;
+
+	return dynamic_cast<EmuNtXisoFile*>(iEmuHandle->NtObject);
+}
+
+NTSTATUS CxbxXisoCreateFile(EmuXisoImage *Image, std::wstring RelativePath, PHANDLE FileHandle, ULONG Disposition, ULONG CreateOptions, xboxkrnl::PIO_STATUS_BLOCK IoStatusBlock)
+{
+	xboxkrnl::SEARCH_RECORD SearchRecord;
+	NTSTATUS ret;
+
+	DWORD Found = CxbxXisoLookup(Image, CxbxXisoRelativePath(RelativePath), &SearchRecord);
+	bool IsDirectory = (Found == XDVDFS_NO_ERROR) && (SearchRecord.CurrentFileAttributes & XDVDFS_ATTRIBUTE_DIRECTORY);
+
+	if (Found != XDVDFS_NO_ERROR)
+		// Images are read-only, so missing files can't be created either
+		ret = ((Disposition == FILE_OPEN) || (Disposition == FILE_OVERWRITE)) ? STATUS_OBJECT_NAME_NOT_FOUND : STATUS_MEDIA_WRITE_PROTECTED;
+	else if (Disposition == FILE_CREATE)
+		ret = STATUS_OBJECT_NAME_COLLISION;
+	else if ((Disposition != FILE_OPEN) && (Disposition != FILE_OPEN_IF))
+		ret = STATUS_MEDIA_WRITE_PROTECTED;
+	else if ((CreateOptions & FILE_DIRECTORY_FILE) && !IsDirectory)
+		ret = STATUS_NOT_A_DIRECTORY;
+	else if ((CreateOptions & FILE_NON_DIRECTORY_FILE) && IsDirectory)
+		ret = STATUS_FILE_IS_A_DIRECTORY;
+	else
+	{
+		EmuNtXisoFile *XisoFile = new EmuNtXisoFile();
+
+		XisoFile->Image = Image;
+		XisoFile->FileName = (char *)SearchRecord.CurrentFilename;
+		XisoFile->FileAttributes = SearchRecord.CurrentFileAttributes;
+		XisoFile->FileStartSector = SearchRecord.CurrentFileStartSector;
+		XisoFile->FileSize = SearchRecord.CurrentFileSize;
+		*FileHandle = XisoFile->NewHandle();
+		// From now on, the handle keeps the file alive
+		XisoFile->NtClose();
+		ret = STATUS_SUCCESS;
+	}
+
+	IoStatusBlock->Status = ret;
+	IoStatusBlock->Information = (ret == STATUS_SUCCESS) ? FILE_OPENED : 0;
+	return ret;
+}
+
+NTSTATUS CxbxXisoQueryFullAttributes(EmuXisoImage *Image, std::wstring RelativePath, xboxkrnl::PFILE_NETWORK_OPEN_INFORMATION Attributes)
+{
+	xboxkrnl::SEARCH_RECORD SearchRecord;
+
+	if (CxbxXisoLookup(Image, CxbxXisoRelativePath(RelativePath), &SearchRecord) != XDVDFS_NO_ERROR)
+		return STATUS_OBJECT_NAME_NOT_FOUND;
+
+	CxbxXisoFileTime(Image, &Attributes->CreationTime);
+	CxbxXisoFileTime(Image, &Attributes->LastAccessTime);
+	CxbxXisoFileTime(Image, &Attributes->LastWriteTime);
+	CxbxXisoFileTime(Image, &Attributes->ChangeTime);
+	Attributes->AllocationSize.QuadPart = CxbxXisoAllocationSize(SearchRecord.CurrentFileSize);
+	Attributes->EndOfFile.QuadPart = SearchRecord.CurrentFileSize;
+	Attributes->FileAttributes = CxbxXisoFileAttributes(SearchRecord.CurrentFileAttributes);
+	return STATUS_SUCCESS;
+}
+
+EmuNtXisoFile::EmuNtXisoFile()
+{
+	Image = nullptr;
+	FileAttributes = 0;
+	FileStartSector = 0;
+	FileSize = 0;
+	CurrentPosition = 0;
+	EnumPosition = 0;
+	EnumStarted = false;
+}
+
+NTSTATUS EmuNtXisoFile::NtReadFile(HANDLE Event, xboxkrnl::PIO_APC_ROUTINE ApcRoutine, PVOID ApcContext, xboxkrnl::PIO_STATUS_BLOCK IoStatusBlock, PVOID Buffer, ULONG Length, xboxkrnl::PLARGE_INTEGER ByteOffset)
+{
+	ULONGLONG Offset = CurrentPosition;
+	xboxkrnl::FILE_RECORD FileRecord;
+
+	if (FileAttributes & XDVDFS_ATTRIBUTE_DIRECTORY)
+		return CxbxXisoComplete(STATUS_INVALID_DEVICE_REQUEST, 0, Event, ApcRoutine, ApcContext, IoStatusBlock);
+
+	if ((ByteOffset != NULL) && !((ByteOffset->u.LowPart == FILE_USE_FILE_POINTER_POSITION) && (ByteOffset->u.HighPart == -1)))
+		Offset = ByteOffset->QuadPart;
+
+	if (Offset >= FileSize)
+		return CxbxXisoComplete(STATUS_END_OF_FILE, 0, Event, ApcRoutine, ApcContext, IoStatusBlock);
+
+	Image->Lock();
+	FileRecord.Magic = Image->Session.Magic;
+	FileRecord.FileStartSector = FileStartSector;
+	FileRecord.FileSize = FileSize;
+	FileRecord.CurrentPosition = (DWORD)Offset;
+	DWORD Size = xboxkrnl::XDVDFS_FileRead(&Image->Session, &FileRecord, Buffer, Length);
+	Image->Unlock();
+
+	if ((Size == 0) && (Length > 0))
+	{
+		EmuWarning("Could not read from image \"%s\"", Image->HostPath.c_str());
+		return CxbxXisoComplete(STATUS_UNEXPECTED_IO_ERROR, 0, Event, ApcRoutine, ApcContext, IoStatusBlock);
+	}
+
+	CurrentPosition = (DWORD)Offset + Size;
+	return CxbxXisoComplete(STATUS_SUCCESS, Size, Event, ApcRoutine, ApcContext, IoStatusBlock);
+}
+
+NTSTATUS EmuNtXisoFile::NtQueryInformationFile(xboxkrnl::PIO_STATUS_BLOCK IoStatusBlock, PVOID FileInformation, ULONG Length, xboxkrnl::FILE_INFORMATION_CLASS FileInformationClass)
+{
+	ULONG InfoSize = (FileInformationClass < xboxkrnl::FileMaximumInformation) ? XboxFileInfoStructSizes[FileInformationClass] : 0;
+	bool IsDirectory = (FileAttributes & XDVDFS_ATTRIBUTE_DIRECTORY) != 0;
+
+	if ((InfoSize > 0) && (Length < InfoSize))
+		return CxbxXisoComplete(STATUS_INFO_LENGTH_MISMATCH, 0, NULL, NULL, NULL, IoStatusBlock);
+
+	switch (FileInformationClass)
+	{
+	case xboxkrnl::FileBasicInformation:
+	{
+		xboxkrnl::PFILE_BASIC_INFORMATION Info = (xboxkrnl::PFILE_BASIC_INFORMATION)FileInformation;
+		CxbxXisoFileTime(Image, &Info->CreationTime);
+		CxbxXisoFileTime(Image, &Info->LastAccessTime);
+		CxbxXisoFileTime(Image, &Info->LastWriteTime);
+		CxbxXisoFileTime(Image, &Info->ChangeTime);
+		Info->FileAttributes = CxbxXisoFileAttributes(FileAttributes);
+		break;
+	}
+	case xboxkrnl::FileStandardInformation:
+	{
+		xboxkrnl::PFILE_STANDARD_INFORMATION Info = (xboxkrnl::PFILE_STANDARD_INFORMATION)FileInformation;
+		Info->AllocationSize.QuadPart = CxbxXisoAllocationSize(FileSize);
+		Info->EndOfFile.QuadPart = FileSize;
+		Info->NumberOfLinks = 1;
+		Info->DeletePending = FALSE;
+		Info->Directory = IsDirectory;
+		break;
+	}
+	case xboxkrnl::FileInternalInformation:
+		((xboxkrnl::PFILE_INTERNAL_INFORMATION)FileInformation)->IndexNumber.QuadPart = FileStartSector;
+		break;
+	case xboxkrnl::FilePositionInformation:
+		((xboxkrnl::PFILE_POSITION_INFORMATION)FileInformation)->CurrentByteOffset.QuadPart = CurrentPosition;
+		break;
+	case xboxkrnl::FileNetworkOpenInformation:
+	{
+		xboxkrnl::PFILE_NETWORK_OPEN_INFORMATION Info = (xboxkrnl::PFILE_NETWORK_OPEN_INFORMATION)FileInformation;
+		CxbxXisoFileTime(Image, &Info->CreationTime);
+		CxbxXisoFileTime(Image, &Info->LastAccessTime);
+		CxbxXisoFileTime(Image, &Info->LastWriteTime);
+		CxbxXisoFileTime(Image, &Info->ChangeTime);
+		Info->AllocationSize.QuadPart = CxbxXisoAllocationSize(FileSize);
+		Info->EndOfFile.QuadPart = FileSize;
+		Info->FileAttributes = CxbxXisoFileAttributes(FileAttributes);
+		break;
+	}
+	default:
+		EmuWarning("NtQueryInformationFile : FileInformationClass %d isn't supported on images", FileInformationClass);
+		return CxbxXisoComplete(STATUS_INVALID_PARAMETER, 0, NULL, NULL, NULL, IoStatusBlock);
+	}
+
+	return CxbxXisoComplete(STATUS_SUCCESS, InfoSize, NULL, NULL, NULL, IoStatusBlock);
+}
+
+NTSTATUS EmuNtXisoFile::NtSetInformationFile(xboxkrnl::PIO_STATUS_BLOCK IoStatusBlock, PVOID FileInformation, ULONG Length, xboxkrnl::FILE_INFORMATION_CLASS FileInformationClass)
+{
+	// Moving the file pointer is the only change that doesn't write to the image
+	if (FileInformationClass != xboxkrnl::FilePositionInformation)
+		return CxbxXisoComplete(STATUS_MEDIA_WRITE_PROTECTED, 0, NULL, NULL, NULL, IoStatusBlock);
+
+	if (Length < sizeof(xboxkrnl::FILE_POSITION_INFORMATION))
+		return CxbxXisoComplete(STATUS_INFO_LENGTH_MISMATCH, 0, NULL, NULL, NULL, IoStatusBlock);
+
+	LONGLONG Position = ((xboxkrnl::PFILE_POSITION_INFORMATION)FileInformation)->CurrentByteOffset.QuadPart;
+	if ((Position < 0) || (Position > MAXDWORD))
+		return CxbxXisoComplete(STATUS_INVALID_PARAMETER, 0, NULL, NULL, NULL, IoStatusBlock);
+
+	// Like on NT, the position may be set beyond the end of the file
+	CurrentPosition = (DWORD)Position;
+	return CxbxXisoComplete(STATUS_SUCCESS, 0, NULL, NULL, NULL, IoStatusBlock);
+}
+
+NTSTATUS EmuNtXisoFile::NtQueryDirectoryFile(HANDLE Event, PVOID ApcRoutine, PVOID ApcContext, xboxkrnl::PIO_STATUS_BLOCK IoStatusBlock, xboxkrnl::FILE_DIRECTORY_INFORMATION *FileInformation, ULONG Length, xboxkrnl::PSTRING FileMask, BOOLEAN RestartScan)
+{
+	xboxkrnl::SEARCH_RECORD SearchRecord;
+	ULONG NameOffset = offsetof(xboxkrnl::FILE_DIRECTORY_INFORMATION, FileName);
+	DWORD Found;
+
+	if (!(FileAttributes & XDVDFS_ATTRIBUTE_DIRECTORY))
+		return CxbxXisoComplete(STATUS_INVALID_PARAMETER, 0, Event, ApcRoutine, ApcContext, IoStatusBlock);
+
+	if (Length < NameOffset)
+		return CxbxXisoComplete(STATUS_INFO_LENGTH_MISMATCH, 0, Event, ApcRoutine, ApcContext, IoStatusBlock);
+
+	// The mask given with the first query (or a restart) applies to the whole scan
+	if (!EnumStarted || RestartScan)
+	{
+		EnumMask = ((FileMask != NULL) && (FileMask->Length > 0)) ? PSTRING_to_string(FileMask) : "*";
+		EnumPosition = 0;
+	}
+
+	Image->Lock();
+	SearchRecord.Magic = Image->Session.Magic;
+	SearchRecord.SearchStartSector = FileStartSector;
+	SearchRecord.DirectorySize = FileSize;
+	SearchRecord.Position = EnumPosition;
+	while ((Found = xboxkrnl::XDVDFS_EnumFiles(&Image->Session, &SearchRecord)) == XDVDFS_NO_ERROR)
+	{
+		if (PathMatchSpec((char *)SearchRecord.CurrentFilename, EnumMask.c_str()))
+			break;
+	}
+	Image->Unlock();
+
+	if (Found != XDVDFS_NO_ERROR)
+	{
+		NTSTATUS ret = EnumStarted ? STATUS_NO_MORE_FILES : STATUS_NO_SUCH_FILE;
+
+		EnumStarted = true;
+		EnumPosition = SearchRecord.Position;
+		return CxbxXisoComplete(ret, 0, Event, ApcRoutine, ApcContext, IoStatusBlock);
+	}
+
+	ULONG NameLength = strlen((char *)SearchRecord.CurrentFilename);
+	ULONG CopyLength = (NameLength < Length - NameOffset) ? NameLength : Length - NameOffset;
+
+	FileInformation->NextEntryOffset = 0;
+	FileInformation->FileIndex = 0;
+	CxbxXisoFileTime(Image, &FileInformation->CreationTime);
+	CxbxXisoFileTime(Image, &FileInformation->LastAccessTime);
+	CxbxXisoFileTime(Image, &FileInformation->LastWriteTime);
+	CxbxXisoFileTime(Image, &FileInformation->ChangeTime);
+	FileInformation->EndOfFile.QuadPart = SearchRecord.CurrentFileSize;
+	FileInformation->AllocationSize.QuadPart = CxbxXisoAllocationSize(SearchRecord.CurrentFileSize);
+	FileInformation->FileAttributes = CxbxXisoFileAttributes(SearchRecord.CurrentFileAttributes);
+	FileInformation->FileNameLength = NameLength;
+	memcpy(FileInformation->FileName, SearchRecord.CurrentFilename, CopyLength);
+
+	// Only move on when the entry was returned completely
+	if (CopyLength < NameLength)
+		return CxbxXisoComplete(STATUS_BUFFER_OVERFLOW, NameOffset + CopyLength, Event, ApcRoutine, ApcContext, IoStatusBlock);
+
+	EnumStarted = true;
+	EnumPosition = SearchRecord.Position;
+	return CxbxXisoComplete(STATUS_SUCCESS, NameOffset + CopyLength, Event, ApcRoutine, ApcContext, IoStatusBlock);
+}
+
+NTSTATUS EmuNtXisoFile::NtQueryVolumeInformationFile(xboxkrnl::PIO_STATUS_BLOCK IoStatusBlock, xboxkrnl::PFILE_FS_SIZE_INFORMATION FileInformation, ULONG Length, xboxkrnl::FS_INFORMATION_CLASS FileInformationClass)
+{
+	if (FileInformationClass != xboxkrnl::FileFsSizeInformation)
+	{
+		EmuWarning("NtQueryVolumeInformationFile : FsInformationClass %d isn't supported on images", FileInformationClass);
+		return CxbxXisoComplete(STATUS_INVALID_PARAMETER, 0, NULL, NULL, NULL, IoStatusBlock);
+	}
+
+	if (Length < sizeof(xboxkrnl::FILE_FS_SIZE_INFORMATION))
+		return CxbxXisoComplete(STATUS_INFO_LENGTH_MISMATCH, 0, NULL, NULL, NULL, IoStatusBlock);
+
+	// A disc is completely in use
+	FileInformation->TotalAllocationUnits.QuadPart = Image->HostFileSize.QuadPart / SECTOR_SIZE;
+	FileInformation->AvailableAllocationUnits.QuadPart = 0;
+	FileInformation->SectorsPerAllocationUnit = 1;
+	FileInformation->BytesPerSector = SECTOR_SIZE;
+	return CxbxXisoComplete(STATUS_SUCCESS, sizeof(xboxkrnl::FILE_FS_SIZE_INFORMATION), NULL, NULL, NULL, IoStatusBlock);
+}
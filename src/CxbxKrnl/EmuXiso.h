@@ -0,0 +1,95 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Win32->CxbxKrnl->EmuXiso.h
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef EMUXISO_H
+#define EMUXISO_H
+
+// Xbox disc images (XISO, or full redump images) are mounted directly as the
+// contents of an Xbox device, instead of requiring them to be extracted first.
+// Files on an image are opened as EmuNtXisoFile objects, behind emu handles;
+// the kernel file API's forward calls on those to the methods below.
+
+#include "EmuFile.h"
+
+class EmuXisoImage;
+
+// ******************************************************************
+// * A file or directory opened on a mounted image
+// ******************************************************************
+class EmuNtXisoFile : public EmuNtObject {
+public:
+	EmuNtXisoFile();
+	EmuXisoImage *Image;
+	std::string FileName;
+	DWORD FileAttributes;
+	DWORD FileStartSector;
+	DWORD FileSize;
+	DWORD CurrentPosition;
+
+	NTSTATUS NtReadFile(HANDLE Event, xboxkrnl::PIO_APC_ROUTINE ApcRoutine, PVOID ApcContext, xboxkrnl::PIO_STATUS_BLOCK IoStatusBlock, PVOID Buffer, ULONG Length, xboxkrnl::PLARGE_INTEGER ByteOffset);
+	NTSTATUS NtQueryInformationFile(xboxkrnl::PIO_STATUS_BLOCK IoStatusBlock, PVOID FileInformation, ULONG Length, xboxkrnl::FILE_INFORMATION_CLASS FileInformationClass);
+	NTSTATUS NtSetInformationFile(xboxkrnl::PIO_STATUS_BLOCK IoStatusBlock, PVOID FileInformation, ULONG Length, xboxkrnl::FILE_INFORMATION_CLASS FileInformationClass);
+	NTSTATUS NtQueryDirectoryFile(HANDLE Event, PVOID ApcRoutine, PVOID ApcContext, xboxkrnl::PIO_STATUS_BLOCK IoStatusBlock, xboxkrnl::FILE_DIRECTORY_INFORMATION *FileInformation, ULONG Length, xboxkrnl::PSTRING FileMask, BOOLEAN RestartScan);
+	NTSTATUS NtQueryVolumeInformationFile(xboxkrnl::PIO_STATUS_BLOCK IoStatusBlock, xboxkrnl::PFILE_FS_SIZE_INFORMATION FileInformation, ULONG Length, xboxkrnl::FS_INFORMATION_CLASS FileInformationClass);
+private:
+	// Directory enumeration state
+	DWORD EnumPosition;
+	std::string EnumMask;
+	bool EnumStarted;
+};
+
+// Does the host path refer to a disc image (instead of an Xbe)?
+bool CxbxIsXisoPath(std::string HostPath);
+
+// Mounts the image at the host path (or returns the one already mounted), nullptr if it's invalid
+EmuXisoImage *CxbxMountXiso(std::string HostPath);
+
+// Copies a file from an image to the host, so the Xbe class can load it
+bool CxbxExtractXisoFile(EmuXisoImage *Image, std::string XisoPath, std::string HostPath);
+
+// Registers an image as the contents of an Xbox device (like CxbxRegisterDeviceHostPath does for host folders)
+int CxbxRegisterDeviceXiso(std::string XboxDevicePath, std::string ImagePath);
+
+// Returns the image a symbolic link root handle refers to, or nullptr for host based links
+EmuXisoImage *CxbxXisoImageByRootHandle(HANDLE RootDirectory);
+
+// Returns the image file behind an emu handle, or nullptr for any other handle
+EmuNtXisoFile *CxbxXisoFileByHandle(HANDLE Handle);
+
+// Opens a file or directory on an image (images are read-only, so nothing can be created)
+NTSTATUS CxbxXisoCreateFile(EmuXisoImage *Image, std::wstring RelativePath, PHANDLE FileHandle, ULONG Disposition, ULONG CreateOptions, xboxkrnl::PIO_STATUS_BLOCK IoStatusBlock);
+
+// Retrieves the attributes of a file or directory on an image
+NTSTATUS CxbxXisoQueryFullAttributes(EmuXisoImage *Image, std::wstring RelativePath, xboxkrnl::PFILE_NETWORK_OPEN_INFORMATION Attributes);
+
+#endif
@@ -0,0 +1,245 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Win32->CxbxKrnl->FilePathPrefixCache.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "FilePathPrefixCache.h"
+
+#include <cstdio>
+
+static inline char Upcase(char c)
+{
+    return ((c >= 'a') && (c <= 'z')) ? c - ('a' - 'A') : c;
+}
+
+FilePathPrefixCache::FilePathPrefixCache(FillCallback Fill)
+{
+    InitializeSRWLock(&m_Lock);
+
+    m_Fill = Fill;
+    m_bFilled = false;
+    Clear();
+
+    m_Hits = 0;
+    m_Misses = 0;
+    m_Fills = 0;
+    m_Invalidations = 0;
+}
+
+void FilePathPrefixCache::Clear()
+{
+    for(int d = 0; d < 26; d++)
+        m_Drives[d] = -1;
+
+    m_Nodes.resize(1);
+    m_Nodes[0].FirstChild = -1;
+    m_Nodes[0].NextSibling = -1;
+    m_Nodes[0].Prefix = -1;
+    m_Prefixes.clear();
+}
+
+int FilePathPrefixCache::NewPrefix(void *pLink, HANDLE RootDirectory, size_t Length)
+{
+    FILE_PATH_PREFIX Prefix;
+    Prefix.pLink = pLink;
+    Prefix.RootDirectory = RootDirectory;
+    Prefix.Length = Length;
+
+    m_Prefixes.push_back(Prefix);
+    return (int)m_Prefixes.size() - 1;
+}
+
+int FilePathPrefixCache::FindChild(int Parent, char Character) const
+{
+    Character = Upcase(Character);
+
+    // labels never start with the same character as one of their siblings'
+    for(int Child = m_Nodes[Parent].FirstChild; Child >= 0; Child = m_Nodes[Child].NextSibling)
+        if(m_Nodes[Child].Label[0] == Character)
+            return Child;
+
+    return -1;
+}
+
+void FilePathPrefixCache::AddDrive(char DriveLetter, void *pLink, HANDLE RootDirectory)
+{
+    DriveLetter = Upcase(DriveLetter);
+    if((DriveLetter < 'A') || (DriveLetter > 'Z') || (m_Drives[DriveLetter - 'A'] >= 0))
+        return;
+
+    m_Drives[DriveLetter - 'A'] = NewPrefix(pLink, RootDirectory, 2);
+}
+
+void FilePathPrefixCache::AddDevice(const std::string &DevicePath, void *pLink, HANDLE RootDirectory)
+{
+    std::string Key(DevicePath);
+    for(char &c : Key)
+        c = Upcase(c);
+
+    int Node = 0;
+    size_t Pos = 0;
+    while(Pos < Key.length())
+    {
+        int Child = FindChild(Node, Key[Pos]);
+        if(Child < 0)
+        {
+            // the rest of the key becomes a new leaf
+            Child = (int)m_Nodes.size();
+            m_Nodes.push_back({ Key.substr(Pos), -1, m_Nodes[Node].FirstChild, -1 });
+            m_Nodes[Node].FirstChild = Child;
+            Node = Child;
+            break;
+        }
+
+        size_t Common = 1;
+        const std::string &Label = m_Nodes[Child].Label;
+        while((Common < Label.length()) && (Pos + Common < Key.length()) && (Label[Common] == Key[Pos + Common]))
+            Common++;
+
+        if(Common < Label.length())
+        {
+            // the key ends or differs within the label, so split the node there : the child
+            // keeps its place among its siblings, and gets the rest of itself as its only child
+            int Rest = (int)m_Nodes.size();
+            m_Nodes.push_back({ m_Nodes[Child].Label.substr(Common), m_Nodes[Child].FirstChild, -1, m_Nodes[Child].Prefix });
+            m_Nodes[Child].Label.resize(Common);
+            m_Nodes[Child].FirstChild = Rest;
+            m_Nodes[Child].Prefix = -1;
+        }
+
+        Node = Child;
+        Pos += Common;
+    }
+
+    // a device that was added before takes precedence
+    if(m_Nodes[Node].Prefix < 0)
+        m_Nodes[Node].Prefix = NewPrefix(pLink, RootDirectory, Key.length());
+}
+
+bool FilePathPrefixCache::Resolve(const std::string &Path, FILE_PATH_PREFIX *pPrefix) const
+{
+    int Best = -1;
+
+    if((Path.length() >= 2) && (Path[1] == ':'))
+    {
+        // a drive letter only ever matches its own drive
+        char DriveLetter = Upcase(Path[0]);
+        if((DriveLetter >= 'A') && (DriveLetter <= 'Z'))
+            Best = m_Drives[DriveLetter - 'A'];
+    }
+    else
+    {
+        // otherwise, of all devices along the path, the one added first wins
+        int Node = 0;
+        size_t Pos = 0;
+        while(true)
+        {
+            int Prefix = m_Nodes[Node].Prefix;
+            if((Prefix >= 0) && ((Best < 0) || (Prefix < Best)))
+                Best = Prefix;
+
+            if(Pos >= Path.length())
+                break;
+
+            int Child = FindChild(Node, Path[Pos]);
+            if(Child < 0)
+                break;
+
+            const std::string &Label = m_Nodes[Child].Label;
+            if(Path.length() - Pos < Label.length())
+                break;
+
+            size_t i = 1;
+            while((i < Label.length()) && (Upcase(Path[Pos + i]) == Label[i]))
+                i++;
+
+            if(i < Label.length())
+                break;
+
+            Node = Child;
+            Pos += Label.length();
+        }
+    }
+
+    if(Best < 0)
+        return false;
+
+    *pPrefix = m_Prefixes[Best];
+    return true;
+}
+
+bool FilePathPrefixCache::Lookup(const std::string &Path, FILE_PATH_PREFIX *pPrefix)
+{
+    AcquireSRWLockShared(&m_Lock);
+
+    while(!m_bFilled)
+    {
+        // fill under the exclusive lock, then look up under the shared one again
+        ReleaseSRWLockShared(&m_Lock);
+        AcquireSRWLockExclusive(&m_Lock);
+        if(!m_bFilled)
+        {
+            m_Fill(*this);
+            m_bFilled = true;
+            InterlockedIncrement(&m_Fills);
+        }
+        ReleaseSRWLockExclusive(&m_Lock);
+        AcquireSRWLockShared(&m_Lock);
+    }
+
+    bool result = Resolve(Path, pPrefix);
+
+    ReleaseSRWLockShared(&m_Lock);
+
+    InterlockedIncrement(result ? &m_Hits : &m_Misses);
+    return result;
+}
+
+void FilePathPrefixCache::Invalidate()
+{
+    AcquireSRWLockExclusive(&m_Lock);
+    Clear();
+    m_bFilled = false;
+    ReleaseSRWLockExclusive(&m_Lock);
+
+    InterlockedIncrement(&m_Invalidations);
+}
+
+void FilePathPrefixCache::DumpStatistics()
+{
+    AcquireSRWLockShared(&m_Lock);
+    size_t Prefixes = m_Prefixes.size();
+    size_t Nodes = m_Nodes.size();
+    ReleaseSRWLockShared(&m_Lock);
+
+    printf("EmuFile : File path prefix cache holds %u prefixes (%u trie nodes), %d hits, %d misses, %d fills, %d invalidations\n",
+        (unsigned int)Prefixes, (unsigned int)Nodes, m_Hits, m_Misses, m_Fills, m_Invalidations);
+}
@@ -0,0 +1,106 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Win32->CxbxKrnl->FilePathPrefixCache.h
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef FILEPATHPREFIXCACHE_H
+#define FILEPATHPREFIXCACHE_H
+
+#include <windows.h>
+#include <string>
+#include <vector>
+
+// what the drive letter or device an Xbox path starts with resolves to
+typedef struct _FILE_PATH_PREFIX
+{
+    void   *pLink;          // the symbolic link the prefix is mapped by
+    HANDLE  RootDirectory;  // host directory the rest of the path is relative to
+    size_t  Length;         // how many leading characters of the path are the prefix
+}
+FILE_PATH_PREFIX;
+
+// resolves the prefixes of Xbox paths through the prefixes of all symbolic links
+//
+// Drive prefixes ("D:") are kept per drive letter, device prefixes
+// ("\Device\Harddisk0\Partition1") in a trie whose nodes hold runs of
+// characters, so lookups mostly compare strings. Both are matched case-insensitive. When several device
+// prefixes match a path, the one added first wins, so filling in drive letter
+// order resolves paths like the drive letter scan in FindNtSymbolicLinkObjectByDevice.
+//
+// The prefixes are filled by a callback the first time they're needed, and
+// thrown away by Invalidate, which must be called whenever a link is created
+// or deleted. Lookups share a lock, so they only wait for refills.
+class FilePathPrefixCache
+{
+    public:
+        typedef void (*FillCallback)(FilePathPrefixCache &Cache);
+
+        FilePathPrefixCache(FillCallback Fill);
+
+        // only to be called from the fill callback
+        void AddDrive(char DriveLetter, void *pLink, HANDLE RootDirectory);
+        void AddDevice(const std::string &DevicePath, void *pLink, HANDLE RootDirectory);
+
+        // Path must have its '\??\' removed; returns false when no prefix matches
+        bool Lookup(const std::string &Path, FILE_PATH_PREFIX *pPrefix);
+
+        void Invalidate();
+
+        void DumpStatistics();
+
+    private:
+        struct Node
+        {
+            std::string Label;          // upper-cased characters this node adds to its parent's
+            int         FirstChild;     // -1 if none
+            int         NextSibling;    // -1 if none
+            int         Prefix;         // index in m_Prefixes of the device ending here, -1 if none
+        };
+
+        int  NewPrefix(void *pLink, HANDLE RootDirectory, size_t Length);
+        int  FindChild(int Parent, char Character) const;
+        bool Resolve(const std::string &Path, FILE_PATH_PREFIX *pPrefix) const;
+        void Clear();
+
+        FillCallback                    m_Fill;
+        SRWLOCK                         m_Lock;
+        bool                            m_bFilled;
+        int                             m_Drives[26];   // index in m_Prefixes per drive letter, -1 if none
+        std::vector<Node>               m_Nodes;        // m_Nodes[0] is the root, with an empty label
+        std::vector<FILE_PATH_PREFIX>   m_Prefixes;     // in the order they were added
+
+        volatile LONG                   m_Hits;
+        volatile LONG                   m_Misses;
+        volatile LONG                   m_Fills;
+        volatile LONG                   m_Invalidations;
+};
+
+#endif
@@ -0,0 +1,184 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Win32->CxbxKrnl->HLECache.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "HLECache.h"
+
+#include <algorithm>
+#include <cstring>
+
+static inline const HLECacheSymbol *GetSymbolTable(const HLECacheHeader *pHeader)
+{
+	return (const HLECacheSymbol *)((const uint8_t *)pHeader + pHeader->SymbolTableOffset);
+}
+
+static inline const char *GetStringPool(const HLECacheHeader *pHeader)
+{
+	return (const char *)((const uint8_t *)pHeader + pHeader->StringPoolOffset);
+}
+
+void HLECacheWrite(const HLECacheInfo &Info, const HLECacheSymbols &Symbols, std::vector<uint8_t> &Image)
+{
+	// Sort on name, so that HLECacheFind can do a binary search
+	std::vector<const std::pair<std::string, uint32_t> *> Sorted;
+	Sorted.reserve(Symbols.size());
+	for (auto it = Symbols.begin(); it != Symbols.end(); ++it)
+		Sorted.push_back(&(*it));
+
+	std::sort(Sorted.begin(), Sorted.end(),
+		[](const std::pair<std::string, uint32_t> *a, const std::pair<std::string, uint32_t> *b) {
+			return strcmp(a->first.c_str(), b->first.c_str()) < 0;
+		});
+
+	// Build the string pool, starting with the title name
+	std::string StringPool = Info.TitleName;
+	StringPool.push_back('\0');
+
+	std::vector<HLECacheSymbol> SymbolTable(Sorted.size());
+	for (size_t i = 0; i < Sorted.size(); i++) {
+		SymbolTable[i].NameOffset = (uint32_t)StringPool.size();
+		SymbolTable[i].NameLength = (uint32_t)Sorted[i]->first.size();
+		SymbolTable[i].Address = Sorted[i]->second;
+		StringPool.append(Sorted[i]->first);
+		StringPool.push_back('\0');
+	}
+
+	HLECacheHeader Header;
+	Header.Magic = HLE_CACHE_MAGIC;
+	Header.FormatVersion = HLE_CACHE_FORMAT_VERSION;
+	Header.DatabaseHash = Info.DatabaseHash;
+	Header.LibraryHash = Info.LibraryHash;
+	Header.D3D8BuildVersion = Info.D3D8BuildVersion;
+	Header.TitleId = Info.TitleId;
+	Header.GameRegion = Info.GameRegion;
+	Header.TitleNameOffset = 0;
+	Header.SymbolCount = (uint32_t)SymbolTable.size();
+	Header.SymbolTableOffset = sizeof(HLECacheHeader);
+	Header.StringPoolOffset = Header.SymbolTableOffset + Header.SymbolCount * sizeof(HLECacheSymbol);
+	Header.StringPoolSize = (uint32_t)StringPool.size();
+	Header.FileSize = Header.StringPoolOffset + Header.StringPoolSize;
+
+	Image.resize(Header.FileSize);
+	memcpy(&Image[0], &Header, sizeof(Header));
+	if (Header.SymbolCount > 0)
+		memcpy(&Image[Header.SymbolTableOffset], &SymbolTable[0], Header.SymbolCount * sizeof(HLECacheSymbol));
+	memcpy(&Image[Header.StringPoolOffset], StringPool.data(), Header.StringPoolSize);
+}
+
+const HLECacheHeader *HLECacheValidate(const void *pImage, size_t Size)
+{
+	if (pImage == nullptr || Size < sizeof(HLECacheHeader))
+		return nullptr;
+
+	const HLECacheHeader *pHeader = (const HLECacheHeader *)pImage;
+	if (pHeader->Magic != HLE_CACHE_MAGIC || pHeader->FormatVersion != HLE_CACHE_FORMAT_VERSION)
+		return nullptr;
+
+	if (pHeader->FileSize != Size)
+		return nullptr;
+
+	// Check the symbol table and string pool lie within the image (using 64 bit math to prevent overflows)
+	uint64_t SymbolTableEnd = (uint64_t)pHeader->SymbolTableOffset + (uint64_t)pHeader->SymbolCount * sizeof(HLECacheSymbol);
+	uint64_t StringPoolEnd = (uint64_t)pHeader->StringPoolOffset + pHeader->StringPoolSize;
+	if (pHeader->SymbolTableOffset < sizeof(HLECacheHeader) || SymbolTableEnd > Size)
+		return nullptr;
+
+	if (pHeader->StringPoolOffset < SymbolTableEnd || StringPoolEnd > Size || pHeader->StringPoolSize == 0)
+		return nullptr;
+
+	// The string pool must be terminated, so that all strings in it are too
+	const char *StringPool = GetStringPool(pHeader);
+	if (StringPool[pHeader->StringPoolSize - 1] != '\0' || pHeader->TitleNameOffset >= pHeader->StringPoolSize)
+		return nullptr;
+
+	// Check all names lie within the string pool, and are sorted
+	const HLECacheSymbol *SymbolTable = GetSymbolTable(pHeader);
+	for (uint32_t i = 0; i < pHeader->SymbolCount; i++) {
+		const HLECacheSymbol &Symbol = SymbolTable[i];
+		if ((uint64_t)Symbol.NameOffset + Symbol.NameLength >= pHeader->StringPoolSize)
+			return nullptr;
+
+		if (StringPool[Symbol.NameOffset + Symbol.NameLength] != '\0')
+			return nullptr;
+
+		if (i > 0 && strcmp(StringPool + SymbolTable[i - 1].NameOffset, StringPool + Symbol.NameOffset) >= 0)
+			return nullptr;
+	}
+
+	return pHeader;
+}
+
+void HLECacheRead(const HLECacheHeader *pHeader, HLECacheInfo &Info, HLECacheSymbols &Symbols)
+{
+	const char *StringPool = GetStringPool(pHeader);
+
+	Info.DatabaseHash = pHeader->DatabaseHash;
+	Info.LibraryHash = pHeader->LibraryHash;
+	Info.D3D8BuildVersion = pHeader->D3D8BuildVersion;
+	Info.TitleId = pHeader->TitleId;
+	Info.GameRegion = pHeader->GameRegion;
+	Info.TitleName = StringPool + pHeader->TitleNameOffset;
+
+	const HLECacheSymbol *SymbolTable = GetSymbolTable(pHeader);
+	Symbols.clear();
+	Symbols.reserve(pHeader->SymbolCount);
+	for (uint32_t i = 0; i < pHeader->SymbolCount; i++) {
+		const HLECacheSymbol &Symbol = SymbolTable[i];
+		Symbols.push_back(std::make_pair(std::string(StringPool + Symbol.NameOffset, Symbol.NameLength), Symbol.Address));
+	}
+}
+
+bool HLECacheFind(const HLECacheHeader *pHeader, const char *szName, uint32_t &Address)
+{
+	const HLECacheSymbol *SymbolTable = GetSymbolTable(pHeader);
+	const char *StringPool = GetStringPool(pHeader);
+
+	uint32_t Low = 0;
+	uint32_t High = pHeader->SymbolCount;
+	while (Low < High) {
+		uint32_t Mid = Low + (High - Low) / 2;
+		int Compare = strcmp(StringPool + SymbolTable[Mid].NameOffset, szName);
+		if (Compare == 0) {
+			Address = SymbolTable[Mid].Address;
+			return true;
+		}
+
+		if (Compare < 0)
+			Low = Mid + 1;
+		else
+			High = Mid;
+	}
+
+	return false;
+}
@@ -0,0 +1,107 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Win32->CxbxKrnl->HLECache.h
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef HLECACHE_H
+#define HLECACHE_H
+
+// The HLE cache is stored in a binary format that's mapped into memory and
+// validated in one go. It contains a header, a symbol table (sorted on name,
+// so symbols can be looked up by binary search) and a pool with all strings.
+// This code doesn't depend on any Windows API, so the format can be read
+// and written on any platform.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Marks a binary HLE cache file ('CXHC' when viewed as bytes)
+#define HLE_CACHE_MAGIC 0x43485843
+
+// Increment this whenever the layout of the structures below changes
+#define HLE_CACHE_FORMAT_VERSION 1
+
+#pragma pack(push, 1)
+
+struct HLECacheHeader
+{
+	uint32_t Magic;             // HLE_CACHE_MAGIC
+	uint32_t FormatVersion;     // HLE_CACHE_FORMAT_VERSION
+	uint32_t FileSize;          // total size of the cache, including this header
+	uint32_t DatabaseHash;      // hash of the HLE database revision the symbols were detected with
+	uint32_t LibraryHash;       // hash of the library versions of the Xbe
+	uint32_t D3D8BuildVersion;  // D3D8 build version, as used while scanning
+	uint32_t TitleId;           // informational : certificate title ID
+	uint32_t GameRegion;        // informational : certificate game region
+	uint32_t TitleNameOffset;   // informational : offset of the title name in the string pool
+	uint32_t SymbolCount;       // number of HLECacheSymbol entries
+	uint32_t SymbolTableOffset; // file offset of the symbol table
+	uint32_t StringPoolOffset;  // file offset of the string pool
+	uint32_t StringPoolSize;    // size of the string pool, in bytes
+};
+
+struct HLECacheSymbol
+{
+	uint32_t NameOffset;        // offset of the (zero terminated) name in the string pool
+	uint32_t NameLength;        // length of the name, excluding the terminator
+	uint32_t Address;           // detected address, zero if the symbol wasn't found
+};
+
+#pragma pack(pop)
+
+struct HLECacheInfo
+{
+	uint32_t DatabaseHash;
+	uint32_t LibraryHash;
+	uint32_t D3D8BuildVersion;
+	uint32_t TitleId;
+	uint32_t GameRegion;
+	std::string TitleName;
+};
+
+typedef std::vector<std::pair<std::string, uint32_t>> HLECacheSymbols;
+
+// Serialize the given info and symbols into a cache image
+void HLECacheWrite(const HLECacheInfo &Info, const HLECacheSymbols &Symbols, std::vector<uint8_t> &Image);
+
+// Validate a cache image and return it's header, or nullptr if the image is damaged
+const HLECacheHeader *HLECacheValidate(const void *pImage, size_t Size);
+
+// Read the info and all symbols (in name order) from a validated cache image
+void HLECacheRead(const HLECacheHeader *pHeader, HLECacheInfo &Info, HLECacheSymbols &Symbols);
+
+// Look up a single symbol in a validated cache image
+bool HLECacheFind(const HLECacheHeader *pHeader, const char *szName, uint32_t &Address);
+
+#endif // HLECACHE_H
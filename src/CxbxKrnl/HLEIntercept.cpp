@@ -42,8 +42,10 @@
 #include "EmuFS.h"
 #include "EmuXTL.h"
 #include "EmuShared.h"
+#include "EmuX86.h"
 #include "HLEDataBase.h"
 #include "HLEIntercept.h"
+#include "HLECache.h"
 #include "xxhash32.h"
 #include <Shlwapi.h>
 
@@ -52,8 +54,10 @@ static void  EmuInstallPatches(OOVPATable *OovpaTable, uint32 OovpaTableSize, Xb
 static inline void EmuInstallPatch(xbaddr FunctionAddr, void *Patch);
 
 #include <shlobj.h>
+#include <array>
 #include <unordered_map>
 #include <sstream>
+#include <vector>
 
 std::unordered_map<std::string, xbaddr> g_SymbolAddresses;
 bool g_HLECacheUsed = false;
@@ -102,6 +106,46 @@ void *GetEmuPatchAddr(std::string aFunctionName)
 	return addr;
 }
 
+// Map an HLE cache file into memory, and fill g_SymbolAddresses from it when it's still valid
+static bool EmuLoadHLECache(const std::string &filename, uint32_t uiDatabaseHash, uint32_t uiLibraryHash)
+{
+	HANDLE hFile = CreateFile(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	bool bResult = false;
+	DWORD dwSize = GetFileSize(hFile, nullptr);
+	HANDLE hFileMapping = CreateFileMapping(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (hFileMapping != NULL) {
+		void *pImage = MapViewOfFile(hFileMapping, FILE_MAP_READ, 0, 0, 0);
+		if (pImage != nullptr) {
+			const HLECacheHeader *pHeader = HLECacheValidate(pImage, dwSize);
+			if (pHeader == nullptr) {
+				printf("HLE Cache file is damaged\n");
+			}
+			else if (pHeader->DatabaseHash == uiDatabaseHash && pHeader->LibraryHash == uiLibraryHash) {
+				HLECacheInfo Info;
+				HLECacheSymbols Symbols;
+				HLECacheRead(pHeader, Info, Symbols);
+
+				g_BuildVersion = Info.D3D8BuildVersion;
+				for (auto it = Symbols.begin(); it != Symbols.end(); ++it) {
+					g_SymbolAddresses[(*it).first] = (*it).second;
+				}
+
+				bResult = true;
+			}
+
+			UnmapViewOfFile(pImage);
+		}
+
+		CloseHandle(hFileMapping);
+	}
+
+	CloseHandle(hFile);
+	return bResult;
+}
+
 void EmuHLEIntercept(Xbe::Header *pXbeHeader)
 {
     Xbe::Certificate *pCertificate = (Xbe::Certificate*)pXbeHeader->dwCertificateAddr;
@@ -123,35 +167,18 @@ void EmuHLEIntercept(Xbe::Header *pXbeHeader)
 	// Hash the loaded XBE's header, use it as a filename
 	uint32_t uiHash = XXHash32::hash((void*)&CxbxKrnl_Xbe->m_Header, sizeof(Xbe::Header), 0);
 	std::stringstream sstream;
-	sstream << cachePath << std::hex << uiHash << ".ini";
+	sstream << cachePath << std::hex << uiHash << ".bin";
 	std::string filename = sstream.str();
 
-	if (PathFileExists(filename.c_str())) {
-		printf("Found HLE Cache File: %08X.ini\n", uiHash);
+	// The cache is invalidated whenever the HLE Database or any of the library versions changes
+	uint32_t uiDatabaseHash = XXHash32::hash(szHLELastCompileTime, strlen(szHLELastCompileTime), 0);
+	uint32_t uiLibraryHash = XXHash32::hash(pLibraryVersion, pXbeHeader->dwLibraryVersions * sizeof(Xbe::LibraryVersion), 0);
 
-		// Verify the version of the cache file against the HLE Database
-		char buffer[SHRT_MAX] = { 0 };
-		char* bufferPtr = buffer;
-
-		GetPrivateProfileString("Info", "HLEDatabaseVersion", NULL, buffer, sizeof(buffer), filename.c_str());
-		g_BuildVersion = GetPrivateProfileInt("Libs", "D3D8_BuildVersion", 0, filename.c_str());
+	if (PathFileExists(filename.c_str())) {
+		printf("Found HLE Cache File: %08X.bin\n", uiHash);
 
-		if (strcmp(buffer, szHLELastCompileTime) == 0) {
+		if (EmuLoadHLECache(filename, uiDatabaseHash, uiLibraryHash)) {
 			printf("Using HLE Cache\n");
-			GetPrivateProfileSection("Symbols", buffer, sizeof(buffer), filename.c_str());
-
-			// Parse the .INI file into the map of symbol addresses
-			while (strlen(bufferPtr) > 0) {
-				std::string ini_entry(bufferPtr);
-
-				auto separator = ini_entry.find('=');
-				std::string key = ini_entry.substr(0, separator);
-				std::string value = ini_entry.substr(separator + 1, std::string::npos);
-				uint32_t addr = strtol(value.c_str(), 0, 16);
-
-				g_SymbolAddresses[key] = addr;
-				bufferPtr += strlen(bufferPtr) + 1;
-			}
 
 			// Iterate through the map of symbol addresses, calling GetEmuPatchAddr on all functions.	
 			for (auto it = g_SymbolAddresses.begin(); it != g_SymbolAddresses.end(); ++it) {
@@ -582,41 +609,31 @@ void EmuHLEIntercept(Xbe::Header *pXbeHeader)
 
 	printf("\n");
 
-	// Write the HLE Database version string
-	WritePrivateProfileString("Info", "HLEDatabaseVersion", szHLELastCompileTime, filename.c_str());
+	// Write the found symbol addresses into the cache file
+	HLECacheInfo Info;
+	Info.DatabaseHash = uiDatabaseHash;
+	Info.LibraryHash = uiLibraryHash;
+	Info.D3D8BuildVersion = g_BuildVersion;
+	Info.TitleId = pCertificate->dwTitleId;
+	Info.GameRegion = pCertificate->dwGameRegion;
 
-	// Write the Certificate Details to the cache file
 	char tAsciiTitle[40] = "Unknown";
 	setlocale(LC_ALL, "English");
 	wcstombs(tAsciiTitle, pCertificate->wszTitleName, sizeof(tAsciiTitle));
-	WritePrivateProfileString("Certificate", "Name", tAsciiTitle, filename.c_str());
-
-	std::stringstream titleId;
-	titleId << std::hex << pCertificate->dwTitleId;
-	WritePrivateProfileString("Certificate", "TitleID", titleId.str().c_str(), filename.c_str());
-
-	std::stringstream region;
-	region << std::hex << pCertificate->dwGameRegion;
-	WritePrivateProfileString("Certificate", "Region", region.str().c_str(), filename.c_str());
+	tAsciiTitle[sizeof(tAsciiTitle) - 1] = '\0';
+	Info.TitleName = tAsciiTitle;
 
-	// Write Library Details
-	for (uint i = 0; i < pXbeHeader->dwLibraryVersions; i++)	{
-		std::string LibraryName(pLibraryVersion[i].szName, pLibraryVersion[i].szName + 8);
-		std::stringstream buildVersion;
-		buildVersion << pLibraryVersion[i].wBuildVersion;
+	HLECacheSymbols Symbols(g_SymbolAddresses.begin(), g_SymbolAddresses.end());
+	std::vector<uint8_t> Image;
+	HLECacheWrite(Info, Symbols, Image);
 
-		WritePrivateProfileString("Libs", LibraryName.c_str(), buildVersion.str().c_str(), filename.c_str());
+	FILE* fp = fopen(filename.c_str(), "wb");
+	if (fp == nullptr || fwrite(&Image[0], Image.size(), 1, fp) != 1) {
+		EmuWarning("Couldn't write HLE Cache File!");
 	}
 
-	std::stringstream buildVersion;
-	buildVersion << g_BuildVersion;
-	WritePrivateProfileString("Libs", "D3D8_BuildVersion", buildVersion.str().c_str(), filename.c_str());
-
-	// Write the found symbol addresses into the cache file
-	for(auto it = g_SymbolAddresses.begin(); it != g_SymbolAddresses.end(); ++it) {
-		std::stringstream cacheAddress;
-		cacheAddress << std::hex << (*it).second;
-		WritePrivateProfileString("Symbols", (*it).first.c_str(), cacheAddress.str().c_str(), filename.c_str());
+	if (fp != nullptr) {
+		fclose(fp);
 	}
 
     return;
@@ -628,6 +645,8 @@ static inline void EmuInstallPatch(xbaddr FunctionAddr, void *Patch)
 
 	*(uint08*)&FuncBytes[0] = OPCODE_JMP_E9; // = opcode for JMP rel32 (Jump near, relative, displacement relative to next instruction)
     *(uint32*)&FuncBytes[1] = (uint32)Patch - FunctionAddr - 5;
+
+    EmuX86_InvalidateDecodeCache(FunctionAddr, 5);
 }
 
 static inline void GetXRefEntry(OOVPA *oovpa, int index, OUT uint32 &xref, OUT uint08 &offset)
@@ -657,7 +676,7 @@ static boolean CompareOOVPAToAddress(OOVPA *Oovpa, xbaddr cur)
 		GetXRefEntry(Oovpa, v, XRef, Offset);
 		xbaddr XRefAddr = XRefDataBase[XRef];
 		// Undetermined XRef cannot be checked yet
-		// (EmuLocateFunction already checked this, but this check
+		// (PrepareOOVPAScanEntry already checked this, but this check
 		// is cheap enough to keep, and keep this function generic).
 		if (XRefAddr == XREF_ADDR_UNDETERMINED)
 			return false;
@@ -689,14 +708,56 @@ static boolean CompareOOVPAToAddress(OOVPA *Oovpa, xbaddr cur)
 	return true;
 }
 
-// locate the given function, searching within lower and upper bounds
-static xbaddr EmuLocateFunction(OOVPA *Oovpa, xbaddr lower, xbaddr upper)
+// ******************************************************************
+// * OOVPA scanning
+// ******************************************************************
+// Instead of comparing each OOVPA at every address (one full pass per
+// OOVPA), all OOVPA's of a table are indexed on an anchor {Offset, Value}
+// pair, using the value that's least common in the scanned section.
+// A single pass over the section then only visits those OOVPA's that
+// have their anchor value present at the current address, and checks
+// a second pair before doing the full comparison.
+struct OOVPAScanEntry
+{
+	OOVPA *Oovpa;
+	uint32 TableIndex;   // index into the OOVPATable this entry was created for
+	uint32 AnchorOffset; // offset of the least common (non-XRef) value
+	uint08 AnchorValue;
+	uint32 CheckOffset;  // offset of a second (non-XRef) value, checked before the full compare
+	uint08 CheckValue;
+	uint32 LastOffset;   // highest offset that's read when comparing
+	xbaddr Match;        // lowest address found, or nullptr
+};
+
+// Byte histograms per scanned range, kept over all passes (the image doesn't change while scanning)
+static std::unordered_map<uint64_t, std::array<uint32, 256>> g_OOVPAScanHistograms;
+
+static const std::array<uint32, 256> &GetScanHistogram(xbaddr lower, xbaddr upper)
+{
+	uint64_t key = ((uint64_t)lower << 32) | upper;
+	auto it = g_OOVPAScanHistograms.find(key);
+	if (it != g_OOVPAScanHistograms.end())
+		return it->second;
+
+	std::array<uint32, 256> &Histogram = g_OOVPAScanHistograms[key];
+	Histogram.fill(0);
+	for (xbaddr cur = lower; cur < upper; cur++)
+		Histogram[*(uint08*)cur]++;
+
+	return Histogram;
+}
+
+// check if the given OOVPA needs to be searched for, and if so, initialize it's scan entry
+static bool PrepareOOVPAScanEntry(OOVPA *Oovpa, OOVPAScanEntry &Entry)
 {
 	// skip out if this is an unnecessary search
 	if (!bXRefFirstPass && Oovpa->XRefCount == XRefZero && Oovpa->XRefSaveIndex == XRefNoSaveIndex)
-		return (xbaddr)nullptr;
+		return false;
+
+	Entry.Oovpa = Oovpa;
+	Entry.LastOffset = 0;
+	Entry.Match = (xbaddr)nullptr;
 
-	uint32_t derive_indices = 0;
 	// Check all XRefs are known (if not, don't do a useless scan) :
 	for (uint32 v = 0; v < Oovpa->XRefCount; v++)
 	{
@@ -705,126 +766,212 @@ static xbaddr EmuLocateFunction(OOVPA *Oovpa, xbaddr lower, xbaddr upper)
 
 		// get currently registered (un)known address
 		GetXRefEntry(Oovpa, v, XRef, Offset);
-		xbaddr XRefAddr = XRefDataBase[XRef];
 		// Undetermined XRef cannot be checked yet
-		if (XRefAddr == XREF_ADDR_UNDETERMINED)
-			// Skip this scan over the address range
-			return (xbaddr)nullptr;
+		if (XRefDataBase[XRef] == XREF_ADDR_UNDETERMINED)
+			return false;
 
-		// Don't verify an xref that has to be (but isn't yet) derived
-		if (XRefAddr == XREF_ADDR_DERIVE)
+		// XRefs read a 4 byte address
+		if (Entry.LastOffset < (uint32)Offset + 4 - 1)
+			Entry.LastOffset = (uint32)Offset + 4 - 1;
+	}
+
+	// An OOVPA without any (Offset, Value)-pair cannot be anchored
+	if (Oovpa->Count <= Oovpa->XRefCount)
+		return false;
+
+	uint32 Offset;
+	uint08 Value;
+
+	GetOovpaEntry(Oovpa, Oovpa->XRefCount, Offset, Value);
+	Entry.AnchorOffset = Entry.CheckOffset = Offset;
+	Entry.AnchorValue = Entry.CheckValue = Value;
+	for (uint32 v = Oovpa->XRefCount; v < Oovpa->Count; v++)
+	{
+		GetOovpaEntry(Oovpa, v, Offset, Value);
+		if (Entry.LastOffset < Offset)
+			Entry.LastOffset = Offset;
+	}
+
+	return true;
+}
+
+// choose the anchor (and check) pair of an entry, using the value histogram of the scanned range
+static void SelectOOVPAScanAnchor(OOVPAScanEntry &Entry, const std::array<uint32, 256> &Histogram)
+{
+	OOVPA *Oovpa = Entry.Oovpa;
+	uint32 AnchorCount = MAXUINT32;
+	uint32 CheckCount = MAXUINT32;
+
+	for (uint32 v = Oovpa->XRefCount; v < Oovpa->Count; v++)
+	{
+		uint32 Offset;
+		uint08 Value;
+
+		GetOovpaEntry(Oovpa, v, Offset, Value);
+		uint32 Count = Histogram[Value];
+		if (Count < AnchorCount)
 		{
-			// Mark (up to index 32) which xref needs to be derived
-			derive_indices |= (1 << v);
-			continue;
+			// the previous anchor becomes the check
+			Entry.CheckOffset = Entry.AnchorOffset;
+			Entry.CheckValue = Entry.AnchorValue;
+			CheckCount = AnchorCount;
+
+			Entry.AnchorOffset = Offset;
+			Entry.AnchorValue = Value;
+			AnchorCount = Count;
+		}
+		else if (Count < CheckCount)
+		{
+			Entry.CheckOffset = Offset;
+			Entry.CheckValue = Value;
+			CheckCount = Count;
 		}
 	}
+}
 
-	// correct upper bound with highest Oovpa offset
-	uint32 count = Oovpa->Count;
+// search all given entries (that aren't found yet) in a single pass over the given range
+static void EmuScanOOVPAs(std::vector<OOVPAScanEntry> &Entries, xbaddr lower, xbaddr upper)
+{
+	if (upper <= lower)
+		return;
+
+	const std::array<uint32, 256> &Histogram = GetScanHistogram(lower, upper);
+
+	// index all entries that still need to be found on their anchor value
+	std::vector<uint32> Buckets[256];
+	uint32 Remaining = 0;
+	for (uint32 e = 0; e < Entries.size(); e++)
 	{
-		uint32 Offset;
-		uint08 Value; // ignored
+		OOVPAScanEntry &Entry = Entries[e];
+		if (Entry.Match != (xbaddr)nullptr)
+			continue;
+
+		// skip entries that can't fit in this range
+		if (Entry.LastOffset >= upper - lower)
+			continue;
 
-		GetOovpaEntry(Oovpa, count - 1, Offset, Value);
-		upper -= Offset;
+		SelectOOVPAScanAnchor(Entry, Histogram);
+		Buckets[Entry.AnchorValue].push_back(e);
+		Remaining++;
 	}
 
-	// search all of the image memory
-	for (xbaddr cur = lower; cur < upper; cur++)
-		if (CompareOOVPAToAddress(Oovpa, cur))
+	for (xbaddr pos = lower; pos < upper && Remaining > 0; pos++)
+	{
+		std::vector<uint32> &Bucket = Buckets[*(uint08*)pos];
+		for (uint32 b = 0; b < Bucket.size(); )
 		{
-			// do we need to save the found address?
-			if (Oovpa->XRefSaveIndex != XRefNoSaveIndex)
+			OOVPAScanEntry &Entry = Entries[Bucket[b]];
+			xbaddr cur = pos - Entry.AnchorOffset;
+			if (pos - lower < Entry.AnchorOffset // cur below lower bound
+				|| cur + Entry.LastOffset >= upper
+				|| *(uint08*)(cur + Entry.CheckOffset) != Entry.CheckValue
+				|| !CompareOOVPAToAddress(Entry.Oovpa, cur))
 			{
-				// is the XRef not saved yet?
-				switch (XRefDataBase[Oovpa->XRefSaveIndex]) {
-				case XREF_ADDR_NOT_FOUND:
-				{
-					EmuWarning("Found OOVPA after first finding nothing?");
-					// fallthrough to XREF_ADDR_UNDETERMINED
-				}
-				case XREF_ADDR_UNDETERMINED:
-				{
-					// save and count the found address
-					UnResolvedXRefs--;
-					XRefDataBase[Oovpa->XRefSaveIndex] = cur;
-					break;
-				}
-				case XREF_ADDR_DERIVE:
-				{
-					EmuWarning("Cannot derive a save index!");
-					break;
-				}
-				default:
-				{
-					if (XRefDataBase[Oovpa->XRefSaveIndex] != cur)
-						EmuWarning("Found OOVPA on other address than in XRefDataBase!");
-					break;
-				}
-				}
+				b++;
+				continue;
 			}
 
-			while (derive_indices > 0)
-			{
-				uint32 XRef;
-				uint08 Offset;
-				DWORD derive_index;
-
-				// Extract an index from the indices mask :
-				_BitScanReverse(&derive_index, derive_indices); // MSVC intrinsic; GCC has __builtin_clz
-				derive_indices ^= (1 << derive_index);
-
-				// get currently registered (un)known address
-				GetXRefEntry(Oovpa, derive_index, XRef, Offset);
-
-				// Calculate the address where the XRef resides
-				xbaddr XRefAddr = cur + Offset;
-				// Read the address it points to
-				XRefAddr = *((xbaddr*)XRefAddr);
-
-				/* For now assume it's a direct reference;
-				// TODO : Check if it's PC-relative reference?
-				if (XRefAddr + cur + Offset + 4 < XBE_MAX_VA)
-					XRefAddr = XRefAddr + cur + Offset + 4;
-				*/
-
-				// Does the address seem valid?
-				if (XRefAddr < XBE_MAX_VA)
-				{
-					// save and count the derived address
-					UnResolvedXRefs--;
-					XRefDataBase[XRef] = XRefAddr;
-					printf("Derived OOVPA!\n");
-				}
-			}
+			// Since pos increments, this is the lowest matching address; remove it from the index
+			Entry.Match = cur;
+			Bucket[b] = Bucket.back();
+			Bucket.pop_back();
+			Remaining--;
+		}
+	}
+}
 
-			return cur;
+// register the XRefs of an OOVPA that was found on the given address
+static void EmuRegisterOOVPA(OOVPA *Oovpa, xbaddr cur)
+{
+	// do we need to save the found address?
+	if (Oovpa->XRefSaveIndex != XRefNoSaveIndex)
+	{
+		// is the XRef not saved yet?
+		switch (XRefDataBase[Oovpa->XRefSaveIndex]) {
+		case XREF_ADDR_NOT_FOUND:
+		{
+			EmuWarning("Found OOVPA after first finding nothing?");
+			// fallthrough to XREF_ADDR_UNDETERMINED
+		}
+		case XREF_ADDR_UNDETERMINED:
+		{
+			// save and count the found address
+			UnResolvedXRefs--;
+			XRefDataBase[Oovpa->XRefSaveIndex] = cur;
+			break;
+		}
+		case XREF_ADDR_DERIVE:
+		{
+			EmuWarning("Cannot derive a save index!");
+			break;
 		}
+		default:
+		{
+			if (XRefDataBase[Oovpa->XRefSaveIndex] != cur)
+				EmuWarning("Found OOVPA on other address than in XRefDataBase!");
+			break;
+		}
+		}
+	}
+
+	// derive all XRefs that have to be (but aren't yet) derived
+	for (uint32 v = 0; v < Oovpa->XRefCount; v++)
+	{
+		uint32 XRef;
+		uint08 Offset;
+
+		// get currently registered (un)known address
+		GetXRefEntry(Oovpa, v, XRef, Offset);
+		if (XRefDataBase[XRef] != XREF_ADDR_DERIVE)
+			continue;
 
-	// found nothing
-    return (xbaddr)nullptr;
+		// Calculate the address where the XRef resides
+		xbaddr XRefAddr = cur + Offset;
+		// Read the address it points to
+		XRefAddr = *((xbaddr*)XRefAddr);
+
+		/* For now assume it's a direct reference;
+		// TODO : Check if it's PC-relative reference?
+		if (XRefAddr + cur + Offset + 4 < XBE_MAX_VA)
+			XRefAddr = XRefAddr + cur + Offset + 4;
+		*/
+
+		// Does the address seem valid?
+		if (XRefAddr < XBE_MAX_VA)
+		{
+			// save and count the derived address
+			UnResolvedXRefs--;
+			XRefDataBase[XRef] = XRefAddr;
+			printf("Derived OOVPA!\n");
+		}
+	}
 }
 
-// install function interception wrappers
-static void EmuInstallPatches(OOVPATable *OovpaTable, uint32 OovpaTableSize, Xbe::Header *pXbeHeader)
+// locate the given function, searching within lower and upper bounds
+static xbaddr EmuLocateFunction(OOVPA *Oovpa, xbaddr lower, xbaddr upper)
 {
-    xbaddr lower = pXbeHeader->dwBaseAddr;
+	std::vector<OOVPAScanEntry> Entries(1);
+	if (!PrepareOOVPAScanEntry(Oovpa, Entries[0]))
+		return (xbaddr)nullptr;
 
-	// Find the highest address contained within an executable segment
-	xbaddr upper = pXbeHeader->dwBaseAddr;
-	Xbe::SectionHeader* headers = reinterpret_cast<Xbe::SectionHeader*>(pXbeHeader->dwSectionHeadersAddr);
+	EmuScanOOVPAs(Entries, lower, upper);
+	if (Entries[0].Match == (xbaddr)nullptr)
+		return (xbaddr)nullptr;
 
-	for (uint32_t i = 0; i < pXbeHeader->dwSections; i++) {
-		xbaddr end_addr = headers[i].dwVirtualAddr + headers[i].dwVirtualSize;
-		if (headers[i].dwFlags.bExecutable && end_addr > upper) {
-			upper = end_addr;
-		}	
-	}
+	EmuRegisterOOVPA(Oovpa, Entries[0].Match);
+	return Entries[0].Match;
+}
 
-    // traverse the full OOVPA table
-    for(size_t a=0;a<OovpaTableSize/sizeof(OOVPATable);a++)
-    {
+// install function interception wrappers
+static void EmuInstallPatches(OOVPATable *OovpaTable, uint32 OovpaTableSize, Xbe::Header *pXbeHeader)
+{
+	uint32 OovpaTableCount = OovpaTableSize / sizeof(OOVPATable);
+
+	// collect all OOVPA's that need to be searched for
+	std::vector<OOVPAScanEntry> Entries;
+	Entries.reserve(OovpaTableCount);
+	for (uint32 a = 0; a < OovpaTableCount; a++)
+	{
 		// Never used : skip scans when so configured
 		bool DontScan = (OovpaTable[a].Flags & Flag_DontScan) > 0;
 		if (DontScan)
@@ -835,12 +982,40 @@ static void EmuInstallPatches(OOVPATable *OovpaTable, uint32 OovpaTableSize, Xbe
 		if (pFunc != (xbaddr)nullptr)
 			continue;
 
-		// Search for each function's location using the OOVPA
-        OOVPA *Oovpa = OovpaTable[a].Oovpa;
-		pFunc = (xbaddr)EmuLocateFunction(Oovpa, lower, upper);
+		OOVPAScanEntry Entry;
+		if (!PrepareOOVPAScanEntry(OovpaTable[a].Oovpa, Entry))
+			continue;
+
+		Entry.TableIndex = a;
+		Entries.push_back(Entry);
+	}
+
+	// Search all executable sections, in a single pass per section
+	Xbe::SectionHeader* headers = reinterpret_cast<Xbe::SectionHeader*>(pXbeHeader->dwSectionHeadersAddr);
+
+	for (uint32_t i = 0; i < pXbeHeader->dwSections; i++) {
+		if (headers[i].dwFlags.bExecutable) {
+			xbaddr lower = headers[i].dwVirtualAddr;
+			xbaddr upper = headers[i].dwVirtualAddr + headers[i].dwVirtualSize;
+			EmuScanOOVPAs(Entries, lower, upper);
+		}
+	}
+
+    // handle all found OOVPA's, in table order
+    for(auto it = Entries.begin(); it != Entries.end(); ++it)
+    {
+		xbaddr pFunc = it->Match;
 		if (pFunc == (xbaddr)nullptr)
 			continue;
 
+		uint32 a = it->TableIndex;
+
+		// Skip symbols that were found via an earlier entry in this pass
+		if (g_SymbolAddresses[OovpaTable[a].szFuncName] != (xbaddr)nullptr)
+			continue;
+
+		EmuRegisterOOVPA(it->Oovpa, pFunc);
+
 		// Now that we found the address, store it (regardless if we patch it or not)
 		g_SymbolAddresses[OovpaTable[a].szFuncName] = (uint32_t)pFunc;
 
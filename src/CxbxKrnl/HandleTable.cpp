@@ -0,0 +1,178 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Win32->CxbxKrnl->HandleTable.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "HandleTable.h"
+
+#include <cstdio>
+
+HandleTable g_HandleTable;
+
+#define HANDLE_INFO(Generation, Type)   (((Generation) << 8) | (Type))
+#define HANDLE_INFO_TYPE(Info)          ((HANDLE_TYPE)((Info) & 0xFF))
+#define HANDLE_INFO_GENERATION(Info)    (((uint32_t)(Info) >> 8) & HANDLE_TABLE_GENERATION_MASK)
+
+HandleTable::HandleTable()
+{
+    InitializeCriticalSection(&m_Lock);
+
+    for(int p = 0; p < HANDLE_TABLE_PAGES; p++)
+        m_Pages[p] = nullptr;
+
+    // entry zero isn't used, its handle would be HANDLE_TABLE_TAG itself
+    m_FirstFree = 0;
+    m_NextUnused = 1;
+
+    m_Handles = 0;
+    m_Inserts = 0;
+    m_StaleLookups = 0;
+}
+
+HandleTable::~HandleTable()
+{
+    for(int p = 0; p < HANDLE_TABLE_PAGES; p++)
+        delete[] m_Pages[p];
+
+    DeleteCriticalSection(&m_Lock);
+}
+
+HandleTable::Entry *HandleTable::GetEntry(uint32_t Index) const
+{
+    Entry *pPage = m_Pages[Index / HANDLE_TABLE_PAGE_SIZE];
+    if(pPage == nullptr)
+        return nullptr;
+
+    return &pPage[Index % HANDLE_TABLE_PAGE_SIZE];
+}
+
+HANDLE HandleTable::Insert(void *pObject, HANDLE_TYPE Type)
+{
+    EnterCriticalSection(&m_Lock);
+
+    uint32_t Index = m_FirstFree;
+    Entry *pEntry;
+    if(Index != 0)
+    {
+        pEntry = GetEntry(Index);
+        m_FirstFree = (uint32_t)(uintptr_t)pEntry->pObject;
+    }
+    else
+    {
+        if(m_NextUnused >= HANDLE_TABLE_ENTRIES)
+        {
+            LeaveCriticalSection(&m_Lock);
+            return NULL;
+        }
+
+        Index = m_NextUnused++;
+
+        // pages are published once completely initialized, and never freed
+        uint32_t Page = Index / HANDLE_TABLE_PAGE_SIZE;
+        if(m_Pages[Page] == nullptr)
+            m_Pages[Page] = new Entry[HANDLE_TABLE_PAGE_SIZE]();
+
+        pEntry = GetEntry(Index);
+    }
+
+    uint32_t Generation = HANDLE_INFO_GENERATION(pEntry->Info);
+
+    // the object must be in place before lookups can see the entry in use
+    pEntry->pObject = pObject;
+    MemoryBarrier();
+    pEntry->Info = HANDLE_INFO(Generation, Type);
+
+    LeaveCriticalSection(&m_Lock);
+
+    InterlockedIncrement(&m_Handles);
+    InterlockedIncrement(&m_Inserts);
+
+    return (HANDLE)(uintptr_t)(HANDLE_TABLE_TAG | (Generation << HANDLE_TABLE_GENERATION_SHIFT) | (Index << HANDLE_TABLE_INDEX_SHIFT));
+}
+
+HANDLE_TYPE HandleTable::Lookup(HANDLE Handle, void **ppObject)
+{
+    uint32_t Value = (uint32_t)(uintptr_t)Handle;
+    uint32_t Index = (Value >> HANDLE_TABLE_INDEX_SHIFT) & (HANDLE_TABLE_ENTRIES - 1);
+
+    Entry *pEntry = IsTableHandle(Handle) ? GetEntry(Index) : nullptr;
+    if(pEntry != nullptr)
+    {
+        // the entry is only consistent if it didn't change while reading it
+        // (volatile reads are acquires, so these aren't reordered)
+        LONG Info = pEntry->Info;
+        void *pObject = pEntry->pObject;
+
+        if((pEntry->Info == Info) && (HANDLE_INFO_TYPE(Info) != HANDLE_TYPE_FREE) &&
+           (HANDLE_INFO_GENERATION(Info) == ((Value >> HANDLE_TABLE_GENERATION_SHIFT) & HANDLE_TABLE_GENERATION_MASK)))
+        {
+            *ppObject = pObject;
+            return HANDLE_INFO_TYPE(Info);
+        }
+    }
+
+    InterlockedIncrement(&m_StaleLookups);
+
+    *ppObject = nullptr;
+    return HANDLE_TYPE_FREE;
+}
+
+HANDLE_TYPE HandleTable::Remove(HANDLE Handle, void **ppObject)
+{
+    EnterCriticalSection(&m_Lock);
+
+    HANDLE_TYPE Type = Lookup(Handle, ppObject);
+    if(Type != HANDLE_TYPE_FREE)
+    {
+        uint32_t Index = ((uint32_t)(uintptr_t)Handle >> HANDLE_TABLE_INDEX_SHIFT) & (HANDLE_TABLE_ENTRIES - 1);
+        Entry *pEntry = GetEntry(Index);
+
+        // a new generation invalidates all copies of the handle
+        pEntry->Info = HANDLE_INFO((HANDLE_INFO_GENERATION(pEntry->Info) + 1) & HANDLE_TABLE_GENERATION_MASK, HANDLE_TYPE_FREE);
+        MemoryBarrier();
+        pEntry->pObject = (void *)(uintptr_t)m_FirstFree;
+        m_FirstFree = Index;
+
+        InterlockedDecrement(&m_Handles);
+    }
+
+    LeaveCriticalSection(&m_Lock);
+
+    return Type;
+}
+
+void HandleTable::DumpStatistics()
+{
+    printf("HandleTable : %d handles open, %d given out, %d invalid or stale lookups, %u entries used\n",
+        m_Handles, m_Inserts, m_StaleLookups, m_NextUnused - 1);
+}
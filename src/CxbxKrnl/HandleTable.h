@@ -0,0 +1,113 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Win32->CxbxKrnl->HandleTable.h
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef HANDLETABLE_H
+#define HANDLETABLE_H
+
+#include <windows.h>
+#include <cstdint>
+
+// Handles of emulated objects look like this (native handles never have the
+// top bit set, and 0xFFFFFFFE and up are pseudo handles) :
+//
+//   31   30..22       21..2   1..0
+//   [1] [generation] [index] [00]
+//
+// The generation of an entry changes on each close, so stale handles are
+// detected instead of resolving to whichever object reused the entry.
+#define HANDLE_TABLE_TAG            0x80000000
+#define HANDLE_TABLE_INDEX_SHIFT    2
+#define HANDLE_TABLE_INDEX_BITS     20
+#define HANDLE_TABLE_GENERATION_SHIFT (HANDLE_TABLE_INDEX_SHIFT + HANDLE_TABLE_INDEX_BITS)
+#define HANDLE_TABLE_GENERATION_MASK  0x1FF
+
+#define HANDLE_TABLE_ENTRIES        (1 << HANDLE_TABLE_INDEX_BITS)
+#define HANDLE_TABLE_PAGE_SIZE      256 // entries, allocated a page at a time
+#define HANDLE_TABLE_PAGES          (HANDLE_TABLE_ENTRIES / HANDLE_TABLE_PAGE_SIZE)
+
+typedef enum _HANDLE_TYPE
+{
+    HANDLE_TYPE_FREE = 0,       // not (or no longer) a valid handle
+    HANDLE_TYPE_EMU,            // an EmuHandle (see EmuFile.h)
+    HANDLE_TYPE_OBJECT          // the body of an Xbox object (see EmuKrnlOb.cpp)
+}
+HANDLE_TYPE;
+
+// table of all handles given out for emulated objects
+//
+// Inserting and removing handles is locked, looking them up isn't : readers
+// validate the entry they read against its generation instead.
+extern class HandleTable
+{
+    public:
+        HandleTable();
+       ~HandleTable();
+
+        // returns NULL when the table is full
+        HANDLE Insert(void *pObject, HANDLE_TYPE Type);
+
+        // returns HANDLE_TYPE_FREE for invalid and stale handles
+        HANDLE_TYPE Lookup(HANDLE Handle, void **ppObject);
+
+        // like Lookup, also freeing the handle
+        HANDLE_TYPE Remove(HANDLE Handle, void **ppObject);
+
+        // whether the handle could have come from this table
+        static bool IsTableHandle(HANDLE Handle)
+        {
+            return ((uint32_t)(uintptr_t)Handle > HANDLE_TABLE_TAG) && ((uint32_t)(uintptr_t)Handle < 0xFFFFFFFE);
+        }
+
+        void DumpStatistics();
+
+    private:
+        struct Entry
+        {
+            volatile LONG   Info;       // generation << 8 | HANDLE_TYPE
+            void * volatile pObject;    // or the index of the next free entry
+        };
+
+        Entry *GetEntry(uint32_t Index) const;
+
+        Entry * volatile m_Pages[HANDLE_TABLE_PAGES];
+        CRITICAL_SECTION m_Lock;
+        uint32_t         m_FirstFree;   // zero if none
+        uint32_t         m_NextUnused;  // entries from here on were never used
+
+        volatile LONG    m_Handles;
+        volatile LONG    m_Inserts;
+        volatile LONG    m_StaleLookups;
+}
+g_HandleTable;
+
+#endif
@@ -47,6 +47,9 @@ MemoryManager g_MemoryManager;
 MemoryManager::MemoryManager()
 {
 	InitializeCriticalSectionAndSpinCount(&m_CriticalSection, 0x400);
+	// Start allocating Contiguous Memory after the Kernel image header to prevent overwriting our dummy Kernel
+	m_ContiguousHeap.Initialize(XBOX_KERNEL_BASE + sizeof(DUMMY_KERNEL), MM_SYSTEM_PHYSICAL_MAP + CONTIGUOUS_MEMORY_SIZE);
+	m_ContiguousReportedHighWater = 0;
 }
 
 MemoryManager::~MemoryManager()
@@ -137,55 +140,22 @@ void* MemoryManager::AllocateContiguous(size_t size, size_t alignment)
 	assert(alignment >= 4096); // TODO : Pull PAGE_SIZE in scope for this?
 	assert((alignment & (alignment - 1)) == 0);
 
-	xbaddr alignMask = (xbaddr)(alignment - 1);
-
-	xbaddr addr = NULL;
-
 	EnterCriticalSection(&m_CriticalSection);
-	// Is the contiguous allocation table empty?
-	if (m_ContiguousMemoryBlocks.size() == 0) {
-		// Start allocating Contiguous Memory after the Kernel image header to prevent overwriting our dummy Kernel
-		addr = XBOX_KERNEL_BASE + sizeof(DUMMY_KERNEL);
-		addr = (addr + alignMask) & ~alignMask;
-	} else {
-		// Locate the first available Memory Region with enough space for the requested buffer
-		// TODO : This could be improved later on by always locating the smallest block with enough space
-		// in order to reduce memory fragmentation.
-		for (auto it = m_ContiguousMemoryBlocks.begin(); it != m_ContiguousMemoryBlocks.end(); ++it) {
-			MemoryBlock current = it->second;
-			xbaddr after_current = (xbaddr)current.addr + current.size;
-			after_current = (after_current + alignMask) & ~alignMask;
-
-			// Is this the last entry?
-			if (std::next(it) == m_ContiguousMemoryBlocks.end()) {
-				// Continue allocating after the last block :
-				addr = after_current;
-				break;
-			}
-
-			// Is there an empty gap after the current entry?
-			MemoryBlock next = std::next(it)->second;
-			if (after_current < (xbaddr)next.addr) {
-				// does this allocation fit inside the gap?
-				if (after_current + size < (xbaddr)next.addr) {
-					addr = after_current;
-					break;
-				}
-			}
-		}
+	// Take the best fitting free block (see ContiguousHeap)
+	xbaddr addr = m_ContiguousHeap.Allocate(size, alignment);
+	if (addr == NULL) {
+		ContiguousHeapStatistics stats;
+
+		m_ContiguousHeap.GetStatistics(&stats);
+		EmuWarning("MemoryManager::AllocateContiguous exhausted it's allowed memory buffer"
+			" (%u of %u bytes in use, largest free block %u bytes, %u%% fragmented)",
+			stats.UsedSize, stats.TotalSize, stats.LargestFreeSize, stats.Fragmentation);
 	}
-	
-	if (addr + size > MM_SYSTEM_PHYSICAL_MAP + CONTIGUOUS_MEMORY_SIZE)  {
-		EmuWarning("MemoryManager::AllocateContiguous exhausted it's allowed memory buffer");
-		addr = NULL;	
-	}
-	 
-	if (addr != NULL) {
+	else {
 		MemoryBlock block;
 
 		block.addr = (void *)addr;
 		block.size = size;
-		m_ContiguousMemoryBlocks[(void *)addr] = block;
 
 		TypedMemoryBlock info;
 
@@ -193,8 +163,14 @@ void* MemoryManager::AllocateContiguous(size_t size, size_t alignment)
 		info.block = block;
 
 		m_MemoryBlockInfo[(void *)addr] = info;
+
+		// Log each megabyte the high-water mark rises
+		if (m_ContiguousHeap.GetHighWaterSize() >= m_ContiguousReportedHighWater + ONE_MB) {
+			m_ContiguousReportedHighWater = m_ContiguousHeap.GetHighWaterSize();
+			DbgPrintf("MemoryManager: Contiguous memory high-water mark is now %u bytes\n", m_ContiguousReportedHighWater);
+		}
 	}
-	
+
 	LeaveCriticalSection(&m_CriticalSection);
 
 	RETURN((void*)addr);
@@ -245,7 +221,7 @@ void MemoryManager::Free(void* addr)
 				m_MemoryBlockInfo.erase(info->block.addr);
 				break;
 			case MemoryType::CONTIGUOUS:
-				m_ContiguousMemoryBlocks.erase(info->block.addr);
+				m_ContiguousHeap.Free((xbaddr)info->block.addr);
 				m_MemoryBlockInfo.erase(info->block.addr);
 				break;
 			default:
@@ -287,3 +263,10 @@ size_t MemoryManager::QueryAllocationSize(void* addr)
 
 	RETURN(ret);
 }
+
+void MemoryManager::GetContiguousStatistics(ContiguousHeapStatistics *pStatistics)
+{
+	EnterCriticalSection(&m_CriticalSection);
+	m_ContiguousHeap.GetStatistics(pStatistics);
+	LeaveCriticalSection(&m_CriticalSection);
+}
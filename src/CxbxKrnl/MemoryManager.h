@@ -42,6 +42,8 @@
 #include <map>
 #include <unordered_map>
 
+#include "ContiguousHeap.h"
+
 typedef struct {
 	void *addr;
 	size_t size;
@@ -70,9 +72,11 @@ public:
 	bool IsAllocated(void* addr);
 	void Free(void* addr);
 	size_t QueryAllocationSize(void* addr);
+	void GetContiguousStatistics(ContiguousHeapStatistics *pStatistics);
 private:
 	std::map<void *, TypedMemoryBlock> m_MemoryBlockInfo;
-	std::map<void *, MemoryBlock> m_ContiguousMemoryBlocks;
+	ContiguousHeap m_ContiguousHeap;
+	size_t m_ContiguousReportedHighWater;
 	CRITICAL_SECTION m_CriticalSection;
 	TypedMemoryBlock *FindContainingTypedMemoryBlock(void* addr);
 };
@@ -53,6 +53,28 @@ ResourceTracker g_PatchedStreamsCache;
 ResourceTracker g_DataToTexture;
 ResourceTracker g_AlignCache;
 
+// marks a hash table slot of which the node was removed
+#define RT_REMOVED ((RTNode *)1)
+
+// initial number of hash table slots
+#define RT_MIN_TABLE_SIZE 64
+
+static inline uint32 RTHash(uint32 uiKey, uint32 uiTableSize)
+{
+    // mix all key bits into the low ones (the MurmurHash3 finalizer), as the
+    // low bits of aligned pointer keys are always zero; multiplying alone
+    // keeps those zeroes, and would leave most slots unused
+    uint32_t uiHash = (uint32_t)uiKey;
+
+    uiHash ^= uiHash >> 16;
+    uiHash *= 0x85EBCA6B;
+    uiHash ^= uiHash >> 13;
+    uiHash *= 0xC2B2AE35;
+    uiHash ^= uiHash >> 16;
+
+    return uiHash & (uiTableSize - 1);
+}
+
 ResourceTracker::~ResourceTracker()
 {
     clear();
@@ -75,35 +97,108 @@ void ResourceTracker::clear()
 
     m_head = m_tail = 0;
 
+    delete[] m_table;
+
+    m_table = 0;
+    m_tableSize = 0;
+    m_tableUsed = 0;
+    m_count = 0;
+
     this->Unlock();
 }
 
+RTNode *ResourceTracker::find(uint32 uiKey)
+{
+    if(m_table == 0)
+        return 0;
+
+    for(uint32 i = RTHash(uiKey, m_tableSize);; i = (i + 1) & (m_tableSize - 1))
+    {
+        RTNode *cur = m_table[i];
+
+        if(cur == 0)
+            return 0;
+
+        if(cur != RT_REMOVED && cur->uiKey == uiKey)
+            return cur;
+    }
+}
+
+void ResourceTracker::rehash(uint32 uiTableSize)
+{
+    delete[] m_table;
+
+    m_table = new RTNode*[uiTableSize]();
+    m_tableSize = uiTableSize;
+    m_tableUsed = m_count;
+
+    // the tail is an empty node, which isn't hashed
+    for(RTNode *cur = m_head; cur != m_tail; cur = cur->pNext)
+    {
+        uint32 i = RTHash(cur->uiKey, m_tableSize);
+
+        while(m_table[i] != 0)
+            i = (i + 1) & (m_tableSize - 1);
+
+        m_table[i] = cur;
+    }
+}
+
 void ResourceTracker::insert(void *pResource)
 {
-    insert((uint32)pResource, pResource);
+    insert((uint32)(uintptr_t)pResource, pResource);
 }
 
 void ResourceTracker::insert(uint32 uiKey, void *pResource)
 {
     this->Lock();
 
-    if(exists(uiKey))
+    if(find(uiKey) != 0)
     {
         this->Unlock();
         return;
     }
 
+    // keep the table at most half full (counting removed slots too)
+    if((m_tableUsed + 1) * 2 > m_tableSize)
+    {
+        uint32 uiTableSize = (m_tableSize == 0) ? RT_MIN_TABLE_SIZE : m_tableSize;
+
+        // only grow when there are not enough removed slots to reclaim
+        while((m_count + 1) * 2 > uiTableSize)
+            uiTableSize *= 2;
+
+        rehash(uiTableSize);
+    }
+
     if(m_head == 0)
     {
         m_tail = m_head = new RTNode();
         m_tail->pResource = 0;
         m_tail->pNext = 0;
+        m_tail->pPrev = 0;
     }
 
     m_tail->pResource = pResource;
     m_tail->uiKey = uiKey;
 
     m_tail->pNext = new RTNode();
+    m_tail->pNext->pPrev = m_tail;
+
+    // hash the node that was just filled in
+    {
+        uint32 i = RTHash(uiKey, m_tableSize);
+
+        while(m_table[i] != 0 && m_table[i] != RT_REMOVED)
+            i = (i + 1) & (m_tableSize - 1);
+
+        if(m_table[i] == 0)
+            m_tableUsed++;
+
+        m_table[i] = m_tail;
+    }
+
+    m_count++;
 
     m_tail = m_tail->pNext;
 
@@ -118,46 +213,56 @@ void ResourceTracker::insert(uint32 uiKey, void *pResource)
 
 void ResourceTracker::remove(void *pResource)
 {
-    remove((uint32)pResource);
+    remove((uint32)(uintptr_t)pResource);
 }
 
 void ResourceTracker::remove(uint32 uiKey)
 {
     this->Lock();
 
-    RTNode *pre = 0;
-    RTNode *cur = m_head;
+    if(m_table == 0)
+    {
+        this->Unlock();
+        return;
+    }
 
-    while(cur != 0)
+    for(uint32 i = RTHash(uiKey, m_tableSize);; i = (i + 1) & (m_tableSize - 1))
     {
-        if(cur->uiKey == uiKey)
-        {
-            if(pre != 0)
-            {
-                pre->pNext = cur->pNext;
-            }
-            else
-            {
-                m_head = cur->pNext;
+        RTNode *cur = m_table[i];
 
-                if(m_head->pNext == 0)
-                {
-                    delete m_head;
+        if(cur == 0)
+            break;
 
-                    m_head = 0;
-                    m_tail = 0;
-                }
-            }
+        if(cur == RT_REMOVED || cur->uiKey != uiKey)
+            continue;
 
-            delete cur;
+        m_table[i] = RT_REMOVED;
+        m_count--;
 
-            this->Unlock();
+        // unlink the node (there's always a tail after it)
+        cur->pNext->pPrev = cur->pPrev;
 
-            return;
+        if(cur->pPrev != 0)
+        {
+            cur->pPrev->pNext = cur->pNext;
+        }
+        else
+        {
+            m_head = cur->pNext;
         }
 
-        pre = cur;
-        cur = cur->pNext;
+        delete cur;
+
+        // drop the tail when the list has become empty
+        if(m_count == 0)
+        {
+            delete m_head;
+
+            m_head = 0;
+            m_tail = 0;
+        }
+
+        break;
     }
 
     this->Unlock();
@@ -167,48 +272,32 @@ void ResourceTracker::remove(uint32 uiKey)
 
 bool ResourceTracker::exists(void *pResource)
 {
-    return exists((uint32)pResource);
+    return exists((uint32)(uintptr_t)pResource);
 }
 
 bool ResourceTracker::exists(uint32 uiKey)
 {
     this->Lock();
 
-    RTNode *cur = m_head;
-
-    while(cur != 0)
-    {
-        if(cur->uiKey == uiKey)
-        {
-            this->Unlock();
-            return true;
-        }
-
-        cur = cur->pNext;
-    }
+    bool bExists = (find(uiKey) != 0);
 
     this->Unlock();
 
-    return false;
+    return bExists;
 }
 
 void *ResourceTracker::get(void *pResource)
 {
-    return get((uint32)pResource);
+    return get((uint32)(uintptr_t)pResource);
 }
 
 void *ResourceTracker::get(uint32 uiKey)
 {
-    RTNode *cur = m_head;
+    RTNode *cur = find(uiKey);
 
-    while(cur != 0)
+    if(cur != 0)
     {
-        if(cur->uiKey == uiKey)
-        {
-            return cur->pResource;
-        }
-
-        cur = cur->pNext;
+        return cur->pResource;
     }
 
     return 0;
@@ -216,20 +305,5 @@ void *ResourceTracker::get(uint32 uiKey)
 
 uint32 ResourceTracker::get_count(void)
 {
-    uint32 uiCount = 0;
-
-    this->Lock();
-
-    RTNode *cur = m_head;
-
-    while(cur != 0)
-    {
-        uiCount++;
-
-        cur = cur->pNext;
-    }
-
-    this->Unlock();
-
-    return uiCount;
+    return m_count;
 }
@@ -43,7 +43,7 @@ extern bool g_bPBSkipPusher;
 extern class ResourceTracker : public Mutex
 {
     public:
-        ResourceTracker() : m_head(0), m_tail(0) {};
+        ResourceTracker() : m_head(0), m_tail(0), m_table(0), m_tableSize(0), m_tableUsed(0), m_count(0) {};
        ~ResourceTracker();
 
         // clear the tracker
@@ -80,9 +80,21 @@ extern class ResourceTracker : public Mutex
         struct RTNode *getHead() { return m_head; }
 
     private:
+        // lookup a node in the hash table, explicit locking needed
+        struct RTNode *find(uint32 uiKey);
+
+        // (re)allocate the hash table, rehashing all nodes in the list
+        void rehash(uint32 uiTableSize);
+
         // list of "live" vertex buffers for debugging purposes
         struct RTNode *m_head;
         struct RTNode *m_tail;
+
+        // open addressed (linear probing) hash table of all nodes in the list, on uiKey
+        struct RTNode **m_table;
+        uint32 m_tableSize;     // always a power of two
+        uint32 m_tableUsed;     // number of occupied slots, including removed ones
+        uint32 m_count;         // number of nodes in the list (excluding the tail)
 }
 g_VBTrackTotal, g_VBTrackDisable,
 g_PBTrackTotal, g_PBTrackDisable, g_PBTrackShowOnce,
@@ -93,6 +105,7 @@ struct RTNode
     uint32   uiKey;
     void    *pResource;
     RTNode  *pNext;
+    RTNode  *pPrev;
 };
 
 #endif
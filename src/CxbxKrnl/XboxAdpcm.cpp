@@ -0,0 +1,142 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Win32->CxbxKrnl->XboxAdpcm.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include "XboxAdpcm.h"
+
+static const int16_t StepTable[89] = {
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+	19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+	50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+	130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+	337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+	876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+	2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+	5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+	15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int8_t IndexTable[16] = {
+	-1, -1, -1, -1, 2, 4, 6, 8,
+	-1, -1, -1, -1, 2, 4, 6, 8
+};
+
+// The signed difference for each step index and 4 bit code, and the step index that
+// follows it, so that decoding a sample takes two table lookups and no branches.
+// The differences are built with the same shifts (and truncation) as the IMA reference.
+struct AdpcmTables
+{
+	int32_t Diff[89][16];
+	uint8_t NextIndex[89][16];
+
+	AdpcmTables()
+	{
+		for (int Index = 0; Index < 89; Index++) {
+			int Step = StepTable[Index];
+
+			for (int Code = 0; Code < 16; Code++) {
+				int Delta = Step >> 3;
+
+				if (Code & 4) Delta += Step;
+				if (Code & 2) Delta += Step >> 1;
+				if (Code & 1) Delta += Step >> 2;
+
+				Diff[Index][Code] = (Code & 8) ? -Delta : Delta;
+
+				int Next = Index + IndexTable[Code];
+
+				NextIndex[Index][Code] = (uint8_t)((Next < 0) ? 0 : (Next > 88) ? 88 : Next);
+			}
+		}
+	}
+};
+
+static const AdpcmTables g_AdpcmTables;
+
+// Decodes the 8 codes in a 4 byte group of one channel, writing every nStride'th sample
+static inline void DecodeGroup(const uint8_t *pSrc, int16_t *pDst, unsigned nStride, int &Predictor, int &Index)
+{
+	uint32_t Codes = pSrc[0] | (pSrc[1] << 8) | (pSrc[2] << 16) | ((uint32_t)pSrc[3] << 24);
+
+	for (int i = 0; i < 8; i++) {
+		unsigned Code = Codes & 15;
+
+		Predictor += g_AdpcmTables.Diff[Index][Code];
+		Predictor = (Predictor < -32768) ? -32768 : (Predictor > 32767) ? 32767 : Predictor;
+		Index = g_AdpcmTables.NextIndex[Index][Code];
+		*pDst = (int16_t)Predictor;
+		pDst += nStride;
+		Codes >>= 4;
+	}
+}
+
+void XboxAdpcmDecode
+(
+	const void *pSrc,
+	void *pDst,
+	size_t dwBlocks,
+	unsigned nChannels
+)
+{
+	const uint8_t *pIn = (const uint8_t *)pSrc;
+	int16_t *pOut = (int16_t *)pDst;
+	int Predictor[XBOX_ADPCM_MAX_CHANNELS];
+	int Index[XBOX_ADPCM_MAX_CHANNELS];
+
+	if (nChannels == 0 || nChannels > XBOX_ADPCM_MAX_CHANNELS)
+		return;
+
+	while (dwBlocks-- > 0) {
+		// The headers give each channel's first sample and initial step index
+		for (unsigned c = 0; c < nChannels; c++) {
+			Predictor[c] = (int16_t)(pIn[0] | (pIn[1] << 8));
+			Index[c] = (pIn[2] > 88) ? 88 : pIn[2];
+			pOut[c] = (int16_t)Predictor[c];
+			pIn += 4;
+		}
+
+		pOut += nChannels;
+
+		// Then 8 groups of 8 samples for each channel
+		for (int Group = 0; Group < 8; Group++) {
+			for (unsigned c = 0; c < nChannels; c++) {
+				DecodeGroup(pIn, pOut + c, nChannels, Predictor[c], Index[c]);
+				pIn += 4;
+			}
+
+			pOut += 8 * nChannels;
+		}
+	}
+}
@@ -0,0 +1,79 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Win32->CxbxKrnl->XboxAdpcm.h
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#ifndef XBOXADPCM_H
+#define XBOXADPCM_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Xbox ADPCM is IMA ADPCM with a fixed block layout. Per channel, a block starts with
+// a 4 byte header (the first sample as a 16 bit value, then the step index and a pad
+// byte), followed by 32 bytes holding 64 more samples as 4 bit codes, low nibble first.
+// With more channels, the headers come first, after which the channels alternate in
+// groups of 4 bytes (8 samples).
+//
+// Each block carries the complete decoder state in its headers, so blocks can be decoded
+// one at a time in any order. This allows decoding just the part of a buffer that's about
+// to be played, instead of converting the whole buffer up front.
+#define XBOX_ADPCM_SRCSIZE 36 // Encoded bytes per block, per channel
+#define XBOX_ADPCM_DSTSIZE 130 // Decoded (16 bit PCM) bytes per block, per channel
+#define XBOX_ADPCM_SAMPLES_PER_BLOCK 65
+#define XBOX_ADPCM_MAX_CHANNELS 8
+
+// Returns the number of 16 bit PCM bytes the (whole) blocks in dwAdpcmBytes decode to
+inline size_t XboxAdpcmDecodedSize(size_t dwAdpcmBytes, unsigned nChannels)
+{
+	return (dwAdpcmBytes / (XBOX_ADPCM_SRCSIZE * nChannels)) * (XBOX_ADPCM_DSTSIZE * nChannels);
+}
+
+// Returns the number of ADPCM bytes the (whole) blocks in dwPcmBytes were decoded from
+inline size_t XboxAdpcmEncodedSize(size_t dwPcmBytes, unsigned nChannels)
+{
+	return (dwPcmBytes / (XBOX_ADPCM_DSTSIZE * nChannels)) * (XBOX_ADPCM_SRCSIZE * nChannels);
+}
+
+// Decodes dwBlocks consecutive blocks of nChannels channels from pSrc, to interleaved
+// 16 bit PCM samples at pDst (which must hold dwBlocks * XBOX_ADPCM_DSTSIZE * nChannels bytes)
+extern void XboxAdpcmDecode
+(
+	const void *pSrc,
+	void *pDst,
+	size_t dwBlocks,
+	unsigned nChannels
+);
+
+#endif
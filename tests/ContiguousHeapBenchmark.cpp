@@ -0,0 +1,166 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->ContiguousHeapBenchmark.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "HostBenchmark.h"
+#include "CxbxKrnl/ContiguousHeap.h"
+
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+BENCHMARK_MAIN_GLOBALS
+
+// The first fit scan MemoryManager::AllocateContiguous did before ContiguousHeap,
+// over a map of the allocated blocks (without the logging and the locking)
+class FirstFitHeap
+{
+public:
+	FirstFitHeap(uint32_t StartAddress, uint32_t EndAddress) : m_StartAddress(StartAddress), m_EndAddress(EndAddress) {}
+
+	uint32_t Allocate(size_t size, size_t alignment)
+	{
+		uint32_t alignMask = (uint32_t)(alignment - 1);
+		uint32_t addr = 0;
+
+		if (m_Blocks.size() == 0) {
+			addr = (m_StartAddress + alignMask) & ~alignMask;
+		} else {
+			for (auto it = m_Blocks.begin(); it != m_Blocks.end(); ++it) {
+				uint32_t after_current = it->first + (uint32_t)it->second;
+				after_current = (after_current + alignMask) & ~alignMask;
+
+				if (std::next(it) == m_Blocks.end()) {
+					addr = after_current;
+					break;
+				}
+
+				uint32_t next = std::next(it)->first;
+				if (after_current < next) {
+					if (after_current + size < next) {
+						addr = after_current;
+						break;
+					}
+				}
+			}
+		}
+
+		if (addr + size > m_EndAddress)
+			return 0;
+
+		m_Blocks[addr] = size;
+		return addr;
+	}
+
+	void Free(uint32_t addr)
+	{
+		m_Blocks.erase(addr);
+	}
+
+private:
+	std::map<uint32_t, size_t> m_Blocks;
+	uint32_t m_StartAddress;
+	uint32_t m_EndAddress;
+};
+
+// Keeps LiveBlocks allocations alive in the 64 MB contiguous region, replacing a random
+// one per iteration. Returns the percentage of replacements whose allocation failed; when
+// a name is given, the replacements are timed.
+template<class HeapType>
+static double Churn(const char *szName, HeapType &Heap, unsigned LiveBlocks, size_t MaxSize, unsigned Iterations)
+{
+	std::vector<uint32_t> Live(LiveBlocks, 0);
+	unsigned Failed = 0;
+
+	srand(LiveBlocks);
+	for (auto &Address : Live)
+		Address = Heap.Allocate(1 + rand() % MaxSize, (size_t)CONTIGUOUS_HEAP_PAGE_SIZE << (rand() % 3));
+
+	auto Replace = [&](unsigned) {
+		uint32_t &Address = Live[rand() % LiveBlocks];
+		if (Address != 0)
+			Heap.Free(Address);
+
+		Address = Heap.Allocate(1 + rand() % MaxSize, (size_t)CONTIGUOUS_HEAP_PAGE_SIZE << (rand() % 3));
+		Failed += (Address == 0);
+	};
+
+	Iterations = BenchmarkIterations(Iterations);
+	if (szName != nullptr)
+		BenchmarkRun(szName, Iterations, 1, Replace);
+	else
+		for (unsigned i = 0; i < Iterations; i++)
+			Replace(i);
+
+	return (Failed * 100.0) / Iterations;
+}
+
+int main(int argc, char *argv[])
+{
+	BenchmarkInit(argc, argv);
+
+	const uint32_t Start = 0x80010000, End = 0x84000000;
+	static const struct { unsigned LiveBlocks; size_t MaxSize; } Loads[] = {
+		{ 100, 1024 * 1024 },
+		{ 1000, 64 * 1024 },
+		{ 10000, 8 * 1024 },
+	};
+
+	for (auto &Load : Loads) {
+		std::string Name = std::to_string(Load.LiveBlocks) + " live blocks of up to " + std::to_string(Load.MaxSize / 1024) + " KB, ";
+
+		// The cost of replacing a block; the first fit scan is linear in the number of blocks
+		FirstFitHeap FirstFit(Start, End);
+		Churn((Name + "first fit (per free+allocate)").c_str(), FirstFit, Load.LiveBlocks, Load.MaxSize, 10000000 / Load.LiveBlocks);
+
+		ContiguousHeap Tlsf;
+		Tlsf.Initialize(Start, End);
+		Churn((Name + "TLSF (per free+allocate)").c_str(), Tlsf, Load.LiveBlocks, Load.MaxSize, 2000000);
+
+		// How often allocations fail, for the exact same sequence of requests
+		const unsigned Iterations = 20000;
+		FirstFitHeap FirstFitRun(Start, End);
+		double FirstFitFailed = Churn(nullptr, FirstFitRun, Load.LiveBlocks, Load.MaxSize, Iterations);
+
+		ContiguousHeap TlsfRun;
+		TlsfRun.Initialize(Start, End);
+		double TlsfFailed = Churn(nullptr, TlsfRun, Load.LiveBlocks, Load.MaxSize, Iterations);
+
+		ContiguousHeapStatistics Statistics;
+		TlsfRun.GetStatistics(&Statistics);
+		printf("  failed allocations : first fit %.2f%%, TLSF %.2f%%; TLSF fragmentation %u%%, high water %zu KB\n",
+			FirstFitFailed, TlsfFailed, Statistics.Fragmentation, Statistics.HighWaterSize / 1024);
+	}
+
+	return 0;
+}
@@ -0,0 +1,238 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->ContiguousHeapTests.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "HostTest.h"
+#include "CxbxKrnl/ContiguousHeap.h"
+
+#include <cstdlib>
+#include <iterator>
+#include <map>
+
+#define PAGE CONTIGUOUS_HEAP_PAGE_SIZE
+
+static ContiguousHeapStatistics GetStatistics(ContiguousHeap &Heap)
+{
+	ContiguousHeapStatistics Statistics;
+
+	Heap.GetStatistics(&Statistics);
+	return Statistics;
+}
+
+TEST_CASE(ContiguousHeap_Initialize)
+{
+	ContiguousHeap Heap;
+
+	// An uninitialized heap has nothing to give out
+	TEST_CHECK_EQUAL(Heap.Allocate(1, PAGE), 0);
+
+	// The region is rounded inwards to whole pages
+	Heap.Initialize(0x80010100, 0x80020800);
+	ContiguousHeapStatistics Statistics = GetStatistics(Heap);
+	TEST_CHECK_EQUAL(Statistics.TotalSize, 15 * PAGE);
+	TEST_CHECK_EQUAL(Statistics.UsedSize, 0);
+	TEST_CHECK_EQUAL(Statistics.LargestFreeSize, 15 * PAGE);
+	TEST_CHECK_EQUAL(Statistics.FreeBlocks, 1);
+	TEST_CHECK_EQUAL(Statistics.Fragmentation, 0);
+	TEST_CHECK_EQUAL(Heap.Allocate(1, PAGE), 0x80011000);
+}
+
+TEST_CASE(ContiguousHeap_AllocateAndFree)
+{
+	ContiguousHeap Heap;
+
+	Heap.Initialize(0x80000000, 0x80000000 + 16 * PAGE);
+
+	uint32_t A = Heap.Allocate(1, PAGE);
+	uint32_t B = Heap.Allocate(PAGE + 1, PAGE);
+	uint32_t C = Heap.Allocate(0, PAGE); // is given a page too
+	TEST_CHECK(A != 0 && B != 0 && C != 0);
+	TEST_CHECK(B >= A + PAGE || A >= B + 2 * PAGE);
+
+	ContiguousHeapStatistics Statistics = GetStatistics(Heap);
+	TEST_CHECK_EQUAL(Statistics.UsedSize, 4 * PAGE);
+	TEST_CHECK_EQUAL(Statistics.UsedBlocks, 3);
+
+	// Only the start of an allocation can be freed, and only once
+	TEST_CHECK_EQUAL(Heap.Free(B + PAGE), 0);
+	TEST_CHECK_EQUAL(Heap.Free(B + 1), 0);
+	TEST_CHECK_EQUAL(Heap.Free(0x80000000 + 32 * PAGE), 0);
+	TEST_CHECK_EQUAL(Heap.Free(0x70000000), 0);
+	TEST_CHECK_EQUAL(Heap.Free(B), 2 * PAGE);
+	TEST_CHECK_EQUAL(Heap.Free(B), 0);
+	TEST_CHECK_EQUAL(Heap.Free(A), PAGE);
+	TEST_CHECK_EQUAL(Heap.Free(C), PAGE);
+
+	// All free blocks have merged back into one
+	Statistics = GetStatistics(Heap);
+	TEST_CHECK_EQUAL(Statistics.UsedSize, 0);
+	TEST_CHECK_EQUAL(Statistics.UsedBlocks, 0);
+	TEST_CHECK_EQUAL(Statistics.FreeBlocks, 1);
+	TEST_CHECK_EQUAL(Statistics.LargestFreeSize, 16 * PAGE);
+	TEST_CHECK_EQUAL(Statistics.HighWaterSize, 4 * PAGE);
+}
+
+TEST_CASE(ContiguousHeap_Alignment)
+{
+	ContiguousHeap Heap;
+
+	Heap.Initialize(0x80001000, 0x80001000 + 1024 * PAGE);
+	for (size_t Alignment = PAGE; Alignment <= 64 * PAGE; Alignment <<= 1) {
+		// A one page block first, so the next one needs padding
+		uint32_t Small = Heap.Allocate(PAGE, PAGE);
+		uint32_t Aligned = Heap.Allocate(3 * PAGE, Alignment);
+		TEST_CHECK(Small != 0);
+		TEST_CHECK(Aligned != 0);
+		TEST_CHECK_EQUAL(Aligned % Alignment, 0);
+	}
+
+	// The padding pages went back to the free lists
+	ContiguousHeapStatistics Statistics = GetStatistics(Heap);
+	TEST_CHECK_EQUAL(Statistics.UsedSize, 7 * 4 * PAGE);
+	TEST_CHECK(Statistics.FreeBlocks > 1);
+}
+
+TEST_CASE(ContiguousHeap_Exhaustion)
+{
+	ContiguousHeap Heap;
+
+	Heap.Initialize(0x80000000, 0x80000000 + 8 * PAGE);
+	TEST_CHECK_EQUAL(Heap.Allocate(8 * PAGE + 1, PAGE), 0);
+	TEST_CHECK_EQUAL(GetStatistics(Heap).FailedAllocations, 1);
+
+	uint32_t Pages[8];
+	for (int i = 0; i < 8; i++) {
+		Pages[i] = Heap.Allocate(PAGE, PAGE);
+		TEST_CHECK_EQUAL(Pages[i], 0x80000000 + i * PAGE); // best fit from the start
+	}
+
+	TEST_CHECK_EQUAL(Heap.Allocate(1, PAGE), 0);
+	TEST_CHECK_EQUAL(GetStatistics(Heap).FailedAllocations, 2);
+
+	// Free every other page : half the memory is free, but no two pages are adjacent
+	for (int i = 0; i < 8; i += 2)
+		Heap.Free(Pages[i]);
+
+	ContiguousHeapStatistics Statistics = GetStatistics(Heap);
+	TEST_CHECK_EQUAL(Statistics.FreeBlocks, 4);
+	TEST_CHECK_EQUAL(Statistics.LargestFreeSize, PAGE);
+	TEST_CHECK_EQUAL(Statistics.Fragmentation, 75);
+	TEST_CHECK_EQUAL(Statistics.HighWaterSize, 8 * PAGE);
+	TEST_CHECK_EQUAL(Statistics.HighWaterAddress, 0x80000000 + 8 * PAGE);
+	TEST_CHECK_EQUAL(Heap.Allocate(2 * PAGE, PAGE), 0);
+
+	// Freeing a page in between merges it with both neighbours
+	Heap.Free(Pages[1]);
+	Statistics = GetStatistics(Heap);
+	TEST_CHECK_EQUAL(Statistics.FreeBlocks, 3);
+	TEST_CHECK_EQUAL(Statistics.LargestFreeSize, 3 * PAGE);
+	TEST_CHECK_EQUAL(Heap.Allocate(3 * PAGE, PAGE), Pages[0]);
+}
+
+// An aligned allocation must find a fitting block even when the lists it looks in first
+// only hold misaligned blocks, and no block is large enough for the worst case padding
+TEST_CASE(ContiguousHeap_FragmentedAlignment)
+{
+	ContiguousHeap Heap;
+	uint32_t Pages[8];
+
+	Heap.Initialize(0x80000000, 0x80000000 + 8 * PAGE);
+	for (int i = 0; i < 8; i++)
+		Pages[i] = Heap.Allocate(PAGE, PAGE);
+
+	// Free blocks : page 1 (misaligned), and pages 3-4 (of which page 4 is 4 page aligned)
+	Heap.Free(Pages[1]);
+	Heap.Free(Pages[3]);
+	Heap.Free(Pages[4]);
+
+	TEST_CHECK_EQUAL(Heap.Allocate(PAGE, 4 * PAGE), Pages[4]);
+	TEST_CHECK_EQUAL(Heap.Allocate(PAGE, 4 * PAGE), 0);
+	TEST_CHECK_EQUAL(GetStatistics(Heap).FailedAllocations, 1);
+}
+
+// Random allocations and frees, checked against a shadow administration
+TEST_CASE(ContiguousHeap_RandomStress)
+{
+	const uint32_t Start = 0x80010000, End = Start + 16 * 1024 * 1024;
+	ContiguousHeap Heap;
+	std::map<uint32_t, size_t> Live; // address -> requested size
+	size_t UsedSize = 0;
+
+	Heap.Initialize(Start, End);
+	srand(9);
+	for (int i = 0; i < 200000; i++) {
+		if (Live.empty() || (Live.size() < 2000 && rand() % 2 == 0)) {
+			size_t Size = (rand() % 8 == 0) ? 1 + rand() % (1024 * 1024) : 1 + rand() % (64 * 1024);
+			size_t Alignment = (size_t)PAGE << (rand() % 5);
+			uint32_t Address = Heap.Allocate(Size, Alignment);
+			if (Address == 0)
+				continue;
+
+			TEST_CHECK_EQUAL(Address % Alignment, 0);
+			TEST_CHECK(Address >= Start && Address + Size <= End);
+
+			// No overlap with the neighbouring allocations
+			auto Next = Live.lower_bound(Address);
+			if (Next != Live.end())
+				TEST_CHECK(Address + Size <= Next->first);
+			if (Next != Live.begin())
+				TEST_CHECK(std::prev(Next)->first + std::prev(Next)->second <= Address);
+
+			Live[Address] = Size;
+			UsedSize += (Size + PAGE - 1) & ~(size_t)(PAGE - 1);
+		}
+		else {
+			auto Victim = Live.begin();
+			std::advance(Victim, rand() % Live.size());
+			size_t Rounded = (Victim->second + PAGE - 1) & ~(size_t)(PAGE - 1);
+			TEST_CHECK_EQUAL(Heap.Free(Victim->first), Rounded);
+			UsedSize -= Rounded;
+			Live.erase(Victim);
+		}
+
+		if (i % 1000 == 0) {
+			ContiguousHeapStatistics Statistics = GetStatistics(Heap);
+			TEST_CHECK_EQUAL(Statistics.UsedSize, UsedSize);
+			TEST_CHECK_EQUAL(Statistics.UsedBlocks, Live.size());
+			TEST_CHECK(Statistics.LargestFreeSize <= Statistics.TotalSize - Statistics.UsedSize);
+			TEST_CHECK(Statistics.HighWaterSize >= Statistics.UsedSize);
+		}
+	}
+
+	for (auto &Allocation : Live)
+		Heap.Free(Allocation.first);
+
+	ContiguousHeapStatistics Statistics = GetStatistics(Heap);
+	TEST_CHECK_EQUAL(Statistics.UsedSize, 0);
+	TEST_CHECK_EQUAL(Statistics.FreeBlocks, 1);
+	TEST_CHECK_EQUAL(Statistics.LargestFreeSize, Statistics.TotalSize);
+}
@@ -0,0 +1,134 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->CriticalSectionRegistryBenchmark.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "HostBenchmark.h"
+#include "CxbxKrnl/CriticalSectionRegistry.h"
+#include "CriticalSectionRegistryReference.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+BENCHMARK_MAIN_GLOBALS
+
+// Only the lookups are measured, so the native sections do nothing
+
+VOID NtDll::RtlInitializeCriticalSection(PRTL_CRITICAL_SECTION CriticalSection)
+{
+	memset(CriticalSection, 0, sizeof(*CriticalSection));
+	CriticalSection->LockCount = -1;
+}
+
+NtDll::NTSTATUS NtDll::RtlDeleteCriticalSection(PRTL_CRITICAL_SECTION CriticalSection)
+{
+	return 0;
+}
+
+VOID NtDll::RtlEnterCriticalSection(PRTL_CRITICAL_SECTION CriticalSection)
+{
+}
+
+BOOL NtDll::RtlTryEnterCriticalSection(PRTL_CRITICAL_SECTION CriticalSection)
+{
+	return TRUE;
+}
+
+VOID NtDll::RtlLeaveCriticalSection(PRTL_CRITICAL_SECTION CriticalSection)
+{
+}
+
+struct XboxSection
+{
+	uint8_t Bytes[28];
+};
+
+// Looks up sections in a pseudo random order, from several threads at once
+template<typename Lookup>
+static void BenchmarkLookups(const char *szName, int SectionCount, int ThreadCount, Lookup Find)
+{
+	std::string Name = std::string(szName) + ", " + std::to_string(SectionCount) + " sections, "
+		+ std::to_string(ThreadCount) + " thread(s)";
+	unsigned Lookups = BenchmarkIterations(1000000);
+
+	BenchmarkRun(Name.c_str(), 1, ThreadCount * Lookups, [&](unsigned) {
+		std::vector<std::thread> Threads;
+
+		for (int t = 0; t < ThreadCount; t++)
+			Threads.emplace_back([&, t] {
+				uint32_t Random = 7919 * (t + 1);
+
+				for (unsigned i = 0; i < Lookups; i++) {
+					Random = Random * 1103515245 + 12345;
+					BenchmarkKeep(Find((Random >> 8) % SectionCount));
+				}
+			});
+
+		for (std::thread &Thread : Threads)
+			Thread.join();
+	});
+}
+
+int main(int argc, char *argv[])
+{
+	BenchmarkInit(argc, argv);
+
+	static XboxSection Sections[MAX_XBOX_CRITICAL_SECTIONS];
+	static LinearCriticalSectionTable Table;
+
+	InitializeSectionStructures();
+
+	// Titles typically have tens of sections; the old table could not hold more than 1024
+	for (int SectionCount : { 32, 256, MAX_XBOX_CRITICAL_SECTIONS }) {
+		for (int s = 0; s < SectionCount; s++) {
+			FindCriticalSection(&Sections[s]);
+			Table.Register(&Sections[s]);
+		}
+
+		for (int ThreadCount : { 1, 4 }) {
+			BenchmarkLookups("sharded hash maps", SectionCount, ThreadCount,
+				[&](int s) { return FindCriticalSection(&Sections[s]); });
+			BenchmarkLookups("linear scan (before)", SectionCount, ThreadCount,
+				[&](int s) { return Table.Find(&Sections[s]); });
+		}
+	}
+
+	// A Leave of a section that was never entered (and an Initialize of a new one)
+	// used to scan the whole table
+	XboxSection Unknown;
+	BenchmarkLookups("sharded hash maps, unregistered", 1, 1,
+		[&](int) { return FindCriticalSection(&Unknown, false); });
+	BenchmarkLookups("linear scan (before), unregistered", 1, 1,
+		[&](int) { return Table.Find(&Unknown); });
+
+	return 0;
+}
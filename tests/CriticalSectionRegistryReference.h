@@ -0,0 +1,96 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->CriticalSectionRegistryReference.h
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef CRITICALSECTIONREGISTRYREFERENCE_H
+#define CRITICALSECTIONREGISTRYREFERENCE_H
+
+// The critical section table from before CxbxKrnl/CriticalSectionRegistry.cpp, kept as
+// the reference it is measured against : every lookup scanned the table from the start,
+// so finding a section cost as many compares as there were slots before it (and a section
+// that wasn't registered yet, all 1024 of them).
+
+#include "CxbxKrnl/CriticalSectionRegistry.h"
+
+#define MAX_XBOX_CRITICAL_SECTIONS 1024
+
+struct LinearCriticalSectionTable
+{
+	struct Entry
+	{
+		PVOID XboxCriticalSection;
+		NtDll::_RTL_CRITICAL_SECTION NativeCriticalSection;
+	};
+
+	Entry Sections[MAX_XBOX_CRITICAL_SECTIONS];
+
+	LinearCriticalSectionTable()
+	{
+		memset(Sections, 0, sizeof(Sections));
+	}
+
+	int Find(PVOID CriticalSection)
+	{
+		int FreeSection = -1;
+
+		for (int iSection = 0; iSection < MAX_XBOX_CRITICAL_SECTIONS; ++iSection)
+		{
+			if (Sections[iSection].XboxCriticalSection == CriticalSection)
+			{
+				FreeSection = iSection;
+				break;
+			}
+			else if (FreeSection < 0 && Sections[iSection].XboxCriticalSection == NULL)
+			{
+				FreeSection = iSection;
+			}
+		}
+
+		return FreeSection;
+	}
+
+	// As RtlInitializeCriticalSection did it
+	int Register(PVOID CriticalSection)
+	{
+		int iSection = Find(CriticalSection);
+
+		if (iSection >= 0 && Sections[iSection].XboxCriticalSection == NULL)
+		{
+			Sections[iSection].XboxCriticalSection = CriticalSection;
+			NtDll::RtlInitializeCriticalSection(&Sections[iSection].NativeCriticalSection);
+		}
+
+		return iSection;
+	}
+};
+
+#endif // CRITICALSECTIONREGISTRYREFERENCE_H
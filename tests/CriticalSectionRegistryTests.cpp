@@ -0,0 +1,298 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->CriticalSectionRegistryTests.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "HostTest.h"
+#include "CxbxKrnl/CriticalSectionRegistry.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//
+// Native critical sections on a recursive mutex, keeping LockCount, RecursionCount
+// and OwningThread like Windows does, and counting (de)initializations
+//
+
+static std::atomic<int> g_Initializations(0);
+static std::atomic<int> g_Deletions(0);
+
+static std::recursive_mutex *NativeMutex(NtDll::PRTL_CRITICAL_SECTION CriticalSection)
+{
+	return (std::recursive_mutex *)CriticalSection->LockSemaphore;
+}
+
+VOID NtDll::RtlInitializeCriticalSection(PRTL_CRITICAL_SECTION CriticalSection)
+{
+	memset(CriticalSection, 0, sizeof(*CriticalSection));
+	CriticalSection->LockCount = -1;
+	CriticalSection->LockSemaphore = new std::recursive_mutex();
+	g_Initializations++;
+}
+
+NtDll::NTSTATUS NtDll::RtlDeleteCriticalSection(PRTL_CRITICAL_SECTION CriticalSection)
+{
+	delete NativeMutex(CriticalSection);
+	CriticalSection->LockSemaphore = nullptr;
+	g_Deletions++;
+	return 0;
+}
+
+static void Entered(NtDll::PRTL_CRITICAL_SECTION CriticalSection)
+{
+	CriticalSection->LockCount++;
+	CriticalSection->RecursionCount++;
+	CriticalSection->OwningThread = (HANDLE)(uintptr_t)GetCurrentThreadId();
+}
+
+VOID NtDll::RtlEnterCriticalSection(PRTL_CRITICAL_SECTION CriticalSection)
+{
+	NativeMutex(CriticalSection)->lock();
+	Entered(CriticalSection);
+}
+
+BOOL NtDll::RtlTryEnterCriticalSection(PRTL_CRITICAL_SECTION CriticalSection)
+{
+	if (!NativeMutex(CriticalSection)->try_lock())
+		return FALSE;
+
+	Entered(CriticalSection);
+	return TRUE;
+}
+
+VOID NtDll::RtlLeaveCriticalSection(PRTL_CRITICAL_SECTION CriticalSection)
+{
+	CriticalSection->LockCount--;
+	if (--CriticalSection->RecursionCount == 0)
+		CriticalSection->OwningThread = nullptr;
+	NativeMutex(CriticalSection)->unlock();
+}
+
+// Stands in for Xbox critical sections; only their addresses matter to the registry
+struct XboxSection
+{
+	uint8_t Bytes[28];
+};
+
+static void Setup()
+{
+	static bool bInitialized = false;
+
+	if (!bInitialized) {
+		InitializeSectionStructures();
+		bInitialized = true;
+	}
+}
+
+static void Leave(INTERNAL_CRITICAL_SECTION *pSection)
+{
+	NtDll::RtlLeaveCriticalSection(&pSection->NativeCriticalSection);
+}
+
+TEST_CASE(CriticalSectionRegistry_RegistersEachSectionOnce)
+{
+	static XboxSection Sections[2];
+	Setup();
+
+	int InitializationsBefore = g_Initializations;
+
+	// Leave looks up without creating
+	TEST_CHECK(FindCriticalSection(&Sections[0], false) == nullptr);
+	TEST_CHECK_EQUAL(g_Initializations, InitializationsBefore);
+
+	INTERNAL_CRITICAL_SECTION *pSection = FindCriticalSection(&Sections[0]);
+	TEST_CHECK(pSection != nullptr);
+	TEST_CHECK(pSection->XboxCriticalSection == &Sections[0]);
+	TEST_CHECK_EQUAL(pSection->NativeCriticalSection.LockCount, -1);
+	TEST_CHECK_EQUAL(g_Initializations, InitializationsBefore + 1);
+
+	TEST_CHECK(FindCriticalSection(&Sections[0]) == pSection);
+	TEST_CHECK(FindCriticalSection(&Sections[0], false) == pSection);
+	TEST_CHECK(FindCriticalSection(&Sections[1]) != pSection);
+	TEST_CHECK_EQUAL(g_Initializations, InitializationsBefore + 2);
+}
+
+TEST_CASE(CriticalSectionRegistry_EntriesNeverMove)
+{
+	static XboxSection Sections[20000];
+	Setup();
+
+	// Registering many more makes every shard rehash
+	INTERNAL_CRITICAL_SECTION *pFirst = FindCriticalSection(&Sections[0]);
+	for (XboxSection &Section : Sections)
+		FindCriticalSection(&Section);
+
+	TEST_CHECK(FindCriticalSection(&Sections[0], false) == pFirst);
+	TEST_CHECK(pFirst->XboxCriticalSection == &Sections[0]);
+
+	// and there's no limit on how many there are (the old table held 1024)
+	for (XboxSection &Section : Sections)
+		TEST_CHECK(FindCriticalSection(&Section, false) != nullptr);
+}
+
+TEST_CASE(CriticalSectionRegistry_ReinitializingReusesTheEntry)
+{
+	static XboxSection Section;
+	Setup();
+
+	int InitializationsBefore = g_Initializations;
+	int DeletionsBefore = g_Deletions;
+
+	INTERNAL_CRITICAL_SECTION *pSection = InitializeCriticalSectionEntry(&Section);
+	TEST_CHECK_EQUAL(g_Initializations, InitializationsBefore + 1);
+	TEST_CHECK_EQUAL(g_Deletions, DeletionsBefore);
+
+	EnterNativeCriticalSection(pSection);
+	Leave(pSection);
+
+	// The title reused the memory for a new section : a new native one, in the same entry
+	TEST_CHECK(InitializeCriticalSectionEntry(&Section) == pSection);
+	TEST_CHECK_EQUAL(g_Initializations, InitializationsBefore + 2);
+	TEST_CHECK_EQUAL(g_Deletions, DeletionsBefore + 1);
+	TEST_CHECK_EQUAL(pSection->NativeCriticalSection.LockCount, -1);
+	TEST_CHECK_EQUAL(pSection->Enters, 1);
+}
+
+TEST_CASE(CriticalSectionRegistry_CountsContention)
+{
+	static XboxSection Section;
+	Setup();
+
+	INTERNAL_CRITICAL_SECTION *pSection = FindCriticalSection(&Section);
+
+	EnterNativeCriticalSection(pSection);
+	EnterNativeCriticalSection(pSection); // recursive, not contended
+	TEST_CHECK_EQUAL(pSection->NativeCriticalSection.RecursionCount, 2);
+
+	std::atomic<bool> bTried(false);
+	bool bTryEntered = true;
+	std::thread Other([&] {
+		bTryEntered = TryEnterNativeCriticalSection(pSection);
+		bTried = true;
+		EnterNativeCriticalSection(pSection);
+		Leave(pSection);
+	});
+
+	while (!bTried)
+		std::this_thread::yield();
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	Leave(pSection);
+	Leave(pSection);
+	Other.join();
+
+	TEST_CHECK(!bTryEntered);
+	TEST_CHECK_EQUAL(pSection->Enters, 3);
+	TEST_CHECK_EQUAL(pSection->Contentions, 1);
+
+	LARGE_INTEGER Frequency;
+	QueryPerformanceFrequency(&Frequency);
+	TEST_CHECK(pSection->WaitTicks >= Frequency.QuadPart / 100); // at least 10 ms
+
+	TEST_CHECK(TryEnterNativeCriticalSection(pSection));
+	TEST_CHECK_EQUAL(pSection->Enters, 4);
+	Leave(pSection);
+}
+
+// Threads entering sections in random order, each once through a fresh lookup
+struct ConcurrencyCase
+{
+	int Threads;
+	int Sections;
+	int Iterations;
+	int HotPercentage;  // of the iterations that use the first section
+};
+
+TEST_CASE(CriticalSectionRegistry_RegistersAndExcludesConcurrently)
+{
+	static const ConcurrencyCase Cases[] = {
+		{ 2, 16, 50000, 0 },
+		{ 4, 5000, 50000, 10 },
+		{ 8, 1500, 20000, 50 },
+	};
+	Setup();
+
+	for (const ConcurrencyCase &Case : Cases) {
+		int FailuresBefore = g_HostTestFailures;
+		std::vector<XboxSection> Sections(Case.Sections);
+		std::vector<long> Counters(Case.Sections, 0);
+		std::vector<std::thread> Threads;
+		int InitializationsBefore = g_Initializations;
+
+		for (int t = 0; t < Case.Threads; t++)
+			Threads.emplace_back([&, t] {
+				uint32_t Random = 7919 * (t + 1);
+
+				for (int i = 0; i < Case.Iterations; i++) {
+					Random = Random * 1103515245 + 12345;
+					int s = (Random >> 8) % Case.Sections;
+					if ((int)((Random >> 4) % 100) < Case.HotPercentage)
+						s = 0;
+
+					// nested, like a title's helper that takes a lock its caller holds
+					INTERNAL_CRITICAL_SECTION *pOuter = FindCriticalSection(&Sections[s]);
+					EnterNativeCriticalSection(pOuter);
+					INTERNAL_CRITICAL_SECTION *pInner = FindCriticalSection(&Sections[s]);
+					EnterNativeCriticalSection(pInner);
+					Counters[s] = Counters[s] + 1;
+					Leave(pInner);
+					Leave(pOuter);
+				}
+			});
+
+		for (std::thread &Thread : Threads)
+			Thread.join();
+
+		long Total = 0;
+		uint64_t Enters = 0;
+		int Registered = 0;
+		for (int s = 0; s < Case.Sections; s++) {
+			INTERNAL_CRITICAL_SECTION *pSection = FindCriticalSection(&Sections[s], false);
+			Total += Counters[s];
+			if (pSection != nullptr) {
+				Registered++;
+				Enters += pSection->Enters;
+				TEST_CHECK_EQUAL(pSection->Enters, 2 * Counters[s]);
+				TEST_CHECK_EQUAL(pSection->NativeCriticalSection.LockCount, -1);
+			}
+		}
+
+		TEST_CHECK_EQUAL(Total, (long)Case.Threads * Case.Iterations);
+		TEST_CHECK_EQUAL(Enters, 2 * (uint64_t)Total);
+		// each section that was used got exactly one native section
+		TEST_CHECK_EQUAL(g_Initializations - InitializationsBefore, Registered);
+
+		if (g_HostTestFailures != FailuresBefore)
+			printf("  in case of %d threads, %d sections\n", Case.Threads, Case.Sections);
+	}
+}
@@ -0,0 +1,666 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->EmuX86Tests.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "HostTest.h"
+#include "CxbxKrnl/CxbxKrnl.h"
+#include "CxbxKrnl/Emu.h"
+#include "CxbxKrnl/EmuX86.h"
+#include "CxbxKrnl/EmuNV2A.h"
+#include "CxbxKrnl/HLEIntercept.h"
+
+#define SUPPORT_64BIT_OFFSET
+#include "distorm.h"
+#include "mnemonics.h"
+
+#include <cstdarg>
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+// The handlers in EmuX86.cpp that are tested directly
+typedef bool (*OpcodeHandler)(LPEXCEPTION_POINTERS e, _DInst& info);
+bool EmuX86_Opcode_AND(LPEXCEPTION_POINTERS e, _DInst& info);
+bool EmuX86_Opcode_CMP(LPEXCEPTION_POINTERS e, _DInst& info);
+bool EmuX86_Opcode_IN(LPEXCEPTION_POINTERS e, _DInst& info);
+bool EmuX86_Opcode_MOVS(LPEXCEPTION_POINTERS e, _DInst& info);
+bool EmuX86_Opcode_MOVSX(LPEXCEPTION_POINTERS e, _DInst& info);
+bool EmuX86_Opcode_OR(LPEXCEPTION_POINTERS e, _DInst& info);
+bool EmuX86_Opcode_STOS(LPEXCEPTION_POINTERS e, _DInst& info);
+bool EmuX86_Opcode_SUB(LPEXCEPTION_POINTERS e, _DInst& info);
+bool EmuX86_Opcode_XOR(LPEXCEPTION_POINTERS e, _DInst& info);
+void EmuX86_SetLogicFlags(LPEXCEPTION_POINTERS e, uint32_t result, uint16_t size);
+void EmuX86_SetAddFlags(LPEXCEPTION_POINTERS e, uint32_t dest, uint32_t src, uint32_t result, uint16_t size);
+void EmuX86_SetSubFlags(LPEXCEPTION_POINTERS e, uint32_t dest, uint32_t src, uint32_t result, uint16_t size);
+uint32_t EmuX86_Read(xbaddr addr, int size);
+void EmuX86_Write(xbaddr addr, uint32_t value, int size);
+
+volatile bool g_bEmuException = true;
+bool bLLE_GPU = true;
+
+static int g_Warnings = 0;
+
+void EmuWarning(const char *szWarningMessage, ...)
+{
+	g_Warnings++;
+}
+
+//
+// A fake NV2A : registers in a map, and a log of every access
+//
+
+struct DeviceAccess
+{
+	xbaddr Address;
+	int Size;
+	bool bWrite;
+};
+
+static std::map<xbaddr, uint32_t> g_Registers;
+static std::vector<DeviceAccess> g_Accesses;
+
+static uint32_t SizeMask(int size)
+{
+	return (size >= 32) ? 0xFFFFFFFF : (1u << size) - 1;
+}
+
+uint32_t EmuNV2A_Read(xbaddr addr, int size)
+{
+	// EmuX86 must split accesses that cross a register
+	TEST_CHECK((addr & 3) * 8 + size <= 32);
+
+	g_Accesses.push_back({ addr, size, false });
+	return (g_Registers[addr & ~3] >> ((addr & 3) * 8)) & SizeMask(size);
+}
+
+void EmuNV2A_Write(xbaddr addr, uint32_t value, int size)
+{
+	TEST_CHECK((addr & 3) * 8 + size <= 32);
+
+	g_Accesses.push_back({ addr, size, true });
+	int shift = (addr & 3) * 8;
+	uint32_t mask = SizeMask(size) << shift;
+	g_Registers[addr & ~3] = (g_Registers[addr & ~3] & ~mask) | ((value << shift) & mask);
+}
+
+//
+// A fake distorm : EmuX86_DecodeException gets g_FakeInstruction
+//
+
+static _DInst g_FakeInstruction;
+static int g_FakeDecodes = 0;
+
+extern "C" _DecodeResult distorm_decompose64(_CodeInfo* ci, _DInst result[], unsigned int maxInstructions, unsigned int* usedInstructionsCount)
+{
+	g_FakeDecodes++;
+	result[0] = g_FakeInstruction;
+	*usedInstructionsCount = 1;
+	return DECRES_SUCCESS;
+}
+
+extern "C" unsigned int distorm_version()
+{
+	return 0;
+}
+
+//
+// Everything EmuX86 addresses must lie below 4 GB (and code within the Xbe range),
+// as xbaddr is 32 bits wide. This keeps it all in memory mapped at a low address,
+// followed by a page that is guaranteed to be unmapped.
+//
+
+#define LOW_MEMORY_ADDRESS 0x01000000
+#define LOW_MEMORY_SIZE    0x10000
+#define UNMAPPED_ADDRESS   (LOW_MEMORY_ADDRESS + LOW_MEMORY_SIZE)
+
+struct LowMemory
+{
+	CONTEXT Context;
+	EXCEPTION_POINTERS Pointers;
+	_DInst Info;
+	uint8_t Code[16];
+	uint8_t Ram[0x1000];
+};
+
+#define NV2A_REGISTER (NV2A_ADDR + 0x400100) // where the tests put their operands
+
+static LowMemory *Setup()
+{
+	static LowMemory *pLow = nullptr;
+
+	if (pLow == nullptr) {
+		void *pMemory = mmap((void *)LOW_MEMORY_ADDRESS, LOW_MEMORY_SIZE + 0x1000, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+		if (pMemory != (void *)LOW_MEMORY_ADDRESS) {
+			printf("Could not map memory at 0x%08X\n", LOW_MEMORY_ADDRESS);
+			exit(1);
+		}
+
+		munmap((void *)UNMAPPED_ADDRESS, 0x1000);
+		pLow = (LowMemory *)pMemory;
+		EmuX86_Init();
+	}
+
+	memset(pLow, 0, sizeof(*pLow));
+	pLow->Pointers.ContextRecord = &pLow->Context;
+	pLow->Context.EFlags = 1 << EMUX86_EFLAG_IF;
+	g_Registers.clear();
+	g_Accesses.clear();
+	g_Warnings = 0;
+	return pLow;
+}
+
+static void SetOperand(_DInst &Info, int Operand, uint8_t Type, uint8_t Index, uint16_t Size)
+{
+	Info.ops[Operand].type = Type;
+	Info.ops[Operand].index = Index;
+	Info.ops[Operand].size = Size;
+}
+
+// Names the table case that the failed checks above it belong to
+static void ReportCase(int FailuresBefore, const char *szName)
+{
+	if (g_HostTestFailures != FailuresBefore)
+		printf("  in case \"%s\"\n", szName);
+}
+
+static uint8_t RegisterOfSize(uint8_t Register32, int Size)
+{
+	static const uint8_t Registers[][3] = {
+		{ R_EAX, R_AX, R_AL },
+		{ R_ECX, R_CX, R_CL },
+		{ R_EDX, R_DX, R_DL },
+	};
+
+	for (auto &Sizes : Registers)
+		if (Sizes[0] == Register32)
+			return (Size == 32) ? Sizes[0] : (Size == 16) ? Sizes[1] : Sizes[2];
+
+	return R_NONE;
+}
+
+#define FLAG(f) (1u << EMUX86_EFLAG_##f)
+#define RESULT_FLAGS (FLAG(CF) | FLAG(PF) | FLAG(ZF) | FLAG(SF) | FLAG(OF))
+
+//
+// Arithmetic and logic on a device register : op [edx+offset], ecx/imm
+//
+
+struct AluCase
+{
+	const char *szName;
+	OpcodeHandler Handler;
+	int Size;
+	int Offset;         // of the operand within the register
+	uint32_t Dest;
+	uint32_t Src;
+	int ImmediateSize;  // 0 : the source is ECX, CX or CL
+	uint32_t Expected;
+	bool bWrites;
+	uint32_t Flags;     // expected CF, PF, ZF, SF and OF
+};
+
+static const AluCase AluCases[] = {
+	{ "AND r/m32, imm8",  EmuX86_Opcode_AND, 32, 0, 0x12345678, 0xF0, 8, 0x12345670, true, 0 },
+	{ "AND r/m8, r8",     EmuX86_Opcode_AND, 8,  2, 0x0F,       0xF0, 0, 0x00,       true, FLAG(ZF) | FLAG(PF) },
+	{ "OR r/m16, r16",    EmuX86_Opcode_OR,  16, 2, 0x0F00,     0x00F0, 0, 0x0FF0,   true, FLAG(PF) },
+	{ "OR r/m32, imm32",  EmuX86_Opcode_OR,  32, 0, 0x80000000, 1,    32, 0x80000001, true, FLAG(SF) },
+	{ "XOR r/m8, r8",     EmuX86_Opcode_XOR, 8,  3, 0xAA,       0xAA, 0, 0x00,       true, FLAG(ZF) | FLAG(PF) },
+	{ "XOR r/m32, r32",   EmuX86_Opcode_XOR, 32, 0, 0xFFFF0000, 0x0000FFFF, 0, 0xFFFFFFFF, true, FLAG(SF) | FLAG(PF) },
+	{ "SUB r/m32, r32",   EmuX86_Opcode_SUB, 32, 0, 0,          1,    0, 0xFFFFFFFF, true, FLAG(CF) | FLAG(SF) | FLAG(PF) },
+	{ "SUB r/m16, imm8",  EmuX86_Opcode_SUB, 16, 0, 0x8000,     1,    8, 0x7FFF,     true, FLAG(OF) | FLAG(PF) },
+	{ "SUB r/m8, imm8",   EmuX86_Opcode_SUB, 8,  1, 5,          5,    8, 0,          true, FLAG(ZF) | FLAG(PF) },
+	{ "CMP r/m32, r32",   EmuX86_Opcode_CMP, 32, 0, 5,          7,    0, 5,          false, FLAG(CF) | FLAG(SF) },
+	{ "CMP r/m8, r8",     EmuX86_Opcode_CMP, 8,  1, 0x80,       1,    0, 0x80,       false, FLAG(OF) },
+	{ "CMP r/m32, imm8",  EmuX86_Opcode_CMP, 32, 0, 0xFFFFFFFF, 0xFF, 8, 0xFFFFFFFF, false, FLAG(ZF) | FLAG(PF) },
+};
+
+TEST_CASE(EmuX86_ArithmeticAndLogicOnDeviceRegisters)
+{
+	for (const AluCase &Case : AluCases) {
+		int FailuresBefore = g_HostTestFailures;
+		LowMemory *pLow = Setup();
+		CONTEXT &Context = pLow->Context;
+		_DInst &Info = pLow->Info;
+
+		uint32_t Mask = SizeMask(Case.Size) << (Case.Offset * 8);
+		g_Registers[NV2A_REGISTER - NV2A_ADDR] = (0xDEADBEEF & ~Mask) | ((Case.Dest << (Case.Offset * 8)) & Mask);
+
+		// Start with the opposite of the expected flags, so both setting and clearing are checked
+		Context.EFlags |= ~Case.Flags & RESULT_FLAGS;
+
+		Context.Edx = NV2A_REGISTER + Case.Offset;
+		SetOperand(Info, 0, O_SMEM, R_EDX, Case.Size);
+		if (Case.ImmediateSize != 0) {
+			SetOperand(Info, 1, O_IMM, 0, Case.ImmediateSize);
+			Info.imm.qword = Case.Src;
+		} else {
+			Context.Ecx = Case.Src;
+			SetOperand(Info, 1, O_REG, RegisterOfSize(R_ECX, Case.Size), Case.Size);
+		}
+
+		bool bHandled = Case.Handler(&pLow->Pointers, Info);
+		uint32_t Register = g_Registers[NV2A_REGISTER - NV2A_ADDR];
+
+		TEST_CHECK(bHandled);
+		TEST_CHECK_EQUAL((Register & Mask) >> (Case.Offset * 8), Case.Expected);
+		TEST_CHECK_EQUAL(Register & ~Mask, 0xDEADBEEF & ~Mask);
+		TEST_CHECK_EQUAL(Context.EFlags & RESULT_FLAGS, Case.Flags);
+		TEST_CHECK(Context.EFlags & FLAG(IF));
+
+		// One access of the operand size each way, even for narrow operands
+		TEST_CHECK_EQUAL(g_Accesses.size(), Case.bWrites ? 2 : 1);
+		for (const DeviceAccess &Access : g_Accesses) {
+			TEST_CHECK_EQUAL(Access.Address, NV2A_REGISTER - NV2A_ADDR + Case.Offset);
+			TEST_CHECK_EQUAL(Access.Size, Case.Size);
+		}
+		ReportCase(FailuresBefore, Case.szName);
+	}
+}
+
+//
+// The flag helpers, on their own
+//
+
+struct FlagCase
+{
+	const char *szName;
+	int Kind;           // 0 : logic, 1 : add, 2 : sub
+	int Size;
+	uint32_t Dest, Src; // result = dest op src
+	uint32_t Flags;     // expected CF, PF, ZF, SF and OF (AF where noted)
+};
+
+static const FlagCase FlagCases[] = {
+	{ "logic 32, zero",                 0, 32, 0, 0, FLAG(ZF) | FLAG(PF) },
+	{ "logic 8, only low bits count",   0, 8,  0xFFFFFF80, 0, FLAG(SF) },
+	{ "logic 16, odd parity",           0, 16, 0x0107, 0, 0 },
+	{ "add 32, carry out",              1, 32, 0xFFFFFFFF, 1, FLAG(CF) | FLAG(ZF) | FLAG(PF) | FLAG(AF) },
+	{ "add 8, signed overflow",         1, 8,  0x7F, 1, FLAG(OF) | FLAG(SF) | FLAG(AF) },
+	{ "add 16, no carry into bit 16",   1, 16, 0x7FFF, 0x7FFF, FLAG(OF) | FLAG(SF) | FLAG(AF) },
+	{ "sub 32, borrow",                 2, 32, 1, 2, FLAG(CF) | FLAG(SF) | FLAG(PF) | FLAG(AF) },
+	{ "sub 8, signed overflow",         2, 8,  0x80, 1, FLAG(OF) | FLAG(AF) },
+	{ "sub 16, equal",                  2, 16, 0x1234, 0x1234, FLAG(ZF) | FLAG(PF) },
+};
+
+TEST_CASE(EmuX86_FlagHelpers)
+{
+	for (const FlagCase &Case : FlagCases) {
+		int FailuresBefore = g_HostTestFailures;
+		LowMemory *pLow = Setup();
+		const uint32_t Flags = RESULT_FLAGS | FLAG(AF);
+
+		pLow->Context.EFlags |= ~Case.Flags & Flags;
+
+		switch (Case.Kind) {
+		case 0:
+			// logic flags leave AF alone
+			pLow->Context.EFlags = (pLow->Context.EFlags & ~FLAG(AF)) | (Case.Flags & FLAG(AF));
+			EmuX86_SetLogicFlags(&pLow->Pointers, Case.Dest, Case.Size);
+			break;
+		case 1:
+			EmuX86_SetAddFlags(&pLow->Pointers, Case.Dest, Case.Src, Case.Dest + Case.Src, Case.Size);
+			break;
+		default:
+			EmuX86_SetSubFlags(&pLow->Pointers, Case.Dest, Case.Src, Case.Dest - Case.Src, Case.Size);
+			break;
+		}
+
+		TEST_CHECK_EQUAL(pLow->Context.EFlags & Flags, Case.Flags);
+		ReportCase(FailuresBefore, Case.szName);
+	}
+}
+
+//
+// MOVSX from a device register
+//
+
+struct MovsxCase
+{
+	int SrcSize;
+	int Offset;
+	int DestSize;
+	uint32_t Expected; // EAX, which starts out as 0x12345678
+};
+
+TEST_CASE(EmuX86_MovsxFromDeviceRegisters)
+{
+	static const MovsxCase Cases[] = {
+		{ 8,  1, 32, 0xFFFFFF80 },  // byte 1 of 0x0000807F is 0x80
+		{ 8,  0, 32, 0x0000007F },
+		{ 16, 1, 32, 0x00000180 },
+		{ 16, 2, 32, 0xFFFF8001 },  // the upper half of 0x8001807F
+		{ 8,  1, 16, 0x1234FF80 },
+	};
+
+	for (const MovsxCase &Case : Cases) {
+		LowMemory *pLow = Setup();
+
+		g_Registers[NV2A_REGISTER - NV2A_ADDR] = 0x8001807F;
+		pLow->Context.Eax = 0x12345678;
+		pLow->Context.Edx = NV2A_REGISTER + Case.Offset;
+		SetOperand(pLow->Info, 0, O_REG, RegisterOfSize(R_EAX, Case.DestSize), Case.DestSize);
+		SetOperand(pLow->Info, 1, O_SMEM, R_EDX, Case.SrcSize);
+
+		TEST_CHECK(EmuX86_Opcode_MOVSX(&pLow->Pointers, pLow->Info));
+		TEST_CHECK_EQUAL(pLow->Context.Eax, Case.Expected);
+		TEST_CHECK_EQUAL(g_Accesses.size(), 1);
+		TEST_CHECK_EQUAL(g_Accesses[0].Size, Case.SrcSize);
+	}
+}
+
+//
+// IN (no I/O devices are emulated, so every port reads as zero)
+//
+
+TEST_CASE(EmuX86_InWritesTheOperandSize)
+{
+	static const struct { int Size; bool bImmediatePort; uint32_t Expected; } Cases[] = {
+		{ 8,  false, 0xFFFFFF00 },
+		{ 16, false, 0xFFFF0000 },
+		{ 32, true,  0x00000000 },
+	};
+
+	for (auto &Case : Cases) {
+		LowMemory *pLow = Setup();
+
+		pLow->Context.Eax = 0xFFFFFFFF;
+		SetOperand(pLow->Info, 0, O_REG, RegisterOfSize(R_EAX, Case.Size), Case.Size);
+		if (Case.bImmediatePort) {
+			SetOperand(pLow->Info, 1, O_IMM, 0, 8);
+			pLow->Info.imm.qword = 0xC0;
+		} else {
+			pLow->Context.Edx = 0x80C0;
+			SetOperand(pLow->Info, 1, O_REG, R_DX, 16);
+		}
+
+		TEST_CHECK(EmuX86_Opcode_IN(&pLow->Pointers, pLow->Info));
+		TEST_CHECK_EQUAL(pLow->Context.Eax, Case.Expected);
+		TEST_CHECK_EQUAL(g_Warnings, 1); // not implemented
+	}
+}
+
+//
+// String instructions between device registers and memory
+//
+
+struct StringCase
+{
+	const char *szName;
+	int Size;
+	bool bRep;
+	bool bDown;
+	uint32_t Count;     // ECX
+	bool bFromDevice;   // MOVS : which side the device is on
+	int Offset;         // of the device address within its register
+};
+
+static const StringCase MovsCases[] = {
+	{ "REP MOVSD device to memory",        32, true,  false, 4, true,  0 },
+	{ "REP MOVSW memory to device, down",  16, true,  true,  2, false, 2 },
+	{ "MOVSB memory to device",            8,  false, false, 9, false, 3 },
+	{ "REP MOVSB device to memory, none",  8,  true,  false, 0, true,  0 },
+};
+
+TEST_CASE(EmuX86_Movs)
+{
+	for (const StringCase &Case : MovsCases) {
+		int FailuresBefore = g_HostTestFailures;
+		LowMemory *pLow = Setup();
+		CONTEXT &Context = pLow->Context;
+		int Step = Case.Size / 8;
+		uint32_t Elements = Case.bRep ? Case.Count : 1;
+
+		for (uint32_t i = 0; i < 4; i++)
+			g_Registers[NV2A_REGISTER - NV2A_ADDR + i * 4] = 0x10203040 + i * 0x01010101;
+		for (uint32_t i = 0; i < sizeof(pLow->Ram); i++)
+			pLow->Ram[i] = (uint8_t)(i * 3);
+
+		// The instruction starts at the highest address when going down
+		xbaddr Device = NV2A_REGISTER + Case.Offset + (Case.bDown ? (Elements - 1) * Step : 0);
+		xbaddr Memory = (xbaddr)(uintptr_t)&pLow->Ram[0x100] + (Case.bDown ? (Elements - 1) * Step : 0);
+
+		Context.Esi = Case.bFromDevice ? Device : Memory;
+		Context.Edi = Case.bFromDevice ? Memory : Device;
+		Context.Ecx = Case.Count;
+		if (Case.bDown)
+			Context.EFlags |= FLAG(DF);
+		pLow->Info.flags = Case.bRep ? FLAG_REP : 0;
+		SetOperand(pLow->Info, 0, O_SMEM, R_EDI, Case.Size);
+		SetOperand(pLow->Info, 1, O_SMEM, R_ESI, Case.Size);
+
+		// What a real MOVS would do, computed on copies
+		std::map<xbaddr, uint32_t> ExpectedRegisters = g_Registers;
+		std::vector<uint8_t> ExpectedRam(pLow->Ram, pLow->Ram + sizeof(pLow->Ram));
+		uint32_t DeviceStart = Device - (Case.bDown ? (Elements - 1) * Step : 0) - NV2A_ADDR;
+		uint32_t MemoryStart = Memory - (Case.bDown ? (Elements - 1) * Step : 0) - (xbaddr)(uintptr_t)pLow->Ram;
+		for (uint32_t b = 0; b < Elements * Step; b++) {
+			uint32_t Address = DeviceStart + b;
+			uint32_t Shift = (Address & 3) * 8;
+			if (Case.bFromDevice) {
+				ExpectedRam[MemoryStart + b] = (uint8_t)(ExpectedRegisters[Address & ~3] >> Shift);
+			} else {
+				ExpectedRegisters[Address & ~3] = (ExpectedRegisters[Address & ~3] & ~(0xFFu << Shift)) | ((uint32_t)ExpectedRam[MemoryStart + b] << Shift);
+			}
+		}
+
+		TEST_CHECK(EmuX86_Opcode_MOVS(&pLow->Pointers, pLow->Info));
+		TEST_CHECK(g_Registers == ExpectedRegisters);
+		TEST_CHECK_MEMORY(pLow->Ram, ExpectedRam.data(), sizeof(pLow->Ram));
+		TEST_CHECK_EQUAL(g_Accesses.size(), Elements);
+
+		int Delta = (Case.bDown ? -Step : Step) * (int)Elements;
+		TEST_CHECK_EQUAL(Context.Esi, (Case.bFromDevice ? Device : Memory) + Delta);
+		TEST_CHECK_EQUAL(Context.Edi, (Case.bFromDevice ? Memory : Device) + Delta);
+		TEST_CHECK_EQUAL(Context.Ecx, Case.bRep ? 0 : Case.Count);
+		ReportCase(FailuresBefore, Case.szName);
+	}
+}
+
+TEST_CASE(EmuX86_MovsRefusesUnmappedMemory)
+{
+	LowMemory *pLow = Setup();
+
+	// The last dword runs into the unmapped page
+	pLow->Context.Esi = NV2A_REGISTER;
+	pLow->Context.Edi = UNMAPPED_ADDRESS - 12;
+	pLow->Context.Ecx = 4;
+	pLow->Info.flags = FLAG_REP;
+	SetOperand(pLow->Info, 0, O_SMEM, R_EDI, 32);
+	SetOperand(pLow->Info, 1, O_SMEM, R_ESI, 32);
+
+	TEST_CHECK(!EmuX86_Opcode_MOVS(&pLow->Pointers, pLow->Info));
+	TEST_CHECK_EQUAL(g_Accesses.size(), 0);
+	TEST_CHECK_EQUAL(pLow->Context.Ecx, 4);
+
+	// A device range that runs past the end of the NV2A
+	pLow->Context.Esi = NV2A_ADDR + NV2A_SIZE - 8;
+	pLow->Context.Edi = (xbaddr)(uintptr_t)pLow->Ram;
+	TEST_CHECK(!EmuX86_Opcode_MOVS(&pLow->Pointers, pLow->Info));
+}
+
+static const StringCase StosCases[] = {
+	{ "REP STOSD to device",          32, true,  false, 3, false, 0 },
+	{ "STOSB to device",              8,  false, false, 7, false, 1 },
+	{ "REP STOSW to device, down",    16, true,  true,  3, false, 2 },
+};
+
+TEST_CASE(EmuX86_StosToDeviceRegisters)
+{
+	for (const StringCase &Case : StosCases) {
+		int FailuresBefore = g_HostTestFailures;
+		LowMemory *pLow = Setup();
+		int Step = Case.Size / 8;
+		uint32_t Elements = Case.bRep ? Case.Count : 1;
+		xbaddr Device = NV2A_REGISTER + Case.Offset + (Case.bDown ? (Elements - 1) * Step : 0);
+
+		for (uint32_t i = 0; i < 4; i++)
+			g_Registers[NV2A_REGISTER - NV2A_ADDR + i * 4] = 0xDEADBEEF;
+
+		pLow->Context.Eax = 0x5A6B7C8D;
+		pLow->Context.Edi = Device;
+		pLow->Context.Ecx = Case.Count;
+		if (Case.bDown)
+			pLow->Context.EFlags |= FLAG(DF);
+		pLow->Info.flags = Case.bRep ? FLAG_REP : 0;
+		SetOperand(pLow->Info, 0, O_SMEM, R_EDI, Case.Size);
+		SetOperand(pLow->Info, 1, O_REG, RegisterOfSize(R_EAX, Case.Size), Case.Size);
+
+		std::map<xbaddr, uint32_t> Expected = g_Registers;
+		uint32_t Start = Device - (Case.bDown ? (Elements - 1) * Step : 0) - NV2A_ADDR;
+		for (uint32_t b = 0; b < Elements * Step; b++) {
+			uint32_t Address = Start + b;
+			uint32_t Shift = (Address & 3) * 8;
+			uint32_t Byte = (0x5A6B7C8D >> ((b % Step) * 8)) & 0xFF;
+			Expected[Address & ~3] = (Expected[Address & ~3] & ~(0xFFu << Shift)) | (Byte << Shift);
+		}
+
+		TEST_CHECK(EmuX86_Opcode_STOS(&pLow->Pointers, pLow->Info));
+		TEST_CHECK(g_Registers == Expected);
+		TEST_CHECK_EQUAL(g_Accesses.size(), Elements);
+		TEST_CHECK_EQUAL(g_Accesses[0].Size, Case.Size);
+		TEST_CHECK_EQUAL(pLow->Context.Edi, Device + (Case.bDown ? -Step : Step) * (int)Elements);
+		TEST_CHECK_EQUAL(pLow->Context.Ecx, Case.bRep ? 0 : Case.Count);
+		ReportCase(FailuresBefore, Case.szName);
+	}
+}
+
+//
+// Narrow and unaligned device accesses
+//
+
+struct MmioCase
+{
+	int Offset;             // from a register boundary
+	int Size;
+	uint32_t ReadValue;     // registers hold 0x11223344, 0x55667788
+	DeviceAccess Accesses[2];
+};
+
+TEST_CASE(EmuX86_NarrowAndSplitDeviceAccesses)
+{
+	static const MmioCase Cases[] = {
+		{ 0, 32, 0x11223344, { { 0, 32 } } },
+		{ 2, 16, 0x1122,     { { 2, 16 } } },
+		{ 3, 8,  0x11,       { { 3, 8 } } },
+		{ 1, 32, 0x88112233, { { 1, 24 }, { 4, 8 } } },
+		{ 3, 32, 0x66778811, { { 3, 8 }, { 4, 24 } } },
+		{ 3, 16, 0x8811,     { { 3, 8 }, { 4, 8 } } },
+	};
+
+	for (const MmioCase &Case : Cases) {
+		Setup();
+		xbaddr Base = NV2A_REGISTER - NV2A_ADDR;
+		size_t AccessCount = (Case.Accesses[1].Size != 0) ? 2 : 1;
+
+		g_Registers[Base] = 0x11223344;
+		g_Registers[Base + 4] = 0x55667788;
+		TEST_CHECK_EQUAL(EmuX86_Read(NV2A_REGISTER + Case.Offset, Case.Size), Case.ReadValue);
+		TEST_CHECK_EQUAL(g_Accesses.size(), AccessCount);
+
+		// Writing back what was read changes nothing
+		EmuX86_Write(NV2A_REGISTER + Case.Offset, Case.ReadValue, Case.Size);
+		TEST_CHECK_EQUAL(g_Registers[Base], 0x11223344);
+		TEST_CHECK_EQUAL(g_Registers[Base + 4], 0x55667788);
+
+		TEST_CHECK_EQUAL(g_Accesses.size(), AccessCount * 2);
+		for (size_t i = 0; i < g_Accesses.size(); i++) {
+			const DeviceAccess &Expected = Case.Accesses[i % AccessCount];
+			TEST_CHECK_EQUAL(g_Accesses[i].Address, Base + Expected.Address);
+			TEST_CHECK_EQUAL(g_Accesses[i].Size, Expected.Size);
+			TEST_CHECK_EQUAL(g_Accesses[i].bWrite, i >= AccessCount);
+		}
+	}
+
+	// A split write puts each part in its own register
+	Setup();
+	EmuX86_Write(NV2A_REGISTER + 1, 0xA1B2C3D4, 32);
+	TEST_CHECK_EQUAL(g_Registers[NV2A_REGISTER - NV2A_ADDR], 0xB2C3D400);
+	TEST_CHECK_EQUAL(g_Registers[NV2A_REGISTER - NV2A_ADDR + 4], 0x000000A1);
+}
+
+//
+// The fault path : decoding, the decoded instruction cache and skipping the instruction
+//
+
+TEST_CASE(EmuX86_DecodeExceptionCachesDecodedInstructions)
+{
+	LowMemory *pLow = Setup();
+
+	// mov [edx], eax (89 02)
+	memset(&g_FakeInstruction, 0, sizeof(g_FakeInstruction));
+	g_FakeInstruction.opcode = I_MOV;
+	g_FakeInstruction.size = 2;
+	SetOperand(g_FakeInstruction, 0, O_SMEM, R_EDX, 32);
+	SetOperand(g_FakeInstruction, 1, O_REG, R_EAX, 32);
+	pLow->Code[0] = 0x89;
+	pLow->Code[1] = 0x02;
+
+	xbaddr Eip = (xbaddr)(uintptr_t)pLow->Code;
+	EmuX86_InvalidateDecodeCache(Eip, sizeof(pLow->Code)); // from earlier runs
+	g_FakeDecodes = 0;
+
+	for (int i = 0; i < 3; i++) {
+		pLow->Context.Eip = Eip;
+		pLow->Context.Eax = 0x100 + i;
+		pLow->Context.Edx = NV2A_REGISTER;
+		TEST_CHECK(EmuX86_DecodeException(&pLow->Pointers));
+		TEST_CHECK_EQUAL(pLow->Context.Eip, Eip + 2);
+		TEST_CHECK_EQUAL(g_Registers[NV2A_REGISTER - NV2A_ADDR], 0x100 + i);
+	}
+	TEST_CHECK_EQUAL(g_FakeDecodes, 1);
+
+	// Changed code is decoded again
+	pLow->Code[1] = 0x0A;
+	pLow->Context.Eip = Eip;
+	pLow->Context.Ecx = 0;
+	TEST_CHECK(EmuX86_DecodeException(&pLow->Pointers));
+	TEST_CHECK_EQUAL(g_FakeDecodes, 2);
+
+	// As is invalidated code
+	EmuX86_InvalidateDecodeCache(Eip + 1, 1);
+	pLow->Context.Eip = Eip;
+	TEST_CHECK(EmuX86_DecodeException(&pLow->Pointers));
+	TEST_CHECK_EQUAL(g_FakeDecodes, 3);
+
+	// Unimplemented instructions are skipped, but not handled
+	g_FakeInstruction.opcode = I_PUSH;
+	EmuX86_InvalidateDecodeCache(Eip, 1);
+	pLow->Context.Eip = Eip;
+	TEST_CHECK(!EmuX86_DecodeException(&pLow->Pointers));
+	TEST_CHECK_EQUAL(pLow->Context.Eip, Eip + 2);
+
+	// Code outside the Xbe isn't decoded
+	pLow->Context.Eip = XBE_MAX_VA + 0x1000;
+	TEST_CHECK(!EmuX86_DecodeException(&pLow->Pointers));
+	TEST_CHECK_EQUAL(g_FakeDecodes, 4);
+}
@@ -0,0 +1,109 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->FilePathPrefixCacheBenchmark.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "HostBenchmark.h"
+#include "FilePathPrefixCacheReference.h"
+#include "CxbxKrnl/FilePathPrefixCache.h"
+
+#include <string>
+#include <vector>
+
+BENCHMARK_MAIN_GLOBALS
+
+// The links CxbxKrnlMain creates, and those of a title with a few save game folders
+static ReferenceLink *g_Links[26];
+
+static void FillFromLinks(FilePathPrefixCache &Cache)
+{
+	for (char DriveLetter = 'A'; DriveLetter <= 'Z'; DriveLetter++) {
+		ReferenceLink *pLink = g_Links[DriveLetter - 'A'];
+		if (pLink != nullptr) {
+			Cache.AddDrive(DriveLetter, pLink, pLink->RootDirectoryHandle);
+			Cache.AddDevice(pLink->XboxSymbolicLinkPath, pLink, pLink->RootDirectoryHandle);
+		}
+	}
+}
+
+static void Link(char DriveLetter, const char *szXboxPath)
+{
+	g_Links[DriveLetter - 'A'] = new ReferenceLink{ szXboxPath, (HANDLE)(uintptr_t)(0x1000 + DriveLetter * 4) };
+}
+
+int main(int argc, char *argv[])
+{
+	BenchmarkInit(argc, argv);
+
+	Link('C', "\\Device\\Harddisk0\\Partition2");
+	Link('E', "\\Device\\Harddisk0\\Partition1");
+	Link('T', "\\Device\\Harddisk0\\Partition1\\TDATA\\4d530017");
+	Link('U', "\\Device\\Harddisk0\\Partition1\\UDATA\\4d530017");
+	Link('X', "\\Device\\Harddisk0\\Partition3");
+	Link('Y', "\\Device\\Harddisk0\\Partition4");
+	Link('Z', "\\Device\\Harddisk0\\Partition6");
+
+	static FilePathPrefixCache Cache(FillFromLinks);
+
+	// Titles mostly use drive letters; the kernel and the dashboard use device paths,
+	// of which the ones on a late drive letter (Z:) take the scan the longest
+	const std::vector<std::string> Paths = {
+		"D:\\media\\level1.xpr",
+		"\\??\\T:\\settings.dat",
+		"\\Device\\Harddisk0\\Partition2\\xboxdash.xbe",
+		"\\Device\\Harddisk0\\Partition6\\cache\\level1.bin",
+		"\\Device\\CdRom0\\default.xbe",
+	};
+
+	for (const std::string &Path : Paths) {
+		// as _CxbxConvertFilePath gets it, with '\??\' trimmed off
+		std::string RelativePath = (Path.compare(0, 4, "\\??\\") == 0) ? Path.substr(4) : Path;
+		FILE_PATH_PREFIX Prefix;
+
+		BenchmarkRun(("FilePathPrefixCache::Lookup, " + Path).c_str(), 2000000, 1, [&](unsigned) {
+			BenchmarkKeep(Cache.Lookup(RelativePath, &Prefix) ? Prefix.Length : 0);
+		});
+		BenchmarkRun(("Drive letter scan (before), " + Path).c_str(), 2000000, 1, [&](unsigned) {
+			BenchmarkKeep(ReferenceResolvePrefix(g_Links, RelativePath, &Prefix) ? Prefix.Length : 0);
+		});
+	}
+
+	// A lookup right after a symbolic link was created or deleted refills the trie
+	BenchmarkRun("FilePathPrefixCache::Invalidate and Lookup", 200000, 1, [&](unsigned) {
+		FILE_PATH_PREFIX Prefix;
+		Cache.Invalidate();
+		BenchmarkKeep(Cache.Lookup("\\Device\\Harddisk0\\Partition6\\file", &Prefix));
+	});
+
+	Cache.DumpStatistics();
+
+	return 0;
+}
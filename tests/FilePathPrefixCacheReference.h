@@ -0,0 +1,101 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->FilePathPrefixCacheReference.h
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef FILEPATHPREFIXCACHEREFERENCE_H
+#define FILEPATHPREFIXCACHEREFERENCE_H
+
+// How _CxbxConvertFilePath resolved path prefixes before CxbxKrnl/FilePathPrefixCache.cpp,
+// kept as the reference it is tested and measured against : a drive letter indexes the
+// table of symbolic links, and a device path scans that table in drive letter order for
+// the first link whose Xbox path it starts with (FindNtSymbolicLinkObjectByDevice).
+
+#include "CxbxKrnl/FilePathPrefixCache.h"
+
+#include <string>
+
+// Stands in for EmuNtSymbolicLinkObject
+struct ReferenceLink
+{
+	std::string XboxSymbolicLinkPath; // empty for links to host paths
+	HANDLE RootDirectoryHandle;
+};
+
+inline char ReferenceUpcase(char c)
+{
+	return ((c >= 'a') && (c <= 'z')) ? c - ('a' - 'A') : c;
+}
+
+// _strnicmp(Path, Prefix, Prefix.length()) == 0
+inline bool ReferenceStartsWithText(const std::string &Path, const std::string &Prefix)
+{
+	if (Path.length() < Prefix.length())
+		return false;
+
+	for (size_t i = 0; i < Prefix.length(); i++)
+		if (ReferenceUpcase(Path[i]) != ReferenceUpcase(Prefix[i]))
+			return false;
+
+	return true;
+}
+
+inline bool ReferenceResolvePrefix(ReferenceLink *const Links[26], const std::string &Path, FILE_PATH_PREFIX *pPrefix)
+{
+	ReferenceLink *pLink = nullptr;
+	size_t Length = 0;
+
+	if ((Path.length() >= 2) && (Path[1] == ':')) {
+		char DriveLetter = ReferenceUpcase(Path[0]);
+		if ((DriveLetter >= 'A') && (DriveLetter <= 'Z'))
+			pLink = Links[DriveLetter - 'A'];
+
+		Length = 2;
+	}
+	else {
+		for (int i = 0; i < 26; i++)
+			if ((Links[i] != nullptr) && ReferenceStartsWithText(Path, Links[i]->XboxSymbolicLinkPath)) {
+				pLink = Links[i];
+				Length = pLink->XboxSymbolicLinkPath.length();
+				break;
+			}
+	}
+
+	if (pLink == nullptr)
+		return false;
+
+	pPrefix->pLink = pLink;
+	pPrefix->RootDirectory = pLink->RootDirectoryHandle;
+	pPrefix->Length = Length;
+	return true;
+}
+
+#endif // FILEPATHPREFIXCACHEREFERENCE_H
@@ -0,0 +1,326 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->FilePathPrefixCacheTests.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "HostTest.h"
+#include "FilePathPrefixCacheReference.h"
+#include "CxbxKrnl/FilePathPrefixCache.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// The symbolic links the cache is filled from, like NtSymbolicLinkObjects in EmuFile.cpp
+static ReferenceLink *g_Links[26];
+static std::atomic<int> g_Fills(0);
+
+static void FillFromLinks(FilePathPrefixCache &Cache)
+{
+	g_Fills++;
+
+	for (char DriveLetter = 'A'; DriveLetter <= 'Z'; DriveLetter++) {
+		ReferenceLink *pLink = g_Links[DriveLetter - 'A'];
+		if (pLink != nullptr) {
+			Cache.AddDrive(DriveLetter, pLink, pLink->RootDirectoryHandle);
+			Cache.AddDevice(pLink->XboxSymbolicLinkPath, pLink, pLink->RootDirectoryHandle);
+		}
+	}
+}
+
+static HANDLE Root(uintptr_t Number)
+{
+	return (HANDLE)(0x1000 + Number * 4);
+}
+
+// As EmuNtSymbolicLinkObject::Init and its destructor do
+static ReferenceLink *CreateLink(FilePathPrefixCache &Cache, char DriveLetter, const char *szXboxPath, HANDLE RootDirectory)
+{
+	ReferenceLink *pLink = new ReferenceLink{ szXboxPath, RootDirectory };
+	g_Links[DriveLetter - 'A'] = pLink;
+	Cache.Invalidate();
+	return pLink;
+}
+
+static void DeleteLink(FilePathPrefixCache &Cache, char DriveLetter)
+{
+	ReferenceLink *pLink = g_Links[DriveLetter - 'A'];
+	g_Links[DriveLetter - 'A'] = nullptr;
+	Cache.Invalidate();
+	delete pLink;
+}
+
+static void DeleteAllLinks(FilePathPrefixCache &Cache)
+{
+	for (char DriveLetter = 'A'; DriveLetter <= 'Z'; DriveLetter++)
+		if (g_Links[DriveLetter - 'A'] != nullptr)
+			DeleteLink(Cache, DriveLetter);
+}
+
+// The partitions CxbxKrnlMain links, plus a save game folder of a title
+static void CreateKernelLinks(FilePathPrefixCache &Cache)
+{
+	CreateLink(Cache, 'C', "\\Device\\Harddisk0\\Partition2", Root(2));
+	CreateLink(Cache, 'E', "\\Device\\Harddisk0\\Partition1", Root(1));
+	CreateLink(Cache, 'T', "\\Device\\Harddisk0\\Partition1\\TDATA\\4d530017", Root(11));
+	CreateLink(Cache, 'X', "\\Device\\Harddisk0\\Partition3", Root(3));
+	CreateLink(Cache, 'Y', "\\Device\\Harddisk0\\Partition4", Root(4));
+	CreateLink(Cache, 'Z', "\\Device\\Harddisk0\\Partition6", Root(6));
+}
+
+struct PrefixCase
+{
+	const char *szPath;
+	char DriveLetter;   // of the link it must resolve to, 0 for none
+	size_t Length;
+};
+
+static void CheckCases(FilePathPrefixCache &Cache, const PrefixCase *pCases, size_t Count)
+{
+	for (size_t i = 0; i < Count; i++) {
+		const PrefixCase &Case = pCases[i];
+		int FailuresBefore = g_HostTestFailures;
+		FILE_PATH_PREFIX Prefix = {};
+
+		bool bFound = Cache.Lookup(Case.szPath, &Prefix);
+		TEST_CHECK_EQUAL(bFound, Case.DriveLetter != 0);
+		if (bFound && (Case.DriveLetter != 0)) {
+			ReferenceLink *pLink = g_Links[Case.DriveLetter - 'A'];
+			TEST_CHECK(Prefix.pLink == pLink);
+			TEST_CHECK(Prefix.RootDirectory == pLink->RootDirectoryHandle);
+			TEST_CHECK_EQUAL(Prefix.Length, Case.Length);
+		}
+
+		if (g_HostTestFailures != FailuresBefore)
+			printf("  in case \"%s\"\n", Case.szPath);
+	}
+}
+
+TEST_CASE(FilePathPrefixCache_ResolvesDriveLetters)
+{
+	FilePathPrefixCache Cache(FillFromLinks);
+	CreateKernelLinks(Cache);
+
+	const PrefixCase Cases[] = {
+		{ "C:\\xboxdash.xbe", 'C', 2 },
+		{ "c:\\xboxdash.xbe", 'C', 2 },
+		{ "T:", 'T', 2 },
+		{ "e::\\", 'E', 2 }, // the extra ':' is removed by the caller
+		{ "Q:\\not linked", 0, 0 },
+		{ "1:\\not a letter", 0, 0 },
+		// a drive letter only matches its own link, never a device path
+		{ "C:\\Device\\Harddisk0\\Partition2", 'C', 2 },
+	};
+	CheckCases(Cache, Cases, sizeof(Cases) / sizeof(Cases[0]));
+
+	DeleteAllLinks(Cache);
+}
+
+TEST_CASE(FilePathPrefixCache_ResolvesDevices)
+{
+	FilePathPrefixCache Cache(FillFromLinks);
+	CreateKernelLinks(Cache);
+
+	const PrefixCase Cases[] = {
+		{ "\\Device\\Harddisk0\\Partition2\\xboxdash.xbe", 'C', 28 },
+		{ "\\DEVICE\\harddisk0\\PARTITION2\\xboxdash.xbe", 'C', 28 },
+		{ "\\Device\\Harddisk0\\Partition6", 'Z', 28 },
+		// the scan took the first link in drive letter order, not the longest one
+		{ "\\Device\\Harddisk0\\Partition1\\TDATA\\4d530017\\save.dat", 'E', 28 },
+		// and matched on text, not on path components
+		{ "\\Device\\Harddisk0\\Partition10\\file", 'E', 28 },
+		{ "\\Device\\Harddisk0\\Partition", 0, 0 },
+		{ "\\Device\\Harddisk0\\Partition5\\file", 0, 0 },
+		{ "\\Device\\CdRom0\\default.xbe", 0, 0 },
+		{ "gamedata.dat", 0, 0 },
+		{ "", 0, 0 },
+	};
+	CheckCases(Cache, Cases, sizeof(Cases) / sizeof(Cases[0]));
+
+	// A link to a host path has no Xbox path, so it matches every device path
+	CreateLink(Cache, 'D', "", Root(100));
+	const PrefixCase HostCases[] = {
+		{ "\\Device\\Harddisk0\\Partition2\\xboxdash.xbe", 'C', 28 },
+		{ "\\Device\\Harddisk0\\Partition1\\file", 'D', 0 },
+		{ "\\Device\\CdRom0\\default.xbe", 'D', 0 },
+		{ "gamedata.dat", 'D', 0 },
+		{ "D:\\default.xbe", 'D', 2 },
+	};
+	CheckCases(Cache, HostCases, sizeof(HostCases) / sizeof(HostCases[0]));
+
+	DeleteAllLinks(Cache);
+}
+
+TEST_CASE(FilePathPrefixCache_MatchesReference)
+{
+	FilePathPrefixCache Cache(FillFromLinks);
+	CreateKernelLinks(Cache);
+	CreateLink(Cache, 'D', "", Root(100));
+	CreateLink(Cache, 'U', "\\Device\\Harddisk0\\Partition1\\UDATA\\4d530017", Root(12));
+	CreateLink(Cache, 'F', "\\Device\\Harddisk0\\Partition6", Root(16)); // the same device as Z
+
+	const char *Starts[] = {
+		"", "\\", "C:", "d:", "Z:", "q:", ":", "\\Device", "\\Device\\Harddisk0\\Partition",
+		"\\Device\\Harddisk0\\Partition1", "\\Device\\Harddisk0\\Partition2", "\\device\\harddisk0\\partition6",
+		"\\Device\\Harddisk0\\Partition1\\TDATA\\4d530017", "\\Device\\Harddisk0\\Partition1\\UDATA",
+		"\\Device\\CdRom0",
+	};
+	const char *Tails[] = { "", "\\", "1", "0\\file", "\\TDATA\\4d530017\\save", "\\udata\\4D530017", ":\\file" };
+
+	// Also with links removed, so the host path link (which matches anything) isn't always there
+	for (int Round = 0; Round < 3; Round++) {
+		if (Round == 1)
+			DeleteLink(Cache, 'D');
+		if (Round == 2)
+			DeleteLink(Cache, 'C');
+
+		for (const char *szStart : Starts)
+			for (const char *szTail : Tails) {
+				std::string Path = std::string(szStart) + szTail;
+				int FailuresBefore = g_HostTestFailures;
+				FILE_PATH_PREFIX Prefix = {}, Expected = {};
+
+				bool bFound = Cache.Lookup(Path, &Prefix);
+				TEST_CHECK_EQUAL(bFound, ReferenceResolvePrefix(g_Links, Path, &Expected));
+				TEST_CHECK(Prefix.pLink == Expected.pLink);
+				TEST_CHECK(Prefix.RootDirectory == Expected.RootDirectory);
+				TEST_CHECK_EQUAL(Prefix.Length, Expected.Length);
+
+				if (g_HostTestFailures != FailuresBefore)
+					printf("  in case \"%s\", round %d\n", Path.c_str(), Round);
+			}
+	}
+
+	DeleteAllLinks(Cache);
+}
+
+TEST_CASE(FilePathPrefixCache_InvalidatesOnLinkChanges)
+{
+	FilePathPrefixCache Cache(FillFromLinks);
+	FILE_PATH_PREFIX Prefix;
+	const char *szSavePath = "\\Device\\Harddisk0\\Partition1\\TDATA\\4d530017\\save.dat";
+
+	// Filled once, on the first lookup
+	int Fills = g_Fills;
+	CreateKernelLinks(Cache);
+	TEST_CHECK_EQUAL(g_Fills, Fills);
+	TEST_CHECK(Cache.Lookup("C:\\file", &Prefix));
+	TEST_CHECK(Cache.Lookup(szSavePath, &Prefix));
+	TEST_CHECK(Cache.Lookup("W:\\file", &Prefix) == false);
+	TEST_CHECK_EQUAL(g_Fills, Fills + 1);
+
+	// Creating a link is seen right away, by drive letter and by device
+	ReferenceLink *pW = CreateLink(Cache, 'W', "\\Device\\Harddisk0\\Partition5", Root(5));
+	TEST_CHECK(Cache.Lookup("W:\\file", &Prefix));
+	TEST_CHECK(Prefix.pLink == pW);
+	TEST_CHECK(Cache.Lookup("\\Device\\Harddisk0\\Partition5\\file", &Prefix));
+	TEST_CHECK(Prefix.pLink == pW);
+	TEST_CHECK(Prefix.RootDirectory == Root(5));
+	TEST_CHECK_EQUAL(g_Fills, Fills + 2);
+
+	// So is deleting one, after which an earlier link in drive letter order no longer hides
+	// a later one (like re-linking E: through CxbxCreateSymbolicLink, which deletes first)
+	DeleteLink(Cache, 'E');
+	TEST_CHECK(Cache.Lookup("E:\\file", &Prefix) == false);
+	TEST_CHECK(Cache.Lookup(szSavePath, &Prefix));
+	TEST_CHECK(Prefix.pLink == g_Links['T' - 'A']);
+	TEST_CHECK_EQUAL(Prefix.Length, strlen("\\Device\\Harddisk0\\Partition1\\TDATA\\4d530017"));
+	TEST_CHECK(Cache.Lookup("\\Device\\Harddisk0\\Partition1\\file", &Prefix) == false);
+
+	ReferenceLink *pE = CreateLink(Cache, 'E', "\\Device\\Harddisk0\\Partition1", Root(21));
+	TEST_CHECK(Cache.Lookup("E:\\file", &Prefix));
+	TEST_CHECK(Prefix.pLink == pE);
+	TEST_CHECK(Prefix.RootDirectory == Root(21));
+	TEST_CHECK(Cache.Lookup(szSavePath, &Prefix));
+	TEST_CHECK(Prefix.pLink == pE);
+
+	// Several changes in a row cost a single fill
+	Fills = g_Fills;
+	DeleteLink(Cache, 'W');
+	DeleteLink(Cache, 'X');
+	CreateLink(Cache, 'X', "\\Device\\Harddisk0\\Partition3", Root(33));
+	TEST_CHECK_EQUAL(g_Fills, Fills);
+	TEST_CHECK(Cache.Lookup("\\Device\\Harddisk0\\Partition5\\file", &Prefix) == false);
+	TEST_CHECK(Cache.Lookup("\\Device\\Harddisk0\\Partition3\\file", &Prefix));
+	TEST_CHECK(Prefix.RootDirectory == Root(33));
+	TEST_CHECK_EQUAL(g_Fills, Fills + 1);
+
+	// Without any links, nothing resolves
+	DeleteAllLinks(Cache);
+	TEST_CHECK(Cache.Lookup("C:\\file", &Prefix) == false);
+	TEST_CHECK(Cache.Lookup(szSavePath, &Prefix) == false);
+}
+
+TEST_CASE(FilePathPrefixCache_LookupsDuringLinkChanges)
+{
+	FilePathPrefixCache Cache(FillFromLinks);
+	CreateKernelLinks(Cache);
+	ReferenceLink *pC = g_Links['C' - 'A'];
+
+	// W: comes and goes, while other threads resolve C: and W: paths
+	const int Changes = 2000;
+	std::atomic<bool> bStop(false);
+	std::atomic<int> Failures(0);
+	std::vector<std::thread> Threads;
+
+	for (int t = 0; t < 3; t++)
+		Threads.emplace_back([&] {
+			FILE_PATH_PREFIX Prefix;
+			while (!bStop) {
+				if (!Cache.Lookup("\\Device\\Harddisk0\\Partition2\\file", &Prefix) || (Prefix.pLink != pC) || (Prefix.Length != 28))
+					Failures++;
+
+				// W: is either there (with its own root) or not
+				if (Cache.Lookup("W:\\file", &Prefix) && ((Prefix.RootDirectory != Root(5)) || (Prefix.Length != 2)))
+					Failures++;
+			}
+		});
+
+	std::vector<ReferenceLink *> Deleted;
+	for (int i = 0; i < Changes; i++) {
+		ReferenceLink *pW = new ReferenceLink{ "\\Device\\Harddisk0\\Partition5", Root(5) };
+		g_Links['W' - 'A'] = pW;
+		Cache.Invalidate();
+		g_Links['W' - 'A'] = nullptr;
+		Cache.Invalidate();
+		Deleted.push_back(pW); // freed once no lookup can be using it anymore
+	}
+
+	bStop = true;
+	for (std::thread &Thread : Threads)
+		Thread.join();
+
+	TEST_CHECK_EQUAL(Failures, 0);
+
+	for (ReferenceLink *pW : Deleted)
+		delete pW;
+	DeleteAllLinks(Cache);
+}
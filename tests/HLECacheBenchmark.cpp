@@ -0,0 +1,72 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->HLECacheBenchmark.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "HostBenchmark.h"
+#include "CxbxKrnl/HLECache.h"
+
+#include <string>
+
+BENCHMARK_MAIN_GLOBALS
+
+int main(int argc, char *argv[])
+{
+	BenchmarkInit(argc, argv);
+
+	// About as many symbols as a title linking most libraries gets
+	HLECacheInfo Info = { 0x11223344, 0x55667788, 5849, 0x4D530004, 1, "Benchmark" };
+	HLECacheSymbols Symbols;
+	for (uint32_t i = 0; i < 4000; i++)
+		Symbols.push_back(std::make_pair("D3DDevice_Symbol_" + std::to_string((i * 7919) % 4000), 0x10000 + i * 16));
+
+	std::vector<uint8_t> Image;
+	BenchmarkRun("HLECacheWrite, 4000 symbols (per symbol)", 200, 4000, [&](unsigned) {
+		HLECacheWrite(Info, Symbols, Image);
+	});
+
+	// A warm start : validate the mapped image, then read all symbols
+	BenchmarkRun("HLECacheValidate + HLECacheRead, 4000 symbols (per symbol)", 200, 4000, [&](unsigned) {
+		HLECacheInfo ReadInfo;
+		HLECacheSymbols ReadSymbols;
+		HLECacheRead(HLECacheValidate(Image.data(), Image.size()), ReadInfo, ReadSymbols);
+		BenchmarkKeep(ReadSymbols.size());
+	});
+
+	const HLECacheHeader *pHeader = HLECacheValidate(Image.data(), Image.size());
+	BenchmarkRun("HLECacheFind, 4000 symbols", 1000000, 1, [&](unsigned i) {
+		uint32_t Address = 0;
+		HLECacheFind(pHeader, Symbols[i % Symbols.size()].first.c_str(), Address);
+		BenchmarkKeep(Address);
+	});
+
+	return 0;
+}
@@ -0,0 +1,199 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->HLECacheTests.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "HostTest.h"
+#include "CxbxKrnl/HLECache.h"
+
+static HLECacheInfo MakeInfo()
+{
+	HLECacheInfo Info;
+	Info.DatabaseHash = 0x11223344;
+	Info.LibraryHash = 0x55667788;
+	Info.D3D8BuildVersion = 5849;
+	Info.TitleId = 0x4D530004;
+	Info.GameRegion = 1;
+	Info.TitleName = "Halo";
+	return Info;
+}
+
+static HLECacheSymbols MakeSymbols()
+{
+	HLECacheSymbols Symbols;
+	// Deliberately unsorted, and with a symbol that wasn't found (address zero)
+	Symbols.push_back(std::make_pair(std::string("XapiInitProcess"), 0x00012340u));
+	Symbols.push_back(std::make_pair(std::string("D3DDevice_SetRenderState_CullMode"), 0x00245670u));
+	Symbols.push_back(std::make_pair(std::string("CDirectSound_CreateSoundBuffer"), 0u));
+	Symbols.push_back(std::make_pair(std::string("D3DDevice_Clear"), 0x00200000u));
+	return Symbols;
+}
+
+TEST_CASE(HLECache_RoundTrip)
+{
+	std::vector<uint8_t> Image;
+	HLECacheWrite(MakeInfo(), MakeSymbols(), Image);
+
+	const HLECacheHeader *pHeader = HLECacheValidate(Image.data(), Image.size());
+	TEST_CHECK(pHeader != nullptr);
+	if (pHeader == nullptr)
+		return;
+
+	HLECacheInfo Info;
+	HLECacheSymbols Symbols;
+	HLECacheRead(pHeader, Info, Symbols);
+	TEST_CHECK_EQUAL(Info.DatabaseHash, 0x11223344);
+	TEST_CHECK_EQUAL(Info.LibraryHash, 0x55667788);
+	TEST_CHECK_EQUAL(Info.D3D8BuildVersion, 5849);
+	TEST_CHECK_EQUAL(Info.TitleId, 0x4D530004);
+	TEST_CHECK_EQUAL(Info.GameRegion, 1);
+	TEST_CHECK(Info.TitleName == "Halo");
+
+	// Symbols come back in name order
+	TEST_CHECK_EQUAL(Symbols.size(), 4);
+	if (Symbols.size() == 4) {
+		TEST_CHECK(Symbols[0].first == "CDirectSound_CreateSoundBuffer");
+		TEST_CHECK(Symbols[1].first == "D3DDevice_Clear");
+		TEST_CHECK(Symbols[2].first == "D3DDevice_SetRenderState_CullMode");
+		TEST_CHECK(Symbols[3].first == "XapiInitProcess");
+		TEST_CHECK_EQUAL(Symbols[0].second, 0);
+		TEST_CHECK_EQUAL(Symbols[3].second, 0x00012340);
+	}
+}
+
+TEST_CASE(HLECache_Find)
+{
+	std::vector<uint8_t> Image;
+	HLECacheWrite(MakeInfo(), MakeSymbols(), Image);
+	const HLECacheHeader *pHeader = HLECacheValidate(Image.data(), Image.size());
+	TEST_CHECK(pHeader != nullptr);
+	if (pHeader == nullptr)
+		return;
+
+	for (auto &Symbol : MakeSymbols()) {
+		uint32_t Address = 0xFFFFFFFF;
+		TEST_CHECK(HLECacheFind(pHeader, Symbol.first.c_str(), Address));
+		TEST_CHECK_EQUAL(Address, Symbol.second);
+	}
+
+	uint32_t Address = 0xCCCCCCCC;
+	TEST_CHECK(!HLECacheFind(pHeader, "D3DDevice", Address)); // a prefix of existing names
+	TEST_CHECK(!HLECacheFind(pHeader, "AAA", Address));
+	TEST_CHECK(!HLECacheFind(pHeader, "ZZZ", Address));
+	TEST_CHECK_EQUAL(Address, 0xCCCCCCCC);
+}
+
+TEST_CASE(HLECache_Empty)
+{
+	HLECacheInfo Info = MakeInfo();
+	Info.TitleName = "";
+
+	std::vector<uint8_t> Image;
+	HLECacheWrite(Info, HLECacheSymbols(), Image);
+	const HLECacheHeader *pHeader = HLECacheValidate(Image.data(), Image.size());
+	TEST_CHECK(pHeader != nullptr);
+	if (pHeader == nullptr)
+		return;
+
+	HLECacheSymbols Symbols;
+	HLECacheRead(pHeader, Info, Symbols);
+	TEST_CHECK(Symbols.empty());
+	TEST_CHECK(Info.TitleName.empty());
+
+	uint32_t Address;
+	TEST_CHECK(!HLECacheFind(pHeader, "D3DDevice_Clear", Address));
+}
+
+// Returns whether a valid image, damaged by Damage, still validates
+template<class F>
+static bool ValidatesAfter(F Damage)
+{
+	std::vector<uint8_t> Image;
+	HLECacheWrite(MakeInfo(), MakeSymbols(), Image);
+	Damage(Image);
+	return HLECacheValidate(Image.data(), Image.size()) != nullptr;
+}
+
+static HLECacheHeader *Header(std::vector<uint8_t> &Image)
+{
+	return (HLECacheHeader *)Image.data();
+}
+
+static HLECacheSymbol *Symbol(std::vector<uint8_t> &Image, int i)
+{
+	return (HLECacheSymbol *)(Image.data() + Header(Image)->SymbolTableOffset) + i;
+}
+
+TEST_CASE(HLECache_RejectsDamagedImages)
+{
+	TEST_CHECK(ValidatesAfter([](std::vector<uint8_t> &) {}));
+	TEST_CHECK(HLECacheValidate(nullptr, 0) == nullptr);
+	TEST_CHECK(HLECacheValidate("CXHC", 4) == nullptr);
+
+	TEST_CHECK(!ValidatesAfter([](std::vector<uint8_t> &Image) { Header(Image)->Magic ^= 1; }));
+	TEST_CHECK(!ValidatesAfter([](std::vector<uint8_t> &Image) { Header(Image)->FormatVersion++; }));
+	TEST_CHECK(!ValidatesAfter([](std::vector<uint8_t> &Image) { Image.pop_back(); }));
+	TEST_CHECK(!ValidatesAfter([](std::vector<uint8_t> &Image) { Image.push_back(0); }));
+	TEST_CHECK(!ValidatesAfter([](std::vector<uint8_t> &Image) { Header(Image)->SymbolCount = 0x10000000; }));
+	TEST_CHECK(!ValidatesAfter([](std::vector<uint8_t> &Image) { Header(Image)->SymbolTableOffset = 4; }));
+	TEST_CHECK(!ValidatesAfter([](std::vector<uint8_t> &Image) { Header(Image)->StringPoolOffset -= 4; }));
+	TEST_CHECK(!ValidatesAfter([](std::vector<uint8_t> &Image) { Header(Image)->StringPoolSize = 0xFFFFFFF0; }));
+	TEST_CHECK(!ValidatesAfter([](std::vector<uint8_t> &Image) { Header(Image)->TitleNameOffset = Header(Image)->StringPoolSize; }));
+	// An unterminated string pool
+	TEST_CHECK(!ValidatesAfter([](std::vector<uint8_t> &Image) { Image.back() = 'x'; }));
+	// Names outside the pool, of the wrong length, or out of order
+	TEST_CHECK(!ValidatesAfter([](std::vector<uint8_t> &Image) { Symbol(Image, 0)->NameOffset = 0xFFFFFFF0; }));
+	TEST_CHECK(!ValidatesAfter([](std::vector<uint8_t> &Image) { Symbol(Image, 1)->NameLength--; }));
+	TEST_CHECK(!ValidatesAfter([](std::vector<uint8_t> &Image) { std::swap(*Symbol(Image, 1), *Symbol(Image, 2)); }));
+}
+
+TEST_CASE(HLECache_ManySymbols)
+{
+	HLECacheSymbols Symbols;
+	for (uint32_t i = 0; i < 5000; i++)
+		Symbols.push_back(std::make_pair("Symbol_" + std::to_string((i * 7919) % 5000), 0x10000 + i));
+
+	std::vector<uint8_t> Image;
+	HLECacheWrite(MakeInfo(), Symbols, Image);
+	const HLECacheHeader *pHeader = HLECacheValidate(Image.data(), Image.size());
+	TEST_CHECK(pHeader != nullptr);
+	if (pHeader == nullptr)
+		return;
+
+	int Mismatches = 0;
+	for (auto &Symbol : Symbols) {
+		uint32_t Address = 0;
+		if (!HLECacheFind(pHeader, Symbol.first.c_str(), Address) || Address != Symbol.second)
+			Mismatches++;
+	}
+
+	TEST_CHECK_EQUAL(Mismatches, 0);
+}
@@ -0,0 +1,140 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->HandleTableBenchmark.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "HostBenchmark.h"
+#include "HandleTableReference.h"
+#include "CxbxKrnl/HandleTable.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+BENCHMARK_MAIN_GLOBALS
+
+// Stands in for objects below 2 GB, which tagging requires
+static void *Object(uintptr_t Number)
+{
+	return (void *)(0x01000000 + Number * 16);
+}
+
+// Resolves handles of OpenCount open objects in a pseudo random order, as Nt* calls
+// would, while ThreadCount threads do the same
+template<class F>
+static void BenchmarkResolve(const char *szName, const std::vector<HANDLE> &Handles, int ThreadCount, F Resolve)
+{
+	std::string Name = std::string(szName) + ", " + std::to_string(Handles.size()) + " open, "
+		+ std::to_string(ThreadCount) + " thread(s)";
+	unsigned Lookups = BenchmarkIterations(2000000);
+
+	BenchmarkRun(Name.c_str(), 1, ThreadCount * Lookups, [&](unsigned) {
+		std::vector<std::thread> Threads;
+
+		for (int t = 0; t < ThreadCount; t++)
+			Threads.emplace_back([&, t] {
+				uint32_t Random = 7919 * (t + 1);
+
+				for (unsigned i = 0; i < Lookups; i++) {
+					Random = Random * 1103515245 + 12345;
+					BenchmarkKeep(Resolve(Handles[(Random >> 8) % Handles.size()]));
+				}
+			});
+
+		for (std::thread &Thread : Threads)
+			Thread.join();
+	});
+}
+
+int main(int argc, char *argv[])
+{
+	BenchmarkInit(argc, argv);
+
+	static HandleTable Table;
+
+	// A title has tens to thousands of files, events and threads open
+	for (size_t OpenCount : { 16, 1024, 65536 }) {
+		std::vector<HANDLE> TableHandles, TaggedHandles;
+		for (size_t i = 0; i < OpenCount; i++) {
+			TableHandles.push_back(Table.Insert(Object(i), HANDLE_TYPE_EMU));
+			TaggedHandles.push_back(ReferenceEmuHandleToHandle(Object(i)));
+		}
+
+		for (int ThreadCount : { 1, 4 }) {
+			BenchmarkResolve("HandleTable::Lookup", TableHandles, ThreadCount, [&](HANDLE Handle) {
+				void *pObject;
+				return (Table.Lookup(Handle, &pObject) == HANDLE_TYPE_EMU) ? pObject : nullptr;
+			});
+			BenchmarkResolve("0x80000000 tag (before)", TaggedHandles, ThreadCount, [&](HANDLE Handle) {
+				return ReferenceIsEmuHandle(Handle) ? ReferenceHandleToEmuHandle(Handle) : nullptr;
+			});
+		}
+
+		for (HANDLE Handle : TableHandles) {
+			void *pObject;
+			Table.Remove(Handle, &pObject);
+		}
+	}
+
+	// Opening and closing (NtCreateFile and NtClose), which tagging did without any bookkeeping
+	BenchmarkRun("HandleTable::Insert and Remove", 2000000, 1, [&](unsigned i) {
+		void *pObject;
+		Table.Remove(Table.Insert(Object(i), HANDLE_TYPE_EMU), &pObject);
+		BenchmarkKeep(pObject);
+	});
+	BenchmarkRun("0x80000000 tag and untag (before)", 2000000, 1, [&](unsigned i) {
+		BenchmarkKeep(ReferenceHandleToEmuHandle(ReferenceEmuHandleToHandle(Object(i))));
+	});
+
+	// Lookups while another thread keeps opening and closing handles
+	std::vector<HANDLE> Handles;
+	for (size_t i = 0; i < 1024; i++)
+		Handles.push_back(Table.Insert(Object(i), HANDLE_TYPE_OBJECT));
+
+	std::atomic<bool> bStop(false);
+	std::thread Churn([&] {
+		while (!bStop) {
+			void *pObject;
+			Table.Remove(Table.Insert(Object(0), HANDLE_TYPE_EMU), &pObject);
+		}
+	});
+	BenchmarkResolve("HandleTable::Lookup, during opens and closes", Handles, 1, [&](HANDLE Handle) {
+		void *pObject;
+		return (Table.Lookup(Handle, &pObject) == HANDLE_TYPE_OBJECT) ? pObject : nullptr;
+	});
+	bStop = true;
+	Churn.join();
+
+	Table.DumpStatistics();
+
+	return 0;
+}
@@ -0,0 +1,60 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->HandleTableReference.h
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef HANDLETABLEREFERENCE_H
+#define HANDLETABLEREFERENCE_H
+
+// The EmuHandle scheme from before CxbxKrnl/HandleTable.cpp, kept as the reference
+// it is measured against : a handle was the object's address with the top bit set.
+// That costs nothing to resolve, but can't tell a closed (or never opened) handle
+// from a live one, and only works for objects below 2 GB.
+
+#include <windows.h>
+#include <cstdint>
+
+inline bool ReferenceIsEmuHandle(HANDLE Handle)
+{
+	return ((uint32_t)(uintptr_t)Handle > 0x80000000) && ((uint32_t)(uintptr_t)Handle < 0xFFFFFFFE);
+}
+
+inline void *ReferenceHandleToEmuHandle(HANDLE Handle)
+{
+	return (void *)(uintptr_t)((uint32_t)(uintptr_t)Handle & 0x7FFFFFFF);
+}
+
+inline HANDLE ReferenceEmuHandleToHandle(void *pEmuHandle)
+{
+	return (HANDLE)(uintptr_t)((uint32_t)(uintptr_t)pEmuHandle | 0x80000000);
+}
+
+#endif // HANDLETABLEREFERENCE_H
@@ -0,0 +1,335 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->HandleTableTests.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "HostTest.h"
+#include "CxbxKrnl/HandleTable.h"
+
+#include <atomic>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+
+// Every test uses a table of its own (g_HandleTable is only there to link)
+static std::unique_ptr<HandleTable> NewTable()
+{
+	return std::unique_ptr<HandleTable>(new HandleTable());
+}
+
+static void *Object(uintptr_t Number)
+{
+	return (void *)(0x1000 + Number * 16);
+}
+
+static uint32_t HandleValue(HANDLE Handle)
+{
+	return (uint32_t)(uintptr_t)Handle;
+}
+
+static uint32_t HandleIndex(HANDLE Handle)
+{
+	return (HandleValue(Handle) >> HANDLE_TABLE_INDEX_SHIFT) & (HANDLE_TABLE_ENTRIES - 1);
+}
+
+TEST_CASE(HandleTable_InsertLookupRemove)
+{
+	auto Table = NewTable();
+	void *pObject;
+
+	HANDLE Emu = Table->Insert(Object(1), HANDLE_TYPE_EMU);
+	HANDLE Body = Table->Insert(Object(2), HANDLE_TYPE_OBJECT);
+
+	// tagged like EmuHandles were, but with the two low (NT tag) bits clear
+	TEST_CHECK(HandleTable::IsTableHandle(Emu));
+	TEST_CHECK(HandleTable::IsTableHandle(Body));
+	TEST_CHECK_EQUAL(HandleValue(Emu) & 3, 0);
+	TEST_CHECK(Emu != Body);
+
+	TEST_CHECK_EQUAL(Table->Lookup(Emu, &pObject), HANDLE_TYPE_EMU);
+	TEST_CHECK(pObject == Object(1));
+	TEST_CHECK_EQUAL(Table->Lookup(Body, &pObject), HANDLE_TYPE_OBJECT);
+	TEST_CHECK(pObject == Object(2));
+
+	TEST_CHECK_EQUAL(Table->Remove(Emu, &pObject), HANDLE_TYPE_EMU);
+	TEST_CHECK(pObject == Object(1));
+	TEST_CHECK_EQUAL(Table->Lookup(Emu, &pObject), HANDLE_TYPE_FREE);
+	TEST_CHECK(pObject == nullptr);
+	TEST_CHECK_EQUAL(Table->Remove(Emu, &pObject), HANDLE_TYPE_FREE);
+
+	// closing one handle leaves the others alone
+	TEST_CHECK_EQUAL(Table->Lookup(Body, &pObject), HANDLE_TYPE_OBJECT);
+	TEST_CHECK(pObject == Object(2));
+}
+
+// Handles that must not resolve to anything
+struct InvalidHandleCase
+{
+	const char *szName;
+	uint32_t Value;
+};
+
+TEST_CASE(HandleTable_RejectsInvalidHandles)
+{
+	auto Table = NewTable();
+	void *pObject;
+
+	HANDLE Open = Table->Insert(Object(1), HANDLE_TYPE_EMU);
+	HANDLE Closed = Table->Insert(Object(2), HANDLE_TYPE_EMU);
+	Table->Remove(Closed, &pObject);
+
+	const uint32_t OtherGeneration = HandleValue(Open) ^ (1 << HANDLE_TABLE_GENERATION_SHIFT);
+	const InvalidHandleCase Cases[] = {
+		{ "NULL", 0 },
+		{ "native", 0x1234 },
+		{ "the tag itself (entry zero)", HANDLE_TABLE_TAG },
+		{ "current process", 0xFFFFFFFF },
+		{ "current thread", 0xFFFFFFFE },
+		{ "the open one, untagged", HandleValue(Open) & ~HANDLE_TABLE_TAG },
+		{ "the open one, other generation", OtherGeneration },
+		{ "closed", HandleValue(Closed) },
+		{ "never used entry", HANDLE_TABLE_TAG | (5 << HANDLE_TABLE_INDEX_SHIFT) },
+		{ "entry in an unallocated page", HANDLE_TABLE_TAG | ((HANDLE_TABLE_ENTRIES - 1) << HANDLE_TABLE_INDEX_SHIFT) },
+	};
+
+	for (const InvalidHandleCase &Case : Cases) {
+		int FailuresBefore = g_HostTestFailures;
+		HANDLE Handle = (HANDLE)(uintptr_t)Case.Value;
+
+		pObject = Object(99);
+		TEST_CHECK_EQUAL(Table->Lookup(Handle, &pObject), HANDLE_TYPE_FREE);
+		TEST_CHECK(pObject == nullptr);
+		TEST_CHECK_EQUAL(Table->Remove(Handle, &pObject), HANDLE_TYPE_FREE);
+
+		if (g_HostTestFailures != FailuresBefore)
+			printf("  in case \"%s\"\n", Case.szName);
+	}
+
+	// none of that closed the open handle
+	TEST_CHECK_EQUAL(Table->Lookup(Open, &pObject), HANDLE_TYPE_EMU);
+	TEST_CHECK(pObject == Object(1));
+
+	// the low two bits are ignored, as NT does
+	TEST_CHECK_EQUAL(Table->Lookup((HANDLE)(uintptr_t)(HandleValue(Open) | 3), &pObject), HANDLE_TYPE_EMU);
+	TEST_CHECK(pObject == Object(1));
+}
+
+TEST_CASE(HandleTable_ReusedEntriesGetANewGeneration)
+{
+	auto Table = NewTable();
+	void *pObject;
+
+	HANDLE First = Table->Insert(Object(1), HANDLE_TYPE_EMU);
+	Table->Remove(First, &pObject);
+
+	// the freed entry is reused first, but its old handle stays closed
+	HANDLE Second = Table->Insert(Object(2), HANDLE_TYPE_OBJECT);
+	TEST_CHECK_EQUAL(HandleIndex(Second), HandleIndex(First));
+	TEST_CHECK(Second != First);
+	TEST_CHECK_EQUAL(Table->Lookup(First, &pObject), HANDLE_TYPE_FREE);
+	TEST_CHECK_EQUAL(Table->Remove(First, &pObject), HANDLE_TYPE_FREE);
+	TEST_CHECK_EQUAL(Table->Lookup(Second, &pObject), HANDLE_TYPE_OBJECT);
+	TEST_CHECK(pObject == Object(2));
+
+	// Every generation is distinct, until they wrap
+	std::set<HANDLE> Handles;
+	HANDLE Handle = Second;
+	for (int i = 0; i < HANDLE_TABLE_GENERATION_MASK; i++) {
+		Handles.insert(Handle);
+		Table->Remove(Handle, &pObject);
+		Handle = Table->Insert(Object(i), HANDLE_TYPE_EMU);
+		TEST_CHECK(HandleTable::IsTableHandle(Handle));
+		TEST_CHECK_EQUAL(HandleIndex(Handle), HandleIndex(First));
+	}
+	TEST_CHECK_EQUAL(Handles.size(), HANDLE_TABLE_GENERATION_MASK);
+	TEST_CHECK(Handles.count(Handle) == 0);
+	TEST_CHECK(Handle == First); // wrapped
+
+	// The free list is last in, first out
+	HANDLE A = Table->Insert(Object(10), HANDLE_TYPE_EMU);
+	HANDLE B = Table->Insert(Object(11), HANDLE_TYPE_EMU);
+	Table->Remove(A, &pObject);
+	Table->Remove(B, &pObject);
+	TEST_CHECK_EQUAL(HandleIndex(Table->Insert(Object(12), HANDLE_TYPE_EMU)), HandleIndex(B));
+	TEST_CHECK_EQUAL(HandleIndex(Table->Insert(Object(13), HANDLE_TYPE_EMU)), HandleIndex(A));
+}
+
+TEST_CASE(HandleTable_FillsUpAndRecovers)
+{
+	auto Table = NewTable();
+	std::vector<HANDLE> Handles;
+	void *pObject;
+
+	// entry zero is never handed out
+	for (uint32_t i = 1; i < HANDLE_TABLE_ENTRIES; i++)
+		Handles.push_back(Table->Insert(Object(i), HANDLE_TYPE_OBJECT));
+
+	TEST_CHECK(Table->Insert(Object(0), HANDLE_TYPE_OBJECT) == NULL);
+
+	int Failures = 0;
+	for (uint32_t i = 1; i < HANDLE_TABLE_ENTRIES; i++) {
+		HANDLE Handle = Handles[i - 1];
+		if (!HandleTable::IsTableHandle(Handle) || HandleIndex(Handle) != i ||
+			Table->Lookup(Handle, &pObject) != HANDLE_TYPE_OBJECT || pObject != Object(i))
+			Failures++;
+	}
+	TEST_CHECK_EQUAL(Failures, 0);
+
+	// closing any handle makes room for one more
+	HANDLE Last = Handles[HANDLE_TABLE_ENTRIES / 2];
+	Table->Remove(Last, &pObject);
+	HANDLE Reopened = Table->Insert(Object(0), HANDLE_TYPE_EMU);
+	TEST_CHECK_EQUAL(HandleIndex(Reopened), HandleIndex(Last));
+	TEST_CHECK(Table->Insert(Object(0), HANDLE_TYPE_EMU) == NULL);
+}
+
+// Threads that open, use and close handles, while others look up handles the
+// writers just gave out (and may already have closed) : a lookup gives the object
+// of its handle, or nothing - unless the entry was reused so often meanwhile that
+// its generation wrapped around to the same handle.
+struct PublishedHandle
+{
+	HANDLE Handle;
+	void *pObject;
+};
+
+TEST_CASE(HandleTable_LookupsNeverSeeAnotherObject)
+{
+	auto Table = NewTable();
+	const int Writers = 3, Readers = 3;
+	const int Cycles = 100000;
+
+	std::vector<PublishedHandle> Published(Writers * Cycles);
+	std::atomic<int> Latest[Writers];
+	std::atomic<long> Inserts(0), Wrong(0), Wrapped(0), Found(0);
+	std::atomic<bool> bStop(false);
+	std::vector<std::thread> Threads;
+
+	for (int w = 0; w < Writers; w++) {
+		Latest[w] = -1;
+		Threads.emplace_back([&, w] {
+			std::vector<HANDLE> Open;
+
+			for (int i = 0; i < Cycles; i++) {
+				PublishedHandle &Entry = Published[w * Cycles + i];
+				Entry.pObject = Object(w * Cycles + i);
+				Entry.Handle = Table->Insert(Entry.pObject, HANDLE_TYPE_EMU);
+				Inserts++;
+				Latest[w] = w * Cycles + i;
+				Open.push_back(Entry.Handle);
+
+				void *pFound;
+				if (Table->Lookup(Entry.Handle, &pFound) != HANDLE_TYPE_EMU || pFound != Entry.pObject)
+					Wrong++;
+
+				// keep a few open, close the others soon
+				if (Open.size() > 8 || (i & 1)) {
+					if (Table->Remove(Open.front(), &pFound) != HANDLE_TYPE_EMU)
+						Wrong++;
+					Open.erase(Open.begin());
+				}
+			}
+		});
+	}
+
+	for (int r = 0; r < Readers; r++)
+		Threads.emplace_back([&, r] {
+			while (!bStop) {
+				long InsertsBefore = Inserts;
+				int Newest = Latest[r % Writers];
+
+				// the newest handles, the oldest of which are being closed
+				for (int i = Newest; i >= 0 && i > Newest - 16; i--) {
+					const PublishedHandle &Entry = Published[i];
+					void *pObject;
+					if (Table->Lookup(Entry.Handle, &pObject) == HANDLE_TYPE_FREE)
+						continue;
+
+					Found++;
+					if (pObject != Entry.pObject) {
+						if (Inserts - InsertsBefore > HANDLE_TABLE_GENERATION_MASK)
+							Wrapped++;
+						else
+							Wrong++;
+					}
+				}
+			}
+		});
+
+	for (int w = 0; w < Writers; w++)
+		Threads[w].join();
+	bStop = true;
+	for (int r = 0; r < Readers; r++)
+		Threads[Writers + r].join();
+
+	TEST_CHECK_EQUAL(Wrong, 0);
+	TEST_CHECK(Found > 0);
+
+	// the writers' handles are all still distinct : as many resolve as they left open
+	int Open = 0;
+	for (const PublishedHandle &Entry : Published) {
+		void *pObject;
+		if (Table->Lookup(Entry.Handle, &pObject) != HANDLE_TYPE_FREE && pObject == Entry.pObject)
+			Open++;
+	}
+	TEST_CHECK_EQUAL(Open, Writers * 8);
+}
+
+TEST_CASE(HandleTable_ConcurrentInsertsAreUnique)
+{
+	auto Table = NewTable();
+	const int ThreadCount = 4, PerThread = 20000;
+	std::vector<std::vector<HANDLE>> Handles(ThreadCount);
+	std::vector<std::thread> Threads;
+
+	for (int t = 0; t < ThreadCount; t++)
+		Threads.emplace_back([&, t] {
+			for (int i = 0; i < PerThread; i++)
+				Handles[t].push_back(Table->Insert(Object(t * PerThread + i), HANDLE_TYPE_OBJECT));
+		});
+
+	for (std::thread &Thread : Threads)
+		Thread.join();
+
+	std::set<HANDLE> Unique;
+	int Failures = 0;
+	for (int t = 0; t < ThreadCount; t++)
+		for (int i = 0; i < PerThread; i++) {
+			void *pObject;
+			Unique.insert(Handles[t][i]);
+			if (Table->Lookup(Handles[t][i], &pObject) != HANDLE_TYPE_OBJECT || pObject != Object(t * PerThread + i))
+				Failures++;
+		}
+
+	TEST_CHECK_EQUAL(Failures, 0);
+	TEST_CHECK_EQUAL(Unique.size(), ThreadCount * PerThread);
+}
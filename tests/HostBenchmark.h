@@ -0,0 +1,92 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->HostBenchmark.h
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef HOSTBENCHMARK_H
+#define HOSTBENCHMARK_H
+
+// Minimal support for the host benchmarks. Each benchmark is a plain executable;
+// passing --quick runs every measurement only briefly, which is how the test
+// runner smoke tests them. Results are printed as time per operation.
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+extern bool g_BenchmarkQuick;
+
+// Returns true when --quick was passed
+inline bool BenchmarkInit(int argc, char *argv[])
+{
+	for (int i = 1; i < argc; i++)
+		if (strcmp(argv[i], "--quick") == 0)
+			g_BenchmarkQuick = true;
+
+	return g_BenchmarkQuick;
+}
+
+// Scales an iteration count down for quick runs
+inline unsigned BenchmarkIterations(unsigned Iterations)
+{
+	return g_BenchmarkQuick ? ((Iterations / 1000) + 1) : Iterations;
+}
+
+// Keeps the compiler from optimizing away a computed value
+template<class T>
+inline void BenchmarkKeep(const T &Value)
+{
+	static volatile T Sink;
+	Sink = Value;
+	(void)Sink;
+}
+
+// Runs Body Iterations times (Body gets the iteration number), and prints the
+// time per operation, where one iteration performs OperationsPerIteration operations
+template<class F>
+double BenchmarkRun(const char *szName, unsigned Iterations, unsigned OperationsPerIteration, F Body)
+{
+	Iterations = BenchmarkIterations(Iterations);
+
+	auto Start = std::chrono::steady_clock::now();
+	for (unsigned i = 0; i < Iterations; i++)
+		Body(i);
+	double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+
+	double NanosecondsPerOperation = (Seconds * 1e9) / ((double)Iterations * OperationsPerIteration);
+	printf("%-60s %12.2f ns/op\n", szName, NanosecondsPerOperation);
+	return NanosecondsPerOperation;
+}
+
+// Defines g_BenchmarkQuick; include this in exactly one translation unit per benchmark
+#define BENCHMARK_MAIN_GLOBALS bool g_BenchmarkQuick = false;
+
+#endif // HOSTBENCHMARK_H
@@ -0,0 +1,77 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->HostTest.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "HostTest.h"
+
+#include <string>
+#include <vector>
+
+int g_HostTestFailures = 0;
+
+struct HostTestEntry
+{
+	const char *szName;
+	HostTestFunction Function;
+};
+
+// Function local, so registrations in other translation units can't run before it exists
+static std::vector<HostTestEntry> &GetHostTests()
+{
+	static std::vector<HostTestEntry> Tests;
+	return Tests;
+}
+
+HostTestRegistration::HostTestRegistration(const char *szName, HostTestFunction Function)
+{
+	HostTestEntry Entry = { szName, Function };
+	GetHostTests().push_back(Entry);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *szFilter = (argc > 1) ? argv[1] : "";
+	int Ran = 0;
+
+	for (auto &Test : GetHostTests()) {
+		if (strstr(Test.szName, szFilter) == nullptr)
+			continue;
+
+		int FailuresBefore = g_HostTestFailures;
+		Test.Function();
+		printf("%-50s %s\n", Test.szName, (g_HostTestFailures == FailuresBefore) ? "passed" : "FAILED");
+		Ran++;
+	}
+
+	printf("%d tests, %d failed checks\n", Ran, g_HostTestFailures);
+	return (g_HostTestFailures == 0 && Ran > 0) ? 0 : 1;
+}
@@ -0,0 +1,75 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->HostTest.h
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef HOSTTEST_H
+#define HOSTTEST_H
+
+// Minimal support for the host tests : every TEST_CASE registers itself, and
+// HostTest.cpp runs them all (or only those whose name contains argv[1]).
+// A failed check is reported, and makes the test executable exit non-zero.
+
+#include <cstdio>
+#include <cstring>
+
+typedef void (*HostTestFunction)();
+
+struct HostTestRegistration
+{
+	HostTestRegistration(const char *szName, HostTestFunction Function);
+};
+
+extern int g_HostTestFailures;
+
+#define TEST_CASE(Name) \
+	static void Name(); \
+	static HostTestRegistration Name##_Registration(#Name, Name); \
+	static void Name()
+
+#define TEST_CHECK(Condition) \
+	do { if (!(Condition)) { \
+		printf("%s(%d) : check failed : %s\n", __FILE__, __LINE__, #Condition); \
+		g_HostTestFailures++; \
+	} } while (0)
+
+// Compares integral values, and shows both of them when they differ
+#define TEST_CHECK_EQUAL(Actual, Expected) \
+	do { long long _actual = (long long)(Actual), _expected = (long long)(Expected); \
+		if (_actual != _expected) { \
+			printf("%s(%d) : check failed : %s == %s (0x%llX != 0x%llX)\n", __FILE__, __LINE__, #Actual, #Expected, _actual, _expected); \
+			g_HostTestFailures++; \
+	} } while (0)
+
+#define TEST_CHECK_MEMORY(Actual, Expected, Size) \
+	TEST_CHECK(memcmp((Actual), (Expected), (Size)) == 0)
+
+#endif // HOSTTEST_H
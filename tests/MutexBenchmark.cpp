@@ -0,0 +1,106 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->MutexBenchmark.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "HostBenchmark.h"
+#include "Common/Win32/Mutex.h"
+#include "MutexReference.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+BENCHMARK_MAIN_GLOBALS
+
+// Threads that each take the lock (nested twice, like the emulator often does),
+// do a little work while holding it, and a bit more after releasing it.
+// The time per acquisition is the wall clock time over all of them.
+template<class M>
+void BenchmarkContention(const char *szName, int ThreadCount, unsigned Acquisitions, int Work)
+{
+	M Lock;
+	long Counter = 0;
+	std::string Name = std::string(szName) + ", " + std::to_string(ThreadCount) + " thread(s)";
+
+	Acquisitions = BenchmarkIterations(Acquisitions);
+
+	BenchmarkRun(Name.c_str(), 1, ThreadCount * Acquisitions, [&](unsigned) {
+		std::vector<std::thread> Threads;
+
+		for (int t = 0; t < ThreadCount; t++)
+			Threads.emplace_back([&] {
+				for (unsigned i = 0; i < Acquisitions; i++) {
+					Lock.Lock();
+					Lock.Lock();
+
+					volatile int Busy = 0;
+					for (int w = 0; w < Work; w++)
+						Busy++;
+					Counter++;
+
+					Lock.Unlock();
+					Lock.Unlock();
+
+					for (int w = 0; w < Work * 4; w++)
+						Busy++;
+				}
+			});
+
+		for (std::thread &Thread : Threads)
+			Thread.join();
+	});
+
+	if (Counter != (long)ThreadCount * Acquisitions)
+		printf("  %s lost updates!\n", szName);
+}
+
+int main(int argc, char *argv[])
+{
+	BenchmarkInit(argc, argv);
+
+	// with a single processor, Mutex never spins and threads rarely meet inside the lock
+	printf("%u processor(s)\n", std::thread::hardware_concurrency());
+
+	// The Sleep based lock takes a millisecond per contended acquisition, so it gets fewer
+	for (int ThreadCount : { 1, 2, 4, 8 }) {
+		BenchmarkContention<Mutex>("spin, then park", ThreadCount, 200000, 50);
+		BenchmarkContention<SleepMutex>("Sleep(1) (before)", ThreadCount, (ThreadCount == 1) ? 200000 : 2000, 50);
+	}
+
+	// Held a long time, so waiters park (or sleep) rather than spin
+	for (int ThreadCount : { 2, 4 }) {
+		BenchmarkContention<Mutex>("spin, then park, long hold", ThreadCount, 2000, 20000);
+		BenchmarkContention<SleepMutex>("Sleep(1) (before), long hold", ThreadCount, 2000, 20000);
+	}
+
+	return 0;
+}
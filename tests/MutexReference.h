@@ -0,0 +1,106 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->MutexReference.h
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef MUTEXREFERENCE_H
+#define MUTEXREFERENCE_H
+
+// The Mutex from before Common/Win32/Mutex.cpp spun then parked contended threads,
+// kept as the reference it is measured against. Every contended acquisition (and
+// even a contended look at the owner fields) slept for a whole scheduler quantum.
+
+#include <windows.h>
+
+class SleepMutex
+{
+	public:
+		SleepMutex()
+		{
+			InterlockedExchange(&m_MutexLock, 0);
+			InterlockedExchange(&m_OwnerProcess, 0);
+			InterlockedExchange(&m_OwnerThread, 0);
+			InterlockedExchange(&m_LockCount, 0);
+		}
+
+		void Lock()
+		{
+			LONG _CurrentProcessId = (LONG) GetCurrentProcessId();
+			LONG _CurrentThreadId = (LONG) GetCurrentThreadId();
+			while (true) {
+				// Grab the lock, letting us look at the variables
+				while (InterlockedCompareExchange(&m_MutexLock, 1, 0))
+					Sleep(1);
+
+				// Are we the the new owner?
+				if (!m_OwnerProcess) {
+					InterlockedExchange(&m_OwnerProcess, _CurrentProcessId);
+					InterlockedExchange(&m_OwnerThread, _CurrentThreadId);
+					InterlockedExchange(&m_LockCount, 1);
+					InterlockedExchange(&m_MutexLock, 0);
+					return;
+				}
+
+				// Someone else owns it, wait and try again
+				if ((m_OwnerProcess != _CurrentProcessId) || (m_OwnerThread != _CurrentThreadId)) {
+					InterlockedExchange(&m_MutexLock, 0);
+					Sleep(1);
+					continue;
+				}
+
+				// Already ours
+				InterlockedIncrement(&m_LockCount);
+				InterlockedExchange(&m_MutexLock, 0);
+				return;
+			}
+		}
+
+		void Unlock()
+		{
+			while (InterlockedCompareExchange(&m_MutexLock, 1, 0))
+				Sleep(1);
+
+			if (!InterlockedDecrement(&m_LockCount)) {
+				InterlockedExchange(&m_OwnerProcess, 0);
+				InterlockedExchange(&m_OwnerThread, 0);
+			}
+
+			InterlockedExchange(&m_MutexLock, 0);
+		}
+
+	private:
+		volatile LONG m_MutexLock;
+		volatile LONG m_OwnerProcess;
+		volatile LONG m_OwnerThread;
+		volatile LONG m_LockCount;
+};
+
+#endif // MUTEXREFERENCE_H
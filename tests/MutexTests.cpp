@@ -0,0 +1,214 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->MutexTests.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "HostTest.h"
+#include "Common/Win32/Mutex.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// Long enough for a blocked thread to have given up spinning, and parked
+#define PARK_DELAY std::chrono::milliseconds(30)
+
+#ifndef _DEBUG_MUTEX
+#error MutexTests checks the statistics, build it with _DEBUG
+#endif
+
+TEST_CASE(Mutex_IsRecursive)
+{
+	Mutex Lock;
+	std::atomic<bool> bAcquired(false);
+
+	Lock.Lock();
+	Lock.Lock();
+	Lock.Lock();
+
+	std::thread Other([&] {
+		Lock.Lock();
+		bAcquired = true;
+		Lock.Unlock();
+	});
+
+	std::this_thread::sleep_for(PARK_DELAY);
+	TEST_CHECK(!bAcquired);
+
+	Lock.Unlock();
+	Lock.Unlock();
+	std::this_thread::sleep_for(PARK_DELAY);
+	TEST_CHECK(!bAcquired);
+
+	Lock.Unlock();
+	Other.join();
+	TEST_CHECK(bAcquired);
+
+	// and it can be taken again afterwards
+	Lock.Lock();
+	Lock.Unlock();
+}
+
+// Threads doing nested acquisitions of one Mutex, each incrementing a plain counter
+struct ContentionCase
+{
+	int Threads;
+	int Nesting;
+	int Work;       // busy loop iterations while holding the lock
+};
+
+TEST_CASE(Mutex_ExcludesUnderContention)
+{
+	static const ContentionCase Cases[] = {
+		{ 1, 1, 0 },
+		{ 2, 1, 0 },
+		{ 4, 2, 10 },
+		{ 8, 3, 50 },
+		{ 16, 1, 200 },
+	};
+	const int Iterations = 20000;
+
+	for (const ContentionCase &Case : Cases) {
+		Mutex Lock;
+		long Counter = 0;
+		std::atomic<int> Inside(0);
+		std::atomic<int> Overlaps(0);
+		std::vector<std::thread> Threads;
+
+		Lock.ResetStatistics();
+
+		for (int t = 0; t < Case.Threads; t++)
+			Threads.emplace_back([&] {
+				for (int i = 0; i < Iterations; i++) {
+					for (int n = 0; n < Case.Nesting; n++)
+						Lock.Lock();
+
+					if (Inside.fetch_add(1) != 0)
+						Overlaps++;
+
+					volatile int Busy = 0;
+					for (int w = 0; w < Case.Work; w++)
+						Busy++;
+
+					Counter = Counter + 1;
+					Inside--;
+
+					for (int n = 0; n < Case.Nesting; n++)
+						Lock.Unlock();
+				}
+			});
+
+		for (std::thread &Thread : Threads)
+			Thread.join();
+
+		MutexStatistics Statistics;
+		Lock.GetStatistics(&Statistics);
+
+		TEST_CHECK_EQUAL(Overlaps, 0);
+		TEST_CHECK_EQUAL(Counter, (long)Case.Threads * Iterations);
+		TEST_CHECK_EQUAL(Statistics.Acquires, (ULONGLONG)Case.Threads * Iterations * Case.Nesting);
+		TEST_CHECK(Statistics.Contended <= (ULONGLONG)Case.Threads * Iterations);
+		if (Case.Threads == 1)
+			TEST_CHECK_EQUAL(Statistics.Contended, 0);
+	}
+}
+
+TEST_CASE(Mutex_CountsStatistics)
+{
+	Mutex Lock;
+	MutexStatistics Statistics;
+
+	for (int i = 0; i < 5; i++)
+		Lock.Lock();
+	for (int i = 0; i < 5; i++)
+		Lock.Unlock();
+
+	Lock.GetStatistics(&Statistics);
+	TEST_CHECK_EQUAL(Statistics.Acquires, 5);
+	TEST_CHECK_EQUAL(Statistics.Contended, 0);
+	TEST_CHECK_EQUAL(Statistics.Spins, 0);
+	TEST_CHECK_EQUAL(Statistics.Parks, 0);
+	TEST_CHECK_EQUAL(Statistics.WaitMicroseconds, 0);
+
+	// One thread that has to wait for the lock, long enough to park
+	Lock.ResetStatistics();
+	Lock.Lock();
+	std::thread Other([&] {
+		Lock.Lock();
+		Lock.Unlock();
+	});
+	std::this_thread::sleep_for(PARK_DELAY);
+	Lock.Unlock();
+	Other.join();
+
+	Lock.GetStatistics(&Statistics);
+	TEST_CHECK_EQUAL(Statistics.Acquires, 2);
+	TEST_CHECK_EQUAL(Statistics.Contended, 1);
+	TEST_CHECK(Statistics.Parks >= 1);
+	TEST_CHECK(Statistics.WaitMicroseconds >= 10000);
+
+	Lock.ResetStatistics();
+	Lock.GetStatistics(&Statistics);
+	TEST_CHECK_EQUAL(Statistics.Acquires, 0);
+	TEST_CHECK_EQUAL(Statistics.Contended, 0);
+}
+
+TEST_CASE(Mutex_WakesEveryParkedThread)
+{
+	const int ThreadCount = 8;
+	Mutex Lock;
+	int Acquired = 0;
+	std::vector<std::thread> Threads;
+
+	Lock.Lock();
+	for (int t = 0; t < ThreadCount; t++)
+		Threads.emplace_back([&] {
+			Lock.Lock();
+			Acquired++;
+			Lock.Unlock();
+		});
+
+	std::this_thread::sleep_for(PARK_DELAY);
+	Lock.ResetStatistics(); // recursive, from the owner
+	Lock.Unlock();
+
+	// Every thread parked behind the owner. Each unlock wakes one, and the lock
+	// stays marked as parked on until the last of them has it.
+	for (std::thread &Thread : Threads)
+		Thread.join();
+
+	MutexStatistics Statistics;
+	Lock.GetStatistics(&Statistics);
+	TEST_CHECK_EQUAL(Acquired, ThreadCount);
+	TEST_CHECK_EQUAL(Statistics.Contended, ThreadCount);
+	TEST_CHECK(Statistics.Parks >= ThreadCount);
+}
@@ -0,0 +1,144 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->PushBufferBenchmark.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "HostBenchmark.h"
+#include "Common/PushBufferDecoder.h"
+
+#include <cstdio>
+#include <vector>
+
+BENCHMARK_MAIN_GLOBALS
+
+#define BENCHMARK_CAPTURE_FILE "PushBufferBenchmark.capture"
+#define FRAME_ADDRESS          0x00100000
+#define STATE_ADDRESS          0x00200000
+#define DRAWS_PER_FRAME        500
+
+static uint32_t MethodWord(uint32_t Method, uint32_t Count, bool bNonIncrementing = false)
+{
+	return (bNonIncrementing ? PUSHBUFFER_NON_INCREMENTING : 0) | (Count << 18) | Method;
+}
+
+// Only counts, like the replayer does
+struct CountingHandler : public PushBufferHandler
+{
+	uint64_t Parameters = 0;
+
+	bool Command(const PushBufferCommand &Command) override
+	{
+		Parameters += Command.Count;
+		return true;
+	}
+};
+
+// A frame shaped like what titles send : per draw a call into shared render
+// state, a few state methods and an inline triangle list of 12 vertices
+// (position, diffuse and one texture coordinate : 6 dwords each)
+static void BuildFrame(std::vector<uint32_t> &Frame, std::vector<uint32_t> &State)
+{
+	State.clear();
+	for (uint32_t m = 0; m < 16; m++) {
+		State.push_back(MethodWord(0x0300 + m * 4, 1));
+		State.push_back(m);
+	}
+	State.push_back(PUSHBUFFER_COMMAND_RETURN);
+
+	Frame.clear();
+	for (uint32_t d = 0; d < DRAWS_PER_FRAME; d++) {
+		Frame.push_back(STATE_ADDRESS | PUSHBUFFER_COMMAND_CALL);
+		Frame.push_back(MethodWord(0x1E70, 4));
+		for (uint32_t p = 0; p < 4; p++)
+			Frame.push_back(d + p);
+		Frame.push_back(MethodWord(NV2A_METHOD_SET_BEGIN_END, 1));
+		Frame.push_back(5); // triangle list
+		Frame.push_back(MethodWord(NV2A_METHOD_INLINE_VERTEX_ARRAY, 12 * 6, true));
+		for (uint32_t v = 0; v < 12 * 6; v++)
+			Frame.push_back(v * d);
+		Frame.push_back(MethodWord(NV2A_METHOD_SET_BEGIN_END, 1));
+		Frame.push_back(0);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	BenchmarkInit(argc, argv);
+
+	std::vector<uint32_t> Frame, State;
+	BuildFrame(Frame, State);
+
+	uint32_t FrameBytes = (uint32_t)(Frame.size() * sizeof(uint32_t));
+	uint32_t StateBytes = (uint32_t)(State.size() * sizeof(uint32_t));
+	uint32_t FrameWords = (uint32_t)Frame.size() + DRAWS_PER_FRAME * (uint32_t)State.size();
+
+	printf("Push buffer : %u draws, %u words decoded per frame\n\n", DRAWS_PER_FRAME, FrameWords);
+
+	PushBufferDecoder Decoder;
+	Decoder.Map(FRAME_ADDRESS, Frame.data(), FrameBytes);
+	Decoder.Map(STATE_ADDRESS, State.data(), StateBytes);
+
+	CountingHandler Handler;
+	BenchmarkRun("PushBufferDecoder::Decode (per word)", 2000, FrameWords, [&](unsigned) {
+		if (Decoder.Decode(FRAME_ADDRESS, FRAME_ADDRESS + FrameBytes, &Handler) != PUSHBUFFER_OK)
+			printf("Decode failed\n");
+	});
+	BenchmarkKeep(Handler.Parameters);
+
+	// Captured frames, replayed from memory the way the ReplayPB command does
+	const unsigned Frames = 60;
+	{
+		PushBufferRecorder Recorder(BENCHMARK_CAPTURE_FILE);
+		for (unsigned f = 0; f < Frames; f++) {
+			Frame[1 + 4] = f; // a changed parameter, so the frame is captured again
+			Recorder.RecordMemory(FRAME_ADDRESS, Frame.data(), FrameBytes);
+			Recorder.RecordMemory(STATE_ADDRESS, State.data(), StateBytes);
+			Recorder.RecordDecode(FRAME_ADDRESS, FRAME_ADDRESS + FrameBytes);
+			Recorder.RecordFrame();
+		}
+
+		if (Recorder.HasError()) {
+			printf("%s\n", Recorder.GetError().c_str());
+			return 1;
+		}
+	}
+
+	PushBufferReplayer Replayer(BENCHMARK_CAPTURE_FILE);
+	BenchmarkRun("PushBufferReplayer::Replay (per word)", 30, Frames * FrameWords, [&](unsigned) {
+		Replayer.Replay();
+	});
+
+	printf("\n");
+	Replayer.DumpStatistics(stdout);
+	remove(BENCHMARK_CAPTURE_FILE);
+
+	return (Replayer.HasError() || Replayer.GetFailureCount() != 0) ? 1 : 0;
+}
@@ -0,0 +1,344 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->PushBufferDecoderTests.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "HostTest.h"
+#include "Common/PushBufferDecoder.h"
+
+#include <cstdio>
+#include <vector>
+
+#define TEST_CAPTURE_FILE "PushBufferDecoderTests.capture"
+
+static uint32_t MethodWord(uint32_t Method, uint32_t Count, uint32_t Subchannel = 0, bool bNonIncrementing = false)
+{
+	return (bNonIncrementing ? PUSHBUFFER_NON_INCREMENTING : 0) | (Count << 18) | (Subchannel << 13) | Method;
+}
+
+static uint32_t JumpWord(uint32_t Address) { return Address | PUSHBUFFER_COMMAND_JUMP; }
+static uint32_t CallWord(uint32_t Address) { return Address | PUSHBUFFER_COMMAND_CALL; }
+static uint32_t OldJumpWord(uint32_t Address) { return Address | PUSHBUFFER_OLD_JUMP; }
+
+// Keeps a copy of every command it is handed
+struct RecordingHandler : public PushBufferHandler
+{
+	struct Entry
+	{
+		PushBufferCommand Command;
+		std::vector<uint32_t> Parameters;
+	};
+
+	std::vector<Entry> Commands;
+	size_t StopAfter = 0; // 0 : never stop
+
+	bool Command(const PushBufferCommand &Command) override
+	{
+		Entry NewEntry;
+		NewEntry.Command = Command;
+		NewEntry.Parameters.assign(Command.pParameters, Command.pParameters + Command.Count);
+		Commands.push_back(NewEntry);
+
+		return StopAfter == 0 || Commands.size() < StopAfter;
+	}
+};
+
+TEST_CASE(PushBufferDecoder_DecodesMethodHeaders)
+{
+	uint32_t Words[] = {
+		MethodWord(0x17FC, 1), 5,
+		MethodWord(0x1818, 3, 2, true), 10, 11, 12,
+		MethodWord(0x0100, 0),
+	};
+	PushBufferDecoder Decoder;
+	RecordingHandler Handler;
+	uint32_t dwStop = 0;
+
+	Decoder.Map(0x1000, Words, sizeof(Words));
+	TEST_CHECK_EQUAL(Decoder.Decode(0x1000, 0x1000 + sizeof(Words), &Handler, &dwStop), PUSHBUFFER_OK);
+	TEST_CHECK_EQUAL(dwStop, 0x1000 + sizeof(Words));
+	TEST_CHECK_EQUAL(Handler.Commands.size(), 3);
+
+	const PushBufferCommand &First = Handler.Commands[0].Command;
+	TEST_CHECK_EQUAL(First.Address, 0x1000);
+	TEST_CHECK_EQUAL(First.Method, 0x17FC);
+	TEST_CHECK_EQUAL(First.Count, 1);
+	TEST_CHECK(!First.bNonIncrementing);
+	TEST_CHECK_EQUAL(Handler.Commands[0].Parameters[0], 5);
+
+	const PushBufferCommand &Second = Handler.Commands[1].Command;
+	TEST_CHECK_EQUAL(Second.Address, 0x1008);
+	TEST_CHECK_EQUAL(Second.Method, 0x1818);
+	TEST_CHECK_EQUAL(Second.Subchannel, 2);
+	TEST_CHECK_EQUAL(Second.Count, 3);
+	TEST_CHECK(Second.bNonIncrementing);
+	TEST_CHECK_EQUAL(Handler.Commands[1].Parameters[2], 12);
+
+	TEST_CHECK_EQUAL(Handler.Commands[2].Command.Count, 0);
+}
+
+TEST_CASE(PushBufferDecoder_FollowsJumpsCallsAndReturns)
+{
+	// main : method, call sub, method, old style jump to tail
+	uint32_t Main[] = {
+		MethodWord(0x0100, 1), 1,
+		CallWord(0x2000),
+		MethodWord(0x0104, 1), 2,
+		OldJumpWord(0x3000),
+	};
+	// sub : FixLoop with 16 bit indices, return
+	uint32_t Sub[] = { MethodWord(0x1808, 2), 0x00010000, 0x00030002, PUSHBUFFER_COMMAND_RETURN };
+	// tail : method, new style jump back to the end of main
+	uint32_t Tail[] = { MethodWord(0x0108, 1), 3, JumpWord(0x1000 + sizeof(Main)) };
+	PushBufferDecoder Decoder;
+	RecordingHandler Handler;
+
+	Decoder.Map(0x1000, Main, sizeof(Main));
+	Decoder.Map(0x2000, Sub, sizeof(Sub));
+	Decoder.Map(0x3000, Tail, sizeof(Tail));
+	TEST_CHECK_EQUAL(Decoder.Decode(0x1000, 0x1000 + sizeof(Main), &Handler), PUSHBUFFER_OK);
+
+	TEST_CHECK_EQUAL(Handler.Commands.size(), 4);
+	TEST_CHECK_EQUAL(Handler.Commands[0].Command.Method, 0x0100);
+	TEST_CHECK_EQUAL(Handler.Commands[1].Command.Method, NV2A_METHOD_FIX_LOOP);
+	TEST_CHECK_EQUAL(Handler.Commands[1].Command.Address, 0x2000);
+	TEST_CHECK_EQUAL(Handler.Commands[1].Parameters[1], 0x00030002);
+	TEST_CHECK_EQUAL(Handler.Commands[2].Command.Method, 0x0104);
+	TEST_CHECK_EQUAL(Handler.Commands[3].Command.Method, 0x0108);
+	TEST_CHECK_EQUAL(Handler.Commands[3].Parameters[0], 3);
+}
+
+TEST_CASE(PushBufferDecoder_LaterMappingsTakePrecedence)
+{
+	uint32_t Old[] = { MethodWord(0x0100, 0) };
+	uint32_t New[] = { MethodWord(0x0200, 0) };
+	PushBufferDecoder Decoder;
+	RecordingHandler Handler;
+
+	Decoder.Map(0x1000, Old, sizeof(Old));
+	Decoder.Map(0x1000, New, sizeof(New));
+	TEST_CHECK_EQUAL(Decoder.Decode(0x1000, 0x1004, &Handler), PUSHBUFFER_OK);
+	TEST_CHECK_EQUAL(Handler.Commands.size(), 1);
+	TEST_CHECK_EQUAL(Handler.Commands[0].Command.Method, 0x0200);
+
+	Decoder.Unmap();
+	TEST_CHECK_EQUAL(Decoder.Decode(0x1000, 0x1004, &Handler), PUSHBUFFER_BAD_ADDRESS);
+}
+
+TEST_CASE(PushBufferDecoder_HandlerCanStop)
+{
+	uint32_t Words[] = { MethodWord(0x0100, 1), 1, MethodWord(0x0104, 1), 2, MethodWord(0x0108, 1), 3 };
+	PushBufferDecoder Decoder;
+	RecordingHandler Handler;
+	uint32_t dwStop = 0;
+
+	Handler.StopAfter = 2;
+	Decoder.Map(0x1000, Words, sizeof(Words));
+	TEST_CHECK_EQUAL(Decoder.Decode(0x1000, 0x1000 + sizeof(Words), &Handler, &dwStop), PUSHBUFFER_STOPPED);
+	TEST_CHECK_EQUAL(Handler.Commands.size(), 2);
+	TEST_CHECK_EQUAL(dwStop, 0x1010); // just past the second command
+}
+
+TEST_CASE(PushBufferDecoder_ReportsBrokenPushBuffers)
+{
+	PushBufferDecoder Decoder;
+	RecordingHandler Handler;
+	uint32_t dwStop = 0;
+
+	// the parameters run past the put address
+	uint32_t Truncated[] = { MethodWord(0x0100, 3), 1, 2, 3 };
+	Decoder.Map(0x1000, Truncated, sizeof(Truncated));
+	TEST_CHECK_EQUAL(Decoder.Decode(0x1000, 0x1008, &Handler, &dwStop), PUSHBUFFER_TRUNCATED);
+	TEST_CHECK_EQUAL(dwStop, 0x1000);
+
+	// the parameters run past the mapped memory
+	uint32_t Unmapped[] = { MethodWord(0x0100, 4), 1, 2, 3 };
+	Decoder.Map(0x5000, Unmapped, sizeof(Unmapped));
+	TEST_CHECK_EQUAL(Decoder.Decode(0x5000, 0x6000, &Handler), PUSHBUFFER_TRUNCATED);
+
+	// a jump to memory that isn't mapped
+	uint32_t Outside[] = { JumpWord(0x8000) };
+	Decoder.Map(0x2000, Outside, sizeof(Outside));
+	TEST_CHECK_EQUAL(Decoder.Decode(0x2000, 0x2004, &Handler, &dwStop), PUSHBUFFER_BAD_ADDRESS);
+	TEST_CHECK_EQUAL(dwStop, 0x8000);
+
+	// a call from within a call
+	uint32_t Nested[] = { CallWord(0x3004), CallWord(0x3008), PUSHBUFFER_COMMAND_RETURN };
+	Decoder.Map(0x3000, Nested, sizeof(Nested));
+	TEST_CHECK_EQUAL(Decoder.Decode(0x3000, 0x300C, &Handler), PUSHBUFFER_NESTED_CALL);
+
+	// a return without a call
+	TEST_CHECK_EQUAL(Decoder.Decode(0x3008, 0x300C, &Handler), PUSHBUFFER_BAD_RETURN);
+
+	// a jump to itself never reaches a method
+	uint32_t Loop[] = { JumpWord(0x4000) };
+	Decoder.Map(0x4000, Loop, sizeof(Loop));
+	TEST_CHECK_EQUAL(Decoder.Decode(0x4000, 0x4004, &Handler), PUSHBUFFER_RUNAWAY);
+
+	TEST_CHECK_EQUAL(Handler.Commands.size(), 0);
+}
+
+static bool ReadFile(const char *szFileName, std::vector<uint8_t> &Data)
+{
+	FILE *File = fopen(szFileName, "rb");
+	if (File == NULL)
+		return false;
+
+	uint8_t Buffer[4096];
+	size_t Read;
+	Data.clear();
+	while ((Read = fread(Buffer, 1, sizeof(Buffer), File)) > 0)
+		Data.insert(Data.end(), Buffer, Buffer + Read);
+
+	fclose(File);
+	return true;
+}
+
+TEST_CASE(PushBufferRecorder_SkipsUnchangedMemory)
+{
+	uint32_t Words[] = { MethodWord(0x17FC, 1), 5 };
+	std::vector<uint8_t> Capture;
+
+	{
+		PushBufferRecorder Recorder(TEST_CAPTURE_FILE);
+		TEST_CHECK(!Recorder.HasError());
+
+		Recorder.RecordMemory(0x1000, Words, sizeof(Words));
+		Recorder.RecordMemory(0x1000, Words, sizeof(Words)); // unchanged, not written
+		Words[1] = 6;
+		Recorder.RecordMemory(0x1000, Words, sizeof(Words));
+		Recorder.RecordDecode(0x1000, 0x1008);
+		Recorder.RecordFrame();
+		TEST_CHECK_EQUAL(Recorder.GetFrameCount(), 1);
+	}
+
+	TEST_CHECK(ReadFile(TEST_CAPTURE_FILE, Capture));
+
+	size_t MemoryRecordSize = sizeof(PushBufferRecordHeader) + sizeof(uint32_t) + sizeof(Words);
+	size_t ExpectedSize = sizeof(PushBufferCaptureHeader)
+		+ 2 * MemoryRecordSize
+		+ sizeof(PushBufferRecordHeader) + 2 * sizeof(uint32_t)
+		+ sizeof(PushBufferRecordHeader);
+	TEST_CHECK_EQUAL(Capture.size(), ExpectedSize);
+
+	PushBufferCaptureHeader Header;
+	memcpy(&Header, Capture.data(), sizeof(Header));
+	TEST_CHECK_EQUAL(Header.Magic, PUSHBUFFER_CAPTURE_MAGIC);
+	TEST_CHECK_EQUAL(Header.Version, PUSHBUFFER_CAPTURE_VERSION);
+
+	remove(TEST_CAPTURE_FILE);
+}
+
+TEST_CASE(PushBufferReplayer_ReplaysCapturedFrames)
+{
+	uint32_t Main[] = { MethodWord(0x17FC, 1), 5, CallWord(0x2000), MethodWord(0x17FC, 1), 0 };
+	uint32_t Sub[] = { MethodWord(0x1818, 4, 0, true), 1, 2, 3, 4, PUSHBUFFER_COMMAND_RETURN };
+
+	{
+		PushBufferRecorder Recorder(TEST_CAPTURE_FILE);
+
+		for (int Frame = 0; Frame < 3; Frame++) {
+			Recorder.RecordMemory(0x1000, Main, sizeof(Main));
+			Recorder.RecordMemory(0x2000, Sub, sizeof(Sub));
+			Recorder.RecordDecode(0x1000, 0x1000 + sizeof(Main));
+			Recorder.RecordFrame();
+		}
+	}
+
+	PushBufferReplayer Replayer(TEST_CAPTURE_FILE);
+	TEST_CHECK(!Replayer.HasError());
+
+	Replayer.Replay(2);
+	TEST_CHECK(!Replayer.HasError());
+	TEST_CHECK_EQUAL(Replayer.GetFrameCount(), 6);
+	TEST_CHECK_EQUAL(Replayer.GetDecodeCount(), 6);
+	TEST_CHECK_EQUAL(Replayer.GetFailureCount(), 0);
+	TEST_CHECK_EQUAL(Replayer.GetCommandCount(), 18);
+	TEST_CHECK_EQUAL(Replayer.GetMethodCount(NV2A_METHOD_SET_BEGIN_END), 12);
+	TEST_CHECK_EQUAL(Replayer.GetMethodCount(NV2A_METHOD_INLINE_VERTEX_ARRAY), 6);
+
+	remove(TEST_CAPTURE_FILE);
+}
+
+TEST_CASE(PushBufferReplayer_CountsMemoryOutsideTheCapture)
+{
+	// only the push buffer is captured, not the memory it calls into
+	uint32_t Main[] = { MethodWord(0x17FC, 1), 5, CallWord(0x2000), MethodWord(0x17FC, 1), 0 };
+
+	{
+		PushBufferRecorder Recorder(TEST_CAPTURE_FILE);
+		Recorder.RecordMemory(0x1000, Main, sizeof(Main));
+		Recorder.RecordDecode(0x1000, 0x1000 + sizeof(Main));
+		Recorder.RecordFrame();
+	}
+
+	PushBufferReplayer Replayer(TEST_CAPTURE_FILE);
+	Replayer.Replay();
+	TEST_CHECK_EQUAL(Replayer.GetDecodeCount(), 1);
+	TEST_CHECK_EQUAL(Replayer.GetFailureCount(), 1);
+	TEST_CHECK_EQUAL(Replayer.GetMissingMemoryCount(), 1);
+	TEST_CHECK_EQUAL(Replayer.GetCommandCount(), 1);
+
+	remove(TEST_CAPTURE_FILE);
+}
+
+TEST_CASE(PushBufferReplayer_RejectsBrokenCaptures)
+{
+	{
+		PushBufferReplayer Replayer("PushBufferDecoderTests.missing");
+		TEST_CHECK(Replayer.HasFatalError());
+	}
+
+	FILE *File = fopen(TEST_CAPTURE_FILE, "wb");
+	uint32_t NotACapture[] = { 0x12345678, PUSHBUFFER_CAPTURE_VERSION };
+	fwrite(NotACapture, sizeof(NotACapture), 1, File);
+	fclose(File);
+	{
+		PushBufferReplayer Replayer(TEST_CAPTURE_FILE);
+		TEST_CHECK(Replayer.HasFatalError());
+	}
+
+	// a memory record claiming more data than the file holds
+	File = fopen(TEST_CAPTURE_FILE, "wb");
+	uint32_t Truncated[] = { PUSHBUFFER_CAPTURE_MAGIC, PUSHBUFFER_CAPTURE_VERSION, PUSHBUFFER_RECORD_MEMORY, 0x100, 0x1000 };
+	fwrite(Truncated, sizeof(Truncated), 1, File);
+	fclose(File);
+	{
+		PushBufferReplayer Replayer(TEST_CAPTURE_FILE);
+		TEST_CHECK(!Replayer.HasFatalError());
+
+		Replayer.Replay();
+		TEST_CHECK(Replayer.HasError());
+		TEST_CHECK_EQUAL(Replayer.GetDecodeCount(), 0);
+	}
+
+	remove(TEST_CAPTURE_FILE);
+}
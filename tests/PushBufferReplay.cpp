@@ -0,0 +1,71 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->PushBufferReplay.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "Common/PushBufferDecoder.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+// Decodes a push buffer capture (made with the RecordPB debug console command)
+// without a GPU or a running title, like the ReplayPB command does :
+//
+//   PushBufferReplay <capture file> [repeat]
+//
+// Prints the per method counts and the decode throughput.
+int main(int argc, char *argv[])
+{
+	if (argc < 2 || argc > 3) {
+		printf("Usage : PushBufferReplay <capture file> [repeat]\n");
+		return 2;
+	}
+
+	uint32_t Repeat = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : 1;
+	if (Repeat == 0)
+		Repeat = 1;
+
+	PushBufferReplayer Replayer(argv[1]);
+
+	if (Replayer.HasFatalError()) {
+		printf("%s\n", Replayer.GetError().c_str());
+		return 1;
+	}
+
+	Replayer.Replay(Repeat);
+
+	if (Replayer.HasError())
+		printf("%s\n", Replayer.GetError().c_str());
+
+	Replayer.DumpStatistics(stdout);
+
+	return Replayer.HasError() ? 1 : 0;
+}
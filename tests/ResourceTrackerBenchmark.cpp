@@ -0,0 +1,123 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->ResourceTrackerBenchmark.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "HostBenchmark.h"
+#include "CxbxKrnl/ResourceTracker.h"
+
+#include <string>
+#include <vector>
+
+BENCHMARK_MAIN_GLOBALS
+
+// The linked list ResourceTracker this replaced, for comparison. Its insert
+// scanned the list for duplicates too; that's skipped while filling it here,
+// as it would make filling 100k entries take minutes.
+class ListResourceTracker : public Mutex
+{
+	public:
+		~ListResourceTracker()
+		{
+			while (m_head != nullptr) {
+				RTNode *tmp = m_head->pNext;
+				delete m_head;
+				m_head = tmp;
+			}
+		}
+
+		void append(uint32 uiKey, void *pResource)
+		{
+			RTNode *Node = new RTNode();
+			Node->uiKey = uiKey;
+			Node->pResource = pResource;
+			Node->pNext = m_head;
+			m_head = Node;
+		}
+
+		bool exists(uint32 uiKey)
+		{
+			Lock();
+			for (RTNode *cur = m_head; cur != nullptr; cur = cur->pNext)
+				if (cur->uiKey == uiKey) {
+					Unlock();
+					return true;
+				}
+			Unlock();
+			return false;
+		}
+
+	private:
+		RTNode *m_head = nullptr;
+};
+
+// Vertex buffer like keys : 16 byte aligned, somewhere in the contiguous region
+static uint32 Key(uint32 i)
+{
+	return 0x80000000 + ((i * 2654435761u) % 0x1000000) * 16;
+}
+
+int main(int argc, char *argv[])
+{
+	BenchmarkInit(argc, argv);
+
+	const uint32 Sizes[] = { 10000, 100000 };
+	for (uint32 Size : Sizes) {
+		std::string Name = std::to_string(Size) + " entries";
+
+		ResourceTracker Tracker;
+		ListResourceTracker List;
+		for (uint32 i = 0; i < Size; i++) {
+			Tracker.insert(Key(i), (void *)(uintptr_t)i);
+			List.append(Key(i), (void *)(uintptr_t)i);
+		}
+
+		BenchmarkRun(("ResourceTracker::exists (hash table), " + Name).c_str(), 2000000, 1, [&](unsigned i) {
+			BenchmarkKeep(Tracker.exists(Key(i % Size)));
+		});
+
+		BenchmarkRun(("ResourceTracker::exists (linked list), " + Name).c_str(), 2000000 / (Size / 100), 1, [&](unsigned i) {
+			BenchmarkKeep(List.exists(Key(i % Size)));
+		});
+
+		BenchmarkRun(("ResourceTracker::get (hash table, miss), " + Name).c_str(), 2000000, 1, [&](unsigned i) {
+			BenchmarkKeep(Tracker.get(Key(i % Size) + 4) != nullptr);
+		});
+
+		// Patched stream like churn : drop the oldest entry, add a new one
+		BenchmarkRun(("ResourceTracker::remove + insert (hash table), " + Name).c_str(), 2000000, 1, [&](unsigned i) {
+			Tracker.remove(Key(i));
+			Tracker.insert(Key(i + Size), (void *)(uintptr_t)i);
+		});
+	}
+
+	return 0;
+}
@@ -0,0 +1,170 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->ResourceTrackerTests.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "HostTest.h"
+
+// Included rather than linked, to reach the static RTHash
+#include "CxbxKrnl/ResourceTracker.cpp"
+
+#include <vector>
+
+// Average number of slots probed to insert Count keys Alignment bytes apart,
+// into a linear probing table of TableSize slots (like ResourceTracker::insert)
+static double AverageProbes(uint32_t Alignment, uint32_t TableSize, uint32_t Count)
+{
+	std::vector<bool> Used(TableSize);
+	uint32_t Probes = 0;
+	for (uint32_t i = 0; i < Count; i++) {
+		uint32_t Slot = RTHash(0x80400000 + i * Alignment, TableSize);
+		for (Probes++; Used[Slot]; Probes++)
+			Slot = (Slot + 1) & (TableSize - 1);
+		Used[Slot] = true;
+	}
+
+	return (double)Probes / Count;
+}
+
+TEST_CASE(RTHash_SpreadsAlignedKeys)
+{
+	// At the maximum load (half full), linear probing needs about 1.5 probes on
+	// average when keys are spread well; aligned pointer keys must be too
+	for (uint32_t Alignment = 4; Alignment <= 4096; Alignment <<= 1) {
+		TEST_CHECK(AverageProbes(Alignment, 1024, 512) < 2.0);
+		TEST_CHECK(AverageProbes(Alignment, 131072, 65536) < 2.0);
+	}
+
+	// And all hashes lie within the table
+	for (uint32_t Key = 0; Key < 100000; Key += 7)
+		TEST_CHECK(RTHash(Key * 2654435761u, 64) < 64);
+}
+
+TEST_CASE(ResourceTracker_InsertGetRemove)
+{
+	ResourceTracker Tracker;
+	int Values[3];
+
+	TEST_CHECK(!Tracker.exists(1));
+	TEST_CHECK(Tracker.get(1) == nullptr);
+	TEST_CHECK_EQUAL(Tracker.get_count(), 0);
+
+	Tracker.insert(1, &Values[0]);
+	Tracker.insert(2, &Values[1]);
+	Tracker.insert(3, &Values[2]);
+	TEST_CHECK_EQUAL(Tracker.get_count(), 3);
+	TEST_CHECK(Tracker.get(2) == &Values[1]);
+
+	// A second insert of an existing key is ignored
+	Tracker.insert(2, &Values[0]);
+	TEST_CHECK_EQUAL(Tracker.get_count(), 3);
+	TEST_CHECK(Tracker.get(2) == &Values[1]);
+
+	Tracker.remove(2);
+	TEST_CHECK(!Tracker.exists(2));
+	TEST_CHECK(Tracker.exists(1) && Tracker.exists(3));
+	TEST_CHECK_EQUAL(Tracker.get_count(), 2);
+
+	// Removing what isn't there changes nothing
+	Tracker.remove(2);
+	Tracker.remove(4);
+	TEST_CHECK_EQUAL(Tracker.get_count(), 2);
+
+	Tracker.remove(1);
+	Tracker.remove(3);
+	TEST_CHECK_EQUAL(Tracker.get_count(), 0);
+	TEST_CHECK(Tracker.getHead() == nullptr);
+
+	// Usable again after becoming empty
+	Tracker.insert(5, &Values[2]);
+	TEST_CHECK(Tracker.get(5) == &Values[2]);
+}
+
+TEST_CASE(ResourceTracker_PointerKeys)
+{
+	ResourceTracker Tracker;
+	std::vector<double> Resources(1000);
+
+	for (auto &Resource : Resources)
+		Tracker.insert(&Resource);
+
+	int Missing = 0;
+	for (auto &Resource : Resources)
+		if (!Tracker.exists(&Resource) || Tracker.get(&Resource) != &Resource)
+			Missing++;
+
+	TEST_CHECK_EQUAL(Missing, 0);
+	TEST_CHECK_EQUAL(Tracker.get_count(), 1000);
+}
+
+TEST_CASE(ResourceTracker_TraversalKeepsInsertionOrder)
+{
+	ResourceTracker Tracker;
+	for (uint32 i = 1; i <= 10; i++)
+		Tracker.insert(i * 16, (void *)(uintptr_t)i);
+
+	Tracker.remove(16);
+	Tracker.remove(5 * 16);
+	Tracker.remove(10 * 16);
+
+	std::vector<uint32> Keys;
+	for (RTNode *cur = Tracker.getHead(); cur != nullptr && cur->pNext != nullptr; cur = cur->pNext)
+		Keys.push_back(cur->uiKey);
+
+	std::vector<uint32> Expected = { 2 * 16, 3 * 16, 4 * 16, 6 * 16, 7 * 16, 8 * 16, 9 * 16 };
+	TEST_CHECK(Keys == Expected);
+}
+
+TEST_CASE(ResourceTracker_ChurnReusesRemovedSlots)
+{
+	// Removed slots must be reclaimed (or rehashed away), never breaking lookups
+	ResourceTracker Tracker;
+	int Errors = 0;
+
+	for (uint32 Round = 0; Round < 200; Round++) {
+		for (uint32 i = 0; i < 100; i++)
+			Tracker.insert(Round * 4096 + i * 16, (void *)(uintptr_t)(i + 1));
+
+		for (uint32 i = 0; i < 100; i += 2)
+			Tracker.remove(Round * 4096 + i * 16);
+
+		for (uint32 i = 0; i < 100; i++)
+			if (Tracker.exists(Round * 4096 + i * 16) != ((i & 1) == 1))
+				Errors++;
+	}
+
+	TEST_CHECK_EQUAL(Errors, 0);
+	TEST_CHECK_EQUAL(Tracker.get_count(), 200 * 50);
+
+	Tracker.clear();
+	TEST_CHECK_EQUAL(Tracker.get_count(), 0);
+	TEST_CHECK(!Tracker.exists(4096 + 16));
+}
@@ -0,0 +1,89 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->RtlPrimitivesBenchmark.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "HostBenchmark.h"
+#include "RtlPrimitivesReference.h"
+#include "Common/RtlPrimitives.h"
+
+#include <string>
+#include <vector>
+
+BENCHMARK_MAIN_GLOBALS
+
+// Runs a primitive and its reference on the same input, once per call
+template<class F, class R>
+static void BenchmarkPrimitive(const char *szName, size_t Length, F Primitive, R Reference)
+{
+	std::string Name = std::string(szName) + ", " + std::to_string(Length) + " bytes";
+	unsigned Iterations = (unsigned)(200000000 / (Length + 64));
+
+	BenchmarkRun((Name + ", reference (per call)").c_str(), Iterations, 1, [&](unsigned) { Reference(); });
+	BenchmarkRun((Name + ", RtlPrimitives (per call)").c_str(), Iterations, 1, [&](unsigned) { Primitive(); });
+}
+
+int main(int argc, char *argv[])
+{
+	BenchmarkInit(argc, argv);
+
+	// Short strings (file names, keys) up to the buffers titles parse assets from
+	for (size_t Length : { 16, 64, 256, 4096 }) {
+		// Offset by one, as buffers aren't necessarily aligned
+		std::vector<uint8_t> Source1(Length + 1, 0x5A), Source2(Length + 1, 0x5A), Destination(2 * Length + 2);
+		std::vector<uint16_t> Chars(Length / 2 + 1, 'a');
+
+		BenchmarkPrimitive("RtlCompareMemory", Length,
+			[&] { BenchmarkKeep(RtlpCompareMemory(&Source1[1], &Source2[1], Length)); },
+			[&] { BenchmarkKeep(ReferenceCompareMemory(&Source1[1], &Source2[1], Length)); });
+		BenchmarkPrimitive("RtlCompareMemoryUlong", Length,
+			[&] { BenchmarkKeep(RtlpCompareMemoryUlong(&Source1[1], Length, 0x5A5A5A5A)); },
+			[&] { BenchmarkKeep(ReferenceCompareMemoryUlong(&Source1[1], Length, 0x5A5A5A5A)); });
+		BenchmarkPrimitive("RtlFillMemoryUlong", Length,
+			[&] { RtlpFillMemoryUlong(&Destination[1], Length, 0x5A5A5A5A); BenchmarkKeep(Destination[2]); },
+			[&] { ReferenceFillMemoryUlong(&Destination[1], Length, 0x5A5A5A5A); BenchmarkKeep(Destination[2]); });
+
+		// The string primitives convert Length / 2 characters (ASCII, so none is left to the caller)
+		size_t Count = Length / 2;
+		uint16_t *pWide = (uint16_t *)Destination.data();
+		BenchmarkPrimitive("RtlUpcaseUnicodeString", Length,
+			[&] { BenchmarkKeep(RtlpUpcaseUnicodeAscii(pWide, &Chars[1], Count)); },
+			[&] { BenchmarkKeep(ReferenceUpcaseUnicodeAscii(pWide, &Chars[1], Count)); });
+		BenchmarkPrimitive("RtlMultiByteToUnicodeN", Length,
+			[&] { BenchmarkKeep(RtlpMultiByteToUnicodeN(pWide, Length, (const char *)&Source1[1], Count)); },
+			[&] { BenchmarkKeep(ReferenceMultiByteToUnicodeN(pWide, Length, (const char *)&Source1[1], Count)); });
+		BenchmarkPrimitive("RtlUnicodeToMultiByteN", Length,
+			[&] { BenchmarkKeep(RtlpUnicodeToMultiByteN((char *)&Destination[1], Count, &Chars[1], Length)); },
+			[&] { BenchmarkKeep(ReferenceUnicodeToMultiByteN((char *)&Destination[1], Count, &Chars[1], Length)); });
+	}
+
+	return 0;
+}
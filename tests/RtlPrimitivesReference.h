@@ -0,0 +1,123 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->RtlPrimitivesReference.h
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef RTLPRIMITIVESREFERENCE_H
+#define RTLPRIMITIVESREFERENCE_H
+
+// One character (or byte) at a time versions of the Rtl primitives, following the
+// documented kernel semantics on the Xbox : there are no code pages, ANSI strings are
+// Latin-1. Common/RtlPrimitives.cpp is tested and measured against these.
+// The volatile accesses keep the compiler from vectorizing them.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+inline size_t ReferenceCompareMemory(const void *pSource1, const void *pSource2, size_t Length)
+{
+	const volatile uint8_t *pBytes1 = (const uint8_t *)pSource1;
+	const volatile uint8_t *pBytes2 = (const uint8_t *)pSource2;
+	size_t i = 0;
+
+	while (i < Length && pBytes1[i] == pBytes2[i])
+		i++;
+
+	return i;
+}
+
+// Only whole ULONGs are compared, a partial one at the end is ignored
+inline size_t ReferenceCompareMemoryUlong(const void *pSource, size_t Length, uint32_t Pattern)
+{
+	const uint8_t *pBytes = (const uint8_t *)pSource;
+	size_t i = 0;
+
+	for (; i + 4 <= Length; i += 4) {
+		volatile uint32_t Value;
+		memcpy((void *)&Value, pBytes + i, 4);
+		if (Value != Pattern)
+			break;
+	}
+
+	return i;
+}
+
+inline void ReferenceFillMemoryUlong(void *pDestination, size_t Length, uint32_t Pattern)
+{
+	volatile uint8_t *pBytes = (uint8_t *)pDestination;
+
+	for (size_t i = 0; i + 4 <= Length; i += 4)
+		for (int b = 0; b < 4; b++)
+			pBytes[i + b] = (uint8_t)(Pattern >> (8 * b));
+}
+
+// Upcases a-z and leaves all other ASCII alone; returns where the first
+// character beyond ASCII is (which RtlUpcaseUnicodeChar handles instead)
+inline size_t ReferenceUpcaseUnicodeAscii(uint16_t *pDestination, const uint16_t *pSource, size_t Count)
+{
+	size_t i = 0;
+
+	for (; i < Count && pSource[i] <= 0x7F; i++) {
+		volatile uint16_t Char = pSource[i];
+		pDestination[i] = (Char >= 'a' && Char <= 'z') ? Char - ('a' - 'A') : Char;
+	}
+
+	return i;
+}
+
+// Returns the number of bytes written
+inline size_t ReferenceMultiByteToUnicodeN(uint16_t *pDestination, size_t MaxBytesInUnicodeString, const char *pSource, size_t BytesInMultiByteString)
+{
+	size_t i = 0;
+
+	for (; i < BytesInMultiByteString && (i + 1) * 2 <= MaxBytesInUnicodeString; i++) {
+		volatile uint8_t Byte = (uint8_t)pSource[i]; // zero extended, chars are signed
+		pDestination[i] = Byte;
+	}
+
+	return i * 2;
+}
+
+// Returns the number of bytes written
+inline size_t ReferenceUnicodeToMultiByteN(char *pDestination, size_t MaxBytesInMultiByteString, const uint16_t *pSource, size_t BytesInUnicodeString)
+{
+	size_t i = 0;
+
+	for (; (i + 1) * 2 <= BytesInUnicodeString && i < MaxBytesInMultiByteString; i++) {
+		volatile uint16_t Char = pSource[i];
+		pDestination[i] = (Char <= 0xFF) ? (char)Char : '?';
+	}
+
+	return i;
+}
+
+#endif // RTLPRIMITIVESREFERENCE_H
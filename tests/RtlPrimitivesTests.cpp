@@ -0,0 +1,357 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->RtlPrimitivesTests.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "HostTest.h"
+#include "RtlPrimitivesReference.h"
+#include "Common/RtlPrimitives.h"
+
+#include <cstdlib>
+#include <vector>
+
+// Every primitive is run at all source alignments, over lengths that cover the
+// vector loops, their scalar tails and lengths that aren't a multiple of the
+// element size, with guard bytes around the destination.
+#define MAX_LENGTH 100
+#define MAX_OFFSET 16
+#define GUARD 0xCD
+
+static std::vector<uint8_t> RandomBytes(size_t Size, int Range = 256)
+{
+	std::vector<uint8_t> Bytes(Size);
+	for (auto &Byte : Bytes)
+		Byte = (uint8_t)(rand() % Range);
+
+	return Bytes;
+}
+
+// Mostly ASCII, with Latin-1, other BMP characters and those from 0x8000 up mixed in
+static uint16_t RandomChar()
+{
+	switch (rand() % 8) {
+	case 0: return (uint16_t)(0x80 + rand() % 0x80);
+	case 1: return (uint16_t)(0x100 + rand() % 0x7F00);
+	case 2: return (uint16_t)(0x8000 | rand());
+	default: return (uint16_t)(rand() % 0x80);
+	}
+}
+
+static bool IsGuarded(const uint8_t *pBytes, size_t Size)
+{
+	for (size_t i = 0; i < Size; i++)
+		if (pBytes[i] != GUARD)
+			return false;
+
+	return true;
+}
+
+TEST_CASE(RtlPrimitives_CompareMemoryFindsEveryMismatch)
+{
+	std::vector<uint8_t> Source1 = RandomBytes(MAX_OFFSET + MAX_LENGTH);
+
+	for (size_t Offset = 0; Offset < MAX_OFFSET; Offset++) {
+		for (size_t Length = 0; Length <= MAX_LENGTH; Length++) {
+			std::vector<uint8_t> Source2 = Source1;
+
+			TEST_CHECK_EQUAL(RtlpCompareMemory(&Source1[Offset], &Source2[Offset], Length), Length);
+
+			// the first mismatch counts, wherever it is in a vector
+			for (size_t Mismatch = 0; Mismatch < Length; Mismatch++) {
+				Source2[Offset + Mismatch] ^= 0x80;
+				TEST_CHECK_EQUAL(RtlpCompareMemory(&Source1[Offset], &Source2[Offset], Length), Mismatch);
+				if (Mismatch + 5 < Length)
+					Source2[Offset + Mismatch + 5] ^= 1;
+				TEST_CHECK_EQUAL(RtlpCompareMemory(&Source1[Offset], &Source2[Offset], Length), Mismatch);
+				Source2 = Source1;
+			}
+		}
+	}
+
+	// Differing buffers are equal over no length, and a buffer is equal to itself
+	TEST_CHECK_EQUAL(RtlpCompareMemory("a", "b", 0), 0);
+	TEST_CHECK_EQUAL(RtlpCompareMemory(Source1.data(), Source1.data(), Source1.size()), Source1.size());
+}
+
+TEST_CASE(RtlPrimitives_CompareMemoryUlongCountsWholeUlongs)
+{
+	static const uint32_t Pattern = 0x80FF0102;
+
+	for (size_t Offset = 0; Offset < MAX_OFFSET; Offset++) {
+		for (size_t Length = 0; Length <= MAX_LENGTH; Length++) {
+			std::vector<uint8_t> Source(MAX_OFFSET + MAX_LENGTH + 4);
+			for (size_t i = 0; i + 4 <= Source.size() - Offset; i += 4)
+				memcpy(&Source[Offset + i], &Pattern, 4);
+
+			// a partial ULONG at the end is never compared
+			TEST_CHECK_EQUAL(RtlpCompareMemoryUlong(&Source[Offset], Length, Pattern), Length & ~3);
+			if (Length % 4 != 0) {
+				Source[Offset + Length - 1] ^= 1;
+				TEST_CHECK_EQUAL(RtlpCompareMemoryUlong(&Source[Offset], Length, Pattern), Length & ~3);
+				Source[Offset + Length - 1] ^= 1;
+			}
+
+			// a mismatch in any of its bytes stops at the start of its ULONG
+			for (size_t Mismatch = 0; Mismatch < (Length & ~3); Mismatch++) {
+				Source[Offset + Mismatch] ^= 0x40;
+				TEST_CHECK_EQUAL(RtlpCompareMemoryUlong(&Source[Offset], Length, Pattern), Mismatch & ~3);
+				TEST_CHECK_EQUAL(RtlpCompareMemoryUlong(&Source[Offset], Length, Pattern),
+					ReferenceCompareMemoryUlong(&Source[Offset], Length, Pattern));
+				Source[Offset + Mismatch] ^= 0x40;
+			}
+		}
+	}
+}
+
+TEST_CASE(RtlPrimitives_FillMemoryUlongStopsAtTheLastWholeUlong)
+{
+	static const uint32_t Pattern = 0x04030201;
+
+	for (size_t Offset = 0; Offset < MAX_OFFSET; Offset++) {
+		for (size_t Length = 0; Length <= MAX_LENGTH; Length++) {
+			std::vector<uint8_t> Actual(MAX_OFFSET + MAX_LENGTH + 16, GUARD);
+			std::vector<uint8_t> Expected = Actual;
+
+			RtlpFillMemoryUlong(&Actual[Offset], Length, Pattern);
+			ReferenceFillMemoryUlong(&Expected[Offset], Length, Pattern);
+
+			TEST_CHECK_MEMORY(Actual.data(), Expected.data(), Actual.size());
+			TEST_CHECK(IsGuarded(&Actual[Offset + (Length & ~3)], Actual.size() - Offset - (Length & ~3)));
+			if (Length >= 4)
+				TEST_CHECK_EQUAL(Actual[Offset + 3], 0x04); // little endian, like the Xbox
+		}
+	}
+}
+
+// The ASCII upcase stops at the first character the caller has to upcase another way
+struct UpcaseCase
+{
+	const char *szName;
+	uint16_t Char;
+	bool bStops;
+	uint16_t Upcased;
+};
+
+TEST_CASE(RtlPrimitives_UpcaseUnicodeAsciiEdges)
+{
+	static const UpcaseCase Cases[] = {
+		{ "a", 'a', false, 'A' },
+		{ "z", 'z', false, 'Z' },
+		{ "before a", '`', false, '`' },
+		{ "after z", '{', false, '{' },
+		{ "A", 'A', false, 'A' },
+		{ "before A", '@', false, '@' },
+		{ "after Z", '[', false, '[' },
+		{ "NUL", 0, false, 0 },
+		{ "DEL", 0x7F, false, 0x7F },
+		{ "Latin-1 a grave", 0xE0, true },
+		{ "Latin-1 y diaeresis", 0xFF, true },
+		{ "first non Latin-1", 0x100, true },
+		{ "lowest sign bit", 0x8000, true },
+		{ "highest", 0xFFFF, true },
+		{ "fullwidth a", 0xFF41, true },
+	};
+
+	for (const UpcaseCase &Case : Cases) {
+		int FailuresBefore = g_HostTestFailures;
+
+		// at every position in a vector and its tail, among lower case letters
+		for (size_t Position = 0; Position < 24; Position++) {
+			uint16_t Source[24], Destination[24];
+			for (size_t i = 0; i < 24; i++)
+				Source[i] = (uint16_t)('a' + i);
+			Source[Position] = Case.Char;
+			memset(Destination, GUARD, sizeof(Destination));
+
+			size_t Done = RtlpUpcaseUnicodeAscii(Destination, Source, 24);
+
+			if (Case.bStops) {
+				TEST_CHECK_EQUAL(Done, Position);
+				TEST_CHECK(IsGuarded((uint8_t *)&Destination[Position], (24 - Position) * 2));
+			}
+			else {
+				TEST_CHECK_EQUAL(Done, 24);
+				TEST_CHECK_EQUAL(Destination[Position], Case.Upcased);
+			}
+
+			for (size_t i = 0; i < Done; i++)
+				if (i != Position)
+					TEST_CHECK_EQUAL(Destination[i], 'A' + i);
+		}
+
+		if (g_HostTestFailures != FailuresBefore)
+			printf("  in case \"%s\"\n", Case.szName);
+	}
+}
+
+TEST_CASE(RtlPrimitives_UpcaseUnicodeAsciiMatchesReference)
+{
+	for (size_t Offset = 0; Offset < MAX_OFFSET; Offset++) {
+		for (size_t Count = 0; Count <= MAX_LENGTH; Count++) {
+			std::vector<uint16_t> Source(MAX_OFFSET + MAX_LENGTH);
+			for (auto &Char : Source)
+				Char = (rand() % 16 == 0) ? RandomChar() : (uint16_t)(0x20 + rand() % 0x60);
+
+			std::vector<uint16_t> Actual(MAX_LENGTH, 0xCDCD), Expected(MAX_LENGTH, 0xCDCD);
+			TEST_CHECK_EQUAL(RtlpUpcaseUnicodeAscii(Actual.data(), &Source[Offset], Count),
+				ReferenceUpcaseUnicodeAscii(Expected.data(), &Source[Offset], Count));
+			TEST_CHECK_MEMORY(Actual.data(), Expected.data(), Actual.size() * 2);
+
+			// in place, as RtlUpcaseUnicodeString may be called
+			std::vector<uint16_t> InPlace = Source;
+			size_t Done = RtlpUpcaseUnicodeAscii(&InPlace[Offset], &InPlace[Offset], Count);
+			TEST_CHECK_MEMORY(&InPlace[Offset], Expected.data(), Done * 2);
+		}
+	}
+}
+
+// The N variants take byte counts, which may be odd, and convert what fits
+struct ConversionCase
+{
+	const char *szName;
+	size_t MaxBytes;        // in the destination
+	size_t SourceBytes;
+	size_t BytesWritten;
+};
+
+TEST_CASE(RtlPrimitives_MultiByteToUnicodeN)
+{
+	static const ConversionCase Cases[] = {
+		{ "empty", 64, 0, 0 },
+		{ "no room", 0, 10, 0 },
+		{ "room for half a character", 1, 10, 0 },
+		{ "odd room", 7, 10, 6 },
+		{ "exact room", 20, 10, 10 * 2 },
+		{ "more room", 64, 10, 10 * 2 },
+		{ "vector and tail", 200, 37, 37 * 2 },
+		{ "truncated in a vector", 41, 37, 20 * 2 },
+	};
+
+	// All bytes, including NUL (there's no terminator) and those with the sign bit set
+	char Source[64];
+	for (int i = 0; i < 64; i++)
+		Source[i] = (char)((i * 37) & 0xFF);
+	Source[5] = 0;
+
+	for (const ConversionCase &Case : Cases) {
+		int FailuresBefore = g_HostTestFailures;
+		uint16_t Actual[100], Expected[100];
+		memset(Actual, GUARD, sizeof(Actual));
+		memset(Expected, GUARD, sizeof(Expected));
+
+		TEST_CHECK_EQUAL(RtlpMultiByteToUnicodeN(Actual, Case.MaxBytes, Source, Case.SourceBytes), Case.BytesWritten);
+		TEST_CHECK_EQUAL(ReferenceMultiByteToUnicodeN(Expected, Case.MaxBytes, Source, Case.SourceBytes), Case.BytesWritten);
+		TEST_CHECK_MEMORY(Actual, Expected, sizeof(Actual));
+		TEST_CHECK(IsGuarded((uint8_t *)Actual + Case.BytesWritten, sizeof(Actual) - Case.BytesWritten));
+
+		if (g_HostTestFailures != FailuresBefore)
+			printf("  in case \"%s\"\n", Case.szName);
+	}
+
+	// Latin-1 is zero extended
+	uint16_t Chars[3];
+	TEST_CHECK_EQUAL(RtlpMultiByteToUnicodeN(Chars, sizeof(Chars), "\x7F\x80\xFF", 3), 6);
+	TEST_CHECK_EQUAL(Chars[0], 0x7F);
+	TEST_CHECK_EQUAL(Chars[1], 0x80);
+	TEST_CHECK_EQUAL(Chars[2], 0xFF);
+}
+
+TEST_CASE(RtlPrimitives_UnicodeToMultiByteN)
+{
+	static const ConversionCase Cases[] = {
+		{ "empty", 64, 0, 0 },
+		{ "no room", 0, 20, 0 },
+		{ "half a character", 64, 1, 0 },
+		{ "odd source", 64, 21, 10 },
+		{ "exact room", 10, 20, 10 },
+		{ "less room", 7, 20, 7 },
+		{ "vector and tail", 100, 2 * 37, 37 },
+		{ "truncated in a vector", 21, 2 * 37, 21 },
+	};
+
+	// Characters that fit in Latin-1 (NUL and 0xFF too), and those that become '?'
+	uint16_t Source[64];
+	static const uint16_t Edges[] = { 0, 'a', 0x7F, 0x80, 0xFF, 0x100, 0x1FF, 0x7FFF, 0x8000, 0x80FF, 0xFFFF };
+	for (int i = 0; i < 64; i++)
+		Source[i] = Edges[(i * 7) % (sizeof(Edges) / sizeof(Edges[0]))];
+
+	for (const ConversionCase &Case : Cases) {
+		int FailuresBefore = g_HostTestFailures;
+		char Actual[100], Expected[100];
+		memset(Actual, GUARD, sizeof(Actual));
+		memset(Expected, GUARD, sizeof(Expected));
+
+		TEST_CHECK_EQUAL(RtlpUnicodeToMultiByteN(Actual, Case.MaxBytes, Source, Case.SourceBytes), Case.BytesWritten);
+		TEST_CHECK_EQUAL(ReferenceUnicodeToMultiByteN(Expected, Case.MaxBytes, Source, Case.SourceBytes), Case.BytesWritten);
+		TEST_CHECK_MEMORY(Actual, Expected, sizeof(Actual));
+		TEST_CHECK(IsGuarded((uint8_t *)Actual + Case.BytesWritten, sizeof(Actual) - Case.BytesWritten));
+
+		if (g_HostTestFailures != FailuresBefore)
+			printf("  in case \"%s\"\n", Case.szName);
+	}
+
+	char Chars[5];
+	static const uint16_t Wide[5] = { 0xFF, 0x100, 0x8000, 0xFFFF, 0x80 };
+	TEST_CHECK_EQUAL(RtlpUnicodeToMultiByteN(Chars, sizeof(Chars), Wide, sizeof(Wide)), 5);
+	TEST_CHECK_MEMORY(Chars, "\xFF???\x80", 5);
+}
+
+TEST_CASE(RtlPrimitives_ConversionsMatchReference)
+{
+	for (size_t Offset = 0; Offset < MAX_OFFSET; Offset++) {
+		for (size_t Count = 0; Count <= MAX_LENGTH; Count++) {
+			std::vector<uint8_t> Bytes = RandomBytes(MAX_OFFSET + MAX_LENGTH);
+			std::vector<uint16_t> Chars(MAX_OFFSET + MAX_LENGTH);
+			for (auto &Char : Chars)
+				Char = RandomChar();
+
+			// odd byte counts on either side, and destinations smaller than the source
+			size_t MaxBytes = rand() % (2 * MAX_LENGTH + 2);
+			size_t UnicodeBytes = 2 * Count + rand() % 2;
+
+			std::vector<uint16_t> ActualWide(MAX_LENGTH + 1, 0xCDCD), ExpectedWide(MAX_LENGTH + 1, 0xCDCD);
+			TEST_CHECK_EQUAL(RtlpMultiByteToUnicodeN(ActualWide.data(), MaxBytes, (const char *)&Bytes[Offset], Count),
+				ReferenceMultiByteToUnicodeN(ExpectedWide.data(), MaxBytes, (const char *)&Bytes[Offset], Count));
+			TEST_CHECK_MEMORY(ActualWide.data(), ExpectedWide.data(), ExpectedWide.size() * 2);
+
+			std::vector<char> ActualNarrow(2 * MAX_LENGTH + 2, '#'), ExpectedNarrow(2 * MAX_LENGTH + 2, '#');
+			TEST_CHECK_EQUAL(RtlpUnicodeToMultiByteN(ActualNarrow.data(), MaxBytes, &Chars[Offset], UnicodeBytes),
+				ReferenceUnicodeToMultiByteN(ExpectedNarrow.data(), MaxBytes, &Chars[Offset], UnicodeBytes));
+			TEST_CHECK_MEMORY(ActualNarrow.data(), ExpectedNarrow.data(), ExpectedNarrow.size());
+
+			// and back : Latin-1 round trips
+			std::vector<char> Narrow(MAX_LENGTH);
+			RtlpUnicodeToMultiByteN(Narrow.data(), Count, ActualWide.data(), 2 * Count);
+			size_t Widened = RtlpMultiByteToUnicodeN(ActualWide.data(), MaxBytes, Narrow.data(), Count) / 2;
+			TEST_CHECK_MEMORY(ActualWide.data(), ExpectedWide.data(), Widened * 2);
+		}
+	}
+}
@@ -0,0 +1,85 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->SwizzleBenchmark.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "HostBenchmark.h"
+#include "SwizzleReference.h"
+#include "CxbxKrnl/EmuXTL.h"
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace XTL;
+
+BENCHMARK_MAIN_GLOBALS
+
+int main(int argc, char *argv[])
+{
+	bool bQuick = BenchmarkInit(argc, argv);
+
+	// Square textures from 1x1 up to 4096x4096, swizzled and unswizzled entirely by
+	// the previous per pixel loop, and by the table driven tiled version
+	const DWORD Sizes[] = { 1, 4, 16, 64, 256, 1024, 4096 };
+	const DWORD TexelSizes[] = { 1, 2, 4, 8, 16 };
+	for (DWORD dwBPP : TexelSizes) {
+		for (DWORD dwSize : Sizes) {
+			if (bQuick && dwSize > 256)
+				break; // the smoke test doesn't need to stream through hundreds of megabytes
+
+			const DWORD dwTexels = dwSize * dwSize, dwPitch = dwSize * dwBPP;
+			std::vector<uint08> Swizzled(dwTexels * dwBPP), Linear(Swizzled.size());
+			for (auto &Byte : Swizzled)
+				Byte = (uint08)rand();
+
+			// About the same amount of texels per measurement, for every size
+			const unsigned Iterations = (16u << 20) / dwTexels + 1;
+			std::string Name = std::to_string(dwSize) + "x" + std::to_string(dwSize) + ", " + std::to_string(dwBPP) + " bpp, ";
+
+			BenchmarkRun((Name + "unswizzle, per pixel loop (per texel)").c_str(), Iterations, dwTexels, [&](unsigned) {
+				ReferenceSwizzleRect(false, Swizzled.data(), dwSize, dwSize, 1, Linear.data(), dwPitch, dwBPP);
+			});
+			BenchmarkRun((Name + "unswizzle, EmuUnswizzleBox (per texel)").c_str(), Iterations, dwTexels, [&](unsigned) {
+				EmuUnswizzleBox(Swizzled.data(), dwSize, dwSize, 1, 0, 0, 0, Linear.data(), dwPitch, dwPitch * dwSize, dwSize, dwSize, 1, dwBPP);
+			});
+			BenchmarkRun((Name + "swizzle, per pixel loop (per texel)").c_str(), Iterations, dwTexels, [&](unsigned) {
+				ReferenceSwizzleRect(true, Swizzled.data(), dwSize, dwSize, 1, Linear.data(), dwPitch, dwBPP);
+			});
+			BenchmarkRun((Name + "swizzle, EmuSwizzleBox (per texel)").c_str(), Iterations, dwTexels, [&](unsigned) {
+				EmuSwizzleBox(Linear.data(), dwPitch, dwPitch * dwSize, Swizzled.data(), dwSize, dwSize, 1, 0, 0, 0, dwSize, dwSize, 1, dwBPP);
+			});
+			BenchmarkKeep(Swizzled[0] ^ Linear[0]);
+		}
+	}
+
+	return 0;
+}
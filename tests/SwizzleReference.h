@@ -0,0 +1,100 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->SwizzleReference.h
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef SWIZZLEREFERENCE_H
+#define SWIZZLEREFERENCE_H
+
+// The per pixel (un)swizzle loop EmuUnswizzleRect used before EmuD3D8/Swizzle.cpp,
+// kept as the reference the table driven version is tested and measured against.
+// It steps through the swizzle masks, copying every texel with a memcpy.
+
+#include "CxbxKrnl/Emu.h"
+
+#include <cstring>
+
+inline void ReferenceSwizzleMasks(DWORD dwWidth, DWORD dwHeight, DWORD dwDepth, DWORD *pMaskX, DWORD *pMaskY, DWORD *pMaskZ)
+{
+	DWORD dwMaskX = 0, dwMaskY = 0, dwMaskZ = 0;
+	for (uint i=1, j=1; (i <= dwWidth) || (i <= dwHeight) || (i <= dwDepth); i <<= 1) {
+		if (i < dwWidth) {
+			dwMaskX = dwMaskX | j;
+			j <<= 1;
+		};
+
+		if (i < dwHeight) {
+			dwMaskY = dwMaskY | j;
+			j <<= 1;
+		}
+
+		if (i < dwDepth) {
+			dwMaskZ = dwMaskZ | j;
+			j <<= 1;
+		}
+	}
+
+	*pMaskX = dwMaskX;
+	*pMaskY = dwMaskY;
+	*pMaskZ = dwMaskZ;
+}
+
+// Converts an entire swizzled image into a linear one (or the reverse, when bSwizzle is set)
+inline void ReferenceSwizzleRect(bool bSwizzle, PBYTE pSwizzled, DWORD dwWidth, DWORD dwHeight, DWORD dwDepth, PBYTE pLinear, DWORD dwPitch, DWORD dwBPP)
+{
+	DWORD dwMaskX, dwMaskY, dwMaskZ;
+
+	ReferenceSwizzleMasks(dwWidth, dwHeight, dwDepth, &dwMaskX, &dwMaskY, &dwMaskZ);
+
+	DWORD dwZ = 0;
+	for (uint z = 0; z < dwDepth; z++) {
+		DWORD dwY = 0;
+		for (uint y = 0; y < dwHeight; y++) {
+			DWORD dwX = 0;
+			for (uint x = 0; x < dwWidth; x++) {
+				int delta = ((dwX | dwY | dwZ) * dwBPP);
+				if (bSwizzle)
+					memcpy(pSwizzled + delta, pLinear, dwBPP);
+				else
+					memcpy(pLinear, pSwizzled + delta, dwBPP); // copy one pixel
+				pLinear += dwBPP; // Step to next pixel in the linear image
+				dwX = (dwX - dwMaskX) & dwMaskX; // step to next pixel in the swizzled image
+			}
+
+			pLinear += dwPitch - (dwWidth * dwBPP); // step to next line in the linear image
+			dwY = (dwY - dwMaskY) & dwMaskY; // step to next line in the swizzled image
+		}
+
+		dwZ = (dwZ - dwMaskZ) & dwMaskZ; // step to next level in the swizzled image
+	}
+}
+
+#endif // SWIZZLEREFERENCE_H
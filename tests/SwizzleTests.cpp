@@ -0,0 +1,205 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->SwizzleTests.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "HostTest.h"
+#include "SwizzleReference.h"
+#include "CxbxKrnl/EmuXTL.h"
+
+#include <cstdlib>
+#include <vector>
+
+using namespace XTL;
+
+static const DWORD TexelSizes[] = { 1, 2, 3, 4, 8, 12, 16 };
+
+// The size of a swizzled image; non power of two sizes address up to the next powers of two
+static size_t SwizzledSize(DWORD dwWidth, DWORD dwHeight, DWORD dwDepth, DWORD dwBPP)
+{
+	size_t Size = 1;
+	while (Size < (size_t)dwWidth * dwHeight * dwDepth * 8)
+		Size <<= 1;
+
+	return Size * dwBPP;
+}
+
+static std::vector<uint08> RandomBytes(size_t Size)
+{
+	std::vector<uint08> Bytes(Size);
+	for (auto &Byte : Bytes)
+		Byte = (uint08)rand();
+
+	return Bytes;
+}
+
+static DWORD RandomExtent(bool bPowerOfTwo, DWORD dwMaxLog2)
+{
+	return bPowerOfTwo ? (1u << (rand() % (dwMaxLog2 + 1))) : (1 + rand() % ((1u << dwMaxLog2) + 7));
+}
+
+TEST_CASE(Swizzle_MortonOrder)
+{
+	// A 4x4 image of 1 byte texels holding their linear index, swizzled by hand
+	static const uint08 Expected[16] = {
+		0,  1,  4,  5,
+		2,  3,  6,  7,
+		8,  9, 12, 13,
+		10, 11, 14, 15,
+	};
+
+	uint08 Linear[16], Swizzled[16];
+	for (int i = 0; i < 16; i++)
+		Linear[i] = (uint08)i;
+
+	EmuSwizzleBox(Linear, 4, 16, Swizzled, 4, 4, 1, 0, 0, 0, 4, 4, 1, 1);
+	TEST_CHECK_MEMORY(Swizzled, Expected, sizeof(Expected));
+
+	// When one dimension runs out of bits, the bits of the other follow contiguously :
+	// the swizzled offsets of the texels of an 8x2 image, in linear order
+	static const uint08 WideOffsets[16] = {
+		0, 1, 4, 5,  8,  9, 12, 13,
+		2, 3, 6, 7, 10, 11, 14, 15,
+	};
+
+	EmuSwizzleBox(Linear, 8, 16, Swizzled, 8, 2, 1, 0, 0, 0, 8, 2, 1, 1);
+	for (int i = 0; i < 16; i++)
+		TEST_CHECK_EQUAL(Swizzled[WideOffsets[i]], Linear[i]);
+}
+
+TEST_CASE(Swizzle_UnswizzleMatchesReference)
+{
+	srand(1);
+	for (int i = 0; i < 400; i++) {
+		DWORD dwWidth = RandomExtent(i % 3 != 0, 7);
+		DWORD dwHeight = RandomExtent(i % 3 != 0, 7);
+		DWORD dwDepth = (i % 4 == 0) ? RandomExtent(true, 2) : 1;
+		DWORD dwBPP = TexelSizes[rand() % ARRAYSIZE(TexelSizes)];
+		DWORD dwPitch = dwWidth * dwBPP + (rand() % 3) * 4;
+
+		std::vector<uint08> Swizzled = RandomBytes(SwizzledSize(dwWidth, dwHeight, dwDepth, dwBPP));
+		std::vector<uint08> Expected(dwPitch * dwHeight * dwDepth), Actual(Expected.size());
+
+		ReferenceSwizzleRect(false, Swizzled.data(), dwWidth, dwHeight, dwDepth, Expected.data(), dwPitch, dwBPP);
+		EmuUnswizzleBox(Swizzled.data(), dwWidth, dwHeight, dwDepth, 0, 0, 0, Actual.data(), dwPitch, dwPitch * dwHeight, dwWidth, dwHeight, dwDepth, dwBPP);
+		TEST_CHECK(Actual == Expected);
+	}
+}
+
+TEST_CASE(Swizzle_SwizzleMatchesReference)
+{
+	srand(2);
+	for (int i = 0; i < 400; i++) {
+		DWORD dwWidth = RandomExtent(true, 7);
+		DWORD dwHeight = RandomExtent(true, 7);
+		DWORD dwDepth = (i % 4 == 0) ? RandomExtent(true, 2) : 1;
+		DWORD dwBPP = TexelSizes[rand() % ARRAYSIZE(TexelSizes)];
+		DWORD dwPitch = dwWidth * dwBPP + (rand() % 3) * 4;
+
+		std::vector<uint08> Linear = RandomBytes(dwPitch * dwHeight * dwDepth);
+		std::vector<uint08> Expected(dwWidth * dwHeight * dwDepth * dwBPP), Actual(Expected.size());
+
+		ReferenceSwizzleRect(true, Expected.data(), dwWidth, dwHeight, dwDepth, Linear.data(), dwPitch, dwBPP);
+		EmuSwizzleBox(Linear.data(), dwPitch, dwPitch * dwHeight, Actual.data(), dwWidth, dwHeight, dwDepth, 0, 0, 0, dwWidth, dwHeight, dwDepth, dwBPP);
+		TEST_CHECK(Actual == Expected);
+	}
+}
+
+TEST_CASE(Swizzle_Roundtrip)
+{
+	srand(3);
+	for (int i = 0; i < 200; i++) {
+		DWORD dwWidth = RandomExtent(true, 8);
+		DWORD dwHeight = RandomExtent(true, 8);
+		DWORD dwDepth = (i % 4 == 0) ? RandomExtent(true, 3) : 1;
+		DWORD dwBPP = TexelSizes[rand() % ARRAYSIZE(TexelSizes)];
+		DWORD dwRowSize = dwWidth * dwBPP;
+
+		std::vector<uint08> Linear = RandomBytes(dwRowSize * dwHeight * dwDepth);
+		std::vector<uint08> Swizzled(Linear.size()), Result(Linear.size());
+
+		EmuSwizzleBox(Linear.data(), dwRowSize, dwRowSize * dwHeight, Swizzled.data(), dwWidth, dwHeight, dwDepth, 0, 0, 0, dwWidth, dwHeight, dwDepth, dwBPP);
+		EmuUnswizzleBox(Swizzled.data(), dwWidth, dwHeight, dwDepth, 0, 0, 0, Result.data(), dwRowSize, dwRowSize * dwHeight, dwWidth, dwHeight, dwDepth, dwBPP);
+		TEST_CHECK(Result == Linear);
+	}
+}
+
+// Copying a sub-box must give the same texels as copying the entire image, at the offset
+TEST_CASE(Swizzle_SubBox)
+{
+	srand(4);
+	for (int i = 0; i < 300; i++) {
+		DWORD dwWidth = RandomExtent(true, 7);
+		DWORD dwHeight = RandomExtent(true, 7);
+		DWORD dwDepth = (i % 3 == 0) ? RandomExtent(true, 3) : 1;
+		DWORD dwBPP = TexelSizes[rand() % ARRAYSIZE(TexelSizes)];
+		DWORD dwRowSize = dwWidth * dwBPP, dwSliceSize = dwRowSize * dwHeight;
+
+		DWORD dwX = rand() % dwWidth, dwY = rand() % dwHeight, dwZ = rand() % dwDepth;
+		DWORD dwCopyWidth = 1 + rand() % (dwWidth - dwX);
+		DWORD dwCopyHeight = 1 + rand() % (dwHeight - dwY);
+		DWORD dwCopyDepth = 1 + rand() % (dwDepth - dwZ);
+		DWORD dwSubRowSize = dwCopyWidth * dwBPP, dwSubSliceSize = dwSubRowSize * dwCopyHeight;
+
+		std::vector<uint08> Swizzled = RandomBytes(dwSliceSize * dwDepth);
+		std::vector<uint08> Linear(Swizzled.size());
+		EmuUnswizzleBox(Swizzled.data(), dwWidth, dwHeight, dwDepth, 0, 0, 0, Linear.data(), dwRowSize, dwSliceSize, dwWidth, dwHeight, dwDepth, dwBPP);
+
+		// Unswizzling the sub-box reads the same texels
+		std::vector<uint08> Sub(dwSubSliceSize * dwCopyDepth);
+		EmuUnswizzleBox(Swizzled.data(), dwWidth, dwHeight, dwDepth, dwX, dwY, dwZ, Sub.data(), dwSubRowSize, dwSubSliceSize, dwCopyWidth, dwCopyHeight, dwCopyDepth, dwBPP);
+		for (DWORD z = 0; z < dwCopyDepth; z++)
+			for (DWORD y = 0; y < dwCopyHeight; y++)
+				TEST_CHECK(memcmp(&Sub[z * dwSubSliceSize + y * dwSubRowSize], &Linear[(dwZ + z) * dwSliceSize + (dwY + y) * dwRowSize + dwX * dwBPP], dwSubRowSize) == 0);
+
+		// Swizzling it back (the way XGSwizzleRect and XGSwizzleBox do) writes only the sub-box
+		std::vector<uint08> Patched = RandomBytes(Sub.size());
+		std::vector<uint08> Expected = Linear;
+		for (DWORD z = 0; z < dwCopyDepth; z++)
+			for (DWORD y = 0; y < dwCopyHeight; y++)
+				memcpy(&Expected[(dwZ + z) * dwSliceSize + (dwY + y) * dwRowSize + dwX * dwBPP], &Patched[z * dwSubSliceSize + y * dwSubRowSize], dwSubRowSize);
+
+		EmuSwizzleBox(Patched.data(), dwSubRowSize, dwSubSliceSize, Swizzled.data(), dwWidth, dwHeight, dwDepth, dwX, dwY, dwZ, dwCopyWidth, dwCopyHeight, dwCopyDepth, dwBPP);
+		EmuUnswizzleBox(Swizzled.data(), dwWidth, dwHeight, dwDepth, 0, 0, 0, Linear.data(), dwRowSize, dwSliceSize, dwWidth, dwHeight, dwDepth, dwBPP);
+		TEST_CHECK(Linear == Expected);
+	}
+}
+
+TEST_CASE(Swizzle_EmptyBox)
+{
+	uint08 Src[16] = { 1 }, Dst[16] = { 0 }, Zero[16] = { 0 };
+
+	EmuSwizzleBox(Src, 4, 16, Dst, 4, 4, 1, 0, 0, 0, 0, 4, 1, 1);
+	EmuSwizzleBox(Src, 4, 16, Dst, 4, 4, 1, 0, 0, 0, 4, 0, 1, 1);
+	EmuSwizzleBox(Src, 4, 16, Dst, 4, 4, 1, 0, 0, 0, 4, 4, 0, 1);
+	EmuUnswizzleBox(Src, 4, 4, 1, 0, 0, 0, Dst, 4, 16, 4, 4, 1, 0);
+	TEST_CHECK_MEMORY(Dst, Zero, sizeof(Dst));
+}
@@ -0,0 +1,184 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->TextureCacheTests.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "HostTest.h"
+#include "CxbxKrnl/EmuXTL.h"
+
+#include <vector>
+
+using namespace XTL;
+
+// Counts the references the cache gives back. The cache is global, so textures from
+// earlier tests may be evicted by later ones; these must outlive the tests (be static).
+struct FakeTexture : public IDirect3DBaseTexture8
+{
+	ULONG Releases = 0;
+	ULONG Release() override { return ++Releases; }
+};
+
+// A 64x64 32 bit texture with 2 levels, spread over 5 pages
+static TEXTURE_CACHE_KEY MakeKey()
+{
+	TEXTURE_CACHE_KEY Key = { 0 };
+
+	Key.Format = 0x12345678;
+	Key.Size = 0;
+	Key.DataSize = 64 * 64 * 4 + 32 * 32 * 4;
+	Key.LevelCount = 2;
+	Key.LevelEnd[0] = 64 * 64 * 4;
+	Key.LevelEnd[1] = Key.DataSize;
+	return Key;
+}
+
+static std::vector<uint08> MakeData(uint08 Seed)
+{
+	std::vector<uint08> Data(MakeKey().DataSize);
+	for (size_t i = 0; i < Data.size(); i++)
+		Data[i] = (uint08)(i * 7 + Seed);
+
+	return Data;
+}
+
+TEST_CASE(TextureCache_ReusesReleasedTexture)
+{
+	TEXTURE_CACHE_KEY Key = MakeKey();
+	std::vector<uint08> Data = MakeData(1), Copy = Data;
+	X_D3DResource A = { 0 }, B = { 0 };
+	static FakeTexture Texture;
+	DWORD dwDirtyLevels = ~0U;
+
+	EmuTextureCacheInitialize(0);
+	TEST_CHECK(EmuTextureCacheLookup(&A, Data.data(), &Key, &dwDirtyLevels) == nullptr);
+	EmuTextureCacheInsert(&A, &Texture, Data.data(), &Key, Key.DataSize);
+	EmuTextureCacheRelease(&A);
+
+	// The same contents, registered from elsewhere, reuse the texture without an upload
+	TEST_CHECK(EmuTextureCacheLookup(&B, Copy.data(), &Key, &dwDirtyLevels) == &Texture);
+	TEST_CHECK_EQUAL(dwDirtyLevels, 0);
+	EmuTextureCacheRelease(&B);
+
+	// Different contents don't
+	Copy[100]++;
+	TEST_CHECK(EmuTextureCacheLookup(&B, Copy.data(), &Key, &dwDirtyLevels) == nullptr);
+	TEST_CHECK_EQUAL(Texture.Releases, 0);
+}
+
+// Live resources with identical contents must not share a host texture, since locking
+// one of them (which detaches it's texture from the cache) would change the others too
+TEST_CASE(TextureCache_NeverSharesBetweenLiveResources)
+{
+	TEXTURE_CACHE_KEY Key = MakeKey();
+	std::vector<uint08> Data = MakeData(2), Copy = Data;
+	X_D3DResource A = { 0 }, B = { 0 }, C = { 0 };
+	static FakeTexture TextureA, TextureB;
+	DWORD dwDirtyLevels;
+
+	EmuTextureCacheInitialize(0);
+	EmuTextureCacheLookup(&A, Data.data(), &Key, &dwDirtyLevels);
+	EmuTextureCacheInsert(&A, &TextureA, Data.data(), &Key, Key.DataSize);
+
+	// A still uses it's texture, so B gets one of it's own
+	TEST_CHECK(EmuTextureCacheLookup(&B, Copy.data(), &Key, &dwDirtyLevels) == nullptr);
+	EmuTextureCacheInsert(&B, &TextureB, Copy.data(), &Key, Key.DataSize);
+
+	// A is locked for writing; it's texture may no longer be handed out, even once A is released
+	EmuTextureCacheDetach(&TextureA);
+	EmuTextureCacheRelease(&A);
+	TEST_CHECK(EmuTextureCacheLookup(&C, Data.data(), &Key, &dwDirtyLevels) == nullptr);
+
+	// B's texture can be reused once B is released
+	EmuTextureCacheRelease(&B);
+	TEST_CHECK(EmuTextureCacheLookup(&C, Data.data(), &Key, &dwDirtyLevels) == &TextureB);
+	EmuTextureCacheRelease(&C);
+}
+
+TEST_CASE(TextureCache_UploadsOnlyChangedLevels)
+{
+	TEXTURE_CACHE_KEY Key = MakeKey();
+	std::vector<uint08> Data = MakeData(3);
+	X_D3DResource A = { 0 }, B = { 0 };
+	static FakeTexture Texture;
+	DWORD dwDirtyLevels;
+
+	EmuTextureCacheInitialize(0);
+	EmuTextureCacheLookup(&A, Data.data(), &Key, &dwDirtyLevels);
+	EmuTextureCacheInsert(&A, &Texture, Data.data(), &Key, Key.DataSize);
+
+	// While A uses the texture, changed contents at the same address need a texture of their own
+	Data[Key.LevelEnd[0] + 1]++;
+	TEST_CHECK(EmuTextureCacheLookup(&B, Data.data(), &Key, &dwDirtyLevels) == nullptr);
+	EmuTextureCacheRelease(&B);
+
+	// Once A is released (and registered again), only the level on the changed page is uploaded
+	EmuTextureCacheRelease(&A);
+	TEST_CHECK(EmuTextureCacheLookup(&A, Data.data(), &Key, &dwDirtyLevels) == &Texture);
+	TEST_CHECK_EQUAL(dwDirtyLevels, 2);
+
+	TEXTURE_CACHE_STATISTICS Statistics;
+	EmuTextureCacheGetStatistics(&Statistics);
+	TEST_CHECK(Statistics.PartialHits >= 1);
+	EmuTextureCacheRelease(&A);
+}
+
+TEST_CASE(TextureCache_EvictsUnusedTextures)
+{
+	TEXTURE_CACHE_KEY Key = MakeKey();
+	std::vector<uint08> Data = MakeData(4), Other = MakeData(5);
+	X_D3DResource A = { 0 }, B = { 0 };
+	static FakeTexture TextureA, TextureB;
+	DWORD dwDirtyLevels;
+	TEXTURE_CACHE_STATISTICS Statistics;
+
+	EmuTextureCacheInitialize(0);
+	EmuTextureCacheGetStatistics(&Statistics);
+	DWORD dwEvictions = Statistics.Evictions;
+
+	EmuTextureCacheLookup(&A, Data.data(), &Key, &dwDirtyLevels);
+	EmuTextureCacheInsert(&A, &TextureA, Data.data(), &Key, Key.DataSize);
+	EmuTextureCacheLookup(&B, Other.data(), &Key, &dwDirtyLevels);
+	EmuTextureCacheInsert(&B, &TextureB, Other.data(), &Key, Key.DataSize);
+	EmuTextureCacheRelease(&A);
+
+	// A budget of nothing releases every unused texture not handed out in the last two frames
+	EmuTextureCacheInitialize(1);
+	TEST_CHECK_EQUAL(TextureA.Releases, 0);
+	EmuTextureCacheEndFrame();
+	EmuTextureCacheEndFrame();
+	TEST_CHECK_EQUAL(TextureA.Releases, 1);
+	TEST_CHECK_EQUAL(TextureB.Releases, 0); // B still uses it's texture
+
+	EmuTextureCacheGetStatistics(&Statistics);
+	TEST_CHECK(Statistics.Evictions > dwEvictions);
+	EmuTextureCacheRelease(&B);
+	EmuTextureCacheInitialize(0);
+}
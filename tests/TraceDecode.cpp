@@ -0,0 +1,74 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->TraceDecode.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "Common/TraceDecoder.h"
+
+#include <cstdio>
+
+// Renders a trace file (written while the TraceRing debug console command was on)
+// as text, without the emulator, like the DecodeTrace command does :
+//
+//   TraceDecode <trace file> [text file]
+//
+// Writes to stdout when no text file is given.
+int main(int argc, char *argv[])
+{
+	if (argc < 2 || argc > 3) {
+		printf("Usage : TraceDecode <trace file> [text file]\n");
+		return 2;
+	}
+
+	TraceDecoder Decoder(argv[1]);
+
+	if (Decoder.HasFatalError()) {
+		fprintf(stderr, "%s\n", Decoder.GetError().c_str());
+		return 1;
+	}
+
+	FILE *Output = (argc > 2) ? fopen(argv[2], "w") : stdout;
+	if (Output == NULL) {
+		fprintf(stderr, "Could not create %s\n", argv[2]);
+		return 1;
+	}
+
+	Decoder.Render(Output);
+
+	if (Output != stdout)
+		fclose(Output);
+
+	fprintf(stderr, "%u events, %u dropped\n", Decoder.GetEventCount(), Decoder.GetDroppedCount());
+	if (Decoder.HasError())
+		fprintf(stderr, "%s\n", Decoder.GetError().c_str());
+
+	return Decoder.HasError() ? 1 : 0;
+}
@@ -0,0 +1,392 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->TraceDecoderTests.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "HostTest.h"
+#include "Common/TraceDecoder.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#define TEST_TRACE_FILE "TraceDecoderTests.trace"
+
+// Renders a trace file, and returns the text
+static std::string Render(TraceDecoder &Decoder)
+{
+	FILE *File = tmpfile();
+	Decoder.Render(File);
+
+	std::string Text;
+	char Buffer[256];
+	rewind(File);
+	while (fgets(Buffer, sizeof(Buffer), File) != NULL)
+		Text += Buffer;
+
+	fclose(File);
+	return Text;
+}
+
+// The lines of a rendered trace, without the time and thread id in front of each event
+static std::vector<std::string> RenderedLines(TraceDecoder &Decoder)
+{
+	std::string Text = Render(Decoder);
+	std::vector<std::string> Lines;
+	size_t Start = 0, End;
+
+	while ((End = Text.find('\n', Start)) != std::string::npos) {
+		std::string Line = Text.substr(Start, End - Start);
+		size_t Prefix = Line.find("] ");
+		Lines.push_back((Prefix != std::string::npos) ? Line.substr(Prefix + 2) : Line);
+		Start = End + 1;
+	}
+
+	return Lines;
+}
+
+// Builds trace files by hand, to feed the decoder what TraceRing never writes
+class TraceFileBuilder
+{
+	public:
+		TraceFileBuilder()
+		{
+			TraceFileHeader Header = { TRACE_FILE_MAGIC, TRACE_FILE_VERSION, 1000000 };
+			Append(&Header, sizeof(Header));
+		}
+
+		void Record(uint32_t Type, const void *pData, uint32_t Size, uint32_t RecordSize)
+		{
+			TraceFileRecord Header = { Type, RecordSize };
+			Append(&Header, sizeof(Header));
+			Append(pData, Size);
+		}
+
+		void Record(uint32_t Type, const void *pData, uint32_t Size) { Record(Type, pData, Size, Size); }
+
+		void String(uint32_t Id, const char *szString)
+		{
+			std::vector<uint8_t> Data(sizeof(Id) + strlen(szString));
+			memcpy(&Data[0], &Id, sizeof(Id));
+			memcpy(&Data[sizeof(Id)], szString, strlen(szString));
+			Record(TRACE_RECORD_STRING, Data.data(), (uint32_t)Data.size());
+		}
+
+		// a printf event with one argument (a string when szString is given)
+		void Printf(uint32_t FormatId, uint64_t Value, const char *szString = nullptr, uint8_t StringsUsed = 0)
+		{
+			TraceFileEvent Event = {};
+			TraceFileArg Arg = { 0, 0, Value };
+			Event.Kind = TRACE_KIND_PRINTF;
+			Event.FormatId = FormatId;
+			Event.ArgCount = 1;
+
+			std::vector<uint8_t> Data(sizeof(Event) + sizeof(Arg));
+			if (szString != nullptr) {
+				Event.StringMask = 1;
+				Event.StringsUsed = (StringsUsed != 0) ? StringsUsed : (uint8_t)(strlen(szString) + 1);
+				Data.resize(Data.size() + Event.StringsUsed);
+				memcpy(&Data[sizeof(Event) + sizeof(Arg)], szString, strlen(szString) + 1);
+			}
+
+			memcpy(&Data[0], &Event, sizeof(Event));
+			memcpy(&Data[sizeof(Event)], &Arg, sizeof(Arg));
+			Record(TRACE_RECORD_EVENT, Data.data(), (uint32_t)Data.size());
+		}
+
+		void Write()
+		{
+			FILE *File = fopen(TEST_TRACE_FILE, "wb");
+			fwrite(m_Data.data(), 1, m_Data.size(), File);
+			fclose(File);
+		}
+
+		std::vector<uint8_t> m_Data;
+
+	private:
+		void Append(const void *pData, size_t Size)
+		{
+			m_Data.insert(m_Data.end(), (const uint8_t *)pData, (const uint8_t *)pData + Size);
+		}
+};
+
+static void TracedFunction(int Handle, const char *szName, float Scale)
+{
+	TraceRecord Call(TRACE_KIND_CALL, "TraceDecoderTests.cpp", "TracedFunction");
+	Call.Arg("Handle", Handle);
+	Call.Arg("szName", szName);
+	Call.Arg("Scale", Scale);
+}
+
+TEST_CASE(TraceDecoder_RendersWhatTraceRingWrote)
+{
+	TEST_CHECK(TraceRingStart(TEST_TRACE_FILE));
+	TracedFunction(5, "hello", 2.5f);
+	{
+		TraceRecord Result(TRACE_KIND_RESULT, "TraceDecoderTests.cpp", "TracedFunction");
+		Result.Arg("returns", 10);
+	}
+	{
+		TraceRecord Message(TRACE_KIND_MESSAGE, "TraceDecoderTests.cpp", "TracedFunction", " unimplemented!");
+	}
+	TraceRingPrintf("Value %d\n", 42);
+	TraceRingStop();
+
+	TraceDecoder Decoder(TEST_TRACE_FILE);
+	std::vector<std::string> Lines = RenderedLines(Decoder);
+
+	static const char *Expected[] = {
+		"TraceDecoderTests.cpp : TracedFunction(",
+		"   Handle               : 0x5",
+		"   szName               : \"hello\"",
+		"   Scale                : 2.5",
+		");",
+		"TraceDecoderTests.cpp : TracedFunction returns 0xA",
+		"TraceDecoderTests.cpp : TracedFunction unimplemented!",
+		"Value 42",
+	};
+
+	TEST_CHECK(!Decoder.HasError());
+	TEST_CHECK_EQUAL(Decoder.GetEventCount(), 4);
+	TEST_CHECK_EQUAL(Lines.size(), sizeof(Expected) / sizeof(Expected[0]));
+	for (size_t i = 0; i < Lines.size() && i < sizeof(Expected) / sizeof(Expected[0]); i++)
+		TEST_CHECK(Lines[i] == Expected[i]);
+
+	remove(TEST_TRACE_FILE);
+}
+
+TEST_CASE(TraceDecoder_RendersPrintfFormats)
+{
+	TEST_CHECK(TraceRingStart(TEST_TRACE_FILE));
+	TraceRingPrintf("%d %i %u\n", -3, 7, 0xFFFFFFFFu);
+	TraceRingPrintf("0x%08X %x %o\n", 0xBEEFu, 255, 8);
+	TraceRingPrintf("%s|%-5s|%5s\n", "abc", "ab", "cd");
+	TraceRingPrintf("%.2f %g\n", 3.14159f, 0.5);
+	TraceRingPrintf("%lld %I64X %llu\n", -(1LL << 40), 1ULL << 40, 5ULL);
+	TraceRingPrintf("%*d|%-*d|\n", 6, 42, 4, 7);
+	TraceRingPrintf("%c%c 100%%\n", 'O', 'K');
+	TraceRingPrintf("%p\n", (void *)0x1234);
+	TraceRingPrintf("%d %d\n", 1);
+	TraceRingPrintf("%d %d %d %d %d %d %d %d %d %d %d %d %d %d\n", 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14);
+	TraceRingStop();
+
+	static const char *Expected[] = {
+		"-3 7 4294967295",
+		"0x0000BEEF ff 10",
+		"abc|ab   |   cd",
+		"3.14 0.5",
+		"-1099511627776 10000000000 5",
+		"    42|7   |",
+		"OK 100%",
+		"00001234",
+		"1 <missing>",
+		"1 2 3 4 5 6 7 8 9 10 11 12 ... ...",
+	};
+
+	TraceDecoder Decoder(TEST_TRACE_FILE);
+	std::vector<std::string> Lines = RenderedLines(Decoder);
+
+	TEST_CHECK_EQUAL(Lines.size(), sizeof(Expected) / sizeof(Expected[0]));
+	for (size_t i = 0; i < Lines.size() && i < sizeof(Expected) / sizeof(Expected[0]); i++) {
+		if (Lines[i] != Expected[i])
+			printf("  rendered \"%s\", expected \"%s\"\n", Lines[i].c_str(), Expected[i]);
+		TEST_CHECK(Lines[i] == Expected[i]);
+	}
+
+	remove(TEST_TRACE_FILE);
+}
+
+TEST_CASE(TraceDecoder_LongStringsKeepTheirAddress)
+{
+	std::string Long(2 * TRACE_STRING_SPACE, 'x');
+
+	TEST_CHECK(TraceRingStart(TEST_TRACE_FILE));
+	TraceRingPrintf("%s %s\n", Long.c_str(), (const char *)0x5678);
+	TraceRingStop();
+
+	TraceDecoder Decoder(TEST_TRACE_FILE);
+	std::vector<std::string> Lines = RenderedLines(Decoder);
+
+	// the first string is cut to the space there is, which leaves none for the second
+	TEST_CHECK_EQUAL(Lines.size(), 1);
+	if (Lines.size() == 1)
+		TEST_CHECK(Lines[0] == std::string(TRACE_STRING_SPACE - 1, 'x') + " (string at 0x00005678)");
+
+	remove(TEST_TRACE_FILE);
+}
+
+TEST_CASE(TraceDecoder_CountsDroppedEvents)
+{
+	TraceFileBuilder Builder;
+	uint32_t Dropped[2] = { 0x10, 7 };
+	Builder.Record(TRACE_RECORD_DROPPED, Dropped, sizeof(Dropped));
+	Builder.Record(TRACE_RECORD_DROPPED, Dropped, sizeof(Dropped));
+	Builder.Write();
+
+	TraceDecoder Decoder(TEST_TRACE_FILE);
+	std::vector<std::string> Lines = RenderedLines(Decoder);
+
+	TEST_CHECK(!Decoder.HasError());
+	TEST_CHECK_EQUAL(Decoder.GetDroppedCount(), 14);
+	TEST_CHECK_EQUAL(Lines.size(), 2);
+
+	remove(TEST_TRACE_FILE);
+}
+
+TEST_CASE(TraceDecoder_RejectsWhatIsNotATrace)
+{
+	{
+		TraceDecoder Decoder("TraceDecoderTests.missing");
+		TEST_CHECK(Decoder.HasFatalError());
+	}
+
+	TraceFileBuilder Builder;
+	Builder.m_Data.resize(sizeof(TraceFileHeader) - 1);
+	Builder.Write();
+	{
+		TraceDecoder Decoder(TEST_TRACE_FILE);
+		TEST_CHECK(Decoder.HasFatalError());
+	}
+
+	Builder = TraceFileBuilder();
+	Builder.m_Data[0] ^= 1; // magic
+	Builder.Write();
+	{
+		TraceDecoder Decoder(TEST_TRACE_FILE);
+		TEST_CHECK(Decoder.HasFatalError());
+		TEST_CHECK(Render(Decoder).empty());
+	}
+
+	remove(TEST_TRACE_FILE);
+}
+
+// Malformed records are skipped, and the records after them still decoded
+struct MalformedCase
+{
+	const char *szName;
+	void (*Build)(TraceFileBuilder &Builder);
+};
+
+static const uint8_t Zeroes[sizeof(TraceFileEvent) + TRACE_MAX_ARGS * sizeof(TraceFileArg) + 256] = {};
+
+static const MalformedCase MalformedCases[] = {
+	{ "empty string record", [](TraceFileBuilder &B) { B.Record(TRACE_RECORD_STRING, Zeroes, 0); } },
+	{ "string record shorter than its id", [](TraceFileBuilder &B) { B.Record(TRACE_RECORD_STRING, Zeroes, 3); } },
+	{ "empty event record", [](TraceFileBuilder &B) { B.Record(TRACE_RECORD_EVENT, Zeroes, 0); } },
+	{ "event record shorter than an event", [](TraceFileBuilder &B) { B.Record(TRACE_RECORD_EVENT, Zeroes, sizeof(TraceFileEvent) - 1); } },
+	{ "dropped record shorter than its counts", [](TraceFileBuilder &B) { B.Record(TRACE_RECORD_DROPPED, Zeroes, 4); } },
+	{ "more strings than fit in an event", [](TraceFileBuilder &B) {
+		std::string Long(200, 's');
+		B.Printf(1, 0, Long.c_str(), 201);
+	} },
+	{ "more arguments than fit in an event", [](TraceFileBuilder &B) {
+		TraceFileEvent Event = {};
+		Event.Kind = TRACE_KIND_CALL;
+		Event.ArgCount = TRACE_MAX_ARGS + 1;
+		std::vector<uint8_t> Data(sizeof(Event) + Event.ArgCount * sizeof(TraceFileArg));
+		memcpy(&Data[0], &Event, sizeof(Event));
+		B.Record(TRACE_RECORD_EVENT, Data.data(), (uint32_t)Data.size());
+	} },
+	{ "event size that doesn't match its contents", [](TraceFileBuilder &B) {
+		TraceFileEvent Event = {};
+		Event.Kind = TRACE_KIND_PRINTF;
+		Event.ArgCount = 1;
+		B.Record(TRACE_RECORD_EVENT, &Event, sizeof(Event));
+	} },
+};
+
+TEST_CASE(TraceDecoder_SkipsMalformedRecords)
+{
+	for (const MalformedCase &Case : MalformedCases) {
+		int FailuresBefore = g_HostTestFailures;
+		TraceFileBuilder Builder;
+
+		Builder.String(1, "before %d\n");
+		Builder.String(2, "after %s\n");
+		Builder.Printf(1, 1);
+		Case.Build(Builder);
+		Builder.Printf(2, 0, "ok");
+		Builder.Write();
+
+		TraceDecoder Decoder(TEST_TRACE_FILE);
+		std::vector<std::string> Lines = RenderedLines(Decoder);
+
+		TEST_CHECK(Decoder.HasError());
+		TEST_CHECK(!Decoder.HasFatalError());
+		TEST_CHECK_EQUAL(Decoder.GetEventCount(), 2);
+		TEST_CHECK_EQUAL(Lines.size(), 2);
+		if (Lines.size() == 2) {
+			TEST_CHECK(Lines[0] == "before 1");
+			TEST_CHECK(Lines[1] == "after ok");
+		}
+
+		if (g_HostTestFailures != FailuresBefore)
+			printf("  in case \"%s\"\n", Case.szName);
+	}
+
+	remove(TEST_TRACE_FILE);
+}
+
+TEST_CASE(TraceDecoder_StopsAtATruncatedRecord)
+{
+	TraceFileBuilder Builder;
+	Builder.String(1, "%d\n");
+	Builder.Printf(1, 5);
+	Builder.Printf(1, 6);
+	Builder.m_Data.resize(Builder.m_Data.size() - 1);
+	Builder.Write();
+
+	TraceDecoder Decoder(TEST_TRACE_FILE);
+	std::vector<std::string> Lines = RenderedLines(Decoder);
+
+	TEST_CHECK(Decoder.HasError());
+	TEST_CHECK_EQUAL(Decoder.GetEventCount(), 1);
+	TEST_CHECK_EQUAL(Lines.size(), 1);
+
+	remove(TEST_TRACE_FILE);
+}
+
+TEST_CASE(TraceDecoder_IgnoresStringOffsetsOutsideTheEvent)
+{
+	TraceFileBuilder Builder;
+	Builder.String(1, "%s\n");
+	Builder.Printf(1, 10, "abc"); // offset 10 of 4 used characters
+	Builder.Write();
+
+	TraceDecoder Decoder(TEST_TRACE_FILE);
+	std::vector<std::string> Lines = RenderedLines(Decoder);
+
+	TEST_CHECK_EQUAL(Lines.size(), 1);
+	if (Lines.size() == 1)
+		TEST_CHECK(Lines[0] == "(string at 0x0000000A)");
+
+	remove(TEST_TRACE_FILE);
+}
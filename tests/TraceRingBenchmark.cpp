@@ -0,0 +1,155 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->TraceRingBenchmark.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "HostBenchmark.h"
+#include "Common/Logging.h"
+#include "Common/TraceDecoder.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+BENCHMARK_MAIN_GLOBALS
+
+volatile bool g_bPrintfOn = false;
+
+#define BENCHMARK_TRACE_FILE "TraceRingBenchmark.trace"
+
+#ifdef _WIN32
+#define NULL_DEVICE "NUL"
+#else
+#define NULL_DEVICE "/dev/null"
+#endif
+
+// text output goes here, so only the formatting is measured
+static FILE *g_NullFile = nullptr;
+
+// Shaped like a kernel export : a call with a handful of arguments, and its result
+static int LoggedFunction(int Handle, const char *szName, float Scale, uint32_t Flags)
+{
+	LOG_FUNC_BEGIN
+		LOG_FUNC_ARG(Handle)
+		LOG_FUNC_ARG(szName)
+		LOG_FUNC_ARG(Scale)
+		LOG_FUNC_ARG(Flags)
+	LOG_FUNC_END;
+
+	RETURN(Handle * 2);
+}
+
+// What DbgPrintf does, printing to g_NullFile instead of stdout
+#define BenchmarkDbgPrintf(fmt, ...) do { if(g_bTraceRingOn) TraceRingPrintf(fmt, ##__VA_ARGS__); else if(g_bPrintfOn) fprintf(g_NullFile, "[0x%X] " fmt, GetCurrentThreadId(), ##__VA_ARGS__); } while (0)
+
+// The ring drops events once the caller outpaces the drain thread, and dropping is
+// cheaper than recording. So the trace ring is measured in bursts that fill at most
+// half a ring each, with an (untimed) pause between them for the drain thread.
+template<class F>
+void BenchmarkBursts(const char *szName, unsigned EventsPerCall, F Body)
+{
+	const unsigned CallsPerBurst = TRACE_RING_SIZE / 2 / EventsPerCall;
+	const unsigned Bursts = BenchmarkIterations(64000) / 1000 + 1;
+	double Seconds = 0;
+	unsigned Call = 0;
+
+	for (unsigned b = 0; b < Bursts; b++) {
+		auto Start = std::chrono::steady_clock::now();
+		for (unsigned i = 0; i < CallsPerBurst; i++)
+			Body(Call++);
+		Seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(20)); // twice the drain interval
+	}
+
+	printf("%-60s %12.2f ns/op\n", szName, (Seconds * 1e9) / Call);
+}
+
+// Measures the cost per log call on the calling thread, for each way logging can be set up :
+// off, recording into the trace ring (while the drain thread writes a file), and text.
+int main(int argc, char *argv[])
+{
+	BenchmarkInit(argc, argv);
+
+	g_NullFile = fopen(NULL_DEVICE, "w");
+	if (g_NullFile == nullptr) {
+		printf("Could not open %s\n", NULL_DEVICE);
+		return 1;
+	}
+
+	const unsigned Calls = 1000000;
+
+	BenchmarkRun("logging off : DbgPrintf", Calls, 1, [](unsigned i) {
+		BenchmarkDbgPrintf("frame %d, %s\n", i, "abc");
+	});
+	BenchmarkRun("logging off : LOG_FUNC_BEGIN .. RETURN", Calls, 1, [](unsigned i) {
+		BenchmarkKeep(LoggedFunction(i, "name", 1.0f, 0x10));
+	});
+
+	if (!TraceRingStart(BENCHMARK_TRACE_FILE)) {
+		printf("Could not create %s\n", BENCHMARK_TRACE_FILE);
+		return 1;
+	}
+
+	BenchmarkBursts("trace ring : DbgPrintf", 1, [](unsigned i) {
+		BenchmarkDbgPrintf("frame %d, %s\n", i, "abc");
+	});
+	BenchmarkBursts("trace ring : LOG_FUNC_BEGIN .. RETURN (2 events)", 2, [](unsigned i) {
+		BenchmarkKeep(LoggedFunction(i, "name", 1.0f, 0x10));
+	});
+
+	TraceRingStop();
+
+	// any dropped events would make the numbers above too optimistic
+	TraceDecoder Decoder(BENCHMARK_TRACE_FILE);
+	Decoder.Render(g_NullFile);
+	printf("trace ring : %u events written, %u dropped\n", Decoder.GetEventCount(), Decoder.GetDroppedCount());
+
+	std::ofstream NullStream(NULL_DEVICE);
+	std::streambuf *pCout = std::cout.rdbuf(NullStream.rdbuf());
+	g_bPrintfOn = true;
+
+	BenchmarkRun("text : DbgPrintf", Calls / 10, 1, [](unsigned i) {
+		BenchmarkDbgPrintf("frame %d, %s\n", i, "abc");
+	});
+	BenchmarkRun("text : LOG_FUNC_BEGIN .. RETURN", Calls / 10, 1, [](unsigned i) {
+		BenchmarkKeep(LoggedFunction(i, "name", 1.0f, 0x10));
+	});
+
+	g_bPrintfOn = false;
+	std::cout.rdbuf(pCout);
+
+	fclose(g_NullFile);
+	remove(BENCHMARK_TRACE_FILE);
+	return 0;
+}
@@ -0,0 +1,83 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->VertexConvertBenchmark.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "HostBenchmark.h"
+#include "CxbxKrnl/EmuXTL.h"
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace XTL;
+
+BENCHMARK_MAIN_GLOBALS
+
+int main(int argc, char *argv[])
+{
+	BenchmarkInit(argc, argv);
+
+	static const struct { const char *szName; DWORD XboxType; } Types[] = {
+		{ "NORMPACKED3", X_D3DVSDT_NORMPACKED3 },
+		{ "SHORT3", X_D3DVSDT_SHORT3 },
+		{ "PBYTE4", X_D3DVSDT_PBYTE4 },
+		{ "NORMSHORT2", X_D3DVSDT_NORMSHORT2 },
+		{ "NORMSHORT3", X_D3DVSDT_NORMSHORT3 },
+		{ "FLOAT2H", X_D3DVSDT_FLOAT2H },
+	};
+
+	// One attribute of a 32 byte vertex, converted into a 48 byte host vertex, for
+	// a batch that fits in the caches, and one that streams through memory
+	const UINT uiSrcStride = 32, uiDstStride = 48;
+	const UINT Counts[] = { 1024, 65536 };
+	for (UINT uiCount : Counts) {
+		std::vector<uint08> Src(uiSrcStride * uiCount), Dst(uiDstStride * uiCount);
+		for (auto &Byte : Src)
+			Byte = (uint08)rand();
+
+		for (auto &Type : Types) {
+			UINT uiSrcSize;
+			VertexConvertKernel Reference = EmuGetVertexConvertReferenceKernel(Type.XboxType, &uiSrcSize);
+			VertexConvertKernel Kernel = EmuGetVertexConvertKernel(Type.XboxType, &uiSrcSize);
+			std::string Name = std::string(Type.szName) + ", " + std::to_string(uiCount) + " vertices, ";
+
+			BenchmarkRun((Name + "reference (per vertex)").c_str(), 13107200 / uiCount, uiCount, [&](unsigned) {
+				Reference(Src.data(), uiSrcStride, Dst.data(), uiDstStride, uiCount);
+			});
+			BenchmarkRun((Name + "selected kernel (per vertex)").c_str(), 13107200 / uiCount, uiCount, [&](unsigned) {
+				Kernel(Src.data(), uiSrcStride, Dst.data(), uiDstStride, uiCount);
+			});
+		}
+	}
+
+	return 0;
+}
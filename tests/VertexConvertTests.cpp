@@ -0,0 +1,217 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->VertexConvertTests.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "HostTest.h"
+#include "CxbxKrnl/EmuXTL.h"
+
+#include <cstdlib>
+#include <vector>
+
+using namespace XTL;
+
+struct VertexType
+{
+	const char *szName;
+	DWORD XboxType;
+	UINT uiSrcSize;
+	UINT uiDstSize;
+};
+
+static const VertexType VertexTypes[] = {
+	{ "NORMPACKED3", X_D3DVSDT_NORMPACKED3,  4, 12 },
+	{ "SHORT1",      X_D3DVSDT_SHORT1,       2,  4 },
+	{ "SHORT3",      X_D3DVSDT_SHORT3,       6,  8 },
+	{ "PBYTE1",      X_D3DVSDT_PBYTE1,       1,  4 },
+	{ "PBYTE2",      X_D3DVSDT_PBYTE2,       2,  8 },
+	{ "PBYTE3",      X_D3DVSDT_PBYTE3,       3, 12 },
+	{ "PBYTE4",      X_D3DVSDT_PBYTE4,       4, 16 },
+	{ "NORMSHORT1",  X_D3DVSDT_NORMSHORT1,   2,  4 },
+	{ "NORMSHORT2",  X_D3DVSDT_NORMSHORT2,   4,  8 },
+	{ "NORMSHORT3",  X_D3DVSDT_NORMSHORT3,   6, 12 },
+	{ "NORMSHORT4",  X_D3DVSDT_NORMSHORT4,   8, 16 },
+	{ "FLOAT2H",     X_D3DVSDT_FLOAT2H,     12, 16 },
+};
+
+static float Float(const uint08 *p, int i)
+{
+	float f;
+	memcpy(&f, p + i * sizeof(float), sizeof(f));
+	return f;
+}
+
+TEST_CASE(VertexConvert_KernelTable)
+{
+	for (auto &Type : VertexTypes) {
+		UINT uiSrcSize = 0;
+		TEST_CHECK(EmuGetVertexConvertKernel(Type.XboxType, &uiSrcSize) != nullptr);
+		TEST_CHECK_EQUAL(uiSrcSize, Type.uiSrcSize);
+		uiSrcSize = 0;
+		TEST_CHECK(EmuGetVertexConvertReferenceKernel(Type.XboxType, &uiSrcSize) != nullptr);
+		TEST_CHECK_EQUAL(uiSrcSize, Type.uiSrcSize);
+	}
+
+	// Types the host supports as-is have no kernel
+	UINT uiSrcSize = 0;
+	TEST_CHECK(EmuGetVertexConvertKernel(0x42 /* X_D3DVSDT_FLOAT4 */, &uiSrcSize) == nullptr);
+	TEST_CHECK(EmuGetVertexConvertKernel(0x40 /* X_D3DVSDT_D3DCOLOR */, &uiSrcSize) == nullptr);
+}
+
+// Converts one attribute with the reference kernel
+static std::vector<uint08> ConvertOne(DWORD XboxType, const void *pSrc)
+{
+	UINT uiSrcSize;
+	std::vector<uint08> Dst(16, 0xCC);
+	EmuGetVertexConvertReferenceKernel(XboxType, &uiSrcSize)((const uint08 *)pSrc, uiSrcSize, Dst.data(), 16, 1);
+	return Dst;
+}
+
+TEST_CASE(VertexConvert_ReferenceValues)
+{
+	// 11, 11 and 10 bit components : x = -1023 (0x401), y = 1023 (0x3FF), z = -511 (0x201)
+	uint32 uiPacked = 0x401 | (0x3FF << 11) | (0x201u << 22);
+	std::vector<uint08> Dst = ConvertOne(X_D3DVSDT_NORMPACKED3, &uiPacked);
+	TEST_CHECK(Float(Dst.data(), 0) == -1.0f);
+	TEST_CHECK(Float(Dst.data(), 1) == 1.0f);
+	TEST_CHECK(Float(Dst.data(), 2) == -1.0f);
+	TEST_CHECK_EQUAL(Dst[12], 0xCC); // nothing written beyond FLOAT3
+
+	SHORT Shorts[4] = { -32767, 32767, 0, 16384 };
+	Dst = ConvertOne(X_D3DVSDT_NORMSHORT4, Shorts);
+	TEST_CHECK(Float(Dst.data(), 0) == -1.0f);
+	TEST_CHECK(Float(Dst.data(), 1) == 1.0f);
+	TEST_CHECK(Float(Dst.data(), 2) == 0.0f);
+	TEST_CHECK(Float(Dst.data(), 3) == 16384.0f / 32767.0f);
+
+	BYTE Bytes[4] = { 0, 255, 51, 1 };
+	Dst = ConvertOne(X_D3DVSDT_PBYTE4, Bytes);
+	TEST_CHECK(Float(Dst.data(), 0) == 0.0f);
+	TEST_CHECK(Float(Dst.data(), 1) == 1.0f);
+	TEST_CHECK(Float(Dst.data(), 2) == 0.2f);
+	TEST_CHECK(Float(Dst.data(), 3) == 1.0f / 255.0f);
+
+	// SHORT1 becomes SHORT2 (0 added), SHORT3 becomes SHORT4 (1 added)
+	Dst = ConvertOne(X_D3DVSDT_SHORT1, Shorts);
+	TEST_CHECK(((SHORT *)Dst.data())[0] == -32767 && ((SHORT *)Dst.data())[1] == 0);
+	Dst = ConvertOne(X_D3DVSDT_SHORT3, Shorts);
+	TEST_CHECK(((SHORT *)Dst.data())[2] == 0 && ((SHORT *)Dst.data())[3] == 1);
+
+	// FLOAT2H (x, y, w) becomes (x, y, 0, w)
+	float Floats[3] = { 0.5f, -2.0f, 4.0f };
+	Dst = ConvertOne(X_D3DVSDT_FLOAT2H, Floats);
+	TEST_CHECK(Float(Dst.data(), 0) == 0.5f && Float(Dst.data(), 1) == -2.0f);
+	TEST_CHECK(Float(Dst.data(), 2) == 0.0f && Float(Dst.data(), 3) == 4.0f);
+}
+
+// Runs the selected and the reference kernel over the same (unaligned, strided)
+// source, and checks the outputs are identical, including the bytes in between
+static bool KernelsMatch(const VertexType &Type, const std::vector<uint08> &Src, UINT uiSrcStride, UINT uiDstStride, UINT uiCount)
+{
+	UINT uiSrcSize;
+	VertexConvertKernel Kernel = EmuGetVertexConvertKernel(Type.XboxType, &uiSrcSize);
+	VertexConvertKernel Reference = EmuGetVertexConvertReferenceKernel(Type.XboxType, &uiSrcSize);
+
+	std::vector<uint08> A(uiDstStride * uiCount + 3, 0xCC), B(uiDstStride * uiCount + 3, 0xCC);
+	Kernel(Src.data() + 1, uiSrcStride, A.data() + 3, uiDstStride, uiCount);
+	Reference(Src.data() + 1, uiSrcStride, B.data() + 3, uiDstStride, uiCount);
+	return A == B;
+}
+
+TEST_CASE(VertexConvert_KernelsAreBitExact)
+{
+	srand(4);
+	for (auto &Type : VertexTypes) {
+		// Strides as tight as the attribute, and as wide as a fat vertex
+		const UINT SrcStrides[] = { Type.uiSrcSize, Type.uiSrcSize + 5, 36 };
+		const UINT DstStrides[] = { Type.uiDstSize, Type.uiDstSize + 4, 48 };
+		for (int s = 0; s < 3; s++) {
+			const UINT uiCount = 4099;
+			std::vector<uint08> Src(SrcStrides[s] * uiCount + 1);
+			for (auto &Byte : Src)
+				Byte = (uint08)rand();
+
+			if (!KernelsMatch(Type, Src, SrcStrides[s], DstStrides[s], uiCount)) {
+				printf("%s, source stride %u : kernels differ\n", Type.szName, SrcStrides[s]);
+				TEST_CHECK(false);
+			}
+		}
+	}
+}
+
+TEST_CASE(VertexConvert_KernelsAreBitExactForAllValues)
+{
+	// Every short and byte value, and every 11 bit component of packed normals
+	for (auto &Type : VertexTypes) {
+		if (Type.XboxType == X_D3DVSDT_FLOAT2H)
+			continue;
+
+		std::vector<uint08> Src(65536 * 2 + 1);
+		for (uint32 i = 0; i < 65536; i++) {
+			uint16 Value = (uint16)i;
+			if (Type.XboxType == X_D3DVSDT_NORMPACKED3)
+				Value = (uint16)((i << 5) | (i >> 11)); // let bits 0..10 and 11..15 take all values
+			memcpy(&Src[1 + i * 2], &Value, 2);
+		}
+
+		UINT uiCount = (65536 * 2) / Type.uiSrcSize;
+		if (!KernelsMatch(Type, Src, Type.uiSrcSize, Type.uiDstSize, uiCount)) {
+			printf("%s : kernels differ\n", Type.szName);
+			TEST_CHECK(false);
+		}
+	}
+}
+
+TEST_CASE(VertexConvert_CopyVertexAttributes)
+{
+	uint08 Src[64], Dst[64];
+	for (int i = 0; i < 64; i++)
+		Src[i] = (uint08)i;
+
+	// Contiguous
+	memset(Dst, 0xCC, sizeof(Dst));
+	EmuCopyVertexAttributes(Src, 8, Dst, 8, 8, 4);
+	TEST_CHECK_MEMORY(Dst, Src, 32);
+	TEST_CHECK_EQUAL(Dst[32], 0xCC);
+
+	// Strided : 4 of every 12 bytes, into every 8
+	memset(Dst, 0xCC, sizeof(Dst));
+	EmuCopyVertexAttributes(Src, 12, Dst, 8, 4, 3);
+	for (int v = 0; v < 3; v++) {
+		TEST_CHECK_MEMORY(Dst + v * 8, Src + v * 12, 4);
+		TEST_CHECK_EQUAL(Dst[v * 8 + 4], 0xCC);
+	}
+
+	// Nothing to copy
+	memset(Dst, 0xCC, sizeof(Dst));
+	EmuCopyVertexAttributes(Src, 12, Dst, 8, 0, 3);
+	TEST_CHECK_EQUAL(Dst[0], 0xCC);
+}
@@ -0,0 +1,75 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->XboxAdpcmBenchmark.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "HostBenchmark.h"
+#include "XboxAdpcmReference.h"
+#include "CxbxKrnl/XboxAdpcm.h"
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+BENCHMARK_MAIN_GLOBALS
+
+int main(int argc, char *argv[])
+{
+	BenchmarkInit(argc, argv);
+
+	// One second of 44.1 kHz audio is 679 blocks (per channel)
+	const size_t dwBlocks = 679;
+	const unsigned Channels[] = { 1, 2, 6 };
+	for (unsigned nChannels : Channels) {
+		std::vector<uint8_t> Src(dwBlocks * XBOX_ADPCM_SRCSIZE * nChannels);
+		std::vector<int16_t> Dst(dwBlocks * XBOX_ADPCM_SAMPLES_PER_BLOCK * nChannels);
+		for (auto &Byte : Src)
+			Byte = (uint8_t)rand();
+
+		const unsigned Samples = (unsigned)Dst.size();
+		std::string Name = std::to_string(nChannels) + " channel(s), ";
+
+		BenchmarkRun((Name + "IMA reference (per sample)").c_str(), 2000 / nChannels, Samples, [&](unsigned) {
+			ReferenceAdpcmDecode(Src.data(), Dst.data(), dwBlocks, nChannels);
+		});
+		BenchmarkRun((Name + "XboxAdpcmDecode, whole buffer (per sample)").c_str(), 2000 / nChannels, Samples, [&](unsigned) {
+			XboxAdpcmDecode(Src.data(), Dst.data(), dwBlocks, nChannels);
+		});
+		// The way HackUpdateSoundBuffers decodes : a few blocks ahead of the play cursor at a time
+		BenchmarkRun((Name + "XboxAdpcmDecode, 4 blocks per call (per sample)").c_str(), 2000 / nChannels, Samples, [&](unsigned) {
+			for (size_t Block = 0; Block + 4 <= dwBlocks; Block += 4)
+				XboxAdpcmDecode(&Src[Block * XBOX_ADPCM_SRCSIZE * nChannels], &Dst[Block * XBOX_ADPCM_SAMPLES_PER_BLOCK * nChannels], 4, nChannels);
+		});
+		BenchmarkKeep(Dst[Samples - 1]);
+	}
+
+	return 0;
+}
@@ -0,0 +1,114 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->XboxAdpcmReference.h
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef XBOXADPCMREFERENCE_H
+#define XBOXADPCMREFERENCE_H
+
+// A straightforward IMA ADPCM decoder (one sample at a time, following the IMA reference
+// code), over the Xbox ADPCM block layout described in CxbxKrnl/XboxAdpcm.h. It's what the
+// table driven XboxAdpcmDecode is tested and measured against.
+
+#include <cstddef>
+#include <cstdint>
+
+static const int ReferenceStepTable[89] = {
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+	19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+	50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+	130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+	337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+	876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+	2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+	5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+	15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int ReferenceIndexTable[16] = {
+	-1, -1, -1, -1, 2, 4, 6, 8,
+	-1, -1, -1, -1, 2, 4, 6, 8
+};
+
+inline int16_t ReferenceDecodeSample(int &Predictor, int &Index, int Code)
+{
+	int Step = ReferenceStepTable[Index];
+	int Delta = Step >> 3;
+
+	if (Code & 4) Delta += Step;
+	if (Code & 2) Delta += Step >> 1;
+	if (Code & 1) Delta += Step >> 2;
+
+	if (Code & 8)
+		Predictor -= Delta;
+	else
+		Predictor += Delta;
+
+	if (Predictor > 32767)
+		Predictor = 32767;
+	else if (Predictor < -32768)
+		Predictor = -32768;
+
+	Index += ReferenceIndexTable[Code];
+	if (Index < 0)
+		Index = 0;
+	else if (Index > 88)
+		Index = 88;
+
+	return (int16_t)Predictor;
+}
+
+inline void ReferenceAdpcmDecode(const uint8_t *pSrc, int16_t *pDst, size_t dwBlocks, unsigned nChannels)
+{
+	for (size_t Block = 0; Block < dwBlocks; Block++) {
+		const uint8_t *pBlock = pSrc + Block * 36 * nChannels;
+		int16_t *pSamples = pDst + Block * 65 * nChannels;
+
+		for (unsigned c = 0; c < nChannels; c++) {
+			int Predictor = (int16_t)(pBlock[c * 4] | (pBlock[c * 4 + 1] << 8));
+			int Index = pBlock[c * 4 + 2];
+
+			if (Index > 88)
+				Index = 88;
+
+			pSamples[c] = (int16_t)Predictor;
+			for (int s = 0; s < 64; s++) {
+				// Groups of 4 bytes (8 samples) per channel, low nibble first
+				uint8_t Byte = pBlock[nChannels * 4 + ((s / 8) * nChannels + c) * 4 + (s % 8) / 2];
+				int Code = (s & 1) ? (Byte >> 4) : (Byte & 15);
+
+				pSamples[(1 + s) * nChannels + c] = ReferenceDecodeSample(Predictor, Index, Code);
+			}
+		}
+	}
+}
+
+#endif // XBOXADPCMREFERENCE_H
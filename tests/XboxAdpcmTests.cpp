@@ -0,0 +1,205 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->XboxAdpcmTests.cpp
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#include "HostTest.h"
+#include "XboxAdpcmReference.h"
+#include "CxbxKrnl/XboxAdpcm.h"
+
+#include <cstdlib>
+#include <vector>
+
+// Builds a block of one channel : the header, followed by the 32 bytes of codes
+static void MonoBlock(uint8_t *pBlock, int16_t First, uint8_t Index, const uint8_t *pCodes)
+{
+	pBlock[0] = (uint8_t)First;
+	pBlock[1] = (uint8_t)((uint16_t)First >> 8);
+	pBlock[2] = Index;
+	pBlock[3] = 0;
+	memcpy(pBlock + 4, pCodes, 32);
+}
+
+// The golden samples below were computed independently from the IMA ADPCM specification
+
+static const uint8_t MonoCodes[32] = {
+	0, 33, 66, 51, 84, 117, 102, 135, 168, 153, 186, 219, 204, 237, 14, 255,
+	32, 65, 50, 83, 116, 101, 134, 167, 152, 185, 218, 203, 236, 13, 254, 31
+};
+
+static const int16_t MonoSamples[65] = {
+	-1234, -1232, -1230, -1224, -1216, -1209, -1196, -1185, -1175, -1162, -1144, -1116, -1060,
+	-953, -762, -371, -427, -478, -709, -835, -949, -1122, -1342, -1542, -1829, -2174,
+	-2591, -3208, -4277, -6171, -5913, -9433, -16981, -15903, -11001, -8327, -1033, 3869,
+	10109, 15782, 23885, 32767, 32767, 32767, 32767, 32767, 28672, 32767, 12289, 8565,
+	-1591, -10823, -30409, -32768, -32768, -32768, -32768, -32768, -32768, -32768, -28673,
+	-32768, -32768, -32768, -20482
+};
+
+TEST_CASE(XboxAdpcm_MonoGolden)
+{
+	uint8_t Block[XBOX_ADPCM_SRCSIZE];
+	int16_t Samples[XBOX_ADPCM_SAMPLES_PER_BLOCK];
+
+	MonoBlock(Block, -1234, 10, MonoCodes);
+	XboxAdpcmDecode(Block, Samples, 1, 1);
+	TEST_CHECK_MEMORY(Samples, MonoSamples, sizeof(Samples));
+}
+
+TEST_CASE(XboxAdpcm_Clamping)
+{
+	// Positive steps from near the top at a large step size, then negative ones
+	uint8_t Codes[32], Block[XBOX_ADPCM_SRCSIZE];
+	int16_t Samples[XBOX_ADPCM_SAMPLES_PER_BLOCK];
+
+	memset(Codes, 0x77, 16);
+	memset(Codes + 16, 0xFF, 16);
+	MonoBlock(Block, 32000, 80, Codes);
+	XboxAdpcmDecode(Block, Samples, 1, 1);
+
+	TEST_CHECK_EQUAL(Samples[0], 32000);
+	for (int i = 1; i <= 32; i++)
+		TEST_CHECK_EQUAL(Samples[i], 32767);
+	TEST_CHECK_EQUAL(Samples[33], -28669);
+	for (int i = 34; i < 65; i++)
+		TEST_CHECK_EQUAL(Samples[i], -32768);
+}
+
+TEST_CASE(XboxAdpcm_StepIndexAbove88)
+{
+	// Step indices past the end of the step table act as the last one
+	uint8_t Block88[XBOX_ADPCM_SRCSIZE], Block[XBOX_ADPCM_SRCSIZE];
+	int16_t Expected[XBOX_ADPCM_SAMPLES_PER_BLOCK], Samples[XBOX_ADPCM_SAMPLES_PER_BLOCK];
+
+	MonoBlock(Block88, 0, 88, MonoCodes);
+	XboxAdpcmDecode(Block88, Expected, 1, 1);
+	TEST_CHECK_EQUAL(Expected[1], 32767 >> 3); // code 0 at step index 88 adds Step / 8
+
+	for (int Index = 89; Index < 256; Index++) {
+		MonoBlock(Block, 0, (uint8_t)Index, MonoCodes);
+		XboxAdpcmDecode(Block, Samples, 1, 1);
+		TEST_CHECK_MEMORY(Samples, Expected, sizeof(Samples));
+	}
+}
+
+static const uint8_t LeftCodes[32] = {
+	5, 42, 79, 116, 153, 190, 227, 8, 45, 82, 119, 156, 193, 230, 11, 48,
+	85, 122, 159, 196, 233, 14, 51, 88, 125, 162, 199, 236, 17, 54, 91, 128
+};
+
+static const uint8_t RightCodes[32] = {
+	200, 35, 126, 217, 52, 143, 234, 69, 160, 251, 86, 177, 12, 103, 194, 29,
+	120, 211, 46, 137, 228, 63, 154, 245, 80, 171, 6, 97, 188, 23, 114, 205
+};
+
+static const int16_t LeftSamples[65] = {
+	100, 113, 114, 107, 114, 95, 120, 151, 214, 187, 163, 66, -26, 58, -85, -104, -87,
+	-265, -147, -40, 175, 605, 1530, 338, -142, 294, -898, 1185, -2507, -6029, -5572,
+	-5157, -2511, 1268, 6803, 3120, 13165, -8371, -17603, 7580, -22891, -32768, -32768,
+	-32768, -28673, -2604, 21095, 18018, 32767, -12286, 32767, 32767, 14146, 32767, -4095,
+	-32768, -32768, -20482, -9310, 32767, 32767, 6698, 32767, 32767, 29043
+};
+
+static const int16_t RightSamples[65] = {
+	-30000, -30284, -32608, -30423, -29003, -32360, -25498, -28439, -32768, -21021, -9967,
+	-31503, -32768, -32768, -32768, 12285, 32767, 32767, 14146, -9553, -32768, 20477,
+	32767, 32767, 6698, -23773, -19678, 32767, 32767, 32767, -751, -32768, -20482, -24206,
+	26579, 32767, -8199, -32768, -12290, -23462, -26847, 853, -32768, -32768, -4099,
+	-22720, -32768, 1087, -32768, -28673, 12293, -16376, -32768, 11246, 15341, 26513,
+	32767, -4095, -32764, 23099, 32767, 32767, 32767, -12286, -32768
+};
+
+TEST_CASE(XboxAdpcm_StereoGolden)
+{
+	// Both headers first, then the channels alternate per 4 bytes of codes
+	uint8_t Block[2 * XBOX_ADPCM_SRCSIZE];
+	int16_t Samples[2 * XBOX_ADPCM_SAMPLES_PER_BLOCK];
+
+	Block[0] = 100; Block[1] = 0; Block[2] = 3; Block[3] = 0;
+	Block[4] = (uint8_t)(-30000 & 0xFF); Block[5] = (uint8_t)((-30000 >> 8) & 0xFF); Block[6] = 60; Block[7] = 0;
+	for (int Group = 0; Group < 8; Group++) {
+		memcpy(&Block[8 + Group * 8], &LeftCodes[Group * 4], 4);
+		memcpy(&Block[8 + Group * 8 + 4], &RightCodes[Group * 4], 4);
+	}
+
+	XboxAdpcmDecode(Block, Samples, 1, 2);
+	for (int i = 0; i < XBOX_ADPCM_SAMPLES_PER_BLOCK; i++) {
+		TEST_CHECK_EQUAL(Samples[i * 2], LeftSamples[i]);
+		TEST_CHECK_EQUAL(Samples[i * 2 + 1], RightSamples[i]);
+	}
+}
+
+TEST_CASE(XboxAdpcm_MatchesReference)
+{
+	srand(10);
+	for (unsigned nChannels = 1; nChannels <= XBOX_ADPCM_MAX_CHANNELS; nChannels++) {
+		const size_t dwBlocks = 100;
+		std::vector<uint8_t> Src(dwBlocks * XBOX_ADPCM_SRCSIZE * nChannels);
+		for (auto &Byte : Src)
+			Byte = (uint8_t)rand();
+
+		std::vector<int16_t> Expected(dwBlocks * XBOX_ADPCM_SAMPLES_PER_BLOCK * nChannels), Actual(Expected.size());
+		ReferenceAdpcmDecode(Src.data(), Expected.data(), dwBlocks, nChannels);
+
+		// All at once, and block by block (the way buffers are decoded incrementally)
+		XboxAdpcmDecode(Src.data(), Actual.data(), dwBlocks, nChannels);
+		TEST_CHECK(Actual == Expected);
+
+		std::fill(Actual.begin(), Actual.end(), 0);
+		for (size_t Block = 0; Block < dwBlocks; Block++)
+			XboxAdpcmDecode(&Src[Block * XBOX_ADPCM_SRCSIZE * nChannels], &Actual[Block * XBOX_ADPCM_SAMPLES_PER_BLOCK * nChannels], 1, nChannels);
+		TEST_CHECK(Actual == Expected);
+
+		TEST_CHECK_EQUAL(XboxAdpcmDecodedSize(Src.size(), nChannels), Expected.size() * sizeof(int16_t));
+		TEST_CHECK_EQUAL(XboxAdpcmEncodedSize(Expected.size() * sizeof(int16_t), nChannels), Src.size());
+	}
+}
+
+TEST_CASE(XboxAdpcm_Sizes)
+{
+	// Only whole blocks count
+	TEST_CHECK_EQUAL(XboxAdpcmDecodedSize(35, 1), 0);
+	TEST_CHECK_EQUAL(XboxAdpcmDecodedSize(36 * 3 + 20, 1), 130 * 3);
+	TEST_CHECK_EQUAL(XboxAdpcmDecodedSize(72 * 2 + 36, 2), 260 * 2);
+	TEST_CHECK_EQUAL(XboxAdpcmEncodedSize(130 * 5 + 129, 1), 36 * 5);
+	TEST_CHECK_EQUAL(XboxAdpcmEncodedSize(260 * 4, 2), 72 * 4);
+}
+
+TEST_CASE(XboxAdpcm_UnsupportedChannels)
+{
+	uint8_t Block[XBOX_ADPCM_SRCSIZE * (XBOX_ADPCM_MAX_CHANNELS + 1)] = { 1, 2, 3 };
+	int16_t Samples[XBOX_ADPCM_SAMPLES_PER_BLOCK * (XBOX_ADPCM_MAX_CHANNELS + 1)] = { 0 };
+	int16_t Zero[XBOX_ADPCM_SAMPLES_PER_BLOCK * (XBOX_ADPCM_MAX_CHANNELS + 1)] = { 0 };
+
+	XboxAdpcmDecode(Block, Samples, 1, 0);
+	XboxAdpcmDecode(Block, Samples, 1, XBOX_ADPCM_MAX_CHANNELS + 1);
+	TEST_CHECK_MEMORY(Samples, Zero, sizeof(Samples));
+}
@@ -0,0 +1,55 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->compat->intrin.h
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef COMPAT_INTRIN_H
+#define COMPAT_INTRIN_H
+
+// A stand-in for the MSVC <intrin.h>, with the intrinsics the tested sources use,
+// implemented on the GCC builtins. This directory is never used for Windows builds.
+
+#include <x86intrin.h> // for __rdtsc
+
+inline unsigned char _BitScanForward(unsigned long *Index, unsigned int Mask)
+{
+	// MSVC leaves *Index undefined for a zero mask
+	*Index = (Mask != 0) ? (unsigned long)__builtin_ctz(Mask) : 0;
+	return Mask != 0;
+}
+
+inline unsigned char _BitScanReverse(unsigned long *Index, unsigned int Mask)
+{
+	*Index = (Mask != 0) ? 31 - (unsigned long)__builtin_clz(Mask) : 0;
+	return Mask != 0;
+}
+
+#endif // COMPAT_INTRIN_H
@@ -0,0 +1,310 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->compat->windows.h
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef COMPAT_WINDOWS_H
+#define COMPAT_WINDOWS_H
+
+// A stand-in for <windows.h>, so the host tests can build sources that use a
+// few Win32 types and synchronization functions on Linux. Only what the tested
+// sources need is here, implemented on top of POSIX (and futexes for the
+// WaitOnAddress family). This directory is never used for Windows builds.
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <climits>
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <emmintrin.h>
+
+#define WINAPI
+#define NTAPI
+#define IN
+#define OUT
+#define OPTIONAL
+#define VOID void
+#define CONST const
+#define TRUE 1
+#define FALSE 0
+#ifndef NULL
+#define NULL 0
+#endif
+#define INFINITE 0xFFFFFFFF
+
+typedef int BOOL;
+typedef uint8_t BYTE, *PBYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD, *PDWORD;
+typedef int32_t LONG, *PLONG;
+typedef uint32_t ULONG, *PULONG;
+typedef int64_t LONGLONG;
+typedef uint64_t ULONGLONG, UINT64;
+typedef unsigned int UINT;
+typedef size_t SIZE_T;
+typedef char CHAR;
+typedef short SHORT;
+typedef float FLOAT;
+typedef void *PVOID, *LPVOID, *HANDLE, *HMODULE;
+typedef const void *LPCVOID;
+typedef int (*FARPROC)();
+
+#define ARRAYSIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+typedef union _LARGE_INTEGER
+{
+	struct { DWORD LowPart; LONG HighPart; };
+	LONGLONG QuadPart;
+} LARGE_INTEGER;
+
+typedef struct _SYSTEM_INFO
+{
+	DWORD dwNumberOfProcessors;
+} SYSTEM_INFO;
+
+// ******************************************************************
+// * Interlocked functions
+// ******************************************************************
+
+inline LONG InterlockedIncrement(volatile LONG *p) { return __atomic_add_fetch(p, 1, __ATOMIC_SEQ_CST); }
+inline LONG InterlockedDecrement(volatile LONG *p) { return __atomic_sub_fetch(p, 1, __ATOMIC_SEQ_CST); }
+inline LONG InterlockedExchange(volatile LONG *p, LONG v) { return __atomic_exchange_n(p, v, __ATOMIC_SEQ_CST); }
+inline LONG InterlockedExchangeAdd(volatile LONG *p, LONG v) { return __atomic_fetch_add(p, v, __ATOMIC_SEQ_CST); }
+inline LONG InterlockedCompareExchange(volatile LONG *p, LONG v, LONG c)
+{
+	__atomic_compare_exchange_n(p, &c, v, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return c;
+}
+inline LONGLONG InterlockedExchangeAdd64(volatile LONGLONG *p, LONGLONG v) { return __atomic_fetch_add(p, v, __ATOMIC_SEQ_CST); }
+
+// The pre VC++.NET headers declared this on PVOIDs, which were 32 bit wide;
+// Mutex.cpp uses that form whenever _MSC_VER isn't defined
+inline PVOID InterlockedCompareExchange(PVOID *p, PVOID v, PVOID c)
+{
+	return (PVOID)(intptr_t)InterlockedCompareExchange((volatile LONG *)p, (LONG)(intptr_t)v, (LONG)(intptr_t)c);
+}
+
+#define YieldProcessor() _mm_pause()
+#define MemoryBarrier() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+// ******************************************************************
+// * Processes, threads and time
+// ******************************************************************
+
+// Both are cached, as they're plain memory reads on Windows
+inline DWORD GetCurrentProcessId()
+{
+	static DWORD dwProcessId = (DWORD)getpid();
+	return dwProcessId;
+}
+
+inline DWORD GetCurrentThreadId()
+{
+	static thread_local DWORD dwThreadId = (DWORD)syscall(SYS_gettid);
+	return dwThreadId;
+}
+inline void Sleep(DWORD dwMilliseconds) { usleep(dwMilliseconds * 1000); }
+inline BOOL SwitchToThread() { return sched_yield() == 0; }
+
+inline void GetSystemInfo(SYSTEM_INFO *pInfo)
+{
+	pInfo->dwNumberOfProcessors = (DWORD)sysconf(_SC_NPROCESSORS_ONLN);
+}
+
+#define PF_XMMI64_INSTRUCTIONS_AVAILABLE 10
+
+inline BOOL IsProcessorFeaturePresent(DWORD ProcessorFeature)
+{
+	return (ProcessorFeature == PF_XMMI64_INSTRUCTIONS_AVAILABLE) && __builtin_cpu_supports("sse2");
+}
+
+inline BOOL QueryPerformanceFrequency(LARGE_INTEGER *pFrequency)
+{
+	pFrequency->QuadPart = 1000000000;
+	return TRUE;
+}
+
+inline BOOL QueryPerformanceCounter(LARGE_INTEGER *pCounter)
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	pCounter->QuadPart = (LONGLONG)ts.tv_sec * 1000000000 + ts.tv_nsec;
+	return TRUE;
+}
+
+// ******************************************************************
+// * Critical sections (recursive, like on Windows)
+// ******************************************************************
+
+typedef pthread_mutex_t CRITICAL_SECTION;
+
+inline void InitializeCriticalSection(CRITICAL_SECTION *pCriticalSection)
+{
+	pthread_mutexattr_t Attributes;
+	pthread_mutexattr_init(&Attributes);
+	pthread_mutexattr_settype(&Attributes, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(pCriticalSection, &Attributes);
+	pthread_mutexattr_destroy(&Attributes);
+}
+
+inline void DeleteCriticalSection(CRITICAL_SECTION *pCriticalSection) { pthread_mutex_destroy(pCriticalSection); }
+inline void EnterCriticalSection(CRITICAL_SECTION *pCriticalSection) { pthread_mutex_lock(pCriticalSection); }
+inline void LeaveCriticalSection(CRITICAL_SECTION *pCriticalSection) { pthread_mutex_unlock(pCriticalSection); }
+
+// ******************************************************************
+// * Slim reader/writer locks
+// ******************************************************************
+
+typedef pthread_rwlock_t SRWLOCK, *PSRWLOCK;
+
+#define SRWLOCK_INIT PTHREAD_RWLOCK_INITIALIZER
+
+inline void InitializeSRWLock(PSRWLOCK SRWLock) { pthread_rwlock_init(SRWLock, nullptr); }
+inline void AcquireSRWLockShared(PSRWLOCK SRWLock) { pthread_rwlock_rdlock(SRWLock); }
+inline void ReleaseSRWLockShared(PSRWLOCK SRWLock) { pthread_rwlock_unlock(SRWLock); }
+inline void AcquireSRWLockExclusive(PSRWLOCK SRWLock) { pthread_rwlock_wrlock(SRWLock); }
+inline void ReleaseSRWLockExclusive(PSRWLOCK SRWLock) { pthread_rwlock_unlock(SRWLock); }
+inline BOOL TryAcquireSRWLockShared(PSRWLOCK SRWLock) { return pthread_rwlock_tryrdlock(SRWLock) == 0; }
+inline BOOL TryAcquireSRWLockExclusive(PSRWLOCK SRWLock) { return pthread_rwlock_trywrlock(SRWLock) == 0; }
+
+// ******************************************************************
+// * Exceptions (the 32 bit x86 context record)
+// ******************************************************************
+
+#define MAXIMUM_SUPPORTED_EXTENSION 512
+
+typedef struct _FLOATING_SAVE_AREA
+{
+	DWORD ControlWord, StatusWord, TagWord, ErrorOffset, ErrorSelector, DataOffset, DataSelector;
+	BYTE RegisterArea[80];
+	DWORD Cr0NpxState;
+} FLOATING_SAVE_AREA;
+
+typedef struct _CONTEXT
+{
+	DWORD ContextFlags;
+	DWORD Dr0, Dr1, Dr2, Dr3, Dr6, Dr7;
+	FLOATING_SAVE_AREA FloatSave;
+	DWORD SegGs, SegFs, SegEs, SegDs;
+	DWORD Edi, Esi, Ebx, Edx, Ecx, Eax;
+	DWORD Ebp, Eip, SegCs, EFlags, Esp, SegSs;
+	BYTE ExtendedRegisters[MAXIMUM_SUPPORTED_EXTENSION];
+} CONTEXT, *PCONTEXT;
+
+typedef struct _EXCEPTION_POINTERS
+{
+	PVOID ExceptionRecord;
+	PCONTEXT ContextRecord;
+} EXCEPTION_POINTERS, *PEXCEPTION_POINTERS, *LPEXCEPTION_POINTERS;
+
+// ******************************************************************
+// * Virtual memory
+// ******************************************************************
+
+#define MEM_COMMIT     0x1000
+#define MEM_FREE       0x10000
+#define PAGE_NOACCESS  0x01
+#define PAGE_READWRITE 0x04
+#define PAGE_GUARD     0x100
+
+typedef struct _MEMORY_BASIC_INFORMATION
+{
+	PVOID BaseAddress;
+	PVOID AllocationBase;
+	DWORD AllocationProtect;
+	SIZE_T RegionSize;
+	DWORD State;
+	DWORD Protect;
+	DWORD Type;
+} MEMORY_BASIC_INFORMATION;
+
+// Reports the page at lpAddress as committed read/write memory when it's mapped, and free
+// otherwise (mincore fails on unmapped pages). The protection of mapped pages isn't known.
+inline SIZE_T VirtualQuery(LPCVOID lpAddress, MEMORY_BASIC_INFORMATION *pBuffer, SIZE_T dwLength)
+{
+	uintptr_t PageSize = (uintptr_t)sysconf(_SC_PAGESIZE);
+	uintptr_t Page = (uintptr_t)lpAddress & ~(PageSize - 1);
+	unsigned char Resident;
+	bool bMapped = mincore((void *)Page, PageSize, &Resident) == 0;
+
+	memset(pBuffer, 0, sizeof(*pBuffer));
+	pBuffer->BaseAddress = (PVOID)Page;
+	pBuffer->AllocationBase = (PVOID)Page;
+	pBuffer->RegionSize = PageSize;
+	pBuffer->State = bMapped ? MEM_COMMIT : MEM_FREE;
+	pBuffer->Protect = bMapped ? PAGE_READWRITE : PAGE_NOACCESS;
+	return sizeof(*pBuffer);
+}
+
+// ******************************************************************
+// * WaitOnAddress family (32 bit values only), on futexes
+// ******************************************************************
+
+inline BOOL WaitOnAddress(volatile VOID *Address, PVOID CompareAddress, SIZE_T AddressSize, DWORD dwMilliseconds)
+{
+	timespec Timeout = { (time_t)(dwMilliseconds / 1000), (long)(dwMilliseconds % 1000) * 1000000 };
+	syscall(SYS_futex, (int *)Address, FUTEX_WAIT_PRIVATE, *(int *)CompareAddress,
+		(dwMilliseconds == INFINITE) ? nullptr : &Timeout, nullptr, 0);
+	return TRUE;
+}
+
+inline VOID WakeByAddressSingle(PVOID Address) { syscall(SYS_futex, (int *)Address, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0); }
+inline VOID WakeByAddressAll(PVOID Address) { syscall(SYS_futex, (int *)Address, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0); }
+
+// Code that resolves these at runtime (like Mutex.cpp does) gets them from "kernelbase.dll",
+// unless CXBX_NO_WAITONADDRESS is set, which makes them missing like on Windows 7
+inline HMODULE GetModuleHandleA(const char *szModuleName)
+{
+	return (strcmp(szModuleName, "kernelbase.dll") == 0) ? (HMODULE)1 : NULL;
+}
+
+inline FARPROC GetProcAddress(HMODULE hModule, const char *szProcName)
+{
+	if (hModule == (HMODULE)1 && getenv("CXBX_NO_WAITONADDRESS") == NULL) {
+		if (strcmp(szProcName, "WaitOnAddress") == 0)
+			return (FARPROC)&WaitOnAddress;
+		if (strcmp(szProcName, "WakeByAddressSingle") == 0)
+			return (FARPROC)&WakeByAddressSingle;
+		if (strcmp(szProcName, "WakeByAddressAll") == 0)
+			return (FARPROC)&WakeByAddressAll;
+	}
+
+	return NULL;
+}
+
+#endif // COMPAT_WINDOWS_H
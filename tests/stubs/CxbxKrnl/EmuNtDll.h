@@ -0,0 +1,60 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->stubs->EmuNtDll.h
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef STUBS_EMUNTDLL_H
+#define STUBS_EMUNTDLL_H
+
+// Stands in for CxbxKrnl/EmuNtDll.h in the host tests (included within namespace
+// NtDll, like the real one). Only the critical section functions are declared;
+// tests that use them define them.
+
+typedef LONG NTSTATUS;
+
+typedef struct _RTL_CRITICAL_SECTION
+{
+    DWORD               Unknown[4];                                     // 0x00
+    LONG                LockCount;                                      // 0x10
+    LONG                RecursionCount;                                 // 0x14
+    HANDLE              OwningThread;                                   // 0x18
+    HANDLE              LockSemaphore;
+    DWORD               Reserved;
+}
+RTL_CRITICAL_SECTION, *PRTL_CRITICAL_SECTION;
+
+VOID RtlInitializeCriticalSection(PRTL_CRITICAL_SECTION CriticalSection);
+NTSTATUS RtlDeleteCriticalSection(PRTL_CRITICAL_SECTION CriticalSection);
+VOID RtlEnterCriticalSection(PRTL_CRITICAL_SECTION CriticalSection);
+BOOL RtlTryEnterCriticalSection(PRTL_CRITICAL_SECTION CriticalSection);
+VOID RtlLeaveCriticalSection(PRTL_CRITICAL_SECTION CriticalSection);
+
+#endif // STUBS_EMUNTDLL_H
@@ -0,0 +1,68 @@
+// ******************************************************************
+// *
+// *    .,-:::::    .,::      .::::::::.    .,::      .:
+// *  ,;;;'````'    `;;;,  .,;;  ;;;'';;'   `;;;,  .,;;
+// *  [[[             '[[,,[['   [[[__[[\.    '[[,,[['
+// *  $$$              Y$$$P     $$""""Y$$     Y$$$P
+// *  `88bo,__,o,    oP"``"Yo,  _88o,,od8P   oP"``"Yo,
+// *    "YUMMMMMP",m"       "Mm,""YUMMMP" ,m"       "Mm,
+// *
+// *   Cxbx->Tests->stubs->EmuXTL.h
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  (c) 2002-2003 Aaron Robinson <caustik@caustik.com>
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef STUBS_EMUXTL_H
+#define STUBS_EMUXTL_H
+
+// Stands in for CxbxKrnl/EmuXTL.h in the host tests. The real one pulls in the
+// Direct3D 8 and DirectSound headers; the tested D3D helpers only need their
+// own declarations, a few Xbox constants (copied from EmuD3D8Types.h), and
+// opaque stand-ins for the resource types the texture cache keeps pointers to.
+
+#include "Emu.h"
+
+namespace XTL
+{
+	const int X_D3DVSDT_NORMSHORT1  = 0x11;
+	const int X_D3DVSDT_NORMSHORT2  = 0x21;
+	const int X_D3DVSDT_NORMSHORT3  = 0x31;
+	const int X_D3DVSDT_NORMSHORT4  = 0x41;
+	const int X_D3DVSDT_NORMPACKED3 = 0x16;
+	const int X_D3DVSDT_SHORT1      = 0x15;
+	const int X_D3DVSDT_SHORT3      = 0x35;
+	const int X_D3DVSDT_PBYTE1      = 0x14;
+	const int X_D3DVSDT_PBYTE2      = 0x24;
+	const int X_D3DVSDT_PBYTE3      = 0x34;
+	const int X_D3DVSDT_PBYTE4      = 0x44;
+	const int X_D3DVSDT_FLOAT2H     = 0x72;
+
+	#include "CxbxKrnl/EmuD3D8/VertexConvert.h"
+	#include "CxbxKrnl/EmuD3D8/Swizzle.h"
+
+	struct X_D3DResource { DWORD Common; DWORD Data; DWORD Lock; };
+	struct IDirect3DBaseTexture8 { virtual ULONG Release() = 0; };
+
+	#include "CxbxKrnl/EmuD3D8/TextureCache.h"
+}
+
+#endif // STUBS_EMUXTL_H